@@ -2,21 +2,51 @@
 
 #include <filesystem>
 #include <cmath>
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
 
 DICOMDirParser::DICOMDirParser(const std::string& directory) {
   sortIntoStacks(scanFiles(directory));
 }
 
+std::vector<uint8_t> DICOMDirParser::getRawData(size_t i) const {
+  std::vector<size_t> offsets(stacks[i].size()+1, 0);
+  for (size_t j = 0;j<stacks[i].size();++j) {
+    offsets[j+1] = offsets[j] + stacks[i][j].getRawDataSize();
+  }
+  std::vector<uint8_t> result(offsets.back());
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t j = 0;j<int64_t(stacks[i].size());++j) {
+    stacks[i][size_t(j)].readData(result.data() + offsets[size_t(j)]);
+  }
+  return result;
+}
+
 std::vector<DICOMFile> DICOMDirParser::scanFiles(const std::string& directory) const {
-  std::vector<DICOMFile> files;
+  std::vector<std::string> paths;
   for (auto& p: std::filesystem::directory_iterator(directory)) {
+    if (p.is_regular_file()) paths.push_back(p.path().string());
+  }
+
+  // the headers are independent, parse them in parallel and keep the order
+  // of the directory listing
+  std::vector<std::optional<DICOMFile>> parsed(paths.size());
+  #pragma omp parallel for schedule(dynamic, 16)
+  for (int64_t i = 0;i<int64_t(paths.size());++i) {
     try {
-      DICOMFile dicomFile{p.path().string()};
-      files.push_back(dicomFile);
+      parsed[size_t(i)].emplace(paths[size_t(i)]);
     } catch (const DICOMFileException& e) {
-      // std::cout << "Unable to read " << p.path() << " " << e.what() << std::endl;
+      // std::cout << "Unable to read " << paths[size_t(i)] << " " << e.what() << std::endl;
     }
   }
+
+  std::vector<DICOMFile> files;
+  files.reserve(paths.size());
+  for (std::optional<DICOMFile>& file : parsed) {
+    if (file) files.push_back(std::move(*file));
+  }
   return files;
 }
 
@@ -29,20 +59,25 @@ static bool sortByDepth( const DICOMFile& a, const DICOMFile& b ) {
 }
 
 
-void DICOMDirParser::sortIntoStacks(const std::vector<DICOMFile>& files) {
+void DICOMDirParser::sortIntoStacks(std::vector<DICOMFile> files) {
   
-  // group files into stacks
+  // group files into stacks, only stacks with the same hash are compared
+  std::unordered_multimap<size_t, size_t> stacksByHash;
   for (size_t i = 0; i<files.size(); i++) {
+    const size_t hash = files[i].stackHash();
     bool bFoundMatch = false;
-    for (size_t j = 0; j<stacks.size(); j++) {
-      if (files[i].match(stacks[j][0])) {
-        stacks[j].push_back(files[i]);
+    const auto candidates = stacksByHash.equal_range(hash);
+    for (auto it = candidates.first; it != candidates.second; ++it) {
+      if (files[i].match(stacks[it->second][0])) {
+        stacks[it->second].push_back(std::move(files[i]));
         bFoundMatch = true;
         break;
       }
     }
     if (!bFoundMatch) {
-      stacks.push_back(std::vector<DICOMFile>{files[i]});
+      stacksByHash.insert({hash, stacks.size()});
+      stacks.emplace_back();
+      stacks.back().push_back(std::move(files[i]));
     }
   }
 
@@ -57,11 +92,11 @@ void DICOMDirParser::sortIntoStacks(const std::vector<DICOMFile>& files) {
   // fix Z aspect ratio - which is broken in many DICOMs - using the patient position
   for (size_t i = 0; i<stacks.size(); i++) {
     if (stacks[i].size() < 2) continue;
-    DCMVec3 dir{fabs(stacks[i][1].getPatientPosition().x -
+    DCMVec3 dir{std::fabs(stacks[i][1].getPatientPosition().x -
                   stacks[i][0].getPatientPosition().x),
-             fabs(stacks[i][1].getPatientPosition().y -
+             std::fabs(stacks[i][1].getPatientPosition().y -
                   stacks[i][0].getPatientPosition().y),
-             fabs(stacks[i][1].getPatientPosition().z -
+             std::fabs(stacks[i][1].getPatientPosition().z -
                   stacks[i][0].getPatientPosition().z)};
 
     float fZDistance = sqrtf(dir.x*dir.x + dir.y*dir.y + dir.z*dir.z);
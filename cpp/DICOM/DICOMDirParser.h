@@ -31,28 +31,24 @@ public:
     return stacks[i][0].getAllocated();
   }
   
-  std::vector<uint8_t> getRawData(size_t i) const {
-    size_t totalSize{0};
-    for (size_t j = 0;j<stacks[i].size();++j) {
-      totalSize += stacks[i][j].getRawDataSize();
-    }
-    std::vector<uint8_t> result(totalSize);
-    
-    uint32_t offset{0};
-    for (size_t j = 0;j<stacks[i].size();++j) {
-      std::vector<uint8_t> currentData = stacks[i][j].getData();
-      std::copy(currentData.begin(), currentData.end(), result.begin()+offset);
-      offset += stacks[i][j].getRawDataSize();
-    }
-    return result;
-  }
+  // all slices of volume i, read in parallel straight into the result
+  std::vector<uint8_t> getRawData(size_t i) const;
 
+  size_t getSliceCount(size_t i) const {
+    return stacks[i].size();
+  }
 
+  // a single slice j of volume i, for consumers that stream the volume
+  std::vector<uint8_t> getSlice(size_t i, size_t j) const {
+    std::vector<uint8_t> result(stacks[i][j].getRawDataSize());
+    stacks[i][j].readData(result.data());
+    return result;
+  }
 
 private:
   std::vector<std::vector<DICOMFile>> stacks;
     
   std::vector<DICOMFile> scanFiles(const std::string& directory) const ;
-  void sortIntoStacks(const std::vector<DICOMFile>& files);
+  void sortIntoStacks(std::vector<DICOMFile> files);
 
 };
@@ -1,9 +1,12 @@
 #include <sstream>
-#include <filesystem>
 #include <climits>
+#include <cstring>
+#include <functional>
+#include <algorithm>
 #include "DICOMFile.h"
 
 
+
 template <typename T>
 T swap_endian(T u) {
     union {
@@ -26,6 +29,56 @@ inline bool machineIsBigEndian() {
 }
 
 
+// most headers are much smaller, larger ones are read in growing chunks
+static const size_t headerChunk{64*1024};
+
+DICOMStream::DICOMStream(const std::string& filename) :
+  file(filename, std::ios::in | std::ios::binary)
+{
+  if (!file) throw DICOMFileException("Error reading file stats");
+  file.seekg(0, std::ios::end);
+  fileSize = size_t(file.tellg());
+  fill(std::min(headerChunk, fileSize));
+}
+
+void DICOMStream::fill(size_t end) {
+  end = std::min(std::max(end, 2*buffer.size()), fileSize);
+  if (end <= buffer.size()) return;
+  const size_t start = buffer.size();
+  buffer.resize(end);
+  file.seekg(std::streamoff(start));
+  file.read(buffer.data()+start, std::streamsize(end-start));
+}
+
+void DICOMStream::read(char* target, size_t count) {
+  const size_t available = position < fileSize ? fileSize-position : 0;
+  if (count > available) {
+    count = available;
+    endReached = true;
+  }
+  if (position+count > buffer.size()) fill(position+count);
+  if (count) std::memcpy(target, buffer.data()+position, count);
+  position += count;
+}
+
+void DICOMStream::seekg(std::streampos pos) {
+  endReached = false;
+  position = size_t(std::streamoff(pos));
+}
+
+void DICOMStream::seekg(std::streamoff offset, std::ios_base::seekdir direction) {
+  endReached = false;
+  switch (direction) {
+    case std::ios_base::beg : position = size_t(offset); break;
+    case std::ios_base::end : position = size_t(std::streamoff(fileSize) + offset); break;
+    default : position = size_t(std::streamoff(position) + offset); break;
+  }
+}
+
+std::streampos DICOMStream::tellg() const {
+  return endReached ? std::streampos(-1) : std::streampos(std::streamoff(position));
+}
+
 static std::vector<std::string> tokenize(const std::string& strInput, char delim) {
   std::vector<std::string> elements;
   size_t iStart = 0;
@@ -48,18 +101,16 @@ DICOMFile::DICOMFile(const std::string& filename) {
   
   DICOM_DBG("Processing file " << filename);
   
+  // only the header is parsed, the pixel data is read on demand
+  DICOMStream fileDICOM(filename);
+
   // Check if file has minimal required size
-  try {
-    if (std::filesystem::file_size(filename) < 128+4) {
-      throw DICOMFileException("Not a DICOM file (too short)");
-    }
-  } catch(std::filesystem::filesystem_error&) {
-    throw DICOMFileException("Error reading file stats");
+  if (fileDICOM.size() < 128+4) {
+    throw DICOMFileException("Not a DICOM file (too short)");
   }
   DICOM_DBG("File exists and has sufficent length");
   
   // Skip the first 128 bytes (that's how DICOM works)
-  std::ifstream fileDICOM(filename, std::ios::in | std::ios::binary);
   fileDICOM.seekg(128);
 
   // Read the Meta-Header
@@ -92,12 +143,9 @@ DICOMFile::DICOMFile(const std::string& filename) {
   
   m_iOffset = uint32_t(fileDICOM.tellg());
   validatePixelData(fileDICOM, elemInfo);
-
-  
-  fileDICOM.close();
 }
 
-void DICOMFile::validatePixelData(std::ifstream& fileDICOM, ElementInfo info) {
+void DICOMFile::validatePixelData(DICOMStream& fileDICOM, ElementInfo info) {
   if (info.elementType != DICOM_eType::TYPE_UN) {
     if (!metaHeader.implicitFileType) {
       
@@ -173,7 +221,7 @@ void DICOMFile::validatePixelData(std::ifstream& fileDICOM, ElementInfo info) {
           DICOM_DBG("Manual search for GroupID seemed to work.");
           if (!metaHeader.implicitFileType) {
             uint32_t iVolumeDataSize = m_ivSize.x * m_ivSize.y * m_ivSize.z * m_iAllocated / 8;
-            uint32_t iDataSizeInFile;
+            uint32_t iDataSizeInFile{0};
             fileDICOM.read((char*)&iDataSizeInFile,4);
             if (iVolumeDataSize != iDataSizeInFile) bOK = false;
           }
@@ -211,7 +259,7 @@ void DICOMFile::validatePixelData(std::ifstream& fileDICOM, ElementInfo info) {
 }
 
 
-ElementInfo DICOMFile::readElemInfo(std::ifstream& fileDICOM) const {
+ElementInfo DICOMFile::readElemInfo(DICOMStream& fileDICOM) const {
   
   bool implicitElementType = metaHeader.implicitFileType;
   bool elementNeedsEndianConversion = metaHeader.needsEndianConversion;
@@ -244,14 +292,14 @@ ElementInfo DICOMFile::readElemInfo(std::ifstream& fileDICOM) const {
     }
   } else {
     fileDICOM.read(&typeString[0],2);
-    uint16_t tmp;
+    uint16_t tmp{0};
     fileDICOM.read((char*)&tmp,2);
     if (elementNeedsEndianConversion) tmp = swap_endian<uint16_t>(tmp);
     info.elementLength = tmp;
     info.elementType = DICOM_eType::TYPE_UN;
     uint32_t i=0;
     for (;i<27;i++) {
-      if (typeString == DICOM_TypeStrings[i]) {
+      if (typeString[0] == DICOM_TypeStrings[i][0] && typeString[1] == DICOM_TypeStrings[i][1]) {
         info.elementType = DICOM_eType(i);
         break;
       }
@@ -276,7 +324,7 @@ ElementInfo DICOMFile::readElemInfo(std::ifstream& fileDICOM) const {
   return info;
 }
 
-void DICOMFile::readMetaHeaderElem(std::ifstream& fileDICOM, const ElementInfo& info) {
+void DICOMFile::readMetaHeaderElem(DICOMStream& fileDICOM, const ElementInfo& info) {
   std::string value;
   
   switch (info.elementID) {
@@ -342,7 +390,7 @@ void DICOMFile::readMetaHeaderElem(std::ifstream& fileDICOM, const ElementInfo&
   }
 }
 
-std::string DICOMFile::readSizedElement(std::ifstream& fileDICOM, const uint32_t elemLength) const {
+std::string DICOMFile::readSizedElement(DICOMStream& fileDICOM, const uint32_t elemLength) const {
   char* strBuffer = new char[elemLength+1];
   std::fill_n(strBuffer,elemLength+1,0);
   if (elemLength) {
@@ -353,11 +401,11 @@ std::string DICOMFile::readSizedElement(std::ifstream& fileDICOM, const uint32_t
   return result;
 }
 
-void DICOMFile::skipUnusedElement(std::ifstream& fileDICOM, const uint32_t elemLength) const {
+void DICOMFile::skipUnusedElement(DICOMStream& fileDICOM, const uint32_t elemLength) const {
   readSizedElement(fileDICOM, elemLength);
 }
 
-void DICOMFile::readHeaderElem(std::ifstream& fileDICOM, const ElementInfo& info) {
+void DICOMFile::readHeaderElem(DICOMStream& fileDICOM, const ElementInfo& info) {
   
   std::string value{"skiped unused element"};
   
@@ -709,7 +757,7 @@ void DICOMFile::readHeaderElem(std::ifstream& fileDICOM, const ElementInfo& info
 }
 
 
-void DICOMFile::parseUndefLengthSequence(std::ifstream& fileDICOM, uint16_t iSeqGroupID, uint16_t iSeqElementID,
+void DICOMFile::parseUndefLengthSequence(DICOMStream& fileDICOM, uint16_t iSeqGroupID, uint16_t iSeqElementID,
                                          const bool bImplicit, uint32_t iDepth) {
 
 
@@ -791,7 +839,7 @@ void DICOMFile::parseUndefLengthSequence(std::ifstream& fileDICOM, uint16_t iSeq
 }
 
 
-uint32_t DICOMFile::getUInt(std::ifstream& fileDICOM, const DICOM_eType eElementType,
+uint32_t DICOMFile::getUInt(DICOMStream& fileDICOM, const DICOM_eType eElementType,
                             const uint32_t iElemLength) {
   std::string value;
   uint32_t result;
@@ -829,6 +877,22 @@ std::vector<uint8_t> DICOMFile::getData(uint32_t count) const {
   return data;
 }
 
+void DICOMFile::readData(uint8_t* target) const {
+  std::ifstream fileDICOM(metaHeader.filename, std::ios::in | std::ios::binary);
+  fileDICOM.seekg(m_iOffset);
+  fileDICOM.read((char*)target, m_iRawDataSize);
+
+  if (!metaHeader.needsEndianConversion || metaHeader.isJPEGEncoded) return;
+  if (m_iAllocated == 16) {
+    for (size_t i = 0;i+1<m_iRawDataSize;i+=2) std::swap(target[i], target[i+1]);
+  } else if (m_iAllocated == 32) {
+    for (size_t i = 0;i+3<m_iRawDataSize;i+=4) {
+      std::swap(target[i], target[i+3]);
+      std::swap(target[i+1], target[i+2]);
+    }
+  }
+}
+
 bool DICOMFile::match(const DICOMFile& other) const {
   return
     m_iSeries         == other.m_iSeries &&
@@ -846,6 +910,33 @@ bool DICOMFile::match(const DICOMFile& other) const {
 }
 
 
+template <typename T>
+static void hashCombine(size_t& seed, const T& value) {
+  seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+size_t DICOMFile::stackHash() const {
+  // the fields of match, floats with + 0.0f so -0 and 0 hash alike
+  size_t seed{0};
+  hashCombine(seed, m_iSeries);
+  hashCombine(seed, m_ivSize.x);
+  hashCombine(seed, m_ivSize.y);
+  hashCombine(seed, m_ivSize.z);
+  hashCombine(seed, m_iAllocated);
+  hashCombine(seed, m_iStored);
+  hashCombine(seed, m_iComponentCount);
+  hashCombine(seed, m_bSigned);
+  hashCombine(seed, m_fvfAspect.x + 0.0f);
+  hashCombine(seed, m_fvfAspect.y + 0.0f);
+  hashCombine(seed, m_fvfAspect.z + 0.0f);
+  hashCombine(seed, metaHeader.isBigEndian);
+  hashCombine(seed, metaHeader.isJPEGEncoded);
+  hashCombine(seed, m_strAcquDate);
+  hashCombine(seed, m_strModality);
+  hashCombine(seed, m_strDesc);
+  return seed;
+}
+
 bool DICOMFile::stackLessCompare(const DICOMFile& other) const {
   return m_iSeries < other.m_iSeries;
 }
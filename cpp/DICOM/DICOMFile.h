@@ -4,6 +4,7 @@
 #include <fstream>
 #include <exception>
 #include <vector>
+#include <cstdint>
 
 #include "DICOMTable.h"
 
@@ -47,6 +48,34 @@ class DICOMFileException : public std::exception {
 };
 
 
+// Reads a file in a few large chunks and offers the subset of the
+// std::ifstream interface the parser uses. The header usually arrives with
+// the first read, so parsing costs no system call per element and the pixel
+// data behind the header is never read.
+class DICOMStream {
+public:
+  DICOMStream(const std::string& filename);
+
+  size_t size() const {return fileSize;}
+
+  // like std::ifstream a read past the end sets eof and tellg returns -1
+  // until the next seekg
+  void read(char* target, size_t count);
+  void seekg(std::streampos position);
+  void seekg(std::streamoff offset, std::ios_base::seekdir direction);
+  std::streampos tellg() const;
+  bool eof() const {return endReached;}
+
+private:
+  std::ifstream file;
+  std::vector<char> buffer;
+  size_t fileSize{0};
+  size_t position{0};
+  bool endReached{false};
+
+  void fill(size_t end);
+};
+
 struct ElementInfo {
   uint16_t groupID{0};
   uint16_t elementID{0};
@@ -73,6 +102,9 @@ public:
     return getData(m_iRawDataSize);
   }
   std::vector<uint8_t> getData(uint32_t count) const;
+  // copies getRawDataSize() bytes into target and converts them to the
+  // byte order of the machine in place
+  void readData(uint8_t* target) const;
   uint32_t getRawDataSize() const {
     return m_iRawDataSize;
   }
@@ -106,6 +138,8 @@ public:
   }
 
   bool match(const DICOMFile& other) const;
+  // equal for all files that match
+  size_t stackHash() const;
     
   bool stackLessCompare(const DICOMFile& other) const;
   bool depthLessCompare(const DICOMFile& other) const;
@@ -114,11 +148,11 @@ public:
 private:
   MetaHeader metaHeader;
   
-  uint32_t      m_iSeries;
+  uint32_t      m_iSeries{0};
   DCMVec3ui     m_ivSize;
   DCMVec3       m_fvfAspect;
-  uint32_t      m_iAllocated;
-  uint32_t      m_iStored;
+  uint32_t      m_iAllocated{0};
+  uint32_t      m_iStored{0};
   std::string   m_strAcquDate;
   std::string   m_strAcquTime;
   std::string   m_strModality;
@@ -126,31 +160,31 @@ private:
   DCMVec3       m_fvPatientPosition;
   DCMVec3       m_fvPatientOrientation1;
   DCMVec3       m_fvPatientOrientation2;
-  bool          m_bSigned;
-  float         m_fWindowCenter;
-  float         m_fWindowWidth;
-  float         m_fBias;
-  float         m_fScale;
-  uint32_t      m_iImageIndex;
-  uint32_t      m_iComponentCount;
-  float         m_fSliceSpacing;
-  float         m_fSliceLocation;
+  bool          m_bSigned{false};
+  float         m_fWindowCenter{0.0f};
+  float         m_fWindowWidth{0.0f};
+  float         m_fBias{0.0f};
+  float         m_fScale{1.0f};
+  uint32_t      m_iImageIndex{0};
+  uint32_t      m_iComponentCount{1};
+  float         m_fSliceSpacing{0.0f};
+  float         m_fSliceLocation{0.0f};
   
-  uint32_t      m_iOffset;
-  uint32_t      m_iRawDataSize;
+  uint32_t      m_iOffset{0};
+  uint32_t      m_iRawDataSize{0};
   
 
-  ElementInfo readElemInfo(std::ifstream& fileDICOM) const;  
-  void readMetaHeaderElem(std::ifstream& fileDICOM, const ElementInfo& info);
-  void readHeaderElem(std::ifstream& fileDICOM, const ElementInfo& info);
+  ElementInfo readElemInfo(DICOMStream& fileDICOM) const;  
+  void readMetaHeaderElem(DICOMStream& fileDICOM, const ElementInfo& info);
+  void readHeaderElem(DICOMStream& fileDICOM, const ElementInfo& info);
 
-  std::string readSizedElement(std::ifstream& fileDICOM, const uint32_t elemLength) const;
-  void skipUnusedElement(std::ifstream& fileDICOM, const uint32_t elemLength) const;
+  std::string readSizedElement(DICOMStream& fileDICOM, const uint32_t elemLength) const;
+  void skipUnusedElement(DICOMStream& fileDICOM, const uint32_t elemLength) const;
 
-  void parseUndefLengthSequence(std::ifstream& fileDICOM, uint16_t iSeqGroupID, uint16_t iSeqElementID,
+  void parseUndefLengthSequence(DICOMStream& fileDICOM, uint16_t iSeqGroupID, uint16_t iSeqElementID,
                                 const bool bImplicit, uint32_t iDepth=1);
 
-  uint32_t getUInt(std::ifstream& fileDICOM, const DICOM_eType eElementType, const uint32_t iElemLength);
+  uint32_t getUInt(DICOMStream& fileDICOM, const DICOM_eType eElementType, const uint32_t iElemLength);
 
-  void validatePixelData(std::ifstream& fileDICOM, ElementInfo info);
+  void validatePixelData(DICOMStream& fileDICOM, ElementInfo info);
 };
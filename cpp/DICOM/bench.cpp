@@ -0,0 +1,215 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "DICOMDirParser.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Writes a synthetic study of small explicit VR files, alternately little
+// and big endian series, opens it with the parser, assembles all volumes
+// and checks every voxel.
+//
+//   dicomBench [fileCount] [seriesCount]   default 20000 files in 100 series
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+class ElementWriter {
+public:
+  ElementWriter(bool bigEndian) : bigEndian(bigEndian) {}
+
+  void u16(uint16_t v, bool big) {
+    if (big) {
+      data.push_back(uint8_t(v >> 8));
+      data.push_back(uint8_t(v));
+    } else {
+      data.push_back(uint8_t(v));
+      data.push_back(uint8_t(v >> 8));
+    }
+  }
+
+  void u32(uint32_t v, bool big) {
+    if (big) {
+      u16(uint16_t(v >> 16), true);
+      u16(uint16_t(v), true);
+    } else {
+      u16(uint16_t(v), false);
+      u16(uint16_t(v >> 16), false);
+    }
+  }
+
+  // the meta header is always little endian
+  void element(uint16_t group, uint16_t element, const char vr[2], const std::string& value) {
+    const bool big = bigEndian && group != 2;
+    std::string padded = value;
+    if (padded.size() % 2) padded += (vr[0] == 'U' && vr[1] == 'I') ? '\0' : ' ';
+    u16(group, big);
+    u16(element, big);
+    data.push_back(uint8_t(vr[0]));
+    data.push_back(uint8_t(vr[1]));
+    u16(uint16_t(padded.size()), big);
+    data.insert(data.end(), padded.begin(), padded.end());
+  }
+
+  void us(uint16_t group, uint16_t element, uint16_t value) {
+    u16(group, bigEndian);
+    u16(element, bigEndian);
+    data.push_back('U');
+    data.push_back('S');
+    u16(2, bigEndian);
+    u16(value, bigEndian);
+  }
+
+  void pixels(const std::vector<uint16_t>& values) {
+    u16(0x7fe0, bigEndian);
+    u16(0x0010, bigEndian);
+    data.push_back('O');
+    data.push_back('W');
+    u16(0, bigEndian);
+    u32(uint32_t(values.size()*2), bigEndian);
+    for (const uint16_t v : values) u16(v, bigEndian);
+  }
+
+  std::vector<uint8_t> data;
+
+private:
+  bool bigEndian;
+};
+
+static uint16_t pixelValue(size_t slice, size_t x, size_t y) {
+  return uint16_t(slice*31 + x*7 + y*3);
+}
+
+static void writeFile(const std::filesystem::path& path, uint32_t series, size_t slice,
+                      uint16_t size, bool bigEndian) {
+  const std::string syntax = bigEndian ? "1.2.840.10008.1.2.2" : "1.2.840.10008.1.2.1";
+
+  ElementWriter meta{false};
+  meta.element(0x2, 0x10, "UI", syntax);
+  ElementWriter w{bigEndian};
+  w.data.resize(128, 0);
+  w.data.insert(w.data.end(), {'D','I','C','M'});
+  w.u16(0x2, false);
+  w.u16(0x0, false);
+  w.data.insert(w.data.end(), {'U','L'});
+  w.u16(4, false);
+  w.u32(uint32_t(meta.data.size()), false);
+  w.data.insert(w.data.end(), meta.data.begin(), meta.data.end());
+
+  std::stringstream position;
+  position << "0\\0\\" << float(slice)*0.5f;
+  w.element(0x8, 0x60, "CS", "CT");
+  w.element(0x20, 0x11, "IS", std::to_string(series));
+  w.element(0x20, 0x13, "IS", std::to_string(slice));
+  w.element(0x20, 0x32, "DS", position.str());
+  w.us(0x28, 0x2, 1);
+  w.us(0x28, 0x10, size);
+  w.us(0x28, 0x11, size);
+  w.element(0x28, 0x30, "DS", "0.5\\0.5");
+  w.us(0x28, 0x100, 16);
+  w.us(0x28, 0x101, 16);
+  w.us(0x28, 0x103, 0);
+
+  std::vector<uint16_t> values(size_t(size)*size);
+  for (size_t y = 0;y<size;++y) {
+    for (size_t x = 0;x<size;++x) values[x+y*size] = pixelValue(slice, x, y);
+  }
+  w.pixels(values);
+
+  std::ofstream file(path, std::ios::binary);
+  file.write(reinterpret_cast<const char*>(w.data.data()), std::streamsize(w.data.size()));
+}
+
+static bool checkVolume(const DICOMDirParser& parser, size_t i, size_t expectedSlices, double& time) {
+  const DCMVec3ui size = parser.getVolmeSize(i);
+  if (size.z != expectedSlices) {
+    std::cout << "  volume " << i << " has " << size.z << " slices, expected " << expectedSlices << std::endl;
+    return false;
+  }
+
+  const auto t1 = Clock::now();
+  const std::vector<uint8_t> data = parser.getRawData(i);
+  const auto t2 = Clock::now();
+  time += seconds(t1,t2);
+
+  const uint16_t* values = reinterpret_cast<const uint16_t*>(data.data());
+  for (size_t z = 0;z<size.z;++z) {
+    for (size_t y = 0;y<size.y;++y) {
+      for (size_t x = 0;x<size.x;++x) {
+        if (values[x + size.x*(y + size.y*z)] != pixelValue(z, x, y)) {
+          std::cout << "  wrong voxel " << x << " " << y << " " << z << std::endl;
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const size_t seriesCount = argc > 2 ? size_t(atoll(argv[2])) : 100;
+  const size_t perSeries = (argc > 1 ? size_t(atoll(argv[1])) : 20000) / seriesCount;
+  const size_t fileCount = perSeries*seriesCount;
+  const std::filesystem::path directory = std::filesystem::temp_directory_path() / "dicomBench";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+
+  auto t1 = Clock::now();
+  for (size_t i = 0;i<fileCount;++i) {
+    // scatter the slices over the directory so the listing is not sorted
+    const size_t slice = (i*7919) % perSeries;
+    const size_t series = i / perSeries;
+    const bool bigEndian = series % 2;
+    std::stringstream name;
+    name << "IM" << std::setw(7) << std::setfill('0') << (i*104729) % 1000003;
+    writeFile(directory / name.str(), uint32_t(series+1), slice, bigEndian ? 32 : 64, bigEndian);
+  }
+  auto t2 = Clock::now();
+  std::cout << fileCount << " files written in " << std::fixed << std::setprecision(3)
+            << seconds(t1,t2) << " s" << std::endl;
+
+  bool ok = true;
+  int maxThreads = 1;
+#ifdef _OPENMP
+  maxThreads = omp_get_max_threads();
+#endif
+  for (const int threads : {1, maxThreads}) {
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    t1 = Clock::now();
+    const DICOMDirParser parser{directory.string()};
+    t2 = Clock::now();
+    std::cout << threads << " thread(s): scanned and grouped in " << std::setprecision(3) << seconds(t1,t2)
+              << " s (" << std::setprecision(0) << double(fileCount) / seconds(t1,t2) << " files/s), "
+              << parser.getVolumeCount() << " volume(s)" << std::endl;
+
+    ok = parser.getVolumeCount() == seriesCount;
+    double time = 0.0;
+    size_t bytes = 0;
+    for (size_t i = 0;ok && i<parser.getVolumeCount();++i) {
+      ok = checkVolume(parser, i, perSeries, time);
+      bytes += size_t(parser.getVolmeSize(i).x)*parser.getVolmeSize(i).y*parser.getVolmeSize(i).z*2;
+    }
+    if (ok) {
+      std::cout << "  volumes assembled in " << std::setprecision(3) << time << " s ("
+                << std::setprecision(0) << double(bytes) / time / (1<<20) << " MB/s)" << std::endl;
+    }
+    if (!ok || threads == maxThreads) break;
+  }
+
+  std::filesystem::remove_all(directory);
+  std::cout << (ok ? "all voxels match" : "FAILED") << std::endl;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
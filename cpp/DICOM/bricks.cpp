@@ -0,0 +1,180 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <algorithm>
+
+#include "DICOMDirParser.h"
+#include "BrickedVolume.h"
+
+// Converts a DICOM directory or a QVis .dat/.raw pair into bricked volumes
+// (see BrickedVolume.h) slice by slice, so the source never has to fit into
+// memory, and prints statistics gathered brick by brick from the result.
+//
+//   volume2bricks <DICOM directory | file.dat> [--8bit]
+//
+// With --8bit 16 bit data is scaled to 8 bits with a first pass over all
+// slices to find the value range, like the QVis reader does it.
+
+typedef std::function<std::vector<uint8_t>(size_t)> SliceSource;
+
+struct SourceVolume {
+  uint32_t width{0};
+  uint32_t height{0};
+  uint32_t depth{0};
+  uint32_t bytesPerVoxel{1};
+  Vec3 scale{1.0f, 1.0f, 1.0f};
+  SliceSource slice;
+};
+
+static void convert(const SourceVolume& source, const std::string& filename, bool to8Bit) {
+  uint16_t minValue{0};
+  uint16_t maxValue{65535};
+  const bool scaleDown = to8Bit && source.bytesPerVoxel == 2;
+  if (scaleDown) {
+    minValue = 65535;
+    maxValue = 0;
+    for (uint32_t z = 0;z<source.depth;++z) {
+      const std::vector<uint8_t> s = source.slice(z);
+      for (size_t i = 0;i+1<s.size();i+=2) {
+        const uint16_t v = uint16_t(s[i] | (s[i+1] << 8));
+        minValue = std::min(minValue, v);
+        maxValue = std::max(maxValue, v);
+      }
+    }
+  }
+
+  BrickedVolumeWriter writer{filename, source.width, source.height, source.depth,
+                             scaleDown ? 1u : source.bytesPerVoxel, source.scale};
+  const size_t sliceSize = size_t(source.width)*source.height*source.bytesPerVoxel;
+  std::vector<uint8_t> scaled(size_t(source.width)*source.height);
+  for (uint32_t z = 0;z<source.depth;++z) {
+    const std::vector<uint8_t> s = source.slice(z);
+    if (s.size() < sliceSize) throw BrickedVolumeException{"slice smaller than expected"};
+    if (scaleDown) {
+      for (size_t i = 0;i<scaled.size();++i) {
+        const uint32_t v = uint32_t(s[2*i] | (s[2*i+1] << 8));
+        scaled[i] = uint8_t(((v-minValue)*255) / (1u+maxValue-minValue));
+      }
+      writer.addSlice(scaled.data());
+    } else {
+      writer.addSlice(s.data());
+    }
+  }
+  writer.finish();
+}
+
+static void printInfo(const std::string& filename) {
+  const BrickedVolume volume{filename, size_t(256) << 20};
+  std::cout << "  " << filename << ": " << volume.getLevelCount() << " level(s)";
+  for (size_t l = 0;l<volume.getLevelCount();++l) {
+    const BrickLevel& level = volume.getLevel(l);
+    std::cout << (l ? ", " : " ") << level.width << "x" << level.height << "x" << level.depth;
+  }
+  std::cout << std::endl;
+
+  const VolumeStatistics stats = computeStatistics(volume);
+  std::cout << "  range [" << stats.minValue << ", " << stats.maxValue << "], mean "
+            << std::fixed << std::setprecision(2) << stats.mean << ", standard deviation "
+            << stats.standardDeviation << ", peak brick memory "
+            << (volume.getPeakResidentBytes() >> 20) << " MB" << std::endl;
+}
+
+static std::string trim(const std::string& s) {
+  const size_t first = s.find_first_not_of(" \t\r");
+  if (first == std::string::npos) return "";
+  return s.substr(first, s.find_last_not_of(" \t\r")-first+1);
+}
+
+// the tags of the .dat file the QVis reader understands
+static SourceVolume openQVis(const std::string& filename) {
+  std::ifstream datfile(filename);
+  if (!datfile) throw BrickedVolumeException{std::string("Unable to read file ")+filename};
+
+  SourceVolume source;
+  std::string rawFilename;
+  std::string line;
+  while (std::getline(datfile, line)) {
+    const size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    std::string id = trim(line.substr(0, colon));
+    std::string value = trim(line.substr(colon+1));
+    std::transform(id.begin(), id.end(), id.begin(), ::tolower);
+
+    std::stringstream ss{value};
+    if (id == "objectfilename") {
+      const size_t slash = filename.find_last_of("/\\");
+      rawFilename = (slash == std::string::npos) ? value : filename.substr(0, slash+1) + value;
+    } else if (id == "resolution") {
+      ss >> source.width >> source.height >> source.depth;
+    } else if (id == "slicethickness") {
+      ss >> source.scale.x >> source.scale.y >> source.scale.z;
+    } else if (id == "format") {
+      std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+      source.bytesPerVoxel = (value == "char" || value == "uchar" || value == "byte") ? 1 : 2;
+    }
+  }
+  if (rawFilename.empty() || source.width == 0 || source.height == 0 || source.depth == 0)
+    throw BrickedVolumeException{std::string("Incomplete dat file ")+filename};
+
+  auto raw = std::make_shared<std::ifstream>(rawFilename, std::ios::binary);
+  if (!*raw) throw BrickedVolumeException{std::string("Unable to read file ")+rawFilename};
+  const size_t sliceSize = size_t(source.width)*source.height*source.bytesPerVoxel;
+  source.slice = [raw, sliceSize](size_t z) {
+    std::vector<uint8_t> s(sliceSize);
+    raw->clear();
+    raw->seekg(std::streamoff(z*sliceSize));
+    raw->read(reinterpret_cast<char*>(s.data()), std::streamsize(sliceSize));
+    if (!*raw) throw BrickedVolumeException{"raw file shorter than the resolution"};
+    return s;
+  };
+  return source;
+}
+
+int main(int argc, char ** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " <DICOM directory | file.dat> [--8bit]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::string input{argv[1]};
+  const bool to8Bit = argc > 2 && std::string(argv[2]) == "--8bit";
+
+  try {
+    if (input.size() > 4 && input.substr(input.size()-4) == ".dat") {
+      const std::string filename = input.substr(0, input.size()-4) + ".bvol";
+      convert(openQVis(input), filename, to8Bit);
+      printInfo(filename);
+      return EXIT_SUCCESS;
+    }
+
+    const DICOMDirParser parser{input};
+    std::cout << "Found " << parser.getVolumeCount() << " volume(s)." << std::endl;
+    for (size_t i = 0;i<parser.getVolumeCount();++i) {
+      if (parser.getComponentCount(i) != 1 ||
+          (parser.getAllocated(i) != 8 && parser.getAllocated(i) != 16)) {
+        std::cout << "  " << i+1 << ": only single component 8 or 16 bit data, skipped" << std::endl;
+        continue;
+      }
+
+      SourceVolume source;
+      source.width = parser.getVolmeSize(i).x;
+      source.height = parser.getVolmeSize(i).y;
+      source.depth = parser.getVolmeSize(i).z;
+      source.bytesPerVoxel = parser.getAllocated(i)/8;
+      source.scale = Vec3{parser.getVolmeAspect(i).x, parser.getVolmeAspect(i).y, parser.getVolmeAspect(i).z};
+      source.slice = [&parser, i](size_t z) {return parser.getSlice(i, z);};
+
+      std::stringstream ss;
+      ss << "volume" << (i+1) << ".bvol";
+      convert(source, ss.str(), to8Bit);
+      printInfo(ss.str());
+    }
+  } catch (const BrickedVolumeException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
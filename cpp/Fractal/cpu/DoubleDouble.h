@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+// Unevaluated sum of two doubles, about 106 bits of mantissa. Enough to
+// compute perturbation reference orbits for zooms down to ~1e-28, far past
+// the ~1e-13 where plain doubles run out.
+struct DoubleDouble {
+  double hi;
+  double lo;
+
+  DoubleDouble(double hi=0.0, double lo=0.0) :
+    hi(hi),
+    lo(lo)
+  {}
+
+  static DoubleDouble twoSum(double a, double b) {
+    const double s = a + b;
+    const double v = s - a;
+    return {s, (a - (s - v)) + (b - v)};
+  }
+
+  static DoubleDouble quickTwoSum(double a, double b) {
+    const double s = a + b;
+    return {s, b - (s - a)};
+  }
+
+  DoubleDouble operator+(const DoubleDouble& o) const {
+    DoubleDouble s = twoSum(hi, o.hi);
+    const DoubleDouble t = twoSum(lo, o.lo);
+    s.lo += t.hi;
+    s = quickTwoSum(s.hi, s.lo);
+    s.lo += t.lo;
+    return quickTwoSum(s.hi, s.lo);
+  }
+
+  DoubleDouble operator-() const {return {-hi, -lo};}
+  DoubleDouble operator-(const DoubleDouble& o) const {return *this + (-o);}
+
+  DoubleDouble operator*(const DoubleDouble& o) const {
+    const double p = hi * o.hi;
+    const double e = std::fma(hi, o.hi, -p);
+    return quickTwoSum(p, e + (hi * o.lo + lo * o.hi));
+  }
+
+  DoubleDouble operator/(double d) const {
+    const double q1 = hi / d;
+    const DoubleDouble r = *this - DoubleDouble(q1) * DoubleDouble(d);
+    const double q2 = r.hi / d;
+    return quickTwoSum(q1, q2);
+  }
+
+  double toDouble() const {return hi + lo;}
+
+  // parses decimal numbers like "-0.743643887037158704752191506114774"
+  // or "1.5e-3", returns false on malformed input
+  static bool parse(const std::string& str, DoubleDouble& result) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < str.size() && (str[i] == '-' || str[i] == '+')) negative = str[i++] == '-';
+
+    DoubleDouble value;
+    int32_t exponent = 0;
+    bool digits = false;
+    bool fraction = false;
+    for (;i<str.size();++i) {
+      const char c = str[i];
+      if (c >= '0' && c <= '9') {
+        value = value * DoubleDouble(10.0) + DoubleDouble(double(c - '0'));
+        if (fraction) exponent--;
+        digits = true;
+      } else if (c == '.' && !fraction) {
+        fraction = true;
+      } else if (c == 'e' || c == 'E') {
+        try {
+          exponent += std::stoi(str.substr(i+1));
+        } catch (...) {
+          return false;
+        }
+        break;
+      } else {
+        return false;
+      }
+    }
+    if (!digits) return false;
+
+    for (;exponent < 0;++exponent) value = value / 10.0;
+    for (;exponent > 0;--exponent) value = value * DoubleDouble(10.0);
+    result = negative ? -value : value;
+    return true;
+  }
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// A handful of double precision lanes, eight with AVX-512, four with AVX2
+// and a plain array of four otherwise (which the compiler can still map to
+// SSE2). Only the operations needed by the Mandelbrot kernels are provided.
+
+#if defined(__AVX512F__)
+
+struct LaneMask {
+  __mmask8 m;
+
+  LaneMask operator&(const LaneMask& other) const {return {__mmask8(m & other.m)};}
+  LaneMask operator|(const LaneMask& other) const {return {__mmask8(m | other.m)};}
+  LaneMask andNot(const LaneMask& other) const {return {__mmask8(m & ~other.m)};}
+  bool any() const {return m != 0;}
+  bool lane(uint32_t i) const {return (m >> i) & 1;}
+};
+
+struct DoubleLanes {
+  static constexpr uint32_t width = 8;
+  __m512d v;
+
+  DoubleLanes() : v(_mm512_setzero_pd()) {}
+  DoubleLanes(double d) : v(_mm512_set1_pd(d)) {}
+  DoubleLanes(__m512d v) : v(v) {}
+
+  static DoubleLanes load(const double* p) {return _mm512_loadu_pd(p);}
+  static DoubleLanes ramp() {return _mm512_set_pd(7,6,5,4,3,2,1,0);}
+  static DoubleLanes gather(const double* base, const DoubleLanes& index) {
+    return _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, _mm512_maskz_cvttpd_epi32(0xFF, index.v), base, 8);
+  }
+  void store(double* p) const {_mm512_storeu_pd(p, v);}
+
+  DoubleLanes operator+(const DoubleLanes& o) const {return _mm512_add_pd(v, o.v);}
+  DoubleLanes operator-(const DoubleLanes& o) const {return _mm512_sub_pd(v, o.v);}
+  DoubleLanes operator*(const DoubleLanes& o) const {return _mm512_mul_pd(v, o.v);}
+
+  LaneMask operator<(const DoubleLanes& o) const {return {_mm512_cmp_pd_mask(v, o.v, _CMP_LT_OQ)};}
+  LaneMask operator>=(const DoubleLanes& o) const {return {_mm512_cmp_pd_mask(v, o.v, _CMP_GE_OQ)};}
+
+  // lanes in mask get a, the others keep their value
+  DoubleLanes select(const LaneMask& mask, const DoubleLanes& a) const {
+    return _mm512_mask_blend_pd(mask.m, v, a.v);
+  }
+  // adds 1 to the lanes in mask
+  DoubleLanes increment(const LaneMask& mask) const {
+    return _mm512_mask_add_pd(v, mask.m, v, _mm512_set1_pd(1.0));
+  }
+};
+
+#elif defined(__AVX2__)
+
+struct LaneMask {
+  __m256d m;
+
+  LaneMask operator&(const LaneMask& other) const {return {_mm256_and_pd(m, other.m)};}
+  LaneMask operator|(const LaneMask& other) const {return {_mm256_or_pd(m, other.m)};}
+  LaneMask andNot(const LaneMask& other) const {return {_mm256_andnot_pd(other.m, m)};}
+  bool any() const {return _mm256_movemask_pd(m) != 0;}
+  bool lane(uint32_t i) const {return (_mm256_movemask_pd(m) >> i) & 1;}
+};
+
+struct DoubleLanes {
+  static constexpr uint32_t width = 4;
+  __m256d v;
+
+  DoubleLanes() : v(_mm256_setzero_pd()) {}
+  DoubleLanes(double d) : v(_mm256_set1_pd(d)) {}
+  DoubleLanes(__m256d v) : v(v) {}
+
+  static DoubleLanes load(const double* p) {return _mm256_loadu_pd(p);}
+  static DoubleLanes ramp() {return _mm256_set_pd(3,2,1,0);}
+  static DoubleLanes gather(const double* base, const DoubleLanes& index) {
+    return _mm256_i32gather_pd(base, _mm256_cvttpd_epi32(index.v), 8);
+  }
+  void store(double* p) const {_mm256_storeu_pd(p, v);}
+
+  DoubleLanes operator+(const DoubleLanes& o) const {return _mm256_add_pd(v, o.v);}
+  DoubleLanes operator-(const DoubleLanes& o) const {return _mm256_sub_pd(v, o.v);}
+  DoubleLanes operator*(const DoubleLanes& o) const {return _mm256_mul_pd(v, o.v);}
+
+  LaneMask operator<(const DoubleLanes& o) const {return {_mm256_cmp_pd(v, o.v, _CMP_LT_OQ)};}
+  LaneMask operator>=(const DoubleLanes& o) const {return {_mm256_cmp_pd(v, o.v, _CMP_GE_OQ)};}
+
+  DoubleLanes select(const LaneMask& mask, const DoubleLanes& a) const {
+    return _mm256_blendv_pd(v, a.v, mask.m);
+  }
+  DoubleLanes increment(const LaneMask& mask) const {
+    return _mm256_add_pd(v, _mm256_and_pd(mask.m, _mm256_set1_pd(1.0)));
+  }
+};
+
+#else
+
+struct LaneMask {
+  bool m[4];
+
+  LaneMask operator&(const LaneMask& o) const {return {{m[0]&&o.m[0], m[1]&&o.m[1], m[2]&&o.m[2], m[3]&&o.m[3]}};}
+  LaneMask operator|(const LaneMask& o) const {return {{m[0]||o.m[0], m[1]||o.m[1], m[2]||o.m[2], m[3]||o.m[3]}};}
+  LaneMask andNot(const LaneMask& o) const {return {{m[0]&&!o.m[0], m[1]&&!o.m[1], m[2]&&!o.m[2], m[3]&&!o.m[3]}};}
+  bool any() const {return m[0] || m[1] || m[2] || m[3];}
+  bool lane(uint32_t i) const {return m[i];}
+};
+
+struct DoubleLanes {
+  static constexpr uint32_t width = 4;
+  double v[4];
+
+  DoubleLanes() : v{0,0,0,0} {}
+  DoubleLanes(double d) : v{d,d,d,d} {}
+
+  static DoubleLanes load(const double* p) {DoubleLanes r; for (uint32_t i = 0;i<width;++i) r.v[i] = p[i]; return r;}
+  static DoubleLanes ramp() {DoubleLanes r; for (uint32_t i = 0;i<width;++i) r.v[i] = i; return r;}
+  static DoubleLanes gather(const double* base, const DoubleLanes& index) {
+    DoubleLanes r;
+    for (uint32_t i = 0;i<width;++i) r.v[i] = base[int32_t(index.v[i])];
+    return r;
+  }
+  void store(double* p) const {for (uint32_t i = 0;i<width;++i) p[i] = v[i];}
+
+  DoubleLanes operator+(const DoubleLanes& o) const {DoubleLanes r; for (uint32_t i = 0;i<width;++i) r.v[i] = v[i]+o.v[i]; return r;}
+  DoubleLanes operator-(const DoubleLanes& o) const {DoubleLanes r; for (uint32_t i = 0;i<width;++i) r.v[i] = v[i]-o.v[i]; return r;}
+  DoubleLanes operator*(const DoubleLanes& o) const {DoubleLanes r; for (uint32_t i = 0;i<width;++i) r.v[i] = v[i]*o.v[i]; return r;}
+
+  LaneMask operator<(const DoubleLanes& o) const {return {{v[0]<o.v[0], v[1]<o.v[1], v[2]<o.v[2], v[3]<o.v[3]}};}
+  LaneMask operator>=(const DoubleLanes& o) const {return {{v[0]>=o.v[0], v[1]>=o.v[1], v[2]>=o.v[2], v[3]>=o.v[3]}};}
+
+  DoubleLanes select(const LaneMask& mask, const DoubleLanes& a) const {
+    DoubleLanes r;
+    for (uint32_t i = 0;i<width;++i) r.v[i] = mask.m[i] ? a.v[i] : v[i];
+    return r;
+  }
+  DoubleLanes increment(const LaneMask& mask) const {
+    DoubleLanes r;
+    for (uint32_t i = 0;i<width;++i) r.v[i] = mask.m[i] ? v[i]+1.0 : v[i];
+    return r;
+  }
+};
+
+#endif
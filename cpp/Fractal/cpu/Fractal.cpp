@@ -2,6 +2,11 @@
 #include "Complex.h"
 
 void Fractal::compute() {
+  engine.compute();
+  getDataVector() = engine.getData();
+}
+
+void Fractal::computeScalar() {
   float dx = 2.8f / w;
   float dy = 2.6f / h;
 
@@ -1,13 +1,24 @@
 #pragma once
 
 #include "Image.h"
+#include "MandelbrotEngine.h"
 
 class Fractal : public Image {
 public:
   Fractal(unsigned int w, unsigned int h) :
-   Image(w,h)
+   Image(w,h),
+   engine(w,h,w,h,0,0)
   {
   }
   
+  // SIMD and multithreaded, see MandelbrotEngine
   void compute();
+  // the original single threaded float loop, kept as reference
+  void computeScalar();
+
+  MandelbrotEngine& getEngine() {return engine;}
+  const std::vector<uint8_t>& getData() {return getDataVector();}
+
+private:
+  MandelbrotEngine engine;
 };
@@ -0,0 +1,413 @@
+#include <algorithm>
+#include <cmath>
+
+#include "MandelbrotEngine.h"
+#include "DoubleLanes.h"
+
+// two vectors are iterated side by side, their dependency chains are
+// independent so the core can overlap them
+static const uint32_t interleave{2};
+static const uint32_t chunkWidth{interleave * DoubleLanes::width};
+
+MandelbrotEngine::MandelbrotEngine(uint32_t w, uint32_t h,
+                                   int64_t fullW, int64_t fullH,
+                                   int64_t offsetX, int64_t offsetY,
+                                   uint32_t threadCount) :
+  w(w),
+  h(h),
+  fullW(fullW),
+  fullH(fullH),
+  offsetX(offsetX),
+  offsetY(offsetY),
+  target(size_t(w)*h),
+  iterations(size_t(w)*h)
+{
+  setDefaultView();
+
+  if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+  workerCount = threadCount;
+  workers = std::make_unique<Worker[]>(workerCount);
+  // the calling thread acts as worker 0
+  for (uint32_t i = 1;i<workerCount;++i) {
+    threads.emplace_back(&MandelbrotEngine::workerFunc, this, i);
+  }
+}
+
+MandelbrotEngine::~MandelbrotEngine() {
+  {
+    const std::scoped_lock<std::mutex> lock(poolMutex);
+    shutdown = true;
+  }
+  poolWakeup.notify_all();
+  for (std::thread& t : threads) t.join();
+}
+
+void MandelbrotEngine::setResolution(int64_t fullW, int64_t fullH) {
+  this->fullW = fullW;
+  this->fullH = fullH;
+  updatePixelSize();
+  referenceValid = false;
+}
+
+void MandelbrotEngine::setOffset(int64_t offsetX, int64_t offsetY) {
+  this->offsetX = offsetX;
+  this->offsetY = offsetY;
+}
+
+void MandelbrotEngine::setMaxIterations(uint32_t maxIterations) {
+  this->maxIterations = std::max(1u, maxIterations);
+  referenceValid = false;
+}
+
+void MandelbrotEngine::setMode(Mode mode) {
+  this->mode = mode;
+}
+
+bool MandelbrotEngine::setView(const std::string& centerRe, const std::string& centerIm, double pixelSize) {
+  DoubleDouble re, im;
+  if (!DoubleDouble::parse(centerRe, re) || !DoubleDouble::parse(centerIm, im) || !(pixelSize > 0)) {
+    return false;
+  }
+  defaultView = false;
+  this->centerRe = re;
+  this->centerIm = im;
+  dx = pixelSize;
+  dy = pixelSize;
+  referenceValid = false;
+  return true;
+}
+
+void MandelbrotEngine::setDefaultView() {
+  defaultView = true;
+  centerRe = DoubleDouble(-0.7);
+  centerIm = DoubleDouble(0.0);
+  updatePixelSize();
+  referenceValid = false;
+}
+
+void MandelbrotEngine::updatePixelSize() {
+  if (!defaultView) return;
+  dx = 2.8 / double(fullW);
+  dy = 2.6 / double(fullH);
+}
+
+bool MandelbrotEngine::needsPerturbation() const {
+  switch (mode) {
+    case Mode::Direct : return false;
+    case Mode::Perturbation : return true;
+    case Mode::Auto :
+    default: {
+      // leave a safety margin of a few thousand ulps per pixel
+      const double magnitude = std::max({1.0, std::fabs(centerRe.hi), std::fabs(centerIm.hi)});
+      return std::min(dx, dy) < 1e-12 * magnitude;
+    }
+  }
+}
+
+void MandelbrotEngine::compute() {
+  perturbationActive = needsPerturbation();
+  if (perturbationActive && !referenceValid) computeReference();
+
+  // contiguous blocks of tiles per worker, neighbouring tiles tend to have
+  // similar cost so most of the stealing happens at the end
+  const uint32_t tileCount = tileCountX() * tileCountY();
+  for (uint32_t i = 0;i<workerCount;++i) {
+    const uint64_t begin = uint64_t(tileCount) * i / workerCount;
+    const uint64_t end = uint64_t(tileCount) * (i+1) / workerCount;
+    workers[i].range.store(begin | (end << 32));
+  }
+
+  {
+    const std::scoped_lock<std::mutex> lock(poolMutex);
+    busyWorkers = workerCount - 1;
+    generation++;
+  }
+  poolWakeup.notify_all();
+
+  runTiles(0);
+
+  std::unique_lock<std::mutex> lock(poolMutex);
+  poolDone.wait(lock, [this]{return busyWorkers == 0;});
+
+  for (size_t i = 0;i<iterations.size();++i) {
+    target[i] = uint8_t(iterations[i]);
+  }
+}
+
+void MandelbrotEngine::workerFunc(uint32_t index) {
+  uint64_t seenGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(poolMutex);
+      poolWakeup.wait(lock, [&]{return shutdown || generation != seenGeneration;});
+      if (shutdown) return;
+      seenGeneration = generation;
+    }
+
+    runTiles(index);
+
+    {
+      const std::scoped_lock<std::mutex> lock(poolMutex);
+      busyWorkers--;
+    }
+    poolDone.notify_one();
+  }
+}
+
+void MandelbrotEngine::runTiles(uint32_t index) {
+  uint32_t tile;
+  while (popTile(index, tile)) computeTile(tile);
+
+  // own range is empty, help the others from the back of their ranges
+  bool stolen = true;
+  while (stolen) {
+    stolen = false;
+    for (uint32_t i = 1;i<workerCount;++i) {
+      if (stealTile((index + i) % workerCount, tile)) {
+        computeTile(tile);
+        stolen = true;
+        break;
+      }
+    }
+  }
+}
+
+bool MandelbrotEngine::popTile(uint32_t index, uint32_t& tile) {
+  std::atomic<uint64_t>& range = workers[index].range;
+  uint64_t r = range.load();
+  while (true) {
+    const uint32_t begin = uint32_t(r);
+    const uint32_t end = uint32_t(r >> 32);
+    if (begin >= end) return false;
+    if (range.compare_exchange_weak(r, uint64_t(begin+1) | (uint64_t(end) << 32))) {
+      tile = begin;
+      return true;
+    }
+  }
+}
+
+bool MandelbrotEngine::stealTile(uint32_t victim, uint32_t& tile) {
+  std::atomic<uint64_t>& range = workers[victim].range;
+  uint64_t r = range.load();
+  while (true) {
+    const uint32_t begin = uint32_t(r);
+    const uint32_t end = uint32_t(r >> 32);
+    if (begin >= end) return false;
+    if (range.compare_exchange_weak(r, uint64_t(begin) | (uint64_t(end-1) << 32))) {
+      tile = end-1;
+      return true;
+    }
+  }
+}
+
+void MandelbrotEngine::computeTile(uint32_t tile) {
+  const uint32_t x0 = (tile % tileCountX()) * tileWidth;
+  const uint32_t y0 = (tile / tileCountX()) * tileHeight;
+  const uint32_t x1 = std::min(w, x0 + tileWidth);
+  const uint32_t y1 = std::min(h, y0 + tileHeight);
+
+  for (uint32_t y = y0;y<y1;++y) {
+    if (perturbationActive) {
+      computePerturbationRow(y, x0, x1);
+    } else {
+      computeDirectRow(y, x0, x1);
+    }
+  }
+}
+
+void MandelbrotEngine::computeDirectRow(uint32_t y, uint32_t x0, uint32_t x1) {
+  const DoubleLanes four(4.0);
+  const DoubleLanes two(2.0);
+  const DoubleLanes maxIter{double(maxIterations)};
+
+  // same expressions as the OpenCL kernel for the default view
+  const double cI = defaultView ? -1.3 + dy*double(int64_t(y)+offsetY)
+                                : centerIm.toDouble() + (double(int64_t(y)+offsetY) - double(fullH)/2.0)*dy;
+
+  for (uint32_t x = x0;x<x1;x+=chunkWidth) {
+    DoubleLanes cr[interleave], ci[interleave], zr[interleave], zi[interleave], count[interleave];
+    LaneMask active[interleave];
+    for (uint32_t k = 0;k<interleave;++k) {
+      const DoubleLanes px = DoubleLanes::ramp() + DoubleLanes(double(int64_t(x + k*DoubleLanes::width)+offsetX));
+      cr[k] = defaultView ? DoubleLanes(-2.1) + DoubleLanes(dx)*px
+                          : DoubleLanes(centerRe.toDouble()) + (px - DoubleLanes(double(fullW)/2.0))*DoubleLanes(dx);
+      ci[k] = DoubleLanes(cI);
+
+      // main cardioid and period-2 bulb never escape
+      const DoubleLanes xx = cr[k] - DoubleLanes(0.25);
+      const DoubleLanes yy = ci[k]*ci[k];
+      DoubleLanes q = xx*xx + yy;
+      q = q*(q + xx);
+      const DoubleLanes bx = cr[k] + DoubleLanes(1.0);
+      const LaneMask inside = (q*four < yy) | ((bx*bx + yy) < DoubleLanes(1.0/16.0));
+
+      active[k] = (DoubleLanes(0.0) < maxIter).andNot(inside);
+      count[k] = DoubleLanes(0.0).select(inside, maxIter);
+    }
+
+    // the escape test runs every iteration but only updates the lane mask,
+    // the branch on "all lanes done" is taken every few iterations
+    bool running = true;
+    while (running) {
+      for (uint32_t i = 0;i<escapeCheckInterval;++i) {
+        for (uint32_t k = 0;k<interleave;++k) {
+          const DoubleLanes zr2 = zr[k]*zr[k];
+          const DoubleLanes zi2 = zi[k]*zi[k];
+          active[k] = active[k] & ((zr2 + zi2) < four) & (count[k] < maxIter);
+          count[k] = count[k].increment(active[k]);
+          zi[k] = two*zr[k]*zi[k] + ci[k];
+          zr[k] = zr2 - zi2 + cr[k];
+        }
+      }
+      running = false;
+      for (uint32_t k = 0;k<interleave;++k) running = running || active[k].any();
+    }
+
+    double result[chunkWidth];
+    for (uint32_t k = 0;k<interleave;++k) count[k].store(result + k*DoubleLanes::width);
+    for (uint32_t i = 0;i<chunkWidth && x+i < x1;++i) {
+      iterations[size_t(y)*w + x + i] = uint32_t(result[i]);
+    }
+  }
+}
+
+// Perturbation with rebasing: every pixel iterates its offset dz to the
+// reference orbit Z, dz' = (2Z + dz)dz + dc. Whenever the full value Z+dz
+// gets smaller than dz, or the reference orbit ends, the pixel continues
+// with dz = Z+dz against the start of the orbit, which avoids the classic
+// glitches without extra reference points.
+void MandelbrotEngine::computePerturbationRow(uint32_t y, uint32_t x0, uint32_t x1) {
+  const DoubleLanes four(4.0);
+  const DoubleLanes two(2.0);
+  const DoubleLanes zero(0.0);
+  const DoubleLanes maxIter{double(maxIterations)};
+  const DoubleLanes lastRef{double(referenceRe.size() - 1)};
+  const double* refRe = referenceRe.data();
+  const double* refIm = referenceIm.data();
+
+  const double dcI = (double(int64_t(y)+offsetY) - double(fullH)/2.0)*dy;
+
+  for (uint32_t x = x0;x<x1;x+=chunkWidth) {
+    DoubleLanes dcr[interleave], dci[interleave], dzr[interleave], dzi[interleave];
+    DoubleLanes ref[interleave], count[interleave];
+    LaneMask active[interleave];
+    for (uint32_t k = 0;k<interleave;++k) {
+      const DoubleLanes px = DoubleLanes::ramp() + DoubleLanes(double(int64_t(x + k*DoubleLanes::width)+offsetX));
+      dcr[k] = (px - DoubleLanes(double(fullW)/2.0))*DoubleLanes(dx);
+      dci[k] = DoubleLanes(dcI);
+
+      // dz after the skipped iterations: A dc + B dc^2 + C dc^3
+      const DoubleLanes dc2r = dcr[k]*dcr[k] - dci[k]*dci[k];
+      const DoubleLanes dc2i = two*dcr[k]*dci[k];
+      const DoubleLanes dc3r = dc2r*dcr[k] - dc2i*dci[k];
+      const DoubleLanes dc3i = dc2r*dci[k] + dc2i*dcr[k];
+      dzr[k] = DoubleLanes(seriesA[0])*dcr[k] - DoubleLanes(seriesA[1])*dci[k]
+             + DoubleLanes(seriesB[0])*dc2r - DoubleLanes(seriesB[1])*dc2i
+             + DoubleLanes(seriesC[0])*dc3r - DoubleLanes(seriesC[1])*dc3i;
+      dzi[k] = DoubleLanes(seriesA[0])*dci[k] + DoubleLanes(seriesA[1])*dcr[k]
+             + DoubleLanes(seriesB[0])*dc2i + DoubleLanes(seriesB[1])*dc2r
+             + DoubleLanes(seriesC[0])*dc3i + DoubleLanes(seriesC[1])*dc3r;
+
+      ref[k] = DoubleLanes(double(skippedIterations));
+      count[k] = DoubleLanes(double(skippedIterations));
+      active[k] = count[k] < maxIter;
+    }
+
+    bool running = true;
+    while (running) {
+      for (uint32_t i = 0;i<escapeCheckInterval;++i) {
+        for (uint32_t k = 0;k<interleave;++k) {
+          DoubleLanes zRefR = DoubleLanes::gather(refRe, ref[k]);
+          DoubleLanes zRefI = DoubleLanes::gather(refIm, ref[k]);
+          const DoubleLanes zr = zRefR + dzr[k];
+          const DoubleLanes zi = zRefI + dzi[k];
+          const DoubleLanes magnitude = zr*zr + zi*zi;
+          active[k] = active[k] & (magnitude < four) & (count[k] < maxIter);
+
+          const LaneMask rebase = active[k] & ((magnitude < dzr[k]*dzr[k] + dzi[k]*dzi[k]) | (ref[k] >= lastRef));
+          dzr[k] = dzr[k].select(rebase, zr);
+          dzi[k] = dzi[k].select(rebase, zi);
+          ref[k] = ref[k].select(rebase, zero);
+          zRefR = zRefR.select(rebase, zero);
+          zRefI = zRefI.select(rebase, zero);
+
+          const DoubleLanes tr = two*zRefR + dzr[k];
+          const DoubleLanes ti = two*zRefI + dzi[k];
+          // finished lanes keep their state so their reference index stays valid
+          const DoubleLanes nextR = tr*dzr[k] - ti*dzi[k] + dcr[k];
+          const DoubleLanes nextI = tr*dzi[k] + ti*dzr[k] + dci[k];
+          dzr[k] = dzr[k].select(active[k], nextR);
+          dzi[k] = dzi[k].select(active[k], nextI);
+          ref[k] = ref[k].increment(active[k]);
+          count[k] = count[k].increment(active[k]);
+        }
+      }
+      running = false;
+      for (uint32_t k = 0;k<interleave;++k) running = running || active[k].any();
+    }
+
+    double result[chunkWidth];
+    for (uint32_t k = 0;k<interleave;++k) count[k].store(result + k*DoubleLanes::width);
+    for (uint32_t i = 0;i<chunkWidth && x+i < x1;++i) {
+      iterations[size_t(y)*w + x + i] = uint32_t(result[i]);
+    }
+  }
+}
+
+static double norm(const double c[2]) {
+  return std::sqrt(c[0]*c[0] + c[1]*c[1]);
+}
+
+void MandelbrotEngine::computeReference() {
+  referenceRe.clear();
+  referenceIm.clear();
+
+  // Z_0 = 0, iterate until the reference escapes or reaches maxIterations
+  DoubleDouble zr, zi;
+  referenceRe.push_back(0.0);
+  referenceIm.push_back(0.0);
+  for (uint32_t n = 0;n<maxIterations;++n) {
+    const DoubleDouble zr2 = zr*zr;
+    const DoubleDouble zi2 = zi*zi;
+    zi = DoubleDouble(2.0)*zr*zi + centerIm;
+    zr = zr2 - zi2 + centerRe;
+    referenceRe.push_back(zr.toDouble());
+    referenceIm.push_back(zi.toDouble());
+    if (zr.hi*zr.hi + zi.hi*zi.hi > 4.0) break;
+  }
+
+  // Series approximation dz_n = A_n dc + B_n dc^2 + C_n dc^3 with
+  //   A' = 2ZA + 1,  B' = 2ZB + A^2,  C' = 2ZC + 2AB
+  // valid as long as the cubic term stays negligible for the largest dc in
+  // the image and the offsets stay small compared to the reference itself
+  const double maxDelta = std::sqrt(std::pow(double(fullW)/2.0*dx, 2) + std::pow(double(fullH)/2.0*dy, 2));
+  const double tolerance = 1.0 / (1 << 30);
+
+  double a[2] = {0,0}, b[2] = {0,0}, c[2] = {0,0};
+  seriesA[0] = seriesA[1] = seriesB[0] = seriesB[1] = seriesC[0] = seriesC[1] = 0;
+  skippedIterations = 0;
+  for (uint32_t n = 0;n+2 < referenceRe.size();++n) {
+    const double zr = referenceRe[n];
+    const double zi = referenceIm[n];
+    const double na[2] = {2*(zr*a[0] - zi*a[1]) + 1, 2*(zr*a[1] + zi*a[0])};
+    const double nb[2] = {2*(zr*b[0] - zi*b[1]) + a[0]*a[0] - a[1]*a[1],
+                          2*(zr*b[1] + zi*b[0]) + 2*a[0]*a[1]};
+    const double nc[2] = {2*(zr*c[0] - zi*c[1]) + 2*(a[0]*b[0] - a[1]*b[1]),
+                          2*(zr*c[1] + zi*c[0]) + 2*(a[0]*b[1] + a[1]*b[0])};
+
+    const double zNext = std::sqrt(referenceRe[n+1]*referenceRe[n+1] + referenceIm[n+1]*referenceIm[n+1]);
+    if (!std::isfinite(norm(nc)) ||
+        norm(nc)*maxDelta*maxDelta*maxDelta > tolerance*norm(na)*maxDelta ||
+        norm(na)*maxDelta > 1e-3*zNext) break;
+
+    std::copy(na, na+2, a);
+    std::copy(nb, nb+2, b);
+    std::copy(nc, nc+2, c);
+    skippedIterations = n+1;
+  }
+  std::copy(a, a+2, seriesA);
+  std::copy(b, b+2, seriesB);
+  std::copy(c, c+2, seriesC);
+
+  referenceValid = true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "DoubleDouble.h"
+
+// CPU Mandelbrot renderer for machines without OpenCL. Pixels are iterated in
+// SIMD lanes (DoubleLanes.h), two vectors interleaved per loop to hide the
+// multiply latency, and the image is cut into small tiles that a pool of
+// worker threads processes with work stealing, as iteration counts differ
+// by orders of magnitude between neighbouring tiles.
+//
+// The public interface mirrors the OpenCL Fractal in OpenGL/OpenCL so it can
+// replace it in MultiresGen: the engine computes a w x h window at offsetX,
+// offsetY of a fullW x fullH image. By default the image shows the classic
+// [-2.1,0.7]x[-1.3,1.3] view, setView() selects an arbitrary center and
+// pixel size. Views deeper than double precision are rendered with
+// perturbation against a double-double reference orbit at the view center,
+// with the first iterations skipped by series approximation.
+class MandelbrotEngine {
+public:
+  enum class Mode {
+    Auto,         // perturbation once the pixel size gets close to double precision
+    Direct,       // iterate z = z^2 + c in double precision
+    Perturbation  // iterate the difference to the reference orbit
+  };
+
+  MandelbrotEngine(uint32_t w, uint32_t h,
+                   int64_t fullW, int64_t fullH,
+                   int64_t offsetX, int64_t offsetY,
+                   uint32_t threadCount=0);
+  ~MandelbrotEngine();
+
+  void compute();
+
+  uint32_t getWidth() const {return w;}
+  uint32_t getHeight() const {return h;}
+  // iteration count per pixel truncated to 8 bit, same as the OpenCL kernel
+  const std::vector<uint8_t>& getData() const {return target;}
+  const std::vector<uint32_t>& getIterations() const {return iterations;}
+
+  void setResolution(int64_t fullW, int64_t fullH);
+  void setOffset(int64_t offsetX, int64_t offsetY);
+  void setMaxIterations(uint32_t maxIterations);
+  void setMode(Mode mode);
+
+  // centers the full image at (centerRe, centerIm), given as decimal strings
+  // to keep the digits beyond double precision; pixelSize is the distance of
+  // two neighbouring pixels in the complex plane
+  bool setView(const std::string& centerRe, const std::string& centerIm, double pixelSize);
+  void setDefaultView();
+
+  // number of iterations the last compute() skipped by series approximation
+  uint32_t getSkippedIterations() const {return skippedIterations;}
+  bool usedPerturbation() const {return perturbationActive;}
+
+private:
+  struct Worker {
+    // remaining tiles [begin, end) packed as begin | end << 32, the owner
+    // takes from the front, thieves from the back
+    std::atomic<uint64_t> range{0};
+  };
+
+  static const uint32_t tileWidth{64};
+  static const uint32_t tileHeight{16};
+  static const uint32_t escapeCheckInterval{8};
+
+  uint32_t w;
+  uint32_t h;
+  int64_t fullW;
+  int64_t fullH;
+  int64_t offsetX;
+  int64_t offsetY;
+  uint32_t maxIterations{256};
+  Mode mode{Mode::Auto};
+
+  // the default view keeps the non square pixels of the OpenCL kernel
+  bool defaultView{true};
+  DoubleDouble centerRe;
+  DoubleDouble centerIm;
+  double dx;
+  double dy;
+
+  std::vector<uint8_t> target;
+  std::vector<uint32_t> iterations;
+
+  // perturbation state, rebuilt when the view changes
+  bool referenceValid{false};
+  bool perturbationActive{false};
+  std::vector<double> referenceRe;
+  std::vector<double> referenceIm;
+  uint32_t skippedIterations{0};
+  double seriesA[2], seriesB[2], seriesC[2];
+
+  // thread pool
+  uint32_t workerCount;
+  std::vector<std::thread> threads;
+  std::unique_ptr<Worker[]> workers;
+  std::mutex poolMutex;
+  std::condition_variable poolWakeup;
+  std::condition_variable poolDone;
+  uint64_t generation{0};
+  uint32_t busyWorkers{0};
+  bool shutdown{false};
+
+  uint32_t tileCountX() const {return (w + tileWidth - 1) / tileWidth;}
+  uint32_t tileCountY() const {return (h + tileHeight - 1) / tileHeight;}
+
+  void workerFunc(uint32_t index);
+  void runTiles(uint32_t index);
+  bool popTile(uint32_t index, uint32_t& tile);
+  bool stealTile(uint32_t victim, uint32_t& tile);
+
+  void computeTile(uint32_t tile);
+  void computeDirectRow(uint32_t y, uint32_t x0, uint32_t x1);
+  void computePerturbationRow(uint32_t y, uint32_t x0, uint32_t x1);
+
+  bool needsPerturbation() const;
+  void computeReference();
+  void updatePixelSize();
+};
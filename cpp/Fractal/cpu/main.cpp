@@ -1,18 +1,77 @@
 #include <iostream>
+#include <string>
 #include "Fractal.h"
 
 #include <chrono>
 typedef std::chrono::high_resolution_clock Clock;
 
-int main(int argc, char** argv) {
-  Fractal f(4096,4096);
-  
+static double percentDifferent(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+  size_t different = 0;
+  for (size_t i = 0;i<a.size();++i) {
+    if (a[i] != b[i]) different++;
+  }
+  return 100.0 * double(different) / double(a.size());
+}
+
+static int deepZoom(int argc, char** argv) {
+  const uint32_t size = argc > 6 ? uint32_t(atoi(argv[6])) : 1024;
+  Fractal f(size, size);
+  MandelbrotEngine& engine = f.getEngine();
+  if (!engine.setView(argv[2], argv[3], atof(argv[4]))) {
+    std::cerr << "Invalid view" << std::endl;
+    return EXIT_FAILURE;
+  }
+  engine.setMaxIterations(uint32_t(atoi(argv[5])));
+
   std::cout << "Starting fractal computation ... " << std::flush;
   auto t1 = Clock::now();
   f.compute();
   auto t2 = Clock::now();
-  std::cout << " done in " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << " milliseconds!" << std::endl;
-  
+  std::cout << " done in " << std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count() << " milliseconds"
+            << (engine.usedPerturbation() ? " (perturbation, " : " (direct, ")
+            << engine.getSkippedIterations() << " iterations skipped)" << std::endl;
+
+  f.save("deep.bmp");
+  return EXIT_SUCCESS;
+}
+
+// fractal                                          default view, scalar vs. engine
+// fractal deep <re> <im> <pixelSize> <maxIter> [size]  arbitrary view, writes deep.bmp
+int main(int argc, char** argv) {
+  if (argc > 5 && std::string(argv[1]) == "deep") return deepZoom(argc, argv);
+
+  Fractal f(4096,4096);
+
+  std::cout << "Starting scalar fractal computation ... " << std::flush;
+  auto t1 = Clock::now();
+  f.computeScalar();
+  auto t2 = Clock::now();
+  const auto scalarTime = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+  std::cout << " done in " << scalarTime << " milliseconds!" << std::endl;
+  const std::vector<uint8_t> scalarData = f.getData();
+
+  std::cout << "Starting fractal computation ... " << std::flush;
+  t1 = Clock::now();
+  f.compute();
+  t2 = Clock::now();
+  const auto engineTime = std::chrono::duration_cast<std::chrono::milliseconds>(t2 - t1).count();
+  std::cout << " done in " << engineTime << " milliseconds! ("
+            << double(scalarTime) / double(std::max<int64_t>(1, engineTime)) << "x, "
+            << percentDifferent(scalarData, f.getData()) << "% of the pixels differ from the float version)" << std::endl;
+
   f.save("fractal.bmp");
+
+  // perturbation against direct iteration where double precision still suffices
+  MandelbrotEngine engine(512,512,512,512,0,0);
+  engine.setView("-0.743643887037158704752191506114774", "0.131825904205311970493132056385139", 1e-10);
+  engine.setMaxIterations(1000);
+  engine.setMode(MandelbrotEngine::Mode::Direct);
+  engine.compute();
+  const std::vector<uint8_t> direct = engine.getData();
+  engine.setMode(MandelbrotEngine::Mode::Perturbation);
+  engine.compute();
+  std::cout << "Perturbation check: " << percentDifferent(direct, engine.getData())
+            << "% of the pixels differ, " << engine.getSkippedIterations() << " iterations skipped" << std::endl;
+
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,104 @@
+#include <stdexcept>
+#include <algorithm>
+#include <bitset>
+
+#include "BitLife.h"
+
+BitLife::BitLife(size_t width, size_t height) :
+  width(width),
+  height(height),
+  wordsPerRow(width/64),
+  data(wordsPerRow*height),
+  next(wordsPerRow*height)
+{
+  if (width == 0 || width % 64 != 0 || height == 0) {
+    throw std::invalid_argument("BitLife: width must be a non-zero multiple of 64");
+  }
+}
+
+void BitLife::setData(size_t x, size_t y, bool value) {
+  uint64_t& word = data[y*wordsPerRow + x/64];
+  const uint64_t bit = uint64_t(1) << (x%64);
+  word = value ? (word | bit) : (word & ~bit);
+}
+
+bool BitLife::getData(size_t x, size_t y) const {
+  return (data[y*wordsPerRow + x/64] >> (x%64)) & 1;
+}
+
+uint64_t BitLife::population() const {
+  uint64_t count = 0;
+  for (const uint64_t word : data) count += std::bitset<64>(word).count();
+  return count;
+}
+
+void BitLife::clear() {
+  std::fill(data.begin(), data.end(), 0);
+}
+
+// Next state of the 64 cells in c, given the words left and right of the
+// row above (a), the row itself (c) and the row below (b).
+static inline uint64_t evolve(uint64_t aPrev, uint64_t a, uint64_t aNext,
+                              uint64_t cPrev, uint64_t c, uint64_t cNext,
+                              uint64_t bPrev, uint64_t b, uint64_t bNext) {
+  // the west and east neighbours of every bit, carried across word borders
+  const uint64_t aw = (a << 1) | (aPrev >> 63);
+  const uint64_t ae = (a >> 1) | (aNext << 63);
+  const uint64_t cw = (c << 1) | (cPrev >> 63);
+  const uint64_t ce = (c >> 1) | (cNext << 63);
+  const uint64_t bw = (b << 1) | (bPrev >> 63);
+  const uint64_t be = (b >> 1) | (bNext << 63);
+
+  // full adders per row: ones and twos of the three cells above and below,
+  // half adder for the two horizontal neighbours
+  const uint64_t aOnes = aw ^ a ^ ae;
+  const uint64_t aTwos = (aw & a) | (ae & (aw ^ a));
+  const uint64_t bOnes = bw ^ b ^ be;
+  const uint64_t bTwos = (bw & b) | (be & (bw ^ b));
+  const uint64_t cOnes = cw ^ ce;
+  const uint64_t cTwos = cw & ce;
+
+  // add the ones, the carry joins the twos
+  const uint64_t ones = aOnes ^ bOnes ^ cOnes;
+  const uint64_t carry = (aOnes & bOnes) | (cOnes & (aOnes ^ bOnes));
+
+  // the count is 2 or 3 iff exactly one of the four twos bits is set; with
+  // an odd number of them set, three are set iff one of the pairs is
+  const uint64_t twosOdd = aTwos ^ bTwos ^ cTwos ^ carry;
+  const uint64_t twosPair = (aTwos & bTwos) | (cTwos & carry);
+  const uint64_t exactlyOneTwo = twosOdd & ~twosPair;
+
+  // 3 neighbours: birth or survival, 2 neighbours: survival only
+  return exactlyOneTwo & (ones | c);
+}
+
+void BitLife::stepRow(size_t y) {
+  const uint64_t* a = data.data() + ((y+height-1) % height)*wordsPerRow;
+  const uint64_t* c = data.data() + y*wordsPerRow;
+  const uint64_t* b = data.data() + ((y+1) % height)*wordsPerRow;
+  uint64_t* target = next.data() + y*wordsPerRow;
+
+  const size_t last = wordsPerRow-1;
+  if (wordsPerRow == 1) {
+    target[0] = evolve(a[0], a[0], a[0], c[0], c[0], c[0], b[0], b[0], b[0]);
+    return;
+  }
+
+  target[0] = evolve(a[last], a[0], a[1], c[last], c[0], c[1], b[last], b[0], b[1]);
+  // no wrap around in here, plain neighbouring loads that vectorize
+  for (size_t i = 1;i<last;++i) {
+    target[i] = evolve(a[i-1], a[i], a[i+1], c[i-1], c[i], c[i+1], b[i-1], b[i], b[i+1]);
+  }
+  target[last] = evolve(a[last-1], a[last], a[0], c[last-1], c[last], c[0], b[last-1], b[last], b[0]);
+}
+
+void BitLife::step(size_t generations) {
+  for (size_t g = 0;g<generations;++g) {
+    // static schedule: every thread gets one contiguous band of rows
+    #pragma omp parallel for schedule(static)
+    for (int64_t y = 0;y<int64_t(height);++y) {
+      stepRow(size_t(y));
+    }
+    std::swap(data, next);
+  }
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Toroidal board with 64 cells per 64 bit word, bit i of word j in a row is
+// the cell x = j*64+i. A generation evaluates the neighbour counts of all 64
+// cells of a word at once with a bit sliced adder network, the row loop is
+// written so the compiler can put several words into one SIMD register, and
+// the rows are split into bands over the OpenMP threads.
+//
+// The width has to be a multiple of 64.
+class BitLife {
+public:
+  BitLife(size_t width, size_t height);
+
+  void setData(size_t x, size_t y, bool value);
+  bool getData(size_t x, size_t y) const;
+
+  size_t getWidth() const {return width;}
+  size_t getHeight() const {return height;}
+  size_t getWordsPerRow() const {return wordsPerRow;}
+  const uint64_t* getRow(size_t y) const {return data.data() + y*wordsPerRow;}
+
+  uint64_t population() const;
+  void clear();
+
+  void step(size_t generations=1);
+
+private:
+  size_t width;
+  size_t height;
+  size_t wordsPerRow;
+  std::vector<uint64_t> data;
+  std::vector<uint64_t> next;
+
+  void stepRow(size_t y);
+};
@@ -0,0 +1,312 @@
+#include <algorithm>
+
+#include "HashLife.h"
+#include "BitLife.h"
+
+HashLife::HashLife() {
+  reset();
+}
+
+void HashLife::reset() {
+  nodes.clear();
+  table.clear();
+  emptyNodes.clear();
+  nodes.push_back({nullptr, nullptr, nullptr, nullptr, 0, 0});
+  dead = &nodes.back();
+  nodes.push_back({nullptr, nullptr, nullptr, nullptr, 0, 1});
+  alive = &nodes.back();
+  root = empty(3);
+  currentStep = 0;
+  generation = 0;
+}
+
+const HashLife::Node* HashLife::join(const Node* nw, const Node* ne, const Node* sw, const Node* se) {
+  const Key key{nw, ne, sw, se};
+  const auto it = table.find(key);
+  if (it != table.end()) return it->second;
+
+  nodes.push_back({nw, ne, sw, se, nw->level+1,
+                   nw->population + ne->population + sw->population + se->population});
+  const Node* n = &nodes.back();
+  table[key] = n;
+  return n;
+}
+
+const HashLife::Node* HashLife::empty(uint32_t level) {
+  if (emptyNodes.empty()) emptyNodes.push_back(dead);
+  while (emptyNodes.size() <= level) {
+    const Node* e = emptyNodes.back();
+    emptyNodes.push_back(join(e, e, e, e));
+  }
+  return emptyNodes[level];
+}
+
+// same content, one level up, centered around the same origin
+const HashLife::Node* HashLife::expand(const Node* n) {
+  const Node* e = empty(n->level-1);
+  return join(join(e, e, e, n->nw),
+              join(e, e, n->ne, e),
+              join(e, n->sw, e, e),
+              join(n->se, e, e, e));
+}
+
+const HashLife::Node* HashLife::centeredSubnode(const Node* n) {
+  return join(n->nw->se, n->ne->sw, n->sw->ne, n->se->nw);
+}
+
+const HashLife::Node* HashLife::centeredHorizontal(const Node* w, const Node* e) {
+  return join(w->ne, e->nw, w->se, e->sw);
+}
+
+const HashLife::Node* HashLife::centeredVertical(const Node* n, const Node* s) {
+  return join(n->sw, n->se, s->nw, s->ne);
+}
+
+bool HashLife::cell(const Node* n, uint32_t x, uint32_t y) {
+  while (n->level > 0) {
+    const uint32_t half = 1u << (n->level-1);
+    if (y < half) {
+      n = (x < half) ? n->nw : n->ne;
+    } else {
+      n = (x < half) ? n->sw : n->se;
+      y -= half;
+    }
+    if (x >= half) x -= half;
+  }
+  return n->population != 0;
+}
+
+// 4x4 cells, returns the center 2x2 one generation later
+const HashLife::Node* HashLife::baseCase(const Node* n) {
+  bool cells[4][4];
+  for (uint32_t y = 0;y<4;++y) {
+    for (uint32_t x = 0;x<4;++x) {
+      cells[y][x] = cell(n, x, y);
+    }
+  }
+
+  const Node* result[2][2];
+  for (uint32_t y = 1;y<3;++y) {
+    for (uint32_t x = 1;x<3;++x) {
+      uint32_t count = 0;
+      for (uint32_t dy = y-1;dy<=y+1;++dy) {
+        for (uint32_t dx = x-1;dx<=x+1;++dx) {
+          if ((dx != x || dy != y) && cells[dy][dx]) count++;
+        }
+      }
+      const bool next = cells[y][x] ? (count == 2 || count == 3) : count == 3;
+      result[y-1][x-1] = next ? alive : dead;
+    }
+  }
+  return join(result[0][0], result[0][1], result[1][0], result[1][1]);
+}
+
+// The center half of n, advanced by 2^min(level-2, currentStep) generations.
+const HashLife::Node* HashLife::next(const Node* n) {
+  if (n->result) return n->result;
+  if (n->population == 0) {
+    n->result = empty(n->level-1);
+    return n->result;
+  }
+  if (n->level == 2) {
+    n->result = baseCase(n);
+    return n->result;
+  }
+
+  // nine overlapping subnodes of half the size
+  const Node* n00 = n->nw;
+  const Node* n01 = centeredHorizontal(n->nw, n->ne);
+  const Node* n02 = n->ne;
+  const Node* n10 = centeredVertical(n->nw, n->sw);
+  const Node* n11 = centeredSubnode(n);
+  const Node* n12 = centeredVertical(n->ne, n->se);
+  const Node* n20 = n->sw;
+  const Node* n21 = centeredHorizontal(n->sw, n->se);
+  const Node* n22 = n->se;
+
+  const Node* r00 = next(n00);
+  const Node* r01 = next(n01);
+  const Node* r02 = next(n02);
+  const Node* r10 = next(n10);
+  const Node* r11 = next(n11);
+  const Node* r12 = next(n12);
+  const Node* r20 = next(n20);
+  const Node* r21 = next(n21);
+  const Node* r22 = next(n22);
+
+  if (n->level-2 <= currentStep) {
+    // full speed: advance the four combined quarters a second time
+    n->result = join(next(join(r00, r01, r10, r11)),
+                     next(join(r01, r02, r11, r12)),
+                     next(join(r10, r11, r20, r21)),
+                     next(join(r11, r12, r21, r22)));
+  } else {
+    // smaller step: the subnodes already advanced far enough, only crop
+    n->result = join(centeredSubnode(join(r00, r01, r10, r11)),
+                     centeredSubnode(join(r01, r02, r11, r12)),
+                     centeredSubnode(join(r10, r11, r20, r21)),
+                     centeredSubnode(join(r11, r12, r21, r22)));
+  }
+  return n->result;
+}
+
+bool HashLife::centeredQuarterHoldsAll(const Node* n) const {
+  return n->population == n->nw->se->se->population + n->ne->sw->sw->population +
+                          n->sw->ne->ne->population + n->se->nw->nw->population;
+}
+
+void HashLife::setStep(uint32_t k) {
+  if (k == currentStep) return;
+  // results of nodes up to level step+2 do not depend on the step size
+  const uint32_t keep = std::min(k, currentStep) + 2;
+  for (const Node& n : nodes) {
+    if (n.level > keep) n.result = nullptr;
+  }
+  currentStep = k;
+}
+
+void HashLife::stepPow2(uint32_t k) {
+  setStep(k);
+  // the pattern may grow by 2^k cells in each direction, make sure that
+  // fits into the center half the result covers
+  while (root->level < k+3 || !centeredQuarterHoldsAll(root)) {
+    root = expand(root);
+  }
+  root = next(root);
+  generation += uint64_t(1) << k;
+
+  if (nodes.size() > maxNodes) compact();
+}
+
+void HashLife::advance(uint64_t generations) {
+  for (uint32_t k = 0;k<64 && (generations >> k) != 0;++k) {
+    if ((generations >> k) & 1) stepPow2(k);
+  }
+}
+
+const HashLife::Node* HashLife::copyNode(const Node* n, std::unordered_map<const Node*, const Node*>& copies) {
+  const auto it = copies.find(n);
+  if (it != copies.end()) return it->second;
+  const Node* copy = join(copyNode(n->nw, copies), copyNode(n->ne, copies),
+                          copyNode(n->sw, copies), copyNode(n->se, copies));
+  copies[n] = copy;
+  return copy;
+}
+
+// rebuilds the node store with only the nodes reachable from the root
+void HashLife::compact() {
+  std::deque<Node> oldNodes;
+  std::swap(oldNodes, nodes);
+  const Node* oldRoot = root;
+  const Node* oldDead = dead;
+  const Node* oldAlive = alive;
+  const uint32_t step = currentStep;
+  const uint64_t oldGeneration = generation;
+
+  reset();
+  std::unordered_map<const Node*, const Node*> copies{{oldDead, dead}, {oldAlive, alive}};
+  root = copyNode(oldRoot, copies);
+  currentStep = step;
+  generation = oldGeneration;
+}
+
+const HashLife::Node* HashLife::set(const Node* n, uint64_t x, uint64_t y, bool value) {
+  if (n->level == 0) return value ? alive : dead;
+  const uint64_t half = uint64_t(1) << (n->level-1);
+  if (y < half) {
+    if (x < half) return join(set(n->nw, x, y, value), n->ne, n->sw, n->se);
+    return join(n->nw, set(n->ne, x-half, y, value), n->sw, n->se);
+  }
+  if (x < half) return join(n->nw, n->ne, set(n->sw, x, y-half, value), n->se);
+  return join(n->nw, n->ne, n->sw, set(n->se, x-half, y-half, value));
+}
+
+void HashLife::setData(int64_t x, int64_t y, bool value) {
+  while (true) {
+    const int64_t half = int64_t(1) << (root->level-1);
+    if (x >= -half && x < half && y >= -half && y < half) break;
+    root = expand(root);
+  }
+  const int64_t half = int64_t(1) << (root->level-1);
+  root = set(root, uint64_t(x+half), uint64_t(y+half), value);
+}
+
+bool HashLife::getData(int64_t x, int64_t y) const {
+  const int64_t half = int64_t(1) << (root->level-1);
+  if (x < -half || x >= half || y < -half || y >= half) return false;
+
+  const Node* n = root;
+  uint64_t lx = uint64_t(x+half);
+  uint64_t ly = uint64_t(y+half);
+  while (n->level > 0 && n->population > 0) {
+    const uint64_t h = uint64_t(1) << (n->level-1);
+    if (ly < h) {
+      n = (lx < h) ? n->nw : n->ne;
+    } else {
+      n = (lx < h) ? n->sw : n->se;
+      ly -= h;
+    }
+    if (lx >= h) lx -= h;
+  }
+  return n->population != 0;
+}
+
+const HashLife::Node* HashLife::build(const BitLife& board, uint64_t x0, uint64_t y0, uint32_t level) {
+  if (x0 >= board.getWidth() || y0 >= board.getHeight()) return empty(level);
+  if (level == 0) return board.getData(x0, y0) ? alive : dead;
+
+  const uint64_t size = uint64_t(1) << level;
+  if (level >= 6) {
+    // whole words, skip empty regions without descending to single cells
+    const uint64_t yEnd = std::min<uint64_t>(y0+size, board.getHeight());
+    const uint64_t wordEnd = std::min<uint64_t>((x0+size)/64, board.getWordsPerRow());
+    bool isEmpty = true;
+    for (uint64_t y = y0;y<yEnd && isEmpty;++y) {
+      const uint64_t* row = board.getRow(y);
+      for (uint64_t w = x0/64;w<wordEnd;++w) {
+        if (row[w]) {
+          isEmpty = false;
+          break;
+        }
+      }
+    }
+    if (isEmpty) return empty(level);
+  }
+
+  const uint64_t half = size/2;
+  return join(build(board, x0, y0, level-1),
+              build(board, x0+half, y0, level-1),
+              build(board, x0, y0+half, level-1),
+              build(board, x0+half, y0+half, level-1));
+}
+
+void HashLife::load(const BitLife& board) {
+  reset();
+  uint32_t level = 3;
+  while ((uint64_t(1) << (level-1)) < std::max(board.getWidth(), board.getHeight())) level++;
+  const Node* e = empty(level-1);
+  root = join(e, e, e, build(board, 0, 0, level-1));
+}
+
+void HashLife::storeNode(const Node* n, int64_t x0, int64_t y0, BitLife& board) const {
+  if (n->population == 0) return;
+  const int64_t size = int64_t(1) << n->level;
+  if (x0 >= int64_t(board.getWidth()) || y0 >= int64_t(board.getHeight()) ||
+      x0+size <= 0 || y0+size <= 0) return;
+
+  if (n->level == 0) {
+    board.setData(size_t(x0), size_t(y0), true);
+    return;
+  }
+  const int64_t half = size/2;
+  storeNode(n->nw, x0, y0, board);
+  storeNode(n->ne, x0+half, y0, board);
+  storeNode(n->sw, x0, y0+half, board);
+  storeNode(n->se, x0+half, y0+half, board);
+}
+
+void HashLife::store(BitLife& board) const {
+  board.clear();
+  const int64_t half = int64_t(1) << (root->level-1);
+  storeNode(root, -half, -half, board);
+}
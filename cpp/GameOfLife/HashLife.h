@@ -0,0 +1,103 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+class BitLife;
+
+// Gosper's HashLife: the plane is a quadtree of canonical (hash consed)
+// nodes, so identical regions are stored once, and every node memoizes its
+// center half advanced in time. Sparse, repetitive or periodic patterns can
+// thus be advanced by 2^k generations in time roughly proportional to the
+// number of distinct nodes instead of cells times generations.
+//
+// Unlike Grid2D and BitLife the plane is unbounded, not a torus; patterns
+// agree as long as nothing reaches the border of the torus.
+class HashLife {
+public:
+  HashLife();
+
+  void setData(int64_t x, int64_t y, bool value);
+  bool getData(int64_t x, int64_t y) const;
+  uint64_t population() const {return root->population;}
+  uint64_t getGeneration() const {return generation;}
+  size_t getNodeCount() const {return nodes.size();}
+
+  // advances by 2^k generations
+  void stepPow2(uint32_t k);
+  // advances by any number of generations as a sum of powers of two
+  void advance(uint64_t generations);
+
+  // replaces the plane by the board, board cell (x,y) becomes (x,y)
+  void load(const BitLife& board);
+  // writes the cells within the board's rectangle into the board
+  void store(BitLife& board) const;
+
+private:
+  struct Node {
+    const Node* nw;
+    const Node* ne;
+    const Node* sw;
+    const Node* se;
+    uint32_t level;       // 2^level x 2^level cells, level 0 is a single cell
+    uint64_t population;
+    mutable const Node* result{nullptr};
+  };
+
+  struct Key {
+    const Node* nw;
+    const Node* ne;
+    const Node* sw;
+    const Node* se;
+    bool operator==(const Key& other) const {
+      return nw == other.nw && ne == other.ne && sw == other.sw && se == other.se;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& k) const {
+      uint64_t h = uint64_t(k.nw);
+      h = h * 0x9e3779b97f4a7c15ull + uint64_t(k.ne);
+      h = h * 0x9e3779b97f4a7c15ull + uint64_t(k.sw);
+      h = h * 0x9e3779b97f4a7c15ull + uint64_t(k.se);
+      return size_t(h ^ (h >> 29));
+    }
+  };
+
+  // beyond this many nodes the unreachable ones are dropped after a step
+  static const size_t maxNodes{1u << 24};
+
+  std::deque<Node> nodes;
+  std::unordered_map<Key, const Node*, KeyHash> table;
+  std::vector<const Node*> emptyNodes;
+  const Node* dead;
+  const Node* alive;
+  const Node* root;
+  uint32_t currentStep{0};
+  uint64_t generation{0};
+
+  void reset();
+  const Node* join(const Node* nw, const Node* ne, const Node* sw, const Node* se);
+  const Node* empty(uint32_t level);
+  const Node* expand(const Node* n);
+
+  const Node* centeredSubnode(const Node* n);
+  const Node* centeredHorizontal(const Node* w, const Node* e);
+  const Node* centeredVertical(const Node* n, const Node* s);
+
+  const Node* next(const Node* n);
+  const Node* baseCase(const Node* n);
+  bool centeredQuarterHoldsAll(const Node* n) const;
+
+  void setStep(uint32_t k);
+  void compact();
+  const Node* copyNode(const Node* n, std::unordered_map<const Node*, const Node*>& copies);
+
+  const Node* set(const Node* n, uint64_t x, uint64_t y, bool value);
+  const Node* build(const BitLife& board, uint64_t x0, uint64_t y0, uint32_t level);
+  void storeNode(const Node* n, int64_t x0, int64_t y0, BitLife& board) const;
+  static bool cell(const Node* n, uint32_t x, uint32_t y);
+};
@@ -0,0 +1,194 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <sstream>
+#include <functional>
+#include <chrono>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "Grid2D.h"
+#include "BitLife.h"
+#include "HashLife.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Validates BitLife and HashLife generation by generation against the
+// Grid2D reference, reports cell updates per second of the dense engines
+// and the time HashLife needs for a million generations of a glider gun.
+//
+//   golBench [size]   size of the BitLife benchmark board, default 4096
+
+static void randomFill(size_t x0, size_t y0, size_t w, size_t h, float density, uint32_t seed,
+                       const std::function<void(size_t, size_t)>& set) {
+  std::mt19937 gen(seed);
+  std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+  for (size_t y = y0;y<y0+h;++y) {
+    for (size_t x = x0;x<x0+w;++x) {
+      if (dist(gen) < density) set(x, y);
+    }
+  }
+}
+
+// minimal RLE reader for the benchmark patterns, "b" dead, "o" alive, "$" new row
+static void parseRLE(const std::string& rle, int64_t x0, int64_t y0,
+                     const std::function<void(int64_t, int64_t)>& set) {
+  int64_t x = x0, y = y0, count = 0;
+  for (const char c : rle) {
+    if (c >= '0' && c <= '9') {
+      count = count*10 + (c - '0');
+      continue;
+    }
+    const int64_t n = count ? count : 1;
+    switch (c) {
+      case 'b' : x += n; break;
+      case 'o' : for (int64_t i = 0;i<n;++i) set(x++, y); break;
+      case '$' : y += n; x = x0; break;
+      default: break;
+    }
+    count = 0;
+  }
+}
+
+static bool equal(const Grid2D& g, const BitLife& b) {
+  for (size_t y = 0;y<g.getHeight();++y) {
+    for (size_t x = 0;x<g.getWidth();++x) {
+      if (g.getData(x,y) != b.getData(x,y)) return false;
+    }
+  }
+  return true;
+}
+
+static bool validateBitLife(size_t width, size_t height, size_t generations) {
+  Grid2D current{width, height};
+  Grid2D next{width, height};
+  BitLife board{width, height};
+  randomFill(0, 0, width, height, 0.35f, 1, [&](size_t x, size_t y) {
+    current.setData(x, y, true);
+    board.setData(x, y, true);
+  });
+
+  for (size_t g = 0;g<generations;++g) {
+    play(current, next);
+    std::swap(current, next);
+    board.step();
+    if (!equal(current, board)) {
+      std::cout << "BitLife " << width << "x" << height << " differs in generation " << g+1 << std::endl;
+      return false;
+    }
+  }
+  std::cout << "BitLife " << width << "x" << height << ": " << generations << " generations match" << std::endl;
+  return true;
+}
+
+static bool validateHashLife() {
+  // a soup in the center, far enough from the border that it cannot wrap
+  // around the torus within the tested generations
+  const size_t size = 256;
+  Grid2D current{size, size};
+  Grid2D next{size, size};
+  BitLife board{size, size};
+  randomFill(104, 104, 48, 48, 0.4f, 2, [&](size_t x, size_t y) {
+    current.setData(x, y, true);
+    board.setData(x, y, true);
+  });
+
+  HashLife life;
+  life.load(board);
+
+  size_t generation = 0;
+  for (const uint64_t steps : {1, 2, 5, 8, 13, 16, 3, 32}) {
+    for (size_t g = 0;g<steps;++g) {
+      play(current, next);
+      std::swap(current, next);
+    }
+    generation += steps;
+    life.advance(steps);
+    life.store(board);
+    if (!equal(current, board)) {
+      std::cout << "HashLife differs in generation " << generation << std::endl;
+      return false;
+    }
+  }
+  std::cout << "HashLife: " << generation << " generations match" << std::endl;
+  return true;
+}
+
+static void report(const std::string& name, double cellUpdates, double seconds) {
+  std::cout << std::left << std::setw(40) << name << std::right << std::setw(12) << std::fixed
+            << std::setprecision(3) << cellUpdates / seconds / 1e9 << " Gcell updates/s" << std::endl;
+}
+
+static void benchGrid2D() {
+  const size_t size = 512;
+  const size_t generations = 10;
+  Grid2D current{size, size};
+  Grid2D next{size, size};
+  randomFill(0, 0, size, size, 0.35f, 3, [&](size_t x, size_t y) {current.setData(x, y, true);});
+
+  const auto t1 = Clock::now();
+  for (size_t g = 0;g<generations;++g) {
+    play(current, next);
+    std::swap(current, next);
+  }
+  const auto t2 = Clock::now();
+  report("Grid2D 512x512", double(size*size*generations), std::chrono::duration<double>(t2-t1).count());
+}
+
+static void benchBitLife(size_t size) {
+  const size_t generations = std::max<size_t>(1, (size_t(1) << 32) / (size*size));
+  BitLife board{size, size};
+  randomFill(0, 0, size, size, 0.35f, 4, [&](size_t x, size_t y) {board.setData(x, y, true);});
+
+  const auto t1 = Clock::now();
+  board.step(generations);
+  const auto t2 = Clock::now();
+
+  int threads = 1;
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#endif
+  std::stringstream name;
+  name << "BitLife " << size << "x" << size << " (" << threads << " threads)";
+  report(name.str(), double(size*size*generations), std::chrono::duration<double>(t2-t1).count());
+}
+
+static void benchHashLife() {
+  // Gosper glider gun, periodic core plus a stream of gliders
+  const std::string gun = "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$"
+                          "2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o!";
+  HashLife life;
+  parseRLE(gun, 0, 0, [&](int64_t x, int64_t y) {life.setData(x, y, true);});
+
+  const uint32_t k = 20;
+  const auto t1 = Clock::now();
+  life.stepPow2(k);
+  const auto t2 = Clock::now();
+
+  // cell updates are meaningless here, the plane is unbounded
+  const double seconds = std::chrono::duration<double>(t2-t1).count();
+  std::cout << std::left << std::setw(40) << "HashLife glider gun 2^20 gens" << std::right
+            << std::setw(12) << std::fixed << std::setprecision(3) << seconds << " s" << std::endl;
+  std::cout << "  population " << life.population() << ", " << life.getNodeCount() << " nodes" << std::endl;
+}
+
+int main(int argc, char** argv) {
+  const size_t size = argc > 1 ? size_t(atoll(argv[1])) : 4096;
+
+  bool ok = validateBitLife(64, 64, 200) &&
+            validateBitLife(192, 100, 200) &&
+            validateBitLife(128, 3, 50) &&
+            validateHashLife();
+  if (!ok) return EXIT_FAILURE;
+
+  std::cout << std::endl;
+  benchGrid2D();
+  benchBitLife(size);
+  benchHashLife();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,218 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include <ParticleSimulation.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Runs the particle simulation headless and compares it with the previous
+// array of Particle objects, first for identical results with restarts
+// disabled, then for the time of a frame (update and vertex data).
+//
+//   particleBench [millions] [frames]   defaults 1 and 120
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// the particle of the previous ParticleSystem without the height field
+class Particle {
+public:
+  Particle(const Vec3& position, const Vec3& direction, const Vec3& acceleration,
+           const Vec3& color, float maxAge, const Vec3& minPos, const Vec3& maxPos, bool bounce) :
+    position(position), direction(direction), acceleration(acceleration), color(color),
+    opacity(1.0f), bounce(bounce), maxAge(maxAge), age(0.0f), minPos(minPos), maxPos(maxPos) {}
+
+  void update(float deltaT) {
+    age+=deltaT;
+    if(isDead()) {
+      opacity = 0.0f;
+      return;
+    }
+    Vec3 nextPosition{position + direction*deltaT};
+    if (bounce) {
+      if (nextPosition.x < minPos.x || nextPosition.x > maxPos.x)
+        direction = direction * Vec3(-0.5f,0.0f,0.0f);
+      if (nextPosition.y < minPos.y || nextPosition.y > maxPos.y)
+        direction = direction * Vec3(0.0f,-0.5f,0.0f);
+      if (nextPosition.z < minPos.z || nextPosition.z > maxPos.z)
+        direction = direction * Vec3(0.0f,0.0f,-0.5f);
+      nextPosition = position + direction*deltaT;
+    } else {
+      if (nextPosition.x < minPos.x || nextPosition.x > maxPos.x ||
+          nextPosition.y < minPos.y || nextPosition.y > maxPos.y ||
+          nextPosition.z < minPos.z || nextPosition.z > maxPos.z) {
+        direction = Vec3(0,0,0);
+        acceleration = Vec3(0,0,0);
+        nextPosition = position;
+      }
+    }
+    position = nextPosition;
+    direction = direction + acceleration*deltaT;
+  }
+
+  void restart(const Vec3& position, const Vec3& direction, const Vec3& acceleration,
+               const Vec3& color, float maxAge) {
+    this->position = position;
+    this->direction = direction;
+    this->acceleration = acceleration;
+    this->color = color;
+    this->opacity = 1.0f;
+    this->maxAge = maxAge;
+    age = 0.0f;
+  }
+
+  bool isDead() const {return age >= maxAge;}
+
+  std::vector<float> getData() const {
+    return { position.x, position.y, position.z, color.x, color.y, color.z, opacity };
+  }
+
+private:
+  Vec3 position;
+  Vec3 direction;
+  Vec3 acceleration;
+  Vec3 color;
+  float opacity;
+  bool bounce;
+  float maxAge;
+  float age;
+  Vec3 minPos;
+  Vec3 maxPos;
+};
+
+// the update and getData of the previous ParticleSystem
+class ReferenceSystem {
+public:
+  ReferenceSystem(size_t count, std::shared_ptr<StartVolume> starter, const Vec3& speedMin, const Vec3& speedMax,
+                  const Vec3& acceleration, const Vec3& minPos, const Vec3& maxPos, float maxAge, bool bounce) :
+    starter(starter), speedMin(speedMin), speedMax(speedMax), acceleration(acceleration), maxAge(maxAge)
+  {
+    for (size_t i = 0;i<count;++i) {
+      particles.emplace_back(starter->getPosition(), direction(), acceleration, Vec3::random(),
+                             maxAge*staticRand.rand01(), minPos, maxPos, bounce);
+    }
+  }
+
+  void update(float t) {
+    const float deltaT = t-lastT;
+    lastT = t;
+    for (Particle& p : particles) {
+      p.update(deltaT);
+      if (p.isDead()) p.restart(starter->getPosition(), direction(), acceleration, Vec3::random(), maxAge*staticRand.rand01());
+    }
+  }
+
+  std::vector<float> getData() const {
+    std::vector<float> data;
+    for (const Particle& p : particles) {
+      std::vector<float> pData{p.getData()};
+      data.insert(data.end(), pData.begin(), pData.end());
+    }
+    return data;
+  }
+
+private:
+  std::vector<Particle> particles;
+  std::shared_ptr<StartVolume> starter;
+  Vec3 speedMin;
+  Vec3 speedMax;
+  Vec3 acceleration;
+  float maxAge;
+  float lastT{0};
+
+  Vec3 direction() const {
+    return speedMin + (speedMax - speedMin) * Vec3{staticRand.rand01(),staticRand.rand01(),staticRand.rand01()};
+  }
+};
+
+// deterministic start positions on a lattice partly outside the bounds
+class LatticeStart : public StartVolume {
+public:
+  using StartVolume::getPosition;
+  virtual Vec3 getPosition(Random& random) const {
+    const uint32_t i = counter++;
+    return Vec3{float(i % 97), float((i/97) % 89), float((i/(97*89)) % 83)} / 40.0f - Vec3{1.2f, 1.1f, 1.0f};
+  }
+  void reset() {counter = 0;}
+private:
+  mutable uint32_t counter{0};
+};
+
+static bool validate(bool bounce) {
+  const size_t count = 100003;
+  const Vec3 speed{0.3f, 0.8f, -0.45f};
+  const Vec3 gravity{0.0f, -0.981f, 0.0f};
+  auto starter = std::make_shared<LatticeStart>();
+  ParticleSimulation simulation{uint32_t(count), starter, speed, speed, gravity,
+                                Vec3{-1,-1,-1}, Vec3{1,1,1}, 1e9f, Vec3{1,1,1}};
+  simulation.setBounce(bounce);
+  starter->reset();
+  ReferenceSystem reference{count, starter, speed, speed, gravity, Vec3{-1,-1,-1}, Vec3{1,1,1}, 1e9f, bounce};
+
+  std::vector<float> data(count*7);
+  float maxError = 0.0f;
+  for (size_t frame = 1;frame<=300;++frame) {
+    simulation.update(frame/60.0f);
+    reference.update(frame/60.0f);
+  }
+  simulation.getData(data.data());
+  const std::vector<float> expected = reference.getData();
+  for (size_t i = 0;i<count;++i) {
+    for (size_t j = 0;j<3;++j) maxError = std::max(maxError, std::abs(data[i*7+j]-expected[i*7+j]));
+  }
+  std::cout << "bounce " << (bounce ? "on:  " : "off: ") << "largest position difference after 300 frames "
+            << maxError << std::endl;
+  // the compiler may contract either side into fused multiply-adds, so the
+  // positions only agree up to rounding
+  return maxError < 1e-5f;
+}
+
+int main(int argc, char** argv) {
+  const size_t millions = argc > 1 ? size_t(atoi(argv[1])) : 1;
+  const size_t frames = argc > 2 ? size_t(atoi(argv[2])) : 120;
+
+  const bool bounceOk = validate(true);
+  const bool stopOk = validate(false);
+  const bool ok = bounceOk && stopOk;
+
+  const size_t count = millions*1000000;
+  auto starter = std::make_shared<SphereStart>(Vec3{0,0,0}, 0.2f);
+  const Vec3 speedMin{-0.1f,-0.1f,-0.1f};
+  const Vec3 speedMax{0.1f,0.1f,0.1f};
+  const Vec3 gravity{0.0f,-0.1f,0.0f};
+
+  // particles live five seconds on average, so about one in 300 restarts
+  // every frame
+  ParticleSimulation simulation{uint32_t(count), starter, speedMin, speedMax, gravity,
+                                Vec3{-1.9f,-1.9f,-1.9f}, Vec3{1.9f,1.9f,1.9f}, 10.0f};
+  std::vector<float> data(count*7);
+  auto t1 = Clock::now();
+  for (size_t frame = 1;frame<=frames;++frame) {
+    simulation.update(frame/60.0f);
+    simulation.getData(data.data());
+  }
+  auto t2 = Clock::now();
+  const double soaTime = seconds(t1,t2)/frames/millions;
+
+  ReferenceSystem reference{count, starter, speedMin, speedMax, gravity,
+                            Vec3{-1.9f,-1.9f,-1.9f}, Vec3{1.9f,1.9f,1.9f}, 10.0f, true};
+  t1 = Clock::now();
+  for (size_t frame = 1;frame<=frames;++frame) {
+    reference.update(frame/60.0f);
+    const std::vector<float> referenceData = reference.getData();
+  }
+  t2 = Clock::now();
+  const double aosTime = seconds(t1,t2)/frames/millions;
+
+  std::cout << std::fixed << std::setprecision(2) << count << " particles, frame time per million: "
+            << soaTime*1000 << " ms, previous " << aosTime*1000 << " ms (" << std::setprecision(1)
+            << aosTime/soaTime << "x)" << std::endl;
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,58 @@
+#include <algorithm>
+
+#include <omp.h>
+
+#include <Rand.h>
+
+#include "DendriteGrowth.h"
+
+DendriteGrowth::DendriteGrowth(float radius, uint32_t seed, bool only2D, size_t maxBatchSize) :
+    colDist(2*radius),
+    seed(seed),
+    only2D(only2D),
+    maxBatchSize(maxBatchSize),
+    particles{Vec3(0.0f,0.0f,0.0f)},
+    octree{1.0f, Vec3{0.0f,0.0f,0.0f}, 10}
+{
+}
+
+size_t DendriteGrowth::batchSize() const {
+    // few enough that walkers of one batch rarely meet each other's spot
+    return std::clamp<size_t>(particles.size()/64, 1, maxBatchSize);
+}
+
+std::vector<Vec3> DendriteGrowth::walk(size_t count) {
+    std::vector<Vec3> stuck(count);
+    const uint32_t batchSeed = seed;
+    seed += uint32_t(omp_get_max_threads());
+
+    #pragma omp parallel
+    {
+        Random random{batchSeed + uint32_t(omp_get_thread_num())};
+        const auto startpoint = [&]() {
+            while (true) {
+                const Vec3 pos{random.rand11(), random.rand11(), only2D ? 0.0f : random.rand11()};
+                if (octree.minDist(pos) >= colDist) return pos;
+            }
+        };
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int64_t i = 0;i<int64_t(count);++i) {
+            Vec3 current = startpoint();
+            while (true) {
+                const float dist = octree.minDist(current);
+                if (dist < colDist) break;
+                current = current + (only2D ? Vec3::randomPointInDisc(random)
+                                            : Vec3::randomPointInSphere(random)) * dist;
+                if (current.sqlength() > 5*5) current = startpoint();
+            }
+            stuck[size_t(i)] = current;
+        }
+    }
+    return stuck;
+}
+
+void DendriteGrowth::attach(const std::vector<Vec3>& positions) {
+    particles.insert(particles.end(), positions.begin(), positions.end());
+    octree.add(positions);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Vec3.h>
+
+#include "Octree.h"
+
+// Diffusion limited aggregation around a particle at the origin. Walkers
+// start at random positions in [-1,1]^3, or in the xy-plane, and jump by
+// their distance to the aggregate until they come closer than two radii
+// and stick. A walker further than 5 from the origin starts over.
+//
+// Walkers are released in batches that walk in parallel through the
+// aggregate as it was when the batch started, each writing only its own
+// slot, and are attached together afterwards. The batches grow with the
+// aggregate, so a small aggregate still grows one particle at a time.
+class DendriteGrowth {
+public:
+    DendriteGrowth(float radius, uint32_t seed, bool only2D=false, size_t maxBatchSize=1024);
+
+    size_t batchSize() const;
+    // positions where count walkers stuck, does not change the aggregate
+    std::vector<Vec3> walk(size_t count);
+    void attach(const std::vector<Vec3>& positions);
+
+    const std::vector<Vec3>& getParticles() const {return particles;}
+    Octree& getOctree() {return octree;}
+    const Octree& getOctree() const {return octree;}
+
+private:
+    float colDist;
+    uint32_t seed;
+    bool only2D;
+    size_t maxBatchSize;
+    std::vector<Vec3> particles;
+    Octree octree;
+};
@@ -1,258 +1,347 @@
-#include <iostream>
+#include <algorithm>
 #include <limits>
 #include <cmath>
-#include <memory>
 
 #include "Octree.h"
 
+// boxes at depth 32 are below float resolution anyway, the limit bounds
+// the traversal stack
+static const size_t maxSupportedDepth = 32;
+static const uint32_t noBlock = std::numeric_limits<uint32_t>::max();
+static const uint16_t initialWarranty = 20;
+static const float inf = std::numeric_limits<float>::infinity();
 
-OctreeNode::OctreeNode(const Vec3& first, const Vec3& minPos, const Vec3& maxPos) :
-    warranty{20},
-    minPos{minPos},
-    maxPos{maxPos},
-    elements{first},
-    children{nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr}
-{
+static float sq(float x) {return x*x;}
+
+// 0 inside the box, infinite for the empty box of a node without points
+static float boxSqDist(const Vec3& pos, const Vec3& minPos, const Vec3& maxPos) {
+    float sqDist = 0.0f;
+    if (pos.x < minPos.x) sqDist += sq(minPos.x - pos.x); else if (pos.x > maxPos.x) sqDist += sq(pos.x - maxPos.x);
+    if (pos.y < minPos.y) sqDist += sq(minPos.y - pos.y); else if (pos.y > maxPos.y) sqDist += sq(pos.y - maxPos.y);
+    if (pos.z < minPos.z) sqDist += sq(minPos.z - pos.z); else if (pos.z > maxPos.z) sqDist += sq(pos.z - maxPos.z);
+    return sqDist;
 }
 
-OctreeNode::OctreeNode(const Vec3& minPos, const Vec3& maxPos) :
-    warranty{20},
-    minPos{minPos},
-    maxPos{maxPos},
-    elements{},
-    children{nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr,nullptr}
-{
+static void pushColor(std::vector<float>& v, const Vec4& c) {
+    v.push_back(c.r);
+    v.push_back(c.g);
+    v.push_back(c.b);
+    v.push_back(c.a);
 }
 
-Vec3 OctreeNode::computeCenter() const {
-    return maxPos/2.0f+minPos/2.0f;
+Octree::Octree(float size, const Vec3& first, size_t maxElemCount, size_t maxDepth) :
+    maxElemCount(maxElemCount),
+    maxDepth(std::min(maxDepth, maxSupportedDepth)),
+    // room for the point that makes a leaf split, rounded up to eight floats
+    blockSize((maxElemCount/8+1)*8),
+    elementCount(0)
+{
+    nodes.push_back(Node{Vec3(-size,-size,-size), Vec3(size,size,size), Vec3(inf,inf,inf), Vec3(-inf,-inf,-inf), 0, noBlock, noBlock, 0, 0, initialWarranty});
+    add(first);
 }
 
-size_t OctreeNode::subtreeIndex(const Vec3& pos) const {
-    const Vec3 center{computeCenter()};
+uint32_t Octree::subtreeIndex(const Node& node, const Vec3& pos) {
+    const Vec3 center{node.maxPos/2.0f+node.minPos/2.0f};
     return ((pos.z <= center.z) ? 0 : 4) +
            ((pos.y <= center.y) ? 0 : 2) +
            ((pos.x <= center.x) ? 0 : 1);
 }
 
-void OctreeNode::add(const Vec3& pos, size_t maxElemCount, size_t maxDepth) {
-    if (isLeaf()) {
-        elements.push_back(pos);
-        if (maxDepth > 0 && elements.size() > maxElemCount) {
-            split(maxElemCount, maxDepth);
-            warranty = 20;
-        }
+uint32_t Octree::allocateBlock() {
+    uint32_t block;
+    if (freeBlocks.empty()) {
+        block = uint32_t(nextBlock.size());
+        nextBlock.push_back(noBlock);
+        x.resize(x.size()+blockSize);
+        y.resize(y.size()+blockSize);
+        z.resize(z.size()+blockSize);
     } else {
-        size_t index = subtreeIndex(pos);
-        children[index]->add(pos, maxElemCount, maxDepth-1);
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+        nextBlock[block] = noBlock;
     }
+    return block;
 }
 
-void OctreeNode::split(size_t maxElemCount, size_t maxDepth) {
-    // create childen
-    const Vec3 center{computeCenter()};
-    children[0] = std::make_shared<OctreeNode>(minPos,center);
-    children[1] = std::make_shared<OctreeNode>(Vec3(center.x,minPos.y,minPos.z),
-                                               Vec3(maxPos.x,center.y,center.z));
-    children[2] = std::make_shared<OctreeNode>(Vec3(minPos.x,center.y,minPos.z),
-                                               Vec3(center.x,maxPos.y,center.z));
-    children[3] = std::make_shared<OctreeNode>(Vec3(center.x,center.y,minPos.z),
-                                               Vec3(maxPos.x,maxPos.y,center.z));
-
-    children[4] = std::make_shared<OctreeNode>(Vec3(minPos.x,minPos.y,center.z),
-                                               Vec3(center.x,center.y,maxPos.z));
-    children[5] = std::make_shared<OctreeNode>(Vec3(center.x,minPos.y,center.z),
-                                               Vec3(maxPos.x,center.y,maxPos.z));
-    children[6] = std::make_shared<OctreeNode>(Vec3(minPos.x,center.y,center.z),
-                                               Vec3(center.x,maxPos.y,maxPos.z));
-    children[7] = std::make_shared<OctreeNode>(center, maxPos);
-
-    // insert elements into children
-    for (size_t i = 0;i<elements.size();++i) {
-        size_t index = subtreeIndex(elements[i]);
-        children[index]->add(elements[i], maxElemCount, maxDepth-1);
+void Octree::add(const Vec3& pos) {
+    uint32_t index = 0;
+    while (nodes[index].firstChild != 0) {
+        nodes[index].lower = Vec3::minV(nodes[index].lower, pos);
+        nodes[index].upper = Vec3::maxV(nodes[index].upper, pos);
+        index = nodes[index].firstChild + subtreeIndex(nodes[index], pos);
     }
-    
-    elements.clear();
+    insert(index, pos);
+    ++elementCount;
 }
 
-float OctreeNode::minSqDistApprox(const Vec3& pos) const {
-    float minSqDistance = std::numeric_limits<float>::max();
-    if (isLeaf()) {
-        for (const Vec3& e : elements) {
-            minSqDistance = std::min(minSqDistance, (pos-e).sqlength());
-        }
-        return minSqDistance;
-    } else {
-        size_t index = subtreeIndex(pos);
-        if (children[index]->isLeaf() && children[index]->elements.size() == 0) {
-            for (size_t i = 0;i<8;++i) {
-                minSqDistance = std::min(minSqDistance, children[i]->minSqDistApprox(pos));
-            }
-            return minSqDistance;
-        } else {
-            return children[index]->minSqDistApprox(pos);
-        }
+void Octree::add(const std::vector<Vec3>& positions) {
+    for (const Vec3& pos : positions) add(pos);
+}
+
+void Octree::insert(uint32_t index, const Vec3& pos) {
+    const size_t slot = nodes[index].count % blockSize;
+    if (slot == 0) {
+        const uint32_t block = allocateBlock();
+        if (nodes[index].count == 0)
+            nodes[index].firstBlock = block;
+        else
+            nextBlock[nodes[index].lastBlock] = block;
+        nodes[index].lastBlock = block;
     }
+    const size_t offset = nodes[index].lastBlock*blockSize+slot;
+    x[offset] = pos.x;
+    y[offset] = pos.y;
+    z[offset] = pos.z;
+    ++nodes[index].count;
+    nodes[index].lower = Vec3::minV(nodes[index].lower, pos);
+    nodes[index].upper = Vec3::maxV(nodes[index].upper, pos);
+
+    if (nodes[index].count > maxElemCount && nodes[index].depth < maxDepth) split(index);
 }
 
-bool OctreeNode::intersect(const Vec3& pos, float radiusSq, Vec3 minPos, Vec3 maxPos) const {
-    if (pos.x < minPos.x) {
-        radiusSq -= sq(minPos.x - pos.x);
-    } else if (pos.x > maxPos.x) {
-        radiusSq -= sq(maxPos.x - pos.x);
+void Octree::split(uint32_t index) {
+    // a copy, adding the children may grow the pool
+    const Node parent = nodes[index];
+    const Vec3 center{parent.maxPos/2.0f+parent.minPos/2.0f};
+    const uint32_t firstChild = uint32_t(nodes.size());
+    for (uint32_t i = 0;i<8;++i) {
+        const Vec3 minPos{(i & 1) ? center.x : parent.minPos.x,
+                          (i & 2) ? center.y : parent.minPos.y,
+                          (i & 4) ? center.z : parent.minPos.z};
+        const Vec3 maxPos{(i & 1) ? parent.maxPos.x : center.x,
+                          (i & 2) ? parent.maxPos.y : center.y,
+                          (i & 4) ? parent.maxPos.z : center.z};
+        nodes.push_back(Node{minPos, maxPos, Vec3(inf,inf,inf), Vec3(-inf,-inf,-inf), 0, noBlock, noBlock, 0, uint16_t(parent.depth+1), initialWarranty});
     }
-    if (pos.y < minPos.y) {
-        radiusSq -= sq(minPos.y - pos.y);
-    } else if (pos.y > maxPos.y) {
-        radiusSq -= sq(maxPos.y - pos.y);
+    nodes[index].firstChild = firstChild;
+    nodes[index].firstBlock = noBlock;
+    nodes[index].lastBlock = noBlock;
+    nodes[index].count = 0;
+    nodes[index].warranty = initialWarranty;
+
+    size_t remaining = parent.count;
+    for (uint32_t block = parent.firstBlock;remaining > 0;block = nextBlock[block]) {
+        const size_t count = std::min(remaining, blockSize);
+        for (size_t i = 0;i<count;++i) {
+            const size_t offset = block*blockSize+i;
+            const Vec3 pos{x[offset], y[offset], z[offset]};
+            insert(firstChild + subtreeIndex(parent, pos), pos);
+        }
+        remaining -= count;
     }
-    if (pos.z < minPos.z) {
-        radiusSq -= sq(minPos.z - pos.z);
-    } else if (pos.z > maxPos.z) {
-        radiusSq -= sq(maxPos.z - pos.z);
+
+    // release the blocks only now so the children do not write into them
+    remaining = parent.count;
+    for (uint32_t block = parent.firstBlock;remaining > 0;block = nextBlock[block]) {
+        freeBlocks.push_back(block);
+        remaining -= std::min(remaining, blockSize);
     }
-    return radiusSq > 0;
 }
 
-float OctreeNode::minSqDist(const Vec3& pos, float radiusSq) const {
-    if (isLeaf()) {
-        return std::min(radiusSq, minSqDistApprox(pos));
-    } else {
-        for (size_t i = 0;i<8;++i) {
-            if (intersect(pos, radiusSq, children[i]->minPos, children[i]->maxPos))
-                radiusSq = std::min(radiusSq, children[i]->minSqDist(pos, radiusSq));
+// Calls visit for the points of every leaf closer than sqrt(radiusSq) to
+// pos, in blocks. visit may shrink radiusSq to prune the rest of the
+// traversal. The children of a node are visited closest first, so the
+// first points seen are usually close ones and prune most of the tree.
+template <typename Visit>
+void Octree::visitLeaves(const Vec3& pos, const float& radiusSq, Visit visit) const {
+    // every level replaces one node with at most eight
+    struct Entry {
+        uint32_t index;
+        float sqDist;
+    };
+    std::array<Entry, maxSupportedDepth*7+8> stack;
+    size_t top = 0;
+    stack[top++] = Entry{0, boxSqDist(pos, nodes[0].lower, nodes[0].upper)};
+    while (top > 0) {
+        const Entry entry = stack[--top];
+        if (entry.sqDist >= radiusSq) continue;
+        const Node& node = nodes[entry.index];
+
+        if (node.firstChild == 0) {
+            size_t remaining = node.count;
+            for (uint32_t block = node.firstBlock;remaining > 0;block = nextBlock[block]) {
+                const size_t count = std::min(remaining, blockSize);
+                const size_t offset = block*blockSize;
+                visit(x.data()+offset, y.data()+offset, z.data()+offset, count);
+                remaining -= count;
+            }
+        } else {
+            // push the children in range farthest first
+            const size_t first = top;
+            for (uint32_t i = 0;i<8;++i) {
+                const uint32_t child = node.firstChild+i;
+                const float sqDist = boxSqDist(pos, nodes[child].lower, nodes[child].upper);
+                if (sqDist >= radiusSq) continue;
+                size_t j = top++;
+                for (;j>first && stack[j-1].sqDist < sqDist;--j) stack[j] = stack[j-1];
+                stack[j] = Entry{child, sqDist};
+            }
         }
     }
-    return radiusSq;
 }
 
-void OctreeNode::pushColor(std::vector<float>& v, const Vec4& c) {
-    v.push_back(c.r);
-    v.push_back(c.g);
-    v.push_back(c.b);
-    v.push_back(c.a);
+float Octree::minDist(const Vec3& pos) const {
+    float minSqDist = inf;
+    visitLeaves(pos, minSqDist, [&](const float* xs, const float* ys, const float* zs, size_t count) {
+        float blockMin = minSqDist;
+        for (size_t i = 0;i<count;++i) {
+            const float d = sq(xs[i]-pos.x) + sq(ys[i]-pos.y) + sq(zs[i]-pos.z);
+            blockMin = d < blockMin ? d : blockMin;
+        }
+        minSqDist = blockMin;
+    });
+    return sqrt(minSqDist);
 }
 
-std::vector<float> OctreeNode::toTriList() {
-    std::vector<float> result;
-    
-    age();
-    
-    Vec4 color{(warranty == 0) ? Vec4{0.01f,0.01f,0.01f,0.01f} : Vec4{0.1f,0.0f,0.0f,0.1f}};
-        
-    if (!isLeaf()) {
-        const Vec3 center{computeCenter()};
-        
-        // tris 0
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(center.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(center.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(center.z); pushColor(result,color);
-        
-        // tris 1
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(center.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(center.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(center.z); pushColor(result,color);
-
-        // tris 2
-        result.push_back(minPos.x); result.push_back(center.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(center.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(center.y); result.push_back(maxPos.z); pushColor(result,color);
-        
-        // tris 3
-        result.push_back(minPos.x); result.push_back(center.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(center.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(center.y); result.push_back(maxPos.z); pushColor(result,color);
-
-        // tris 4
-        result.push_back(center.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(center.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(center.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        
-        // tris 5
-        result.push_back(center.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(center.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(center.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        
-        for (size_t i = 0;i<children.size();++i) {
-            std::vector<float> b = children[i]->toTriList();
-            result.insert(result.end(), b.begin(), b.end());
-        }
+std::vector<float> Octree::minDists(const std::vector<Vec3>& positions) const {
+    std::vector<float> distances(positions.size());
+    #pragma omp parallel for schedule(dynamic, 64)
+    for (int64_t i = 0;i<int64_t(positions.size());++i) {
+        distances[size_t(i)] = minDist(positions[size_t(i)]);
     }
-    return result;
+    return distances;
 }
 
+std::vector<Vec3> Octree::nearest(const Vec3& pos, size_t k) const {
+    if (k == 0) return {};
 
-std::vector<float> OctreeNode::toLineList() const {
-    std::vector<float> result;
-        
-    Vec4 color{(warranty == 0) ? Vec4{1.0,1.0,1.0,1.0} : Vec4{1.0,0.0,0.0,1.0}};
-    
-    if (!isLeaf()) {
-        // front back
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-
-        // back quad
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        
-        // connections
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
-
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
-        result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
-        
-        for (size_t i = 0;i<children.size();++i) {
-            std::vector<float> b = children[i]->toLineList();
-            result.insert(result.end(), b.begin(), b.end());
+    // max heap of the k closest points so far
+    std::vector<std::pair<float, Vec3>> heap;
+    const auto farther = [](const std::pair<float, Vec3>& a, const std::pair<float, Vec3>& b) {
+        return a.first < b.first;
+    };
+    float radiusSq = inf;
+    visitLeaves(pos, radiusSq, [&](const float* xs, const float* ys, const float* zs, size_t count) {
+        for (size_t i = 0;i<count;++i) {
+            const float d = sq(xs[i]-pos.x) + sq(ys[i]-pos.y) + sq(zs[i]-pos.z);
+            if (heap.size() < k) {
+                heap.push_back({d, Vec3{xs[i], ys[i], zs[i]}});
+                std::push_heap(heap.begin(), heap.end(), farther);
+            } else if (d < heap.front().first) {
+                std::pop_heap(heap.begin(), heap.end(), farther);
+                heap.back() = {d, Vec3{xs[i], ys[i], zs[i]}};
+                std::push_heap(heap.begin(), heap.end(), farther);
+            }
+            if (heap.size() == k) radiusSq = heap.front().first;
         }
-    }
+    });
+
+    std::sort_heap(heap.begin(), heap.end(), farther);
+    std::vector<Vec3> result;
+    result.reserve(heap.size());
+    for (const auto& candidate : heap) result.push_back(candidate.second);
     return result;
 }
 
-Octree::Octree(float size, const Vec3& first, size_t maxElemCount, size_t maxDepth) :
-    maxElemCount(maxElemCount),
-    maxDepth(maxDepth),
-    root{std::make_shared<OctreeNode>(first, Vec3(-size,-size,-size),Vec3(size,size,size))}
-{
+std::vector<Vec3> Octree::withinRadius(const Vec3& pos, float radius) const {
+    std::vector<Vec3> result;
+    const float radiusSq = radius*radius;
+    visitLeaves(pos, radiusSq, [&](const float* xs, const float* ys, const float* zs, size_t count) {
+        for (size_t i = 0;i<count;++i) {
+            if (sq(xs[i]-pos.x) + sq(ys[i]-pos.y) + sq(zs[i]-pos.z) < radiusSq)
+                result.push_back(Vec3{xs[i], ys[i], zs[i]});
+        }
+    });
+    return result;
 }
 
-void Octree::add(const Vec3& pos) {
-    root->add(pos, maxElemCount, maxDepth);
+void Octree::appendTris(uint32_t index, std::vector<float>& result) {
+    Node& node = nodes[index];
+    if (node.warranty > 0) node.warranty--;
+
+    if (node.firstChild == 0) return;
+
+    const Vec4 color{(node.warranty == 0) ? Vec4{0.01f,0.01f,0.01f,0.01f} : Vec4{0.1f,0.0f,0.0f,0.1f}};
+    const Vec3 minPos{node.minPos};
+    const Vec3 maxPos{node.maxPos};
+    const Vec3 center{maxPos/2.0f+minPos/2.0f};
+
+    // tris 0
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(center.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(center.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(center.z); pushColor(result,color);
+
+    // tris 1
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(center.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(center.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(center.z); pushColor(result,color);
+
+    // tris 2
+    result.push_back(minPos.x); result.push_back(center.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(center.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(center.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    // tris 3
+    result.push_back(minPos.x); result.push_back(center.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(center.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(center.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    // tris 4
+    result.push_back(center.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(center.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(center.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    // tris 5
+    result.push_back(center.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(center.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(center.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    const uint32_t firstChild = node.firstChild;
+    for (uint32_t i = 0;i<8;++i) appendTris(firstChild+i, result);
 }
 
-float Octree::minDist(const Vec3& pos) const {
-    if (root->isLeaf()) {
-        return sqrt(root->minSqDistApprox(pos));
-    }
-    float minDist = root->minSqDistApprox(pos);
-    return sqrt(root->minSqDist(pos, minDist));
+void Octree::appendLines(uint32_t index, std::vector<float>& result) const {
+    const Node& node = nodes[index];
+    if (node.firstChild == 0) return;
+
+    const Vec4 color{(node.warranty == 0) ? Vec4{1.0,1.0,1.0,1.0} : Vec4{1.0,0.0,0.0,1.0}};
+    const Vec3& minPos{node.minPos};
+    const Vec3& maxPos{node.maxPos};
+
+    // front back
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+
+    // back quad
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    // connections
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(minPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(minPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(minPos.z); pushColor(result,color);
+    result.push_back(maxPos.x); result.push_back(maxPos.y); result.push_back(maxPos.z); pushColor(result,color);
+
+    for (uint32_t i = 0;i<8;++i) appendLines(node.firstChild+i, result);
 }
 
 std::vector<float> Octree::toTriList() {
-    return root->toTriList();
+    std::vector<float> result;
+    appendTris(0, result);
+    return result;
 }
 
 std::vector<float> Octree::toLineList() const {
-    return root->toLineList();
+    std::vector<float> result;
+    appendLines(0, result);
+    return result;
 }
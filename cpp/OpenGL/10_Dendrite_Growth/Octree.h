@@ -2,59 +2,71 @@
 
 #include <vector>
 #include <array>
-#include <memory>
+#include <cstdint>
 
 #include <Vec3.h>
 #include <Vec4.h>
 
-
-class OctreeNode;
-
-typedef std::shared_ptr<OctreeNode> OctreeNodePtr;
-
-class OctreeNode {
-public:
-    OctreeNode(const Vec3& minPos, const Vec3& maxPos);
-    OctreeNode(const Vec3& first, const Vec3& minPos, const Vec3& maxPos);
-    void add(const Vec3& pos, size_t maxElemCount, size_t maxDepth);
-
-    std::vector<float> toTriList();
-    std::vector<float> toLineList() const;
-
-    float minSqDistApprox(const Vec3& pos) const;
-    float minSqDist(const Vec3& pos, float radiusSq) const;
-    bool isLeaf() const {return children[0] == nullptr;}
-    
-    void age() {if (warranty>0) warranty--;}
-
-private:
-    size_t warranty;
-    Vec3 minPos;
-    Vec3 maxPos;
-    std::vector<Vec3> elements;
-    std::array<OctreeNodePtr, 8> children;
-
-    void split(size_t maxElemCount, size_t maxDepth);
-    size_t subtreeIndex(const Vec3& pos) const;
-    Vec3 computeCenter() const;
-    bool intersect(const Vec3& pos, float radiusSq, Vec3 minPos, Vec3 maxPos) const;
-    static float sq(float x) {return x*x;}
-    static void pushColor(std::vector<float>& v, const Vec4& c);
-
-};
-
+// Octree over points for distance queries. All nodes live in one pool and
+// refer to their eight children, stored next to each other, by index. The
+// points of a leaf are kept in fixed size blocks of x, y and z arrays, a
+// leaf at the maximum depth chains as many blocks as it needs.
+//
+// Queries only read the tree, any number of them may run in parallel as
+// long as no point is added at the same time.
 class Octree {
 public:
     Octree(float size, const Vec3& first, size_t maxElemCount=10, size_t maxDepth=20);
-    
+
     void add(const Vec3& pos);
+    void add(const std::vector<Vec3>& positions);
+    size_t size() const {return elementCount;}
+
     float minDist(const Vec3& pos) const;
-    
+    std::vector<float> minDists(const std::vector<Vec3>& positions) const;
+    // the k closest points, closest first
+    std::vector<Vec3> nearest(const Vec3& pos, size_t k) const;
+    std::vector<Vec3> withinRadius(const Vec3& pos, float radius) const;
+
     std::vector<float> toTriList();
     std::vector<float> toLineList() const;
-        
+
 private:
+    struct Node {
+        Vec3 minPos;
+        Vec3 maxPos;
+        // bounding box of the points below the node, far tighter than
+        // the cell around the thin branches of a dendrite
+        Vec3 lower;
+        Vec3 upper;
+        // first of the eight children, 0 for a leaf as the root is no child
+        uint32_t firstChild;
+        uint32_t firstBlock;
+        uint32_t lastBlock;
+        uint32_t count;
+        uint16_t depth;
+        uint16_t warranty;
+    };
+
     size_t maxElemCount;
     size_t maxDepth;
-    OctreeNodePtr root;
+    size_t blockSize;
+    size_t elementCount;
+    std::vector<Node> nodes;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<uint32_t> nextBlock;
+    std::vector<uint32_t> freeBlocks;
+
+    uint32_t allocateBlock();
+    void insert(uint32_t index, const Vec3& pos);
+    void split(uint32_t index);
+    static uint32_t subtreeIndex(const Node& node, const Vec3& pos);
+
+    template <typename Visit>
+    void visitLeaves(const Vec3& pos, const float& radiusSq, Visit visit) const;
+
+    void appendTris(uint32_t index, std::vector<float>& result);
+    void appendLines(uint32_t index, std::vector<float>& result) const;
 };
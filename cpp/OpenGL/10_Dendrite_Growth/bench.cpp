@@ -0,0 +1,219 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <memory>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <Vec3.h>
+#include <Rand.h>
+
+#include "Octree.h"
+#include "DendriteGrowth.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Grows an aggregate and measures at given sizes how many walkers per
+// second stick to it, releasing batches through DendriteGrowth and one
+// walker at a time through the shared_ptr octree the demo used before.
+// The queries of the octree are checked against brute force.
+//
+//   dendriteBench [walkers] [sizes...]   defaults 10000, 100000 1000000
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+    return std::chrono::duration<double>(t2-t1).count();
+}
+
+// the previous octree, only what the walk needs
+class LegacyNode {
+public:
+    LegacyNode(const Vec3& minPos, const Vec3& maxPos) : minPos{minPos}, maxPos{maxPos} {}
+
+    void add(const Vec3& pos, size_t maxElemCount, size_t maxDepth) {
+        if (isLeaf()) {
+            elements.push_back(pos);
+            if (maxDepth > 0 && elements.size() > maxElemCount) split(maxElemCount, maxDepth);
+        } else {
+            children[subtreeIndex(pos)]->add(pos, maxElemCount, maxDepth-1);
+        }
+    }
+
+    float minSqDistApprox(const Vec3& pos) const {
+        float minSqDistance = std::numeric_limits<float>::max();
+        if (isLeaf()) {
+            for (const Vec3& e : elements) minSqDistance = std::min(minSqDistance, (pos-e).sqlength());
+            return minSqDistance;
+        }
+        const size_t index = subtreeIndex(pos);
+        if (children[index]->isLeaf() && children[index]->elements.size() == 0) {
+            for (size_t i = 0;i<8;++i) minSqDistance = std::min(minSqDistance, children[i]->minSqDistApprox(pos));
+            return minSqDistance;
+        }
+        return children[index]->minSqDistApprox(pos);
+    }
+
+    float minSqDist(const Vec3& pos, float radiusSq) const {
+        if (isLeaf()) return std::min(radiusSq, minSqDistApprox(pos));
+        for (size_t i = 0;i<8;++i) {
+            if (intersect(pos, radiusSq, children[i]->minPos, children[i]->maxPos))
+                radiusSq = std::min(radiusSq, children[i]->minSqDist(pos, radiusSq));
+        }
+        return radiusSq;
+    }
+
+    bool isLeaf() const {return children[0] == nullptr;}
+
+private:
+    Vec3 minPos;
+    Vec3 maxPos;
+    std::vector<Vec3> elements;
+    std::array<std::shared_ptr<LegacyNode>, 8> children;
+
+    size_t subtreeIndex(const Vec3& pos) const {
+        const Vec3 center{maxPos/2.0f+minPos/2.0f};
+        return ((pos.z <= center.z) ? 0 : 4) + ((pos.y <= center.y) ? 0 : 2) + ((pos.x <= center.x) ? 0 : 1);
+    }
+
+    void split(size_t maxElemCount, size_t maxDepth) {
+        const Vec3 center{maxPos/2.0f+minPos/2.0f};
+        for (size_t i = 0;i<8;++i) {
+            children[i] = std::make_shared<LegacyNode>(
+                Vec3((i & 1) ? center.x : minPos.x, (i & 2) ? center.y : minPos.y, (i & 4) ? center.z : minPos.z),
+                Vec3((i & 1) ? maxPos.x : center.x, (i & 2) ? maxPos.y : center.y, (i & 4) ? maxPos.z : center.z));
+        }
+        for (const Vec3& e : elements) children[subtreeIndex(e)]->add(e, maxElemCount, maxDepth-1);
+        elements.clear();
+    }
+
+    static bool intersect(const Vec3& pos, float radiusSq, const Vec3& minPos, const Vec3& maxPos) {
+        for (size_t i = 0;i<3;++i) {
+            if (pos[i] < minPos[i]) radiusSq -= (minPos[i]-pos[i])*(minPos[i]-pos[i]);
+            else if (pos[i] > maxPos[i]) radiusSq -= (maxPos[i]-pos[i])*(maxPos[i]-pos[i]);
+        }
+        return radiusSq > 0;
+    }
+};
+
+struct LegacyOctree {
+    LegacyNode root{Vec3(-1.0f,-1.0f,-1.0f), Vec3(1.0f,1.0f,1.0f)};
+
+    void add(const Vec3& pos) {root.add(pos, 10, 20);}
+    float minDist(const Vec3& pos) const {
+        if (root.isLeaf()) return sqrt(root.minSqDistApprox(pos));
+        return sqrt(root.minSqDist(pos, root.minSqDistApprox(pos)));
+    }
+};
+
+// the walk of the demo, which looked up the distance twice per step
+static void legacyWalk(LegacyOctree& octree, size_t count, float colDist) {
+    const auto checkCollision = [&](const Vec3& pos) {return octree.minDist(pos) < colDist;};
+    const auto startpoint = [&]() {
+        Vec3 current{staticRand.rand11(),staticRand.rand11(),staticRand.rand11()};
+        while (checkCollision(current)) current = Vec3{staticRand.rand11(),staticRand.rand11(),staticRand.rand11()};
+        return current;
+    };
+    for (size_t i = 0;i<count;++i) {
+        Vec3 current = startpoint();
+        while (!checkCollision(current)) {
+            current = current + Vec3::randomPointInSphere()*octree.minDist(current);
+            if (current.sqlength() > 5*5) current = startpoint();
+        }
+        octree.add(current);
+    }
+}
+
+static size_t grow(DendriteGrowth& growth, size_t target) {
+    size_t released = 0;
+    while (growth.getParticles().size() < target) {
+        const size_t count = std::min(growth.batchSize(), target-growth.getParticles().size());
+        growth.attach(growth.walk(count));
+        released += count;
+    }
+    return released;
+}
+
+static bool checkQueries(const Octree& octree, const std::vector<Vec3>& particles, size_t queryCount) {
+    Random random{7};
+    std::vector<Vec3> queries(queryCount);
+    for (Vec3& q : queries) q = Vec3{random.rand11(), random.rand11(), random.rand11()}*0.5f;
+    const std::vector<float> distances = octree.minDists(queries);
+
+    for (size_t i = 0;i<queries.size();++i) {
+        std::vector<std::pair<float, size_t>> sorted(particles.size());
+        for (size_t j = 0;j<particles.size();++j) sorted[j] = {(particles[j]-queries[i]).sqlength(), j};
+        const size_t k = 8;
+        std::partial_sort(sorted.begin(), sorted.begin()+k, sorted.end());
+
+        if (std::abs(distances[i] - std::sqrt(sorted[0].first)) > 1e-6f) return false;
+
+        const std::vector<Vec3> nearest = octree.nearest(queries[i], k);
+        if (nearest.size() != k) return false;
+        for (size_t j = 0;j<k;++j) {
+            if (std::abs((nearest[j]-queries[i]).sqlength() - sorted[j].first) > 1e-6f) return false;
+        }
+
+        const float radius = 2.0f*std::sqrt(sorted[k-1].first);
+        const size_t inside = size_t(std::count_if(sorted.begin(), sorted.end(),
+            [&](const std::pair<float, size_t>& s) {return s.first < radius*radius;}));
+        if (octree.withinRadius(queries[i], radius).size() != inside) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const size_t walkers = argc > 1 ? size_t(atoi(argv[1])) : 10000;
+    std::vector<size_t> sizes;
+    for (int i = 2;i<argc;++i) sizes.push_back(size_t(atoi(argv[i])));
+    if (sizes.empty()) sizes = {100000, 1000000};
+
+    const float radius = 0.001f;
+    DendriteGrowth growth{radius, 42};
+    for (const size_t size : sizes) {
+        auto t1 = Clock::now();
+        const size_t released = grow(growth, size);
+        auto t2 = Clock::now();
+        std::cout << "grown to " << growth.getParticles().size() << " particles, " << std::fixed
+                  << std::setprecision(1) << seconds(t1,t2) << " s, " << std::setprecision(0)
+                  << released/seconds(t1,t2) << " walkers/s on average" << std::endl;
+
+        const bool queriesOK = checkQueries(growth.getOctree(), growth.getParticles(), 200);
+        std::cout << "  octree queries " << (queriesOK ? "match" : "DIFFER FROM") << " brute force" << std::endl;
+        if (!queriesOK) return EXIT_FAILURE;
+
+        LegacyOctree legacy;
+        t1 = Clock::now();
+        for (const Vec3& p : growth.getParticles()) legacy.add(p);
+        t2 = Clock::now();
+        const double legacyBuild = seconds(t1,t2);
+        t1 = Clock::now();
+        Octree octree{1.0f, growth.getParticles()[0], 10};
+        octree.add(std::vector<Vec3>(growth.getParticles().begin()+1, growth.getParticles().end()));
+        t2 = Clock::now();
+        std::cout << "  building: shared_ptr octree " << std::setprecision(3) << legacyBuild
+                  << " s, pooled octree " << seconds(t1,t2) << " s" << std::endl;
+
+        t1 = Clock::now();
+        legacyWalk(legacy, walkers, 2*radius);
+        t2 = Clock::now();
+        const double legacyRate = walkers/seconds(t1,t2);
+
+        t1 = Clock::now();
+        size_t released2 = 0;
+        while (released2 < walkers) {
+            const size_t count = std::min(growth.batchSize(), walkers-released2);
+            growth.attach(growth.walk(count));
+            released2 += count;
+        }
+        t2 = Clock::now();
+        const double rate = walkers/seconds(t1,t2);
+
+        std::cout << "  " << walkers << " walkers at " << size << " particles: shared_ptr octree "
+                  << std::setprecision(0) << legacyRate << " walkers/s, DendriteGrowth " << rate
+                  << " walkers/s, " << std::setprecision(1) << rate/legacyRate << "x" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -8,6 +8,8 @@
 #include <vector>
 #include <string>
 #include <chrono>
+#include <random>
+#include <algorithm>
 typedef std::chrono::high_resolution_clock Clock;
 
 #include <GL/glew.h>  
@@ -19,7 +21,7 @@ typedef std::chrono::high_resolution_clock Clock;
 #include <Rand.h>
 #include <ColorConversion.h>
 
-#include "Octree.h"
+#include "DendriteGrowth.h"
 
 #include <AbstractParticleSystem.h>
 
@@ -78,11 +80,13 @@ private:
 };
 
 
-std::vector<Vec3> fixedParticles{};
 const float radius = 0.001f;
-const float colDist = 2*radius;
 const size_t particleCount = 100000;
-Octree octree{1.0f, Vec3{0.0f,0.0f,0.0f}, 10};
+#ifdef only2D
+DendriteGrowth growth{radius, std::random_device{}(), true};
+#else
+DendriteGrowth growth{radius, std::random_device{}()};
+#endif
 bool rotation{true};
 bool bTerminateSimulation{false};
 std::mutex simulationMutex;
@@ -101,53 +105,15 @@ static void keyCallback(GLFWwindow* window, int key, int scancode, int action, i
     } 
 }
 
-float mindDist(const Vec3& pos) {
-    return octree.minDist(pos);
-}
-
-bool checkCollision(const Vec3& pos) {
-    return mindDist(pos) < colDist;
-}
-
-Vec3 randomWalk(const Vec3& pos) {
-    #ifdef only2D
-        return pos + Vec3::randomPointInDisc()*mindDist(pos);
-    #else
-        return pos + Vec3::randomPointInSphere()*mindDist(pos);
-    #endif
-}
-
-Vec3 genRandomStartpoint() {
-#ifdef only2D
-    Vec3 current{staticRand.rand11(),staticRand.rand11(),0};
-#else
-    Vec3 current{staticRand.rand11(),staticRand.rand11(),staticRand.rand11()};
-#endif
-    while (checkCollision(current))
-        current = genRandomStartpoint();
-    return current;
-}
-
-void initParticles() {
-    fixedParticles.clear();
-    fixedParticles.push_back(Vec3(0.0f,0.0f,0.0f));
-}
-
 void simulate(size_t particleCount) {
-    for (size_t i = 0;i<particleCount;++i) {
-        Vec3 current = genRandomStartpoint();
-        while (!checkCollision(current)) {
-            current = randomWalk(current);
-            if (current.sqlength() > 5*5) {
-                current = genRandomStartpoint();
-            }
-        }
+    while (growth.getParticles().size() < particleCount) {
+        const size_t count = std::min(growth.batchSize(), particleCount-growth.getParticles().size());
+        const std::vector<Vec3> stuck = growth.walk(count);
         simulationMutex.lock();
-        fixedParticles.push_back(current);
-        octree.add(current);
+        growth.attach(stuck);
         simulationMutex.unlock();
 
-        std::cout << i+1 << "/" << particleCount << "\r" << std::flush;
+        std::cout << growth.getParticles().size() << "/" << particleCount << "\r" << std::flush;
         if (bTerminateSimulation) return;
     }
 }
@@ -196,7 +162,7 @@ int main(int argc, char ** argv) {
     octreeFaceArray.connectVertexAttrib(vbOctreeFacePos, prog, "vColor", 4, 3);
 #endif
 
-    SimpleStaticParticleSystem simplePS(fixedParticles, 5);
+    SimpleStaticParticleSystem simplePS(growth.getParticles(), 5);
     simplePS.setColor(RAINBOW_COLOR);
 
     gl.setKeyCallback(keyCallback);
@@ -228,20 +194,20 @@ int main(int argc, char ** argv) {
     
     do {
                 
-        if (fixedParticles.size() < particleCount) {
+        if (growth.getParticles().size() < particleCount) {
             simulationMutex.lock();
 #ifdef showOctree
             octreeLineArray.bind();
-            std::vector<float> data{octree.toLineList()};
+            std::vector<float> data{growth.getOctree().toLineList()};
             lineVertexCount = data.size()/7;
             vbOctreeLinePos.setData(data,7,GL_DYNAMIC_DRAW);
             
             octreeFaceArray.bind();
-            data = octree.toTriList();
+            data = growth.getOctree().toTriList();
             trisVertexCount = data.size()/7;
             vbOctreeFacePos.setData(data,7,GL_DYNAMIC_DRAW);
 #endif
-            simplePS.setData(fixedParticles);
+            simplePS.setData(growth.getParticles());
             simulationMutex.unlock();
         }
         
@@ -265,7 +231,7 @@ int main(int argc, char ** argv) {
         simplePS.render(v*m,p);
 
 #ifdef showOctree
-        if (fixedParticles.size() < particleCount) {
+        if (growth.getParticles().size() < particleCount) {
             glEnable(GL_BLEND);
             glBlendFunc(GL_ONE, GL_ONE);
             glBlendEquation(GL_FUNC_ADD);
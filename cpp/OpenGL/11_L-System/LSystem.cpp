@@ -0,0 +1,360 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <Rand.h>
+#include <ColorConversion.h>
+
+#include "LSystem.h"
+
+// the top of the derivation tree is cut into at least this many items,
+// independent of the thread count so that the output is as well
+static const size_t minItemCount = 4096;
+
+static const double pi = 3.14159265358979323846;
+
+static const int64_t noDepth = std::numeric_limits<int64_t>::lowest();
+
+static uint64_t mix(uint64_t x) {
+  // splitmix64 finalizer
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+  return x ^ (x >> 31);
+}
+
+static uint64_t childSeed(uint64_t seed, size_t index) {
+  return mix(seed + 0x9e3779b97f4a7c15ull*(index+1));
+}
+
+static bool isBalanced(const std::string& s) {
+  int64_t open = 0;
+  for (const char c : s) {
+    if (c == '[') ++open;
+    if (c == ']' && --open < 0) return false;
+  }
+  return open == 0;
+}
+
+std::string Rule::getTarget() const {
+  return getTarget(staticRand.rand01());
+}
+
+const std::string& Rule::getTarget(float p) const {
+  for (const Target& t : targets) {
+      p -= t.probability;
+      if (p <= 0)
+          return t.targetString;
+  }
+
+  return targets.back().targetString;
+}
+
+void Rule::normalize() {
+  float sum = 0.0f;
+  for (const Target& t : targets) {
+      sum += t.probability;
+  }
+  for (Target& t : targets) {
+      t.probability /= sum;
+  }
+}
+
+struct LSystem::Turtle {
+  float x, y, z;
+  float dx, dy, dz;
+  int64_t depth;
+  float cosA, sinA;
+  float maxDepth;
+  // without output only the highest depth of a line is tracked
+  float* out;
+  int64_t maxSeen{0};
+  Vec3 minV{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+  Vec3 maxV{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+  std::vector<std::array<float, 5>> stack;
+  std::vector<int64_t> depthStack;
+
+  void vertex(const Vec3& color) {
+    out[0] = x; out[1] = y; out[2] = z;
+    out[3] = color.r; out[4] = color.g; out[5] = color.b; out[6] = 1.0f;
+    out += 7;
+    minV = Vec3::minV(minV, Vec3{x, y, z});
+    maxV = Vec3::maxV(maxV, Vec3{x, y, z});
+  }
+
+  void apply(char symbol) {
+    switch (symbol) {
+      case 'G' :
+      case 'F' : {
+          if (!out) {
+            maxSeen = std::max(maxSeen, depth);
+            x += dx; y += dy; z += dz;
+            break;
+          }
+          const Vec3 color = ColorConversion::hsvToRgb<float>(Vec3{360.0f * float(depth)/maxDepth,1.0f,1.0f});
+          vertex(color);
+          x += dx; y += dy; z += dz;
+          vertex(color);
+          break;
+      }
+      case '[' :
+          stack.push_back({x, y, z, dx, dy});
+          depthStack.push_back(depth);
+          break;
+      case ']' :
+          if (stack.empty()) break;
+          x = stack.back()[0]; y = stack.back()[1]; z = stack.back()[2];
+          dx = stack.back()[3]; dy = stack.back()[4];
+          depth = depthStack.back();
+          stack.pop_back();
+          depthStack.pop_back();
+          break;
+      case '+' : {
+          const float rx = cosA*dx - sinA*dy;
+          dy = sinA*dx + cosA*dy;
+          dx = rx;
+          depth++;
+          break;
+      }
+      case '-' : {
+          const float rx = cosA*dx + sinA*dy;
+          dy = -sinA*dx + cosA*dy;
+          dx = rx;
+          depth++;
+          break;
+      }
+    }
+  }
+};
+
+LSystem::LSystem(const LShape& shape, size_t iterations, uint64_t seed) :
+  rules{shape.rules},
+  start{shape.start},
+  iterations{iterations},
+  seed{seed},
+  startDir{shape.startDir},
+  angle{shape.angle},
+  balanced{isBalanced(shape.start)},
+  vertexCount{0}
+{
+  // the first rule for a symbol wins, as in executeRules
+  ruleOf.fill(-1);
+  for (size_t r = rules.size();r-- > 0;) ruleOf[uint8_t(rules[r].source)] = int16_t(r);
+
+  deterministic.fill(true);
+  for (const Rule& rule : rules) {
+    if (rule.getTargets().size() > 1) deterministic[uint8_t(rule.source)] = false;
+    for (const Target& t : rule.getTargets()) balanced = balanced && isBalanced(t.targetString);
+  }
+  for (bool changed = true;changed;) {
+    changed = false;
+    for (size_t s = 0;s<256;++s) {
+      if (!deterministic[s] || ruleOf[s] < 0) continue;
+      for (const char c : rules[size_t(ruleOf[s])].getTargets()[0].targetString) {
+        if (!deterministic[uint8_t(c)]) {
+          deterministic[s] = false;
+          changed = true;
+          break;
+        }
+      }
+    }
+  }
+
+  summaries.resize(iterations+1);
+  for (size_t s = 0;s<256;++s) summaries[0][s] = atom(char(s));
+  for (uint32_t i = 1;i<=iterations;++i) {
+    for (size_t s = 0;s<256;++s) {
+      summaries[i][s] = (deterministic[s] && ruleOf[s] >= 0)
+        ? summarize(rules[size_t(ruleOf[s])].getTargets()[0].targetString, i-1, 0)
+        : summaries[0][s];
+    }
+  }
+
+  for (size_t i = 0;i<start.size();++i) items.push_back({start[i], uint32_t(iterations), childSeed(seed, i)});
+  while (items.size() < minItemCount) {
+    std::vector<Item> next;
+    bool expanded = false;
+    for (const Item& item : items) {
+      const int16_t rule = ruleFor(item.symbol, item.iterations);
+      if (rule < 0) {
+        next.push_back(item);
+        continue;
+      }
+      const std::string& target = expand(rule, item.seed);
+      for (size_t i = 0;i<target.size();++i)
+        next.push_back({target[i], item.iterations-1, childSeed(item.seed, i)});
+      expanded = true;
+    }
+    items.swap(next);
+    if (!expanded) break;
+  }
+  if (items.empty()) {
+    throw LException("Evaluated String should not be empty.");
+  }
+
+  itemSummaries.resize(items.size());
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0;i<int64_t(items.size());++i) {
+    const Item& item = items[size_t(i)];
+    itemSummaries[size_t(i)] = summarize(item.symbol, item.iterations, item.seed);
+  }
+  for (const Summary& s : itemSummaries) vertexCount += 2*s.moves;
+}
+
+const std::string& LSystem::expand(int16_t rule, uint64_t seed) const {
+  const Rule& r = rules[size_t(rule)];
+  if (r.getTargets().size() == 1) return r.getTargets()[0].targetString;
+  return r.getTarget(float(mix(seed) >> 40) / float(1ull << 24));
+}
+
+LSystem::Summary LSystem::atom(char symbol) const {
+  switch (symbol) {
+    case 'G' :
+    case 'F' : return {1, 0, 0, 0, 1.0};
+    case '+' : return {0, 1, 1, noDepth, 0.0};
+    case '-' : return {0, -1, 1, noDepth, 0.0};
+    default  : return {0, 0, 0, noDepth, 0.0};
+  }
+}
+
+std::complex<double> LSystem::rotation(int64_t turns) const {
+  const double degrees = std::fmod(double(turns)*double(angle), 360.0);
+  return std::polar(1.0, degrees*pi/180.0);
+}
+
+LSystem::Summary LSystem::compose(const Summary& first, const Summary& second) const {
+  return {first.moves + second.moves,
+          first.turns + second.turns,
+          first.depth + second.depth,
+          second.maxDepth == noDepth ? first.maxDepth : std::max(first.maxDepth, first.depth + second.maxDepth),
+          first.turns == 0 ? first.displacement + second.displacement
+                           : first.displacement + rotation(first.turns)*second.displacement};
+}
+
+LSystem::Summary LSystem::summarize(char symbol, uint32_t iterations, uint64_t seed) const {
+  const int16_t rule = ruleFor(symbol, iterations);
+  if (rule < 0) return summaries[0][uint8_t(symbol)];
+  if (deterministic[uint8_t(symbol)]) return summaries[iterations][uint8_t(symbol)];
+  return summarize(expand(rule, seed), iterations-1, seed);
+}
+
+LSystem::Summary LSystem::summarize(const std::string& target, uint32_t iterations, uint64_t seed) const {
+  Summary result{0, 0, 0, noDepth, 0.0};
+  std::vector<Summary> stack;
+  for (size_t i = 0;i<target.size();++i) {
+    const char c = target[i];
+    if (ruleFor(c, iterations) < 0 && (c == '[' || c == ']')) {
+      // a branch leaves the turtle where it started, only its lines remain
+      if (c == '[') {
+        stack.push_back(result);
+      } else if (!stack.empty()) {
+        result.turns = stack.back().turns;
+        result.depth = stack.back().depth;
+        result.displacement = stack.back().displacement;
+        stack.pop_back();
+      }
+      continue;
+    }
+    result = compose(result, summarize(c, iterations, childSeed(seed, i)));
+  }
+  return result;
+}
+
+std::vector<LSystem::State> LSystem::scan(int64_t& maxDepth) const {
+  const std::complex<double> dir{startDir.x, startDir.y};
+  std::vector<State> states(items.size());
+  std::vector<State> stack;
+  State state{0.0, 0.0, 0, 1};
+  maxDepth = 0;
+  for (size_t i = 0;i<items.size();++i) {
+    states[i] = state;
+    const Item& item = items[i];
+    if (ruleFor(item.symbol, item.iterations) < 0 && (item.symbol == '[' || item.symbol == ']')) {
+      if (item.symbol == '[') {
+        stack.push_back(state);
+      } else if (!stack.empty()) {
+        state = stack.back();
+        stack.pop_back();
+      }
+      continue;
+    }
+    const Summary& s = itemSummaries[i];
+    if (s.maxDepth != noDepth) maxDepth = std::max(maxDepth, state.depth + s.maxDepth);
+    state.pos += dir*rotation(state.turns)*s.displacement;
+    state.z += double(s.moves)*startDir.z;
+    state.turns += s.turns;
+    state.depth += s.depth;
+  }
+  return states;
+}
+
+void LSystem::walk(char symbol, uint32_t iterations, uint64_t seed, Turtle& turtle) const {
+  const int16_t rule = ruleFor(symbol, iterations);
+  if (rule < 0) {
+    turtle.apply(symbol);
+    return;
+  }
+  const std::string& target = expand(rule, seed);
+  for (size_t i = 0;i<target.size();++i) walk(target[i], iterations-1, childSeed(seed, i), turtle);
+}
+
+Mat4 LSystem::generate(float* target) const {
+  if (vertexCount == 0) return Mat4{};
+
+  const float radians = float(angle*pi/180.0);
+  Turtle first{0.0f, 0.0f, 0.0f, startDir.x, startDir.y, startDir.z, 1,
+               std::cos(radians), std::sin(radians), 0.0f, target};
+  Vec3 minV = first.minV;
+  Vec3 maxV = first.maxV;
+
+  if (!balanced) {
+    // no summaries to start items from, one turtle walks them all, first
+    // without output for the highest depth of a line
+    Turtle measure{first};
+    measure.out = nullptr;
+    for (const Item& item : items) walk(item.symbol, item.iterations, item.seed, measure);
+    first.maxDepth = float(measure.maxSeen);
+    for (const Item& item : items) walk(item.symbol, item.iterations, item.seed, first);
+    minV = first.minV;
+    maxV = first.maxV;
+  } else {
+    int64_t maxDepth;
+    const std::vector<State> states = scan(maxDepth);
+    std::vector<size_t> firstVertex(items.size());
+    size_t vertex = 0;
+    for (size_t i = 0;i<items.size();++i) {
+      firstVertex[i] = vertex;
+      vertex += 2*itemSummaries[i].moves;
+    }
+
+#pragma omp parallel
+    {
+      Turtle turtle{first};
+      turtle.maxDepth = float(maxDepth);
+#pragma omp for schedule(dynamic)
+      for (int64_t i = 0;i<int64_t(items.size());++i) {
+        if (itemSummaries[size_t(i)].moves == 0) continue;
+        const State& state = states[size_t(i)];
+        const std::complex<double> dir = std::complex<double>{startDir.x, startDir.y}*rotation(state.turns);
+        turtle.x = float(state.pos.real());
+        turtle.y = float(state.pos.imag());
+        turtle.z = float(state.z);
+        turtle.dx = float(dir.real());
+        turtle.dy = float(dir.imag());
+        turtle.depth = state.depth;
+        turtle.out = target + firstVertex[size_t(i)]*7;
+        const Item& item = items[size_t(i)];
+        walk(item.symbol, item.iterations, item.seed, turtle);
+      }
+#pragma omp critical
+      {
+        minV = Vec3::minV(minV, turtle.minV);
+        maxV = Vec3::maxV(maxV, turtle.maxV);
+      }
+    }
+  }
+
+  const Vec3 sizeV = maxV-minV;
+  const float maxSize = std::max(sizeV.x, std::max(sizeV.y, sizeV.z));
+  const Vec3 center = minV+sizeV/2.0f;
+  return Mat4::scaling(1.0f/maxSize) * Mat4::translation(-center.x, -center.y, -center.z);
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <complex>
+#include <cstdint>
+#include <exception>
+
+#include <Vec3.h>
+#include <Mat4.h>
+
+class LException : public std::exception {
+  public:
+      LException(const std::string& whatStr) : whatStr(whatStr) {}
+      virtual const char* what() const throw() {
+          return whatStr.c_str();
+      }
+  private:
+      std::string whatStr;
+};
+
+
+struct Target {
+  float probability;
+  std::string targetString;
+};
+
+class Rule {
+public:
+  Rule(char source, const std::string& target) :
+      source(source),
+      targets{Target{1.0f,target}}
+  {}
+
+  Rule(char source, const std::vector<Target>& targets) :
+      source(source),
+      targets{targets}
+  {
+      normalize();
+  }
+
+  std::string getTarget() const;
+  // the target for a uniform random p in [0,1)
+  const std::string& getTarget(float p) const;
+  const std::vector<Target>& getTargets() const {return targets;}
+
+  char source;
+
+private:
+  std::vector<Target> targets;
+
+  void normalize();
+};
+
+struct LShape {
+  std::string name;
+  std::string start;
+  std::vector<Rule> rules;
+  float angle;
+  Vec3 startDir;
+};
+
+// Expands an L-system and walks the turtle in one go, without building
+// the string of any iteration. Symbols are expanded recursively, so only
+// one path through the derivation tree is held at a time.
+//
+// For the parallel walk the top of the derivation tree is cut into
+// items. For every symbol and number of remaining iterations the moves,
+// the net turn and the displacement of the turtle are computed once, so
+// a serial scan over the items yields the first vertex and the turtle
+// state of each item, and the items are then walked in parallel straight
+// into the vertex buffer. Symbols reaching stochastic rules are summarized
+// by walking them without output instead.
+//
+// A stochastic rule draws its target from a seed derived from the path to
+// the symbol in the derivation tree, the result does not depend on the
+// number of threads. Rule targets with unbalanced brackets are walked in
+// one piece, extra closing brackets are ignored.
+class LSystem {
+public:
+  LSystem(const LShape& shape, size_t iterations, uint64_t seed=0);
+
+  size_t getVertexCount() const {return vertexCount;}
+
+  // writes getVertexCount() vertices of seven floats, the lines as pairs
+  // of positions with a color from hue by turn depth, and returns the
+  // transformation that centers and scales them into [-0.5,0.5]
+  Mat4 generate(float* target) const;
+
+private:
+  // the effect of expanding a symbol on the turtle, relative to the
+  // direction it starts out with
+  struct Summary {
+    uint64_t moves;
+    int64_t turns;
+    int64_t depth;
+    // highest depth of a line, or lowest() without lines
+    int64_t maxDepth;
+    // where the turtle ends up, as the sum of the directions of the
+    // moves outside of branches
+    std::complex<double> displacement;
+  };
+
+  struct Item {
+    char symbol;
+    uint32_t iterations;
+    uint64_t seed;
+  };
+
+  struct State {
+    std::complex<double> pos;
+    double z;
+    int64_t turns;
+    int64_t depth;
+  };
+
+  std::vector<Rule> rules;
+  std::string start;
+  size_t iterations;
+  uint64_t seed;
+  Vec3 startDir;
+  float angle;
+  std::array<int16_t, 256> ruleOf;
+  std::array<bool, 256> deterministic;
+  bool balanced;
+  // summaries[i][symbol] after i iterations, for deterministic symbols
+  std::vector<std::array<Summary, 256>> summaries;
+
+  std::vector<Item> items;
+  std::vector<Summary> itemSummaries;
+  size_t vertexCount;
+
+  struct Turtle;
+
+  int16_t ruleFor(char symbol, uint32_t iterations) const {
+    return iterations > 0 ? ruleOf[uint8_t(symbol)] : -1;
+  }
+  const std::string& expand(int16_t rule, uint64_t seed) const;
+  Summary summarize(char symbol, uint32_t iterations, uint64_t seed) const;
+  Summary summarize(const std::string& target, uint32_t iterations, uint64_t seed) const;
+  Summary atom(char symbol) const;
+  Summary compose(const Summary& first, const Summary& second) const;
+  std::complex<double> rotation(int64_t turns) const;
+  std::vector<State> scan(int64_t& maxDepth) const;
+  void walk(char symbol, uint32_t iterations, uint64_t seed, Turtle& turtle) const;
+};
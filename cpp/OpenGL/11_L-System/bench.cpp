@@ -0,0 +1,293 @@
+#include <iostream>
+#include <iomanip>
+#include <array>
+#include <vector>
+#include <stack>
+#include <string>
+#include <sstream>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <omp.h>
+
+#include <Vec3.h>
+#include <Mat4.h>
+#include <ColorConversion.h>
+
+#include "LSystem.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Streams the demo's L-systems through LSystem at the highest iteration
+// count that fits a vertex budget and compares with the string rewriting
+// the demo used before at lower counts. Both are checked vertex by vertex
+// against the string walked in double precision. Stochastic systems are
+// checked to give the same vertices with one and four threads. Every
+// system is streamed in a process of its own, so its peak RSS is not
+// hidden by the systems measured before.
+//
+//   lsystemBench [maxVertices] [maxLegacyChars]   defaults 16M and 64M
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+static double peakMB() {
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss/1024.0;
+}
+
+static std::vector<LShape> systems {
+  #include "lsystems.inc"
+  LShape {"koch curve", "F--F--F", {Rule{'F',"F+F--F+F"}}, 60, {1.0f,0.0f,0.0f}},
+  LShape {"fractal plant", "X", {Rule{'X',"F+[[X]-X]-F[-FX]+X"},Rule{'F',"FF"}}, 25, {0.0f,1.0f,0.0f}},
+  LShape {"random plant", "X", {Rule{'X',std::vector<Target>{Target{0.5f,"F[-FX]FX"},Target{0.5f,"F[+FX]FX"}}}}, 15, {0.0f,1.0f,0.0f}}
+};
+
+// executeRules, drawString and the normalization of genTree from main.cpp
+struct Vertex {
+  Vec3 pos;
+  size_t depth;
+};
+
+struct DrawState {
+  Vec3 pos;
+  Vec3 dir;
+  size_t depth;
+};
+
+static std::string executeRules(const std::string& input, const std::vector<Rule>& rules) {
+  std::string result;
+  for (const char symbol : input) {
+      bool found = false;
+      for (const Rule& r : rules) {
+          if (r.source == symbol) {
+              result += r.getTarget();
+              found = true;
+              break;
+          }
+      }
+      if (!found) result.push_back(symbol);
+  }
+  return result;
+}
+
+static std::vector<Vertex> drawString(const std::string& s, float angle, const Vec3& startDir) {
+  std::vector<Vertex> result;
+  std::stack<DrawState> drawStack;
+  DrawState currentState{{0.0f,0.0f,0.0f}, startDir, 1};
+  for (const char symbol : s) {
+      switch (symbol) {
+          case 'G' :
+          case 'F' :
+              result.push_back(Vertex{currentState.pos, currentState.depth});
+              currentState.pos = currentState.pos + currentState.dir;
+              result.push_back(Vertex{currentState.pos, currentState.depth});
+              break;
+          case '[' :
+              drawStack.push(DrawState{currentState});
+              break;
+          case ']' :
+              currentState = drawStack.top();
+              drawStack.pop();
+              break;
+          case '+' :
+              currentState.dir = Mat4::rotationZ(-angle)*currentState.dir;
+              currentState.depth++;
+              break;
+          case '-' :
+              currentState.dir = Mat4::rotationZ(angle)*currentState.dir;
+              currentState.depth++;
+              break;
+      }
+  }
+  return result;
+}
+
+static std::vector<float> legacyTree(size_t iterations, const LShape& shape, size_t& peakChars,
+                                     std::string& target) {
+  target = shape.start;
+  peakChars = target.size();
+  for (size_t i = 0;i<iterations;++i) {
+      std::string next = executeRules(target, shape.rules);
+      peakChars = std::max(peakChars, target.size() + next.size());
+      target = std::move(next);
+  }
+  const std::vector<Vertex> structure = drawString(target, shape.angle, shape.startDir);
+  if (structure.empty()) return {};
+
+  Vec3 minV = structure[0].pos;
+  Vec3 maxV = structure[0].pos;
+  size_t maxDepth = 0;
+  for (const Vertex& p : structure) {
+      minV = Vec3::minV(minV, p.pos);
+      maxV = Vec3::maxV(maxV, p.pos);
+      maxDepth = std::max(maxDepth,p.depth);
+  }
+  const Vec3 sizeV = maxV-minV;
+  float maxSize = std::max(sizeV.x, std::max(sizeV.y, sizeV.z));
+
+  std::vector<float> data{};
+  for (const Vertex& p : structure) {
+      data.push_back((p.pos.x-minV.x-sizeV.x/2)/maxSize);
+      data.push_back((p.pos.y-minV.y-sizeV.y/2)/maxSize);
+      data.push_back((p.pos.z-minV.z-sizeV.z/2)/maxSize);
+      Vec3 color = ColorConversion::hsvToRgb<float>(Vec3{360.0f * p.depth/maxDepth,1.0f,1.0f});
+      data.push_back(color.r);
+      data.push_back(color.g);
+      data.push_back(color.b);
+      data.push_back(1.0f);
+  }
+  return data;
+}
+
+static bool deterministic(const LShape& shape) {
+  for (const Rule& r : shape.rules) {
+    if (r.getTargets().size() > 1) return false;
+  }
+  return true;
+}
+
+// the vertices of the string in double precision with exact rotations,
+// normalized like genTree, the legacy float matrices drift after many turns
+static std::vector<double> exactTree(const std::string& s, const LShape& shape) {
+  std::vector<double> result;
+  std::vector<std::array<double, 3>> stack;
+  double x = 0, y = 0, turns = 0;
+  for (const char symbol : s) {
+    switch (symbol) {
+      case 'G' :
+      case 'F' : {
+        const double a = std::fmod(turns*double(shape.angle), 360.0)*3.14159265358979323846/180.0;
+        result.push_back(x);
+        result.push_back(y);
+        x += std::cos(a)*shape.startDir.x - std::sin(a)*shape.startDir.y;
+        y += std::sin(a)*shape.startDir.x + std::cos(a)*shape.startDir.y;
+        result.push_back(x);
+        result.push_back(y);
+        break;
+      }
+      case '[' : stack.push_back({x, y, turns}); break;
+      case ']' : x = stack.back()[0]; y = stack.back()[1]; turns = stack.back()[2]; stack.pop_back(); break;
+      case '+' : turns += 1; break;
+      case '-' : turns -= 1; break;
+    }
+  }
+  double minX = result[0], maxX = result[0], minY = result[1], maxY = result[1];
+  for (size_t i = 0;i<result.size();i += 2) {
+    minX = std::min(minX, result[i]);
+    maxX = std::max(maxX, result[i]);
+    minY = std::min(minY, result[i+1]);
+    maxY = std::max(maxY, result[i+1]);
+  }
+  const double maxSize = std::max(maxX-minX, maxY-minY);
+  for (size_t i = 0;i<result.size();i += 2) {
+    result[i] = (result[i]-minX-(maxX-minX)/2)/maxSize;
+    result[i+1] = (result[i+1]-minY-(maxY-minY)/2)/maxSize;
+  }
+  return result;
+}
+
+// largest distance of the normalized vertices to the exact ones
+static float deviation(const std::vector<double>& exact, const std::vector<float>& data,
+                       const Mat4& normalization) {
+  float maxError = 0.0f;
+  for (size_t i = 0;i<data.size()/7;++i) {
+    const Vec3 p = normalization * Vec3{data[i*7], data[i*7+1], data[i*7+2]};
+    maxError = std::max(maxError, float(std::max(std::abs(p.x-exact[i*2]), std::abs(p.y-exact[i*2+1]))));
+  }
+  return maxError;
+}
+
+// streams the system at the highest iteration count below maxVertices,
+// called in a fresh process by main
+static int streamSystem(const LShape& shape, size_t maxVertices) {
+  size_t iterations = 1;
+  while (iterations < 40 && LSystem{shape, iterations+1}.getVertexCount() <= maxVertices) ++iterations;
+
+  auto t1 = Clock::now();
+  const LSystem system{shape, iterations};
+  std::vector<float> data(system.getVertexCount()*7);
+  system.generate(data.data());
+  auto t2 = Clock::now();
+  std::cout << "  " << std::left << std::setw(48) << shape.name << std::right << std::setw(3) << iterations
+            << " iterations " << std::setw(9) << system.getVertexCount() << " vertices "
+            << std::fixed << std::setprecision(1) << std::setw(7) << system.getVertexCount()/seconds(t1,t2)/1e6
+            << " M vertices/s, peak RSS " << std::setprecision(0) << peakMB() << " MB" << std::endl;
+
+  if (!deterministic(shape)) {
+    omp_set_num_threads(4);
+    std::vector<float> parallel(data.size());
+    system.generate(parallel.data());
+    omp_set_num_threads(1);
+    std::vector<float> serial(data.size());
+    system.generate(serial.data());
+    const bool same = std::memcmp(parallel.data(), serial.data(), data.size()*sizeof(float)) == 0;
+    std::cout << "    1 and 4 threads give " << (same ? "the same" : "DIFFERENT") << " vertices" << std::endl;
+    if (!same) return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+  // lsystemBench --stream index maxVertices, one system of streamSystem
+  if (argc > 3 && std::string(argv[1]) == "--stream") {
+    return streamSystem(systems.at(size_t(atoi(argv[2]))), size_t(atof(argv[3])));
+  }
+
+  const size_t maxVertices = argc > 1 ? size_t(atof(argv[1])) : size_t(16) << 20;
+  const size_t maxLegacyChars = argc > 2 ? size_t(atof(argv[2])) : size_t(64) << 20;
+
+  std::cout << "streaming, highest iteration count below " << maxVertices << " vertices" << std::endl;
+  for (size_t i = 0;i<systems.size();++i) {
+    std::stringstream command;
+    command << "\"" << argv[0] << "\" --stream " << i << " " << maxVertices;
+    if (std::system(command.str().c_str()) != 0) return EXIT_FAILURE;
+  }
+
+  std::cout << "string rewriting, highest iteration count below " << maxLegacyChars << " characters" << std::endl;
+  for (const LShape& shape : systems) {
+    if (!deterministic(shape)) continue;
+    size_t iterations = 1;
+    size_t peakChars = 0;
+    while (iterations < 40) {
+      std::string s = shape.start;
+      for (size_t i = 0;i<=iterations && s.size() <= maxLegacyChars;++i) s = executeRules(s, shape.rules);
+      if (s.size() > maxLegacyChars) break;
+      ++iterations;
+    }
+
+    std::string target;
+    auto t1 = Clock::now();
+    const std::vector<float> legacy = legacyTree(iterations, shape, peakChars, target);
+    auto t2 = Clock::now();
+    const double legacyTime = seconds(t1,t2);
+
+    t1 = Clock::now();
+    const LSystem system{shape, iterations};
+    std::vector<float> data(system.getVertexCount()*7);
+    const Mat4 normalization = system.generate(data.data());
+    t2 = Clock::now();
+    const double time = seconds(t1,t2);
+
+    std::cout << "  " << std::left << std::setw(48) << shape.name << std::right << std::setw(3) << iterations
+              << " iterations " << std::setw(9) << legacy.size()/7 << " vertices, strings "
+              << std::fixed << std::setprecision(0) << std::setw(5) << peakChars/1048576.0 << " MB, "
+              << std::setprecision(1) << std::setw(5) << legacy.size()/7/legacyTime/1e6 << " vs "
+              << std::setw(6) << data.size()/7/time/1e6 << " M vertices/s";
+    if (legacy.size() != data.size()) {
+      std::cout << ", DIFFERENT vertex count " << data.size()/7 << std::endl;
+      return EXIT_FAILURE;
+    }
+    const std::vector<double> exact = exactTree(target, shape);
+    const float error = deviation(exact, data, normalization);
+    const float legacyError = deviation(exact, legacy, Mat4{});
+    std::cout << ", deviation " << std::scientific << std::setprecision(1) << legacyError << " vs "
+              << error << std::fixed << std::endl;
+    if (error > 1e-3f) return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <stack>
 #include <string>
 #include <chrono>
 typedef std::chrono::high_resolution_clock Clock;
@@ -13,93 +12,13 @@ typedef std::chrono::high_resolution_clock Clock;
 #include <Vec2.h>
 #include <Mat4.h>
 #include <Rand.h>
-#include <ColorConversion.h>
 
 #include "GLProgram.h"
 #include "GLBuffer.h"
 #include "GLArray.h"
 #include "GLTexture2D.h"
 
-#include <exception>
-
-class LException : public std::exception {
-  public:
-      LException(const std::string& whatStr) : whatStr(whatStr) {}
-      virtual const char* what() const throw() {
-          return whatStr.c_str();
-      }
-  private:
-      std::string whatStr;
-};
-
-
-struct Target {
-  float probability;
-  std::string targetString;
-};
-
-class Rule {
-public:
-  Rule(char source, const std::string& target) :
-      source(source),
-      targets{Target{1.0f,target}}
-  {}
-
-  Rule(char source, const std::vector<Target>& targets) :
-      source(source),
-      targets{targets}
-  {
-      normalize();
-  }
-
-  std::string getTarget() const {
-      float p = staticRand.rand01();
-      
-      for (const Target& t : targets) {
-          p -= t.probability;
-          if (p <= 0)
-              return t.targetString;
-      }
-      
-      return targets.back().targetString;
-  }
-  
-  char source;
-  
-private:
-  std::vector<Target> targets;
-  
-  void normalize() {
-      float sum = 0.0f;
-      for (const Target& t : targets) {
-          sum += t.probability;
-      }
-      for (Target& t : targets) {
-          t.probability /= sum;
-      }
-
-  }
-};
-
-struct DrawState {
-  Vec3 pos;
-  Vec3 dir;
-  size_t depth;
-};
-
-
-struct Vertex {
-  Vec3 pos;
-  size_t depth;
-};
-
-struct LShape {
-  std::string name;
-  std::string start;
-  std::vector<Rule> rules;
-  float angle;
-  Vec3 startDir;
-};
+#include "LSystem.h"
 
 std::vector<LShape> systems {
   #include "lsystems.inc"
@@ -115,107 +34,6 @@ std::vector<LShape> systems {
 size_t currentSystem = 0;
 
 
-std::string executeRules(const std::string& input, const std::vector<Rule>& rules) {
-  
-  std::string result;
-  
-  for (const char symbol : input) {
-      bool found = false;
-      for (const Rule& r : rules) {
-          if (r.source == symbol) {
-              result += r.getTarget();
-              found = true;
-              break;
-          }
-      }
-      if (!found) result.push_back(symbol);
-  }
-  
-  return result;
-}
-
-const std::vector<Vertex> drawString(const std::string& s, float angle, const Vec3& startDir) {
-  std::vector<Vertex> result;
-  std::stack<DrawState> drawStack;
-      
-  DrawState currentState{{0.0f,0.0f,0.0f}, startDir, 1};
-  
-  for (const char symbol : s) {
-      switch (symbol) {
-          case 'G' :
-          case 'F' :
-              result.push_back(Vertex{currentState.pos, currentState.depth});
-              currentState.pos = currentState.pos + currentState.dir;
-              result.push_back(Vertex{currentState.pos, currentState.depth});
-              break;
-          case '[' :
-              drawStack.push(DrawState{currentState});
-              break;
-          case ']' :
-              currentState = drawStack.top();
-              drawStack.pop();
-              break;
-          case '+' :
-              currentState.dir = Mat4::rotationZ(-angle)*currentState.dir;
-              currentState.depth++;
-              break;
-          case '-' :
-              currentState.dir = Mat4::rotationZ(angle)*currentState.dir;
-              currentState.depth++;
-              break;
-      }
-  }
-  
-  return result;
-}
-
-std::vector<float> genTree(size_t iterations, const LShape& currenShape) {
-
-  std::string target = currenShape.start;
-  for (size_t i = 0;i<iterations;++i) {
-      target = executeRules(target, currenShape.rules);
-  }
-  
-  if (target.empty()) {
-      throw LException("Evaluated String should not be empty.");
-  }
-  
-  const std::vector<Vertex> structure = drawString(target, currenShape.angle, currenShape.startDir);
-  
-  if (structure.empty()) {
-      return {};
-  }
-  
-  Vec3 minV = structure[0].pos;
-  Vec3 maxV = structure[0].pos;
-  size_t maxDepth = 0;
-  
-  for (const Vertex& p : structure) {
-      minV = Vec3::minV(minV, p.pos);
-      maxV = Vec3::maxV(maxV, p.pos);
-      maxDepth = std::max(maxDepth,p.depth);
-  }
-  
-  const Vec3 sizeV = maxV-minV;
-  float maxSize = std::max(sizeV.x, std::max(sizeV.y, sizeV.z));
-  
-  std::vector<float> data{};
-  for (const Vertex& p : structure) {
-      data.push_back((p.pos.x-minV.x-sizeV.x/2)/maxSize);
-      data.push_back((p.pos.y-minV.y-sizeV.y/2)/maxSize);
-      data.push_back((p.pos.z-minV.z-sizeV.z/2)/maxSize);
-              
-      Vec3 color = ColorConversion::hsvToRgb<float>(Vec3{360.0f * p.depth/maxDepth,1.0f,1.0f});
-      data.push_back(color.r);
-      data.push_back(color.g);
-      data.push_back(color.b);
-      data.push_back(1.0f);
-  }
-  
-  return data;
-}
-
-
 static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
   if (action == GLFW_REPEAT || action == GLFW_PRESS) {
       switch (key) {
@@ -336,6 +154,7 @@ int main(int argc, char ** argv) {
   size_t iterations=0;
   size_t lastIterations=1;
   size_t lastSystem=1;
+  Mat4 normalization;
   
   do {
     dim = Dimensions{gl.getFramebufferSize()};
@@ -348,7 +167,6 @@ int main(int argc, char ** argv) {
                    Mat4::scaling(scale, scale, scale)};
 
     prog.enable();
-    prog.setUniform(mvpLocation, mvp);
 
     lineArray.bind();
     
@@ -357,12 +175,16 @@ int main(int argc, char ** argv) {
     }
     
     if (iterations != lastIterations) {
-        const std::vector<float> data{genTree(iterations, systems[currentSystem])};
+        const LSystem system{systems[currentSystem], iterations};
         lastSystem = currentSystem;
-        vbLinePos.setData(data,7,GL_DYNAMIC_DRAW);
+        vertexCount = GLsizei(system.getVertexCount());
+        if (vertexCount > 0) {
+            normalization = system.generate(vbLinePos.map(system.getVertexCount()*7, 7));
+            vbLinePos.unmap();
+        }
         lastIterations = iterations;
-        vertexCount = GLsizei(data.size()/7);
     }
+    prog.setUniform(mvpLocation, mvp*normalization);
     
     
     glDrawArrays(GL_LINES, 0, vertexCount );
@@ -0,0 +1,191 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <OBJFile.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Writes a height field of textured, lit triangles in the usual exporter
+// layout, f v/vt/vn, and loads it with the getline/stringstream loader the
+// demos used before, with OBJFile while writing the .objcache and with
+// OBJFile from that cache. All three meshes must agree. A small file of
+// quads and relative indices checks the polygon support.
+//
+//   objBench [triangles in millions]   default 2
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// the previous loader, it only understood "f a b c"
+struct LegacyOBJ {
+  typedef std::array<size_t, 3> IndexType;
+  std::vector<IndexType> indices;
+  std::vector<Vec3> vertices;
+  std::vector<Vec3> normals;
+
+  LegacyOBJ(const std::string& filename) {
+    std::ifstream f(filename);
+    std::string line;
+    while (std::getline(f, line)) {
+      trim(line);
+      if (line.size() < 2) continue;
+      if (line[0] == 'f') {
+        std::vector<std::string> face = tokenize(line,1);
+        if (face.size() != 3) continue;
+        indices.push_back({fromStr<size_t>(face[0])-1,fromStr<size_t>(face[1])-1,fromStr<size_t>(face[2])-1});
+      } else if (line[0] == 'v') {
+        if (line[1] == 'n') {
+          std::vector<std::string> normal = tokenize(line,2);
+          if (normal.size() != 3) continue;
+          normals.push_back({fromStr<float>(normal[0]),fromStr<float>(normal[1]),fromStr<float>(normal[2])});
+        } else if (line[1] == ' ') {
+          std::vector<std::string> vertex = tokenize(line,1);
+          if (vertex.size() != 3) continue;
+          vertices.push_back({fromStr<float>(vertex[0]),fromStr<float>(vertex[1]),fromStr<float>(vertex[2])});
+        }
+      }
+    }
+    normals.resize(vertices.size());
+    for (const IndexType& triangle : indices) {
+      const Vec3 normal = Vec3::normalize(Vec3::cross(vertices[triangle[1]]-vertices[triangle[0]],
+                                                      vertices[triangle[2]]-vertices[triangle[0]]));
+      for (size_t i = 0;i<3;++i) normals[triangle[i]] = normal;
+    }
+  }
+
+  static void trim(std::string& s) {
+    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {return !std::isspace(ch);}));
+    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {return !std::isspace(ch);}).base(), s.end());
+  }
+
+  static std::vector<std::string> tokenize(const std::string& str, size_t startpos) {
+    std::vector<std::string> elements;
+    std::string buf;
+    std::stringstream ss(str.substr(startpos));
+    while (ss >> buf) elements.push_back(buf);
+    return elements;
+  }
+
+  // "12/5/12" reads as 12 like operator>> did
+  template <typename T> static T fromStr(const std::string& str) {
+    T result;
+    std::stringstream s(str);
+    s >> result;
+    return result;
+  }
+};
+
+static size_t writeHeightField(const std::string& filename, size_t triangles) {
+  const size_t n = std::max<size_t>(1, size_t(std::sqrt(triangles/2.0)));
+  std::ofstream f(filename);
+  f << "# height field " << n << "x" << n << "\n" << std::fixed << std::setprecision(6);
+  for (size_t y = 0;y<=n;++y) {
+    for (size_t x = 0;x<=n;++x) {
+      const float u = float(x)/n;
+      const float v = float(y)/n;
+      f << "v " << u << " " << 0.1f*std::sin(20.0f*u)*std::cos(20.0f*v) << " " << v << "\n";
+    }
+  }
+  for (size_t y = 0;y<=n;++y)
+    for (size_t x = 0;x<=n;++x) f << "vt " << float(x)/n << " " << float(y)/n << "\n";
+  for (size_t y = 0;y<=n;++y)
+    for (size_t x = 0;x<=n;++x) f << "vn 0.000000 1.000000 0.000000\n";
+  f << "g surface\ns 1\n";
+  for (size_t y = 0;y<n;++y) {
+    for (size_t x = 0;x<n;++x) {
+      const size_t a = y*(n+1)+x+1;
+      const size_t b = a+1;
+      const size_t c = a+n+1;
+      const size_t d = c+1;
+      f << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " "
+        << d << "/" << d << "/" << d << "\n";
+      f << "f " << a << "/" << a << "/" << a << " " << d << "/" << d << "/" << d << " "
+        << c << "/" << c << "/" << c << "\n";
+    }
+  }
+  return 2*n*n;
+}
+
+template <typename A, typename B>
+static bool sameMesh(const A& a, const B& b) {
+  if (a.vertices.size() != b.vertices.size() || a.indices.size() != b.indices.size() ||
+      a.normals.size() != b.normals.size()) return false;
+  for (size_t i = 0;i<a.indices.size();++i)
+    if (a.indices[i] != b.indices[i]) return false;
+  for (size_t i = 0;i<a.vertices.size();++i) {
+    if ((a.vertices[i]-b.vertices[i]).length() > 1e-6f) return false;
+    if ((a.normals[i]-b.normals[i]).length() > 1e-5f) return false;
+  }
+  return true;
+}
+
+static bool checkPolygons() {
+  const std::string filename = "objBench-polygons.obj";
+  std::ofstream f(filename);
+  f << "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+       "f 1 2 3 4\n"
+       "v 0 0 1\nv 1 0 1\nv 1 1 1\nv 0 1 1\nv 0.5 1.5 1\n"
+       "f -5//1 -4//1 -3//1 -1//1 -2//1\n";
+  f.close();
+  const OBJFile obj{filename, false, false};
+  std::remove(filename.c_str());
+  const std::vector<OBJFile::IndexType> expected{{0,1,2},{0,2,3},{4,5,6},{4,6,8},{4,8,7}};
+  return obj.vertices.size() == 9 && obj.indices == expected;
+}
+
+int main(int argc, char** argv) {
+  const size_t requested = size_t((argc > 1 ? atof(argv[1]) : 2.0) * 1000000);
+  const std::string filename = "objBench.obj";
+  const std::string cacheFilename = filename + ".objcache";
+
+  std::remove(cacheFilename.c_str());
+  const size_t triangles = writeHeightField(filename, requested);
+  std::ifstream sizeCheck(filename, std::ios::binary | std::ios::ate);
+  std::cout << triangles << " triangles, " << std::setprecision(1) << std::fixed
+            << sizeCheck.tellg()/1048576.0 << " MiB of OBJ" << std::endl;
+
+  auto t1 = Clock::now();
+  const LegacyOBJ legacy{filename};
+  auto t2 = Clock::now();
+  const double legacyTime = seconds(t1,t2);
+
+  t1 = Clock::now();
+  const OBJFile parsed{filename};
+  t2 = Clock::now();
+  const double parseTime = seconds(t1,t2);
+
+  t1 = Clock::now();
+  const OBJFile cached{filename};
+  t2 = Clock::now();
+  const double cacheTime = seconds(t1,t2);
+
+  std::cout << std::setprecision(3)
+            << "      getline loader: " << legacyTime << " s" << std::endl
+            << "   OBJFile + caching: " << parseTime << " s, " << std::setprecision(1)
+            << legacyTime/parseTime << "x" << std::endl << std::setprecision(3)
+            << "  OBJFile from cache: " << cacheTime << " s, " << std::setprecision(1)
+            << legacyTime/cacheTime << "x" << std::endl;
+
+  const bool parsedOK = sameMesh(legacy, parsed);
+  const bool cachedOK = sameMesh(legacy, cached);
+  const bool polygonsOK = checkPolygons();
+  std::cout << "parsed mesh " << (parsedOK ? "matches" : "DIFFERS") << ", cached mesh "
+            << (cachedOK ? "matches" : "DIFFERS") << ", polygons " << (polygonsOK ? "OK" : "WRONG")
+            << std::endl;
+
+  std::remove(filename.c_str());
+  std::remove(cacheFilename.c_str());
+  return parsedOK && cachedOK && polygonsOK ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,328 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "BVH.h"
+
+BVH::AABB::AABB() :
+	minPos{std::numeric_limits<float>::max(),std::numeric_limits<float>::max(),std::numeric_limits<float>::max()},
+	maxPos{std::numeric_limits<float>::lowest(),std::numeric_limits<float>::lowest(),std::numeric_limits<float>::lowest()}
+{
+}
+
+void BVH::AABB::grow(const AABB& other) {
+	for (size_t a = 0;a<3;++a) {
+		minPos[a] = std::min(minPos[a], other.minPos[a]);
+		maxPos[a] = std::max(maxPos[a], other.maxPos[a]);
+	}
+}
+
+void BVH::AABB::grow(const std::array<float,3>& p) {
+	for (size_t a = 0;a<3;++a) {
+		minPos[a] = std::min(minPos[a], p[a]);
+		maxPos[a] = std::max(maxPos[a], p[a]);
+	}
+}
+
+float BVH::AABB::area() const {
+	const float ex{maxPos[0]-minPos[0]};
+	const float ey{maxPos[1]-minPos[1]};
+	const float ez{maxPos[2]-minPos[2]};
+	if (ex < 0 || ey < 0 || ez < 0) return 0.0f;
+	return ex*ey + ey*ez + ez*ex;
+}
+
+BVH::BVH() :
+	dirty{false}
+{
+}
+
+BVH::BVH(const std::vector<std::shared_ptr<const Sphere>>& spheres) :
+	dirty{false}
+{
+	for (const auto& sphere : spheres) add(*sphere);
+	build();
+}
+
+void BVH::add(const Sphere& sphere) {
+	add(sphere.getCenter(), sphere.getRadius(), sphere.getMaterial());
+}
+
+void BVH::add(const Vec3& center, const float r, const std::shared_ptr<Material> material) {
+	auto known = materialLookup.find(material.get());
+	uint32_t index;
+	if (known == materialLookup.end()) {
+		index = uint32_t(materials.size());
+		materials.push_back(material);
+		materialLookup[material.get()] = index;
+	} else {
+		index = known->second;
+	}
+
+	centerX.push_back(center.x);
+	centerY.push_back(center.y);
+	centerZ.push_back(center.z);
+	radius.push_back(r);
+	materialIndex.push_back(index);
+	dirty = true;
+}
+
+BVH::AABB BVH::primitiveBounds(const uint32_t i) const {
+	AABB box;
+	box.minPos = {centerX[i]-radius[i], centerY[i]-radius[i], centerZ[i]-radius[i]};
+	box.maxPos = {centerX[i]+radius[i], centerY[i]+radius[i], centerZ[i]+radius[i]};
+	return box;
+}
+
+void BVH::build() {
+	nodes.clear();
+	dirty = false;
+	if (radius.empty()) return;
+
+	const uint32_t count{uint32_t(radius.size())};
+	std::vector<uint32_t> indices(count);
+	centroids.resize(count);
+	for (uint32_t i = 0;i<count;++i) {
+		indices[i] = i;
+		centroids[i] = {centerX[i], centerY[i], centerZ[i]};
+	}
+
+	// a binary tree over n leaves never has more than 2n-1 nodes
+	nodes.reserve(2*size_t(count)-1);
+	nodes.push_back(Node{{},0,{},count});
+	updateNodeBounds(nodes[0], indices);
+	subdivide(0, indices, 0);
+	nodes.shrink_to_fit();
+
+	reorder(indices);
+	centroids.clear();
+	centroids.shrink_to_fit();
+}
+
+void BVH::updateNodeBounds(Node& node, const std::vector<uint32_t>& indices) const {
+	AABB box;
+	for (uint32_t i = 0;i<node.count;++i) {
+		box.grow(primitiveBounds(indices[node.leftFirst+i]));
+	}
+	node.minPos = box.minPos;
+	node.maxPos = box.maxPos;
+}
+
+uint32_t BVH::binIndex(const Split& split, const float centroid) {
+	const uint32_t bin{uint32_t((centroid - split.centroidMin) * split.scale)};
+	return std::min(bin, binCount-1);
+}
+
+std::optional<BVH::Split> BVH::findBestSplit(const Node& node, const std::vector<uint32_t>& indices) const {
+	std::optional<Split> best{};
+
+	for (uint32_t axis = 0;axis<3;++axis) {
+		float centroidMin{std::numeric_limits<float>::max()};
+		float centroidMax{std::numeric_limits<float>::lowest()};
+		for (uint32_t i = 0;i<node.count;++i) {
+			const float c{centroids[indices[node.leftFirst+i]][axis]};
+			centroidMin = std::min(centroidMin, c);
+			centroidMax = std::max(centroidMax, c);
+		}
+		if (centroidMin == centroidMax) continue;
+
+		Split candidate{axis, 0, 0.0f, centroidMin, binCount / (centroidMax - centroidMin)};
+
+		std::array<AABB, binCount> binBounds;
+		std::array<uint32_t, binCount> binCounts{};
+		for (uint32_t i = 0;i<node.count;++i) {
+			const uint32_t prim{indices[node.leftFirst+i]};
+			const uint32_t bin{binIndex(candidate, centroids[prim][axis])};
+			binCounts[bin]++;
+			binBounds[bin].grow(primitiveBounds(prim));
+		}
+
+		// sweep from both sides to get the area and count left and right
+		// of each of the binCount-1 candidate planes
+		std::array<float, binCount-1> leftArea, rightArea;
+		std::array<uint32_t, binCount-1> leftCount, rightCount;
+		AABB leftBox, rightBox;
+		uint32_t leftSum{0}, rightSum{0};
+		for (uint32_t i = 0;i<binCount-1;++i) {
+			leftSum += binCounts[i];
+			leftCount[i] = leftSum;
+			leftBox.grow(binBounds[i]);
+			leftArea[i] = leftBox.area();
+
+			rightSum += binCounts[binCount-1-i];
+			rightCount[binCount-2-i] = rightSum;
+			rightBox.grow(binBounds[binCount-1-i]);
+			rightArea[binCount-2-i] = rightBox.area();
+		}
+
+		for (uint32_t i = 0;i<binCount-1;++i) {
+			if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+			const float cost{leftCount[i]*leftArea[i] + rightCount[i]*rightArea[i]};
+			if (!best || cost < best->cost) {
+				candidate.bin = i;
+				candidate.cost = cost;
+				best = candidate;
+			}
+		}
+	}
+
+	return best;
+}
+
+void BVH::subdivide(const uint32_t nodeIndex, std::vector<uint32_t>& indices, const uint32_t level) {
+	// copy, nodes may reallocate during recursion if reserve was too small
+	const Node node{nodes[nodeIndex]};
+	if (node.count <= 1 || level+1 >= stackSize) return;
+
+	const std::optional<Split> split{findBestSplit(node, indices)};
+	if (!split) return;
+
+	AABB nodeBox;
+	nodeBox.minPos = node.minPos;
+	nodeBox.maxPos = node.maxPos;
+	const float leafCost{node.count * nodeBox.area()};
+	const float splitCost{traversalCost * nodeBox.area() + split->cost};
+	if (splitCost >= leafCost && node.count <= maxLeafSize) return;
+
+	// partition the primitive indices in place
+	uint32_t i{node.leftFirst};
+	uint32_t j{node.leftFirst + node.count - 1};
+	while (i <= j) {
+		if (binIndex(*split, centroids[indices[i]][split->axis]) <= split->bin) {
+			++i;
+		} else {
+			std::swap(indices[i], indices[j]);
+			if (j == 0) break;
+			--j;
+		}
+	}
+
+	const uint32_t leftCount{i - node.leftFirst};
+	if (leftCount == 0 || leftCount == node.count) return;
+
+	const uint32_t leftChild{uint32_t(nodes.size())};
+	nodes.push_back(Node{{},node.leftFirst,{},leftCount});
+	nodes.push_back(Node{{},i,{},node.count-leftCount});
+	updateNodeBounds(nodes[leftChild], indices);
+	updateNodeBounds(nodes[leftChild+1], indices);
+
+	nodes[nodeIndex].leftFirst = leftChild;
+	nodes[nodeIndex].count = 0;
+
+	subdivide(leftChild, indices, level+1);
+	subdivide(leftChild+1, indices, level+1);
+}
+
+void BVH::reorder(const std::vector<uint32_t>& indices) {
+	std::vector<float> x(indices.size()), y(indices.size()), z(indices.size()), r(indices.size());
+	std::vector<uint32_t> m(indices.size());
+	for (size_t i = 0;i<indices.size();++i) {
+		x[i] = centerX[indices[i]];
+		y[i] = centerY[indices[i]];
+		z[i] = centerZ[indices[i]];
+		r[i] = radius[indices[i]];
+		m[i] = materialIndex[indices[i]];
+	}
+	centerX.swap(x);
+	centerY.swap(y);
+	centerZ.swap(z);
+	radius.swap(r);
+	materialIndex.swap(m);
+}
+
+uint32_t BVH::depth() const {
+	return nodes.empty() ? 0 : depth(0);
+}
+
+uint32_t BVH::depth(const uint32_t nodeIndex) const {
+	const Node& node{nodes[nodeIndex]};
+	if (node.count > 0) return 1;
+	return 1 + std::max(depth(node.leftFirst), depth(node.leftFirst+1));
+}
+
+// slab test, returns the entry distance or infinity if the box is missed
+static float intersectAABB(const std::array<float,3>& minPos, const std::array<float,3>& maxPos,
+						   const std::array<float,3>& o, const std::array<float,3>& invD,
+						   const float tMin, const float tMax) {
+	float tNear{tMin};
+	float tFar{tMax};
+	for (size_t a = 0;a<3;++a) {
+		float t0{(minPos[a] - o[a]) * invD[a]};
+		float t1{(maxPos[a] - o[a]) * invD[a]};
+		if (t0 > t1) std::swap(t0, t1);
+		tNear = t0 > tNear ? t0 : tNear;
+		tFar = t1 < tFar ? t1 : tFar;
+	}
+	return tNear <= tFar ? tNear : std::numeric_limits<float>::infinity();
+}
+
+const std::optional<HitRecord> BVH::hit(const Ray& r, const float tMin, const float tMax) const {
+	if (dirty) throw std::runtime_error("BVH::hit called before BVH::build");
+	if (nodes.empty()) return {};
+
+	const Vec3 origin{r.origin()};
+	const Vec3 direction{r.direction()};
+	const std::array<float,3> o{origin.x, origin.y, origin.z};
+	const std::array<float,3> d{direction.x, direction.y, direction.z};
+	const std::array<float,3> invD{1.0f/d[0], 1.0f/d[1], 1.0f/d[2]};
+	const float a{direction.sqlength()};
+	const float inf{std::numeric_limits<float>::infinity()};
+
+	float tClosest{tMax};
+	uint32_t closest{std::numeric_limits<uint32_t>::max()};
+
+	std::array<const Node*, stackSize> stack;
+	uint32_t stackPtr{0};
+	const Node* node{&nodes[0]};
+	if (intersectAABB(node->minPos, node->maxPos, o, invD, tMin, tClosest) == inf) return {};
+
+	while (true) {
+		if (node->count > 0) {
+			for (uint32_t i = node->leftFirst;i<node->leftFirst+node->count;++i) {
+				const float ocX{o[0]-centerX[i]};
+				const float ocY{o[1]-centerY[i]};
+				const float ocZ{o[2]-centerZ[i]};
+				const float halfB{ocX*d[0] + ocY*d[1] + ocZ*d[2]};
+				const float c{ocX*ocX + ocY*ocY + ocZ*ocZ - radius[i]*radius[i]};
+				const float discriminant{halfB*halfB - a*c};
+				if (discriminant <= 0) continue;
+
+				const float root{sqrtf(discriminant)};
+				float t{(-halfB - root) / a};
+				if (!(t < tClosest && t > tMin)) {
+					t = (-halfB + root) / a;
+					if (!(t < tClosest && t > tMin)) continue;
+				}
+				tClosest = t;
+				closest = i;
+			}
+			if (stackPtr == 0) break;
+			node = stack[--stackPtr];
+			continue;
+		}
+
+		const Node* near{&nodes[node->leftFirst]};
+		const Node* far{&nodes[node->leftFirst+1]};
+		float distNear{intersectAABB(near->minPos, near->maxPos, o, invD, tMin, tClosest)};
+		float distFar{intersectAABB(far->minPos, far->maxPos, o, invD, tMin, tClosest)};
+		if (distNear > distFar) {
+			std::swap(distNear, distFar);
+			std::swap(near, far);
+		}
+
+		if (distNear == inf) {
+			if (stackPtr == 0) break;
+			node = stack[--stackPtr];
+		} else {
+			node = near;
+			if (distFar != inf) stack[stackPtr++] = far;
+		}
+	}
+
+	if (closest == std::numeric_limits<uint32_t>::max()) return {};
+
+	const Vec3 p{r.pointAtParameter(tClosest)};
+	const Vec3 outwardNormal{(p - Vec3{centerX[closest], centerY[closest], centerZ[closest]}) / radius[closest]};
+	return HitRecord{tClosest, p, outwardNormal, r, materials[materialIndex[closest]].get()};
+}
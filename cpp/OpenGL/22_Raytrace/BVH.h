@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <unordered_map>
+
+#include "Vec3.h"
+#include "Ray.h"
+#include "Hitable.h"
+#include "Material.h"
+#include "Sphere.h"
+
+// Bounding volume hierarchy over a flat set of spheres. The spheres are
+// stored as structure of arrays, materials are referenced by index and the
+// tree itself is a single array of 32 byte nodes that is traversed with an
+// explicit stack. Call build() after the last add() and before hit().
+class BVH : public Hitable {
+	public:
+		BVH();
+		BVH(const std::vector<std::shared_ptr<const Sphere>>& spheres);
+		virtual ~BVH() {}
+
+		void add(const Vec3& center, const float radius, const std::shared_ptr<Material> material);
+		void add(const Sphere& sphere);
+		void build();
+
+		virtual const std::optional<HitRecord> hit(const Ray& r, const float tMin, const float tMax) const;
+
+		size_t size() const {return radius.size();}
+		size_t nodeCount() const {return nodes.size();}
+		size_t materialCount() const {return materials.size();}
+		uint32_t depth() const;
+
+	private:
+		struct Node {
+			std::array<float,3> minPos;
+			uint32_t leftFirst;    // first primitive for leaves, left child otherwise
+			std::array<float,3> maxPos;
+			uint32_t count;        // primitive count, 0 for inner nodes
+		};
+
+		struct AABB {
+			std::array<float,3> minPos;
+			std::array<float,3> maxPos;
+
+			AABB();
+			void grow(const AABB& other);
+			void grow(const std::array<float,3>& p);
+			float area() const;
+		};
+
+		struct Split {
+			uint32_t axis;
+			uint32_t bin;
+			float cost;
+			float centroidMin;
+			float scale;
+		};
+
+		static const uint32_t binCount{16};
+		static const uint32_t maxLeafSize{4};
+		static constexpr float traversalCost{1.0f};  // relative to one sphere test
+		static const uint32_t stackSize{64};
+
+		std::vector<float> centerX;
+		std::vector<float> centerY;
+		std::vector<float> centerZ;
+		std::vector<float> radius;
+		std::vector<uint32_t> materialIndex;
+		std::vector<std::shared_ptr<Material>> materials;
+		std::unordered_map<const Material*, uint32_t> materialLookup;
+
+		std::vector<Node> nodes;
+		bool dirty;
+
+		// centroids are only needed while building
+		std::vector<std::array<float,3>> centroids;
+
+		AABB primitiveBounds(const uint32_t i) const;
+		void updateNodeBounds(Node& node, const std::vector<uint32_t>& indices) const;
+		void subdivide(const uint32_t nodeIndex, std::vector<uint32_t>& indices, const uint32_t level);
+		std::optional<Split> findBestSplit(const Node& node, const std::vector<uint32_t>& indices) const;
+		static uint32_t binIndex(const Split& split, const float centroid);
+		uint32_t depth(const uint32_t nodeIndex) const;
+		void reorder(const std::vector<uint32_t>& indices);
+};
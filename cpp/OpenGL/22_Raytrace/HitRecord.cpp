@@ -11,7 +11,7 @@ HitRecord::HitRecord(const HitRecord& other) :
 {}
 
 HitRecord::HitRecord(const float t, const Vec3& p, const Vec3& n, const Ray& r,
-					 const std::shared_ptr<Material> material) :				
+					 const Material* material) :
 	t{t},
 	p{p},
 	r{r},
@@ -10,12 +10,12 @@ class HitRecord {
 	public:
 		HitRecord(const HitRecord& other);
 		HitRecord(const float t, const Vec3& p, const Vec3& n, const Ray& r,
-				  const std::shared_ptr<Material> material);				
+				  const Material* material);
 
 		float t;
 		Vec3 p;
 		Ray r;
-		std::shared_ptr<Material> material;
+		const Material* material;
 		bool frontFace;
 		Vec3 n;
 };
@@ -24,14 +24,14 @@ const std::optional<HitRecord> Sphere::hit(const Ray &r, const float tMin, const
 		if (t1 < tMax && t1 > tMin) {
 			const Vec3 p{r.pointAtParameter(t1)};
 			const Vec3 outwardNormal{(p - center) / radius};
-			return HitRecord{t1,p,outwardNormal,r,material};
+			return HitRecord{t1,p,outwardNormal,r,material.get()};
 		}
 		
 		const float t2 = (-halfB + root) / a;
 		if (t2 < tMax && t2 > tMin) {
 			const Vec3 p{r.pointAtParameter(t2)};
 			const Vec3 outwardNormal{(p - center) / radius};
-			return HitRecord{t2,p,outwardNormal,r,material};
+			return HitRecord{t2,p,outwardNormal,r,material.get()};
 		}
 	}
 	
@@ -12,7 +12,7 @@
 #include <chrono>
 typedef std::chrono::high_resolution_clock Clock;
 
-#include "HitableList.h"
+#include "BVH.h"
 #include "Vec3.h"
 #include "Mat4.h"
 #include "Ray.h"
@@ -24,7 +24,7 @@ typedef std::chrono::high_resolution_clock Clock;
 #include <GLApp.h>
 
 
-const Vec3 rayColor(const Ray& r, const HitableList& world, const float depth) {
+const Vec3 rayColor(const Ray& r, const Hitable& world, const float depth) {
 	// if we've exceeded the ray bounce limit, no more light is gathered.
 	if (depth <= 0)
 		return {0,0,0};
@@ -71,16 +71,16 @@ const std::array<uint8_t,3> finalizeColor(const Vec3& pixelColor, const uint32_t
 
 }
 
-HitableList randomSphereScene() {
-	HitableList world{};
+BVH randomSphereScene() {
+	BVH world{};
 
 	// Bottom "plane"
-	world.add(std::make_shared<Sphere>(Vec3{0.0f,-1000.0f,0.0f}, 1000.0f, std::make_shared<Lambertian>(Vec3{0.5f, 0.5f, 0.5f})));
+	world.add(Vec3{0.0f,-1000.0f,0.0f}, 1000.0f, std::make_shared<Lambertian>(Vec3{0.5f, 0.5f, 0.5f}));
 
 	// three large spheres
-	world.add(std::make_shared<Sphere>(Vec3{0.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Dielectric>(1.5f)));
-	world.add(std::make_shared<Sphere>(Vec3{-4.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Lambertian>(Vec3{0.4f, 0.2f, 0.1f})));
-	world.add(std::make_shared<Sphere>(Vec3{4.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Metal>(Vec3{0.7f, 0.6f, 0.5f}, 0.0f)));
+	world.add(Vec3{0.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Dielectric>(1.5f));
+	world.add(Vec3{-4.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Lambertian>(Vec3{0.4f, 0.2f, 0.1f}));
+	world.add(Vec3{4.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Metal>(Vec3{0.7f, 0.6f, 0.5f}, 0.0f));
 	
 	// numerous small spheres
 	for (int32_t a{-11}; a < 11;++a) {
@@ -92,22 +92,23 @@ HitableList randomSphereScene() {
 				if (chooseMat < 0.8f) {
 					// diffuse
 					const Vec3 color{Vec3::random() * Vec3::random()};
-					world.add(std::make_shared<Sphere>(center, 0.2f, std::make_shared<Lambertian>(color)));
+					world.add(center, 0.2f, std::make_shared<Lambertian>(color));
 				} else {
 					if (chooseMat < 0.9f) {
 						// metal
 						const float c{staticRand.rand005()};
 						const Vec3 color{c,c,c};
 						const float fuzz{staticRand.rand051()};
-						world.add(std::make_shared<Sphere>(center, 0.2f, std::make_shared<Metal>(color, fuzz)));
+						world.add(center, 0.2f, std::make_shared<Metal>(color, fuzz));
 					} else {
 						// glass
-						world.add(std::make_shared<Sphere>(center, 0.2f, std::make_shared<Dielectric>(1.5f)));
+						world.add(center, 0.2f, std::make_shared<Dielectric>(1.5f));
 					}
 				}
 			}
 		}
 	}
+	world.build();
 	return world;
 }
 
@@ -120,7 +121,7 @@ const uint32_t maxDepth{20};
 class MyGLApp : public GLApp {
 public:
 
-  HitableList world;
+  BVH world;
 
   Vec3 lookFrom{13,2,3};
   const Vec3 lookAt{0,0,0};
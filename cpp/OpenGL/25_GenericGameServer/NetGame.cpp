@@ -1,14 +1,23 @@
 #include "NetGame.h"
 
+namespace {
+  struct MessageHeader {
+    uint32_t type;
+
+    static constexpr auto schema() {
+      return std::make_tuple(MessageSchema::constant("game"),
+                             MessageSchema::field("type", &MessageHeader::type));
+    }
+  };
+}
+
 MessageType identifyString(const std::string& s) {
-  Tokenizer t(s);
-  if (t.nextString() != "game") return MessageType::InvalidMessage;
-  uint32_t i;
+  MessageHeader header;
   try {
-    i = t.nextUint32();
-    if (i > uint32_t(MessageType::GameMessage)) return MessageType::InvalidMessage;
-  } catch (const std::invalid_argument&) {
+    MessageSchema::decodeText(s, header);
+  } catch (const MessageException&) {
     return MessageType::InvalidMessage;
   }
-  return MessageType(i);
+  if (header.type > uint32_t(MessageType::GameMessage)) return MessageType::InvalidMessage;
+  return MessageType(header.type);
 }
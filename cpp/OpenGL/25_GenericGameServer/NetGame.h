@@ -7,6 +7,7 @@
 #include <exception>
 
 #include <NetCommon.h>
+#include <MessageSchema.h>
 
 constexpr uint16_t serverPort = 11003;
 
@@ -31,31 +32,26 @@ MessageType identifyString(const std::string& s);
 struct BasicMessage {
   MessageType pt;
   uint32_t userID{0};
-  Tokenizer tokenizer;
 
-  BasicMessage(const std::string& message) :
-    tokenizer{message}
-  {
-    if (tokenizer.nextString() != "game") throw MessageException("Invalid message");
-    pt = MessageType(tokenizer.nextUint32());
-    userID = tokenizer.nextUint32();
+  BasicMessage(const std::string& message) {
+    MessageSchema::decodeText(message, *this);
     pt = MessageType::BasicMessage;
   }
   
-  BasicMessage() :
-    tokenizer{""}
-  {
+  BasicMessage() {
     pt = MessageType::BasicMessage;
   }
   
   virtual ~BasicMessage() {}
   
   virtual std::string toString() {
-    StringEncoder coder;
-    coder.add("game");
-    coder.add(int(pt));
-    coder.add(userID);
-    return coder.getEncodedMessage();
+    return MessageSchema::toText(*this);
+  }
+
+  static constexpr auto schema() {
+    return std::make_tuple(MessageSchema::constant("game"),
+                           MessageSchema::field("type", &BasicMessage::pt),
+                           MessageSchema::field("userID", &BasicMessage::userID));
   }
 };
 
@@ -79,11 +75,8 @@ struct PairedMessage : public BasicMessage {
   std::string name;
   uint32_t level;
 
-  PairedMessage(const std::string& message) :
-    BasicMessage(message)
-  {
-    name = tokenizer.nextString();
-    level = tokenizer.nextUint32();
+  PairedMessage(const std::string& message) {
+    MessageSchema::decodeText(message, *this);
     pt = MessageType::PairedMessage;
   }
   
@@ -97,10 +90,13 @@ struct PairedMessage : public BasicMessage {
   virtual ~PairedMessage() {}
   
   virtual std::string toString() override {
-    StringEncoder coder;
-    coder.add(name);
-    coder.add(level);
-    return BasicMessage::toString() + coder.getEncodedMessage();
+    return MessageSchema::toText(*this);
+  }
+
+  static constexpr auto schema() {
+    return std::tuple_cat(BasicMessage::schema(),
+                          std::make_tuple(MessageSchema::field("name", &PairedMessage::name),
+                                          MessageSchema::field("level", &PairedMessage::level)));
   }
 };
 
@@ -125,12 +121,8 @@ struct ConnectMessage : public BasicMessage {
   GameIDs gameID;
   uint32_t level;
   
-  ConnectMessage(const std::string& message) :
-    BasicMessage(message)
-  {
-    name = tokenizer.nextString();
-    gameID = (GameIDs)tokenizer.nextUint32();
-    level = tokenizer.nextUint32();
+  ConnectMessage(const std::string& message) {
+    MessageSchema::decodeText(message, *this);
     pt = MessageType::ConnectMessage;
   }
   
@@ -145,21 +137,22 @@ struct ConnectMessage : public BasicMessage {
   virtual ~ConnectMessage() {}
   
   virtual std::string toString() override {
-    StringEncoder coder;
-    coder.add(name);
-    coder.add(uint32_t(gameID));
-    coder.add(level);
-    return BasicMessage::toString() + coder.getEncodedMessage();
+    return MessageSchema::toText(*this);
+  }
+
+  static constexpr auto schema() {
+    return std::tuple_cat(BasicMessage::schema(),
+                          std::make_tuple(MessageSchema::field("name", &ConnectMessage::name),
+                                          MessageSchema::field("gameID", &ConnectMessage::gameID),
+                                          MessageSchema::field("level", &ConnectMessage::level)));
   }
 };
 
 struct GameMessage : public BasicMessage {
   std::string payload;
   
-  GameMessage(const std::string& message) :
-    BasicMessage(message)
-  {
-    payload = tokenizer.nextString();
+  GameMessage(const std::string& message) {
+    MessageSchema::decodeText(message, *this);
     pt = MessageType::GameMessage;
   }
   
@@ -172,8 +165,11 @@ struct GameMessage : public BasicMessage {
   virtual ~GameMessage() {}
   
   virtual std::string toString() override {
-    StringEncoder coder;
-    coder.add(payload);
-    return BasicMessage::toString() + coder.getEncodedMessage();
+    return MessageSchema::toText(*this);
+  }
+
+  static constexpr auto schema() {
+    return std::tuple_cat(BasicMessage::schema(),
+                          std::make_tuple(MessageSchema::field("payload", &GameMessage::payload)));
   }
 };
@@ -0,0 +1,341 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+
+#include <NetCommon.h>
+#include <MessageSchema.h>
+
+#include "NetGame.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Encodes and decodes messages with the old Encoder and Tokenizer classes
+// and with MessageSchema, and checks that both write the same bytes and
+// read the same values: the GGS ConnectMessage and GameMessage in the text
+// format, the way NetGame.h built them before, and a message of fixed
+// width fields in the binary format of BinaryEncoder. The schema is timed
+// with the NetGame types, which allocate their strings, and with views and
+// a reused buffer, which allocate nothing.
+//
+//   ggsBench [messages]   default 1000000
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// NetGame.h before the schemas
+namespace Legacy {
+  struct BasicMessage {
+    MessageType pt;
+    uint32_t userID{0};
+    Tokenizer tokenizer;
+
+    BasicMessage(const std::string& message) :
+      tokenizer{message}
+    {
+      if (tokenizer.nextString() != "game") throw MessageException("Invalid message");
+      pt = MessageType(tokenizer.nextUint32());
+      userID = tokenizer.nextUint32();
+      pt = MessageType::BasicMessage;
+    }
+
+    BasicMessage() :
+      tokenizer{""}
+    {
+      pt = MessageType::BasicMessage;
+    }
+
+    virtual ~BasicMessage() {}
+
+    virtual std::string toString() {
+      StringEncoder coder;
+      coder.add("game");
+      coder.add(int(pt));
+      coder.add(userID);
+      return coder.getEncodedMessage();
+    }
+  };
+
+  struct ConnectMessage : public BasicMessage {
+    std::string name;
+    GameIDs gameID;
+    uint32_t level;
+
+    ConnectMessage(const std::string& message) :
+      BasicMessage(message)
+    {
+      name = tokenizer.nextString();
+      gameID = (GameIDs)tokenizer.nextUint32();
+      level = tokenizer.nextUint32();
+      pt = MessageType::ConnectMessage;
+    }
+
+    ConnectMessage(const std::string& name, GameIDs gameID, uint32_t level) :
+      name(name),
+      gameID(gameID),
+      level(level)
+    {
+      pt = MessageType::ConnectMessage;
+    }
+
+    virtual std::string toString() override {
+      StringEncoder coder;
+      coder.add(name);
+      coder.add(uint32_t(gameID));
+      coder.add(level);
+      return BasicMessage::toString() + coder.getEncodedMessage();
+    }
+  };
+
+  struct GameMessage : public BasicMessage {
+    std::string payload;
+
+    GameMessage(const std::string& message) :
+      BasicMessage(message)
+    {
+      payload = tokenizer.nextString();
+      pt = MessageType::GameMessage;
+    }
+
+    GameMessage() {
+      pt = MessageType::GameMessage;
+    }
+
+    virtual std::string toString() override {
+      StringEncoder coder;
+      coder.add(payload);
+      return BasicMessage::toString() + coder.getEncodedMessage();
+    }
+  };
+}
+
+// GameMessage with a view of the payload
+struct GameMessageView {
+  MessageType pt{MessageType::GameMessage};
+  uint32_t userID{0};
+  std::string_view payload;
+
+  static constexpr auto schema() {
+    return std::make_tuple(MessageSchema::constant("game"),
+                           MessageSchema::field("type", &GameMessageView::pt),
+                           MessageSchema::field("userID", &GameMessageView::userID),
+                           MessageSchema::field("payload", &GameMessageView::payload));
+  }
+};
+
+// a game state update of fixed width fields and a name
+struct StateMessage {
+  uint32_t frame;
+  uint16_t player;
+  float x, y, z;
+  float yaw, pitch;
+  int32_t health;
+  uint64_t inventory;
+  bool alive;
+  std::string_view name;
+
+  static constexpr auto schema() {
+    return std::make_tuple(MessageSchema::field("frame", &StateMessage::frame),
+                           MessageSchema::field("player", &StateMessage::player),
+                           MessageSchema::field("x", &StateMessage::x),
+                           MessageSchema::field("y", &StateMessage::y),
+                           MessageSchema::field("z", &StateMessage::z),
+                           MessageSchema::field("yaw", &StateMessage::yaw),
+                           MessageSchema::field("pitch", &StateMessage::pitch),
+                           MessageSchema::field("health", &StateMessage::health),
+                           MessageSchema::field("inventory", &StateMessage::inventory),
+                           MessageSchema::field("alive", &StateMessage::alive),
+                           MessageSchema::field("name", &StateMessage::name));
+  }
+};
+
+static StateMessage state(uint32_t i) {
+  return {i, uint16_t(i%7), 1.5f*i, -0.25f*i, 3.0f, 0.1f*(i%60), -0.5f, int32_t(i%200)-100,
+          0x0123456789ABCDEFull ^ i, i%3 != 0, "player one"};
+}
+
+static std::vector<uint8_t> legacyEncode(const StateMessage& s) {
+  BinaryEncoder e;
+  e.add(s.frame); e.add(s.player);
+  e.add(s.x); e.add(s.y); e.add(s.z); e.add(s.yaw); e.add(s.pitch);
+  e.add(s.health); e.add(s.inventory); e.add(s.alive); e.add(std::string(s.name));
+  return e.getEncodedMessage();
+}
+
+struct LegacyState {
+  uint32_t frame;
+  uint16_t player;
+  float x, y, z;
+  float yaw, pitch;
+  int32_t health;
+  uint64_t inventory;
+  bool alive;
+  std::string name;
+};
+
+static LegacyState legacyDecode(const std::vector<uint8_t>& message) {
+  BinaryDecoder d{message};
+  LegacyState s;
+  s.frame = d.nextUint32(); s.player = d.nextUint16();
+  s.x = d.nextFloat(); s.y = d.nextFloat(); s.z = d.nextFloat(); s.yaw = d.nextFloat(); s.pitch = d.nextFloat();
+  s.health = d.nextInt32(); s.inventory = d.nextUint64(); s.alive = d.nextBool(); s.name = d.nextString();
+  return s;
+}
+
+static bool sameState(const LegacyState& a, const StateMessage& b) {
+  return a.frame == b.frame && a.player == b.player && a.x == b.x && a.y == b.y && a.z == b.z &&
+         a.yaw == b.yaw && a.pitch == b.pitch && a.health == b.health && a.inventory == b.inventory &&
+         a.alive == b.alive && a.name == b.name;
+}
+
+static bool check() {
+  for (uint32_t i = 0;i<1000;++i) {
+    const std::string name = "player " + std::to_string(i) + (i%10 == 0 ? std::string(1, char(1)) : "");
+    Legacy::ConnectMessage lc{name, GameIDs(i%3), i};
+    lc.userID = i*7;
+    ConnectMessage c{name, GameIDs(i%3), i};
+    c.userID = i*7;
+    const std::string text = lc.toString();
+    if (c.toString() != text) return false;
+    const Legacy::ConnectMessage lr{text};
+    const ConnectMessage r{text};
+    if (r.name != lr.name || r.gameID != lr.gameID || r.level != lr.level || r.userID != lr.userID ||
+        identifyString(text) != MessageType::ConnectMessage) return false;
+
+    Legacy::GameMessage lg;
+    lg.userID = i;
+    lg.payload = "6" + std::string(1, char(2)) + std::to_string(i*i) + std::string(1, char(2));
+    GameMessage g;
+    g.userID = i;
+    g.payload = lg.payload;
+    const std::string gameText = lg.toString();
+    if (g.toString() != gameText || GameMessage{gameText}.payload != lg.payload) return false;
+    GameMessageView v;
+    MessageSchema::decodeText(gameText, v);
+    if (v.payload != lg.payload || v.userID != i) return false;
+
+    const StateMessage s = state(i);
+    const std::vector<uint8_t> binary = legacyEncode(s);
+    if (MessageSchema::toBinary(s) != binary) return false;
+    StateMessage d;
+    MessageSchema::decodeBinary(binary.data(), binary.size(), d);
+    if (!sameState(legacyDecode(binary), d)) return false;
+  }
+  return true;
+}
+
+static void report(const std::string& name, size_t count, double time, double reference) {
+  std::cout << "  " << std::left << std::setw(40) << name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(8) << count/time/1e6 << " M messages/s";
+  if (reference > 0) std::cout << std::setw(8) << std::setprecision(1) << reference/time << "x";
+  std::cout << std::endl;
+}
+
+template <typename F>
+static double time(F&& f) {
+  const auto t1 = Clock::now();
+  f();
+  return seconds(t1, Clock::now());
+}
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? size_t(atol(argv[1])) : 1000000;
+
+  if (!check()) {
+    std::cout << "WRONG result, the schema does not match the old encoders" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "checked" << std::endl;
+
+  size_t sink = 0;
+  const std::string payload = "6" + std::string(1, char(2)) + "12" + std::string(1, char(2)) + "7" + std::string(1, char(2));
+
+  std::cout << "ConnectMessage, text" << std::endl;
+  const double connectEncode = time([&]{
+    for (size_t i = 0;i<count;++i) sink += Legacy::ConnectMessage{"player one", GameIDs::BattleShips2, uint32_t(i)}.toString().size();
+  });
+  report("encode, StringEncoder", count, connectEncode, 0);
+  report("encode, schema", count, time([&]{
+    for (size_t i = 0;i<count;++i) sink += ConnectMessage{"player one", GameIDs::BattleShips2, uint32_t(i)}.toString().size();
+  }), connectEncode);
+  const std::string connectText = ConnectMessage{"player one", GameIDs::BattleShips2, 17}.toString();
+  const double connectDecode = time([&]{
+    for (size_t i = 0;i<count;++i) sink += Legacy::ConnectMessage{connectText}.level;
+  });
+  report("decode, Tokenizer", count, connectDecode, 0);
+  report("decode, schema", count, time([&]{
+    for (size_t i = 0;i<count;++i) sink += ConnectMessage{connectText}.level;
+  }), connectDecode);
+
+  std::cout << "GameMessage, text" << std::endl;
+  const double gameEncode = time([&]{
+    for (size_t i = 0;i<count;++i) {
+      Legacy::GameMessage g;
+      g.userID = uint32_t(i);
+      g.payload = payload;
+      sink += g.toString().size();
+    }
+  });
+  report("encode, StringEncoder", count, gameEncode, 0);
+  report("encode, schema", count, time([&]{
+    for (size_t i = 0;i<count;++i) {
+      GameMessage g;
+      g.userID = uint32_t(i);
+      g.payload = payload;
+      sink += g.toString().size();
+    }
+  }), gameEncode);
+  char buffer[256];
+  report("encode, schema, view into buffer", count, time([&]{
+    for (size_t i = 0;i<count;++i) {
+      GameMessageView g;
+      g.userID = uint32_t(i);
+      g.payload = payload;
+      sink += MessageSchema::encodeText(g, buffer, sizeof(buffer));
+    }
+  }), gameEncode);
+  const std::string gameText = MessageSchema::toText(GameMessageView{MessageType::GameMessage, 3, payload});
+  const double gameDecode = time([&]{
+    for (size_t i = 0;i<count;++i) sink += Legacy::GameMessage{gameText}.payload.size();
+  });
+  report("decode, Tokenizer", count, gameDecode, 0);
+  report("decode, schema", count, time([&]{
+    for (size_t i = 0;i<count;++i) sink += GameMessage{gameText}.payload.size();
+  }), gameDecode);
+  report("decode, schema, view", count, time([&]{
+    for (size_t i = 0;i<count;++i) {
+      GameMessageView g;
+      MessageSchema::decodeText(gameText, g);
+      sink += g.payload.size();
+    }
+  }), gameDecode);
+
+  std::cout << "StateMessage, binary" << std::endl;
+  const double stateEncode = time([&]{
+    for (size_t i = 0;i<count;++i) sink += legacyEncode(state(uint32_t(i))).size();
+  });
+  report("encode, BinaryEncoder", count, stateEncode, 0);
+  uint8_t binary[256];
+  report("encode, schema into buffer", count, time([&]{
+    for (size_t i = 0;i<count;++i) sink += MessageSchema::encodeBinary(state(uint32_t(i)), binary, sizeof(binary));
+  }), stateEncode);
+  const std::vector<uint8_t> stateBinary = legacyEncode(state(17));
+  const double stateDecode = time([&]{
+    for (size_t i = 0;i<count;++i) sink += legacyDecode(stateBinary).frame;
+  });
+  report("decode, BinaryDecoder", count, stateDecode, 0);
+  report("decode, schema, view", count, time([&]{
+    for (size_t i = 0;i<count;++i) {
+      StateMessage s;
+      MessageSchema::decodeBinary(stateBinary.data(), stateBinary.size(), s);
+      sink += s.frame;
+    }
+  }), stateDecode);
+
+  std::cout << "describe: " << MessageSchema::describe(state(17)) << std::endl;
+  return sink == 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// A set of up to 256 cells of a grid, one bit per cell at x+y*width. All
+// operations work on the four words at once, which the compiler turns into
+// a few SIMD instructions.
+struct Bitboard {
+  static constexpr uint32_t maxCells = 256;
+
+  std::array<uint64_t, 4> words{};
+
+  static Bitboard cell(uint32_t index) {
+    Bitboard b;
+    b.set(index);
+    return b;
+  }
+
+  void set(uint32_t index) {words[index/64] |= uint64_t(1) << (index%64);}
+  bool test(uint32_t index) const {return (words[index/64] >> (index%64)) & 1;}
+
+  bool empty() const {
+    return (words[0] | words[1] | words[2] | words[3]) == 0;
+  }
+
+  uint32_t count() const {
+    uint32_t c = 0;
+    for (const uint64_t w : words) c += popcount(w);
+    return c;
+  }
+
+  // index of the n-th set cell, n < count()
+  uint32_t select(uint32_t n) const {
+    for (size_t i = 0;i<words.size();++i) {
+      uint64_t w = words[i];
+      const uint32_t c = popcount(w);
+      if (n >= c) {
+        n -= c;
+        continue;
+      }
+      for (;n>0;--n) w &= w-1;
+      return uint32_t(i*64) + lowestBit(w);
+    }
+    return maxCells;
+  }
+
+  // moves every cell n indices up, cells beyond maxCells are lost
+  Bitboard operator<<(uint32_t n) const {
+    Bitboard r;
+    const uint32_t q = n/64;
+    const uint32_t s = n%64;
+    for (uint32_t i = q;i<4;++i) {
+      r.words[i] = words[i-q] << s;
+      if (s > 0 && i > q) r.words[i] |= words[i-q-1] >> (64-s);
+    }
+    return r;
+  }
+
+  // moves every cell n indices down
+  Bitboard operator>>(uint32_t n) const {
+    Bitboard r;
+    const uint32_t q = n/64;
+    const uint32_t s = n%64;
+    for (uint32_t i = 0;i+q<4;++i) {
+      r.words[i] = words[i+q] >> s;
+      if (s > 0 && i+q+1 < 4) r.words[i] |= words[i+q+1] << (64-s);
+    }
+    return r;
+  }
+
+  Bitboard operator&(const Bitboard& o) const {
+    Bitboard r;
+    for (size_t i = 0;i<4;++i) r.words[i] = words[i] & o.words[i];
+    return r;
+  }
+
+  Bitboard operator|(const Bitboard& o) const {
+    Bitboard r;
+    for (size_t i = 0;i<4;++i) r.words[i] = words[i] | o.words[i];
+    return r;
+  }
+
+  Bitboard operator^(const Bitboard& o) const {
+    Bitboard r;
+    for (size_t i = 0;i<4;++i) r.words[i] = words[i] ^ o.words[i];
+    return r;
+  }
+
+  Bitboard operator~() const {
+    Bitboard r;
+    for (size_t i = 0;i<4;++i) r.words[i] = ~words[i];
+    return r;
+  }
+
+  Bitboard& operator&=(const Bitboard& o) {return *this = *this & o;}
+  Bitboard& operator|=(const Bitboard& o) {return *this = *this | o;}
+  Bitboard& operator^=(const Bitboard& o) {return *this = *this ^ o;}
+
+  bool operator==(const Bitboard& o) const {return words == o.words;}
+  bool operator!=(const Bitboard& o) const {return words != o.words;}
+
+  static uint32_t popcount(uint64_t w) {
+#ifdef _MSC_VER
+    return uint32_t(__popcnt64(w));
+#else
+    return uint32_t(__builtin_popcountll(w));
+#endif
+  }
+
+  static uint32_t lowestBit(uint64_t w) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, w);
+    return uint32_t(index);
+#else
+    return uint32_t(__builtin_ctzll(w));
+#endif
+  }
+};
+
+// The neighbourhood of the cells of a grid with at most Bitboard::maxCells
+// cells in bitboards. Along the rows or the columns of the grid, "forward"
+// is the direction of growing x or y.
+class BitboardGrid {
+public:
+  BitboardGrid(uint32_t width, uint32_t height) :
+    width{width}
+  {
+    for (uint32_t y = 0;y<height;++y) {
+      for (uint32_t x = 0;x<width;++x) {
+        all.set(x+y*width);
+        if (x > 0) notFirstColumn.set(x+y*width);
+        if (x+1 < width) notLastColumn.set(x+y*width);
+      }
+    }
+  }
+
+  Bitboard getAll() const {return all;}
+
+  // moves every cell one step forward, cells leaving the grid are lost
+  Bitboard forward(const Bitboard& b, bool vertical) const {
+    return vertical ? (b << width) & all : (b << 1) & notFirstColumn;
+  }
+
+  Bitboard backward(const Bitboard& b, bool vertical) const {
+    return vertical ? b >> width : (b >> 1) & notLastColumn;
+  }
+
+  // the cells and their eight neighbours
+  Bitboard dilate(const Bitboard& b) const {
+    const Bitboard row = b | forward(b, false) | backward(b, false);
+    return row | forward(row, true) | backward(row, true);
+  }
+
+  // the first cells of all runs of length cells in b
+  Bitboard starts(const Bitboard& b, uint32_t length, bool vertical) const {
+    Bitboard r = b;
+    for (uint32_t i = 1;i<length;++i) r = backward(r, vertical) & b;
+    return r;
+  }
+
+  // all cells of the runs of length cells beginning at starts
+  Bitboard cover(const Bitboard& starts, uint32_t length, bool vertical) const {
+    Bitboard r = starts;
+    for (uint32_t i = 1;i<length;++i) r = forward(r, vertical) | starts;
+    return r;
+  }
+
+private:
+  uint32_t width;
+  Bitboard all;
+  Bitboard notFirstColumn;
+  Bitboard notLastColumn;
+};
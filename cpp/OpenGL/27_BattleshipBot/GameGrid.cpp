@@ -1,4 +1,5 @@
 #include "GameGrid.h"
+#include "Targeting.h"
 
 #include <NetCommon.h>
 
@@ -170,117 +171,28 @@ uint32_t GameGrid::markAsSunk(const Vec2ui& pos) {
   return std::max(ship.end.x - ship.start.x, ship.end.y - ship.start.y)+1;
 }
 
-uint32_t GameGrid::distSum(const Vec2ui& pos) const {
-  if (getCell(pos.x, pos.y) != Cell::Unknown) return 0;
-  uint32_t distX = 0;
-  for (uint32_t x = pos.x+1;x<gridSize.x;x++) {
-    if (getCell(x, pos.y) != Cell::Unknown) break;
-    distX++;
-  }
-  
-  uint32_t dist = 0;
-  for (int64_t x = int64_t(pos.x)-1;x>=0;x--) {
-    if (dist >= distX || getCell(uint32_t(x), pos.y) != Cell::Unknown) break;
-    dist++;
-  }
-  distX = std::min(dist, distX);
-    
-  uint32_t distY = 0;
-  for (uint32_t y = pos.y+1;y<gridSize.y;y++) {
-    if (getCell(pos.x, y) != Cell::Unknown) break;
-    distY++;
-  }
-
-  dist = 0;
-  for (int64_t y = int64_t(pos.y)-1;y>=0;y--) {
-    if (dist >= distY || getCell(pos.x, uint32_t(y)) != Cell::Unknown) break;
-    dist++;
-  }
-  distY = std::min(dist, distY);
-  
-  return distY+distX;
-}
-
 Vec2ui GameGrid::guessNextCell() const {
-  uint32_t maxMindist = 0;
-  for (uint32_t y = 0;y<gridSize.y;y++) {
-    for (uint32_t x = 0;x<gridSize.x;x++) {
-      maxMindist = std::max(maxMindist, distSum({uint32_t(x), uint32_t(y)}));
-    }
-  }
-  
-  std::vector<Vec2ui> candidates;
+  Targeting targeting{gridSize};
   for (uint32_t y = 0;y<gridSize.y;y++) {
     for (uint32_t x = 0;x<gridSize.x;x++) {
-      const Vec2ui p{uint32_t(x), uint32_t(y)};
-      if (distSum(p) == maxMindist) {
-        candidates.push_back(p);
+      switch (getCell(x, y)) {
+        case Cell::Unknown :
+          break;
+        case Cell::Empty :
+        case Cell::EmptyShot :
+          targeting.addMiss({x,y});
+          break;
+        case Cell::Ship :
+        case Cell::ShipShot :
+          targeting.addHit({x,y});
+          break;
       }
     }
   }
-  const Vec2ui pick = candidates[staticRand.rand<size_t>(0,candidates.size())];
-  return pick;
-}
-
-std::optional<Vec2ui> GameGrid::guessNextShipCellH(const Vec2ui& pos) const {
-  for (uint32_t x = pos.x+1;x<gridSize.x;x++) {
-    const Cell c = getCell(x, pos.y);
-    if (c == Cell::Unknown) return Vec2ui{x, pos.y};
-    if (c == Cell::Empty || c == Cell::EmptyShot) break;
-  }
-  for (int64_t x = int64_t(pos.x)-1;x>=0;x--) {
-    const Cell c = getCell(uint32_t(x), pos.y);
-    if (c == Cell::Unknown) return Vec2ui{uint32_t(x), pos.y};
-    if (c == Cell::Empty || c == Cell::EmptyShot) break;
-  }
-  return {};
-}
-
-std::optional<Vec2ui> GameGrid::guessNextShipCellV(const Vec2ui& pos) const {
-  for (uint32_t y = pos.y+1;y<gridSize.y;y++) {
-    const Cell c = getCell(pos.x, y);
-    if (c == Cell::Unknown) return Vec2ui{pos.x, y};
-    if (c == Cell::Empty || c == Cell::EmptyShot) break;
-  }
-  for (int64_t y = int64_t(pos.y)-1;y>=0;y--) {
-    const Cell c = getCell(pos.x, uint32_t(y));
-    if (c == Cell::Unknown) return Vec2ui{pos.x, uint32_t(y)};
-    if (c == Cell::Empty || c == Cell::EmptyShot) break;
-  }
-  return {};
-}
-
-Vec2ui GameGrid::guessNextShipCell(const Vec2ui& pos) const {
-  const bool horizontalFirst = staticRand.rand01() > 0.5f;
-    
-  bool searchHorizontal{true};
-  if (pos.y > 0 && (getCell(pos.x, pos.y-1) == Cell::Ship || getCell(pos.x, pos.y-1) == Cell::ShipShot)) searchHorizontal = false;
-  if (pos.y < gridSize.y && (getCell(pos.x, pos.y+1) == Cell::Ship || getCell(pos.x, pos.y+1) == Cell::ShipShot)) searchHorizontal = false;
-
-  bool searchVertical{true};
-  if (pos.x > 0 && (getCell(pos.x-1, pos.y) == Cell::Ship || getCell(pos.x-1, pos.y) == Cell::ShipShot)) searchVertical = false;
-  if (pos.x < gridSize.x && (getCell(pos.x+1, pos.y) == Cell::Ship || getCell(pos.x+1, pos.y) == Cell::ShipShot)) searchVertical = false;
-
-  if (horizontalFirst) {
-    if (searchHorizontal) {
-      const auto r = guessNextShipCellH(pos);
-      if (r) return *r;
-    }
-    const auto r = guessNextShipCellV(pos);
-    if (r) return *r;
-  } else {
-    if (searchVertical) {
-      const auto r = guessNextShipCellV(pos);
-      if (r) return *r;
-    }
-    const auto r = guessNextShipCellH(pos);
-    if (r) return *r;
-  }
-    
-  return guessNextCell();
+  for (const ShipLocation& ship : sunken) targeting.addSunk(ship);
+  return targeting.nextShot(staticRand);
 }
 
-
 ShipLocation GameGrid::findSunkenShip(const Vec2ui& pos) const {
   bool horizontal{true};
   if (pos.y > 0 && (getCell(pos.x, pos.y-1) == Cell::Ship || getCell(pos.x, pos.y-1) == Cell::ShipShot)) horizontal = false;
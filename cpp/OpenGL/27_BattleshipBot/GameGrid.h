@@ -2,7 +2,6 @@
 
 #include <vector>
 #include <string>
-#include <optional>
 
 #include <Vec2.h>
 
@@ -38,8 +37,8 @@ public:
 
   size_t getRemainingHits() const;
   
+  // the next shot of the bot, see Targeting
   Vec2ui guessNextCell() const;
-  Vec2ui guessNextShipCell(const Vec2ui& pos) const;
   
   void markAroundSunk(const Vec2ui& pos);
   ShipLocation findSunkenShip(const Vec2ui& pos) const;
@@ -56,9 +55,4 @@ private:
   void addShip(const Vec2ui& pos);
   void setCell(uint32_t x, uint32_t y, Cell c);
   uint32_t markAsSunk(const Vec2ui& pos);
-  uint32_t distSum(const Vec2ui& pos) const;
-  
-  std::optional<Vec2ui> guessNextShipCellH(const Vec2ui& pos) const;
-  std::optional<Vec2ui> guessNextShipCellV(const Vec2ui& pos) const;
-  
 };
@@ -14,7 +14,6 @@ void MainPhase::prepare(const ShipPlacement& myShipPlacement) {
   otherBoard = GameGrid{boardSize};
   otherBoard.clearUnknown();
   
-  hitCoords = {0,0};
   status = {Status::SEARCHING};
   alpha = {0};
 
@@ -67,9 +66,8 @@ void MainPhase::run() {
 
       if (newResult == ShotResult::SUNK) {
         status = Status::SEARCHING;
-        otherBoard.markAroundSunk(hitCoords);
+        otherBoard.markAroundSunk(pos);
       } else {
-        if (status == Status::SEARCHING) hitCoords = pos;
         status = Status::SINKING;
       }
     }
@@ -109,10 +107,8 @@ void MainPhase::findNextShot() {
         }
       }
     }
-    nextShot = otherBoard.guessNextCell();
-  } else {
-    nextShot = otherBoard.guessNextShipCell(hitCoords);
   }
+  nextShot = otherBoard.guessNextCell();
 }
 
 uint32_t MainPhase::gameOver() const {
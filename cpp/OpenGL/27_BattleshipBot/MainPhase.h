@@ -33,7 +33,6 @@ private:
   std::vector<Vec2ui> shotsReceived;
   std::vector<ShotResult> shotResults;
 
-  Vec2ui hitCoords{0,0};
   Status status{Status::SEARCHING};
   float alpha{0};
   Vec2ui lastShot{0,0};
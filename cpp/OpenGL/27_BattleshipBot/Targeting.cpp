@@ -0,0 +1,126 @@
+#include <stdexcept>
+#include <algorithm>
+
+#include "Targeting.h"
+
+namespace {
+  // eight bit counters for all cells, bit i of every count in planes[i]
+  struct Counter {
+    std::array<Bitboard, 8> planes{};
+
+    void add(Bitboard b) {
+      for (Bitboard& plane : planes) {
+        if (b.empty()) return;
+        const Bitboard carry = plane & b;
+        plane ^= b;
+        b = carry;
+      }
+    }
+
+    // the candidates with the highest count
+    Bitboard maxima(Bitboard candidates) const {
+      for (size_t i = planes.size();i>0;--i) {
+        const Bitboard higher = candidates & planes[i-1];
+        if (!higher.empty()) candidates = higher;
+      }
+      return candidates;
+    }
+  };
+}
+
+Targeting::Targeting(const Vec2ui& gridSize, const std::vector<ShipSize>& fleet) :
+  gridSize{gridSize},
+  grid{gridSize.x, gridSize.y}
+{
+  if (size_t(gridSize.x)*gridSize.y > Bitboard::maxCells)
+    throw std::runtime_error("Targeting supports grids of up to 256 cells");
+
+  uint32_t maxCount = 0;
+  for (const ShipSize& s : fleet) {
+    const uint32_t length = uint32_t(s);
+    if (remaining.size() <= length) remaining.resize(length+1);
+    remaining[length]++;
+    maxCount += 2*length;
+  }
+  if (maxCount > 255)
+    throw std::runtime_error("Targeting supports fleets of up to 127 cells");
+}
+
+void Targeting::addMiss(const Vec2ui& pos) {
+  misses.set(index(pos));
+}
+
+void Targeting::addHit(const Vec2ui& pos) {
+  hits.set(index(pos));
+}
+
+void Targeting::addSunk(const ShipLocation& ship) {
+  for (uint32_t y = ship.start.y;y<=ship.end.y;y++) {
+    for (uint32_t x = ship.start.x;x<=ship.end.x;x++) {
+      hits.set(index({x,y}));
+      sunk.set(index({x,y}));
+    }
+  }
+  const uint32_t length = std::max(ship.end.x - ship.start.x, ship.end.y - ship.start.y)+1;
+  if (length < remaining.size() && remaining[length] > 0) remaining[length]--;
+}
+
+bool Targeting::isKnown(const Vec2ui& pos) const {
+  return misses.test(index(pos)) || hits.test(index(pos));
+}
+
+size_t Targeting::getRemainingShips() const {
+  size_t count = 0;
+  for (const uint32_t r : remaining) count += r;
+  return count;
+}
+
+Vec2ui Targeting::nextShot(Random& rand) const {
+  const Bitboard unknown = grid.getAll() & ~(misses | hits);
+  if (unknown.empty()) return {0,0};
+
+  const Bitboard unsunk = hits & ~sunk;
+  const Bitboard open = unknown | unsunk;
+
+  Counter throughHits;
+  Counter elsewhere;
+  for (const bool vertical : {false, true}) {
+    // cells beside a hit across the ship, diagonals included
+    Bitboard side = grid.forward(hits, !vertical) | grid.backward(hits, !vertical);
+    side |= grid.forward(side, vertical) | grid.backward(side, vertical);
+    const Bitboard body = open & ~side;
+    const Bitboard notAfterHit = ~grid.forward(hits, vertical);
+    const Bitboard notBeforeHit = ~grid.backward(hits, vertical);
+
+    for (uint32_t length = 1;length<remaining.size();++length) {
+      if (remaining[length] == 0) continue;
+
+      // walk back from the last cell, so the ends may not touch a hit
+      Bitboard starts = body & notBeforeHit;
+      for (uint32_t i = 1;i<length;++i) starts = grid.backward(starts, vertical) & body;
+      starts &= notAfterHit;
+
+      // placements covering an unsunk hit start at most length-1 cells before it
+      Bitboard beforeHit = unsunk;
+      for (uint32_t i = 1;i<length;++i) beforeHit |= grid.backward(beforeHit, vertical);
+      const Bitboard starts1 = starts & beforeHit;
+      const Bitboard starts0 = starts & ~beforeHit;
+
+      Bitboard cells1 = starts1;
+      Bitboard cells0 = starts0;
+      for (uint32_t i = 0;i<length;++i) {
+        for (uint32_t j = 0;j<remaining[length];++j) {
+          throughHits.add(cells1);
+          elsewhere.add(cells0);
+        }
+        cells1 = grid.forward(cells1, vertical);
+        cells0 = grid.forward(cells0, vertical);
+      }
+    }
+  }
+
+  const Bitboard best = elsewhere.maxima(throughHits.maxima(unknown));
+  const uint32_t count = best.count();
+  const uint32_t cell = best.select(std::min(count-1, rand.rand<uint32_t>(0, count)));
+  return {cell % gridSize.x, cell / gridSize.x};
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include <Vec2.h>
+#include <Rand.h>
+
+#include "Bitboard.h"
+#include "ShipPlacement.h"
+
+// What is known about the ships of the other player, and where to shoot
+// next. For every ship not sunk yet, all placements are counted that are
+// legal with the shots so far: they avoid misses and sunken ships, and
+// they touch no hit, not even diagonally, other than the hits they cover.
+// The unknown cell covered by most placements through unsunk hits is
+// chosen, ties broken by the count of all other placements and then at
+// random. Both counts are taken for all cells at once, with bit sliced
+// counters over bitboards of the grid.
+class Targeting {
+public:
+  // throws std::runtime_error for grids of more than Bitboard::maxCells cells
+  Targeting(const Vec2ui& gridSize,
+            const std::vector<ShipSize>& fleet=ShipPlacement::completePlacement);
+
+  void addMiss(const Vec2ui& pos);
+  void addHit(const Vec2ui& pos);
+  // the cells of the ship count as hits, its size leaves the fleet
+  void addSunk(const ShipLocation& ship);
+
+  bool isKnown(const Vec2ui& pos) const;
+  size_t getRemainingShips() const;
+
+  Vec2ui nextShot(Random& rand) const;
+
+private:
+  Vec2ui gridSize;
+  BitboardGrid grid;
+  Bitboard misses;
+  Bitboard hits;
+  Bitboard sunk;
+  // remaining[l] ships of length l are left
+  std::vector<uint32_t> remaining;
+
+  uint32_t index(const Vec2ui& pos) const {return pos.x+pos.y*gridSize.x;}
+};
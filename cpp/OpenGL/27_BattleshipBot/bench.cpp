@@ -0,0 +1,371 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <optional>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <omp.h>
+
+#include <Rand.h>
+
+#include "GameGrid.h"
+#include "Targeting.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Headless self-play: the bot shoots at random fleets until all ships are
+// sunk. The fleets are placed like BoardSetupPhase does. First many games
+// are played on Targeting directly, spread over all threads. Then fewer
+// games are played serially through GameGrid, the way MainPhase shoots, once
+// with guessNextCell and once with the distance heuristic used before.
+// Every game is checked: the bot never shoots at a known cell, and the game
+// ends in at most one shot per cell.
+//
+//   battleshipBench [games] [comparisonGames]   defaults 1000000 and 10000
+
+const Vec2ui boardSize{15,15};  // as in BattleShips.h
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+struct Fleet {
+  std::vector<ShipLocation> ships;
+  std::vector<Bitboard> cells;
+};
+
+static Fleet randomFleet(Random& rand) {
+  const std::vector<ShipSize>& setup = ShipPlacement::completePlacement;
+  ShipPlacement placement{boardSize};
+  do {
+    placement = ShipPlacement{boardSize};
+    for (const ShipSize& s : setup) {
+      for (size_t i = 0;i<100;++i) {
+        const Orientation o = Orientation(rand.rand(0,2));
+        const uint32_t x = rand.rand<uint32_t>(0,boardSize.x);
+        const uint32_t y = rand.rand<uint32_t>(0,boardSize.y);
+        if (placement.addShip({s,o,{x,y}})) break;
+      }
+    }
+  } while (placement.getShips().size() != setup.size());
+
+  Fleet fleet;
+  for (const Ship& s : placement.getShips()) {
+    const ShipLocation location{s.pos, s.computeEnd()};
+    Bitboard cells;
+    for (uint32_t y = location.start.y;y<=location.end.y;y++)
+      for (uint32_t x = location.start.x;x<=location.end.x;x++)
+        cells.set(x+y*boardSize.x);
+    fleet.ships.push_back(location);
+    fleet.cells.push_back(cells);
+  }
+  return fleet;
+}
+
+struct Result {
+  size_t shots{0};
+  size_t decisions{0};
+  bool valid{true};
+};
+
+// the ship hit by a shot and whether it sinks
+struct Impact {
+  size_t ship;
+  bool sunk;
+};
+
+static std::optional<Impact> fire(const Fleet& fleet, std::vector<uint32_t>& damage, const Vec2ui& pos) {
+  const uint32_t cell = pos.x+pos.y*boardSize.x;
+  for (size_t i = 0;i<fleet.ships.size();++i) {
+    if (!fleet.cells[i].test(cell)) continue;
+    damage[i]++;
+    return Impact{i, damage[i] == fleet.cells[i].count()};
+  }
+  return {};
+}
+
+static Result playTargeting(const Fleet& fleet, Random& rand) {
+  Result result;
+  Targeting targeting{boardSize};
+  std::vector<uint32_t> damage(fleet.ships.size());
+  size_t sunk = 0;
+  while (sunk < fleet.ships.size()) {
+    const Vec2ui pos = targeting.nextShot(rand);
+    result.decisions++;
+    result.shots++;
+    if (targeting.isKnown(pos) || result.shots > boardSize.x*boardSize.y) {
+      result.valid = false;
+      return result;
+    }
+    const std::optional<Impact> impact = fire(fleet, damage, pos);
+    if (!impact) {
+      targeting.addMiss(pos);
+    } else if (impact->sunk) {
+      targeting.addSunk(fleet.ships[impact->ship]);
+      sunk++;
+    } else {
+      targeting.addHit(pos);
+    }
+  }
+  return result;
+}
+
+// guessNextCell and guessNextShipCell as they were before Targeting
+namespace legacy {
+  static uint32_t distSum(const GameGrid& g, const Vec2ui& pos) {
+    if (g.getCell(pos.x, pos.y) != Cell::Unknown) return 0;
+    uint32_t distX = 0;
+    for (uint32_t x = pos.x+1;x<g.getSize().x;x++) {
+      if (g.getCell(x, pos.y) != Cell::Unknown) break;
+      distX++;
+    }
+
+    uint32_t dist = 0;
+    for (int64_t x = int64_t(pos.x)-1;x>=0;x--) {
+      if (dist >= distX || g.getCell(uint32_t(x), pos.y) != Cell::Unknown) break;
+      dist++;
+    }
+    distX = std::min(dist, distX);
+
+    uint32_t distY = 0;
+    for (uint32_t y = pos.y+1;y<g.getSize().y;y++) {
+      if (g.getCell(pos.x, y) != Cell::Unknown) break;
+      distY++;
+    }
+
+    dist = 0;
+    for (int64_t y = int64_t(pos.y)-1;y>=0;y--) {
+      if (dist >= distY || g.getCell(pos.x, uint32_t(y)) != Cell::Unknown) break;
+      dist++;
+    }
+    distY = std::min(dist, distY);
+
+    return distY+distX;
+  }
+
+  static Vec2ui guessNextCell(const GameGrid& g, Random& rand) {
+    uint32_t maxMindist = 0;
+    for (uint32_t y = 0;y<g.getSize().y;y++) {
+      for (uint32_t x = 0;x<g.getSize().x;x++) {
+        maxMindist = std::max(maxMindist, distSum(g, {uint32_t(x), uint32_t(y)}));
+      }
+    }
+
+    std::vector<Vec2ui> candidates;
+    for (uint32_t y = 0;y<g.getSize().y;y++) {
+      for (uint32_t x = 0;x<g.getSize().x;x++) {
+        const Vec2ui p{uint32_t(x), uint32_t(y)};
+        if (distSum(g, p) == maxMindist) {
+          candidates.push_back(p);
+        }
+      }
+    }
+    return candidates[rand.rand<size_t>(0,candidates.size())];
+  }
+
+  static std::optional<Vec2ui> guessNextShipCellH(const GameGrid& g, const Vec2ui& pos) {
+    for (uint32_t x = pos.x+1;x<g.getSize().x;x++) {
+      const Cell c = g.getCell(x, pos.y);
+      if (c == Cell::Unknown) return Vec2ui{x, pos.y};
+      if (c == Cell::Empty || c == Cell::EmptyShot) break;
+    }
+    for (int64_t x = int64_t(pos.x)-1;x>=0;x--) {
+      const Cell c = g.getCell(uint32_t(x), pos.y);
+      if (c == Cell::Unknown) return Vec2ui{uint32_t(x), pos.y};
+      if (c == Cell::Empty || c == Cell::EmptyShot) break;
+    }
+    return {};
+  }
+
+  static std::optional<Vec2ui> guessNextShipCellV(const GameGrid& g, const Vec2ui& pos) {
+    for (uint32_t y = pos.y+1;y<g.getSize().y;y++) {
+      const Cell c = g.getCell(pos.x, y);
+      if (c == Cell::Unknown) return Vec2ui{pos.x, y};
+      if (c == Cell::Empty || c == Cell::EmptyShot) break;
+    }
+    for (int64_t y = int64_t(pos.y)-1;y>=0;y--) {
+      const Cell c = g.getCell(pos.x, uint32_t(y));
+      if (c == Cell::Unknown) return Vec2ui{pos.x, uint32_t(y)};
+      if (c == Cell::Empty || c == Cell::EmptyShot) break;
+    }
+    return {};
+  }
+
+  static Vec2ui guessNextShipCell(const GameGrid& g, const Vec2ui& pos, Random& rand) {
+    const bool horizontalFirst = rand.rand01() > 0.5f;
+    const auto ship = [&](uint32_t x, uint32_t y) {
+      return g.getCell(x, y) == Cell::Ship || g.getCell(x, y) == Cell::ShipShot;
+    };
+
+    bool searchHorizontal{true};
+    if (pos.y > 0 && ship(pos.x, pos.y-1)) searchHorizontal = false;
+    if (pos.y < g.getSize().y && ship(pos.x, pos.y+1)) searchHorizontal = false;
+
+    bool searchVertical{true};
+    if (pos.x > 0 && ship(pos.x-1, pos.y)) searchVertical = false;
+    if (pos.x < g.getSize().x && ship(pos.x+1, pos.y)) searchVertical = false;
+
+    if (horizontalFirst) {
+      if (searchHorizontal) {
+        const auto r = guessNextShipCellH(g, pos);
+        if (r) return *r;
+      }
+      const auto r = guessNextShipCellV(g, pos);
+      if (r) return *r;
+    } else {
+      if (searchVertical) {
+        const auto r = guessNextShipCellV(g, pos);
+        if (r) return *r;
+      }
+      const auto r = guessNextShipCellH(g, pos);
+      if (r) return *r;
+    }
+
+    return guessNextCell(g, rand);
+  }
+}
+
+// the shooting of MainPhase without the remembered positions. The distance
+// heuristic may shoot at known cells once only isolated cells are left,
+// those shots are counted but do not invalidate the game. When another
+// ship sinks while it is after one, it marks the cells around the first
+// hit of that one, as MainPhase did.
+static Result playGameGrid(const Fleet& fleet, Random& rand, bool useLegacy) {
+  Result result;
+  GameGrid board{boardSize};
+  std::vector<uint32_t> damage(fleet.ships.size());
+  size_t sunk = 0;
+  bool sinking = false;
+  Vec2ui hitCoords{0,0};
+  while (sunk < fleet.ships.size()) {
+    Vec2ui pos;
+    if (!useLegacy)
+      pos = board.guessNextCell();
+    else if (sinking)
+      pos = legacy::guessNextShipCell(board, hitCoords, rand);
+    else
+      pos = legacy::guessNextCell(board, rand);
+    result.decisions++;
+    result.shots++;
+    const bool known = board.getCell(pos.x, pos.y) != Cell::Unknown;
+    if ((known && !useLegacy) || result.shots > 10*boardSize.x*boardSize.y) {
+      result.valid = false;
+      return result;
+    }
+    if (known) continue;
+
+    const std::optional<Impact> impact = fire(fleet, damage, pos);
+    if (!impact) {
+      board.addMiss(pos);
+      continue;
+    }
+    board.addHit(pos, impact->sunk);
+    if (impact->sunk) {
+      sunk++;
+      sinking = false;
+      board.markAroundSunk(useLegacy ? hitCoords : pos);
+    } else {
+      if (!sinking) hitCoords = pos;
+      sinking = true;
+    }
+  }
+  if (!useLegacy && result.shots > boardSize.x*boardSize.y) result.valid = false;
+  return result;
+}
+
+struct Statistics {
+  size_t games{0};
+  size_t decisions{0};
+  std::vector<size_t> histogram;
+  bool valid{true};
+
+  void add(const Result& r) {
+    games++;
+    decisions += r.decisions;
+    if (histogram.size() <= r.shots) histogram.resize(r.shots+1);
+    histogram[r.shots]++;
+    valid = valid && r.valid;
+  }
+
+  void merge(const Statistics& o) {
+    games += o.games;
+    decisions += o.decisions;
+    if (histogram.size() < o.histogram.size()) histogram.resize(o.histogram.size());
+    for (size_t i = 0;i<o.histogram.size();++i) histogram[i] += o.histogram[i];
+    valid = valid && o.valid;
+  }
+
+  double average() const {
+    double sum = 0;
+    for (size_t i = 0;i<histogram.size();++i) sum += double(i)*histogram[i];
+    return sum/games;
+  }
+
+  size_t percentile(double p) const {
+    size_t seen = 0;
+    for (size_t i = 0;i<histogram.size();++i) {
+      seen += histogram[i];
+      if (seen >= p*games) return i;
+    }
+    return histogram.size();
+  }
+
+  void print(const std::string& name, double time) const {
+    std::cout << "  " << std::left << std::setw(24) << name << std::right << std::setw(8) << games
+              << " games, " << std::fixed << std::setprecision(2) << std::setw(6) << average()
+              << " shots to win (median " << percentile(0.5) << ", 90% " << percentile(0.9)
+              << ", worst " << histogram.size()-1 << "), " << std::setprecision(3)
+              << std::setw(8) << decisions/time/1e6 << " M decisions/s" << std::endl;
+  }
+};
+
+int main(int argc, char** argv) {
+  const size_t games = argc > 1 ? size_t(atof(argv[1])) : 1000000;
+  const size_t comparisonGames = argc > 2 ? size_t(atof(argv[2])) : 10000;
+
+  std::cout << boardSize.x << "x" << boardSize.y << " board, " << ShipPlacement::completePlacement.size()
+            << " ships, " << omp_get_max_threads() << " threads" << std::endl;
+
+  Statistics targeting;
+  auto t1 = Clock::now();
+#pragma omp parallel
+  {
+    Random rand(uint32_t(1234 + omp_get_thread_num()));
+    Statistics local;
+#pragma omp for schedule(dynamic, 256)
+    for (int64_t i = 0;i<int64_t(games);++i) {
+      local.add(playTargeting(randomFleet(rand), rand));
+    }
+#pragma omp critical
+    targeting.merge(local);
+  }
+  auto t2 = Clock::now();
+  targeting.print("Targeting", seconds(t1,t2));
+  if (!targeting.valid) {
+    std::cout << "  INVALID shot" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  // guessNextCell draws from staticRand, these games run on one thread
+  if (comparisonGames == 0) return EXIT_SUCCESS;
+  for (const bool useLegacy : {false, true}) {
+    Random rand(42);
+    Statistics stats;
+    double time = 0;
+    for (size_t i = 0;i<comparisonGames;++i) {
+      const Fleet fleet = randomFleet(rand);
+      t1 = Clock::now();
+      stats.add(playGameGrid(fleet, rand, useLegacy));
+      t2 = Clock::now();
+      time += seconds(t1,t2);
+    }
+    stats.print(useLegacy ? "distance heuristic" : "GameGrid::guessNextCell", time);
+    if (!stats.valid) {
+      std::cout << "  INVALID game" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
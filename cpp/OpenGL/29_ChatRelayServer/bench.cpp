@@ -0,0 +1,303 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+
+#include <Base64.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Compares the Base64 codec with the character at a time version it
+// replaced, which is kept below. Random buffers of every length up to 300
+// bytes are encoded with the standard and the url alphabet, their encodings
+// are decoded whole, truncated, with garbage appended and with random
+// characters overwritten, and the streaming classes get the same input in
+// random chunks. Everything has to match the old functions byte for byte.
+// Encoding and decoding of a large buffer is then timed in GB/s of binary
+// data, as the relay does for every keyed message.
+//
+//   base64Bench [megabytes]   default 64
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+namespace Legacy {
+  static const std::string base64_chars =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "abcdefghijklmnopqrstuvwxyz"
+  "0123456789+/";
+
+  static const std::string base64url_chars =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+  "abcdefghijklmnopqrstuvwxyz"
+  "0123456789-_";
+
+  static std::string encode(uint8_t const* buf, size_t bufLen, bool url) {
+    const std::string& chars = url ? base64url_chars : base64_chars;
+    std::string ret;
+    int i = 0;
+    int j = 0;
+    uint8_t char_array_3[3];
+    uint8_t char_array_4[4];
+
+    while (bufLen--) {
+      char_array_3[i++] = *(buf++);
+      if (i == 3) {
+        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+        char_array_4[3] = char_array_3[2] & 0x3f;
+
+        for(i = 0; (i <4) ; i++)
+          ret += chars[char_array_4[i]];
+        i = 0;
+      }
+    }
+
+    if (i)
+    {
+      for(j = i; j < 3; j++)
+        char_array_3[j] = '\0';
+
+      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
+      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
+      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
+      char_array_4[3] = char_array_3[2] & 0x3f;
+
+      for (j = 0; (j < i + 1); j++)
+        ret += chars[char_array_4[j]];
+
+      while((i++ < 3))
+        ret += url ? "%3d" : "=";
+    }
+
+    return ret;
+  }
+
+  static bool isBase64(uint8_t c, bool url) {
+    return isalnum(c) || (url ? (c == '-' || c == '_') : (c == '+' || c == '/'));
+  }
+
+  static void decode(const std::string& encoded_string, std::vector<uint8_t>& result, bool url) {
+    const std::string& chars = url ? base64url_chars : base64_chars;
+    int in_len = (int)encoded_string.size();
+    int i = 0;
+    int j = 0;
+    int in_ = 0;
+    uint8_t char_array_4[4], char_array_3[3];
+
+    result.clear();
+
+    while (in_len-- && ( encoded_string[in_] != (url ? '%' : '=')) && isBase64(encoded_string[in_], url)) {
+      char_array_4[i++] = encoded_string[in_]; in_++;
+      if (i ==4) {
+        for (i = 0; i <4; i++)
+          char_array_4[i] = (unsigned char)chars.find(char_array_4[i]);
+
+        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+        for (i = 0; (i < 3); i++)
+          result.push_back(char_array_3[i]);
+        i = 0;
+      }
+    }
+
+    if (i) {
+      for (j = i; j <4; j++)
+        char_array_4[j] = 0;
+
+      for (j = 0; j <4; j++)
+        char_array_4[j] = (unsigned char)chars.find(char_array_4[j]);
+
+      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+      for (j = 0; (j < i - 1); j++)
+        result.push_back(char_array_3[j]);
+    }
+  }
+
+  static std::string decodeString(const std::string& encoded_string, bool url) {
+    if (encoded_string.empty()) return "";
+    std::vector<uint8_t> decoded;
+    decode(encoded_string, decoded, url);
+    decoded.push_back(0);
+    return std::string((char*)decoded.data());
+  }
+}
+
+static std::mt19937 rng{42};
+
+static size_t randomSize(size_t limit) {
+  return std::uniform_int_distribution<size_t>(0, limit)(rng);
+}
+
+static std::vector<uint8_t> randomBytes(size_t size) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> data(size);
+  for (uint8_t& b : data) b = uint8_t(byte(rng));
+  return data;
+}
+
+// random cuts, including empty chunks
+static std::vector<size_t> randomChunks(size_t size) {
+  std::vector<size_t> cuts{0, size};
+  const size_t count = randomSize(6);
+  for (size_t i = 0;i<count;++i) cuts.push_back(randomSize(size));
+  std::sort(cuts.begin(), cuts.end());
+  return cuts;
+}
+
+static std::string streamEncode(const std::vector<uint8_t>& data, bool url) {
+  Base64Encoder encoder{url};
+  std::string text(Base64Encoder::maxEncodedSize(data.size()) + 10, '\0');
+  size_t count = 0;
+  const std::vector<size_t> cuts = randomChunks(data.size());
+  for (size_t i = 0;i+1<cuts.size();++i)
+    count += encoder.update(data.data()+cuts[i], cuts[i+1]-cuts[i], &text[count]);
+  count += encoder.finish(&text[count]);
+  text.resize(count);
+  return text;
+}
+
+static std::vector<uint8_t> streamDecode(const std::string& text, bool url) {
+  Base64Decoder decoder{url};
+  std::vector<uint8_t> data(Base64Decoder::maxDecodedSize(text.size()) + 2);
+  size_t count = 0;
+  const std::vector<size_t> cuts = randomChunks(text.size());
+  for (size_t i = 0;i+1<cuts.size();++i)
+    count += decoder.update(text.data()+cuts[i], cuts[i+1]-cuts[i], data.data()+count);
+  count += decoder.finish(data.data()+count);
+  data.resize(count);
+  return data;
+}
+
+static bool checkDecode(const std::string& text, bool url) {
+  std::vector<uint8_t> expected;
+  Legacy::decode(text, expected, url);
+  std::vector<uint8_t> decoded;
+  if (url) base64url_decode(text, decoded); else base64_decode(text, decoded);
+  const std::string decodedString = url ? base64url_decode(text) : base64_decode(text);
+  return decoded == expected && streamDecode(text, url) == expected &&
+         decodedString == Legacy::decodeString(text, url);
+}
+
+// the characters the garbage is drawn from, the alphabets with some
+// neighbours and bytes that are negative as char
+static char randomChar() {
+  static const std::string pool = "ABCZaz09+/-_=%3d .,:@[`{\x7f\x80\xc3\xff";
+  if (randomSize(1)) return pool[randomSize(pool.size()-1)];
+  return char(randomSize(255));
+}
+
+static bool check(size_t size, bool url) {
+  const std::vector<uint8_t> data = randomBytes(size);
+  const std::string text = url ? base64url_encode(data) : base64_encode(data);
+  const std::string expected = Legacy::encode(data.data(), data.size(), url);
+  if (text != expected || streamEncode(data, url) != expected) return false;
+
+  const std::string asString(data.begin(), data.end());
+  if ((url ? base64url_encode(asString) : base64_encode(asString)) != expected) return false;
+
+  if (!checkDecode(text, url) || !checkDecode(text.substr(0, randomSize(text.size())), url))
+    return false;
+
+  std::string garbage = text;
+  const size_t appended = randomSize(40);
+  for (size_t i = 0;i<appended;++i) garbage += randomChar();
+  if (!checkDecode(garbage, url)) return false;
+
+  if (!garbage.empty()) {
+    std::string overwritten = garbage;
+    const size_t count = randomSize(3);
+    for (size_t i = 0;i<count;++i) overwritten[randomSize(overwritten.size()-1)] = randomChar();
+    if (!checkDecode(overwritten, url)) return false;
+  }
+  return true;
+}
+
+static void report(const std::string& name, size_t bytes, double time, double reference) {
+  std::cout << "  " << std::left << std::setw(24) << name << std::right << std::fixed
+            << std::setprecision(3) << std::setw(9) << double(bytes)/time/1e9 << " GB/s";
+  if (reference > 0) std::cout << std::setw(8) << std::setprecision(1) << reference/time << "x";
+  std::cout << std::endl;
+}
+
+template <typename F>
+static double best(F f) {
+  double result = 1e30;
+  for (size_t i = 0;i<3;++i) {
+    const auto t1 = Clock::now();
+    f();
+    result = std::min(result, seconds(t1, Clock::now()));
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  const size_t megabytes = argc > 1 ? size_t(atol(argv[1])) : 64;
+
+  for (size_t round = 0;round<20;++round) {
+    for (size_t size = 0;size<=300;++size) {
+      for (const bool url : {false, true}) {
+        if (!check(size, url)) {
+          std::cout << "WRONG result for " << size << " bytes" << (url ? " url" : "") << std::endl;
+          return EXIT_FAILURE;
+        }
+      }
+    }
+  }
+  for (size_t i = 0;i<200;++i) {
+    if (!check(300 + randomSize(5000), i % 2 == 1)) {
+      std::cout << "WRONG result for a large buffer" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::cout << "checked" << std::endl;
+
+  const std::vector<uint8_t> data = randomBytes(megabytes << 20);
+  std::cout << megabytes << " MB" << std::endl;
+
+  std::string text;
+  const double legacyEncode = best([&] {text = Legacy::encode(data.data(), data.size(), false);});
+  report("old encode", data.size(), legacyEncode, 0);
+  const double encode = best([&] {text = base64_encode(data);});
+  report("encode", data.size(), encode, legacyEncode);
+
+  std::vector<char> chunkText(Base64Encoder::maxEncodedSize(1 << 16) + 10);
+  const double streamed = best([&] {
+    Base64Encoder encoder;
+    for (size_t i = 0;i<data.size();i += 1 << 16)
+      encoder.update(data.data()+i, std::min<size_t>(1 << 16, data.size()-i), chunkText.data());
+    encoder.finish(chunkText.data());
+  });
+  report("encode in 64 KB chunks", data.size(), streamed, legacyEncode);
+
+  std::vector<uint8_t> decoded;
+  const double legacyDecode = best([&] {Legacy::decode(text, decoded, false);});
+  report("old decode", data.size(), legacyDecode, 0);
+  const double decode = best([&] {base64_decode(text, decoded);});
+  report("decode", data.size(), decode, legacyDecode);
+  if (decoded != data) {
+    std::cout << "WRONG round trip" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<uint8_t> chunkData(Base64Decoder::maxDecodedSize(1 << 16) + 2);
+  const double streamedDecode = best([&] {
+    Base64Decoder decoder;
+    for (size_t i = 0;i<text.size();i += 1 << 16)
+      decoder.update(text.data()+i, std::min<size_t>(1 << 16, text.size()-i), chunkData.data());
+    decoder.finish(chunkData.data());
+  });
+  report("decode in 64 KB chunks", data.size(), streamedDecode, legacyDecode);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+#include <Vec2.h>
+#include <Rand.h>
+#include <DistanceTransform.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Renders antialiased discs, whose signed distance is known, at the given
+// sizes and transforms them with the chamfer propagation Grid2D used
+// before and with DistanceTransform. Errors are sampled over the whole
+// image and in a band of three pixels around the edges. A small smooth
+// field checks the transform against a brute force search for the nearest
+// edge pixels.
+//
+//   sdtBench [sizes...]   defaults 1024 4096 16384
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// the previous Grid2D::toSignedDistance
+static std::vector<float> legacySignedDistance(const std::vector<float>& data, size_t width, size_t height,
+                                               float threshold) {
+  const float d1{1.0f};
+  const float d2{1.4142135624f};
+  const float INV = std::numeric_limits<float>::max();
+  const Vec2ui NO_POS{std::numeric_limits<uint32_t>::max(), std::numeric_limits<uint32_t>::max()};
+  const auto index = [&](size_t x, size_t y) {return x + y * width;};
+  const auto dist = [](size_t x, size_t y, const Vec2ui& p) {
+    return sqrtf((x-float(p.x))*(x-float(p.x)) + (y-float(p.y))*(y-float(p.y)));
+  };
+
+  std::vector<float> r(width*height, INV);
+  std::vector<bool> I(width*height);
+  std::vector<Vec2ui> p(width*height, NO_POS);
+  for (size_t i = 0;i<I.size();++i) I[i] = data[i] >= threshold;
+
+  for (size_t y = 1; y<height-1; y++) {
+    for (size_t x = 1; x<width-1; x++) {
+      const size_t i = index(x,y);
+      if (I[index(x-1,y)] != I[i] || I[index(x+1,y)] != I[i] || I[index(x,y+1)] != I[i] || I[index(x,y-1)] != I[i]) {
+        r[i] = 0;
+        p[i] = Vec2ui(uint32_t(x),uint32_t(y));
+      }
+    }
+  }
+  const auto propagate = [&](size_t x, size_t y, size_t nx, size_t ny, float d) {
+    const size_t i = index(x,y);
+    const size_t n = index(nx,ny);
+    if (r[n]+d < r[i]) {
+      p[i] = p[n];
+      r[i] = dist(x, y, p[i]);
+    }
+  };
+  for (size_t y = 1; y<height-1; y++) {
+    for (size_t x = 1; x<width-1; x++) {
+      propagate(x, y, x-1, y-1, d2);
+      propagate(x, y, x, y-1, d1);
+      propagate(x, y, x+1, y-1, d2);
+      propagate(x, y, x-1, y, d1);
+    }
+  }
+  for (size_t y = height-2; y>=1; y--) {
+    for (size_t x = width-2; x>=1; x--) {
+      propagate(x, y, x+1, y, d1);
+      propagate(x, y, x-1, y+1, d2);
+      propagate(x, y, x, y+1, d1);
+      propagate(x, y, x+1, y+1, d2);
+    }
+  }
+  for (size_t i = 0;i<I.size();++i) if (!I[i]) r[i] = -r[i];
+  return r;
+}
+
+struct Disc {
+  float x;
+  float y;
+  float radius;
+};
+
+static std::vector<Disc> placeDiscs(size_t size, Random& random) {
+  std::vector<Disc> discs;
+  for (size_t attempt = 0;attempt<1000 && discs.size()<24;++attempt) {
+    const float radius = size*(1.0f/64.0f + random.rand01()/16.0f);
+    const Disc d{radius+2+random.rand01()*(size-2*radius-4), radius+2+random.rand01()*(size-2*radius-4), radius};
+    bool free = true;
+    for (const Disc& o : discs)
+      free = free && std::hypot(d.x-o.x, d.y-o.y) > d.radius+o.radius+8;
+    if (free) discs.push_back(d);
+  }
+  return discs;
+}
+
+// coverage ramping over one pixel across the circle, 0.5 on it
+static std::vector<float> renderDiscs(const std::vector<Disc>& discs, size_t size) {
+  std::vector<float> data(size*size, 0.0f);
+  for (const Disc& d : discs) {
+    const size_t x0 = size_t(std::max(0.0f, d.x-d.radius-2));
+    const size_t x1 = std::min(size, size_t(d.x+d.radius+3));
+    const size_t y0 = size_t(std::max(0.0f, d.y-d.radius-2));
+    const size_t y1 = std::min(size, size_t(d.y+d.radius+3));
+    for (size_t y = y0;y<y1;++y) {
+      for (size_t x = x0;x<x1;++x) {
+        const float coverage = std::clamp(0.5f + d.radius - std::hypot(x-d.x, y-d.y), 0.0f, 1.0f);
+        data[x+y*size] = std::max(data[x+y*size], coverage);
+      }
+    }
+  }
+  return data;
+}
+
+static float trueDistance(const std::vector<Disc>& discs, float x, float y) {
+  float outside = std::numeric_limits<float>::max();
+  for (const Disc& d : discs) {
+    const float sd = d.radius - std::hypot(x-d.x, y-d.y);
+    if (sd >= 0) return sd;
+    outside = std::min(outside, -sd);
+  }
+  return -outside;
+}
+
+struct Samples {
+  std::vector<std::pair<size_t, size_t>> all;
+  std::vector<std::pair<size_t, size_t>> band;
+};
+
+// away from the outermost pixels, the chamfer transform never reached them
+static Samples drawSamples(const std::vector<Disc>& discs, size_t size, Random& random) {
+  Samples s;
+  for (size_t i = 0;i<200000;++i)
+    s.all.push_back({1+random.rand<size_t>(0,size-2), 1+random.rand<size_t>(0,size-2)});
+  for (size_t i = 0;i<200000;++i) {
+    const Disc& d = discs[i % discs.size()];
+    const float angle = random.rand0Pi();
+    const float r = d.radius + 3*random.rand11();
+    s.band.push_back({size_t(std::lround(d.x + r*std::cos(angle))), size_t(std::lround(d.y + r*std::sin(angle)))});
+  }
+  return s;
+}
+
+static void printError(const std::string& name, double time, const std::vector<float>& sdf,
+                       const std::vector<Disc>& discs, const Samples& samples, size_t size) {
+  const auto error = [&](const std::vector<std::pair<size_t, size_t>>& points, double& mean, double& max) {
+    mean = 0;
+    max = 0;
+    for (const auto& p : points) {
+      const double e = std::abs(sdf[p.first + p.second*size] - trueDistance(discs, float(p.first), float(p.second)));
+      mean += e;
+      max = std::max(max, e);
+    }
+    mean /= points.size();
+  };
+  double meanAll, maxAll, meanBand, maxBand;
+  error(samples.all, meanAll, maxAll);
+  error(samples.band, meanBand, maxBand);
+  std::cout << std::setw(10) << name << ": " << std::fixed << std::setprecision(3) << std::setw(8) << time
+            << " s, error mean " << meanAll << " max " << maxAll << ", near edges mean " << meanBand
+            << " max " << maxBand << std::endl;
+}
+
+static bool checkBruteForce() {
+  const size_t width = 97;
+  const size_t height = 61;
+  std::vector<float> data(width*height);
+  for (size_t y = 0;y<height;++y)
+    for (size_t x = 0;x<width;++x)
+      data[x+y*width] = std::sin(x*0.21f) * std::cos(y*0.17f+0.3f) + 0.3f*std::sin((x+y)*0.05f);
+  const float threshold = 0.1f;
+  const std::vector<float> sdf = DistanceTransform::signedDistance(data, width, height, threshold);
+
+  const auto inside = [&](int64_t x, int64_t y) {return data[size_t(x+y*int64_t(width))] >= threshold;};
+  const auto across = [&](int64_t x, int64_t y, int64_t nx, int64_t ny) {
+    return nx >= 0 && ny >= 0 && nx < int64_t(width) && ny < int64_t(height) && inside(nx,ny) != inside(x,y);
+  };
+  const auto offset = [&](int64_t x, int64_t y, int64_t nx, int64_t ny) {
+    const float v = data[size_t(x+y*int64_t(width))];
+    return (v - threshold) / (v - data[size_t(nx+ny*int64_t(width))]);
+  };
+  // distance of an edge pixel to the line, infinite for other pixels, and
+  // the point on the line it is closest to
+  std::vector<float> edge(width*height, std::numeric_limits<float>::infinity());
+  std::vector<float> lineX(width*height);
+  std::vector<float> lineY(width*height);
+  for (int64_t y = 0;y<int64_t(height);++y) {
+    for (int64_t x = 0;x<int64_t(width);++x) {
+      float fx = std::numeric_limits<float>::infinity();
+      float fy = std::numeric_limits<float>::infinity();
+      if (across(x,y,x-1,y)) fx = std::min(fx, offset(x,y,x-1,y));
+      if (across(x,y,x+1,y)) fx = std::min(fx, offset(x,y,x+1,y));
+      if (across(x,y,x,y-1)) fy = std::min(fy, offset(x,y,x,y-1));
+      if (across(x,y,x,y+1)) fy = std::min(fy, offset(x,y,x,y+1));
+      const size_t i = size_t(x+y*int64_t(width));
+      float& e = edge[i];
+      if (std::isinf(fx)) e = fy;
+      else if (std::isinf(fy)) e = fx;
+      else e = fx*fy/std::sqrt(fx*fx+fy*fy);
+
+      // moved by e along the gradient onto the line
+      const auto value = [&](int64_t nx, int64_t ny) {
+        nx = std::clamp<int64_t>(nx, 0, int64_t(width)-1);
+        ny = std::clamp<int64_t>(ny, 0, int64_t(height)-1);
+        return data[size_t(nx+ny*int64_t(width))];
+      };
+      const float gx = value(x+1,y) - value(x-1,y);
+      const float gy = value(x,y+1) - value(x,y-1);
+      const float length = std::sqrt(gx*gx+gy*gy);
+      const float step = std::isinf(e) || length == 0.0f ? 0.0f : (inside(x,y) ? -1.0f : 1.0f) * e / length;
+      lineX[i] = x + gx*step;
+      lineY[i] = y + gy*step;
+    }
+  }
+
+  for (int64_t y = 0;y<int64_t(height);++y) {
+    for (int64_t x = 0;x<int64_t(width);++x) {
+      const size_t i = size_t(x+y*int64_t(width));
+      const float d = inside(x,y) ? sdf[i] : -sdf[i];
+      if (!std::isinf(edge[i])) {
+        if (std::abs(d - edge[i]) > 1e-5f) return false;
+        continue;
+      }
+      // any of the nearest edge pixels may have been chosen
+      int64_t nearest = std::numeric_limits<int64_t>::max();
+      for (int64_t qy = 0;qy<int64_t(height);++qy)
+        for (int64_t qx = 0;qx<int64_t(width);++qx)
+          if (!std::isinf(edge[size_t(qx+qy*int64_t(width))]))
+            nearest = std::min(nearest, (qx-x)*(qx-x) + (qy-y)*(qy-y));
+      bool found = false;
+      for (int64_t qy = 0;qy<int64_t(height);++qy) {
+        for (int64_t qx = 0;qx<int64_t(width);++qx) {
+          const size_t q = size_t(qx+qy*int64_t(width));
+          if (std::isinf(edge[q]) || (qx-x)*(qx-x) + (qy-y)*(qy-y) != nearest) continue;
+          const float expected = std::hypot(x-lineX[q], y-lineY[q]);
+          found = found || std::abs(d - expected) < 1e-4f;
+        }
+      }
+      if (!found) return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1;i<argc;++i) sizes.push_back(size_t(atoi(argv[i])));
+  if (sizes.empty()) sizes = {1024, 4096, 16384};
+
+  std::cout << "smooth field " << (checkBruteForce() ? "matches" : "DIFFERS FROM") << " brute force" << std::endl;
+
+  Random random{11};
+  for (const size_t size : sizes) {
+    const std::vector<Disc> discs = placeDiscs(size, random);
+    const Samples samples = drawSamples(discs, size, random);
+    const std::vector<float> data = renderDiscs(discs, size);
+    std::cout << size << "x" << size << ", " << discs.size() << " discs" << std::endl;
+
+    {
+      const auto t1 = Clock::now();
+      const std::vector<float> sdf = DistanceTransform::signedDistance(data, size, size, 0.5f);
+      const auto t2 = Clock::now();
+      printError("exact EDT", seconds(t1,t2), sdf, discs, samples, size);
+    }
+    {
+      const auto t1 = Clock::now();
+      const std::vector<float> sdf = legacySignedDistance(data, size, size, 0.5f);
+      const auto t2 = Clock::now();
+      printError("chamfer", seconds(t1,t2), sdf, discs, samples, size);
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -140,7 +140,39 @@ CacheFileGenerator::~CacheFileGenerator() {
   
 void CacheFileGenerator::addImage(const std::string& filename) {
   const Image image = BMP::load(filename).cropToAspectAndResample(smallImageResolution.x, smallImageResolution.y);
-  const MD5Hash hash = MD5::computeMD5(image.data);
+  addImage(image, MultiHash::hash(MultiHash::Algorithm::MD5, image.data.data(), image.data.size()));
+}
+
+void CacheFileGenerator::addImages(const std::vector<std::string>& filenames) {
+  std::vector<Image> images(filenames.size(), Image(0,0));
+  std::vector<uint8_t> loaded(filenames.size(), 0);
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t i = 0;i<int64_t(filenames.size());++i) {
+    try {
+      images[size_t(i)] = BMP::load(filenames[size_t(i)]).cropToAspectAndResample(smallImageResolution.x,
+                                                                                  smallImageResolution.y);
+      loaded[size_t(i)] = 1;
+    } catch (...) {
+    }
+  }
+
+  std::vector<MultiHash::Buffer> buffers;
+  for (size_t i = 0;i<images.size();++i)
+    if (loaded[i]) buffers.push_back({images[i].data.data(), images[i].data.size()});
+  const std::vector<MultiHash::Digest> digests = MultiHash::hashBuffers(MultiHash::Algorithm::MD5, buffers);
+
+  size_t next = 0;
+  for (size_t i = 0;i<images.size();++i) {
+    if (!loaded[i]) continue;
+    try {
+      addImage(images[i], digests[next]);
+    } catch (...) {
+    }
+    ++next;
+  }
+}
+
+void CacheFileGenerator::addImage(const Image& image, const MultiHash::Digest& hash) {
   if (hashes.find(hash) != hashes.end()) return;
   
   const CacheFileEntry e{image, file, smallImageResolution, largeImageBlockSize, offset};
@@ -9,7 +9,7 @@
 #include <Vec3.h>
 #include <Vec2.h>
 #include <Image.h>
-#include <MD5.h>
+#include <MultiHash.h>
 
 std::vector<Vec3t<double>> computeFeatureTensorForImage(const Image& image,
                                                         const Vec2ui& globalStart,
@@ -78,13 +78,16 @@ public:
   ~CacheFileGenerator();
   
   void addImage(const std::string& filename);
+  // loads and resamples the images in parallel and hashes them in groups,
+  // images that can't be loaded are skipped
+  void addImages(const std::vector<std::string>& filenames);
   size_t getImageCount() const {
     return cacheFileEntries.size();
   }
   
 private:
   std::ofstream file;
-  std::map<MD5Hash, bool> hashes;
+  std::map<MultiHash::Digest, bool> hashes;
   
   const Vec2ui& smallImageResolution;
   const Vec2ui& largeImageBlockSize;
@@ -92,6 +95,7 @@ private:
   uint64_t offset;
   std::vector<CacheFileEntry> cacheFileEntries;
   
+  void addImage(const Image& image, const MultiHash::Digest& hash);
   size_t getHeaderSize() const;
   size_t getVectorSize() const;
 };
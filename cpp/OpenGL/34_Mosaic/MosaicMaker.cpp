@@ -55,14 +55,13 @@ void MosaicMaker::updateSmallImageCache() {
     CacheFileGenerator gen(smallImageResolution, largeImageBlockSize, files.size(), cacheFilename);
 
     startProgress(uint32_t(files.size()));
-    uint32_t element{1};
     
-    for (const std::string& filename: files) {
-      setProgress(element++);
-      try {
-        gen.addImage(filename);
-      } catch (...) {
-      }
+    // groups of images are loaded in parallel and hashed together
+    const size_t groupSize = 64;
+    for (size_t first = 0;first<files.size();first += groupSize) {
+      const size_t last = std::min(files.size(), first+groupSize);
+      gen.addImages({files.begin()+std::ptrdiff_t(first), files.begin()+std::ptrdiff_t(last)});
+      setProgress(uint32_t(last));
     }
     
     if (gen.getImageCount() == 1)
@@ -0,0 +1,255 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+
+#include <MD5.h>
+#include <SHA2.h>
+#include <MultiHash.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Checks every compiled in MultiHash backend against the MD5 and SHA256
+// classes: single buffers of every length up to 1000 bytes, the same data
+// streamed in random pieces, groups of buffers of mixed lengths so lanes
+// finish at different times, the Merkle mode against its definition and
+// hashFiles on a directory of small, streamed and missing files. Then the
+// throughput per algorithm and backend is reported in GB/s, for one large
+// buffer, for as many small images as the mosaic cache hashes, in Merkle
+// mode on every core and for files read from disk.
+//
+//   hashBench [megabytes]   default 256
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+using MultiHash::Algorithm;
+using MultiHash::Backend;
+using MultiHash::Digest;
+
+static std::mt19937 rng{7};
+
+static std::vector<uint8_t> randomBytes(size_t size) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> data(size);
+  for (uint8_t& b : data) b = uint8_t(byte(rng));
+  return data;
+}
+
+static Digest reference(Algorithm algorithm, const uint8_t* data, size_t size) {
+  if (algorithm == Algorithm::MD5) {
+    MD5 md5;
+    int error = 0;
+    md5.update((uint8_t*)data, uint32_t(size), error);
+    return md5.final(error);
+  }
+  SHA256 sha;
+  sha.init();
+  sha.update(data, (unsigned int)size);
+  sha.final();
+  Digest digest;
+  sha.getDigest(digest);
+  return digest;
+}
+
+static std::string name(Algorithm algorithm) {
+  return algorithm == Algorithm::MD5 ? "MD5" : "SHA-256";
+}
+
+static std::string name(Backend backend) {
+  switch (backend) {
+    case Backend::Auto : return "auto";
+    case Backend::Scalar : return "scalar";
+    case Backend::AVX2 : return "AVX2";
+    case Backend::SHANI : return "SHA-NI";
+  }
+  return "";
+}
+
+static std::vector<Backend> backends(Algorithm algorithm) {
+  std::vector<Backend> result;
+  for (Backend b : {Backend::Scalar, Backend::AVX2, Backend::SHANI, Backend::Auto})
+    if (MultiHash::isAvailable(algorithm, b)) result.push_back(b);
+  return result;
+}
+
+static bool checkKnown() {
+  const std::string abc = "abc";
+  const uint8_t* data = (const uint8_t*)abc.data();
+  return MultiHash::toHexString(MultiHash::hash(Algorithm::MD5, data, 0)) == "d41d8cd98f00b204e9800998ecf8427e" &&
+         MultiHash::toHexString(MultiHash::hash(Algorithm::MD5, data, 3)) == "900150983cd24fb0d6963f7d28e17f72" &&
+         MultiHash::toHexString(MultiHash::hash(Algorithm::SHA256, data, 3)) ==
+           "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+}
+
+static bool check(Algorithm algorithm, Backend backend) {
+  const std::vector<uint8_t> data = randomBytes(20000);
+
+  std::vector<MultiHash::Buffer> buffers;
+  std::vector<Digest> expected;
+  for (size_t size = 0;size<=1000;++size) {
+    const uint8_t* start = data.data() + size*7;
+    const Digest digest = reference(algorithm, start, size);
+    if (MultiHash::hash(algorithm, start, size, backend) != digest) return false;
+
+    MultiHash::Hasher hasher{algorithm, backend};
+    for (size_t done = 0;done<size;) {
+      const size_t piece = std::min(size-done, size_t(std::uniform_int_distribution<int>(0, 150)(rng)));
+      hasher.update(start+done, piece);
+      done += piece;
+    }
+    if (hasher.finish() != digest) return false;
+
+    buffers.push_back({start, size});
+    expected.push_back(digest);
+  }
+  // long messages among short ones keep some lanes busy while others refill
+  for (size_t i = 0;i<40;++i) {
+    const size_t size = std::uniform_int_distribution<size_t>(0, 20000)(rng);
+    buffers.push_back({data.data(), size});
+    expected.push_back(reference(algorithm, data.data(), size));
+  }
+  std::shuffle(buffers.begin(), buffers.end(), std::mt19937{3});
+  std::shuffle(expected.begin(), expected.end(), std::mt19937{3});
+  if (MultiHash::hashBuffers(algorithm, buffers, backend) != expected) return false;
+  for (size_t count = 0;count<12;++count) {
+    const std::vector<MultiHash::Buffer> few(buffers.begin(), buffers.begin()+std::ptrdiff_t(count));
+    if (MultiHash::hashBuffers(algorithm, few, backend) != std::vector<Digest>(expected.begin(), expected.begin()+std::ptrdiff_t(count)))
+      return false;
+  }
+
+  for (const size_t chunkSize : {64, 1000, 4096, 30000}) {
+    std::vector<uint8_t> leaves;
+    for (size_t c = 0;c==0 || c*chunkSize<data.size();++c) {
+      const Digest leaf = reference(algorithm, data.data()+c*chunkSize, std::min(chunkSize, data.size()-c*chunkSize));
+      leaves.insert(leaves.end(), leaf.begin(), leaf.end());
+    }
+    if (MultiHash::hashChunked(algorithm, data.data(), data.size(), chunkSize, 3, backend) !=
+        reference(algorithm, leaves.data(), leaves.size())) return false;
+  }
+  return MultiHash::hashChunked(algorithm, data.data(), 0, 64, 2, backend) ==
+         reference(algorithm, reference(algorithm, data.data(), 0).data(), MultiHash::digestSize(algorithm));
+}
+
+static std::vector<std::string> writeFiles(const std::filesystem::path& directory,
+                                           const std::vector<std::vector<uint8_t>>& contents) {
+  std::filesystem::create_directories(directory);
+  std::vector<std::string> filenames;
+  for (size_t i = 0;i<contents.size();++i) {
+    filenames.push_back((directory / ("file" + std::to_string(i) + ".bin")).string());
+    std::ofstream file{filenames.back(), std::ios::binary};
+    file.write((const char*)contents[i].data(), std::streamsize(contents[i].size()));
+  }
+  return filenames;
+}
+
+static bool checkFiles(const std::filesystem::path& directory) {
+  std::vector<std::vector<uint8_t>> contents;
+  for (size_t i = 0;i<50;++i) contents.push_back(randomBytes(std::uniform_int_distribution<size_t>(0, 3000)(rng)));
+  contents.push_back(randomBytes(100000));
+  std::vector<std::string> filenames = writeFiles(directory, contents);
+  filenames.insert(filenames.begin()+10, (directory / "missing.bin").string());
+  contents.insert(contents.begin()+10, std::vector<uint8_t>());
+
+  for (Algorithm algorithm : {Algorithm::MD5, Algorithm::SHA256}) {
+    for (size_t threads : {1, 3}) {
+      // files above 10000 bytes are streamed
+      const std::vector<Digest> digests = MultiHash::hashFiles(algorithm, filenames, threads, 10000);
+      for (size_t i = 0;i<filenames.size();++i) {
+        const Digest expected = i == 10 ? Digest() : reference(algorithm, contents[i].data(), contents[i].size());
+        if (digests[i] != expected) return false;
+      }
+    }
+  }
+  std::filesystem::remove_all(directory);
+  return true;
+}
+
+static void report(const std::string& what, size_t bytes, double time, double reference) {
+  std::cout << "  " << std::left << std::setw(36) << what << std::right << std::fixed
+            << std::setprecision(3) << std::setw(8) << double(bytes)/time/1e9 << " GB/s";
+  if (reference > 0) std::cout << std::setw(8) << std::setprecision(1) << reference/time << "x";
+  std::cout << std::endl;
+}
+
+template <typename F>
+static double best(F f) {
+  double result = 1e30;
+  for (size_t i = 0;i<3;++i) {
+    const auto t1 = Clock::now();
+    f();
+    result = std::min(result, seconds(t1, Clock::now()));
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  const size_t megabytes = argc > 1 ? size_t(atol(argv[1])) : 256;
+  const std::filesystem::path directory = std::filesystem::temp_directory_path() / "hashBench";
+
+  if (!checkKnown()) {
+    std::cout << "WRONG known digests" << std::endl;
+    return EXIT_FAILURE;
+  }
+  for (Algorithm algorithm : {Algorithm::MD5, Algorithm::SHA256}) {
+    for (Backend backend : backends(algorithm)) {
+      if (!check(algorithm, backend)) {
+        std::cout << "WRONG result for " << name(algorithm) << " " << name(backend) << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  if (!checkFiles(directory)) {
+    std::cout << "WRONG result for hashFiles" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "checked" << std::endl;
+
+  const std::vector<uint8_t> data = randomBytes(megabytes << 20);
+  // images of 128x128 RGB pixels, as the mosaic cache stores them
+  const size_t imageSize = 128*128*3;
+  std::vector<MultiHash::Buffer> images;
+  for (size_t offset = 0;offset+imageSize<=data.size();offset += imageSize)
+    images.push_back({data.data()+offset, imageSize});
+  const size_t imageBytes = images.size()*imageSize;
+
+  for (Algorithm algorithm : {Algorithm::MD5, Algorithm::SHA256}) {
+    std::cout << name(algorithm) << ", " << megabytes << " MB" << std::endl;
+    const double old = best([&] {reference(algorithm, data.data(), data.size());});
+    report("old class, one buffer", data.size(), old, 0);
+    const double oldImages = best([&] {for (const auto& i : images) reference(algorithm, i.data, i.size);});
+    report("old class, " + std::to_string(images.size()) + " images", imageBytes, oldImages, 0);
+
+    for (Backend backend : backends(algorithm)) {
+      if (backend != Backend::AVX2)
+        report(name(backend) + ", one buffer", data.size(),
+               best([&] {MultiHash::hash(algorithm, data.data(), data.size(), backend);}), old);
+      report(name(backend) + ", images", imageBytes,
+             best([&] {MultiHash::hashBuffers(algorithm, images, backend);}), oldImages);
+    }
+    report("Merkle 1 MB chunks, all threads", data.size(),
+           best([&] {MultiHash::hashChunked(algorithm, data.data(), data.size());}), old);
+  }
+
+  // the images as files, the old way hashes one file after the other
+  std::vector<std::vector<uint8_t>> contents;
+  for (size_t i = 0;i<std::min<size_t>(images.size(), 2000);++i)
+    contents.emplace_back(images[i].data, images[i].data+imageSize);
+  const std::vector<std::string> filenames = writeFiles(directory, contents);
+  const size_t fileBytes = filenames.size()*imageSize;
+  std::cout << filenames.size() << " files" << std::endl;
+  const double oldFiles = best([&] {for (const std::string& f : filenames) MD5::computeMD5(f);});
+  report("MD5::computeMD5 one by one", fileBytes, oldFiles, 0);
+  for (Algorithm algorithm : {Algorithm::MD5, Algorithm::SHA256})
+    report("hashFiles " + name(algorithm), fileBytes,
+           best([&] {MultiHash::hashFiles(algorithm, filenames);}), oldFiles);
+  std::filesystem::remove_all(directory);
+  return EXIT_SUCCESS;
+}
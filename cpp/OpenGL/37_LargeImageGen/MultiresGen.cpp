@@ -2,7 +2,6 @@
 #include <sstream>
 
 #include <bmp.h>
-#include <Fractal.h>
 
 #include "MultiresGen.h"
 
@@ -27,7 +26,7 @@ std::streampos MultiresGen::generateHeader(std::fstream& file) const {
 }
 
 void MultiresGen::generateLevelZero(TilePositions& tilePositions,
-                                    cl_device_id dev,
+                                    FractalDevice dev,
                                     std::fstream& file) const {
   std::cout << "Starting fractal computation ... " << std::endl;
 
@@ -359,7 +358,7 @@ void MultiresGen::storeTilePositions(const TilePositions& tilePositions,
   file.write((char*)&tilePositionsOffset, sizeof(tilePositionsOffset));
 }
 
-void MultiresGen::generate(cl_device_id dev, const std::string& filename) const {
+void MultiresGen::generate(FractalDevice dev, const std::string& filename) const {
   std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
   
   
@@ -6,7 +6,16 @@
 
 #include <Vec3.h>
 
+#ifdef CPU_FRACTAL
+#include <MandelbrotEngine.h>
+using Fractal = MandelbrotEngine;
+// number of worker threads, 0 uses all cores
+using FractalDevice = uint32_t;
+#else
+#include <Fractal.h>
 #include <OpenClUtils.h>
+using FractalDevice = cl_device_id;
+#endif
 
 struct TileCoord {
   uint32_t x;
@@ -25,7 +34,7 @@ using TilePositions = std::map<TileCoord, int64_t>;
 class MultiresGen {
 public:
   MultiresGen(uint32_t inputDim, uint32_t tileDim, uint32_t overlap);  
-  void generate(cl_device_id dev, const std::string& filename) const;
+  void generate(FractalDevice dev, const std::string& filename) const;
 
 private:
   const uint32_t inputDim;
@@ -36,7 +45,7 @@ private:
   const size_t totalTileSize;
 
   std::streampos generateHeader(std::fstream& file) const;
-  void generateLevelZero(TilePositions& tilePositions, cl_device_id dev, std::fstream& file) const;
+  void generateLevelZero(TilePositions& tilePositions, FractalDevice dev, std::fstream& file) const;
   void generateHierarchy(TilePositions& tilePositions, std::fstream& file) const;
   void generateInnerTilesOfLevel(uint32_t level, uint32_t levelSize,
                                  std::vector<uint8_t>& tempTile,
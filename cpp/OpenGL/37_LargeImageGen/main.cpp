@@ -3,12 +3,14 @@
 
 #include "MultiresGen.h"
 
-#include <OpenClUtils.h>
-
 typedef std::chrono::high_resolution_clock Clock;
 
 int main(int argc, char** argv) {
-  cl_device_id dev = selectOpenCLDevice();  
+#ifdef CPU_FRACTAL
+  const FractalDevice dev = 0;
+#else
+  cl_device_id dev = selectOpenCLDevice();
+#endif
   MultiresGen multi(1<<19,512,1);
   
   auto t1 = Clock::now();
@@ -145,18 +145,18 @@ studs(depth*width)
 }
 
  
-std::vector<Vec2t<uint16_t>> SimpleYAK42::studsTop() const {
+const std::vector<Vec2t<uint16_t>>& SimpleYAK42::studsTop() const {
   return studs;
 }
 
-std::vector<Vec2t<uint16_t>> SimpleYAK42::studsBottom() const {
+const std::vector<Vec2t<uint16_t>>& SimpleYAK42::studsBottom() const {
   return studs;
 }
 
 Vec3 SimpleYAK42::computeGlobalStudPos(size_t i) const {
 
-  const uint16_t x = studsTop()[i].x;
-  const uint16_t z = studsTop()[i].y;
+  const uint16_t x = studs[i].x;
+  const uint16_t z = studs[i].y;
   
   const Vec3 relativePos {
     -0.5f*brickScale.x*width+studSpacing/2.0f+studRadius + (studSpacing+2*studRadius)*x,
@@ -176,3 +176,20 @@ AABB SimpleYAK42::computeAABB() const {
   return aabb;
 }
 
+Vec3i SimpleYAK42::computeLatticeStudPos(size_t i, bool top) const {
+  const Vec3i pos = getIntegerPos();
+  return Vec3i{
+    2*pos.x - width + 1 + 2*studs[i].x,
+    2*pos.y + (top ? height : -int32_t(height)),
+    2*pos.z - depth + 1 + 2*studs[i].y
+  };
+}
+
+void SimpleYAK42::computeLatticeCells(std::vector<Vec3i>& cells) const {
+  for (size_t i = 0;i<studsBottom().size();++i) {
+    const Vec3i bottom = computeLatticeStudPos(i, false);
+    for (uint16_t plate = 0;plate<height;++plate) {
+      cells.push_back(Vec3i{bottom.x, bottom.y+2*plate+1, bottom.z});
+    }
+  }
+}
@@ -25,14 +25,22 @@ public:
         uint16_t colorCode) : pos(pos), colorCode(colorCode) {}
   virtual ~YAK42() {};
   
-  virtual std::vector<Vec2t<uint16_t>> studsTop() const = 0;
-  virtual std::vector<Vec2t<uint16_t>> studsBottom() const = 0;
+  virtual const std::vector<Vec2t<uint16_t>>& studsTop() const = 0;
+  virtual const std::vector<Vec2t<uint16_t>>& studsBottom() const = 0;
 
   Vec3i getIntegerPos() const {return pos;}
   Vec3 getPos() const {return Vec3{pos}/Vec3{1,3,1};}
 
   virtual Vec3 computeGlobalStudPos(size_t i) const = 0;
   virtual AABB computeAABB() const = 0;
+
+  // The lattice of half studs and half plates, on which stud centers and
+  // the centers of cells of one stud by one plate fall on integers. The
+  // center of stud i of studsTop() or studsBottom(), at the top or the
+  // bottom face of the brick.
+  virtual Vec3i computeLatticeStudPos(size_t i, bool top) const = 0;
+  // appends the centers of the cells the brick fills
+  virtual void computeLatticeCells(std::vector<Vec3i>& cells) const = 0;
   
   static const std::array<Vec4,111> colors;
  
@@ -60,11 +68,14 @@ public:
   
   virtual ~SimpleYAK42() {};
 
-  virtual std::vector<Vec2t<uint16_t>> studsTop() const override;
-  virtual std::vector<Vec2t<uint16_t>> studsBottom() const override;
+  virtual const std::vector<Vec2t<uint16_t>>& studsTop() const override;
+  virtual const std::vector<Vec2t<uint16_t>>& studsBottom() const override;
   
   virtual Vec3 computeGlobalStudPos(size_t i) const override;
   virtual AABB computeAABB() const override;
+
+  virtual Vec3i computeLatticeStudPos(size_t i, bool top) const override;
+  virtual void computeLatticeCells(std::vector<Vec3i>& cells) const override;
   
   Vec3i getScale() const {return {width,height,depth};}
 
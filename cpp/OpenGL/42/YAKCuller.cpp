@@ -0,0 +1,216 @@
+#include <atomic>
+#include <array>
+#include <memory>
+#include <algorithm>
+
+#include "YAKCuller.h"
+
+namespace {
+  // the block of 4x4x4 cells of the same parity a lattice cell lies in,
+  // 20 bits per coordinate, never equal to CellHash::empty
+  uint64_t blockKey(const Vec3i& c) {
+    return (uint64_t(uint32_t(c.x >> 3) & 0xFFFFF) << 43) |
+           (uint64_t(uint32_t(c.y >> 3) & 0xFFFFF) << 23) |
+           (uint64_t(uint32_t(c.z >> 3) & 0xFFFFF) << 3) |
+           uint64_t((c.x & 1) << 2 | (c.y & 1) << 1 | (c.z & 1));
+  }
+
+  uint64_t blockBit(const Vec3i& c) {
+    return uint64_t(1) << ((c.x & 7) >> 1 | ((c.y & 7) >> 1) << 2 | ((c.z & 7) >> 1) << 4);
+  }
+
+  // an open addressing hash set of lattice cells, stored as one bit mask per
+  // block, that all threads may fill at once. Neighbouring cells mostly
+  // share a block, so lookups stay in a small part of memory.
+  class CellHash {
+  public:
+    static constexpr uint64_t empty = ~uint64_t(0);
+
+    // blockCount is an upper bound on the number of blocks
+    CellHash(size_t blockCount) :
+      bits{1}
+    {
+      while ((size_t(1) << bits) < 2*blockCount) ++bits;
+      mask = (size_t(1) << bits)-1;
+      keys.reset(new std::atomic<uint64_t>[mask+1]);
+      cells.reset(new std::atomic<uint64_t>[mask+1]);
+      for (size_t i = 0;i<=mask;++i) {
+        keys[i].store(empty, std::memory_order_relaxed);
+        cells[i].store(0, std::memory_order_relaxed);
+      }
+    }
+
+    void insert(const Vec3i& cell) {
+      const uint64_t key = blockKey(cell);
+      for (size_t i = slot(key);;i = (i+1) & mask) {
+        uint64_t current = keys[i].load(std::memory_order_relaxed);
+        if (current == empty &&
+            keys[i].compare_exchange_strong(current, key, std::memory_order_relaxed)) current = key;
+        if (current == key) {
+          cells[i].fetch_or(blockBit(cell), std::memory_order_relaxed);
+          return;
+        }
+      }
+    }
+
+    // the cells of a block as bits, see blockBit
+    uint64_t block(uint64_t key) const {
+      for (size_t i = slot(key);;i = (i+1) & mask) {
+        const uint64_t current = keys[i].load(std::memory_order_relaxed);
+        if (current == key) return cells[i].load(std::memory_order_relaxed);
+        if (current == empty) return 0;
+      }
+    }
+
+  private:
+    uint32_t bits;
+    size_t mask;
+    std::unique_ptr<std::atomic<uint64_t>[]> keys;
+    std::unique_ptr<std::atomic<uint64_t>[]> cells;
+
+    size_t slot(uint64_t key) const {
+      return size_t((key * 0x9E3779B97F4A7C15ull) >> (64-bits));
+    }
+  };
+
+  // lookups into a CellHash remembering the last block
+  class CellLookup {
+  public:
+    CellLookup(const CellHash& hash) : hash(hash) {}
+
+    bool contains(const Vec3i& cell) {
+      const uint64_t key = blockKey(cell);
+      if (key != lastKey) {
+        lastKey = key;
+        lastBlock = hash.block(key);
+      }
+      return (lastBlock & blockBit(cell)) != 0;
+    }
+
+  private:
+    const CellHash& hash;
+    uint64_t lastKey{CellHash::empty};
+    uint64_t lastBlock{0};
+  };
+
+  const std::array<Vec3i, 6> neighbours {
+    Vec3i{-2,0,0}, Vec3i{2,0,0},
+    Vec3i{0,-2,0}, Vec3i{0,2,0},
+    Vec3i{0,0,-2}, Vec3i{0,0,2}
+  };
+}
+
+ManagedYAK::ManagedYAK(std::shared_ptr<YAK42> brick) :
+  brick(brick),
+  visible(true)
+{
+  studVisible.resize(brick->studsTop().size());
+  std::fill(studVisible.begin(), studVisible.end(), true);
+}
+
+void StaticYAKCuller::add(std::shared_ptr<YAK42> brick) {
+  mangedBricks.push_back({brick});
+}
+
+void StaticYAKCuller::add(const ManagedYAK& brick) {
+  mangedBricks.push_back(brick);
+}
+
+void StaticYAKCuller::cull() {
+  if (mangedBricks.empty()) {
+    aabb = AABB{};
+    return;
+  }
+  const int64_t brickCount = int64_t(mangedBricks.size());
+
+  aabb = mangedBricks.front().brick->computeAABB();
+  size_t blockCount = 0;
+#pragma omp parallel
+  {
+    std::vector<Vec3i> cells;
+    std::vector<uint64_t> blocks;
+    AABB localAABB = aabb;
+#pragma omp for schedule(dynamic, 256) reduction(+:blockCount)
+    for (int64_t i = 0;i<brickCount;++i) {
+      const YAK42& brick = *mangedBricks[size_t(i)].brick;
+      localAABB.merge(brick.computeAABB());
+      cells.clear();
+      brick.computeLatticeCells(cells);
+      blocks.clear();
+      for (const Vec3i& cell : cells) blocks.push_back(blockKey(cell));
+      std::sort(blocks.begin(), blocks.end());
+      blockCount += size_t(std::unique(blocks.begin(), blocks.end()) - blocks.begin());
+    }
+#pragma omp critical
+    aabb.merge(localAABB);
+  }
+
+  CellHash filled(blockCount);
+#pragma omp parallel
+  {
+    std::vector<Vec3i> cells;
+#pragma omp for schedule(dynamic, 256)
+    for (int64_t i = 0;i<brickCount;++i) {
+      cells.clear();
+      mangedBricks[size_t(i)].brick->computeLatticeCells(cells);
+      for (const Vec3i& cell : cells) filled.insert(cell);
+    }
+  }
+
+#pragma omp parallel
+  {
+    std::vector<Vec3i> cells;
+    CellLookup lookup{filled};
+#pragma omp for schedule(dynamic, 256)
+    for (int64_t i = 0;i<brickCount;++i) {
+      ManagedYAK& managedBrick = mangedBricks[size_t(i)];
+      if (!managedBrick.visible) continue;
+      const YAK42& brick = *managedBrick.brick;
+
+      cells.clear();
+      brick.computeLatticeCells(cells);
+
+      // when the cells fill their bounding box, as they do for boxy bricks,
+      // only neighbours outside of it need to be looked up
+      Vec3i minCell = cells.empty() ? Vec3i{} : cells.front();
+      Vec3i maxCell = minCell;
+      for (const Vec3i& cell : cells) {
+        minCell = Vec3i::minV(minCell, cell);
+        maxCell = Vec3i::maxV(maxCell, cell);
+      }
+      const Vec3i boxSize = (maxCell-minCell)/2 + 1;
+      const bool box = size_t(boxSize.x)*size_t(boxSize.y)*size_t(boxSize.z) == cells.size();
+      const auto inBox = [&](const Vec3i& c) {
+        return box && c.x >= minCell.x && c.y >= minCell.y && c.z >= minCell.z &&
+                      c.x <= maxCell.x && c.y <= maxCell.y && c.z <= maxCell.z;
+      };
+
+      bool enclosed = true;
+      for (size_t c = 0;c<cells.size() && enclosed;++c) {
+        for (const Vec3i& n : neighbours) {
+          const Vec3i neighbour = cells[c]+n;
+          if (!inBox(neighbour) && !lookup.contains(neighbour)) {
+            enclosed = false;
+            break;
+          }
+        }
+      }
+      if (enclosed) {
+        managedBrick.visible = false;
+        continue;
+      }
+
+      for (size_t s = 0;s<managedBrick.studVisible.size();++s) {
+        if (managedBrick.studVisible[s] &&
+            lookup.contains(brick.computeLatticeStudPos(s, true)+Vec3i{0,1,0}))
+          managedBrick.studVisible[s] = false;
+      }
+    }
+  }
+}
+
+std::pair<std::vector<ManagedYAK>,AABB> StaticYAKCuller::get() {
+  std::vector<ManagedYAK> temp;
+  std::swap(temp, mangedBricks);
+  return std::make_pair(temp,aabb);
+}
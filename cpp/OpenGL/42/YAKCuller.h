@@ -0,0 +1,40 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "YAK42.h"
+
+class ManagedYAK {
+public:
+  ManagedYAK(std::shared_ptr<YAK42> brick);
+  
+  std::shared_ptr<YAK42> brick;
+  bool visible;
+  std::vector<bool> studVisible;
+  
+  void hideAllStuds() {
+    std::fill(studVisible.begin(),studVisible.end(),false);
+  }
+};
+
+// Collects bricks and removes what cannot be seen before they are handed
+// to the YAKManager. All cells the bricks fill are put into a spatial hash
+// of 4x4x4 cell blocks on the integer lattice of YAK42, then every brick is
+// checked in parallel: a top stud is hidden when the cell above it is
+// filled, and a brick is hidden when all cells next to its cells are
+// filled. Hiding only ever adds to what was hidden by the caller.
+class StaticYAKCuller {
+public:
+  void add(std::shared_ptr<YAK42> brick);
+  void add(const ManagedYAK& brick);
+  void cull();
+  
+  std::pair<std::vector<ManagedYAK>,AABB> get();
+  
+private:
+  AABB aabb;
+  std::vector<ManagedYAK> mangedBricks;
+  
+};
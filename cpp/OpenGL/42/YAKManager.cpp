@@ -1,3 +1,6 @@
+#include <map>
+#include <array>
+
 #include "YAKManager.h"
 
 #include <Tesselation.h>
@@ -58,16 +61,6 @@ static const std::string fragmentShaderString{R"(#version 410
       outNormal = nnormal;
   })"};
 
-ManagedYAK::ManagedYAK(std::shared_ptr<YAK42> brick) :
-  brick(brick),
-  visible(true)
-{
-  studVisible.resize(brick->studsTop().size());
-  std::fill(studVisible.begin(), studVisible.end(), true);
-}
-
-
-
 YAKManager::YAKManager() :
 studShader{GLProgram::createFromString(studVertexShaderString, fragmentShaderString)},
 studPosBuffer{GL_ARRAY_BUFFER},
@@ -121,30 +114,42 @@ void YAKManager::createCommonData() {
 void YAKManager::generateInstanceData(const std::pair<std::vector<ManagedYAK>,AABB>& bricks) {
   mangedBricks.push_back(std::make_shared<InstanceData>());
   
-  std::vector<float> studsInstanceData;
-  std::vector<float> baseInstanceData;
-
   std::shared_ptr<InstanceData> newInstance = mangedBricks.back();
   newInstance->aabb = bricks.second;
-  
-  newInstance->studInstanceCount = 0;
-  newInstance->baseInstanceCount = 0;  
-    
+
+  const auto floorDiv = [](int32_t a, int32_t b) {
+    return a >= 0 ? a/b : -((-a+b-1)/b);
+  };
+  std::map<std::array<int32_t,3>, std::vector<const ManagedYAK*>> chunkBricks;
   for (const ManagedYAK& managedBrick : bricks.first) {
+    if (!managedBrick.visible) continue;
+    const Vec3i pos = managedBrick.brick->getIntegerPos();
+    chunkBricks[{floorDiv(pos.x, chunkSize), floorDiv(pos.y, 3*chunkSize), floorDiv(pos.z, chunkSize)}]
+      .push_back(&managedBrick);
+  }
 
-    if (managedBrick.visible) {
-      
-      const auto brick = std::dynamic_pointer_cast<SimpleYAK42>(managedBrick.brick);
+  for (const auto& members : chunkBricks) {
+    std::vector<float> studsInstanceData;
+    std::vector<float> baseInstanceData;
+
+    auto newChunk = std::make_unique<InstanceChunk>();
+    newChunk->studInstanceCount = 0;
+    newChunk->baseInstanceCount = 0;
+    newChunk->aabb = members.second.front()->brick->computeAABB();
+
+    for (const ManagedYAK* managedBrick : members.second) {
+      const auto brick = std::dynamic_pointer_cast<SimpleYAK42>(managedBrick->brick);
       
       if (!brick) {
         // TODO: handle other brick types, if the ever see the light of day
         continue;
       }
+      newChunk->aabb.merge(brick->computeAABB());
           
       // studs
       const Vec4 color = brick->getColor();
-      for (size_t i = 0; i<managedBrick.studVisible.size(); ++i) {
-        if (managedBrick.studVisible[i]) {
+      for (size_t i = 0; i<managedBrick->studVisible.size(); ++i) {
+        if (managedBrick->studVisible[i]) {
           const Vec3 pos = brick->computeGlobalStudPos(i);
           studsInstanceData.push_back(pos.x);
           studsInstanceData.push_back(pos.y);
@@ -155,7 +160,7 @@ void YAKManager::generateInstanceData(const std::pair<std::vector<ManagedYAK>,AA
           studsInstanceData.push_back(color.b);
           studsInstanceData.push_back(color.a);
           
-          newInstance->studInstanceCount++;
+          newChunk->studInstanceCount++;
         }
       }
       
@@ -176,83 +181,48 @@ void YAKManager::generateInstanceData(const std::pair<std::vector<ManagedYAK>,AA
       baseInstanceData.push_back(color.b);
       baseInstanceData.push_back(color.a);
       
-      newInstance->baseInstanceCount++;
+      newChunk->baseInstanceCount++;
     }
+
+    generateChunk(*newChunk, studsInstanceData, baseInstanceData);
+    newInstance->chunks.push_back(std::move(newChunk));
   }
-  
+}
+
+void YAKManager::generateChunk(InstanceChunk& chunk, const std::vector<float>& studsInstanceData,
+                               const std::vector<float>& baseInstanceData) {
   studShader.enable();
-  newInstance->studArray.bind();
+  chunk.studArray.bind();
   
 
-  newInstance->studInstanceBuffer.setData(studsInstanceData, 7);
-  newInstance->studArray.connectVertexAttrib(newInstance->studInstanceBuffer, studShader, "vInstancePos",
+  chunk.studInstanceBuffer.setData(studsInstanceData, 7);
+  chunk.studArray.connectVertexAttrib(chunk.studInstanceBuffer, studShader, "vInstancePos",
                                 3,0,1);
-  newInstance->studArray.connectVertexAttrib(newInstance->studInstanceBuffer, studShader, "vInstanceColor",
+  chunk.studArray.connectVertexAttrib(chunk.studInstanceBuffer, studShader, "vInstanceColor",
                                 4,3,1);
 
-  newInstance->studArray.connectVertexAttrib(studPosBuffer, studShader, "vPos", 3);
-  newInstance->studArray.connectVertexAttrib(studNormalBuffer, studShader, "vNormal", 3);
-  newInstance->studArray.connectIndexBuffer(studIndexBuffer);
+  chunk.studArray.connectVertexAttrib(studPosBuffer, studShader, "vPos", 3);
+  chunk.studArray.connectVertexAttrib(studNormalBuffer, studShader, "vNormal", 3);
+  chunk.studArray.connectIndexBuffer(studIndexBuffer);
 
   baseShader.enable();
-  newInstance->baseArray.bind();
+  chunk.baseArray.bind();
   
-  newInstance->baseInstanceBuffer.setData(baseInstanceData, 10);
-  newInstance->baseArray.connectVertexAttrib(newInstance->baseInstanceBuffer, baseShader, "vInstancePos",
+  chunk.baseInstanceBuffer.setData(baseInstanceData, 10);
+  chunk.baseArray.connectVertexAttrib(chunk.baseInstanceBuffer, baseShader, "vInstancePos",
                                 3,0,1);
-  newInstance->baseArray.connectVertexAttrib(newInstance->baseInstanceBuffer, baseShader, "vInstanceScale",
+  chunk.baseArray.connectVertexAttrib(chunk.baseInstanceBuffer, baseShader, "vInstanceScale",
                                 3,3,1);
-  newInstance->baseArray.connectVertexAttrib(newInstance->baseInstanceBuffer, baseShader, "vInstanceColor",
+  chunk.baseArray.connectVertexAttrib(chunk.baseInstanceBuffer, baseShader, "vInstanceColor",
                                 4,6,1);
 
-  newInstance->baseArray.connectVertexAttrib(basePosBuffer, baseShader, "vPos", 3);
-  newInstance->baseArray.connectVertexAttrib(baseNormalBuffer, baseShader, "vNormal", 3);
-  newInstance->baseArray.connectIndexBuffer(baseIndexBuffer);
+  chunk.baseArray.connectVertexAttrib(basePosBuffer, baseShader, "vPos", 3);
+  chunk.baseArray.connectVertexAttrib(baseNormalBuffer, baseShader, "vNormal", 3);
+  chunk.baseArray.connectIndexBuffer(baseIndexBuffer);
 }
 
-void YAKManager::render() const {
-  const Mat4 modelViewProjection = projection*modelView;
-  const Mat4 modelViewInverseTranspose = Mat4::transpose(Mat4::inverse(modelView));
-  
-  studShader.enable();
-  studShader.setUniform("MVP", modelViewProjection);
-  studShader.setUniform("MV", modelView);
-  studShader.setUniform("MVit", modelViewInverseTranspose);
-
-  for (const auto& instance : mangedBricks) {
-    instance->studArray.bind();
-    GL(glDrawElementsInstanced(GL_TRIANGLES, GLsizei(studVertexCount),
-                               GL_UNSIGNED_INT, (void*)0, GLsizei(instance->studInstanceCount)));
-  }
-   
-  baseShader.enable();
-  baseShader.setUniform("MVP", modelViewProjection);
-  baseShader.setUniform("MV", modelView);
-  baseShader.setUniform("MVit", modelViewInverseTranspose);
-  for (const auto& instance : mangedBricks) {
-    instance->baseArray.bind();
-    GL(glDrawElementsInstanced(GL_TRIANGLES, GLsizei(baseVertexCount),
-                               GL_UNSIGNED_INT, (void*)0, GLsizei(instance->baseInstanceCount)));
-  }
-}
-
-bool YAKManager::autoPop() {
-  if (mangedBricks.empty()) return false;
-  
-  const AABB& aabb = mangedBricks.front()->aabb;
-  const std::array<Vec3, 8> bboxPoints {
-    Vec3(aabb.minVec.x,aabb.minVec.y,aabb.minVec.z),
-    Vec3(aabb.maxVec.x,aabb.minVec.y,aabb.minVec.z),
-    Vec3(aabb.minVec.x,aabb.maxVec.y,aabb.minVec.z),
-    Vec3(aabb.maxVec.x,aabb.maxVec.y,aabb.minVec.z),
-    Vec3(aabb.minVec.x,aabb.minVec.y,aabb.maxVec.z),
-    Vec3(aabb.maxVec.x,aabb.minVec.y,aabb.maxVec.z),
-    Vec3(aabb.minVec.x,aabb.maxVec.y,aabb.maxVec.z),
-    Vec3(aabb.maxVec.x,aabb.maxVec.y,aabb.maxVec.z)
-  };
-  const Mat4 mvp = projection*modelView;
-
-  std::array<Vec4, 8> planeCoefficients {
+static std::array<Vec4, 6> frustumPlanes(const Mat4& mvp) {
+  return {
     Vec4{ // Right plane coefficients
       mvp[12] - mvp[ 0],mvp[13] - mvp[1],mvp[14] - mvp[2],mvp[15] - mvp[3]
     },
@@ -272,8 +242,22 @@ bool YAKManager::autoPop() {
       mvp[12] + mvp[8],mvp[13] + mvp[9],mvp[14] + mvp[10],mvp[15] + mvp[11]
     }
   };
-  
-  for (size_t f = 0; f < 6; f++ ) {
+}
+
+// true if all corners of the box are behind one of the planes
+static bool outsideFrustum(const AABB& aabb, const std::array<Vec4, 6>& planeCoefficients) {
+  const std::array<Vec3, 8> bboxPoints {
+    Vec3(aabb.minVec.x,aabb.minVec.y,aabb.minVec.z),
+    Vec3(aabb.maxVec.x,aabb.minVec.y,aabb.minVec.z),
+    Vec3(aabb.minVec.x,aabb.maxVec.y,aabb.minVec.z),
+    Vec3(aabb.maxVec.x,aabb.maxVec.y,aabb.minVec.z),
+    Vec3(aabb.minVec.x,aabb.minVec.y,aabb.maxVec.z),
+    Vec3(aabb.maxVec.x,aabb.minVec.y,aabb.maxVec.z),
+    Vec3(aabb.minVec.x,aabb.maxVec.y,aabb.maxVec.z),
+    Vec3(aabb.maxVec.x,aabb.maxVec.y,aabb.maxVec.z)
+  };
+
+  for (size_t f = 0; f < planeCoefficients.size(); f++ ) {
     bool allOut = true;
     for(size_t p = 0; p < bboxPoints.size(); p++ ) {
       if (planeCoefficients[f][0] * bboxPoints[p].x +
@@ -284,33 +268,52 @@ bool YAKManager::autoPop() {
         break;
       }
     }
-    if (allOut) {
-      pop();
-      return true;
-    }
-  }  
+    if (allOut) return true;
+  }
   return false;
 }
 
-void StaticYAKCuller::add(std::shared_ptr<YAK42> brick) {
-  mangedBricks.push_back({brick});
-}
-
-void StaticYAKCuller::add(const ManagedYAK& brick) {
-  mangedBricks.push_back(brick);
-}
+void YAKManager::render() const {
+  const Mat4 modelViewProjection = projection*modelView;
+  const Mat4 modelViewInverseTranspose = Mat4::transpose(Mat4::inverse(modelView));
 
-void StaticYAKCuller::cull() {
- // TODO: später mehr dazu
+  const std::array<Vec4, 6> planeCoefficients = frustumPlanes(modelViewProjection);
+  std::vector<const InstanceChunk*> visibleChunks;
+  for (const auto& instance : mangedBricks) {
+    if (outsideFrustum(instance->aabb, planeCoefficients)) continue;
+    for (const auto& chunk : instance->chunks) {
+      if (!outsideFrustum(chunk->aabb, planeCoefficients)) visibleChunks.push_back(chunk.get());
+    }
+  }
   
-  aabb = mangedBricks.begin()->brick->computeAABB();
-  for (const auto& managedBrick : mangedBricks) {
-    aabb.merge(managedBrick.brick->computeAABB());
+  studShader.enable();
+  studShader.setUniform("MVP", modelViewProjection);
+  studShader.setUniform("MV", modelView);
+  studShader.setUniform("MVit", modelViewInverseTranspose);
+
+  for (const InstanceChunk* chunk : visibleChunks) {
+    chunk->studArray.bind();
+    GL(glDrawElementsInstanced(GL_TRIANGLES, GLsizei(studVertexCount),
+                               GL_UNSIGNED_INT, (void*)0, GLsizei(chunk->studInstanceCount)));
+  }
+   
+  baseShader.enable();
+  baseShader.setUniform("MVP", modelViewProjection);
+  baseShader.setUniform("MV", modelView);
+  baseShader.setUniform("MVit", modelViewInverseTranspose);
+  for (const InstanceChunk* chunk : visibleChunks) {
+    chunk->baseArray.bind();
+    GL(glDrawElementsInstanced(GL_TRIANGLES, GLsizei(baseVertexCount),
+                               GL_UNSIGNED_INT, (void*)0, GLsizei(chunk->baseInstanceCount)));
   }
 }
 
-std::pair<std::vector<ManagedYAK>,AABB> StaticYAKCuller::get() {
-  std::vector<ManagedYAK> temp;
-  std::swap(temp, mangedBricks);
-  return std::make_pair(temp,aabb);
+bool YAKManager::autoPop() {
+  if (mangedBricks.empty()) return false;
+
+  if (outsideFrustum(mangedBricks.front()->aabb, frustumPlanes(projection*modelView))) {
+    pop();
+    return true;
+  }
+  return false;
 }
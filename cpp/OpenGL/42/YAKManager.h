@@ -10,35 +10,9 @@
 #include <GLArray.h>
 
 #include "YAK42.h"
+#include "YAKCuller.h"
 
-class ManagedYAK {
-public:
-  ManagedYAK(std::shared_ptr<YAK42> brick);
-  
-  std::shared_ptr<YAK42> brick;
-  bool visible;
-  std::vector<bool> studVisible;
-  
-  void hideAllStuds() {
-    std::fill(studVisible.begin(),studVisible.end(),false);
-  }
-};
-
-class StaticYAKCuller {
-public:
-  void add(std::shared_ptr<YAK42> brick);
-  void add(const ManagedYAK& brick);
-  void cull();
-  
-  std::pair<std::vector<ManagedYAK>,AABB> get();
-  
-private:
-  AABB aabb;
-  std::vector<ManagedYAK> mangedBricks;
-  
-};
-
-struct InstanceData {  
+struct InstanceChunk {
   GLArray studArray{};
   GLBuffer studInstanceBuffer{GL_ARRAY_BUFFER};
   GLArray baseArray{};
@@ -49,6 +23,13 @@ struct InstanceData {
   AABB aabb;
 };
 
+// the bricks of one push, grouped into chunks of chunkSize studs in
+// every direction that are frustum culled on their own
+struct InstanceData {
+  std::vector<std::unique_ptr<InstanceChunk>> chunks;
+  AABB aabb;
+};
+
 class YAKManager {
 public:
   YAKManager();
@@ -67,10 +48,14 @@ public:
     this->modelView = modelView;
   }
   
+  static constexpr int32_t chunkSize{32};
+
 private:
   std::deque<std::shared_ptr<InstanceData>> mangedBricks;
 
   void generateInstanceData(const std::pair<std::vector<ManagedYAK>,AABB>& bricks);
+  void generateChunk(InstanceChunk& chunk, const std::vector<float>& studsInstanceData,
+                     const std::vector<float>& baseInstanceData);
   void createCommonData();
   void pop();
 
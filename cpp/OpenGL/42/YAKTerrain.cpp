@@ -199,10 +199,8 @@ void YAKTerrain::generateBricksFromField() {
                                                    colorMapping(height,maxGradient),
                                                    integerPos);
 
-        
-        ManagedYAK managedBrick(brick);
-        if (i > 0) managedBrick.hideAllStuds();
-        culler.add(managedBrick);
+
+        culler.add(brick);
       }
     }
   }
@@ -0,0 +1,158 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <tuple>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+
+#include "YAK42.h"
+#include "YAKCuller.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Culls synthetic builds with StaticYAKCuller and reports the time and how
+// many of the instances YAKManager would draw are removed: a solid block of
+// bricks in alternating layers and a terrain of stacked columns built like
+// YAKTerrain does. Small versions of both are checked against a std::set of
+// all cells: studs are hidden exactly where a cell sits on top of them and
+// bricks exactly where all their neighbour cells are filled.
+//
+//   yakBench [blockSize] [blockLayers] [terrainWidth] [terrainDepth]
+//            defaults 256 24 480 200
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// size x size studs of 4x2 bricks, turned by 90 degrees every other layer
+static std::vector<std::shared_ptr<YAK42>> block(int32_t size, int32_t layers) {
+  std::vector<std::shared_ptr<YAK42>> bricks;
+  for (int32_t l = 0;l<layers;++l) {
+    const bool turned = l % 2 == 1;
+    const int32_t w = turned ? 2 : 4;
+    const int32_t d = turned ? 4 : 2;
+    for (int32_t z = 0;z+d<=size;z += d) {
+      for (int32_t x = 0;x+w<=size;x += w) {
+        bricks.push_back(std::make_shared<SimpleYAK42>(w, d, 3, uint16_t(l%100),
+                                                       Vec3i{x+w/2, 3*l, z+d/2}));
+      }
+    }
+  }
+  return bricks;
+}
+
+// columns of 2x2 bricks reaching down to the lowest neighbour, as in
+// YAKTerrain::generateBricksFromField
+static std::vector<std::shared_ptr<YAK42>> terrain(int32_t width, int32_t depth) {
+  const auto height = [](int32_t x, int32_t y) {
+    return int32_t(20.0f + 12.0f*std::sin(x*0.05f)*std::cos(y*0.07f) + 6.0f*std::sin((x+2*y)*0.13f));
+  };
+  std::vector<std::shared_ptr<YAK42>> bricks;
+  for (int32_t y = 0;y<depth;++y) {
+    for (int32_t x = 0;x<width;++x) {
+      const int32_t h = height(x, y);
+      int32_t maxDiff = 0;
+      for (const Vec2i& n : {Vec2i{-1,0}, Vec2i{1,0}, Vec2i{0,-1}, Vec2i{0,1}})
+        maxDiff = std::max(maxDiff, std::abs(h-height(x+n.x, y+n.y)));
+      for (int32_t i = 0;i<std::max(1,maxDiff);++i) {
+        bricks.push_back(std::make_shared<SimpleYAK42>(2, 2, 3, uint16_t(h%100),
+                                                       Vec3i{x*2, (h-i)*3, y*2}));
+      }
+    }
+  }
+  return bricks;
+}
+
+struct Counts {
+  size_t bricks{0};
+  size_t studs{0};
+  size_t visibleBricks{0};
+  size_t visibleStuds{0};
+};
+
+static Counts count(const std::vector<ManagedYAK>& bricks) {
+  Counts c;
+  for (const ManagedYAK& b : bricks) {
+    c.bricks++;
+    c.studs += b.studVisible.size();
+    if (!b.visible) continue;
+    c.visibleBricks++;
+    for (const bool v : b.studVisible) c.visibleStuds += v;
+  }
+  return c;
+}
+
+static bool check(const std::vector<ManagedYAK>& bricks) {
+  typedef std::tuple<int32_t, int32_t, int32_t> Cell;
+  std::set<Cell> filled;
+  std::vector<Vec3i> cells;
+  for (const ManagedYAK& b : bricks) {
+    cells.clear();
+    b.brick->computeLatticeCells(cells);
+    for (const Vec3i& c : cells) filled.insert({c.x, c.y, c.z});
+  }
+  const auto isFilled = [&](const Vec3i& c) {return filled.count({c.x, c.y, c.z}) > 0;};
+
+  for (const ManagedYAK& b : bricks) {
+    cells.clear();
+    b.brick->computeLatticeCells(cells);
+    bool enclosed = true;
+    for (const Vec3i& c : cells) {
+      for (const Vec3i& n : {Vec3i{-2,0,0}, Vec3i{2,0,0}, Vec3i{0,-2,0}, Vec3i{0,2,0}, Vec3i{0,0,-2}, Vec3i{0,0,2}})
+        enclosed = enclosed && isFilled(c+n);
+    }
+    if (b.visible == enclosed) return false;
+    if (!b.visible) continue;
+    for (size_t s = 0;s<b.studVisible.size();++s) {
+      if (b.studVisible[s] == isFilled(b.brick->computeLatticeStudPos(s, true)+Vec3i{0,1,0})) return false;
+    }
+  }
+  return true;
+}
+
+static bool run(const std::string& name, const std::vector<std::shared_ptr<YAK42>>& bricks, bool verify) {
+  StaticYAKCuller culler;
+  for (const auto& brick : bricks) culler.add(brick);
+
+  const auto t1 = Clock::now();
+  culler.cull();
+  const auto t2 = Clock::now();
+
+  const std::vector<ManagedYAK> culled = culler.get().first;
+  const Counts c = count(culled);
+  const size_t instances = c.bricks + c.studs;
+  const size_t removed = instances - c.visibleBricks - c.visibleStuds;
+  std::cout << "  " << std::left << std::setw(24) << name << std::right << std::setw(8) << c.bricks
+            << " bricks, cull " << std::fixed << std::setprecision(1) << std::setw(7) << seconds(t1,t2)*1000
+            << " ms, removed " << std::setprecision(1) << std::setw(5) << 100.0*(c.bricks-c.visibleBricks)/c.bricks
+            << "% of bricks, " << std::setw(5) << 100.0*(c.studs-c.visibleStuds)/c.studs << "% of studs, "
+            << std::setw(5) << 100.0*removed/instances << "% of " << instances << " instances";
+  if (verify) {
+    const bool ok = check(culled);
+    std::cout << (ok ? ", checked" : ", WRONG");
+    if (!ok) {
+      std::cout << std::endl;
+      return false;
+    }
+  }
+  std::cout << std::endl;
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const int32_t blockSize = argc > 1 ? atoi(argv[1]) : 256;
+  const int32_t blockLayers = argc > 2 ? atoi(argv[2]) : 24;
+  const int32_t terrainWidth = argc > 3 ? atoi(argv[3]) : 480;
+  const int32_t terrainDepth = argc > 4 ? atoi(argv[4]) : 200;
+
+  std::cout << omp_get_max_threads() << " threads" << std::endl;
+  if (!run("small block", block(32, 6), true)) return EXIT_FAILURE;
+  if (!run("small terrain", terrain(40, 30), true)) return EXIT_FAILURE;
+  if (!run("block", block(blockSize, blockLayers), false)) return EXIT_FAILURE;
+  if (!run("terrain", terrain(terrainWidth, terrainDepth), false)) return EXIT_FAILURE;
+  return EXIT_SUCCESS;
+}
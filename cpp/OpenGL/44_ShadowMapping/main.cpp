@@ -100,7 +100,9 @@ public:
     const Dimensions dim = glEnv.getFramebufferSize();
     GL(glViewport(0, 0, GLsizei(dim.width), GLsizei(dim.height)));
 
-    torus.init(Tesselation::genTorus({0,0,0}, 0.8f, 0.3f),true);
+    Tesselation torusTesselation = Tesselation::genTorus({0,0,0}, 0.8f, 0.3f);
+    torusTesselation.optimizeVertexCache();
+    torus.init(torusTesselation, true);
     torus.connect(sceneProgram);
 
     plane.init(Tesselation::genRectangle({0,0,-2}, 6, 6),true);
@@ -0,0 +1,384 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "Benchmark.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+namespace {
+  // the counters of the case whose setup is running
+  std::vector<std::pair<std::string, double>> currentCounters;
+
+  double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+    return std::chrono::duration<double>(t2-t1).count();
+  }
+
+  double timeIterations(const Benchmark::Body& body, size_t iterations) {
+    const auto t1 = Clock::now();
+    for (size_t i = 0;i<iterations;++i) body();
+    return seconds(t1, Clock::now());
+  }
+
+  Benchmark::Result summarize(const std::string& name, size_t iterations, size_t bytes,
+                              size_t items, std::vector<double> samples) {
+    Benchmark::Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.bytesPerIteration = bytes;
+    result.itemsPerIteration = items;
+    std::sort(samples.begin(), samples.end());
+    const size_t n = samples.size();
+    result.min = samples.front();
+    result.max = samples.back();
+    result.median = n % 2 ? samples[n/2] : (samples[n/2-1] + samples[n/2])/2;
+    for (double s : samples) result.mean += s;
+    result.mean /= double(n);
+    for (double s : samples) result.deviation += (s-result.mean)*(s-result.mean);
+    result.deviation = n > 1 ? std::sqrt(result.deviation/double(n-1)) : 0.0;
+    return result;
+  }
+
+  std::string formatTime(double nanoseconds) {
+    std::stringstream s;
+    s << std::fixed << std::setprecision(nanoseconds < 10 ? 2 : 1);
+    if (nanoseconds < 1e3) s << nanoseconds << " ns";
+    else if (nanoseconds < 1e6) s << nanoseconds/1e3 << " us";
+    else if (nanoseconds < 1e9) s << nanoseconds/1e6 << " ms";
+    else s << nanoseconds/1e9 << " s";
+    return s.str();
+  }
+
+  void print(const Benchmark::Result& r) {
+    std::cout << std::left << std::setw(44) << r.name << std::right
+              << std::setw(12) << formatTime(r.median)
+              << std::setw(8) << std::fixed << std::setprecision(1)
+              << (r.mean > 0 ? 100.0*r.deviation/r.mean : 0.0) << "%"
+              << std::setw(12) << formatTime(r.min) << std::setw(12) << formatTime(r.max);
+    if (r.bytesPerIteration > 0)
+      std::cout << std::setw(10) << std::setprecision(3) << double(r.bytesPerIteration)/r.median << " GB/s";
+    if (r.itemsPerIteration > 0)
+      std::cout << std::setw(10) << std::setprecision(1) << 1e3*double(r.itemsPerIteration)/r.median << " M/s";
+    for (const auto& c : r.counters)
+      std::cout << "  " << c.first << " " << std::defaultfloat << std::setprecision(4) << c.second;
+    std::cout << std::endl;
+  }
+
+  std::string escape(const std::string& s) {
+    std::string result;
+    for (char c : s) {
+      if (c == '"' || c == '\\') result += '\\';
+      result += c;
+    }
+    return result;
+  }
+
+  // Just enough of a JSON reader for the files writeJSON produces: objects,
+  // arrays, strings with simple escapes, numbers and literals.
+  class JSONReader {
+  public:
+    JSONReader(const std::string& text) : text(text) {}
+
+    std::vector<Benchmark::Result> results() {
+      std::vector<Benchmark::Result> results;
+      expect('{');
+      while (!consume('}')) {
+        const std::string key = string();
+        expect(':');
+        if (key == "benchmarks") {
+          expect('[');
+          while (!consume(']')) {
+            results.push_back(result());
+            consume(',');
+          }
+        } else {
+          skipValue();
+        }
+        consume(',');
+      }
+      return results;
+    }
+
+  private:
+    const std::string& text;
+    size_t pos{0};
+
+    void skipSpace() {
+      while (pos < text.size() && std::isspace((unsigned char)text[pos])) ++pos;
+    }
+
+    bool consume(char c) {
+      skipSpace();
+      if (pos < text.size() && text[pos] == c) {
+        ++pos;
+        return true;
+      }
+      return false;
+    }
+
+    void expect(char c) {
+      if (!consume(c)) throw BenchmarkException(std::string("Expected '") + c + "' in baseline");
+    }
+
+    std::string string() {
+      expect('"');
+      std::string s;
+      while (pos < text.size() && text[pos] != '"') {
+        if (text[pos] == '\\') ++pos;
+        if (pos < text.size()) s += text[pos++];
+      }
+      expect('"');
+      return s;
+    }
+
+    double number() {
+      skipSpace();
+      const char* start = text.c_str()+pos;
+      char* end = nullptr;
+      const double value = std::strtod(start, &end);
+      if (end == start) throw BenchmarkException("Expected a number in baseline");
+      pos += size_t(end-start);
+      return value;
+    }
+
+    void skipValue() {
+      skipSpace();
+      if (pos >= text.size()) throw BenchmarkException("Unexpected end of baseline");
+      const char c = text[pos];
+      if (c == '"') {
+        string();
+      } else if (c == '{' || c == '[') {
+        const char close = c == '{' ? '}' : ']';
+        ++pos;
+        while (!consume(close)) {
+          if (c == '{') {
+            string();
+            expect(':');
+          }
+          skipValue();
+          consume(',');
+        }
+      } else if (std::isalpha((unsigned char)c)) {
+        while (pos < text.size() && std::isalpha((unsigned char)text[pos])) ++pos;
+      } else {
+        number();
+      }
+    }
+
+    Benchmark::Result result() {
+      Benchmark::Result r;
+      expect('{');
+      while (!consume('}')) {
+        const std::string key = string();
+        expect(':');
+        if (key == "name") r.name = string();
+        else if (key == "iterations") r.iterations = size_t(number());
+        else if (key == "bytes_per_iteration") r.bytesPerIteration = size_t(number());
+        else if (key == "items_per_iteration") r.itemsPerIteration = size_t(number());
+        else if (key == "mean_ns") r.mean = number();
+        else if (key == "median_ns") r.median = number();
+        else if (key == "stddev_ns") r.deviation = number();
+        else if (key == "min_ns") r.min = number();
+        else if (key == "max_ns") r.max = number();
+        else if (key == "counters") {
+          expect('{');
+          while (!consume('}')) {
+            const std::string counter = string();
+            expect(':');
+            r.counters.push_back({counter, number()});
+            consume(',');
+          }
+        }
+        else skipValue();
+        consume(',');
+      }
+      return r;
+    }
+  };
+}
+
+void Benchmark::Suite::add(const std::string& name, Setup setup, size_t bytesPerIteration,
+                           size_t itemsPerIteration) {
+  cases.push_back({name, setup, bytesPerIteration, itemsPerIteration});
+}
+
+std::vector<Benchmark::Result> Benchmark::Suite::run(const Options& options) {
+  if (options.cpu >= 0) pinToCPU(options.cpu);
+
+  failures = 0;
+  std::vector<Result> results;
+  std::cout << std::left << std::setw(44) << "case" << std::right << std::setw(12) << "median"
+            << std::setw(9) << "stddev" << std::setw(12) << "min" << std::setw(12) << "max" << std::endl;
+  for (const Case& c : cases) {
+    if (c.name.find(options.filter) == std::string::npos) continue;
+
+    Body body;
+    currentCounters.clear();
+    try {
+      body = c.setup();
+    } catch (const BenchmarkSkipped& e) {
+      std::cout << std::left << std::setw(44) << c.name << "skipped, " << e.what() << std::endl;
+      continue;
+    } catch (const BenchmarkException& e) {
+      std::cout << std::left << std::setw(44) << c.name << "FAILED, " << e.what() << std::endl;
+      ++failures;
+      continue;
+    }
+
+    std::vector<double> samples;
+    size_t iterations = 1;
+    try {
+      while (timeIterations(body, iterations) < options.minTime && iterations < (size_t(1) << 40))
+        iterations *= 2;
+      for (size_t i = 0;i<options.warmup;++i) timeIterations(body, iterations);
+
+      for (size_t i = 0;i<std::max<size_t>(1, options.repetitions);++i)
+        samples.push_back(timeIterations(body, iterations)*1e9/double(iterations));
+    } catch (const BenchmarkException& e) {
+      std::cout << std::left << std::setw(44) << c.name << "FAILED, " << e.what() << std::endl;
+      ++failures;
+      continue;
+    }
+
+    results.push_back(summarize(c.name, iterations, c.bytesPerIteration, c.itemsPerIteration, samples));
+    results.back().counters = currentCounters;
+    print(results.back());
+  }
+  return results;
+}
+
+int Benchmark::Suite::run(int argc, char** argv) {
+  try {
+    const Options options = parseOptions(argc, argv);
+    if (options.list) {
+      for (const Case& c : cases)
+        if (c.name.find(options.filter) != std::string::npos) std::cout << c.name << std::endl;
+      return EXIT_SUCCESS;
+    }
+
+    const std::vector<Result> baseline = options.baselineFilename.empty()
+                                       ? std::vector<Result>() : readJSON(options.baselineFilename);
+    const std::vector<Result> results = run(options);
+    if (!options.jsonFilename.empty()) writeJSON(options.jsonFilename, results);
+    if (options.baselineFilename.empty()) return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    const size_t regressions = compare(results, baseline, options.threshold);
+    std::cout << regressions << " regression" << (regressions == 1 ? "" : "s") << std::endl;
+    return regressions > 0 || failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+  } catch (const BenchmarkException& e) {
+    std::cerr << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+}
+
+void Benchmark::counter(const std::string& name, double value) {
+  currentCounters.push_back({name, value});
+}
+
+Benchmark::Options Benchmark::parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1;i<argc;++i) {
+    const std::string arg = argv[i];
+    if (arg == "--list") {
+      options.list = true;
+      continue;
+    }
+    if (arg == "--help" || i+1 >= argc) {
+      throw BenchmarkException(std::string("usage: ") + argv[0] + " [--filter text] [--warmup n]"
+                               " [--repetitions n] [--min-time seconds] [--cpu index]"
+                               " [--json file] [--baseline file] [--threshold fraction] [--list]");
+    }
+    const std::string value = argv[++i];
+    if (arg == "--filter") options.filter = value;
+    else if (arg == "--warmup") options.warmup = size_t(std::atol(value.c_str()));
+    else if (arg == "--repetitions") options.repetitions = size_t(std::atol(value.c_str()));
+    else if (arg == "--min-time") options.minTime = std::atof(value.c_str());
+    else if (arg == "--cpu") options.cpu = std::atoi(value.c_str());
+    else if (arg == "--json") options.jsonFilename = value;
+    else if (arg == "--baseline") options.baselineFilename = value;
+    else if (arg == "--threshold") options.threshold = std::atof(value.c_str());
+    else throw BenchmarkException("Unknown option " + arg);
+  }
+  return options;
+}
+
+void Benchmark::pinToCPU(int cpu) {
+#ifdef _WIN32
+  if (cpu >= 64 || SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) == 0)
+    throw BenchmarkException("Unable to pin to CPU " + std::to_string(cpu));
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+    throw BenchmarkException("Unable to pin to CPU " + std::to_string(cpu));
+#else
+  // macOS only takes affinity hints, so the timings run unpinned
+  std::cerr << "CPU pinning is not supported on this platform" << std::endl;
+#endif
+}
+
+void Benchmark::writeJSON(const std::string& filename, const std::vector<Result>& results) {
+  std::ofstream file{filename};
+  if (!file.is_open()) throw BenchmarkException("Unable to write " + filename);
+  file << std::setprecision(10);
+  file << "{\n  \"benchmarks\": [\n";
+  for (size_t i = 0;i<results.size();++i) {
+    const Result& r = results[i];
+    file << "    {\"name\": \"" << escape(r.name) << "\", \"iterations\": " << r.iterations
+         << ", \"bytes_per_iteration\": " << r.bytesPerIteration
+         << ", \"items_per_iteration\": " << r.itemsPerIteration << ", \"mean_ns\": " << r.mean
+         << ", \"median_ns\": " << r.median << ", \"stddev_ns\": " << r.deviation
+         << ", \"min_ns\": " << r.min << ", \"max_ns\": " << r.max;
+    if (!r.counters.empty()) {
+      file << ", \"counters\": {";
+      for (size_t j = 0;j<r.counters.size();++j)
+        file << (j > 0 ? ", " : "") << "\"" << escape(r.counters[j].first) << "\": " << r.counters[j].second;
+      file << "}";
+    }
+    file << "}" << (i+1 < results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n}\n";
+}
+
+std::vector<Benchmark::Result> Benchmark::readJSON(const std::string& filename) {
+  std::ifstream file{filename};
+  if (!file.is_open()) throw BenchmarkException("Unable to read " + filename);
+  std::stringstream text;
+  text << file.rdbuf();
+  const std::string s = text.str();
+  return JSONReader{s}.results();
+}
+
+size_t Benchmark::compare(const std::vector<Result>& results, const std::vector<Result>& baseline,
+                          double threshold) {
+  size_t regressions = 0;
+  std::cout << std::endl << std::left << std::setw(44) << "compared to baseline" << std::right
+            << std::setw(12) << "baseline" << std::setw(12) << "now" << std::setw(10) << "change" << std::endl;
+  for (const Result& r : results) {
+    const auto b = std::find_if(baseline.begin(), baseline.end(),
+                                [&](const Result& e) {return e.name == r.name;});
+    if (b == baseline.end() || b->median <= 0) continue;
+    const double change = r.median/b->median - 1.0;
+    const bool regression = change > threshold;
+    if (regression) ++regressions;
+    std::cout << std::left << std::setw(44) << r.name << std::right << std::setw(12) << formatTime(b->median)
+              << std::setw(12) << formatTime(r.median) << std::setw(9) << std::showpos << std::fixed
+              << std::setprecision(1) << 100.0*change << "%" << std::noshowpos
+              << (regression ? "  REGRESSION" : "") << std::endl;
+  }
+  return regressions;
+}
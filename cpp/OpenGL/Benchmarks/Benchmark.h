@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <utility>
+#include <exception>
+#include <cstddef>
+
+class BenchmarkException : public std::exception {
+  public:
+    BenchmarkException(const std::string& whatStr) : whatStr(whatStr) {}
+    virtual const char* what() const throw() {
+      return whatStr.c_str();
+    }
+  private:
+    std::string whatStr;
+};
+
+// thrown by the setup of a case that can't run in this environment
+class BenchmarkSkipped : public BenchmarkException {
+  public:
+    BenchmarkSkipped(const std::string& whatStr) : BenchmarkException(whatStr) {}
+};
+
+// A small harness for repeatable timings. Every case is set up once, then
+// the number of iterations per repetition is doubled until a repetition
+// takes minTime. After the warmup repetitions every repetition yields one
+// sample of nanoseconds per iteration, the summary holds mean, median,
+// standard deviation and the extremes of these samples, and the
+// throughput in bytes or items, e.g. vertices, per second if given.
+// Results can be written as JSON and compared with such a file from an
+// earlier run: a case whose median is slower than the baseline by more
+// than threshold counts as a regression.
+namespace Benchmark {
+  struct Options {
+    size_t warmup{2};
+    size_t repetitions{10};
+    double minTime{0.05};
+    int cpu{-1};
+    std::string filter;
+    std::string jsonFilename;
+    std::string baselineFilename;
+    double threshold{0.1};
+    bool list{false};
+  };
+
+  struct Result {
+    std::string name;
+    size_t iterations{0};
+    size_t bytesPerIteration{0};
+    size_t itemsPerIteration{0};
+    double mean{0};
+    double median{0};
+    double deviation{0};
+    double min{0};
+    double max{0};
+    // values recorded with counter during the setup
+    std::vector<std::pair<std::string, double>> counters;
+  };
+
+  // the timed code of a case
+  typedef std::function<void()> Body;
+  // called once before the timing, a case that can't run in this
+  // environment throws BenchmarkSkipped, a setup or body that throws
+  // BenchmarkException, e.g. because a result is wrong, fails the case
+  typedef std::function<Body()> Setup;
+
+  class Suite {
+  public:
+    void add(const std::string& name, Setup setup, size_t bytesPerIteration=0,
+             size_t itemsPerIteration=0);
+
+    // parses the command line, runs the cases whose name contains the
+    // filter and returns the exit code, EXIT_FAILURE on a regression or
+    // a failed case
+    int run(int argc, char** argv);
+    std::vector<Result> run(const Options& options);
+
+  private:
+    struct Case {
+      std::string name;
+      Setup setup;
+      size_t bytesPerIteration;
+      size_t itemsPerIteration;
+    };
+    std::vector<Case> cases;
+    size_t failures{0};
+  };
+
+  // records a value besides the timing for the case being set up, e.g.
+  // a cache miss ratio, it is printed and written with the results
+  void counter(const std::string& name, double value);
+
+  Options parseOptions(int argc, char** argv);
+  void pinToCPU(int cpu);
+
+  void writeJSON(const std::string& filename, const std::vector<Result>& results);
+  std::vector<Result> readJSON(const std::string& filename);
+  // prints the change of every case found in both, returns the number of
+  // regressions
+  size_t compare(const std::vector<Result>& results, const std::vector<Result>& baseline,
+                 double threshold);
+
+  // keeps the compiler from optimizing away a result that is never used
+  template <typename T>
+  inline void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+  }
+}
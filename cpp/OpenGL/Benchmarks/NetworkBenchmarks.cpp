@@ -0,0 +1,170 @@
+#include <vector>
+#include <string>
+#include <random>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <AES.h>
+#include <Base64.h>
+#include <Server.h>
+#include <Client.h>
+
+#include "Suites.h"
+
+static std::vector<uint8_t> randomBytes(size_t size) {
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8_t> data(size);
+  for (uint8_t& b : data) b = uint8_t(byte(rng));
+  return data;
+}
+
+// AES-128, the handshake expects exactly 16 characters
+static const std::string key{"benchmarkKey0123"};
+
+static void addCrypt(Benchmark::Suite& suite) {
+  const size_t size = 64*1024;
+
+  suite.add("AESCrypt/encrypt 64 KB", [size] {
+    auto crypt = std::make_shared<AESCrypt>(AESCrypt::genIVString(), key);
+    auto plain = std::make_shared<std::vector<uint8_t>>(randomBytes(size));
+    auto cipher = std::make_shared<std::vector<uint8_t>>();
+    return [crypt, plain, cipher] {
+      crypt->encrypt(*plain, *cipher);
+      Benchmark::keep(cipher->data());
+    };
+  }, size);
+
+  suite.add("AESCrypt/decrypt 64 KB", [size] {
+    const std::string iv = AESCrypt::genIVString();
+    auto cipher = std::make_shared<std::vector<uint8_t>>();
+    AESCrypt{iv, key}.encrypt(randomBytes(size), *cipher);
+    auto plain = std::make_shared<std::vector<uint8_t>>();
+    if (!AESCrypt{iv, key}.decrypt(*cipher, *plain) || *plain != randomBytes(size))
+      throw BenchmarkException("decryption does not match");
+    // the IV chains from call to call, so later calls see other plain
+    // text, the work is the same
+    auto crypt = std::make_shared<AESCrypt>(iv, key);
+    return [crypt, cipher, plain] {
+      crypt->decrypt(*cipher, *plain);
+      Benchmark::keep(plain->data());
+    };
+  }, size);
+
+  suite.add("AESCrypt/encryptString 256 B", [] {
+    auto crypt = std::make_shared<AESCrypt>(AESCrypt::genIVString(), key);
+    const std::vector<uint8_t> bytes = randomBytes(256);
+    const std::string message(bytes.begin(), bytes.end());
+    return [crypt, message] {
+      Benchmark::keep(crypt->encryptString(message).size());
+    };
+  }, 256);
+}
+
+static void addBase64(Benchmark::Suite& suite) {
+  const size_t size = 1 << 20;
+
+  suite.add("Base64/encode 1 MB", [size] {
+    auto data = std::make_shared<std::vector<uint8_t>>(randomBytes(size));
+    return [data] {
+      Benchmark::keep(base64_encode(*data).size());
+    };
+  }, size);
+
+  suite.add("Base64/decode 1 MB", [size] {
+    const std::string encoded = base64_encode(randomBytes(size));
+    auto decoded = std::make_shared<std::vector<uint8_t>>();
+    return [encoded, decoded] {
+      base64_decode(encoded, *decoded);
+      Benchmark::keep(decoded->data());
+    };
+  }, size);
+}
+
+namespace {
+  class CountingServer : public Server<SizedClientConnection> {
+  public:
+    CountingServer(uint16_t port, const std::string& key) :
+      Server<SizedClientConnection>(port, key)
+    {}
+
+    virtual void handleClientConnection(uint32_t, const std::string&, uint16_t) override {
+      ++connections;
+    }
+
+    virtual void handleClientMessage(uint32_t, const std::string& message) override {
+      bytes += message.size();
+      ++messages;
+    }
+
+    std::atomic<size_t> connections{0};
+    std::atomic<size_t> messages{0};
+    std::atomic<size_t> bytes{0};
+  };
+
+  // the client is declared last so it disconnects before the server stops
+  struct Connection {
+    std::unique_ptr<CountingServer> server;
+    std::unique_ptr<Client> client;
+  };
+}
+
+template <typename F>
+static bool waitFor(F condition, std::chrono::milliseconds timeout) {
+  const auto end = std::chrono::steady_clock::now() + timeout;
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > end) return false;
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  return true;
+}
+
+static std::shared_ptr<Connection> connect(uint16_t port, const std::string& key) {
+  auto connection = std::make_shared<Connection>();
+  connection->server = std::make_unique<CountingServer>(port, key);
+  connection->server->start();
+  if (!waitFor([&] {return !connection->server->isStarting();}, std::chrono::seconds(2)) ||
+      !connection->server->isOK())
+    throw BenchmarkSkipped("unable to listen on port " + std::to_string(port));
+
+  connection->client = std::make_unique<Client>("127.0.0.1", port, key);
+  if (!waitFor([&] {return connection->server->connections > 0 && connection->client->isOK();},
+               std::chrono::seconds(2)))
+    throw BenchmarkSkipped("unable to connect to port " + std::to_string(port));
+  return connection;
+}
+
+// Every iteration sends a batch of messages from an in-process client over
+// the loopback interface and waits until the server has handled all of
+// them, so the time covers framing, encryption and both threads.
+static void addServer(Benchmark::Suite& suite) {
+  const size_t batch = 64;
+  const size_t messageSize = 1024;
+  uint16_t port = 11723;
+
+  for (const std::string& k : {std::string(), key}) {
+    const std::string name = "Server/" + std::to_string(batch) + " x 1 KB messages" +
+                             (k.empty() ? "" : " encrypted");
+    suite.add(name, [=] {
+      auto connection = connect(port, k);
+      // encrypted messages are C strings, so the text has no zero bytes
+      std::string message;
+      for (uint8_t b : randomBytes(messageSize)) message += char('a' + b % 26);
+      return [connection, message] {
+        const size_t target = connection->server->messages + batch;
+        for (size_t i = 0;i<batch;++i) connection->client->sendMessage(message);
+        if (!waitFor([&] {return connection->server->messages >= target;}, std::chrono::seconds(10)))
+          throw BenchmarkException("messages lost");
+      };
+    }, batch*messageSize);
+    ++port;
+  }
+}
+
+void addNetworkBenchmarks(Benchmark::Suite& suite) {
+  addCrypt(suite);
+  addBase64(suite);
+  addServer(suite);
+}
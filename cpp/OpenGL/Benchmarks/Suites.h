@@ -0,0 +1,6 @@
+#pragma once
+
+#include "Benchmark.h"
+
+void addUtilsBenchmarks(Benchmark::Suite& suite);
+void addNetworkBenchmarks(Benchmark::Suite& suite);
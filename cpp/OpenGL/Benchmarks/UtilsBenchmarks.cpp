@@ -0,0 +1,461 @@
+#include <vector>
+#include <random>
+#include <memory>
+#include <cmath>
+
+#include <Image.h>
+#include <Grid2D.h>
+#include <Mat4.h>
+#include <Vec3.h>
+#include <VecArray.h>
+#include <Quaternion.h>
+#include <Tesselation.h>
+#include <MeshOptimizer.h>
+#include <MultiHash.h>
+#include <Compression.h>
+
+#include "Suites.h"
+
+static std::mt19937 rng{42};
+
+static Image randomImage(uint32_t width, uint32_t height, uint32_t componentCount) {
+  std::uniform_int_distribution<int> byte(0, 255);
+  Image image{width, height, componentCount};
+  for (uint8_t& b : image.data) b = uint8_t(byte(rng));
+  return image;
+}
+
+static std::vector<Vec3> randomVectors(size_t count) {
+  std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+  std::vector<Vec3> vectors(count);
+  for (Vec3& v : vectors) v = Vec3{coordinate(rng), coordinate(rng), coordinate(rng)};
+  return vectors;
+}
+
+// bytes that compress about as well as text, long runs alone would make
+// the back references too easy
+static std::vector<char> compressibleBytes(size_t size) {
+  std::uniform_int_distribution<int> word(0, 63);
+  std::uniform_int_distribution<int> length(2, 9);
+  std::vector<char> data;
+  while (data.size() < size) {
+    const int w = word(rng);
+    for (int i = length(rng);i>0;--i) data.push_back(char('a' + (w*7+i) % 26));
+    data.push_back(' ');
+  }
+  data.resize(size);
+  return data;
+}
+
+static void addImage(Benchmark::Suite& suite) {
+  suite.add("Image/cropToAspectAndResample 1024x768", [] {
+    auto image = std::make_shared<Image>(randomImage(1024, 768, 4));
+    return [image] {
+      Benchmark::keep(image->cropToAspectAndResample(256, 256).data.data());
+    };
+  }, 1024*768*4);
+
+  suite.add("Image/filter 512x512 3x3", [] {
+    auto image = std::make_shared<Image>(randomImage(512, 512, 4));
+    auto kernel = std::make_shared<Grid2D>(3, 3, std::vector<float>{1,2,1, 2,4,2, 1,2,1});
+    *kernel = *kernel / 16.0f;
+    return [image, kernel] {
+      Benchmark::keep(image->filter(*kernel).data.data());
+    };
+  }, 512*512*4);
+
+  suite.add("Image/generateAlphaFromLuminance 1024x1024", [] {
+    auto image = std::make_shared<Image>(randomImage(1024, 1024, 4));
+    return [image] {
+      image->generateAlphaFromLuminance();
+      Benchmark::keep(image->data.data());
+    };
+  }, 1024*1024*4);
+
+  suite.add("Image/sample 64k bilinear", [] {
+    auto image = std::make_shared<Image>(randomImage(512, 512, 3));
+    return [image] {
+      uint32_t sum = 0;
+      for (uint32_t i = 0;i<65536;++i)
+        sum += image->sample(float(i % 256)/256.0f, float(i / 256)/256.0f, i % 3);
+      Benchmark::keep(sum);
+    };
+  });
+}
+
+static void addGrid2D(Benchmark::Suite& suite) {
+  suite.add("Grid2D/sample and normal 64k", [] {
+    auto grid = std::make_shared<Grid2D>(Grid2D::genRandom(256, 256, 7));
+    return [grid] {
+      float sum = 0;
+      for (uint32_t i = 0;i<65536;++i) {
+        const float x = float(i % 256)/256.0f;
+        const float y = float(i / 256)/256.0f;
+        sum += grid->sample(x, y) + grid->normal(x, y).z;
+      }
+      Benchmark::keep(sum);
+    };
+  });
+
+  suite.add("Grid2D/arithmetic 512x512", [] {
+    auto a = std::make_shared<Grid2D>(Grid2D::genRandom(512, 512, 1));
+    auto b = std::make_shared<Grid2D>(Grid2D::genRandom(512, 512, 2));
+    return [a, b] {
+      const Grid2D result = (*a + *b) * *a - *b / 2.0f;
+      Benchmark::keep(result.getValue(17, 17));
+    };
+  }, 512*512*sizeof(float)*2);
+
+  suite.add("Grid2D/toSignedDistance 256x256", [] {
+    auto grid = std::make_shared<Grid2D>(Grid2D::genRandom(256, 256, 3));
+    return [grid] {
+      Benchmark::keep(grid->toSignedDistance(0.5f).getValue(0, 0));
+    };
+  });
+}
+
+static void addMath(Benchmark::Suite& suite) {
+  suite.add("Mat4/multiply 4k", [] {
+    auto matrices = std::make_shared<std::vector<Mat4>>();
+    for (const Vec3& v : randomVectors(4096))
+      matrices->push_back(Mat4::rotationAxis(v, v.x*10.0f) * Mat4::translation(v));
+    return [matrices] {
+      Mat4 product;
+      for (const Mat4& m : *matrices) product = product * m;
+      Benchmark::keep(product);
+    };
+  });
+
+  suite.add("Mat4/inverse 4k", [] {
+    auto matrices = std::make_shared<std::vector<Mat4>>();
+    for (const Vec3& v : randomVectors(4096))
+      matrices->push_back(Mat4::lookAt(v, Vec3{0,0,0}, Vec3{0,1,0}) * Mat4::scaling(v.y+11.0f));
+    auto result = std::make_shared<std::vector<Mat4>>(matrices->size());
+    return [matrices, result] {
+      for (size_t i = 0;i<matrices->size();++i) (*result)[i] = Mat4::inverse((*matrices)[i]);
+      Benchmark::keep(result->data());
+    };
+  });
+
+  suite.add("Mat4/transform 64k Vec3", [] {
+    auto points = std::make_shared<std::vector<Vec3>>(randomVectors(65536));
+    auto result = std::make_shared<std::vector<Vec3>>(points->size());
+    const Mat4 m = Mat4::perspective(45.0f, 1.5f, 0.1f, 100.0f) *
+                   Mat4::lookAt(Vec3{0,5,20}, Vec3{0,0,0}, Vec3{0,1,0});
+    return [points, result, m] {
+      for (size_t i = 0;i<points->size();++i) (*result)[i] = m * (*points)[i];
+      Benchmark::keep(result->data());
+    };
+  }, 65536*sizeof(Vec3));
+
+  suite.add("Vec3/cross and normalize 64k", [] {
+    auto a = std::make_shared<std::vector<Vec3>>(randomVectors(65536));
+    auto b = std::make_shared<std::vector<Vec3>>(randomVectors(65536));
+    auto result = std::make_shared<std::vector<Vec3>>(a->size());
+    return [a, b, result] {
+      for (size_t i = 0;i<a->size();++i) (*result)[i] = Vec3::normalize(Vec3::cross((*a)[i], (*b)[i]));
+      Benchmark::keep(result->data());
+    };
+  }, 65536*sizeof(Vec3)*2);
+}
+
+static void addCompression(Benchmark::Suite& suite) {
+  const size_t size = 1 << 20;
+
+  suite.add("Compression/compress 1 MB", [size] {
+    auto data = std::make_shared<std::vector<char>>(compressibleBytes(size));
+    return [data] {
+      Benchmark::keep(Compression::compress(*data).size());
+    };
+  }, size);
+
+  suite.add("Compression/decompress 1 MB", [size] {
+    auto compressed = std::make_shared<std::vector<char>>(Compression::compress(compressibleBytes(size)));
+    return [compressed] {
+      Benchmark::keep(Compression::decompress(*compressed).size());
+    };
+  }, size);
+}
+
+static void addHashing(Benchmark::Suite& suite) {
+  const size_t imageSize = 128*128*3;
+  const size_t imageCount = 256;
+
+  for (MultiHash::Algorithm algorithm : {MultiHash::Algorithm::MD5, MultiHash::Algorithm::SHA256}) {
+    const std::string name = algorithm == MultiHash::Algorithm::MD5 ? "MD5" : "SHA-256";
+    suite.add("MultiHash/" + name + " 256 images", [=] {
+      auto data = std::make_shared<Image>(randomImage(128, 128*imageCount, 3));
+      auto buffers = std::make_shared<std::vector<MultiHash::Buffer>>();
+      for (size_t i = 0;i<imageCount;++i) buffers->push_back({data->data.data() + i*imageSize, imageSize});
+      return [algorithm, data, buffers] {
+        Benchmark::keep(MultiHash::hashBuffers(algorithm, *buffers).size());
+      };
+    }, imageSize*imageCount);
+  }
+}
+
+static void expectClose(const Vec3& a, const Vec3& b, float tolerance, const std::string& what) {
+  for (size_t c = 0;c<3;++c) {
+    if (!(std::fabs(a[c]-b[c]) <= tolerance*std::max(1.0f, std::fabs(b[c]))))
+      throw BenchmarkException(what + " does not match, " + a.toString() + " instead of " + b.toString());
+  }
+}
+
+// The batched kernels against the single vector operations on the same
+// data, in million vertices per second. The setups check the results.
+static void addVecArray(Benchmark::Suite& suite) {
+  const size_t count = 1 << 20;
+  const Mat4 projection = Mat4::perspective(45.0f, 1.5f, 0.1f, 100.0f) *
+                          Mat4::lookAt(Vec3{0,5,20}, Vec3{0,0,0}, Vec3{0,1,0});
+  const Mat4 rotation = Mat4::rotationAxis(Vec3{1,2,3}, 30.0f) * Mat4::translation(0.5f, -1.0f, 2.0f);
+
+  suite.add("VecArray/Mat4 * Vec3 one by one 1M", [=] {
+    auto points = std::make_shared<std::vector<Vec3>>(randomVectors(count));
+    auto result = std::make_shared<std::vector<Vec3>>(count);
+    return [=] {
+      for (size_t i = 0;i<count;++i) (*result)[i] = projection * (*points)[i];
+      Benchmark::keep(result->data());
+    };
+  }, 0, count);
+
+  suite.add("VecArray/transformPoints 1M", [=] {
+    const std::vector<Vec3> vectors = randomVectors(count);
+    auto points = std::make_shared<Vec3Array>(vectors);
+    auto result = std::make_shared<Vec3Array>();
+    VecArray::transformPoints(projection, *points, *result);
+    for (size_t i = 0;i<count;i += 997) expectClose((*result)[i], projection * vectors[i], 1e-5f, "transformPoints");
+    return [=] {
+      VecArray::transformPoints(projection, *points, *result);
+      Benchmark::keep(result->x.data());
+    };
+  }, 0, count);
+
+  suite.add("VecArray/transformPoints interleaved 1M", [=] {
+    auto vectors = std::make_shared<std::vector<Vec3>>(randomVectors(count));
+    std::vector<Vec3> expected(*vectors);
+    for (Vec3& v : expected) v = rotation * v;
+    VecArray::transformPoints(rotation, &(*vectors)[0].x, count);
+    for (size_t i = 0;i<count;i += 997) expectClose((*vectors)[i], expected[i], 1e-5f, "interleaved transformPoints");
+    // a rigid motion, so the points stay in range however often they move
+    return [=] {
+      VecArray::transformPoints(rotation, &(*vectors)[0].x, count);
+      Benchmark::keep(vectors->data());
+    };
+  }, 0, count);
+
+  suite.add("VecArray/cross and normalize one by one 1M", [=] {
+    auto a = std::make_shared<std::vector<Vec3>>(randomVectors(count));
+    auto b = std::make_shared<std::vector<Vec3>>(randomVectors(count));
+    auto result = std::make_shared<std::vector<Vec3>>(count);
+    return [=] {
+      for (size_t i = 0;i<count;++i) (*result)[i] = Vec3::normalize(Vec3::cross((*a)[i], (*b)[i]));
+      Benchmark::keep(result->data());
+    };
+  }, 0, count);
+
+  suite.add("VecArray/cross and normalize 1M", [=] {
+    const std::vector<Vec3> va = randomVectors(count);
+    const std::vector<Vec3> vb = randomVectors(count);
+    auto a = std::make_shared<Vec3Array>(va);
+    auto b = std::make_shared<Vec3Array>(vb);
+    auto result = std::make_shared<Vec3Array>();
+    VecArray::cross(*a, *b, *result);
+    VecArray::normalize(*result, *result);
+    for (size_t i = 0;i<count;i += 997)
+      expectClose((*result)[i], Vec3::normalize(Vec3::cross(va[i], vb[i])), 1e-6f, "cross and normalize");
+    return [=] {
+      VecArray::cross(*a, *b, *result);
+      VecArray::normalize(*result, *result);
+      Benchmark::keep(result->x.data());
+    };
+  }, 0, count);
+
+  suite.add("VecArray/bounds one by one 1M", [=] {
+    auto points = std::make_shared<std::vector<Vec3>>(randomVectors(count));
+    return [=] {
+      Vec3 minV = (*points)[0], maxV = (*points)[0];
+      for (const Vec3& p : *points) {
+        minV = Vec3::minV(minV, p);
+        maxV = Vec3::maxV(maxV, p);
+      }
+      Benchmark::keep(minV);
+      Benchmark::keep(maxV);
+    };
+  }, 0, count);
+
+  suite.add("VecArray/bounds 1M", [=] {
+    const std::vector<Vec3> vectors = randomVectors(count);
+    auto points = std::make_shared<Vec3Array>(vectors);
+    Vec3 minV = vectors[0], maxV = vectors[0];
+    for (const Vec3& p : vectors) {
+      minV = Vec3::minV(minV, p);
+      maxV = Vec3::maxV(maxV, p);
+    }
+    const VecArray::AABB box = VecArray::bounds(*points);
+    const VecArray::AABB interleaved = VecArray::bounds(&vectors[0].x, count);
+    expectClose(box.min, minV, 0.0f, "bounds");
+    expectClose(box.max, maxV, 0.0f, "bounds");
+    expectClose(interleaved.min, minV, 0.0f, "interleaved bounds");
+    expectClose(interleaved.max, maxV, 0.0f, "interleaved bounds");
+    return [=] {
+      Benchmark::keep(VecArray::bounds(*points));
+    };
+  }, 0, count);
+
+  suite.add("VecArray/transformBoxes and overlaps 1M", [=] {
+    auto mins = std::make_shared<Vec3Array>(randomVectors(count));
+    auto maxs = std::make_shared<Vec3Array>(*mins);
+    for (size_t i = 0;i<count;++i) maxs->set(i, (*mins)[i] + Vec3{1.0f, 0.5f, 2.0f});
+    auto outMins = std::make_shared<Vec3Array>();
+    auto outMaxs = std::make_shared<Vec3Array>();
+    auto result = std::make_shared<std::vector<uint8_t>>();
+    const VecArray::AABB box{{-2, -2, -2}, {2, 2, 2}};
+
+    VecArray::transformBoxes(rotation, *mins, *maxs, *outMins, *outMaxs);
+    VecArray::overlaps(box, *outMins, *outMaxs, *result);
+    for (size_t i = 0;i<count;i += 997) {
+      // the transformed corners lie inside the transformed box
+      for (size_t c = 0;c<8;++c) {
+        const Vec3 corner{c & 1 ? (*maxs).x[i] : (*mins).x[i], c & 2 ? (*maxs).y[i] : (*mins).y[i],
+                          c & 4 ? (*maxs).z[i] : (*mins).z[i]};
+        const Vec3 p = rotation * corner;
+        const Vec3 lo = (*outMins)[i], hi = (*outMaxs)[i];
+        for (size_t k = 0;k<3;++k)
+          if (p[k] < lo[k]-1e-4f || p[k] > hi[k]+1e-4f) throw BenchmarkException("transformBoxes does not match");
+      }
+      const Vec3 lo = (*outMins)[i], hi = (*outMaxs)[i];
+      const bool expected = lo.x <= 2 && hi.x >= -2 && lo.y <= 2 && hi.y >= -2 && lo.z <= 2 && hi.z >= -2;
+      if ((*result)[i] != (expected ? 1 : 0)) throw BenchmarkException("overlaps does not match");
+    }
+    return [=] {
+      VecArray::transformBoxes(rotation, *mins, *maxs, *outMins, *outMaxs);
+      VecArray::overlaps(box, *outMins, *outMaxs, *result);
+      Benchmark::keep(result->data());
+    };
+  }, 0, count);
+
+  const size_t quaternionCount = 1 << 16;
+  auto randomQuaternions = [](size_t n) {
+    std::uniform_real_distribution<float> component(-1.0f, 1.0f);
+    std::vector<Vec4> q(n);
+    for (Vec4& v : q) v = Vec4{component(rng), component(rng), component(rng), component(rng)};
+    return q;
+  };
+
+  suite.add("VecArray/Quaternion::slerp one by one 64k", [=] {
+    auto a = std::make_shared<std::vector<Vec4>>(randomQuaternions(quaternionCount));
+    auto b = std::make_shared<std::vector<Vec4>>(randomQuaternions(quaternionCount));
+    auto result = std::make_shared<std::vector<Vec4>>(quaternionCount);
+    return [=] {
+      for (size_t i = 0;i<quaternionCount;++i)
+        (*result)[i] = Quaternion::slerp(Quaternion{(*a)[i]}, Quaternion{(*b)[i]}, float(i)/float(quaternionCount)).toVec4();
+      Benchmark::keep(result->data());
+    };
+  }, 0, quaternionCount);
+
+  suite.add("VecArray/slerp 64k", [=] {
+    const std::vector<Vec4> va = randomQuaternions(quaternionCount);
+    const std::vector<Vec4> vb = randomQuaternions(quaternionCount);
+    auto a = std::make_shared<Vec4Array>(va);
+    auto b = std::make_shared<Vec4Array>(vb);
+    auto t = std::make_shared<std::vector<float>>(quaternionCount);
+    for (size_t i = 0;i<quaternionCount;++i) (*t)[i] = float(i)/float(quaternionCount);
+    auto result = std::make_shared<Vec4Array>();
+    VecArray::slerp(*a, *b, *t, *result);
+    for (size_t i = 0;i<quaternionCount;++i) {
+      const Vec4 expected = Quaternion::slerp(Quaternion{va[i]}, Quaternion{vb[i]}, (*t)[i]).toVec4();
+      const Vec4 r = (*result)[i];
+      for (size_t c = 0;c<4;++c)
+        if (!(std::fabs(r[c]-expected[c]) <= 1e-5f)) throw BenchmarkException("slerp does not match");
+    }
+    return [=] {
+      VecArray::slerp(*a, *b, *t, *result);
+      Benchmark::keep(result->x.data());
+    };
+  }, 0, quaternionCount);
+}
+
+// Generation of high resolution meshes in million vertices per second,
+// the ACMR counters are the simulated vertex cache misses per triangle
+// of the generated and of the optimized triangle order.
+static void addTesselation(Benchmark::Suite& suite) {
+  const uint32_t steps = 1000;
+  const size_t sphereVertices = size_t(steps+1)*(steps+1);
+
+  const auto reportACMR = [](Tesselation tesselation) {
+    Benchmark::counter("ACMR", MeshOptimizer::averageCacheMissRatio(tesselation.getIndices()));
+    tesselation.optimizeVertexCache();
+    Benchmark::counter("optimized", MeshOptimizer::averageCacheMissRatio(tesselation.getIndices()));
+  };
+
+  suite.add("Tesselation/genSphere 1000x1000", [=] {
+    reportACMR(Tesselation::genSphere({0,0,0}, 1.0f, steps, steps));
+    return [=] {
+      Benchmark::keep(Tesselation::genSphere({0,0,0}, 1.0f, steps, steps).getIndices().data());
+    };
+  }, 0, sphereVertices);
+
+  suite.add("Tesselation/genTorus 2000x500", [=] {
+    reportACMR(Tesselation::genTorus({0,0,0}, 0.8f, 0.3f, 2000, 500));
+    return [=] {
+      Benchmark::keep(Tesselation::genTorus({0,0,0}, 0.8f, 0.3f, 2000, 500).getIndices().data());
+    };
+  }, 0, size_t(2001)*501);
+
+  suite.add("Tesselation/genGrid 1000x1000", [=] {
+    reportACMR(Tesselation::genGrid({0,0,0}, 1.0f, 1.0f, steps, steps));
+    return [=] {
+      Benchmark::keep(Tesselation::genGrid({0,0,0}, 1.0f, 1.0f, steps, steps).getIndices().data());
+    };
+  }, 0, sphereVertices);
+
+  suite.add("Tesselation/genCylinder 100000 steps", [=] {
+    reportACMR(Tesselation::genCylinder({0,0,0}, 1.0f, 2.0f, true, true, 100000));
+    return [=] {
+      Benchmark::keep(Tesselation::genCylinder({0,0,0}, 1.0f, 2.0f, true, true, 100000).getIndices().data());
+    };
+  }, 0, size_t(100001)*2 + 2*size_t(100002));
+
+  suite.add("Tesselation/interleave 1000x1000 sphere", [=] {
+    auto sphere = std::make_shared<Tesselation>(Tesselation::genSphere({0,0,0}, 1.0f, steps, steps));
+    auto data = std::make_shared<std::vector<float>>(sphere->getVertexCount()*Tesselation::interleavedStride);
+    return [=] {
+      sphere->interleave(data->data());
+      Benchmark::keep(data->data());
+    };
+  }, sphereVertices*Tesselation::interleavedStride*sizeof(float), sphereVertices);
+
+  // the copy of the mesh is part of the timing, it takes a fraction
+  suite.add("Tesselation/optimizeVertexCache sphere 300", [] {
+    auto sphere = std::make_shared<Tesselation>(Tesselation::genSphere({0,0,0}, 1.0f, 300, 300));
+    return [=] {
+      Tesselation optimized{*sphere};
+      optimized.optimizeVertexCache();
+      Benchmark::keep(optimized.getIndices().data());
+    };
+  }, 0, size_t(301)*301);
+
+  suite.add("MeshOptimizer/buildMeshlets 300x300 sphere", [] {
+    auto sphere = std::make_shared<Tesselation>(Tesselation::genSphere({0,0,0}, 1.0f, 300, 300));
+    sphere->optimizeVertexCache();
+    const MeshOptimizer::Meshlets meshlets = MeshOptimizer::buildMeshlets(sphere->getIndices(), sphere->getVertices());
+    size_t triangles = 0;
+    for (const MeshOptimizer::Meshlet& m : meshlets.meshlets) triangles += m.triangleCount;
+    if (triangles != sphere->getIndices().size()/3) throw BenchmarkException("meshlets lost triangles");
+    Benchmark::counter("meshlets", double(meshlets.meshlets.size()));
+    Benchmark::counter("vertices/meshlet", double(meshlets.vertices.size())/double(meshlets.meshlets.size()));
+    return [=] {
+      Benchmark::keep(MeshOptimizer::buildMeshlets(sphere->getIndices(), sphere->getVertices()).meshlets.data());
+    };
+  }, 0, size_t(301)*301);
+}
+
+void addUtilsBenchmarks(Benchmark::Suite& suite) {
+  addImage(suite);
+  addGrid2D(suite);
+  addMath(suite);
+  addVecArray(suite);
+  addTesselation(suite);
+  addCompression(suite);
+  addHashing(suite);
+}
@@ -0,0 +1,12 @@
+#include "Suites.h"
+
+// Runs the benchmarks of the Utils and Network libraries, see Benchmark.h
+// for the options. Store a baseline with --json and compare later runs
+// with --baseline, the exit code is nonzero if a case got slower than the
+// threshold allows.
+int main(int argc, char** argv) {
+  Benchmark::Suite suite;
+  addUtilsBenchmarks(suite);
+  addNetworkBenchmarks(suite);
+  return suite.run(argc, argv);
+}
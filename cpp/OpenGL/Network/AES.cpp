@@ -509,7 +509,7 @@ void AESCrypt::encrypt(const std::vector<uint8_t>& plain, std::vector<uint8_t>&
   size_t totalLength = plain.size()+padCount;
   
   std::vector<uint8_t> newPlain = plain;
-  for (size_t i=0; i<padCount; i++) newPlain[i] = padCount;
+  newPlain.resize(totalLength, padCount);
   
   cipher.resize(totalLength);
   encrypt_buffer(cipher.data(), newPlain.data(), totalLength);
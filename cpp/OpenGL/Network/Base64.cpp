@@ -1,228 +1,426 @@
+#include <algorithm>
+
 #include "Base64.h"
 
-#ifdef ARDUINO
-  #define STR_LENGTH length
-  #define STR_FIND indexOf
-#else
-  #define STR_LENGTH size
-  #define STR_FIND find
+#include "../Utils/CPUFeatures.h"
+#ifdef CPU_X86
+#include <immintrin.h>
 #endif
 
+namespace {
+  const char base64Chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
 
-static const std::string base64_chars =
-"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-"abcdefghijklmnopqrstuvwxyz"
-"0123456789+/";
+  const char base64urlChars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789-_";
 
+  // the value of every character, -1 outside of the alphabet
+  struct DecodeTable {
+    int8_t values[256];
 
-static inline bool is_base64(uint8_t c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
+    DecodeTable(const char* alphabet) {
+      for (size_t i = 0;i<256;++i) values[i] = -1;
+      for (size_t i = 0;i<64;++i) values[uint8_t(alphabet[i])] = int8_t(i);
+    }
+  };
 
-std::string base64_encode(std::vector<uint8_t> buf) {
-  return base64_encode(buf.data(), buf.size());
-}
+  const int8_t* decodeTable(bool url) {
+    static const DecodeTable standard{base64Chars};
+    static const DecodeTable urlSafe{base64urlChars};
+    return url ? urlSafe.values : standard.values;
+  }
 
-std::string base64_encode(uint8_t const* buf, size_t bufLen) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  uint8_t char_array_3[3];
-  uint8_t char_array_4[4];
-  
-  while (bufLen--) {
-    char_array_3[i++] = *(buf++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-      
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars[char_array_4[i]];
-      i = 0;
+  void encodeGroup(const uint8_t* source, char* target, const char* alphabet) {
+    const uint32_t v = uint32_t(source[0]) << 16 | uint32_t(source[1]) << 8 | source[2];
+    target[0] = alphabet[v >> 18];
+    target[1] = alphabet[(v >> 12) & 0x3f];
+    target[2] = alphabet[(v >> 6) & 0x3f];
+    target[3] = alphabet[v & 0x3f];
+  }
+
+  void decodeGroup(const uint8_t* values, uint8_t* target) {
+    const uint32_t v = uint32_t(values[0]) << 18 | uint32_t(values[1]) << 12 |
+                       uint32_t(values[2]) << 6 | values[3];
+    target[0] = uint8_t(v >> 16);
+    target[1] = uint8_t(v >> 8);
+    target[2] = uint8_t(v);
+  }
+
+#ifdef CPU_X86
+SIMD_TARGET_BEGIN_SSSE3
+  // The vector kernels follow Wojciech Muła's "Base64 encoding and decoding
+  // with SIMD instructions". Each group of three bytes is spread over four
+  // bytes holding one six bit index each, the indices become characters by
+  // adding a per range offset from a pshufb table. Decoding classifies the
+  // characters by range, any character outside of the alphabet leaves the
+  // rest of the input to the scalar loop, which stops at it. The kernels
+  // are compiled for SSSE3 and AVX2 and chosen by the CPU at runtime.
+
+  __m128i encodeIndices(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10,11,9,10,7,8,6,7,4,5,3,4,1,2,0,1));
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(t1, t3);
+  }
+
+  __m128i encodeShifts(const char* alphabet) {
+    return _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                         '0'-52, '0'-52, '0'-52, char(alphabet[62]-62), char(alphabet[63]-63),
+                         'A', 0, 0);
+  }
+
+  __m128i indicesToChars(__m128i indices, __m128i shifts) {
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(shifts, range), indices);
+  }
+
+  // returns false if a character is outside of the alphabet
+  bool charsToValues(__m128i chars, __m128i& values, char c62, char c63) {
+    const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('A'-1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('Z'+1), chars));
+    const __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('a'-1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('z'+1), chars));
+    const __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0'-1)),
+                                        _mm_cmpgt_epi8(_mm_set1_epi8('9'+1), chars));
+    const __m128i is62 = _mm_cmpeq_epi8(chars, _mm_set1_epi8(c62));
+    const __m128i is63 = _mm_cmpeq_epi8(chars, _mm_set1_epi8(c63));
+    const __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(_mm_or_si128(digit, is62), is63));
+    if (_mm_movemask_epi8(valid) != 0xffff) return false;
+
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(26-'a')));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(52-'0')));
+    shift = _mm_or_si128(shift, _mm_and_si128(is62, _mm_set1_epi8(char(62-c62))));
+    shift = _mm_or_si128(shift, _mm_and_si128(is63, _mm_set1_epi8(char(63-c63))));
+    values = _mm_add_epi8(chars, shift);
+    return true;
+  }
+
+  // packs four six bit values per 32 bits into three bytes each, the first
+  // twelve bytes of the result are used
+  __m128i packValues(__m128i values) {
+    const __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    const __m128i groups = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(groups, _mm_setr_epi8(2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1));
+  }
+
+  // the kernels of encodeBlocks and decodeBlocks below
+  size_t encodeBlocksSSSE3(const uint8_t* source, size_t size, char* target, const char* alphabet) {
+    size_t i = 0;
+    char* out = target;
+    const __m128i shifts = encodeShifts(alphabet);
+    for (;i+16<=size;i += 12) {
+      const __m128i in = _mm_loadu_si128((const __m128i*)(source+i));
+      _mm_storeu_si128((__m128i*)out, indicesToChars(encodeIndices(in), shifts));
+      out += 16;
     }
+    return i;
   }
-  
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
-    
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-    
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars[char_array_4[j]];
-    
-    while((i++ < 3))
-      ret += '=';
+
+  size_t decodeBlocksSSSE3(const char* text, size_t size, uint8_t* target, const char* alphabet) {
+    size_t i = 0;
+    uint8_t* out = target;
+    for (;i+16<=size;i += 16) {
+      __m128i values;
+      if (!charsToValues(_mm_loadu_si128((const __m128i*)(text+i)), values, alphabet[62], alphabet[63]))
+        return i;
+      const __m128i packed = packValues(values);
+      _mm_storel_epi64((__m128i*)out, packed);
+      const int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+      memcpy(out+8, &last, 4);
+      out += 12;
+    }
+    return i;
   }
-  
-  return ret;
-}
+SIMD_TARGET_END
 
-void base64_decode(const std::string& encoded_string, std::vector<uint8_t>& result) {
-  int in_len = (int)encoded_string.STR_LENGTH();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  uint8_t char_array_4[4], char_array_3[3];
-  
-  result.clear();
-  
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = (unsigned char)base64_chars.STR_FIND(char_array_4[i]);
-      
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-      
-      for (i = 0; (i < 3); i++)
-        result.push_back(char_array_3[i]);
-      i = 0;
+SIMD_TARGET_BEGIN_AVX2
+  __m256i encodeIndices(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_set_epi8(10,11,9,10,7,8,6,7,4,5,3,4,1,2,0,1,
+                                                 10,11,9,10,7,8,6,7,4,5,3,4,1,2,0,1));
+    const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(t1, t3);
+  }
+
+  __m256i indicesToChars(__m256i indices, __m256i shifts) {
+    __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+    const __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+    range = _mm256_or_si256(range, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    return _mm256_add_epi8(_mm256_shuffle_epi8(shifts, range), indices);
+  }
+
+  bool charsToValues(__m256i chars, __m256i& values, char c62, char c63) {
+    const __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('A'-1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('Z'+1), chars));
+    const __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('a'-1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('z'+1), chars));
+    const __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0'-1)),
+                                           _mm256_cmpgt_epi8(_mm256_set1_epi8('9'+1), chars));
+    const __m256i is62 = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c62));
+    const __m256i is63 = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8(c63));
+    const __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                          _mm256_or_si256(_mm256_or_si256(digit, is62), is63));
+    if (_mm256_movemask_epi8(valid) != -1) return false;
+
+    __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(26-'a')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(52-'0')));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(is62, _mm256_set1_epi8(char(62-c62))));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(is63, _mm256_set1_epi8(char(63-c63))));
+    values = _mm256_add_epi8(chars, shift);
+    return true;
+  }
+
+  // the 24 bytes end up in the low bytes of the result
+  __m256i packValues(__m256i values) {
+    const __m256i pairs = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+    const __m256i groups = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    const __m256i packed = _mm256_shuffle_epi8(groups, _mm256_setr_epi8(2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1,
+                                                                        2,1,0,6,5,4,10,9,8,14,13,12,-1,-1,-1,-1));
+    return _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0,1,2,4,5,6,3,7));
+  }
+
+  // the AVX2 loops leave the last blocks to the SSSE3 loops
+  size_t encodeBlocksAVX2(const uint8_t* source, size_t size, char* target, const char* alphabet) {
+    size_t i = 0;
+    char* out = target;
+    const __m256i shifts = _mm256_broadcastsi128_si256(encodeShifts(alphabet));
+    // the upper lane reads four bytes past the 24 it uses
+    for (;i+28<=size;i += 24) {
+      const __m256i in = _mm256_set_m128i(_mm_loadu_si128((const __m128i*)(source+i+12)),
+                                          _mm_loadu_si128((const __m128i*)(source+i)));
+      _mm256_storeu_si256((__m256i*)out, indicesToChars(encodeIndices(in), shifts));
+      out += 32;
+    }
+    return i + encodeBlocksSSSE3(source+i, size-i, out, alphabet);
+  }
+
+  size_t decodeBlocksAVX2(const char* text, size_t size, uint8_t* target, const char* alphabet) {
+    size_t i = 0;
+    uint8_t* out = target;
+    for (;i+32<=size;i += 32) {
+      __m256i values;
+      if (!charsToValues(_mm256_loadu_si256((const __m256i*)(text+i)), values, alphabet[62], alphabet[63]))
+        return i;
+      const __m256i packed = packValues(values);
+      _mm_storeu_si128((__m128i*)out, _mm256_castsi256_si128(packed));
+      _mm_storel_epi64((__m128i*)(out+16), _mm256_extracti128_si256(packed, 1));
+      out += 24;
     }
+    return i + decodeBlocksSSSE3(text+i, size-i, out, alphabet);
   }
-  
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-    
-    for (j = 0; j <4; j++)
-      char_array_4[j] = (unsigned char)base64_chars.STR_FIND(char_array_4[j]);
-    
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-    
-    for (j = 0; (j < i - 1); j++)
-      result.push_back(char_array_3[j]);
+SIMD_TARGET_END
+#endif
+
+  // encodes complete groups with the widest kernel of the CPU, returns the
+  // number of bytes consumed
+  size_t encodeBlocks(const uint8_t* source, size_t size, char* target, const char* alphabet) {
+#ifdef CPU_X86
+    if (CPUFeatures::hasAVX2()) return encodeBlocksAVX2(source, size, target, alphabet);
+    if (CPUFeatures::hasSSSE3()) return encodeBlocksSSSE3(source, size, target, alphabet);
+#endif
+    return 0;
   }
+
+  // decodes complete groups up to the first block that holds a character
+  // outside of the alphabet, returns the number of characters consumed
+  size_t decodeBlocks(const char* text, size_t size, uint8_t* target, const char* alphabet) {
+#ifdef CPU_X86
+    if (CPUFeatures::hasAVX2()) return decodeBlocksAVX2(text, size, target, alphabet);
+    if (CPUFeatures::hasSSSE3()) return decodeBlocksSSSE3(text, size, target, alphabet);
+#endif
+    return 0;
+  }
+}
+
+Base64Encoder::Base64Encoder(bool url) :
+  url{url}
+{
 }
 
-static const std::string base64url_chars =
-"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-"abcdefghijklmnopqrstuvwxyz"
-"0123456789-_";
+size_t Base64Encoder::encodedSize(size_t size, bool url) {
+  const size_t rest = size % 3;
+  return size/3*4 + (rest ? rest+1 + (3-rest)*(url ? 3 : 1) : 0);
+}
 
+size_t Base64Encoder::update(const uint8_t* data, size_t size, char* target) {
+  const char* alphabet = url ? base64urlChars : base64Chars;
+  char* out = target;
 
-static inline bool is_base64url(uint8_t c) {
-  return (isalnum(c) || (c == '-') || (c == '_'));
+  while (pendingCount > 0 && pendingCount < 3 && size > 0) {
+    pending[pendingCount++] = *data++;
+    --size;
+  }
+  if (pendingCount == 3) {
+    encodeGroup(pending, out, alphabet);
+    out += 4;
+    pendingCount = 0;
+  }
+
+  const size_t blocks = encodeBlocks(data, size, out, alphabet);
+  out += blocks/3*4;
+  size_t i = blocks;
+  for (;i+3<=size;i += 3) {
+    encodeGroup(data+i, out, alphabet);
+    out += 4;
+  }
+  for (;i<size;++i) pending[pendingCount++] = data[i];
+  return size_t(out-target);
 }
 
-std::string base64url_encode(uint8_t const* buf, size_t bufLen) {
-  std::string ret;
-  int i = 0;
-  int j = 0;
-  uint8_t char_array_3[3];
-  uint8_t char_array_4[4];
-  
-  while (bufLen--) {
-    char_array_3[i++] = *(buf++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-      
-      for(i = 0; (i <4) ; i++)
-        ret += base64url_chars[char_array_4[i]];
-      i = 0;
+size_t Base64Encoder::finish(char* target) {
+  if (pendingCount == 0) return 0;
+
+  const char* alphabet = url ? base64urlChars : base64Chars;
+  for (size_t i = pendingCount;i<3;++i) pending[i] = 0;
+  char group[4];
+  encodeGroup(pending, group, alphabet);
+
+  char* out = target;
+  for (size_t i = 0;i<pendingCount+1;++i) *out++ = group[i];
+  for (size_t i = pendingCount;i<3;++i) {
+    if (url) {
+      *out++ = '%';
+      *out++ = '3';
+      *out++ = 'd';
+    } else {
+      *out++ = '=';
     }
   }
-  
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
-    
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-    
-    for (j = 0; (j < i + 1); j++)
-      ret += base64url_chars[char_array_4[j]];
-    
-    while((i++ < 3))
-      ret += "%3d";
-  }
-  
-  return ret;
+  pendingCount = 0;
+  return size_t(out-target);
 }
 
-void base64url_decode(const std::string& encoded_string, std::vector<uint8_t>& result) {
-  int in_len = (int)encoded_string.STR_LENGTH();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  uint8_t char_array_4[4], char_array_3[3];
-  
-  result.clear();
-  
-  while (in_len-- && ( encoded_string[in_] != '%') && is_base64url(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = (unsigned char)base64url_chars.STR_FIND(char_array_4[i]);
-      
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-      
-      for (i = 0; (i < 3); i++)
-        result.push_back(char_array_3[i]);
-      i = 0;
+Base64Decoder::Base64Decoder(bool url) :
+  url{url}
+{
+}
+
+size_t Base64Decoder::update(const char* text, size_t size, uint8_t* target) {
+  if (end) return 0;
+
+  const int8_t* table = decodeTable(url);
+  uint8_t* out = target;
+  size_t i = 0;
+  if (pendingCount == 0) {
+    i = decodeBlocks(text, size, out, url ? base64urlChars : base64Chars);
+    out += i/4*3;
+  }
+
+  for (;i<size;++i) {
+    const int8_t value = table[uint8_t(text[i])];
+    if (value < 0) {
+      end = true;
+      break;
+    }
+    pending[pendingCount++] = uint8_t(value);
+    if (pendingCount == 4) {
+      decodeGroup(pending, out);
+      out += 3;
+      pendingCount = 0;
+      // back to the vector loop once the kept characters are used up
+      if (size-i-1 >= 16) {
+        const size_t blocks = decodeBlocks(text+i+1, size-i-1, out, url ? base64urlChars : base64Chars);
+        out += blocks/4*3;
+        i += blocks;
+      }
     }
   }
-  
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-    
-    for (j = 0; j <4; j++)
-      char_array_4[j] = (unsigned char)base64url_chars.STR_FIND(char_array_4[j]);
-    
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-    
-    for (j = 0; (j < i - 1); j++)
-      result.push_back(char_array_3[j]);
+  return size_t(out-target);
+}
+
+size_t Base64Decoder::finish(uint8_t* target) {
+  size_t count = 0;
+  if (pendingCount > 1) {
+    for (size_t i = pendingCount;i<4;++i) pending[i] = 0;
+    uint8_t group[3];
+    decodeGroup(pending, group);
+    count = pendingCount-1;
+    for (size_t i = 0;i<count;++i) target[i] = group[i];
+  }
+  pendingCount = 0;
+  end = false;
+  return count;
+}
+
+namespace {
+  std::string encode(uint8_t const* buf, size_t bufLen, bool url) {
+    std::string ret(Base64Encoder::encodedSize(bufLen, url), '\0');
+    Base64Encoder encoder{url};
+    const size_t count = encoder.update(buf, bufLen, &ret[0]);
+    encoder.finish(&ret[0] + count);
+    return ret;
+  }
+
+  void decode(const std::string& encoded_string, std::vector<uint8_t>& result, bool url) {
+    result.resize(Base64Decoder::maxDecodedSize(encoded_string.size()));
+    Base64Decoder decoder{url};
+    size_t count = decoder.update(encoded_string.data(), encoded_string.size(), result.data());
+    count += decoder.finish(result.data() + count);
+    result.resize(count);
   }
+
+  // the decoded text up to the first zero byte
+  std::string decodeString(const std::string& encoded_string, bool url) {
+    std::string ret(Base64Decoder::maxDecodedSize(encoded_string.size()), '\0');
+    Base64Decoder decoder{url};
+    uint8_t* target = (uint8_t*)&ret[0];
+    size_t count = decoder.update(encoded_string.data(), encoded_string.size(), target);
+    count += decoder.finish(target + count);
+    ret.resize(std::min(count, ret.find('\0')));
+    return ret;
+  }
+}
+
+std::string base64_encode(const std::vector<uint8_t>& buf) {
+  return encode(buf.data(), buf.size(), false);
+}
+
+std::string base64_encode(uint8_t const* buf, size_t bufLen) {
+  return encode(buf, bufLen, false);
+}
+
+void base64_decode(const std::string& encoded_string, std::vector<uint8_t>& result) {
+  decode(encoded_string, result, false);
+}
+
+std::string base64url_encode(uint8_t const* buf, size_t bufLen) {
+  return encode(buf, bufLen, true);
+}
+
+void base64url_decode(const std::string& encoded_string, std::vector<uint8_t>& result) {
+  decode(encoded_string, result, true);
 }
 
 std::string base64_encode(const std::string& str) {
-  return base64_encode((uint8_t*)str.c_str(), str.size());
+  return encode((const uint8_t*)str.data(), str.size(), false);
 }
 
 std::string base64_decode(const std::string& encoded_string) {
-  if (encoded_string.empty()) return "";
-  std::vector<uint8_t> decoded;
-  base64_decode(encoded_string, decoded);
-  decoded.push_back(0);
-  return std::string((char*)decoded.data());
+  return decodeString(encoded_string, false);
 }
 
-std::string base64url_encode(std::vector<uint8_t> buf) {
-  return base64url_encode(buf.data(), buf.size());
+std::string base64url_encode(const std::vector<uint8_t>& buf) {
+  return encode(buf.data(), buf.size(), true);
 }
 
 std::string base64url_encode(const std::string& str) {
-  return base64url_encode((uint8_t*)str.c_str(), str.size());
+  return encode((const uint8_t*)str.data(), str.size(), true);
 }
 
 std::string base64url_decode(const std::string& encoded_string) {
-  if (encoded_string.empty()) return "";
-  std::vector<uint8_t> decoded;
-  base64url_decode(encoded_string, decoded);
-  decoded.push_back(0);
-  return std::string((char*)decoded.data());
+  return decodeString(encoded_string, true);
 }
 
 
@@ -1,10 +1,11 @@
 #pragma once
 
 #include <cstring> // memset, memcpy
+#include <cstdint>
 #include <string>
 #include <vector>
 
-std::string base64_encode(std::vector<uint8_t> buf);
+std::string base64_encode(const std::vector<uint8_t>& buf);
 std::string base64_encode(uint8_t const* buf, size_t bufLen);
 void base64_decode(const std::string& encoded_string, std::vector<uint8_t>& result);
 
@@ -14,10 +15,58 @@ std::string base64_decode(const std::string& encoded_string);
 std::string base64url_encode(uint8_t const* buf, size_t bufLen);
 void base64url_decode(const std::string& encoded_string, std::vector<uint8_t>& result);
 
-std::string base64url_encode(std::vector<uint8_t> buf);
+std::string base64url_encode(const std::vector<uint8_t>& buf);
 std::string base64url_encode(const std::string& str);
 std::string base64url_decode(const std::string& encoded_string);
 
+// Streaming Base64 into caller provided buffers, with SSSE3 and AVX2 where
+// available. The functions above are built on these. The url alphabet uses
+// '-' and '_' and pads with "%3d" instead of '='.
+class Base64Encoder {
+public:
+  Base64Encoder(bool url=false);
+
+  // the most characters update writes for size bytes
+  static size_t maxEncodedSize(size_t size) {return (size+2)/3*4;}
+  // the characters of a complete encoding of size bytes, padding included
+  static size_t encodedSize(size_t size, bool url=false);
+
+  // encodes all complete groups of three bytes, the rest is kept for the
+  // next call, returns the number of characters written
+  size_t update(const uint8_t* data, size_t size, char* target);
+  // encodes the kept bytes with padding, at most 10 characters, and
+  // resets the encoder
+  size_t finish(char* target);
+
+private:
+  bool url;
+  uint8_t pending[3];
+  size_t pendingCount{0};
+};
+
+// Decoding stops at the first character outside of the alphabet, such as
+// the padding, and ignores everything after it.
+class Base64Decoder {
+public:
+  Base64Decoder(bool url=false);
+
+  // the most bytes update writes for size characters
+  static size_t maxDecodedSize(size_t size) {return (size+3)/4*3;}
+
+  // decodes all complete groups of four characters, the rest is kept for
+  // the next call, returns the number of bytes written
+  size_t update(const char* text, size_t size, uint8_t* target);
+  // decodes the kept characters, at most 2 bytes, and resets the decoder
+  size_t finish(uint8_t* target);
+  bool stopped() const {return end;}
+
+private:
+  bool url;
+  bool end{false};
+  uint8_t pending[4];
+  size_t pendingCount{0};
+};
+
 
 /*
  The MIT License
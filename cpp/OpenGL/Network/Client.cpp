@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 
@@ -172,7 +173,9 @@ void Client::clientFunc() {
         bool receivedData{ false };
         try {
           int8_t data[2048];
-          const uint32_t maxSize = std::min<uint32_t>(std::max<uint32_t>(4,messageLength),2048);
+          // never read beyond the current message, see SizedClientConnection
+          const size_t missing = (messageLength == 0 ? 4 : size_t(messageLength)+4) - recievedBytes.size();
+          const uint32_t maxSize = uint32_t(std::clamp<size_t>(missing, 1, 2048));
           const uint32_t bytes = connection->ReceiveData(data, maxSize, 1);
           if (bytes > 0) {
             receivedData = true;
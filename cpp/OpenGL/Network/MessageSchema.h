@@ -0,0 +1,401 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <charconv>
+#include <type_traits>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+#include "NetCommon.h"
+
+// Messages that declare their fields once, as a constexpr tuple returned by
+// a static schema() method:
+//
+//   struct Move {
+//     std::string_view player;
+//     uint32_t x, y;
+//     static constexpr auto schema() {
+//       return std::make_tuple(MessageSchema::constant("move"),
+//                              MessageSchema::field("player", &Move::player),
+//                              MessageSchema::field("x", &Move::x),
+//                              MessageSchema::field("y", &Move::y));
+//     }
+//   };
+//
+// Fields may be integers, enums, float, double, bool, std::string and
+// std::string_view, constants are fixed strings checked when decoding.
+// Two wire formats are supported: the binary format of BinaryEncoder and
+// BinaryDecoder, and the text format of StringEncoder and Tokenizer. All
+// encoders write into caller provided buffers, fixed width fields with a
+// single memcpy, and the decoders fill std::string_view fields with views
+// into the message instead of copies. Errors throw a MessageException.
+namespace MessageSchema {
+
+  template <typename Class, typename T>
+  struct Field {
+    const char* name;
+    T Class::* member;
+  };
+
+  struct Constant {
+    const char* value;
+  };
+
+  template <typename Class, typename T>
+  constexpr Field<Class, T> field(const char* name, T Class::* member) {return {name, member};}
+
+  constexpr Constant constant(const char* value) {return {value};}
+
+  namespace detail {
+    template <typename T>
+    constexpr bool isString = std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view>;
+
+    template <typename T>
+    struct Wire {
+      using type = T;
+    };
+    template <>
+    struct Wire<float> {
+      using type = uint32_t;
+    };
+    template <>
+    struct Wire<double> {
+      using type = uint64_t;
+    };
+
+    template <typename Class, typename T>
+    constexpr const char* fieldName(const Field<Class, T>& field) {return field.name;}
+    constexpr const char* fieldName(const Constant& constant) {return constant.value;}
+
+    template <typename M, typename F>
+    void forEach(F&& f) {
+      std::apply([&](const auto&... fields) {(f(fields), ...);}, M::schema());
+    }
+
+    class Writer {
+    public:
+      Writer(uint8_t* buffer, size_t capacity) : begin{buffer}, pos{buffer}, end{buffer+capacity} {}
+
+      uint8_t* reserve(size_t size) {
+        if (size_t(end-pos) < size) throw MessageException("Buffer too short");
+        uint8_t* result = pos;
+        pos += size;
+        return result;
+      }
+      void put(const void* data, size_t size) {
+        if (size > 0) std::memcpy(reserve(size), data, size);
+      }
+      uint8_t* current() const {return pos;}
+      uint8_t* limit() const {return end;}
+      void advanceTo(uint8_t* p) {pos = p;}
+      size_t written() const {return size_t(pos-begin);}
+
+    private:
+      uint8_t* begin;
+      uint8_t* pos;
+      uint8_t* end;
+    };
+
+    class Reader {
+    public:
+      Reader(const uint8_t* data, size_t size) : pos{data}, end{data+size} {}
+
+      const uint8_t* take(size_t size) {
+        if (size_t(end-pos) < size) throw MessageException("Message too short");
+        const uint8_t* result = pos;
+        pos += size;
+        return result;
+      }
+      const uint8_t* current() const {return pos;}
+      const uint8_t* limit() const {return end;}
+      void advanceTo(const uint8_t* p) {pos = p;}
+
+    private:
+      const uint8_t* pos;
+      const uint8_t* end;
+    };
+
+    // binary, fixed width values are stored as the bytes of swapEndian(value)
+    // on every host, as BinaryEncoder::add does
+    template <typename T>
+    void writeBinary(Writer& w, const T& value) {
+      if constexpr (std::is_enum_v<T>) {
+        writeBinary(w, std::underlying_type_t<T>(value));
+      } else if constexpr (std::is_same_v<T, bool>) {
+        writeBinary(w, uint8_t(value));
+      } else if constexpr (isString<T>) {
+        writeBinary(w, uint32_t(value.size()));
+        w.put(value.data(), value.size());
+      } else {
+        static_assert(std::is_arithmetic_v<T>, "unsupported field type");
+        typename Wire<T>::type bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits = swapEndian(bits);
+        w.put(&bits, sizeof(bits));
+      }
+    }
+
+    template <typename T>
+    void readBinary(Reader& r, T& value) {
+      if constexpr (std::is_enum_v<T>) {
+        std::underlying_type_t<T> i;
+        readBinary(r, i);
+        value = T(i);
+      } else if constexpr (std::is_same_v<T, bool>) {
+        value = *r.take(1) != 0;
+      } else if constexpr (isString<T>) {
+        uint32_t size;
+        readBinary(r, size);
+        value = T(reinterpret_cast<const char*>(r.take(size)), size);
+      } else {
+        static_assert(std::is_arithmetic_v<T>, "unsupported field type");
+        typename Wire<T>::type bits;
+        std::memcpy(&bits, r.take(sizeof(bits)), sizeof(bits));
+        bits = swapEndian(bits);
+        std::memcpy(&value, &bits, sizeof(bits));
+      }
+    }
+
+    template <typename T>
+    size_t binarySize(const T& value) {
+      if constexpr (std::is_same_v<T, bool>) return 1;
+      else if constexpr (std::is_enum_v<T>) return sizeof(std::underlying_type_t<T>);
+      else if constexpr (isString<T>) return sizeof(uint32_t) + value.size();
+      else return sizeof(T);
+    }
+
+    // text, every value is followed by the delimiter, integers are written
+    // as decimals, float and double as std::to_string does, delimiters are
+    // dropped from strings, as StringEncoder::add does
+    template <typename T>
+    void writeText(Writer& w, const T& value, char delimiter) {
+      if constexpr (std::is_enum_v<T>) {
+        writeText(w, std::underlying_type_t<T>(value), delimiter);
+        return;
+      } else if constexpr (std::is_same_v<T, bool>) {
+        const char c = value ? '1' : '0';
+        w.put(&c, 1);
+      } else if constexpr (isString<T>) {
+        const char* p = value.data();
+        const char* end = p + value.size();
+        while (p < end) {
+          const char* d = static_cast<const char*>(std::memchr(p, delimiter, size_t(end-p)));
+          const char* stop = d ? d : end;
+          w.put(p, size_t(stop-p));
+          p = d ? d+1 : end;
+        }
+      } else if constexpr (std::is_floating_point_v<T>) {
+        char* p = reinterpret_cast<char*>(w.current());
+        const size_t space = size_t(w.limit()-w.current());
+        const int length = std::snprintf(p, space, "%f", double(value));
+        if (length < 0 || size_t(length) >= space) throw MessageException("Buffer too short");
+        w.advanceTo(w.current()+length);
+      } else {
+        static_assert(std::is_integral_v<T>, "unsupported field type");
+        const auto result = std::to_chars(reinterpret_cast<char*>(w.current()),
+                                          reinterpret_cast<char*>(w.limit()), value);
+        if (result.ec != std::errc()) throw MessageException("Buffer too short");
+        w.advanceTo(reinterpret_cast<uint8_t*>(result.ptr));
+      }
+      w.put(&delimiter, 1);
+    }
+
+    inline std::string_view nextToken(Reader& r, char delimiter) {
+      const uint8_t* begin = r.current();
+      const void* d = std::memchr(begin, delimiter, size_t(r.limit()-begin));
+      if (!d) throw MessageException("Message too short");
+      r.advanceTo(static_cast<const uint8_t*>(d)+1);
+      return {reinterpret_cast<const char*>(begin), size_t(static_cast<const uint8_t*>(d)-begin)};
+    }
+
+    template <typename T>
+    void readText(Reader& r, T& value, char delimiter) {
+      if constexpr (std::is_enum_v<T>) {
+        std::underlying_type_t<T> i;
+        readText(r, i, delimiter);
+        value = T(i);
+      } else if constexpr (std::is_same_v<T, bool>) {
+        uint32_t i;
+        readText(r, i, delimiter);
+        value = i != 0;
+      } else if constexpr (isString<T>) {
+        const std::string_view token = nextToken(r, delimiter);
+        value = T(token.data(), token.size());
+      } else if constexpr (std::is_floating_point_v<T>) {
+        const std::string_view token = nextToken(r, delimiter);
+        char text[512];
+        if (token.empty() || token.size() >= sizeof(text)) throw MessageException("Value is not a number");
+        std::memcpy(text, token.data(), token.size());
+        text[token.size()] = 0;
+        char* end;
+        const double d = std::strtod(text, &end);
+        if (end != text+token.size()) throw MessageException("Value is not a number");
+        value = T(d);
+      } else {
+        static_assert(std::is_integral_v<T>, "unsupported field type");
+        const std::string_view token = nextToken(r, delimiter);
+        const auto result = std::from_chars(token.data(), token.data()+token.size(), value);
+        if (result.ec == std::errc::result_out_of_range) throw MessageException("Value out of range");
+        if (result.ec != std::errc() || result.ptr != token.data()+token.size())
+          throw MessageException("Value is not an integer");
+      }
+    }
+
+    template <typename T>
+    size_t textSize(const T& value, char delimiter) {
+      if constexpr (std::is_enum_v<T>) {
+        return textSize(std::underlying_type_t<T>(value), delimiter);
+      } else if constexpr (std::is_same_v<T, bool>) {
+        return 2;
+      } else if constexpr (isString<T>) {
+        size_t size = value.size()+1;
+        for (const char c : value) size -= c == delimiter;
+        return size;
+      } else if constexpr (std::is_floating_point_v<T>) {
+        return size_t(std::snprintf(nullptr, 0, "%f", double(value)))+1;
+      } else {
+        char digits[24];
+        return size_t(std::to_chars(digits, digits+sizeof(digits), value).ptr-digits)+1;
+      }
+    }
+  }
+
+  template <typename M>
+  constexpr size_t fieldCount() {
+    return std::tuple_size_v<decltype(M::schema())>;
+  }
+
+  // the names of all fields, constants are named by their value
+  template <typename M>
+  constexpr std::array<const char*, fieldCount<M>()> fieldNames() {
+    return std::apply([](const auto&... fields) {
+      return std::array<const char*, fieldCount<M>()>{detail::fieldName(fields)...};
+    }, M::schema());
+  }
+
+  // calls f(name, value) for all fields in order, constants are skipped
+  template <typename M, typename F>
+  void forEachField(const M& m, F&& f) {
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (!std::is_same_v<std::decay_t<decltype(field)>, Constant>)
+        f(field.name, m.*field.member);
+    });
+  }
+
+  // the fields as "name=value" pairs, for debugging
+  template <typename M>
+  std::string describe(const M& m) {
+    std::stringstream ss;
+    bool first = true;
+    forEachField(m, [&](const char* name, const auto& value) {
+      using T = std::decay_t<decltype(value)>;
+      ss << (first ? "" : ", ") << name << "=";
+      if constexpr (std::is_enum_v<T>) ss << int64_t(value);
+      else if constexpr (detail::isString<T>) ss << "\"" << value << "\"";
+      else if constexpr (std::is_integral_v<T> && sizeof(T) == 1) ss << int32_t(value);
+      else ss << value;
+      first = false;
+    });
+    return ss.str();
+  }
+
+  template <typename M>
+  size_t binarySize(const M& m) {
+    size_t size = 0;
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(field)>, Constant>)
+        size += sizeof(uint32_t) + std::strlen(field.value);
+      else
+        size += detail::binarySize(m.*field.member);
+    });
+    return size;
+  }
+
+  // returns the number of bytes written
+  template <typename M>
+  size_t encodeBinary(const M& m, uint8_t* buffer, size_t capacity) {
+    detail::Writer w{buffer, capacity};
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(field)>, Constant>)
+        detail::writeBinary(w, std::string_view(field.value));
+      else
+        detail::writeBinary(w, m.*field.member);
+    });
+    return w.written();
+  }
+
+  // returns the number of bytes read, string_view fields point into data
+  template <typename M>
+  size_t decodeBinary(const uint8_t* data, size_t size, M& m) {
+    detail::Reader r{data, size};
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(field)>, Constant>) {
+        std::string_view value;
+        detail::readBinary(r, value);
+        if (value != field.value) throw MessageException("Invalid message");
+      } else {
+        detail::readBinary(r, m.*field.member);
+      }
+    });
+    return size_t(r.current()-data);
+  }
+
+  template <typename M>
+  size_t textSize(const M& m, char delimiter = char(1)) {
+    size_t size = 0;
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(field)>, Constant>)
+        size += detail::textSize(std::string_view(field.value), delimiter);
+      else
+        size += detail::textSize(m.*field.member, delimiter);
+    });
+    return size;
+  }
+
+  // returns the number of characters written
+  template <typename M>
+  size_t encodeText(const M& m, char* buffer, size_t capacity, char delimiter = char(1)) {
+    detail::Writer w{reinterpret_cast<uint8_t*>(buffer), capacity};
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(field)>, Constant>)
+        detail::writeText(w, std::string_view(field.value), delimiter);
+      else
+        detail::writeText(w, m.*field.member, delimiter);
+    });
+    return w.written();
+  }
+
+  // returns the number of characters read, string_view fields point into text
+  template <typename M>
+  size_t decodeText(std::string_view text, M& m, char delimiter = char(1)) {
+    detail::Reader r{reinterpret_cast<const uint8_t*>(text.data()), text.size()};
+    detail::forEach<M>([&](const auto& field) {
+      if constexpr (std::is_same_v<std::decay_t<decltype(field)>, Constant>) {
+        if (detail::nextToken(r, delimiter) != field.value) throw MessageException("Invalid message");
+      } else {
+        detail::readText(r, m.*field.member, delimiter);
+      }
+    });
+    return size_t(r.current()-reinterpret_cast<const uint8_t*>(text.data()));
+  }
+
+  template <typename M>
+  std::vector<uint8_t> toBinary(const M& m) {
+    std::vector<uint8_t> result(binarySize(m));
+    encodeBinary(m, result.data(), result.size());
+    return result;
+  }
+
+  template <typename M>
+  std::string toText(const M& m, char delimiter = char(1)) {
+    std::string result(textSize(m, delimiter), ' ');
+    encodeText(m, result.data(), result.size(), delimiter);
+    return result;
+  }
+}
@@ -144,7 +144,10 @@ SizedClientConnection::SizedClientConnection(TCPSocket* connectionSocket, uint32
 
 DataResult SizedClientConnection::checkData() {
   int8_t data[2048];
-  const uint32_t maxSize = std::clamp<uint32_t>(messageLength, 4, 2048);
+  // never read beyond the current message, the start of the next one would
+  // wait in receivedBytes until more data arrives
+  const size_t missing = (messageLength == 0 ? 4 : size_t(messageLength)+4) - receivedBytes.size();
+  const uint32_t maxSize = uint32_t(std::clamp<size_t>(missing, 1, 2048));
   const uint32_t bytes = connectionSocket->ReceiveData(data, maxSize, 1);
   if (bytes > 0) {
     return handleIncommingData(data, bytes);
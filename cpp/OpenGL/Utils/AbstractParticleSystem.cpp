@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "AbstractParticleSystem.h"
 
 std::vector<uint8_t> spritePixel{
@@ -131,7 +133,8 @@ void AbstractParticleSystem::render(const Mat4& v, const Mat4& p) {
     glEnable( GL_PROGRAM_POINT_SIZE );
 
 	particleArray.bind();
-	vbPosColor.setData(getData(),7,GL_DYNAMIC_DRAW);
+	fillData(vbPosColor.map(getParticleCount()*7, 7));
+	vbPosColor.unmap();
 
 	glDrawArrays(GL_POINTS, 0, GLsizei(getParticleCount()));
 
@@ -140,6 +143,11 @@ void AbstractParticleSystem::render(const Mat4& v, const Mat4& p) {
 	glDepthMask(GL_TRUE);
 }
 
+void AbstractParticleSystem::fillData(float* target) const {
+	const std::vector<float> data = getData();
+	std::copy(data.begin(), data.end(), target);
+}
+
 Vec3 AbstractParticleSystem::computeColor(const Vec3& c) {
     if (c == RANDOM_COLOR)
         return Vec3::random();
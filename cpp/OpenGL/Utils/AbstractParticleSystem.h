@@ -7,9 +7,7 @@
 #include "GLBuffer.h"
 #include "GLArray.h"
 #include "GLTexture2D.h"
-
-const Vec3 RANDOM_COLOR{-1.0f,-1.0f,-1.0f};
-const Vec3 RAINBOW_COLOR{-2.0f,-2.0f,-2.0f};
+#include "ParticleSimulation.h"
 
 class AbstractParticleSystem {
 public:
@@ -27,6 +25,9 @@ public:
 	void render(const Mat4& v, const Mat4& p);
 	
 	virtual std::vector<float> getData() const = 0;
+	// writes the 7 floats per particle getData returns straight to target,
+	// systems that can do so without a temporary vector override this
+	virtual void fillData(float* target) const;
 	virtual size_t getParticleCount() const = 0;
 
     static Vec3 computeColor(const Vec3& c);
@@ -0,0 +1,422 @@
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "BrickedVolume.h"
+
+static const char fileMagic[4] = {'B','V','O','L'};
+static const uint32_t fileVersion{1};
+// bricks start at page boundaries so they can be dropped individually
+static const uint64_t brickAlignment{4096};
+
+template <typename T> static void writeValue(std::ostream& os, const T& value) {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+static uint16_t voxel(const uint8_t* data, size_t index, uint32_t bytesPerVoxel) {
+  if (bytesPerVoxel == 1) return data[index];
+  return uint16_t(data[2*index] | (uint16_t(data[2*index+1]) << 8));
+}
+
+static BrickLevel makeLevel(uint32_t width, uint32_t height, uint32_t depth) {
+  BrickLevel level;
+  level.width   = width;
+  level.height  = height;
+  level.depth   = depth;
+  level.bricksX = (width  + BrickedVolume::brickSize-1) / BrickedVolume::brickSize;
+  level.bricksY = (height + BrickedVolume::brickSize-1) / BrickedVolume::brickSize;
+  level.bricksZ = (depth  + BrickedVolume::brickSize-1) / BrickedVolume::brickSize;
+  level.bricks.resize(size_t(level.bricksX)*level.bricksY*level.bricksZ);
+  return level;
+}
+
+const uint32_t BrickedVolume::brickSize;
+const uint32_t BrickedVolume::ghostBefore;
+const uint32_t BrickedVolume::ghostAfter;
+const uint32_t BrickedVolume::storedSize;
+
+static MappedFile mapVolume(const std::string& filename) {
+  try {
+    return MappedFile{filename};
+  } catch (const MappedFileException& e) {
+    throw BrickedVolumeException{e.what()};
+  }
+}
+
+BrickedVolume::BrickedVolume(const std::string& filename, size_t memoryBudget) :
+  memoryBudget(memoryBudget),
+  file(mapVolume(filename))
+{
+  parse();
+}
+
+void BrickedVolume::parse() {
+  size_t position{0};
+  auto read = [this, &position](void* target, size_t size) {
+    if (position + size > file.size()) throw BrickedVolumeException{"truncated bricked volume"};
+    memcpy(target, file.data() + position, size);
+    position += size;
+  };
+
+  char magic[4];
+  uint32_t version, fileBrickSize, fileGhostBefore, fileGhostAfter, levelCount;
+  float s[3];
+  uint64_t tableOffset;
+  read(magic, 4);
+  read(&version, 4);
+  read(&bytesPerVoxel, 4);
+  read(&fileBrickSize, 4);
+  read(&fileGhostBefore, 4);
+  read(&fileGhostAfter, 4);
+  read(s, 12);
+  read(&levelCount, 4);
+  read(&tableOffset, 8);
+
+  if (memcmp(magic, fileMagic, 4) != 0) throw BrickedVolumeException{"not a bricked volume"};
+  if (version != fileVersion) throw BrickedVolumeException{"unsupported bricked volume version"};
+  if (fileBrickSize != brickSize || fileGhostBefore != ghostBefore || fileGhostAfter != ghostAfter)
+    throw BrickedVolumeException{"unsupported brick layout"};
+  if (bytesPerVoxel != 1 && bytesPerVoxel != 2) throw BrickedVolumeException{"unsupported voxel size"};
+  if (levelCount == 0) throw BrickedVolumeException{"bricked volume without levels"};
+  scale = Vec3{s[0], s[1], s[2]};
+
+  position = size_t(tableOffset);
+  for (uint32_t i = 0;i<levelCount;++i) {
+    uint32_t size[3];
+    read(size, 12);
+    BrickLevel level = makeLevel(size[0], size[1], size[2]);
+    for (BrickInfo& brick : level.bricks) {
+      read(&brick.offset, 8);
+      read(&brick.minValue, 2);
+      read(&brick.maxValue, 2);
+      if (brick.offset + storedBytes(bytesPerVoxel) > file.size())
+        throw BrickedVolumeException{"brick outside of the file"};
+    }
+    levels.push_back(std::move(level));
+  }
+}
+
+size_t BrickedVolume::getResidentBytes() const {
+  const std::lock_guard<std::mutex> lock{residentMutex};
+  return resident.size() * storedBytes(bytesPerVoxel);
+}
+
+size_t BrickedVolume::getPeakResidentBytes() const {
+  const std::lock_guard<std::mutex> lock{residentMutex};
+  return peakResident * storedBytes(bytesPerVoxel);
+}
+
+const uint8_t* BrickedVolume::getBrick(size_t level, uint32_t bx, uint32_t by, uint32_t bz) const {
+  const BrickLevel& l = levels[level];
+  const size_t index = l.brickIndex(bx, by, bz);
+  const uint8_t* brick = file.data() + l.bricks[index].offset;
+  touch(level, index, brick);
+  return brick;
+}
+
+void BrickedVolume::touch(size_t level, size_t index, const uint8_t* brick) const {
+  const uint64_t key = (uint64_t(level) << 48) | uint64_t(index);
+  const std::lock_guard<std::mutex> lock{residentMutex};
+
+  const auto it = resident.find(key);
+  if (it != resident.end()) {
+    lru.splice(lru.begin(), lru, it->second);
+    return;
+  }
+
+#ifndef _WIN32
+  // start reading ahead while the caller begins with the first voxels
+  const uintptr_t pageSize = uintptr_t(sysconf(_SC_PAGESIZE));
+  const uintptr_t start = uintptr_t(brick) & ~(pageSize-1);
+  madvise(reinterpret_cast<void*>(start), uintptr_t(brick) + storedBytes(bytesPerVoxel) - start, MADV_WILLNEED);
+#endif
+
+  lru.push_front(key);
+  resident[key] = lru.begin();
+
+  const size_t capacity = std::max<size_t>(1, memoryBudget / storedBytes(bytesPerVoxel));
+  while (resident.size() > capacity) {
+    const uint64_t victim = lru.back();
+    lru.pop_back();
+    resident.erase(victim);
+    const BrickLevel& l = levels[size_t(victim >> 48)];
+    release(file.data() + l.bricks[size_t(victim & ((uint64_t(1) << 48)-1))].offset);
+  }
+  peakResident = std::max(peakResident, resident.size());
+}
+
+void BrickedVolume::release(const uint8_t* brick) const {
+#ifdef _WIN32
+  // trims the pages from the working set, they come back from the file
+  VirtualUnlock(const_cast<uint8_t*>(brick), storedBytes(bytesPerVoxel));
+#else
+  // only whole pages of the brick can go
+  const uintptr_t pageSize = uintptr_t(sysconf(_SC_PAGESIZE));
+  const uintptr_t start = (uintptr_t(brick) + pageSize-1) & ~(pageSize-1);
+  const uintptr_t end = (uintptr_t(brick) + storedBytes(bytesPerVoxel)) & ~(pageSize-1);
+  if (end > start) madvise(reinterpret_cast<void*>(start), end-start, MADV_DONTNEED);
+#endif
+}
+
+BrickedVolumeWriter::BrickedVolumeWriter(const std::string& filename, uint32_t width, uint32_t height,
+                                         uint32_t depth, uint32_t bytesPerVoxel, const Vec3& scale) :
+  file(filename, std::ios::binary),
+  filename(filename),
+  bytesPerVoxel(bytesPerVoxel),
+  scale(scale)
+{
+  if (!file) throw BrickedVolumeException{std::string("Unable to write ")+filename};
+  if (bytesPerVoxel != 1 && bytesPerVoxel != 2) throw BrickedVolumeException{"unsupported voxel size"};
+  if (width == 0 || height == 0 || depth == 0) throw BrickedVolumeException{"empty volume"};
+
+  levels.push_back(LevelWriter{makeLevel(width, height, depth)});
+  while (levels.back().info.bricks.size() > 1) {
+    const BrickLevel& last = levels.back().info;
+    levels.push_back(LevelWriter{makeLevel((last.width+1)/2, (last.height+1)/2, (last.depth+1)/2)});
+  }
+
+  // the header is written by finish, keep its page free
+  const std::vector<char> header(brickAlignment, 0);
+  file.write(header.data(), std::streamsize(header.size()));
+}
+
+BrickedVolumeWriter::~BrickedVolumeWriter() {
+  file.close();
+}
+
+void BrickedVolumeWriter::addSlice(const uint8_t* slice) {
+  const BrickLevel& info = levels[0].info;
+  if (finished || levels[0].receivedSlices == info.depth)
+    throw BrickedVolumeException{"more slices than the volume is deep"};
+  addSlice(0, std::vector<uint8_t>(slice, slice + size_t(info.width)*info.height*bytesPerVoxel));
+}
+
+void BrickedVolumeWriter::addSlice(size_t levelIndex, std::vector<uint8_t> slice) {
+  LevelWriter& level = levels[levelIndex];
+  const uint32_t z = level.receivedSlices++;
+
+  // the next level gets the average of every pair of slices
+  if (levelIndex+1 < levels.size()) {
+    if (z % 2 == 1) {
+      addSlice(levelIndex+1, downsample(level, level.evenSlice, slice));
+    } else if (z+1 == level.info.depth) {
+      addSlice(levelIndex+1, downsample(level, slice, slice));
+    } else {
+      level.evenSlice = slice;
+    }
+  }
+  level.slices.push_back(std::move(slice));
+
+  // write every layer of bricks whose slices including the ghosts are complete
+  while (level.nextLayer < level.info.bricksZ) {
+    const uint32_t lastSlice = std::min(level.nextLayer*BrickedVolume::brickSize +
+                                        BrickedVolume::brickSize + BrickedVolume::ghostAfter - 1,
+                                        level.info.depth-1);
+    if (z < lastSlice) break;
+    writeLayer(level, level.nextLayer++);
+
+    const uint32_t firstSlice = uint32_t(std::max<int64_t>(0, int64_t(level.nextLayer*BrickedVolume::brickSize) -
+                                                              int64_t(BrickedVolume::ghostBefore)));
+    while (level.firstSlice < firstSlice && !level.slices.empty()) {
+      level.slices.pop_front();
+      level.firstSlice++;
+    }
+  }
+}
+
+std::vector<uint8_t> BrickedVolumeWriter::downsample(const LevelWriter& level, const std::vector<uint8_t>& a,
+                                                     const std::vector<uint8_t>& b) const {
+  const uint32_t width = level.info.width;
+  const uint32_t height = level.info.height;
+  const uint32_t halfWidth = (width+1)/2;
+  const uint32_t halfHeight = (height+1)/2;
+  std::vector<uint8_t> result(size_t(halfWidth)*halfHeight*bytesPerVoxel);
+
+  for (uint32_t y = 0;y<halfHeight;++y) {
+    const uint32_t y0 = 2*y;
+    const uint32_t y1 = std::min(2*y+1, height-1);
+    for (uint32_t x = 0;x<halfWidth;++x) {
+      const uint32_t x0 = 2*x;
+      const uint32_t x1 = std::min(2*x+1, width-1);
+      uint32_t sum{4};
+      for (const std::vector<uint8_t>* s : {&a, &b}) {
+        sum += voxel(s->data(), x0 + size_t(y0)*width, bytesPerVoxel) +
+               voxel(s->data(), x1 + size_t(y0)*width, bytesPerVoxel) +
+               voxel(s->data(), x0 + size_t(y1)*width, bytesPerVoxel) +
+               voxel(s->data(), x1 + size_t(y1)*width, bytesPerVoxel);
+      }
+      const uint16_t value = uint16_t(sum/8);
+      const size_t index = x + size_t(y)*halfWidth;
+      if (bytesPerVoxel == 1) {
+        result[index] = uint8_t(value);
+      } else {
+        result[2*index]   = uint8_t(value & 0xFF);
+        result[2*index+1] = uint8_t(value >> 8);
+      }
+    }
+  }
+  return result;
+}
+
+void BrickedVolumeWriter::writeLayer(LevelWriter& level, uint32_t bz) {
+  const BrickLevel& info = level.info;
+  const uint32_t size = BrickedVolume::storedSize;
+  std::vector<uint8_t> brick(BrickedVolume::storedBytes(bytesPerVoxel));
+
+  // voxels outside of the volume repeat the border
+  auto clamped = [](uint32_t brickIndex, uint32_t i, uint32_t extent) {
+    const int64_t v = int64_t(brickIndex)*BrickedVolume::brickSize + i - BrickedVolume::ghostBefore;
+    return uint32_t(std::clamp<int64_t>(v, 0, int64_t(extent)-1));
+  };
+
+  std::vector<uint32_t> xs(size);
+  for (uint32_t by = 0;by<info.bricksY;++by) {
+    for (uint32_t bx = 0;bx<info.bricksX;++bx) {
+      for (uint32_t i = 0;i<size;++i) xs[i] = clamped(bx, i, info.width);
+
+      uint8_t* target = brick.data();
+      for (uint32_t z = 0;z<size;++z) {
+        const std::vector<uint8_t>& slice = level.slices[clamped(bz, z, info.depth) - level.firstSlice];
+        for (uint32_t y = 0;y<size;++y) {
+          const uint8_t* row = slice.data() + size_t(clamped(by, y, info.height))*info.width*bytesPerVoxel;
+          if (bytesPerVoxel == 1) {
+            for (uint32_t x = 0;x<size;++x) *target++ = row[xs[x]];
+          } else {
+            for (uint32_t x = 0;x<size;++x) {
+              *target++ = row[2*xs[x]];
+              *target++ = row[2*xs[x]+1];
+            }
+          }
+        }
+      }
+
+      uint16_t minValue = 65535;
+      uint16_t maxValue = 0;
+      for (size_t i = 0;i<brick.size()/bytesPerVoxel;++i) {
+        const uint16_t v = voxel(brick.data(), i, bytesPerVoxel);
+        minValue = std::min(minValue, v);
+        maxValue = std::max(maxValue, v);
+      }
+
+      const uint64_t position = uint64_t(file.tellp());
+      const uint64_t offset = (position + brickAlignment-1) / brickAlignment * brickAlignment;
+      const std::vector<char> padding(offset-position, 0);
+      file.write(padding.data(), std::streamsize(padding.size()));
+      file.write(reinterpret_cast<const char*>(brick.data()), std::streamsize(brick.size()));
+      if (!file) throw BrickedVolumeException{std::string("Unable to write ")+filename};
+
+      level.info.bricks[info.brickIndex(bx, by, bz)] = BrickInfo{offset, minValue, maxValue};
+    }
+  }
+}
+
+void BrickedVolumeWriter::finish() {
+  if (finished) return;
+  if (levels[0].receivedSlices != levels[0].info.depth)
+    throw BrickedVolumeException{"not all slices of the volume were added"};
+
+  const uint64_t tableOffset = uint64_t(file.tellp());
+  for (const LevelWriter& level : levels) {
+    writeValue(file, level.info.width);
+    writeValue(file, level.info.height);
+    writeValue(file, level.info.depth);
+    for (const BrickInfo& brick : level.info.bricks) {
+      writeValue(file, brick.offset);
+      writeValue(file, brick.minValue);
+      writeValue(file, brick.maxValue);
+    }
+  }
+
+  file.seekp(0);
+  file.write(fileMagic, 4);
+  writeValue(file, fileVersion);
+  writeValue(file, bytesPerVoxel);
+  writeValue(file, uint32_t(BrickedVolume::brickSize));
+  writeValue(file, uint32_t(BrickedVolume::ghostBefore));
+  writeValue(file, uint32_t(BrickedVolume::ghostAfter));
+  writeValue(file, scale.x);
+  writeValue(file, scale.y);
+  writeValue(file, scale.z);
+  writeValue(file, uint32_t(levels.size()));
+  writeValue(file, tableOffset);
+  file.close();
+  if (!file) throw BrickedVolumeException{std::string("Unable to write ")+filename};
+  finished = true;
+}
+
+VolumeStatistics computeStatistics(const BrickedVolume& volume, size_t level) {
+  const BrickLevel& l = volume.getLevel(level);
+  const uint32_t bytesPerVoxel = volume.getBytesPerVoxel();
+  const uint32_t binShift = bytesPerVoxel == 1 ? 0 : 8;
+
+  VolumeStatistics stats;
+  stats.minValue = volume.getMaxValue();
+  stats.histogram.resize(256, 0);
+  double sum{0.0};
+  double squaredSum{0.0};
+
+  #pragma omp parallel
+  {
+    std::vector<uint64_t> histogram(256, 0);
+    uint16_t minValue = volume.getMaxValue();
+    uint16_t maxValue = 0;
+    double threadSum{0.0};
+    double threadSquaredSum{0.0};
+    uint64_t count{0};
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t i = 0;i<int64_t(l.bricks.size());++i) {
+      const uint32_t bx = uint32_t(size_t(i) % l.bricksX);
+      const uint32_t by = uint32_t(size_t(i) / l.bricksX % l.bricksY);
+      const uint32_t bz = uint32_t(size_t(i) / l.bricksX / l.bricksY);
+      const uint8_t* brick = volume.getBrick(level, bx, by, bz);
+
+      // only the voxels that belong to this brick, no ghosts
+      const int32_t sizeX = int32_t(std::min(BrickedVolume::brickSize, l.width  - bx*BrickedVolume::brickSize));
+      const int32_t sizeY = int32_t(std::min(BrickedVolume::brickSize, l.height - by*BrickedVolume::brickSize));
+      const int32_t sizeZ = int32_t(std::min(BrickedVolume::brickSize, l.depth  - bz*BrickedVolume::brickSize));
+      uint64_t brickSum{0};
+      uint64_t brickSquaredSum{0};
+      for (int32_t z = 0;z<sizeZ;++z) {
+        for (int32_t y = 0;y<sizeY;++y) {
+          const size_t row = BrickedVolume::storedIndex(0, y, z);
+          for (int32_t x = 0;x<sizeX;++x) {
+            const uint16_t v = voxel(brick, row + size_t(x), bytesPerVoxel);
+            minValue = std::min(minValue, v);
+            maxValue = std::max(maxValue, v);
+            brickSum += v;
+            brickSquaredSum += uint64_t(v)*v;
+            histogram[v >> binShift]++;
+          }
+        }
+      }
+      threadSum += double(brickSum);
+      threadSquaredSum += double(brickSquaredSum);
+      count += uint64_t(sizeX)*uint64_t(sizeY)*uint64_t(sizeZ);
+    }
+
+    #pragma omp critical
+    {
+      for (size_t b = 0;b<256;++b) stats.histogram[b] += histogram[b];
+      stats.minValue = std::min(stats.minValue, minValue);
+      stats.maxValue = std::max(stats.maxValue, maxValue);
+      sum += threadSum;
+      squaredSum += threadSquaredSum;
+      stats.voxelCount += count;
+    }
+  }
+
+  if (stats.voxelCount > 0) {
+    stats.mean = sum / double(stats.voxelCount);
+    stats.standardDeviation = std::sqrt(std::max(0.0, squaredSum / double(stats.voxelCount) - stats.mean*stats.mean));
+  }
+  return stats;
+}
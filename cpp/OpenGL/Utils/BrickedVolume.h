@@ -0,0 +1,163 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <memory>
+#include <fstream>
+#include <mutex>
+#include <unordered_map>
+#include <exception>
+#include <cstdint>
+
+#include "Vec3.h"
+#include "MappedFile.h"
+
+class BrickedVolumeException : public std::exception {
+  public:
+    BrickedVolumeException(const std::string& whatStr) : whatStr(whatStr) {}
+    virtual const char* what() const throw() {
+      return whatStr.c_str();
+    }
+  private:
+    std::string whatStr;
+};
+
+struct BrickInfo {
+  uint64_t offset;
+  uint16_t minValue;
+  uint16_t maxValue;
+};
+
+struct BrickLevel {
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+  uint32_t bricksX;
+  uint32_t bricksY;
+  uint32_t bricksZ;
+  std::vector<BrickInfo> bricks;
+
+  size_t brickIndex(uint32_t bx, uint32_t by, uint32_t bz) const {
+    return bx + size_t(bricksX)*(by + size_t(bricksY)*bz);
+  }
+};
+
+// Out-of-core volume file (.bvol). The voxels are split into bricks of
+// brickSize^3, every brick is stored together with its neighbourhood (one
+// voxel before and two after along every axis, enough for the cells of the
+// brick and their central difference gradients) and its min and max. Each
+// level of the pyramid halves the previous one until a single brick remains.
+//
+// The file is memory mapped, the OS pages bricks in when they are touched
+// and once more than the memory budget has been handed out the least
+// recently used bricks are dropped again. Pointers to dropped bricks stay
+// valid, their pages are simply read from the file again.
+class BrickedVolume {
+public:
+  static const uint32_t brickSize{64};
+  static const uint32_t ghostBefore{1};
+  static const uint32_t ghostAfter{2};
+  static const uint32_t storedSize{brickSize+ghostBefore+ghostAfter};
+
+  BrickedVolume(const std::string& filename, size_t memoryBudget=size_t(1) << 30);
+  BrickedVolume(const BrickedVolume&) = delete;
+  BrickedVolume& operator=(const BrickedVolume&) = delete;
+
+  uint32_t getWidth() const {return levels[0].width;}
+  uint32_t getHeight() const {return levels[0].height;}
+  uint32_t getDepth() const {return levels[0].depth;}
+  uint32_t getBytesPerVoxel() const {return bytesPerVoxel;}
+  // slice thickness as stored by the converter
+  Vec3 getScale() const {return scale;}
+  uint16_t getMaxValue() const {return bytesPerVoxel == 1 ? 255 : 65535;}
+
+  size_t getLevelCount() const {return levels.size();}
+  const BrickLevel& getLevel(size_t level) const {return levels[level];}
+
+  size_t getMemoryBudget() const {return memoryBudget;}
+  size_t getResidentBytes() const;
+  size_t getPeakResidentBytes() const;
+
+  // storedSize^3 voxels of getBytesPerVoxel() bytes each, see storedIndex
+  const uint8_t* getBrick(size_t level, uint32_t bx, uint32_t by, uint32_t bz) const;
+
+  // index of voxel (x,y,z) of a brick in its stored data, x, y and z range
+  // from -ghostBefore to brickSize+ghostAfter-1
+  static size_t storedIndex(int32_t x, int32_t y, int32_t z) {
+    return size_t(x+int32_t(ghostBefore)) +
+           storedSize*(size_t(y+int32_t(ghostBefore)) + storedSize*size_t(z+int32_t(ghostBefore)));
+  }
+
+  static size_t storedBytes(uint32_t bytesPerVoxel) {
+    return size_t(storedSize)*storedSize*storedSize*bytesPerVoxel;
+  }
+
+private:
+  std::vector<BrickLevel> levels;
+  uint32_t bytesPerVoxel;
+  Vec3 scale;
+  size_t memoryBudget;
+
+  MappedFile file;
+
+  // resident bricks, most recently used first
+  mutable std::mutex residentMutex;
+  mutable std::list<uint64_t> lru;
+  mutable std::unordered_map<uint64_t, std::list<uint64_t>::iterator> resident;
+  mutable size_t peakResident{0};
+
+  void parse();
+  void touch(size_t level, size_t index, const uint8_t* brick) const;
+  void release(const uint8_t* brick) const;
+};
+
+// Converts a volume given slice by slice into a .bvol file, only the
+// slices of the current layer of bricks of every level are kept in memory.
+class BrickedVolumeWriter {
+public:
+  BrickedVolumeWriter(const std::string& filename, uint32_t width, uint32_t height, uint32_t depth,
+                      uint32_t bytesPerVoxel, const Vec3& scale);
+  ~BrickedVolumeWriter();
+
+  // width*height voxels of bytesPerVoxel bytes, little endian, z increasing
+  void addSlice(const uint8_t* slice);
+  // writes the brick table, call after the last slice
+  void finish();
+
+private:
+  struct LevelWriter {
+    BrickLevel info;
+    std::deque<std::vector<uint8_t>> slices;
+    uint32_t firstSlice{0};
+    uint32_t receivedSlices{0};
+    uint32_t nextLayer{0};
+    std::vector<uint8_t> evenSlice;
+  };
+
+  std::ofstream file;
+  std::string filename;
+  uint32_t bytesPerVoxel;
+  Vec3 scale;
+  std::vector<LevelWriter> levels;
+  bool finished{false};
+
+  void addSlice(size_t level, std::vector<uint8_t> slice);
+  void writeLayer(LevelWriter& level, uint32_t bz);
+  std::vector<uint8_t> downsample(const LevelWriter& level, const std::vector<uint8_t>& a,
+                                  const std::vector<uint8_t>& b) const;
+};
+
+struct VolumeStatistics {
+  uint16_t minValue{0};
+  uint16_t maxValue{0};
+  double mean{0.0};
+  double standardDeviation{0.0};
+  uint64_t voxelCount{0};
+  // 256 bins over the value range of the volume
+  std::vector<uint64_t> histogram;
+};
+
+// visits the bricks of one level one by one
+VolumeStatistics computeStatistics(const BrickedVolume& volume, size_t level=0);
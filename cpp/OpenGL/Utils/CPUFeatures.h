@@ -0,0 +1,106 @@
+#pragma once
+
+// Runtime dispatch for the SIMD kernels in Utils and Network. The libraries
+// are built for the baseline instruction set, so kernels for newer
+// extensions are compiled between SIMD_TARGET_BEGIN_* and SIMD_TARGET_END
+// and only called if the CPU reports the extension:
+//
+//   SIMD_TARGET_BEGIN_AVX2
+//   static void kernelAVX2(...) {...}
+//   SIMD_TARGET_END
+//   ...
+//   if (CPUFeatures::hasAVX2()) kernelAVX2(...); else kernel(...);
+//
+// MSVC compiles intrinsics of every extension without flags, the regions
+// are empty there. On other architectures CPU_X86 is undefined and only
+// the portable code is built.
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_X86
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#if defined(__clang__)
+#define SIMD_TARGET_BEGIN_SSSE3 _Pragma("clang attribute push(__attribute__((target(\"ssse3\"))), apply_to=function)")
+#define SIMD_TARGET_BEGIN_AVX2 _Pragma("clang attribute push(__attribute__((target(\"avx2,fma\"))), apply_to=function)")
+#define SIMD_TARGET_BEGIN_SHA _Pragma("clang attribute push(__attribute__((target(\"sha,sse4.1\"))), apply_to=function)")
+#define SIMD_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define SIMD_TARGET_BEGIN_SSSE3 _Pragma("GCC push_options") _Pragma("GCC target(\"ssse3\")")
+#define SIMD_TARGET_BEGIN_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2,fma\")")
+#define SIMD_TARGET_BEGIN_SHA _Pragma("GCC push_options") _Pragma("GCC target(\"sha,sse4.1\")")
+#define SIMD_TARGET_END _Pragma("GCC pop_options")
+#else
+#define SIMD_TARGET_BEGIN_SSSE3
+#define SIMD_TARGET_BEGIN_AVX2
+#define SIMD_TARGET_BEGIN_SHA
+#define SIMD_TARGET_END
+#endif
+
+namespace CPUFeatures {
+  struct Features {
+    bool ssse3{false};
+    bool sse41{false};
+    bool avx2{false};
+    bool fma{false};
+    bool sha{false};
+  };
+
+  inline void cpuid(unsigned leaf, unsigned values[4]) {
+#ifdef _MSC_VER
+    int v[4];
+    __cpuidex(v, int(leaf), 0);
+    for (size_t i = 0;i<4;++i) values[i] = unsigned(v[i]);
+#else
+    values[0] = values[1] = values[2] = values[3] = 0;
+    __get_cpuid_count(leaf, 0, &values[0], &values[1], &values[2], &values[3]);
+#endif
+  }
+
+  inline Features detect() {
+    Features f;
+    unsigned leaf1[4], leaf7[4];
+    cpuid(0, leaf1);
+    const unsigned maxLeaf = leaf1[0];
+    cpuid(1, leaf1);
+    f.ssse3 = leaf1[2] & (1u << 9);
+    f.sse41 = leaf1[2] & (1u << 19);
+
+    // AVX registers need the support of the OS as well
+    bool osAVX = false;
+    if (leaf1[2] & (1u << 27)) {
+#ifdef _MSC_VER
+      osAVX = (_xgetbv(0) & 6) == 6;
+#else
+      unsigned eax, edx;
+      __asm__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      osAVX = (eax & 6) == 6;
+#endif
+    }
+    f.fma = osAVX && (leaf1[2] & (1u << 12));
+
+    if (maxLeaf >= 7) {
+      cpuid(7, leaf7);
+      f.avx2 = osAVX && (leaf7[1] & (1u << 5));
+      f.sha = leaf7[1] & (1u << 29);
+    }
+    return f;
+  }
+
+  inline const Features& features() {
+    static const Features f = detect();
+    return f;
+  }
+
+  inline bool hasSSSE3() {return features().ssse3;}
+  // the AVX2 regions are compiled with FMA enabled as well
+  inline bool hasAVX2() {return features().avx2 && features().fma;}
+  inline bool hasSHA() {return features().sha && features().sse41;}
+}
+
+#endif
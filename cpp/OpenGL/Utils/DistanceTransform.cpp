@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <cmath>
+#include <cstdint>
+
+#include "DistanceTransform.h"
+
+namespace {
+  const uint32_t noRow = std::numeric_limits<uint32_t>::max();
+  const size_t stripWidth = 256;
+
+  struct Field {
+    const std::vector<float>& data;
+    size_t width;
+    size_t height;
+    float threshold;
+
+    bool inside(size_t i) const {return data[i] >= threshold;}
+
+    bool isEdge(size_t x, size_t y) const {
+      const size_t i = x + y*width;
+      const bool in = inside(i);
+      return (x > 0 && inside(i-1) != in) || (x+1 < width && inside(i+1) != in) ||
+             (y > 0 && inside(i-width) != in) || (y+1 < height && inside(i+width) != in);
+    }
+
+    // distance from the center of an edge pixel to the line, interpolated
+    // towards the neighbours across it, a crossing along x and one along y
+    // give the distance to the line through both
+    float edgeOffset(size_t x, size_t y) const {
+      const size_t i = x + y*width;
+      const float v = data[i];
+      const bool in = inside(i);
+      const float none = std::numeric_limits<float>::max();
+      const auto crossing = [&](size_t n) {return (v - threshold) / (v - data[n]);};
+
+      float fx = none;
+      float fy = none;
+      if (x > 0 && inside(i-1) != in) fx = crossing(i-1);
+      if (x+1 < width && inside(i+1) != in) fx = std::min(fx, crossing(i+1));
+      if (y > 0 && inside(i-width) != in) fy = crossing(i-width);
+      if (y+1 < height && inside(i+width) != in) fy = std::min(fy, crossing(i+width));
+
+      if (fx == none) return fy;
+      if (fy == none) return fx;
+      const float length = std::sqrt(fx*fx + fy*fy);
+      return length > 0.0f ? fx*fy/length : 0.0f;
+    }
+
+    // the point on the line closest to the center of an edge pixel, in
+    // the direction of the gradient
+    void edgePoint(size_t x, size_t y, float& px, float& py) const {
+      const size_t i = x + y*width;
+      const float gx = (x+1 < width ? data[i+1] : data[i]) - (x > 0 ? data[i-1] : data[i]);
+      const float gy = (y+1 < height ? data[i+width] : data[i]) - (y > 0 ? data[i-width] : data[i]);
+      const float length = std::sqrt(gx*gx + gy*gy);
+      px = float(x);
+      py = float(y);
+      if (length == 0.0f) return;
+      // down the gradient from inside, up from outside
+      const float step = (inside(i) ? -1.0f : 1.0f) * edgeOffset(x, y) / length;
+      px += gx*step;
+      py += gy*step;
+    }
+  };
+
+  // splits [0,count) into one contiguous range per hardware thread, plain
+  // threads as Grid2D ends up in apps that do not link OpenMP
+  template <typename Body>
+  void parallelRanges(size_t count, Body body) {
+    const size_t threadCount = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count));
+    if (threadCount == 1) {
+      body(size_t(0), count);
+      return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0;t<threadCount;++t)
+      threads.emplace_back(body, count*t/threadCount, count*(t+1)/threadCount);
+    for (std::thread& thread : threads) thread.join();
+  }
+}
+
+std::vector<float> DistanceTransform::signedDistance(const std::vector<float>& data, size_t width,
+                                                     size_t height, float threshold) {
+  const Field field{data, width, height, threshold};
+  std::vector<float> result(width*height);
+
+  // the row of the nearest edge pixel in the same column, in strips of
+  // columns to sweep down and up a row at a time
+  std::vector<uint32_t> nearestRow(width*height);
+  parallelRanges(width, [&](size_t begin, size_t end) {
+    std::vector<uint32_t> last(stripWidth);
+    for (size_t stripBegin = begin;stripBegin<end;stripBegin += stripWidth) {
+      const size_t stripEnd = std::min(end, stripBegin+stripWidth);
+
+      std::fill(last.begin(), last.end(), noRow);
+      for (size_t y = 0;y<height;++y) {
+        for (size_t x = stripBegin;x<stripEnd;++x) {
+          if (field.isEdge(x,y)) last[x-stripBegin] = uint32_t(y);
+          nearestRow[x + y*width] = last[x-stripBegin];
+        }
+      }
+
+      std::fill(last.begin(), last.end(), noRow);
+      for (size_t y = height;y-- > 0;) {
+        for (size_t x = stripBegin;x<stripEnd;++x) {
+          const size_t i = x + y*width;
+          const uint32_t above = nearestRow[i];
+          uint32_t& below = last[x-stripBegin];
+          if (above == y) {
+            below = uint32_t(y);
+          } else if (below != noRow && (above == noRow || below - y < y - above)) {
+            nearestRow[i] = below;
+          }
+        }
+      }
+    }
+  });
+
+  // per row the lower envelope of the parabolas (x-q)^2 + f(q) over the
+  // columns q, f(q) the squared distance to the nearest edge pixel in
+  // column q, yields the column of the nearest edge pixel of each pixel
+  parallelRanges(height, [&](size_t begin, size_t end) {
+    std::vector<int64_t> f(width);
+    std::vector<uint32_t> v(width);
+    std::vector<double> z(width+1);
+    for (size_t y = begin;y<end;++y) {
+      const uint32_t* rows = nearestRow.data() + y*width;
+      float* out = result.data() + y*width;
+
+      int64_t k = -1;
+      for (size_t q = 0;q<width;++q) {
+        if (rows[q] == noRow) continue;
+        const int64_t dy = int64_t(rows[q]) - int64_t(y);
+        f[q] = dy*dy;
+        const int64_t fq = f[q] + int64_t(q*q);
+        double s = -std::numeric_limits<double>::infinity();
+        while (k >= 0) {
+          const int64_t p = v[size_t(k)];
+          s = double(fq - (f[size_t(p)] + p*p)) / double(2*(int64_t(q)-p));
+          if (s > z[size_t(k)]) break;
+          --k;
+        }
+        if (k < 0) s = -std::numeric_limits<double>::infinity();
+        ++k;
+        v[size_t(k)] = uint32_t(q);
+        z[size_t(k)] = s;
+        z[size_t(k)+1] = std::numeric_limits<double>::infinity();
+      }
+
+      if (k < 0) {
+        // no edge pixel anywhere
+        for (size_t x = 0;x<width;++x)
+          out[x] = field.inside(x + y*width) ? std::numeric_limits<float>::max()
+                                             : -std::numeric_limits<float>::max();
+        continue;
+      }
+
+      // runs of pixels share their nearest edge pixel
+      size_t j = 0;
+      size_t pointOf = noRow;
+      float px = 0.0f;
+      float py = 0.0f;
+      for (size_t x = 0;x<width;++x) {
+        while (z[j+1] < double(x)) ++j;
+        const size_t i = x + y*width;
+        const bool in = field.inside(i);
+
+        float d;
+        if (rows[x] == y) {
+          d = field.edgeOffset(x, y);
+        } else {
+          if (pointOf != j) {
+            field.edgePoint(v[j], rows[v[j]], px, py);
+            pointOf = j;
+          }
+          d = std::sqrt((x-px)*(x-px) + (y-py)*(y-py));
+        }
+        out[x] = in ? d : -d;
+      }
+    }
+  });
+
+  return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Signed Euclidean distance in pixels to the iso-line of a scalar field at
+// threshold, positive where the field reaches the threshold, negative
+// elsewhere. Pixels with a 4-neighbour on the other side of the line are
+// edge pixels, their distance to the line is interpolated linearly from
+// the values across it. Every other pixel finds its nearest edge pixel
+// with an exact separable transform after Felzenszwalb and Huttenlocher,
+// first along the columns, then along the rows, and adds or subtracts
+// that edge pixel's distance to the line. Without any edge pixel all
+// distances are +-std::numeric_limits<float>::max().
+namespace DistanceTransform {
+  std::vector<float> signedDistance(const std::vector<float>& data, size_t width, size_t height,
+                                    float threshold);
+}
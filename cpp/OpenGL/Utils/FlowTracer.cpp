@@ -0,0 +1,298 @@
+#include <array>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+#include "FlowTracer.h"
+
+// velocities below this length are treated as critical points
+static const float minSqSpeed = 1e-14f;
+
+class CellSampler {
+public:
+  CellSampler(const FlowTracer& tracer) :
+    tracer(tracer)
+  {}
+
+  Vec3 operator()(const Vec3& pos, float t) {
+    ++count;
+    const float fx = std::clamp(pos.x, 0.0f, 1.0f)*(tracer.sizeX-1);
+    const float fy = std::clamp(pos.y, 0.0f, 1.0f)*(tracer.sizeY-1);
+    const float fz = std::clamp(pos.z, 0.0f, 1.0f)*(tracer.sizeZ-1);
+    const size_t x0 = std::min(size_t(fx), tracer.sizeX-1);
+    const size_t y0 = std::min(size_t(fy), tracer.sizeY-1);
+    const size_t z0 = std::min(size_t(fz), tracer.sizeZ-1);
+
+    const size_t lastStep = tracer.timesteps.size()-1;
+    const float ft = lastStep > 0 ? std::clamp(t/tracer.timestepLength, 0.0f, float(lastStep)) : 0.0f;
+    const size_t t0 = std::min(size_t(ft), lastStep);
+
+    const size_t cell = x0+(y0+z0*tracer.sizeY)*tracer.sizeX;
+    if (cell != cachedCell || t0 != cachedStep) load(x0, y0, z0, t0);
+
+    const Vec3 alpha{fx-x0, fy-y0, fz-z0};
+    const Vec3 v = trilinear(corners[0], alpha);
+    const float at = ft-t0;
+    if (at <= 0.0f) return v;
+    return v*(1.0f-at) + trilinear(corners[1], alpha)*at;
+  }
+
+  size_t getCount() const {return count;}
+
+private:
+  const FlowTracer& tracer;
+  size_t cachedCell{std::numeric_limits<size_t>::max()};
+  size_t cachedStep{0};
+  std::array<std::array<Vec3, 8>, 2> corners;
+  size_t count{0};
+
+  void load(size_t x0, size_t y0, size_t z0, size_t t0) {
+    const size_t x1 = std::min(x0+1, tracer.sizeX-1);
+    const size_t y1 = std::min(y0+1, tracer.sizeY-1);
+    const size_t z1 = std::min(z0+1, tracer.sizeZ-1);
+    const size_t sliceSize = tracer.sizeX*tracer.sizeY;
+    const std::array<size_t, 8> index{
+      x0+y0*tracer.sizeX+z0*sliceSize, x1+y0*tracer.sizeX+z0*sliceSize,
+      x0+y1*tracer.sizeX+z0*sliceSize, x1+y1*tracer.sizeX+z0*sliceSize,
+      x0+y0*tracer.sizeX+z1*sliceSize, x1+y0*tracer.sizeX+z1*sliceSize,
+      x0+y1*tracer.sizeX+z1*sliceSize, x1+y1*tracer.sizeX+z1*sliceSize
+    };
+    const std::vector<Vec3>& data0 = tracer.timesteps[t0].getVectors();
+    for (size_t i = 0;i<8;++i) corners[0][i] = data0[index[i]];
+    if (t0+1 < tracer.timesteps.size()) {
+      const std::vector<Vec3>& data1 = tracer.timesteps[t0+1].getVectors();
+      for (size_t i = 0;i<8;++i) corners[1][i] = data1[index[i]];
+    }
+    cachedCell = x0+(y0+z0*tracer.sizeY)*tracer.sizeX;
+    cachedStep = t0;
+  }
+
+  static Vec3 trilinear(const std::array<Vec3, 8>& c, const Vec3& alpha) {
+    const Vec3 x00 = c[0] + (c[1]-c[0])*alpha.x;
+    const Vec3 x10 = c[2] + (c[3]-c[2])*alpha.x;
+    const Vec3 x01 = c[4] + (c[5]-c[4])*alpha.x;
+    const Vec3 x11 = c[6] + (c[7]-c[6])*alpha.x;
+    const Vec3 y0 = x00 + (x10-x00)*alpha.y;
+    const Vec3 y1 = x01 + (x11-x01)*alpha.y;
+    return y0 + (y1-y0)*alpha.z;
+  }
+};
+
+static bool inside(const Vec3& pos) {
+  return pos.x >= 0.0f && pos.x <= 1.0f &&
+         pos.y >= 0.0f && pos.y <= 1.0f &&
+         pos.z >= 0.0f && pos.z <= 1.0f;
+}
+
+// the point where the step from an inside position a to an outside
+// position b crosses the border of the cube
+static Vec3 clipToBorder(const Vec3& a, const Vec3& b) {
+  float alpha = 1.0f;
+  for (size_t i = 0;i<3;++i) {
+    if (b.e[i] < 0.0f) alpha = std::min(alpha, a.e[i]/(a.e[i]-b.e[i]));
+    if (b.e[i] > 1.0f) alpha = std::min(alpha, (1.0f-a.e[i])/(b.e[i]-a.e[i]));
+  }
+  return a + (b-a)*alpha;
+}
+
+FlowTracer::FlowTracer(const Flowfield& flow) :
+  FlowTracer(std::vector<Flowfield>{flow}, 1.0f)
+{
+}
+
+FlowTracer::FlowTracer(const std::vector<Flowfield>& timesteps, float timestepLength) :
+  timesteps(timesteps),
+  timestepLength(timestepLength)
+{
+  if (timesteps.empty()) throw std::runtime_error("FlowTracer needs at least one time step");
+  sizeX = timesteps[0].getSizeX();
+  sizeY = timesteps[0].getSizeY();
+  sizeZ = timesteps[0].getSizeZ();
+  for (const Flowfield& flow : timesteps) {
+    if (flow.getSizeX() != sizeX || flow.getSizeY() != sizeY || flow.getSizeZ() != sizeZ)
+      throw std::runtime_error("FlowTracer time steps differ in size");
+  }
+}
+
+Vec3 FlowTracer::velocity(const Vec3& pos, float t) const {
+  CellSampler sample{*this};
+  return sample(pos, t);
+}
+
+// zero steps never reach the end of a line and the bisection at the border
+// needs a positive minStepSize, so these would loop forever; checked
+// before the parallel loops, which must not throw
+static void checkParameters(const TraceParameters& p) {
+  if (!(p.minStepSize > 0.0f) || !(p.minStepSize <= p.maxStepSize))
+    throw std::runtime_error("FlowTracer needs 0 < minStepSize <= maxStepSize");
+  if (p.integrator != Integrator::RK45 && !(p.stepSize > 0.0f))
+    throw std::runtime_error("FlowTracer needs a positive stepSize for EULER and RK4");
+}
+
+// Integrates from pos at time t, calls emit for the seed and every
+// following point and returns the number of field lookups.
+template <typename Emit>
+size_t FlowTracer::trace(Vec3 pos, float t, const TraceParameters& p, Emit emit) const {
+  CellSampler sample{*this};
+  emit(pos);
+  if (!inside(pos)) return 0;
+
+  // backward lines integrate the negated field backward in time, so the
+  // integrators only ever see positive steps
+  const float direction = p.backward ? -1.0f : 1.0f;
+  auto f = [&](const Vec3& y, float tau) {return sample(y, t+direction*tau)*direction;};
+
+  // one step of length h from pos at tau, RK45 also yields its error
+  // estimate and the field at the new position, the first stage of the
+  // next step
+  auto step = [&](const Vec3& pos, const Vec3& k1, float tau, float h, Vec3& k7, float& error) -> Vec3 {
+    switch (p.integrator) {
+      case Integrator::EULER :
+        return pos + k1*h;
+      case Integrator::RK4 : {
+          const Vec3 k2 = f(pos + k1*(h/2.0f), tau+h/2.0f);
+          const Vec3 k3 = f(pos + k2*(h/2.0f), tau+h/2.0f);
+          const Vec3 k4 = f(pos + k3*h, tau+h);
+          return pos + (k1 + k2*2.0f + k3*2.0f + k4)*(h/6.0f);
+        }
+      case Integrator::RK45 : {
+          // Dormand-Prince 5(4)
+          const Vec3 k2 = f(pos + k1*(h/5.0f), tau+h/5.0f);
+          const Vec3 k3 = f(pos + (k1*(3.0f/40.0f) + k2*(9.0f/40.0f))*h, tau+h*3.0f/10.0f);
+          const Vec3 k4 = f(pos + (k1*(44.0f/45.0f) - k2*(56.0f/15.0f) + k3*(32.0f/9.0f))*h,
+                            tau+h*4.0f/5.0f);
+          const Vec3 k5 = f(pos + (k1*(19372.0f/6561.0f) - k2*(25360.0f/2187.0f) +
+                                   k3*(64448.0f/6561.0f) - k4*(212.0f/729.0f))*h, tau+h*8.0f/9.0f);
+          const Vec3 k6 = f(pos + (k1*(9017.0f/3168.0f) - k2*(355.0f/33.0f) + k3*(46732.0f/5247.0f) +
+                                   k4*(49.0f/176.0f) - k5*(5103.0f/18656.0f))*h, tau+h);
+          const Vec3 next = pos + (k1*(35.0f/384.0f) + k3*(500.0f/1113.0f) + k4*(125.0f/192.0f) -
+                                   k5*(2187.0f/6784.0f) + k6*(11.0f/84.0f))*h;
+          k7 = f(next, tau+h);
+          const Vec3 e = (k1*(71.0f/57600.0f) - k3*(71.0f/16695.0f) + k4*(71.0f/1920.0f) -
+                          k5*(17253.0f/339200.0f) + k6*(22.0f/525.0f) - k7*(1.0f/40.0f))*h;
+          error = std::max({std::abs(e.x), std::abs(e.y), std::abs(e.z)});
+          return next;
+        }
+    }
+    return pos;
+  };
+
+  const bool adaptive = p.integrator == Integrator::RK45;
+  size_t points = 1;
+  float tau = 0.0f;
+  float h = adaptive ? std::clamp(p.stepSize, p.minStepSize, p.maxStepSize) : p.stepSize;
+  Vec3 k1 = f(pos, tau);
+  while (points < p.maxPoints && tau < p.duration && k1.sqlength() > minSqSpeed) {
+    h = std::min(h, p.duration-tau);
+
+    Vec3 k7;
+    float error = 0.0f;
+    Vec3 next = step(pos, k1, tau, h, k7, error);
+    float nextH = p.stepSize;
+    if (adaptive) {
+      while (true) {
+        const float scale = error > 0.0f ? 0.9f*std::pow(p.tolerance/error, 0.2f) : 5.0f;
+        nextH = std::clamp(h*std::clamp(scale, 0.2f, 5.0f), p.minStepSize, p.maxStepSize);
+        if (error <= p.tolerance || h <= p.minStepSize) break;
+        h = nextH;
+        next = step(pos, k1, tau, h, k7, error);
+      }
+    }
+
+    if (!inside(next)) {
+      // bisect the step length for the crossing, the chord of a long step
+      // would cut the curve short
+      float inStep = 0.0f;
+      float outStep = h;
+      Vec3 in = pos;
+      Vec3 out = next;
+      while (outStep-inStep > p.minStepSize) {
+        const float mid = (inStep+outStep)/2.0f;
+        const Vec3 m = step(pos, k1, tau, mid, k7, error);
+        if (inside(m)) {
+          inStep = mid;
+          in = m;
+        } else {
+          outStep = mid;
+          out = m;
+        }
+      }
+      emit(clipToBorder(in, out));
+      break;
+    }
+
+    tau += h;
+    pos = next;
+    emit(pos);
+    ++points;
+    k1 = adaptive ? k7 : f(pos, tau);
+    h = nextH;
+  }
+  return sample.getCount();
+}
+
+std::vector<Vec3> FlowTracer::streamline(const Vec3& seed, const TraceParameters& p) const {
+  return pathline(seed, 0.0f, p);
+}
+
+std::vector<Vec3> FlowTracer::pathline(const Vec3& seed, float startTime, const TraceParameters& p) const {
+  checkParameters(p);
+  std::vector<Vec3> line;
+  trace(seed, startTime, p, [&line](const Vec3& pos) {line.push_back(pos);});
+  return line;
+}
+
+std::vector<std::vector<Vec3>> FlowTracer::streamlines(const std::vector<Vec3>& seeds,
+                                                       const TraceParameters& p) const {
+  return pathlines(seeds, 0.0f, p);
+}
+
+std::vector<std::vector<Vec3>> FlowTracer::pathlines(const std::vector<Vec3>& seeds, float startTime,
+                                                     const TraceParameters& p) const {
+  checkParameters(p);
+  std::vector<std::vector<Vec3>> lines(seeds.size());
+  size_t samples = 0;
+#pragma omp parallel for schedule(dynamic, 16) reduction(+:samples)
+  for (int64_t i = 0;i<int64_t(seeds.size());++i) {
+    std::vector<Vec3>& line = lines[size_t(i)];
+    samples += trace(seeds[size_t(i)], startTime, p, [&line](const Vec3& pos) {line.push_back(pos);});
+  }
+  sampleCount = samples;
+  return lines;
+}
+
+void FlowTracer::advect(std::vector<Vec3>& positions, float t, float deltaT, const TraceParameters& p) const {
+  checkParameters(p);
+  TraceParameters stepParameters = p;
+  stepParameters.duration = std::abs(deltaT);
+  stepParameters.backward = deltaT < 0.0f;
+  stepParameters.maxPoints = std::numeric_limits<size_t>::max();
+
+  size_t samples = 0;
+#pragma omp parallel for schedule(dynamic, 256) reduction(+:samples)
+  for (int64_t i = 0;i<int64_t(positions.size());++i) {
+    Vec3& pos = positions[size_t(i)];
+    samples += trace(pos, t, stepParameters, [&pos](const Vec3& next) {pos = next;});
+  }
+  sampleCount = samples;
+}
+
+std::vector<Vec3> FlowTracer::seedGrid(size_t countX, size_t countY, size_t countZ) {
+  std::vector<Vec3> seeds;
+  seeds.reserve(countX*countY*countZ);
+  for (size_t z = 0;z<countZ;++z) {
+    for (size_t y = 0;y<countY;++y) {
+      for (size_t x = 0;x<countX;++x) {
+        seeds.push_back(Vec3{(x+0.5f)/countX, (y+0.5f)/countY, (z+0.5f)/countZ});
+      }
+    }
+  }
+  return seeds;
+}
+
+std::vector<Vec3> FlowTracer::seedRandom(size_t count) {
+  std::vector<Vec3> seeds(count);
+  for (Vec3& seed : seeds) seed = Vec3::random();
+  return seeds;
+}
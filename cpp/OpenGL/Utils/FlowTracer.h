@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include "Vec3.h"
+#include "Flowfield.h"
+
+enum class Integrator {
+  EULER,
+  RK4,
+  RK45
+};
+
+struct TraceParameters {
+  Integrator integrator{Integrator::RK45};
+  // the fixed step of EULER and RK4, the first step of RK45
+  float stepSize{0.01f};
+  // largest position error RK45 accepts per step
+  float tolerance{1e-5f};
+  float minStepSize{1e-6f};
+  float maxStepSize{0.1f};
+  // integration time, lines also end at the border, at critical points
+  // and after maxPoints points
+  float duration{1.0f};
+  size_t maxPoints{1000};
+  bool backward{false};
+};
+
+// Integral curves through one Flowfield or a sequence of Flowfields, one
+// per time step, over the unit cube. Between time steps the field is
+// interpolated linearly. A line stores the seed followed by one point per
+// step, a line leaving the cube ends on its border.
+//
+// Lookups go through a sampler per line that keeps the corner vectors of
+// the last cell, since successive steps and the stages within a step
+// rarely leave it. Batches of seeds are traced in parallel.
+class FlowTracer {
+public:
+  FlowTracer(const Flowfield& flow);
+  FlowTracer(const std::vector<Flowfield>& timesteps, float timestepLength);
+
+  Vec3 velocity(const Vec3& pos, float t=0.0f) const;
+
+  std::vector<Vec3> streamline(const Vec3& seed, const TraceParameters& p) const;
+  std::vector<Vec3> pathline(const Vec3& seed, float startTime, const TraceParameters& p) const;
+  std::vector<std::vector<Vec3>> streamlines(const std::vector<Vec3>& seeds, const TraceParameters& p) const;
+  std::vector<std::vector<Vec3>> pathlines(const std::vector<Vec3>& seeds, float startTime,
+                                           const TraceParameters& p) const;
+
+  // moves particles from time t to t+deltaT, particles leaving the cube
+  // stop on its border
+  void advect(std::vector<Vec3>& positions, float t, float deltaT, const TraceParameters& p) const;
+
+  // number of field lookups of the last batch call, to compare integrators
+  size_t getSampleCount() const {return sampleCount;}
+
+  static std::vector<Vec3> seedGrid(size_t countX, size_t countY, size_t countZ);
+  static std::vector<Vec3> seedRandom(size_t count);
+
+private:
+  std::vector<Flowfield> timesteps;
+  float timestepLength;
+  size_t sizeX;
+  size_t sizeY;
+  size_t sizeZ;
+  mutable size_t sampleCount{0};
+
+  friend class CellSampler;
+
+  template <typename Emit>
+  size_t trace(Vec3 pos, float t, const TraceParameters& p, Emit emit) const;
+};
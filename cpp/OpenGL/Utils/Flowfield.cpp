@@ -1,4 +1,5 @@
 #include <cmath>
+#include <array>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -123,15 +124,28 @@ sizeZ(sizeZ)
   data.resize(sizeX*sizeY*sizeZ);
 }
 
-Vec3 Flowfield::getData(size_t x, size_t y, size_t z) {
-  return data[x+y*sizeY+z*sizeX*sizeY];
+Flowfield::Flowfield(size_t sizeX, size_t sizeY, size_t sizeZ, const std::vector<Vec3>& data) :
+sizeX(sizeX),
+sizeY(sizeY),
+sizeZ(sizeZ),
+data(data)
+{
+  if (data.size() != sizeX*sizeY*sizeZ) {
+    std::stringstream s;
+    s << "Expected " << sizeX*sizeY*sizeZ << " vectors but got " << data.size();
+    throw std::runtime_error(s.str());
+  }
+}
+
+Vec3 Flowfield::getData(size_t x, size_t y, size_t z) const {
+  return data[x+y*sizeX+z*sizeX*sizeY];
 }
 
 Vec3 Flowfield::linear(const Vec3& a, const Vec3& b, float alpha) {
   return a * (1.0f - alpha) + b * alpha;
 }
 
-Vec3 Flowfield::interpolate(const Vec3& pos) {
+Vec3 Flowfield::interpolate(const Vec3& pos) const {
   const size_t fX = size_t(floor(pos.x * (sizeX-1)));
   const size_t fY = size_t(floor(pos.y * (sizeY-1)));
   const size_t fZ = size_t(floor(pos.z * (sizeZ-1)));
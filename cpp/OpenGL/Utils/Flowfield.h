@@ -4,7 +4,7 @@
 #include <vector>
 #include <stdexcept>
 
-#include <Vec3.h>
+#include "Vec3.h"
 
 enum class DemoType {
   DRAIN,
@@ -15,11 +15,13 @@ enum class DemoType {
 class Flowfield {
 public:
   Flowfield(size_t sizeX, size_t sizeY, size_t sizeZ);
-  Vec3 interpolate(const Vec3& pos);
+  Flowfield(size_t sizeX, size_t sizeY, size_t sizeZ, const std::vector<Vec3>& data);
+  Vec3 interpolate(const Vec3& pos) const;
 
   size_t getSizeX() const {return sizeX;}
   size_t getSizeY() const {return sizeY;}
   size_t getSizeZ() const {return sizeZ;}
+  const std::vector<Vec3>& getVectors() const {return data;}
 
   static Flowfield genDemo(size_t size, DemoType d);
   static Flowfield fromFile(const std::string& filename);
@@ -28,7 +30,7 @@ private:
   size_t sizeY;
   size_t sizeZ;
   std::vector<Vec3> data;
-  Vec3 getData(size_t x, size_t y, size_t z);
-  
-  Vec3 linear(const Vec3& a, const Vec3& b, float alpha);
+  Vec3 getData(size_t x, size_t y, size_t z) const;
+
+  static Vec3 linear(const Vec3& a, const Vec3& b, float alpha);
 };
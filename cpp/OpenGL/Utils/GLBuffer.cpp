@@ -8,8 +8,10 @@ GLBuffer::GLBuffer(GLenum target) :
 	target(target),
 	bufferID(0),
 	elemSize(0),
+	size(0),
 	stride(0),
-	type(0)
+	type(0),
+	mapped(false)
 {
 	GL(glGenBuffers(1, &bufferID));
 }
@@ -25,6 +27,7 @@ void GLBuffer::setData(const std::vector<float>& data, size_t valuesPerElement,
 	type = GL_FLOAT;
 	GL(glBindBuffer(target, bufferID));
 	GL(glBufferData(target, elemSize*data.size(), data.data(), usage));
+	size = elemSize*data.size();
 }
 
 void GLBuffer::setData(const std::vector<GLuint>& data) {
@@ -33,6 +36,34 @@ void GLBuffer::setData(const std::vector<GLuint>& data) {
 	type = GL_UNSIGNED_INT;
 	GL(glBindBuffer(target, bufferID));
 	GL(glBufferData(target, elemSize*data.size(), data.data(), GL_STATIC_DRAW));
+	size = elemSize*data.size();
+}
+
+GLfloat* GLBuffer::map(size_t count, size_t valuesPerElement) {
+	elemSize = sizeof(GLfloat);
+	stride = valuesPerElement*elemSize;
+	type = GL_FLOAT;
+	// an empty range is GL_INVALID_VALUE for glMapBufferRange
+	if (count == 0) return nullptr;
+
+	GL(glBindBuffer(target, bufferID));
+	if (count*elemSize > size) {
+		size = count*elemSize;
+		GL(glBufferData(target, size, nullptr, GL_DYNAMIC_DRAW));
+	}
+	// invalidating lets the driver hand out fresh memory instead of waiting
+	// for draws still reading the previous contents
+	void* data{nullptr};
+	GL(data = glMapBufferRange(target, 0, count*elemSize, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	mapped = true;
+	return static_cast<GLfloat*>(data);
+}
+
+void GLBuffer::unmap() {
+	if (!mapped) return;
+	mapped = false;
+	GL(glBindBuffer(target, bufferID));
+	GL(glUnmapBuffer(target));
 }
 
 void GLBuffer::connectVertexAttrib(GLint location, size_t elemCount,
@@ -11,6 +11,11 @@ public:
 	~GLBuffer();
 	void setData(const std::vector<GLfloat>& data, size_t valuesPerElement,GLenum usage=GL_STATIC_DRAW);
 	void setData(const std::vector<GLuint>& data);
+	// maps count floats of the buffer for writing, the storage is only
+	// reallocated if it has to grow, call unmap before drawing; returns
+	// nullptr and maps nothing if count is zero
+	GLfloat* map(size_t count, size_t valuesPerElement);
+	void unmap();
 	void connectVertexAttrib(GLint location, size_t elemCount,
                            size_t offset=0, GLuint divisor = 0) const;
 	void bind() const;
@@ -19,6 +24,8 @@ private:
 	GLenum target;
 	GLuint bufferID;
 	size_t elemSize;
+	size_t size;
 	size_t stride;
 	GLenum type;
+	bool mapped;
 };
@@ -5,6 +5,7 @@
 #include "Rand.h"
 #include "Vec2.h"
 #include "bmp.h"
+#include "DistanceTransform.h"
 
 #include "Grid2D.h"
 
@@ -463,94 +464,8 @@ void Grid2D::save(std::ostream &os) const {
   os.write((char*)data.data(), sizeof(float) * width * height);
 }
 
-static const float d1{1.0f};
-static const float d2{1.4142135624f};
-
-static const float INV = std::numeric_limits<float>::max();
-static const Vec2ui NO_POS{std::numeric_limits<uint32_t>::max(),
-                    std::numeric_limits<uint32_t>::max()};
-static float dist(size_t x, size_t y, const Vec2ui& p) {
-  return sqrtf( (x-float(p.x))*(x-float(p.x)) +
-                (y-float(p.y))*(y-float(p.y)));
-}
-
 Grid2D Grid2D::toSignedDistance(float threshold) const {
-  Grid2D r(width, height);
-  
-  std::vector<bool> I(width*height);
-  std::vector<Vec2ui> p(width*height);
-  
-  for (size_t i = 0;i<I.size();++i) {
-    I[i] = data[i] >= threshold;
-  }
-
-  for (size_t i = 0;i<I.size();++i) {
-    r.data[i] = INV;
-    p[i] = NO_POS;
-  }
-  
-  for (size_t y = 1; y<height-1; y++ ) {
-    for (size_t x = 1; x<width-1; x++ ) {
-      const size_t i = index(x,y);
-      if (I[index(x-1,y)] != I[i] ||
-          I[index(x+1,y)] != I[i] ||
-          I[index(x,y+1)] != I[i] ||
-          I[index(x,y-1)] != I[i]) {
-        r.data[i] = 0;
-        p[i] = Vec2ui(uint32_t(x),uint32_t(y));
-      }
-    }
-  }
- 
-  for (size_t y = 1; y<height-1; y++ ) {
-    for (size_t x = 1; x<width-1; x++ ) {
-      const size_t i = index(x,y);
-      if (r.data[index(x-1,y-1)]+d2 < r.data[i]) {
-        p[i] = p[index(x-1,y-1)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-      if (r.data[index(x,y-1)]+d1 < r.data[i]) {
-        p[i] = p[index(x,y-1)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-      if (r.data[index(x+1,y-1)]+d2 < r.data[i]) {
-        p[i] = p[index(x+1,y-1)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-      if (r.data[index(x-1,y)]+d1 < r.data[i]) {
-        p[i] = p[index(x-1,y)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-    }
-  }
-  
-  for (size_t y = height-2; y>=1; y-- ) {
-    for (size_t x = width-2; x>=1; x--) {
-      const size_t i = index(x,y);
-      if (r.data[index(x+1,y)]+d1 < r.data[i]) {
-        p[i] = p[index(x+1,y)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-      if (r.data[index(x-1,y+1)]+d2 < r.data[i]) {
-        p[i] = p[index(x-1,y+1)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-      if (r.data[index(x,y+1)]+d1 < r.data[i]) {
-        p[i] = p[index(x,y+1)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-      if (r.data[index(x+1,y+1)]+d2 < r.data[i]) {
-        p[i] = p[index(x+1,y+1)];
-        r.data[i] = dist(x, y, p[i]);
-      }
-    }
-  }
-  
-  for (size_t i = 0;i<I.size();++i) {
-    if (!I[i]) r.data[i] = -r.data[i];
-  }
-  
-  return r;
+  return Grid2D(width, height, DistanceTransform::signedDistance(data, width, height, threshold));
 }
 
 GLTexture2D Grid2D::toTexture() const {
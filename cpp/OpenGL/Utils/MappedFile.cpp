@@ -0,0 +1,65 @@
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string& filename) {
+#ifdef _WIN32
+  HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file == INVALID_HANDLE_VALUE) throw MappedFileException{std::string("Unable to open ")+filename};
+  LARGE_INTEGER size;
+  GetFileSizeEx(file, &size);
+  fileHandle = file;
+  mappingSize = size_t(size.QuadPart);
+  if (mappingSize == 0) return;
+  HANDLE mappingObject = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (mappingObject == NULL) {
+    CloseHandle(file);
+    throw MappedFileException{std::string("Unable to map ")+filename};
+  }
+  mapping = static_cast<const uint8_t*>(MapViewOfFile(mappingObject, FILE_MAP_READ, 0, 0, 0));
+  if (mapping == nullptr) {
+    CloseHandle(mappingObject);
+    CloseHandle(file);
+    throw MappedFileException{std::string("Unable to map ")+filename};
+  }
+  mappingHandle = mappingObject;
+#else
+  fileDescriptor = open(filename.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) throw MappedFileException{std::string("Unable to open ")+filename};
+  struct stat info;
+  if (fstat(fileDescriptor, &info) != 0) {
+    close(fileDescriptor);
+    throw MappedFileException{std::string("Unable to read ")+filename};
+  }
+  mappingSize = size_t(info.st_size);
+  if (mappingSize == 0) return;
+  void* m = mmap(nullptr, mappingSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+  if (m == MAP_FAILED) {
+    close(fileDescriptor);
+    throw MappedFileException{std::string("Unable to map ")+filename};
+  }
+  mapping = static_cast<const uint8_t*>(m);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+  if (mapping != nullptr) {
+    UnmapViewOfFile(mapping);
+    CloseHandle(mappingHandle);
+  }
+  CloseHandle(fileHandle);
+#else
+  if (mapping != nullptr) munmap(const_cast<uint8_t*>(mapping), mappingSize);
+  close(fileDescriptor);
+#endif
+}
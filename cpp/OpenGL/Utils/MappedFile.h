@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <exception>
+#include <cstdint>
+#include <cstddef>
+
+class MappedFileException : public std::exception {
+  public:
+    MappedFileException(const std::string& whatStr) : whatStr(whatStr) {}
+    virtual const char* what() const throw() {
+      return whatStr.c_str();
+    }
+  private:
+    std::string whatStr;
+};
+
+// Read only memory mapping of a whole file, pages are read from the file
+// when they are first touched. An empty file maps to no data at all.
+class MappedFile {
+public:
+  MappedFile(const std::string& filename);
+  ~MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* data() const {return mapping;}
+  size_t size() const {return mappingSize;}
+
+private:
+  const uint8_t* mapping{nullptr};
+  size_t mappingSize{0};
+#ifdef _WIN32
+  void* fileHandle{nullptr};
+  void* mappingHandle{nullptr};
+#else
+  int fileDescriptor{-1};
+#endif
+};
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include "MeshOptimizer.h"
+
+static const uint32_t unused{std::numeric_limits<uint32_t>::max()};
+
+std::vector<uint32_t> MeshOptimizer::tipsify(const std::vector<uint32_t>& indices,
+                                             size_t vertexCount, size_t cacheSize) {
+  const size_t triangleCount = indices.size()/3;
+
+  // the triangles of every vertex, offsets[v] to offsets[v+1] in adjacency
+  std::vector<size_t> offsets(vertexCount+1, 0);
+  for (size_t i = 0;i<triangleCount*3;++i) ++offsets[indices[i]+1];
+  for (size_t v = 0;v<vertexCount;++v) offsets[v+1] += offsets[v];
+  std::vector<uint32_t> adjacency(offsets[vertexCount]);
+  std::vector<size_t> fill(offsets.begin(), offsets.end()-1);
+  for (size_t i = 0;i<triangleCount*3;++i) adjacency[fill[indices[i]]++] = uint32_t(i/3);
+
+  // the number of triangles of a vertex not emitted yet
+  std::vector<uint32_t> live(vertexCount);
+  for (size_t v = 0;v<vertexCount;++v) live[v] = uint32_t(offsets[v+1]-offsets[v]);
+
+  // a vertex is in the cache while time-cacheTime is at most cacheSize
+  std::vector<size_t> cacheTime(vertexCount, 0);
+  size_t time = cacheSize+1;
+
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<uint32_t> deadEnds;
+  std::vector<uint32_t> candidates;
+  std::vector<uint32_t> result;
+  result.reserve(triangleCount*3);
+  size_t cursor = 0;
+
+  // the next vertex with triangles left once the neighborhood is used up,
+  // the most recently used one first, then in input order
+  const auto skipDeadEnd = [&]() -> int64_t {
+    while (!deadEnds.empty()) {
+      const uint32_t v = deadEnds.back();
+      deadEnds.pop_back();
+      if (live[v] > 0) return v;
+    }
+    for (;cursor<vertexCount;++cursor)
+      if (live[cursor] > 0) return int64_t(cursor);
+    return -1;
+  };
+
+  int64_t fanning = skipDeadEnd();
+  while (fanning >= 0) {
+    // emit all remaining triangles around the fanning vertex
+    candidates.clear();
+    for (size_t a = offsets[size_t(fanning)];a<offsets[size_t(fanning)+1];++a) {
+      const uint32_t t = adjacency[a];
+      if (emitted[t]) continue;
+      for (size_t c = 0;c<3;++c) {
+        const uint32_t v = indices[t*3+c];
+        result.push_back(v);
+        deadEnds.push_back(v);
+        candidates.push_back(v);
+        --live[v];
+        if (time-cacheTime[v] > cacheSize) cacheTime[v] = time++;
+      }
+      emitted[t] = true;
+    }
+
+    // continue with the oldest candidate that stays in the cache while
+    // its own triangles are emitted, else with the youngest one
+    fanning = -1;
+    int64_t bestPriority = -1;
+    for (const uint32_t v : candidates) {
+      if (live[v] == 0) continue;
+      int64_t priority = 0;
+      if (time-cacheTime[v]+2*size_t(live[v]) <= cacheSize) priority = int64_t(time-cacheTime[v]);
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        fanning = v;
+      }
+    }
+    if (fanning < 0) fanning = skipDeadEnd();
+  }
+  return result;
+}
+
+std::vector<uint32_t> MeshOptimizer::fetchOrder(const std::vector<uint32_t>& indices,
+                                                size_t vertexCount) {
+  std::vector<uint32_t> remap(vertexCount, unused);
+  uint32_t next = 0;
+  for (const uint32_t v : indices)
+    if (remap[v] == unused) remap[v] = next++;
+  for (uint32_t& r : remap)
+    if (r == unused) r = next++;
+  return remap;
+}
+
+float MeshOptimizer::averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t cacheSize) {
+  const size_t triangleCount = indices.size()/3;
+  if (triangleCount == 0) return 0.0f;
+
+  const size_t vertexCount = size_t(*std::max_element(indices.begin(), indices.end()))+1;
+  // every miss advances time, a vertex is in the cache while it was among
+  // the last cacheSize misses, hits do not change the FIFO order
+  std::vector<size_t> cacheTime(vertexCount, 0);
+  size_t time = cacheSize;
+  for (size_t i = 0;i<triangleCount*3;++i) {
+    const uint32_t v = indices[i];
+    if (time-cacheTime[v] >= cacheSize) cacheTime[v] = time++;
+  }
+  return float(time-cacheSize)/float(triangleCount);
+}
+
+MeshOptimizer::Meshlets MeshOptimizer::buildMeshlets(const std::vector<uint32_t>& indices,
+                                                     const std::vector<float>& positions,
+                                                     size_t maxVertices, size_t maxTriangles) {
+  maxVertices = std::clamp<size_t>(maxVertices, 3, 256);
+  maxTriangles = std::max<size_t>(maxTriangles, 1);
+
+  Meshlets result;
+  // the meshlet vertex of every mesh vertex in the current meshlet
+  std::vector<uint32_t> local(positions.size()/3, unused);
+  Meshlet current{0, 0, 0, 0, {}, 0.0f};
+
+  const auto finish = [&]() {
+    if (current.triangleCount == 0) return;
+    const uint32_t* first = result.vertices.data()+current.vertexOffset;
+    Vec3 minV{positions[first[0]*3], positions[first[0]*3+1], positions[first[0]*3+2]};
+    Vec3 maxV{minV};
+    for (uint32_t i = 0;i<current.vertexCount;++i) {
+      const Vec3 p{positions[first[i]*3], positions[first[i]*3+1], positions[first[i]*3+2]};
+      minV = Vec3::minV(minV, p);
+      maxV = Vec3::maxV(maxV, p);
+      local[first[i]] = unused;
+    }
+    current.center = (minV+maxV)/2.0f;
+    for (uint32_t i = 0;i<current.vertexCount;++i) {
+      const Vec3 p{positions[first[i]*3], positions[first[i]*3+1], positions[first[i]*3+2]};
+      current.radius = std::max(current.radius, (p-current.center).length());
+    }
+    result.meshlets.push_back(current);
+    current = Meshlet{uint32_t(result.vertices.size()), 0, uint32_t(result.triangles.size()/3), 0, {}, 0.0f};
+  };
+
+  for (size_t t = 0;t<indices.size()/3;++t) {
+    const uint32_t a = indices[t*3+0];
+    const uint32_t b = indices[t*3+1];
+    const uint32_t c = indices[t*3+2];
+    const size_t added = (local[a] == unused) + (local[b] == unused && b != a) +
+                         (local[c] == unused && c != a && c != b);
+    if (current.vertexCount+added > maxVertices || current.triangleCount+1 > maxTriangles) finish();
+
+    for (const uint32_t v : {a, b, c}) {
+      if (local[v] == unused) {
+        local[v] = current.vertexCount++;
+        result.vertices.push_back(v);
+      }
+      result.triangles.push_back(uint8_t(local[v]));
+    }
+    ++current.triangleCount;
+  }
+  finish();
+  return result;
+}
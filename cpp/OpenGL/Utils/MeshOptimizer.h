@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Vec3.h"
+
+// Reordering and clustering of indexed triangle lists, as Tesselation and
+// OBJFile produce them, for the post transform vertex cache of the GPU
+// and for per cluster culling.
+namespace MeshOptimizer {
+  // A triangle order with few vertex cache misses, the Tipsify algorithm
+  // of Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex
+  // Locality and Reduced Overdraw". Runs in linear time, cacheSize is the
+  // number of vertices the cache is assumed to hold.
+  std::vector<uint32_t> tipsify(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                size_t cacheSize=16);
+
+  // remap[v] is the new position of vertex v when the vertices are stored
+  // in the order of their first use by indices, unused vertices go last
+  std::vector<uint32_t> fetchOrder(const std::vector<uint32_t>& indices, size_t vertexCount);
+
+  // Vertex cache misses per triangle of a FIFO cache with cacheSize
+  // entries, the ACMR. Between 3 for a triangle soup and about 0.5 for a
+  // large regular mesh in the best order.
+  float averageCacheMissRatio(const std::vector<uint32_t>& indices, size_t cacheSize=16);
+
+  struct Meshlet {
+    uint32_t vertexOffset;
+    uint32_t vertexCount;
+    uint32_t triangleOffset;
+    uint32_t triangleCount;
+    // bounding sphere of the vertices
+    Vec3 center;
+    float radius;
+  };
+
+  struct Meshlets {
+    std::vector<Meshlet> meshlets;
+    // the mesh vertex of every meshlet vertex, starting at vertexOffset
+    std::vector<uint32_t> vertices;
+    // three meshlet vertices per triangle, starting at 3*triangleOffset
+    std::vector<uint8_t> triangles;
+  };
+
+  // Splits the triangles in their order into clusters of at most
+  // maxVertices (up to 256) vertices and maxTriangles triangles, the
+  // defaults suit mesh shaders. Reorder with tipsify first to get fewer,
+  // fuller meshlets. positions holds three floats per vertex.
+  Meshlets buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<float>& positions,
+                         size_t maxVertices=64, size_t maxTriangles=124);
+}
@@ -23,26 +23,13 @@ public:
             bool useTexCoords=false,
             bool useTangents=false) {
 
-    glPosBuffer = std::make_shared<GLBuffer>(GL_ARRAY_BUFFER);
+    // one interleaved buffer, the flags only decide what connect uses
+    this->useNormals = useNormals;
+    this->useTexCoords = useTexCoords;
+    this->useTangents = useTangents;
 
     glArray.bind();
-    glPosBuffer->setData(tesselation.getVertices(), 3);
-
-    if (useNormals) {
-      glNormalBuffer = std::make_shared<GLBuffer>(GL_ARRAY_BUFFER);
-      glNormalBuffer->setData(tesselation.getNormals(), 3);
-    }
-
-    if (useTexCoords) {
-      glTexCoordsBuffer = std::make_shared<GLBuffer>(GL_ARRAY_BUFFER);
-      glTexCoordsBuffer->setData(tesselation.getTexCoords(), 2);
-    }
-
-    if (useTangents) {
-      glTangentBuffer = std::make_shared<GLBuffer>(GL_ARRAY_BUFFER);
-      glTangentBuffer->setData(tesselation.getTangents(), 3);
-    }
-
+    glVertexBuffer.setData(tesselation.getInterleaved(), Tesselation::interleavedStride);
     glIndexBuffer.setData(tesselation.getIndices());
     vertexCount = GLsizei(tesselation.getIndices().size());
   }
@@ -54,13 +41,16 @@ public:
                const std::string& tagentVar= "vTang") {
 
     glArray.bind();
-    glArray.connectVertexAttrib(*glPosBuffer, program, posVar, 3);
-    if (glNormalBuffer)
-      glArray.connectVertexAttrib(*glNormalBuffer, program, normalVar, 3);
-    if (glTexCoordsBuffer)
-      glArray.connectVertexAttrib(*glTexCoordsBuffer, program, texCoordsVar, 2);
-    if (glTangentBuffer)
-      glArray.connectVertexAttrib(*glTangentBuffer, program, tagentVar, 3);
+    glArray.connectVertexAttrib(glVertexBuffer, program, posVar, 3);
+    if (useNormals)
+      glArray.connectVertexAttrib(glVertexBuffer, program, normalVar, 3,
+                                  Tesselation::normalOffset);
+    if (useTexCoords)
+      glArray.connectVertexAttrib(glVertexBuffer, program, texCoordsVar, 2,
+                                  Tesselation::texCoordOffset);
+    if (useTangents)
+      glArray.connectVertexAttrib(glVertexBuffer, program, tagentVar, 3,
+                                  Tesselation::tangentOffset);
     glArray.connectIndexBuffer(glIndexBuffer);
   }
 
@@ -71,10 +61,10 @@ public:
 
 private:
   GLArray     glArray;
-  std::shared_ptr<GLBuffer>  glPosBuffer{nullptr};
-  std::shared_ptr<GLBuffer>  glNormalBuffer{nullptr};
-  std::shared_ptr<GLBuffer>  glTexCoordsBuffer{nullptr};
-  std::shared_ptr<GLBuffer>  glTangentBuffer{nullptr};
+  GLBuffer    glVertexBuffer{GL_ARRAY_BUFFER};
+  bool        useNormals{false};
+  bool        useTexCoords{false};
+  bool        useTangents{false};
   GLBuffer  glIndexBuffer{GL_ELEMENT_ARRAY_BUFFER};
   GLsizei     vertexCount{0};
 
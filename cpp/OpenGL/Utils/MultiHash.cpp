@@ -0,0 +1,608 @@
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <cstring>
+
+#include "CPUFeatures.h"
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+#include "MappedFile.h"
+#include "MultiHash.h"
+
+using MultiHash::Algorithm;
+using MultiHash::Backend;
+using MultiHash::Digest;
+
+namespace {
+  const uint32_t md5Init[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+  const uint32_t md5K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+  const uint32_t sha256Init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                  0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+  alignas(16) const uint32_t sha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+  uint32_t load32le(const uint8_t* p) {
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+  }
+
+  uint32_t load32be(const uint8_t* p) {
+    return uint32_t(p[3]) | uint32_t(p[2]) << 8 | uint32_t(p[1]) << 16 | uint32_t(p[0]) << 24;
+  }
+
+  // the lane types of the rounds in MultiHashRounds.h
+  struct ScalarLanes {
+    typedef uint32_t V;
+    static V set1(uint32_t x) {return x;}
+    static V add(V a, V b) {return a + b;}
+    static V bitAnd(V a, V b) {return a & b;}
+    static V bitOr(V a, V b) {return a | b;}
+    static V bitXor(V a, V b) {return a ^ b;}
+    static V bitNot(V a) {return ~a;}
+    template <int n> static V rotl(V x) {return (x << n) | (x >> (32-n));}
+    template <int n> static V rotr(V x) {return (x >> n) | (x << (32-n));}
+    template <int n> static V shr(V x) {return x >> n;}
+  };
+
+  namespace scalar {
+#include "MultiHashRounds.h"
+  }
+
+  typedef void (*BlockFunction)(uint32_t* state, const uint8_t* data, size_t count);
+
+  void md5Blocks(uint32_t* state, const uint8_t* data, size_t count) {
+    for (size_t b = 0;b<count;++b, data += 64) {
+      uint32_t x[16];
+      for (size_t i = 0;i<16;++i) x[i] = load32le(data+i*4);
+      scalar::md5Rounds<ScalarLanes>(state, x);
+    }
+  }
+
+  void sha256Blocks(uint32_t* state, const uint8_t* data, size_t count) {
+    for (size_t b = 0;b<count;++b, data += 64) {
+      uint32_t w[64];
+      for (size_t i = 0;i<16;++i) w[i] = load32be(data+i*4);
+      scalar::sha256Rounds<ScalarLanes>(state, w);
+    }
+  }
+
+#ifdef CPU_X86
+SIMD_TARGET_BEGIN_SHA
+  // four rounds of the SHA extensions, the state is kept as ABEF and CDGH
+  #define SHA256_ROUNDS(group, message) {                                         \
+    const __m128i k = _mm_add_epi32(message,                                      \
+                                    _mm_load_si128((const __m128i*)(sha256K+4*(group)))); \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, k);                                  \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(k, 0x0e));         \
+  }
+
+  // rounds of the groups 3 to 14 that also extend the message schedule,
+  // next gets the words of group+1, last starts the ones of group+3
+  #define SHA256_SCHEDULE_ROUNDS(group, current, last, next, first) {             \
+    const __m128i k = _mm_add_epi32(current,                                      \
+                                    _mm_load_si128((const __m128i*)(sha256K+4*(group)))); \
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, k);                                  \
+    next = _mm_sha256msg2_epu32(_mm_add_epi32(next, _mm_alignr_epi8(current, last, 4)), current); \
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(k, 0x0e));         \
+    if (first) last = _mm_sha256msg1_epu32(last, current);                        \
+  }
+
+  void sha256BlocksSHANI(uint32_t* state, const uint8_t* data, size_t count) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)state), 0xb1);
+    const __m128i hgfe = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(state+4)), 0x1b);
+    __m128i abef = _mm_alignr_epi8(dcba, hgfe, 8);
+    __m128i cdgh = _mm_blend_epi16(hgfe, dcba, 0xf0);
+
+    for (size_t b = 0;b<count;++b, data += 64) {
+      const __m128i abefStart = abef;
+      const __m128i cdghStart = cdgh;
+
+      __m128i m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), byteSwap);
+      __m128i m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+16)), byteSwap);
+      __m128i m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+32)), byteSwap);
+      __m128i m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(data+48)), byteSwap);
+
+      SHA256_ROUNDS(0, m0);
+      SHA256_ROUNDS(1, m1);
+      m0 = _mm_sha256msg1_epu32(m0, m1);
+      SHA256_ROUNDS(2, m2);
+      m1 = _mm_sha256msg1_epu32(m1, m2);
+      SHA256_SCHEDULE_ROUNDS(3, m3, m2, m0, true);
+      SHA256_SCHEDULE_ROUNDS(4, m0, m3, m1, true);
+      SHA256_SCHEDULE_ROUNDS(5, m1, m0, m2, true);
+      SHA256_SCHEDULE_ROUNDS(6, m2, m1, m3, true);
+      SHA256_SCHEDULE_ROUNDS(7, m3, m2, m0, true);
+      SHA256_SCHEDULE_ROUNDS(8, m0, m3, m1, true);
+      SHA256_SCHEDULE_ROUNDS(9, m1, m0, m2, true);
+      SHA256_SCHEDULE_ROUNDS(10, m2, m1, m3, true);
+      SHA256_SCHEDULE_ROUNDS(11, m3, m2, m0, true);
+      SHA256_SCHEDULE_ROUNDS(12, m0, m3, m1, true);
+      SHA256_SCHEDULE_ROUNDS(13, m1, m0, m2, false);
+      SHA256_SCHEDULE_ROUNDS(14, m2, m1, m3, false);
+      SHA256_ROUNDS(15, m3);
+
+      abef = _mm_add_epi32(abef, abefStart);
+      cdgh = _mm_add_epi32(cdgh, cdghStart);
+    }
+
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1b);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128((__m128i*)state, _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128((__m128i*)(state+4), _mm_alignr_epi8(dchg, feba, 8));
+  }
+
+  #undef SHA256_ROUNDS
+  #undef SHA256_SCHEDULE_ROUNDS
+SIMD_TARGET_END
+
+SIMD_TARGET_BEGIN_AVX2
+  struct AVX2Lanes {
+    typedef __m256i V;
+    static V set1(uint32_t x) {return _mm256_set1_epi32(int(x));}
+    static V add(V a, V b) {return _mm256_add_epi32(a, b);}
+    static V bitAnd(V a, V b) {return _mm256_and_si256(a, b);}
+    static V bitOr(V a, V b) {return _mm256_or_si256(a, b);}
+    static V bitXor(V a, V b) {return _mm256_xor_si256(a, b);}
+    static V bitNot(V a) {return _mm256_xor_si256(a, _mm256_set1_epi32(-1));}
+    template <int n> static V rotl(V x) {return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32-n));}
+    template <int n> static V rotr(V x) {return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32-n));}
+    template <int n> static V shr(V x) {return _mm256_srli_epi32(x, n);}
+  };
+
+  namespace avx2 {
+#include "MultiHashRounds.h"
+  }
+
+  // rows[l] holds eight words of lane l, afterwards rows[i] holds word i
+  // of every lane
+  void transpose(__m256i rows[8]) {
+    __m256i t[8];
+    for (size_t i = 0;i<8;i += 2) {
+      t[i]   = _mm256_unpacklo_epi32(rows[i], rows[i+1]);
+      t[i+1] = _mm256_unpackhi_epi32(rows[i], rows[i+1]);
+    }
+    __m256i u[8];
+    for (size_t i = 0;i<8;i += 4) {
+      u[i]   = _mm256_unpacklo_epi64(t[i], t[i+2]);
+      u[i+1] = _mm256_unpackhi_epi64(t[i], t[i+2]);
+      u[i+2] = _mm256_unpacklo_epi64(t[i+1], t[i+3]);
+      u[i+3] = _mm256_unpackhi_epi64(t[i+1], t[i+3]);
+    }
+    for (size_t i = 0;i<4;++i) {
+      rows[i]   = _mm256_permute2x128_si256(u[i], u[i+4], 0x20);
+      rows[i+4] = _mm256_permute2x128_si256(u[i], u[i+4], 0x31);
+    }
+  }
+
+  void loadWords(__m256i words[16], const uint8_t* const blocks[8], bool bigEndian) {
+    const __m256i byteSwap = _mm256_setr_epi8(3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12,
+                                              3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12);
+    for (size_t half = 0;half<2;++half) {
+      __m256i* rows = words + half*8;
+      for (size_t l = 0;l<8;++l) rows[l] = _mm256_loadu_si256((const __m256i*)(blocks[l]+half*32));
+      transpose(rows);
+      if (bigEndian)
+        for (size_t i = 0;i<8;++i) rows[i] = _mm256_shuffle_epi8(rows[i], byteSwap);
+    }
+  }
+
+  // one block of each of the eight lanes, state[word][lane]
+  void md5Blocks8(uint32_t state[][8], const uint8_t* const blocks[8]) {
+    __m256i x[16];
+    loadWords(x, blocks, false);
+    __m256i h[4];
+    for (size_t i = 0;i<4;++i) h[i] = _mm256_load_si256((const __m256i*)state[i]);
+    avx2::md5Rounds<AVX2Lanes>(h, x);
+    for (size_t i = 0;i<4;++i) _mm256_store_si256((__m256i*)state[i], h[i]);
+  }
+
+  void sha256Blocks8(uint32_t state[][8], const uint8_t* const blocks[8]) {
+    __m256i w[64];
+    loadWords(w, blocks, true);
+    __m256i h[8];
+    for (size_t i = 0;i<8;++i) h[i] = _mm256_load_si256((const __m256i*)state[i]);
+    avx2::sha256Rounds<AVX2Lanes>(h, w);
+    for (size_t i = 0;i<8;++i) _mm256_store_si256((__m256i*)state[i], h[i]);
+  }
+SIMD_TARGET_END
+#endif
+
+  size_t stateWords(Algorithm algorithm) {
+    return algorithm == Algorithm::MD5 ? 4 : 8;
+  }
+
+  const uint32_t* initialState(Algorithm algorithm) {
+    return algorithm == Algorithm::MD5 ? md5Init : sha256Init;
+  }
+
+  // the backend for a single stream
+  BlockFunction singleBlocks(Algorithm algorithm, Backend backend) {
+    if (algorithm == Algorithm::MD5) return md5Blocks;
+#ifdef CPU_X86
+    if ((backend == Backend::Auto || backend == Backend::SHANI) && CPUFeatures::hasSHA())
+      return sha256BlocksSHANI;
+#endif
+    return sha256Blocks;
+  }
+
+  void checkBackend(Algorithm algorithm, Backend backend) {
+    if (!MultiHash::isAvailable(algorithm, backend))
+      throw std::runtime_error("MultiHash backend is not supported by this CPU");
+  }
+
+  // the last partial block with the padding and the length in bits, one or
+  // two blocks
+  size_t padTail(Algorithm algorithm, const uint8_t* rest, size_t restSize, uint64_t totalSize,
+                 uint8_t tail[128]) {
+    const size_t blocks = restSize + 9 <= 64 ? 1 : 2;
+    std::memset(tail, 0, blocks*64);
+    if (restSize > 0) std::memcpy(tail, rest, restSize);
+    tail[restSize] = 0x80;
+    const uint64_t bits = totalSize*8;
+    uint8_t* length = tail + blocks*64 - 8;
+    for (size_t i = 0;i<8;++i)
+      length[i] = uint8_t(algorithm == Algorithm::MD5 ? bits >> (8*i) : bits >> (56-8*i));
+    return blocks;
+  }
+
+  Digest toDigest(Algorithm algorithm, const uint32_t* state) {
+    Digest digest(MultiHash::digestSize(algorithm));
+    for (size_t i = 0;i<digest.size()/4;++i) {
+      for (size_t j = 0;j<4;++j)
+        digest[i*4+j] = uint8_t(algorithm == Algorithm::MD5 ? state[i] >> (8*j) : state[i] >> (24-8*j));
+    }
+    return digest;
+  }
+
+  Digest hashSingle(Algorithm algorithm, const uint8_t* data, size_t size, BlockFunction blocks) {
+    uint32_t state[8];
+    std::memcpy(state, initialState(algorithm), stateWords(algorithm)*sizeof(uint32_t));
+    const size_t fullBlocks = size/64;
+    blocks(state, data, fullBlocks);
+    uint8_t tail[128];
+    blocks(state, tail, padTail(algorithm, data+fullBlocks*64, size%64, size, tail));
+    return toDigest(algorithm, state);
+  }
+
+#ifdef CPU_X86
+  // Multi-buffer scheduling: every lane walks through the full blocks of
+  // its message and then through its padded tail. When a lane is done its
+  // digest is taken out and the next message moves in. Once no message is
+  // waiting and at most two lanes are left, they finish one by one with
+  // the single stream code rather than running mostly empty vectors.
+  void hashLanes(Algorithm algorithm, const std::vector<MultiHash::Buffer>& buffers,
+                 std::vector<Digest>& digests) {
+    struct Lane {
+      const uint8_t* data;
+      size_t fullBlocks;
+      size_t totalBlocks;
+      size_t next;
+      size_t message;
+      uint8_t tail[128];
+      bool active{false};
+
+      const uint8_t* block() const {
+        return next < fullBlocks ? data + next*64 : tail + (next-fullBlocks)*64;
+      }
+    };
+
+    static const uint8_t unusedBlock[64] = {};
+    alignas(32) uint32_t state[8][8];
+    Lane lanes[8];
+    const size_t words = stateWords(algorithm);
+    const uint32_t* init = initialState(algorithm);
+    const BlockFunction single = singleBlocks(algorithm, Backend::Scalar);
+    size_t nextMessage = 0;
+    size_t activeLanes = 0;
+
+    const auto start = [&](size_t l) {
+      Lane& lane = lanes[l];
+      lane.active = nextMessage < buffers.size();
+      if (!lane.active) return;
+      const MultiHash::Buffer& buffer = buffers[nextMessage];
+      lane.message = nextMessage++;
+      lane.data = buffer.data;
+      lane.fullBlocks = buffer.size/64;
+      lane.totalBlocks = lane.fullBlocks + padTail(algorithm, buffer.data + lane.fullBlocks*64,
+                                                    buffer.size%64, buffer.size, lane.tail);
+      lane.next = 0;
+      for (size_t i = 0;i<words;++i) state[i][l] = init[i];
+      ++activeLanes;
+    };
+    for (size_t l = 0;l<8;++l) start(l);
+
+    while (activeLanes > 0) {
+      if (nextMessage == buffers.size() && activeLanes <= 2) {
+        for (Lane& lane : lanes) {
+          if (!lane.active) continue;
+          const size_t l = size_t(&lane - lanes);
+          uint32_t laneState[8];
+          for (size_t i = 0;i<words;++i) laneState[i] = state[i][l];
+          if (lane.next < lane.fullBlocks)
+            single(laneState, lane.block(), lane.fullBlocks-lane.next);
+          const size_t tailStart = std::max(lane.next, lane.fullBlocks) - lane.fullBlocks;
+          single(laneState, lane.tail + tailStart*64, lane.totalBlocks-lane.fullBlocks-tailStart);
+          digests[lane.message] = toDigest(algorithm, laneState);
+        }
+        break;
+      }
+
+      const uint8_t* blocks[8];
+      for (size_t l = 0;l<8;++l) blocks[l] = lanes[l].active ? lanes[l].block() : unusedBlock;
+      if (algorithm == Algorithm::MD5)
+        md5Blocks8(state, blocks);
+      else
+        sha256Blocks8(state, blocks);
+
+      for (size_t l = 0;l<8;++l) {
+        Lane& lane = lanes[l];
+        if (!lane.active || ++lane.next < lane.totalBlocks) continue;
+        uint32_t laneState[8];
+        for (size_t i = 0;i<words;++i) laneState[i] = state[i][l];
+        digests[lane.message] = toDigest(algorithm, laneState);
+        --activeLanes;
+        start(l);
+      }
+    }
+  }
+#endif
+
+  // splits [0,count) into one contiguous range per thread
+  template <typename Body>
+  void parallelRanges(size_t count, size_t threadCount, Body body) {
+    if (threadCount == 0) threadCount = std::thread::hardware_concurrency();
+    threadCount = std::max<size_t>(1, std::min(threadCount, count));
+    if (threadCount == 1) {
+      body(size_t(0), count);
+      return;
+    }
+    std::vector<std::thread> threads;
+    for (size_t t = 0;t<threadCount;++t)
+      threads.emplace_back(body, count*t/threadCount, count*(t+1)/threadCount);
+    for (std::thread& thread : threads) thread.join();
+  }
+}
+
+bool MultiHash::isAvailable(Algorithm algorithm, Backend backend) {
+  switch (backend) {
+    case Backend::Auto :
+    case Backend::Scalar :
+      return true;
+    case Backend::AVX2 :
+#ifdef CPU_X86
+      return CPUFeatures::hasAVX2();
+#else
+      return false;
+#endif
+    case Backend::SHANI :
+#ifdef CPU_X86
+      return algorithm == Algorithm::SHA256 && CPUFeatures::hasSHA();
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+size_t MultiHash::digestSize(Algorithm algorithm) {
+  return algorithm == Algorithm::MD5 ? 16 : 32;
+}
+
+std::string MultiHash::toHexString(const Digest& digest) {
+  static const char* hex = "0123456789abcdef";
+  std::string result(digest.size()*2, ' ');
+  for (size_t i = 0;i<digest.size();++i) {
+    result[i*2] = hex[digest[i] >> 4];
+    result[i*2+1] = hex[digest[i] & 15];
+  }
+  return result;
+}
+
+MultiHash::Hasher::Hasher(Algorithm algorithm, Backend backend) :
+  algorithm{algorithm},
+  backend{backend}
+{
+  checkBackend(algorithm, backend);
+  reset();
+}
+
+void MultiHash::Hasher::reset() {
+  std::memcpy(state, initialState(algorithm), stateWords(algorithm)*sizeof(uint32_t));
+  blockSize = 0;
+  totalSize = 0;
+}
+
+void MultiHash::Hasher::update(const uint8_t* data, size_t size) {
+  const BlockFunction blocks = singleBlocks(algorithm, backend);
+  totalSize += size;
+  if (blockSize > 0) {
+    const size_t count = std::min(size, 64-blockSize);
+    std::memcpy(block+blockSize, data, count);
+    blockSize += count;
+    data += count;
+    size -= count;
+    if (blockSize < 64) return;
+    blocks(state, block, 1);
+    blockSize = 0;
+  }
+  blocks(state, data, size/64);
+  blockSize = size%64;
+  if (blockSize > 0) std::memcpy(block, data + size/64*64, blockSize);
+}
+
+Digest MultiHash::Hasher::finish() {
+  uint8_t tail[128];
+  singleBlocks(algorithm, backend)(state, tail, padTail(algorithm, block, blockSize, totalSize, tail));
+  const Digest digest = toDigest(algorithm, state);
+  reset();
+  return digest;
+}
+
+Digest MultiHash::hash(Algorithm algorithm, const uint8_t* data, size_t size, Backend backend) {
+  checkBackend(algorithm, backend);
+  return hashSingle(algorithm, data, size, singleBlocks(algorithm, backend));
+}
+
+std::vector<Digest> MultiHash::hashBuffers(Algorithm algorithm, const std::vector<Buffer>& buffers,
+                                           Backend backend) {
+  checkBackend(algorithm, backend);
+  std::vector<Digest> digests(buffers.size());
+#ifdef CPU_X86
+  // the SHA extensions beat eight AVX2 lanes
+  const bool lanes = backend == Backend::AVX2 ||
+                     (backend == Backend::Auto && CPUFeatures::hasAVX2() &&
+                      !isAvailable(algorithm, Backend::SHANI));
+  if (lanes) {
+    hashLanes(algorithm, buffers, digests);
+    return digests;
+  }
+#endif
+  const BlockFunction blocks = singleBlocks(algorithm, backend);
+  for (size_t i = 0;i<buffers.size();++i)
+    digests[i] = hashSingle(algorithm, buffers[i].data, buffers[i].size, blocks);
+  return digests;
+}
+
+Digest MultiHash::hashChunked(Algorithm algorithm, const uint8_t* data, size_t size,
+                              size_t chunkSize, size_t threadCount, Backend backend) {
+  checkBackend(algorithm, backend);
+  if (chunkSize == 0) throw std::runtime_error("MultiHash chunk size must not be zero");
+
+  const size_t chunkCount = std::max<size_t>(1, (size+chunkSize-1)/chunkSize);
+  const size_t length = digestSize(algorithm);
+  std::vector<uint8_t> leaves(chunkCount*length);
+  parallelRanges(chunkCount, threadCount, [&](size_t begin, size_t end) {
+    std::vector<Buffer> chunks;
+    for (size_t c = begin;c<end;++c)
+      chunks.push_back({data + c*chunkSize, std::min(chunkSize, size-std::min(size, c*chunkSize))});
+    const std::vector<Digest> digests = hashBuffers(algorithm, chunks, backend);
+    for (size_t c = begin;c<end;++c)
+      std::memcpy(leaves.data() + c*length, digests[c-begin].data(), length);
+  });
+  return hash(algorithm, leaves.data(), leaves.size(), backend);
+}
+
+Digest MultiHash::hashFileChunked(Algorithm algorithm, const std::string& filename,
+                                  size_t chunkSize, size_t threadCount, Backend backend) {
+  try {
+    const MappedFile file{filename};
+    return hashChunked(algorithm, file.data(), file.size(), chunkSize, threadCount, backend);
+  } catch (const MappedFileException&) {
+    return Digest();
+  }
+}
+
+std::vector<Digest> MultiHash::hashFiles(Algorithm algorithm, const std::vector<std::string>& filenames,
+                                         size_t threadCount, size_t streamAbove, Backend backend) {
+  checkBackend(algorithm, backend);
+  if (threadCount == 0) threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+  // files the reader has loaded, a file without data and with streamed
+  // set is left to the hashing thread that takes it
+  struct File {
+    size_t index;
+    bool streamed;
+    std::vector<uint8_t> data;
+  };
+
+  // the reader stays at most this far ahead of the hashing threads
+  const size_t maxQueuedBytes = std::max<size_t>(size_t(64) << 20, streamAbove);
+  std::vector<Digest> digests(filenames.size());
+  std::deque<File> queue;
+  size_t queuedBytes = 0;
+  bool readingDone = false;
+  std::mutex mutex;
+  std::condition_variable changed;
+
+  std::thread reader([&]() {
+    for (size_t i = 0;i<filenames.size();++i) {
+      File file{i, false, {}};
+      std::ifstream stream{filenames[i], std::ios::binary | std::ios::ate};
+      if (!stream.is_open()) continue;
+      const std::streamoff length = stream.tellg();
+      if (length < 0) continue;
+      if (size_t(length) > streamAbove) {
+        file.streamed = true;
+      } else {
+        file.data.resize(size_t(length));
+        stream.seekg(0);
+        if (!stream.read((char*)file.data.data(), length)) continue;
+      }
+
+      std::unique_lock<std::mutex> lock{mutex};
+      changed.wait(lock, [&]() {return queue.empty() || queuedBytes + file.data.size() <= maxQueuedBytes;});
+      queuedBytes += file.data.size();
+      queue.push_back(std::move(file));
+      changed.notify_all();
+    }
+    std::lock_guard<std::mutex> lock{mutex};
+    readingDone = true;
+    changed.notify_all();
+  });
+
+  const auto hashing = [&]() {
+    std::vector<uint8_t> piece(size_t(1) << 20);
+    while (true) {
+      std::vector<File> files;
+      {
+        std::unique_lock<std::mutex> lock{mutex};
+        changed.wait(lock, [&]() {return !queue.empty() || readingDone;});
+        if (queue.empty()) return;
+        // a group of loaded files fills the lanes, a streamed file goes alone
+        while (!queue.empty() && files.size() < 8 && (files.empty() || !queue.front().streamed)) {
+          queuedBytes -= queue.front().data.size();
+          files.push_back(std::move(queue.front()));
+          queue.pop_front();
+          if (files.back().streamed) break;
+        }
+        changed.notify_all();
+      }
+
+      if (files.front().streamed) {
+        std::ifstream stream{filenames[files.front().index], std::ios::binary};
+        Hasher hasher{algorithm, backend};
+        while (stream.read((char*)piece.data(), std::streamsize(piece.size())) || stream.gcount() > 0)
+          hasher.update(piece.data(), size_t(stream.gcount()));
+        if (stream.bad()) continue;
+        digests[files.front().index] = hasher.finish();
+        continue;
+      }
+
+      std::vector<Buffer> buffers;
+      for (const File& file : files) buffers.push_back({file.data.data(), file.data.size()});
+      const std::vector<Digest> result = hashBuffers(algorithm, buffers, backend);
+      for (size_t i = 0;i<files.size();++i) digests[files[i].index] = result[i];
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0;t<threadCount;++t) threads.emplace_back(hashing);
+  reader.join();
+  for (std::thread& thread : threads) thread.join();
+  return digests;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+// MD5 and SHA-256 with several backends. The multi-buffer functions hash
+// independent messages at the same time, eight of them in the lanes of
+// the AVX2 registers, a lane that finishes its message picks up the next
+// one. SHA-256 also runs on the SHA extensions, one message at a time.
+// Backends are chosen by the CPU at runtime, Auto picks the fastest one
+// available. The digests are the same as the ones of the MD5 and SHA256
+// classes.
+namespace MultiHash {
+  enum class Algorithm {MD5, SHA256};
+  enum class Backend {Auto, Scalar, AVX2, SHANI};
+
+  typedef std::vector<uint8_t> Digest;
+
+  struct Buffer {
+    const uint8_t* data;
+    size_t size;
+  };
+
+  bool isAvailable(Algorithm algorithm, Backend backend);
+  size_t digestSize(Algorithm algorithm);
+  std::string toHexString(const Digest& digest);
+
+  // incremental hashing of a single stream
+  class Hasher {
+  public:
+    Hasher(Algorithm algorithm, Backend backend=Backend::Auto);
+
+    void update(const uint8_t* data, size_t size);
+    // the digest of everything passed to update, resets the hasher
+    Digest finish();
+
+  private:
+    Algorithm algorithm;
+    Backend backend;
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t blockSize{0};
+    uint64_t totalSize{0};
+
+    void reset();
+  };
+
+  Digest hash(Algorithm algorithm, const uint8_t* data, size_t size, Backend backend=Backend::Auto);
+
+  // one digest per buffer, in the same order
+  std::vector<Digest> hashBuffers(Algorithm algorithm, const std::vector<Buffer>& buffers,
+                                  Backend backend=Backend::Auto);
+
+  // Merkle mode for large data: the chunks of chunkSize bytes are hashed
+  // in parallel, the result is the hash of their concatenated digests. It
+  // differs from the plain hash of the data and depends on chunkSize.
+  Digest hashChunked(Algorithm algorithm, const uint8_t* data, size_t size,
+                     size_t chunkSize=size_t(1) << 20, size_t threadCount=0,
+                     Backend backend=Backend::Auto);
+  // the same for a memory mapped file, an empty digest if it can't be read
+  Digest hashFileChunked(Algorithm algorithm, const std::string& filename,
+                         size_t chunkSize=size_t(1) << 20, size_t threadCount=0,
+                         Backend backend=Backend::Auto);
+
+  // Plain hashes of whole files, an empty digest for a file that can't be
+  // read. A reader thread loads the files while threadCount threads hash
+  // them in groups, files larger than streamAbove are read and hashed in
+  // pieces by a hashing thread instead. threadCount 0 uses every core.
+  std::vector<Digest> hashFiles(Algorithm algorithm, const std::vector<std::string>& filenames,
+                                size_t threadCount=0, size_t streamAbove=size_t(16) << 20,
+                                Backend backend=Backend::Auto);
+}
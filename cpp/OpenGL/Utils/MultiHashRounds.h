@@ -0,0 +1,110 @@
+// The MD5 and SHA-256 rounds for a lane type L, a single uint32_t for the
+// scalar code and eight of them in an AVX2 register. MultiHash.cpp includes
+// this file once per instruction set, each time in its own namespace, so
+// the AVX2 instances are compiled for AVX2 and the scalar ones are not.
+// There is deliberately no include guard.
+
+template <typename L, int s>
+void md5Step(typename L::V& a, typename L::V b, typename L::V f, typename L::V x, uint32_t k) {
+  a = L::add(b, L::template rotl<s>(L::add(L::add(a, f), L::add(x, L::set1(k)))));
+}
+
+// the round functions are templates rather than lambdas, lambdas in the
+// templates below would not inherit the instruction set
+template <typename L>
+typename L::V md5F(typename L::V b, typename L::V c, typename L::V d) {
+  return L::bitXor(d, L::bitAnd(b, L::bitXor(c, d)));
+}
+
+template <typename L>
+typename L::V md5G(typename L::V b, typename L::V c, typename L::V d) {
+  return L::bitXor(c, L::bitAnd(d, L::bitXor(b, c)));
+}
+
+template <typename L>
+typename L::V md5H(typename L::V b, typename L::V c, typename L::V d) {
+  return L::bitXor(L::bitXor(b, c), d);
+}
+
+template <typename L>
+typename L::V md5I(typename L::V b, typename L::V c, typename L::V d) {
+  return L::bitXor(c, L::bitOr(b, L::bitNot(d)));
+}
+
+template <typename L>
+void md5Rounds(typename L::V h[4], const typename L::V x[16]) {
+  typedef typename L::V V;
+  const auto f = md5F<L>;
+  const auto g = md5G<L>;
+  const auto e = md5H<L>;
+  const auto i = md5I<L>;
+
+  V a = h[0], b = h[1], c = h[2], d = h[3];
+  for (int t = 0;t<16;t += 4) {
+    md5Step<L,7>(a, b, f(b,c,d), x[t], md5K[t]);
+    md5Step<L,12>(d, a, f(a,b,c), x[t+1], md5K[t+1]);
+    md5Step<L,17>(c, d, f(d,a,b), x[t+2], md5K[t+2]);
+    md5Step<L,22>(b, c, f(c,d,a), x[t+3], md5K[t+3]);
+  }
+  for (int t = 16;t<32;t += 4) {
+    md5Step<L,5>(a, b, g(b,c,d), x[(5*t+1)&15], md5K[t]);
+    md5Step<L,9>(d, a, g(a,b,c), x[(5*t+6)&15], md5K[t+1]);
+    md5Step<L,14>(c, d, g(d,a,b), x[(5*t+11)&15], md5K[t+2]);
+    md5Step<L,20>(b, c, g(c,d,a), x[(5*t+16)&15], md5K[t+3]);
+  }
+  for (int t = 32;t<48;t += 4) {
+    md5Step<L,4>(a, b, e(b,c,d), x[(3*t+5)&15], md5K[t]);
+    md5Step<L,11>(d, a, e(a,b,c), x[(3*t+8)&15], md5K[t+1]);
+    md5Step<L,16>(c, d, e(d,a,b), x[(3*t+11)&15], md5K[t+2]);
+    md5Step<L,23>(b, c, e(c,d,a), x[(3*t+14)&15], md5K[t+3]);
+  }
+  for (int t = 48;t<64;t += 4) {
+    md5Step<L,6>(a, b, i(b,c,d), x[(7*t)&15], md5K[t]);
+    md5Step<L,10>(d, a, i(a,b,c), x[(7*t+7)&15], md5K[t+1]);
+    md5Step<L,15>(c, d, i(d,a,b), x[(7*t+14)&15], md5K[t+2]);
+    md5Step<L,21>(b, c, i(c,d,a), x[(7*t+21)&15], md5K[t+3]);
+  }
+  h[0] = L::add(h[0], a);
+  h[1] = L::add(h[1], b);
+  h[2] = L::add(h[2], c);
+  h[3] = L::add(h[3], d);
+}
+
+// w holds the 16 words of the block and is extended to the 64 of the
+// message schedule
+template <typename L>
+void sha256Rounds(typename L::V h[8], typename L::V w[64]) {
+  typedef typename L::V V;
+  for (int t = 16;t<64;++t) {
+    const V s0 = L::bitXor(L::bitXor(L::template rotr<7>(w[t-15]), L::template rotr<18>(w[t-15])),
+                           L::template shr<3>(w[t-15]));
+    const V s1 = L::bitXor(L::bitXor(L::template rotr<17>(w[t-2]), L::template rotr<19>(w[t-2])),
+                           L::template shr<10>(w[t-2]));
+    w[t] = L::add(L::add(s1, w[t-7]), L::add(s0, w[t-16]));
+  }
+
+  V a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+  for (int t = 0;t<64;++t) {
+    const V s1 = L::bitXor(L::bitXor(L::template rotr<6>(e), L::template rotr<11>(e)), L::template rotr<25>(e));
+    const V ch = L::bitXor(g, L::bitAnd(e, L::bitXor(f, g)));
+    const V t1 = L::add(L::add(L::add(k, s1), L::add(ch, L::set1(sha256K[t]))), w[t]);
+    const V s0 = L::bitXor(L::bitXor(L::template rotr<2>(a), L::template rotr<13>(a)), L::template rotr<22>(a));
+    const V maj = L::bitOr(L::bitAnd(a, b), L::bitAnd(c, L::bitOr(a, b)));
+    k = g;
+    g = f;
+    f = e;
+    e = L::add(d, t1);
+    d = c;
+    c = b;
+    b = a;
+    a = L::add(t1, L::add(s0, maj));
+  }
+  h[0] = L::add(h[0], a);
+  h[1] = L::add(h[1], b);
+  h[2] = L::add(h[2], c);
+  h[3] = L::add(h[3], d);
+  h[4] = L::add(h[4], e);
+  h[5] = L::add(h[5], f);
+  h[6] = L::add(h[6], g);
+  h[7] = L::add(h[7], k);
+}
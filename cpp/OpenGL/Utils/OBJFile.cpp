@@ -1,99 +1,333 @@
 #include <fstream>
 #include <algorithm>
-#include <cctype> //std::isspace
+#include <charconv>
+#include <filesystem>
+#include <limits>
+#include <cstring>
+#include <cstdlib>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "MappedFile.h"
+#include "VecArray.h"
 #include "OBJFile.h"
 
-OBJFile::OBJFile(const std::string& filename, bool normalize) {
-  Vec3 minVal{};
-  Vec3 maxVal{};
-  
-  std::ifstream f(filename);
-  std::string line;
-  while (std::getline(f, line)) {
-    trim(line);
-    if (line.size() < 2) continue;
-    
-    if (line[0] == 'f') {
-      std::vector<std::string> face = tokenize(line,1);
-      if (face.size() != 3) continue;
-      indices.push_back({fromStr<size_t>(face[0])-1,fromStr<size_t>(face[1])-1,fromStr<size_t>(face[2])-1});
-    } else {
-      if (line[0] == 'v') {
-        if (line[1] == 'n') {
-          std::vector<std::string> normal = tokenize(line,2);
-          if (normal.size() != 3) continue;
-          normals.push_back({fromStr<float>(normal[0]),fromStr<float>(normal[1]),fromStr<float>(normal[2])});
-        } else {
-          std::vector<std::string> vertex = tokenize(line,1);
-          if (vertex.size() != 3) continue;
-          Vec3 v{fromStr<float>(vertex[0]),fromStr<float>(vertex[1]),fromStr<float>(vertex[2])};
-          
-          if (vertices.empty()) {
-            minVal = v;
-            maxVal = v;
-          } else {
-            for (size_t i = 0;i<3;++i) {
-              minVal[i] = std::min(minVal[i], v[i]);
-              maxVal[i] = std::max(maxVal[i], v[i]);
-            }
-            
-          }
-          
-          vertices.push_back(v);
-        }
-      }
+static const char cacheMagic[4] = {'O','B','J','C'};
+static const uint32_t cacheVersion{1};
+// smaller files are not worth splitting any further
+static const size_t minChunkSize{size_t(1) << 20};
+static const size_t invalidIndex{std::numeric_limits<size_t>::max()};
+// vertices per call of the batched kernels
+static const size_t vertexBlock{size_t(1) << 12};
+
+struct OBJChunk {
+  std::vector<Vec3> vertices;
+  // three per triangle, zero based, either into the whole file or, for
+  // negative indices, into the vertices of this chunk
+  std::vector<int64_t> corners;
+  std::vector<size_t> relativeCorners;
+};
+
+static bool isBlank(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* skipBlanks(const char* p, const char* end) {
+  while (p < end && isBlank(*p)) ++p;
+  return p;
+}
+
+static const char* parseFloat(const char* p, const char* end, float& value) {
+  p = skipBlanks(p, end);
+  if (p < end && *p == '+') ++p;
+#ifdef __cpp_lib_to_chars
+  const std::from_chars_result result = std::from_chars(p, end, value);
+  return result.ec == std::errc() ? result.ptr : nullptr;
+#else
+  // without floating point from_chars, strtof needs a terminated copy since
+  // the mapping may end right after the number
+  char buffer[64];
+  size_t length = 0;
+  while (p+length < end && length < sizeof(buffer)-1 && !isBlank(p[length]) && p[length] != '\n') {
+    buffer[length] = p[length];
+    ++length;
+  }
+  buffer[length] = 0;
+  char* last;
+  value = std::strtof(buffer, &last);
+  return last == buffer ? nullptr : p + (last-buffer);
+#endif
+}
+
+static void parseVertex(const char* p, const char* end, OBJChunk& chunk) {
+  Vec3 v;
+  for (size_t i = 0;i<3;++i) {
+    p = parseFloat(p, end, v[i]);
+    if (p == nullptr) return;
+  }
+  chunk.vertices.push_back(v);
+}
+
+static void parseFace(const char* p, const char* end, OBJChunk& chunk,
+                      std::vector<std::pair<int64_t, bool>>& polygon) {
+  polygon.clear();
+  while (true) {
+    p = skipBlanks(p, end);
+    if (p == end) break;
+    int64_t index;
+    const std::from_chars_result result = std::from_chars(p, end, index);
+    if (result.ec != std::errc() || index == 0) return;
+    if (index > 0)
+      polygon.push_back({index-1, false});
+    else
+      polygon.push_back({int64_t(chunk.vertices.size())+index, true});
+    // texture coordinate and normal indices are not needed
+    p = result.ptr;
+    while (p < end && !isBlank(*p)) ++p;
+  }
+
+  for (size_t i = 1;i+1<polygon.size();++i) {
+    for (const auto& corner : {polygon[0], polygon[i], polygon[i+1]}) {
+      if (corner.second) chunk.relativeCorners.push_back(chunk.corners.size());
+      chunk.corners.push_back(corner.first);
     }
   }
-  f.close();
-  
-  if (normalize) {
-    Vec3 center = (maxVal + minVal)/2.0f;
-    float maxSize = std::max(maxVal[0] - minVal[0], std::max(maxVal[1] - minVal[1], maxVal[2] - minVal[2]));
+}
 
-    for (size_t i = 0;i<vertices.size();++i) {
-      vertices[i] = (vertices[i] - center) / maxSize;
+static void parseChunk(const char* p, const char* end, OBJChunk& chunk) {
+  std::vector<std::pair<int64_t, bool>> polygon;
+  while (p < end) {
+    const char* newline = static_cast<const char*>(memchr(p, '\n', size_t(end-p)));
+    const char* lineEnd = newline ? newline : end;
+    p = skipBlanks(p, lineEnd);
+    if (lineEnd-p >= 2 && isBlank(p[1])) {
+      if (p[0] == 'v')
+        parseVertex(p+1, lineEnd, chunk);
+      else if (p[0] == 'f')
+        parseFace(p+1, lineEnd, chunk, polygon);
     }
+    p = lineEnd+1;
   }
-  
-  normals.resize(vertices.size());
-  for (const OBJFile::IndexType& triangle : indices) {
-    std::array<Vec3, 3> v;
-    for (size_t i = 0;i<3;++i) {
-      v[0] = Vec3{vertices[triangle[0]][0],vertices[triangle[0]][1],vertices[triangle[0]][2]};
-      v[1] = Vec3{vertices[triangle[1]][0],vertices[triangle[1]][1],vertices[triangle[1]][2]};
-      v[2] = Vec3{vertices[triangle[2]][0],vertices[triangle[2]][1],vertices[triangle[2]][2]};
-      
-      Vec3 normal = Vec3::normalize(Vec3::cross(v[1]-v[0], v[2]-v[0]));
-      
-      normals[triangle[0]] = normal;
-      normals[triangle[1]] = normal;
-      normals[triangle[2]] = normal;
+}
+
+OBJFile::OBJFile(const std::string& filename, bool normalize, bool useCache) {
+  const std::string cacheFilename = filename + ".objcache";
+  std::error_code error;
+  const uint64_t sourceSize = uint64_t(std::filesystem::file_size(filename, error));
+  const int64_t sourceTime = int64_t(std::filesystem::last_write_time(filename, error).time_since_epoch().count());
+
+  if (!useCache || !loadCache(cacheFilename, sourceSize, sourceTime)) {
+    const MappedFile file{filename};
+    parse(file.data(), file.size());
+    computeNormals();
+    if (useCache) saveCache(cacheFilename, sourceSize, sourceTime);
+  }
+
+  if (normalize && !vertices.empty()) {
+    const VecArray::AABB box = VecArray::bounds(&vertices[0].x, vertices.size());
+    const Vec3 center = (box.max + box.min)/2.0f;
+    const Vec3 size = box.max - box.min;
+    const float maxSize = std::max(size.x, std::max(size.y, size.z));
+    const Mat4 m = Mat4::scaling(1.0f/maxSize) * Mat4::translation(-center.x, -center.y, -center.z);
+
+#pragma omp parallel for
+    for (int64_t first = 0;first<int64_t(vertices.size());first += int64_t(vertexBlock)) {
+      VecArray::transformPoints(m, &vertices[size_t(first)].x,
+                                std::min(vertexBlock, vertices.size()-size_t(first)));
     }
   }
-  
 }
 
-void OBJFile::ltrim(std::string &s) {
-    s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }));
+void OBJFile::parse(const uint8_t* data, size_t size) {
+  const char* text = reinterpret_cast<const char*>(data);
+
+#ifdef _OPENMP
+  const size_t threadCount = size_t(omp_get_max_threads());
+#else
+  const size_t threadCount = 1;
+#endif
+
+  // chunks start right after a line break
+  const size_t chunkCount = std::max<size_t>(1, std::min(size/minChunkSize, threadCount*4));
+  std::vector<size_t> starts(chunkCount+1, size);
+  starts[0] = 0;
+  for (size_t c = 1;c<chunkCount;++c) {
+    size_t start = std::max(size*c/chunkCount, starts[c-1]);
+    while (start < size && text[start-1] != '\n') ++start;
+    starts[c] = start;
+  }
+
+  std::vector<OBJChunk> chunks(chunkCount);
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t c = 0;c<int64_t(chunkCount);++c) {
+    parseChunk(text+starts[size_t(c)], text+starts[size_t(c)+1], chunks[size_t(c)]);
+  }
+
+  std::vector<size_t> vertexOffsets(chunkCount+1, 0);
+  std::vector<size_t> triangleOffsets(chunkCount+1, 0);
+  for (size_t c = 0;c<chunkCount;++c) {
+    vertexOffsets[c+1] = vertexOffsets[c] + chunks[c].vertices.size();
+    triangleOffsets[c+1] = triangleOffsets[c] + chunks[c].corners.size()/3;
+  }
+  const size_t vertexCount = vertexOffsets[chunkCount];
+  vertices.resize(vertexCount);
+  indices.resize(triangleOffsets[chunkCount]);
+
+  size_t invalidCount = 0;
+#pragma omp parallel for schedule(dynamic) reduction(+:invalidCount)
+  for (int64_t c = 0;c<int64_t(chunkCount);++c) {
+    OBJChunk& chunk = chunks[size_t(c)];
+    std::copy(chunk.vertices.begin(), chunk.vertices.end(), vertices.begin()+int64_t(vertexOffsets[size_t(c)]));
+    for (const size_t r : chunk.relativeCorners) chunk.corners[r] += int64_t(vertexOffsets[size_t(c)]);
+    for (size_t t = 0;t<chunk.corners.size()/3;++t) {
+      IndexType& triangle = indices[triangleOffsets[size_t(c)]+t];
+      for (size_t i = 0;i<3;++i) {
+        const int64_t index = chunk.corners[t*3+i];
+        triangle[i] = (index >= 0 && uint64_t(index) < vertexCount) ? size_t(index) : invalidIndex;
+      }
+      if (triangle[0] == invalidIndex || triangle[1] == invalidIndex || triangle[2] == invalidIndex)
+        ++invalidCount;
+    }
+  }
+
+  // faces referencing vertices that do not exist are dropped
+  if (invalidCount > 0) {
+    indices.erase(std::remove_if(indices.begin(), indices.end(), [](const IndexType& triangle) {
+      return triangle[0] == invalidIndex || triangle[1] == invalidIndex || triangle[2] == invalidIndex;
+    }), indices.end());
+  }
 }
 
-void OBJFile::rtrim(std::string &s) {
-    s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) {
-        return !std::isspace(ch);
-    }).base(), s.end());
+void OBJFile::computeNormals() {
+  std::vector<size_t> lastTriangle(vertices.size(), invalidIndex);
+  for (size_t t = 0;t<indices.size();++t) {
+    for (const size_t index : indices[t]) lastTriangle[index] = t;
+  }
+
+  // the edges of each block are gathered for the batched cross products
+  normals.resize(vertices.size());
+#pragma omp parallel
+  {
+    Vec3Array a, b;
+#pragma omp for
+    for (int64_t first = 0;first<int64_t(vertices.size());first += int64_t(vertexBlock)) {
+      const size_t count = std::min(vertexBlock, vertices.size()-size_t(first));
+      a.resize(count);
+      b.resize(count);
+      for (size_t i = 0;i<count;++i) {
+        const size_t t = lastTriangle[size_t(first)+i];
+        if (t == invalidIndex) {
+          a.set(i, Vec3{0,0,0});
+          b.set(i, Vec3{0,0,0});
+          continue;
+        }
+        const IndexType& triangle = indices[t];
+        a.set(i, vertices[triangle[1]]-vertices[triangle[0]]);
+        b.set(i, vertices[triangle[2]]-vertices[triangle[0]]);
+      }
+      VecArray::cross(a, b, a);
+      VecArray::normalize(a, a);
+      a.toInterleaved(&normals[size_t(first)].x);
+    }
+  }
 }
 
-void OBJFile::trim(std::string &s) {
-    ltrim(s);
-    rtrim(s);
+struct OBJCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t sourceSize;
+  int64_t sourceTime;
+  uint64_t vertexCount;
+  uint64_t triangleCount;
+  // bytes per stored index, 4 unless there are too many vertices
+  uint32_t indexBytes;
+  uint32_t reserved;
+};
+
+bool OBJFile::loadCache(const std::string& cacheFilename, uint64_t sourceSize, int64_t sourceTime) {
+  std::error_code error;
+  if (!std::filesystem::exists(cacheFilename, error)) return false;
+
+  try {
+    const MappedFile file{cacheFilename};
+    OBJCacheHeader header;
+    if (file.size() < sizeof(header)) return false;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, cacheMagic, 4) != 0 || header.version != cacheVersion ||
+        header.sourceSize != sourceSize || header.sourceTime != sourceTime ||
+        (header.indexBytes != 4 && header.indexBytes != 8)) return false;
+    if (header.vertexCount > std::numeric_limits<size_t>::max()/sizeof(Vec3) ||
+        header.triangleCount > std::numeric_limits<size_t>::max()/(3*header.indexBytes)) return false;
+
+    const size_t vertexBytes = size_t(header.vertexCount)*sizeof(Vec3);
+    const size_t indexBytes = size_t(header.triangleCount)*3*header.indexBytes;
+    if (file.size() != sizeof(header) + 2*vertexBytes + indexBytes) return false;
+
+    const uint8_t* p = file.data() + sizeof(header);
+    vertices.resize(size_t(header.vertexCount));
+    normals.resize(size_t(header.vertexCount));
+    indices.resize(size_t(header.triangleCount));
+    memcpy(static_cast<void*>(vertices.data()), p, vertexBytes);
+    memcpy(static_cast<void*>(normals.data()), p+vertexBytes, vertexBytes);
+    p += 2*vertexBytes;
+
+#pragma omp parallel for
+    for (int64_t t = 0;t<int64_t(indices.size());++t) {
+      for (size_t i = 0;i<3;++i) {
+        const size_t offset = (size_t(t)*3+i)*header.indexBytes;
+        if (header.indexBytes == 4) {
+          uint32_t index;
+          memcpy(&index, p+offset, 4);
+          indices[size_t(t)][i] = index;
+        } else {
+          uint64_t index;
+          memcpy(&index, p+offset, 8);
+          indices[size_t(t)][i] = size_t(index);
+        }
+      }
+    }
+    return true;
+  } catch (const MappedFileException&) {
+    return false;
+  }
 }
 
-std::vector<std::string> OBJFile::tokenize(const std::string& str, size_t startpos) {
-  std::vector<std::string> strElements;
-  std::string buf;
-  std::stringstream ss(str.substr(startpos));
-  while (ss >> buf) strElements.push_back(buf);
-  return strElements;
+void OBJFile::saveCache(const std::string& cacheFilename, uint64_t sourceSize, int64_t sourceTime) const {
+  OBJCacheHeader header;
+  memcpy(header.magic, cacheMagic, 4);
+  header.version = cacheVersion;
+  header.sourceSize = sourceSize;
+  header.sourceTime = sourceTime;
+  header.vertexCount = vertices.size();
+  header.triangleCount = indices.size();
+  header.indexBytes = vertices.size() <= std::numeric_limits<uint32_t>::max() ? 4 : 8;
+  header.reserved = 0;
+
+  // the cache is only an optimization, a read only directory just means
+  // parsing again next time
+  std::ofstream file(cacheFilename, std::ios::binary);
+  if (!file) return;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(vertices.data()), std::streamsize(vertices.size()*sizeof(Vec3)));
+  file.write(reinterpret_cast<const char*>(normals.data()), std::streamsize(normals.size()*sizeof(Vec3)));
+  if (header.indexBytes == 4) {
+    std::vector<uint32_t> narrow(indices.size()*3);
+    for (size_t t = 0;t<indices.size();++t) {
+      for (size_t i = 0;i<3;++i) narrow[t*3+i] = uint32_t(indices[t][i]);
+    }
+    file.write(reinterpret_cast<const char*>(narrow.data()), std::streamsize(narrow.size()*sizeof(uint32_t)));
+  } else {
+    std::vector<uint64_t> wide(indices.size()*3);
+    for (size_t t = 0;t<indices.size();++t) {
+      for (size_t i = 0;i<3;++i) wide[t*3+i] = indices[t][i];
+    }
+    file.write(reinterpret_cast<const char*>(wide.data()), std::streamsize(wide.size()*sizeof(uint64_t)));
+  }
+  if (!file) {
+    file.close();
+    std::error_code error;
+    std::filesystem::remove(cacheFilename, error);
+  }
 }
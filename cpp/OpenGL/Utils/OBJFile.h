@@ -3,33 +3,32 @@
 #include <vector>
 #include <array>
 #include <string>
-#include <sstream>
+#include <cstdint>
 
 #include "Vec3.h"
 
+// Triangle mesh of a Wavefront OBJ file. Faces may reference vertices as
+// v, v/vt, v//vn or v/vt/vn, also relative to the end with negative
+// indices, polygons are split into triangle fans. Texture coordinates and
+// file normals are skipped, the normal of a vertex is the normal of the
+// last triangle using it.
+//
+// The file is memory mapped and parsed in chunks of whole lines in
+// parallel. The result is stored next to the file in a binary .objcache
+// that later loads of the unchanged file read instead of parsing.
 class OBJFile {
 public:
-  OBJFile(const std::string& filename, bool normalize=false);
-  
+  OBJFile(const std::string& filename, bool normalize=false, bool useCache=true);
+
   typedef std::array<size_t, 3> IndexType;
 
   std::vector<IndexType> indices;
   std::vector<Vec3> vertices;
   std::vector<Vec3> normals;
-  
-private:
-  void ltrim(std::string &s);
-  void rtrim(std::string &s);
-  void trim(std::string &s);
-  std::vector<std::string> tokenize(const std::string& str, size_t startpos);
-
-  template <typename T> T fromStr(const std::string& str) {
-    T t;
-    std::istringstream iss{str};
-    iss >> std::dec >> t;
-    return t;
-  }
-
 
+private:
+  void parse(const uint8_t* data, size_t size);
+  void computeNormals();
+  bool loadCache(const std::string& cacheFilename, uint64_t sourceSize, int64_t sourceTime);
+  void saveCache(const std::string& cacheFilename, uint64_t sourceSize, int64_t sourceTime) const;
 };
-
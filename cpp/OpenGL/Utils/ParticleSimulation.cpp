@@ -0,0 +1,351 @@
+#include <cmath>
+#include <algorithm>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "CPUFeatures.h"
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+#include "ParticleSimulation.h"
+#include "ColorConversion.h"
+
+// particles are updated and restarted in chunks of this size, small enough
+// to balance the threads and large enough to keep the SIMD loop busy
+static const size_t chunkSize = 4096;
+
+ParticleSimulation::ParticleSimulation(	uint32_t particleCount, std::shared_ptr<StartVolume> starter,
+										const Vec3& initialSpeedMin, const Vec3& initialSpeedMax,
+										const Vec3& acceleration, const Vec3& minPos, const Vec3& maxPos,
+										float maxAge, const Vec3& color, bool autorestart,
+										EruptionType eruptionType, std::shared_ptr<ParticleTerrain> terrain) :
+	posX(particleCount), posY(particleCount), posZ(particleCount),
+	dirX(particleCount), dirY(particleCount), dirZ(particleCount),
+	accX(particleCount, acceleration.x), accY(particleCount, acceleration.y), accZ(particleCount, acceleration.z),
+	colorR(particleCount), colorG(particleCount), colorB(particleCount),
+	opacity(particleCount, 1.0f),
+	age(particleCount, 0.0f),
+	maxAges(particleCount),
+	starter(starter),
+	initialSpeedMin(initialSpeedMin),
+	initialSpeedMax(initialSpeedMax),
+	acceleration(acceleration),
+	minPos(minPos),
+	maxPos(maxPos),
+	color(color),
+	maxAge(maxAge),
+	lastT{0},
+	bounce{true},
+	autorestart{autorestart},
+	eruptionType{eruptionType},
+	terrain{terrain}
+{
+	for (uint32_t i = 0;i<particleCount;++i) {
+		const Vec3 position = starter->getPosition(staticRand);
+		const Vec3 direction = computeDirection(staticRand, 0.0f);
+		const Vec3 c = computeColor(color, staticRand);
+		posX[i] = position.x; posY[i] = position.y; posZ[i] = position.z;
+		dirX[i] = direction.x; dirY[i] = direction.y; dirZ[i] = direction.z;
+		colorR[i] = c.x; colorG[i] = c.y; colorB[i] = c.z;
+		maxAges[i] = autorestart ? maxAge*staticRand.rand01() : 0;
+	}
+}
+
+void ParticleSimulation::update(float t) {
+	const float deltaT = t-lastT;
+	lastT = t;
+
+#ifdef _OPENMP
+	const size_t threadCount = size_t(omp_get_max_threads());
+#else
+	const size_t threadCount = 1;
+#endif
+	while (randoms.size() < threadCount) randoms.push_back(std::make_unique<Random>());
+
+	const size_t particleCount = getParticleCount();
+	const int64_t chunkCount = int64_t((particleCount+chunkSize-1)/chunkSize);
+#pragma omp parallel for schedule(static)
+	for (int64_t c = 0;c<chunkCount;++c) {
+#ifdef _OPENMP
+		Random& random = *randoms[size_t(omp_get_thread_num())];
+#else
+		Random& random = *randoms[0];
+#endif
+		const size_t first = size_t(c)*chunkSize;
+		const size_t last = std::min(first+chunkSize, particleCount);
+		updateRange(first, last, deltaT);
+		if (autorestart) {
+			for (size_t i = first;i<last;++i) {
+				if (age[i] >= maxAges[i]) restartParticle(i, random, t);
+			}
+		}
+	}
+}
+
+void ParticleSimulation::restart(size_t count) {
+	for (size_t i = 0;i<getParticleCount() && count > 0;++i) {
+		if (age[i] >= maxAges[i]) {
+			restartParticle(i, staticRand, lastT);
+			count--;
+		}
+	}
+}
+
+void ParticleSimulation::restartParticle(size_t i, Random& random, float t) {
+	const Vec3 position = starter->getPosition(random);
+	const Vec3 direction = computeDirection(random, t);
+	const Vec3 c = computeColor(color, random);
+	posX[i] = position.x; posY[i] = position.y; posZ[i] = position.z;
+	dirX[i] = direction.x; dirY[i] = direction.y; dirZ[i] = direction.z;
+	accX[i] = acceleration.x; accY[i] = acceleration.y; accZ[i] = acceleration.z;
+	colorR[i] = c.x; colorG[i] = c.y; colorB[i] = c.z;
+	opacity[i] = 1.0f;
+	maxAges[i] = maxAge*random.rand01();
+	age[i] = 0.0f;
+}
+
+void ParticleSimulation::updateRange(size_t first, size_t last, float deltaT) {
+	if (terrain) {
+		for (size_t i = first;i<last;++i) updateOnTerrain(i, deltaT);
+		return;
+	}
+
+	size_t i = first;
+#ifdef CPU_X86
+	if (CPUFeatures::hasAVX2()) i = updateRangeAVX2(first, last, deltaT);
+#endif
+	for (;i<last;++i) updateFlat(i, deltaT);
+}
+
+#ifdef CPU_X86
+SIMD_TARGET_BEGIN_AVX2
+// updates eight particles at a time and returns the first index of the
+// remaining tail
+size_t ParticleSimulation::updateRangeAVX2(size_t first, size_t last, float deltaT) {
+	size_t i = first;
+	const __m256 dt = _mm256_set1_ps(deltaT);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 minusHalf = _mm256_set1_ps(-0.5f);
+	const __m256 minX = _mm256_set1_ps(minPos.x);
+	const __m256 minY = _mm256_set1_ps(minPos.y);
+	const __m256 minZ = _mm256_set1_ps(minPos.z);
+	const __m256 maxX = _mm256_set1_ps(maxPos.x);
+	const __m256 maxY = _mm256_set1_ps(maxPos.y);
+	const __m256 maxZ = _mm256_set1_ps(maxPos.z);
+
+	for (;i+8<=last;i+=8) {
+		const __m256 a = _mm256_add_ps(_mm256_loadu_ps(&age[i]), dt);
+		_mm256_storeu_ps(&age[i], a);
+		const __m256 dead = _mm256_cmp_ps(a, _mm256_loadu_ps(&maxAges[i]), _CMP_GE_OQ);
+		_mm256_storeu_ps(&opacity[i], _mm256_blendv_ps(_mm256_loadu_ps(&opacity[i]), zero, dead));
+		if (_mm256_movemask_ps(dead) == 0xFF) continue;
+
+		const __m256 px = _mm256_loadu_ps(&posX[i]);
+		const __m256 py = _mm256_loadu_ps(&posY[i]);
+		const __m256 pz = _mm256_loadu_ps(&posZ[i]);
+		const __m256 dx = _mm256_loadu_ps(&dirX[i]);
+		const __m256 dy = _mm256_loadu_ps(&dirY[i]);
+		const __m256 dz = _mm256_loadu_ps(&dirZ[i]);
+		__m256 ax = _mm256_loadu_ps(&accX[i]);
+		__m256 ay = _mm256_loadu_ps(&accY[i]);
+		__m256 az = _mm256_loadu_ps(&accZ[i]);
+
+		__m256 nx = _mm256_add_ps(px, _mm256_mul_ps(dx, dt));
+		__m256 ny = _mm256_add_ps(py, _mm256_mul_ps(dy, dt));
+		__m256 nz = _mm256_add_ps(pz, _mm256_mul_ps(dz, dt));
+		const __m256 outX = _mm256_or_ps(_mm256_cmp_ps(nx, minX, _CMP_LT_OQ), _mm256_cmp_ps(nx, maxX, _CMP_GT_OQ));
+		const __m256 outY = _mm256_or_ps(_mm256_cmp_ps(ny, minY, _CMP_LT_OQ), _mm256_cmp_ps(ny, maxY, _CMP_GT_OQ));
+		const __m256 outZ = _mm256_or_ps(_mm256_cmp_ps(nz, minZ, _CMP_LT_OQ), _mm256_cmp_ps(nz, maxZ, _CMP_GT_OQ));
+
+		__m256 ex = dx;
+		__m256 ey = dy;
+		__m256 ez = dz;
+		if (bounce) {
+			// as in updateFlat, hitting a side keeps only the halved and
+			// reversed component of that axis
+			ex = _mm256_blendv_ps(ex, _mm256_mul_ps(ex, minusHalf), outX);
+			ey = _mm256_blendv_ps(ey, zero, outX);
+			ez = _mm256_blendv_ps(ez, zero, outX);
+			ex = _mm256_blendv_ps(ex, zero, outY);
+			ey = _mm256_blendv_ps(ey, _mm256_mul_ps(ey, minusHalf), outY);
+			ez = _mm256_blendv_ps(ez, zero, outY);
+			ex = _mm256_blendv_ps(ex, zero, outZ);
+			ey = _mm256_blendv_ps(ey, zero, outZ);
+			ez = _mm256_blendv_ps(ez, _mm256_mul_ps(ez, minusHalf), outZ);
+			nx = _mm256_add_ps(px, _mm256_mul_ps(ex, dt));
+			ny = _mm256_add_ps(py, _mm256_mul_ps(ey, dt));
+			nz = _mm256_add_ps(pz, _mm256_mul_ps(ez, dt));
+		} else {
+			const __m256 out = _mm256_or_ps(outX, _mm256_or_ps(outY, outZ));
+			const __m256 stop = _mm256_andnot_ps(dead, out);
+			ex = _mm256_blendv_ps(ex, zero, out);
+			ey = _mm256_blendv_ps(ey, zero, out);
+			ez = _mm256_blendv_ps(ez, zero, out);
+			ax = _mm256_blendv_ps(ax, zero, stop);
+			ay = _mm256_blendv_ps(ay, zero, stop);
+			az = _mm256_blendv_ps(az, zero, stop);
+			nx = _mm256_blendv_ps(nx, px, out);
+			ny = _mm256_blendv_ps(ny, py, out);
+			nz = _mm256_blendv_ps(nz, pz, out);
+			_mm256_storeu_ps(&accX[i], ax);
+			_mm256_storeu_ps(&accY[i], ay);
+			_mm256_storeu_ps(&accZ[i], az);
+		}
+
+		// dead particles keep their position and direction
+		_mm256_storeu_ps(&posX[i], _mm256_blendv_ps(nx, px, dead));
+		_mm256_storeu_ps(&posY[i], _mm256_blendv_ps(ny, py, dead));
+		_mm256_storeu_ps(&posZ[i], _mm256_blendv_ps(nz, pz, dead));
+		_mm256_storeu_ps(&dirX[i], _mm256_blendv_ps(_mm256_add_ps(ex, _mm256_mul_ps(ax, dt)), dx, dead));
+		_mm256_storeu_ps(&dirY[i], _mm256_blendv_ps(_mm256_add_ps(ey, _mm256_mul_ps(ay, dt)), dy, dead));
+		_mm256_storeu_ps(&dirZ[i], _mm256_blendv_ps(_mm256_add_ps(ez, _mm256_mul_ps(az, dt)), dz, dead));
+	}
+	return i;
+}
+SIMD_TARGET_END
+#endif
+
+void ParticleSimulation::updateFlat(size_t i, float deltaT) {
+	age[i] += deltaT;
+	if (age[i] >= maxAges[i]) {
+		opacity[i] = 0.0f;
+		return;
+	}
+
+	const Vec3 position{posX[i], posY[i], posZ[i]};
+	Vec3 direction{dirX[i], dirY[i], dirZ[i]};
+	Vec3 nextPosition{position + direction*deltaT};
+
+	if (bounce) {
+		if (nextPosition.x < minPos.x || nextPosition.x > maxPos.x)
+			direction = direction * Vec3(-0.5f,0.0f,0.0f);
+		if (nextPosition.y < minPos.y || nextPosition.y > maxPos.y)
+			direction = direction * Vec3(0.0f,-0.5f,0.0f);
+		if (nextPosition.z < minPos.z || nextPosition.z > maxPos.z)
+			direction = direction * Vec3(0.0f,0.0f,-0.5f);
+		nextPosition = position + direction*deltaT;
+	} else {
+		if (nextPosition.x < minPos.x || nextPosition.x > maxPos.x ||
+			nextPosition.y < minPos.y || nextPosition.y > maxPos.y ||
+			nextPosition.z < minPos.z || nextPosition.z > maxPos.z) {
+			direction = Vec3(0,0,0);
+			accX[i] = accY[i] = accZ[i] = 0.0f;
+			nextPosition = position;
+		}
+	}
+
+	posX[i] = nextPosition.x; posY[i] = nextPosition.y; posZ[i] = nextPosition.z;
+	dirX[i] = direction.x + accX[i]*deltaT;
+	dirY[i] = direction.y + accY[i]*deltaT;
+	dirZ[i] = direction.z + accZ[i]*deltaT;
+}
+
+void ParticleSimulation::updateOnTerrain(size_t i, float deltaT) {
+	age[i] += deltaT;
+	if (age[i] >= maxAges[i]) {
+		opacity[i] = 0.0f;
+		return;
+	}
+
+	const Vec3 position{posX[i], posY[i], posZ[i]};
+	Vec3 direction{dirX[i], dirY[i], dirZ[i]};
+	Vec3 nextPosition{position + direction*deltaT};
+
+	const Vec2 posOverGrid{(nextPosition.x-minPos.x)/(maxPos.x-minPos.x),
+						   (nextPosition.z-minPos.z)/(maxPos.z-minPos.z)};
+	const float gridHeight = terrain->height(posOverGrid);
+
+	if (bounce) {
+		if (nextPosition.x < minPos.x || nextPosition.x > maxPos.x)
+			direction = direction * Vec3(-0.5f,0.0f,0.0f);
+		if (nextPosition.y < gridHeight || nextPosition.y > maxPos.y)
+			direction = direction * Vec3(0.0f,-0.5f,0.0f);
+		if (nextPosition.z < minPos.z || nextPosition.z > maxPos.z)
+			direction = direction * Vec3(0.0f,0.0f,-0.5f);
+		nextPosition = position + direction*deltaT;
+	} else {
+		const float reduceAir = 0.999f;
+		const float reduceHit = 0.4f;
+		if (nextPosition.x < minPos.x || nextPosition.x > maxPos.x ||
+			nextPosition.y < gridHeight || nextPosition.y > maxPos.y ||
+			nextPosition.z < minPos.z || nextPosition.z > maxPos.z) {
+			const Vec3 n = terrain->normal(posOverGrid);
+			direction = (Vec3::reflect(direction, n))*reduceHit;
+			nextPosition = position + direction * deltaT;
+		}
+		direction = direction * reduceAir;
+	}
+
+	posX[i] = nextPosition.x; posY[i] = nextPosition.y; posZ[i] = nextPosition.z;
+	dirX[i] = direction.x + accX[i]*deltaT;
+	dirY[i] = direction.y + accY[i]*deltaT;
+	dirZ[i] = direction.z + accZ[i]*deltaT;
+}
+
+void ParticleSimulation::getData(float* target) const {
+	const int64_t particleCount = int64_t(getParticleCount());
+#pragma omp parallel for schedule(static)
+	for (int64_t i = 0;i<particleCount;++i) {
+		float* p = target + i*7;
+		p[0] = posX[size_t(i)];
+		p[1] = posY[size_t(i)];
+		p[2] = posZ[size_t(i)];
+		if (colorR[size_t(i)] == RAINBOW_COLOR.x) {
+			const Vec3 c = ColorConversion::hsvToRgb<float>({age[size_t(i)]*100,1.0,1.0});
+			p[3] = c.x;
+			p[4] = c.y;
+			p[5] = c.z;
+		} else {
+			p[3] = colorR[size_t(i)];
+			p[4] = colorG[size_t(i)];
+			p[5] = colorB[size_t(i)];
+		}
+		p[6] = opacity[size_t(i)];
+	}
+}
+
+void ParticleSimulation::setColor(const Vec3& color) {
+	if (this->color != color) {
+		this->color = color;
+		for (size_t i = 0;i<getParticleCount();++i) {
+			const Vec3 c = computeColor(color, staticRand);
+			colorR[i] = c.x; colorG[i] = c.y; colorB[i] = c.z;
+		}
+	}
+}
+
+void ParticleSimulation::setAcceleration(const Vec3& acceleration) {
+	this->acceleration = acceleration;
+	std::fill(accX.begin(), accX.end(), acceleration.x);
+	std::fill(accY.begin(), accY.end(), acceleration.y);
+	std::fill(accZ.begin(), accZ.end(), acceleration.z);
+}
+
+Vec3 ParticleSimulation::computeColor(const Vec3& c, Random& random) {
+	if (c == RANDOM_COLOR)
+		return Vec3::random(random);
+	else
+		return c;
+}
+
+Vec3 ParticleSimulation::computeDirection(Random& random, float t) const {
+	float radius = 1.0f;
+
+	switch (eruptionType) {
+		case DefaultEruption:
+			return initialSpeedMin + (initialSpeedMax - initialSpeedMin) * Vec3{ random.rand01(),random.rand01(),random.rand01() };
+		case SmoothEruption:
+			radius = (initialSpeedMax - initialSpeedMin).length() * (0.6f + 0.4f * random.rand01()) * 0.15f;
+			return Vec3::randomPointInSphere(random) * radius + Vec3{ 0.0f, 0.15f, 0.0f };
+		case MagicChaoticVulcano:
+			radius = (initialSpeedMax - initialSpeedMin).length() * (0.6f + 0.4f * random.rand01()) * 0.1f;
+			return Vec3::randomPointInSphere(random) * radius + Vec3{ 0.04f * cosf(floorf(t * 3.5f) * 10.0f),
+																	  0.05f + 0.2f * (1.2f + cosf(floorf(t * 13.0f))) *
+																	  0.2f * random.rand01(),
+																	  0.04f * sinf(floorf(t * 4.0f) * 20.0f) };
+	}
+	return { 0,0,0 };
+}
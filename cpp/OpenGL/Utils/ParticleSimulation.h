@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "Vec2.h"
+#include "Vec3.h"
+#include "Rand.h"
+
+const Vec3 RANDOM_COLOR{-1.0f,-1.0f,-1.0f};
+const Vec3 RAINBOW_COLOR{-2.0f,-2.0f,-2.0f};
+
+class StartVolume {
+public:
+	virtual ~StartVolume() {}
+	Vec3 getPosition() const {return getPosition(staticRand);}
+	// restarts run in parallel, each thread passes its own generator
+	virtual Vec3 getPosition(Random& random) const = 0;
+};
+
+class SphereStart : public StartVolume {
+public:
+	SphereStart(const Vec3& center, float radius) : center(center), radius(radius) {}
+	virtual ~SphereStart() {}
+	void setStart(const Vec3& center, float radius) {
+		this->center = center;
+		this->radius = radius;
+	}
+	using StartVolume::getPosition;
+	virtual Vec3 getPosition(Random& random) const {
+		return center+Vec3::randomPointInSphere(random)*radius;
+	}
+private:
+	Vec3 center;
+	float radius;
+};
+
+class BrickStart : public StartVolume {
+public:
+	BrickStart(const Vec3& center, const Vec3& extend) : center(center), extend(extend) {}
+	virtual ~BrickStart() {}
+	void setStart(const Vec3& center, const Vec3& extend) {
+		this->center = center;
+		this->extend = extend;
+	}
+	using StartVolume::getPosition;
+	virtual Vec3 getPosition(Random& random) const {
+		return center-extend/2.0+Vec3(random.rand01(),random.rand01(),random.rand01())*extend;
+	}
+private:
+	Vec3 center;
+	Vec3 extend;
+};
+
+// ground the particles collide with instead of the lower bound, sampled
+// over the xz-extent of the bounds mapped to [0,1]
+class ParticleTerrain {
+public:
+	virtual ~ParticleTerrain() {}
+	virtual float height(const Vec2& pos) const = 0;
+	virtual Vec3 normal(const Vec2& pos) const = 0;
+};
+
+enum EruptionType {DefaultEruption, SmoothEruption, MagicChaoticVulcano};
+
+// The particles of a ParticleSystem without any OpenGL, stored as one
+// array per attribute. Particles are updated in chunks in parallel, eight
+// at a time if the terrain is flat and the CPU has AVX2, and dead particles are
+// restarted with one random generator per thread.
+class ParticleSimulation {
+public:
+	ParticleSimulation(	uint32_t particleCount, std::shared_ptr<StartVolume> starter,
+						const Vec3& initialSpeedMin, const Vec3& initialSpeedMax,
+						const Vec3& acceleration, const Vec3& minPos, const Vec3& maxPos,
+						float maxAge, const Vec3& color=RANDOM_COLOR,
+						bool autorestart=true, EruptionType eruptionType=DefaultEruption,
+						std::shared_ptr<ParticleTerrain> terrain=nullptr);
+
+	void update(float t);
+	void restart(size_t count);
+
+	void setEruptionType(EruptionType eruptionType) {this->eruptionType = eruptionType;}
+	EruptionType getEruptionType() const {return eruptionType;}
+	void setStarter(const std::shared_ptr<StartVolume> starter) {this->starter = starter;}
+	void setColor(const Vec3& color);
+	void setBounce(bool bounce) {this->bounce = bounce;}
+	void setAcceleration(const Vec3& acceleration);
+	void setMaxAge(float maxAge) {this->maxAge = maxAge;}
+	void setInitialSpeed(const Vec3& initialSpeedMin, const Vec3& initialSpeedMax) {
+		this->initialSpeedMin = initialSpeedMin;
+		this->initialSpeedMax = initialSpeedMax;
+	}
+	void setAutoRestart(bool autorestart) {this->autorestart = autorestart;}
+	bool getAutoRestart() const {return autorestart;}
+
+	size_t getParticleCount() const {return posX.size();}
+	// writes position, color and opacity of every particle, 7 floats each
+	void getData(float* target) const;
+
+	static Vec3 computeColor(const Vec3& c, Random& random);
+
+private:
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> dirX, dirY, dirZ;
+	std::vector<float> accX, accY, accZ;
+	std::vector<float> colorR, colorG, colorB;
+	std::vector<float> opacity;
+	std::vector<float> age;
+	std::vector<float> maxAges;
+
+	std::shared_ptr<StartVolume> starter;
+	Vec3 initialSpeedMin;
+	Vec3 initialSpeedMax;
+	Vec3 acceleration;
+	Vec3 minPos;
+	Vec3 maxPos;
+	Vec3 color;
+	float maxAge;
+	float lastT;
+	bool bounce;
+	bool autorestart;
+	EruptionType eruptionType;
+	std::shared_ptr<ParticleTerrain> terrain;
+	std::vector<std::unique_ptr<Random>> randoms;
+
+	void updateRange(size_t first, size_t last, float deltaT);
+	size_t updateRangeAVX2(size_t first, size_t last, float deltaT);
+	void updateFlat(size_t i, float deltaT);
+	void updateOnTerrain(size_t i, float deltaT);
+	void restartParticle(size_t i, Random& random, float t);
+	Vec3 computeDirection(Random& random, float t) const;
+};
@@ -7,78 +7,7 @@
 
 #include "Rand.h"
 #include "Grid2D.h"
-
-class StartVolume {
-public:
-	virtual Vec3 getPosition() const = 0;
-};
-
-class SphereStart : public StartVolume {
-public:
-	SphereStart(const Vec3& center, float radius) : center(center), radius(radius) {}
-	virtual ~SphereStart() {}
-	void setStart(const Vec3& center, float radius) {
-		this->center = center;
-		this->radius = radius;
-	}
-	virtual Vec3 getPosition() const {
-		return center+Vec3::randomPointInSphere()*radius;
-	}
-private:
-	Vec3 center;
-	float radius;
-};
-
-class BrickStart : public StartVolume {
-public:
-	BrickStart(const Vec3& center, const Vec3& extend) : center(center), extend(extend) {}
-	virtual ~BrickStart() {}
-	void setStart(const Vec3& center, const Vec3& extend) {
-		this->center = center;
-		this->extend = extend;
-	}
-	virtual Vec3 getPosition() const {
-		return center-extend/2.0+Vec3(staticRand.rand01(),staticRand.rand01(),staticRand.rand01())*extend;
-	}
-private:
-	Vec3 center;
-	Vec3 extend;
-};
-
-
-class Particle {
-public:
-	Particle(const Vec3& position, const Vec3& direction, const Vec3& acceleration, 
-			 const Vec3& color, float opacity, float maxAge, 
-			 const Vec3& minPos, const Vec3& maxPos, bool bounce, std::shared_ptr<Grid2D> grid);
-	
-	void update(float deltaT);
-	void restart(const Vec3& position, const Vec3& direction, const Vec3& acceleration, 
-				 const Vec3& color, float opacity, float maxAge);
-	bool isDead() const {return age >= maxAge;};
-	void setBounce(bool bounce);
-	void setColor(const Vec3& color) {this->color = color;}
-	void setAcceleration(const Vec3& acceleration) {this->acceleration = acceleration;}
-	
-	std::vector<float> getData() const;
-	
-private:
-	Vec3 position;
-	Vec3 direction;
-	Vec3 acceleration;
-	Vec3 color;
-	float opacity;
-	bool bounce;
-	
-	float maxAge;
-	float age;
-	
-	Vec3 minPos;
-	Vec3 maxPos;
-    std::shared_ptr<Grid2D> grid;
-};
-
-enum EruptionType {DefaultEruption, SmoothEruption, MagicChaoticVulcano};
+#include "ParticleSimulation.h"
 
 class ParticleSystem : public AbstractParticleSystem {
 public:
@@ -90,48 +19,33 @@ public:
                     std::shared_ptr<Grid2D> grid=nullptr);
 
   virtual ~ParticleSystem() {}
-	void update(float t);
+	void update(float t) {simulation.update(t);}
 	
-    void setEruptionType(EruptionType eruptionType) {this->eruptionType = eruptionType;}
-    EruptionType getEruptionType() const {return eruptionType;}
+    void setEruptionType(EruptionType eruptionType) {simulation.setEruptionType(eruptionType);}
+    EruptionType getEruptionType() const {return simulation.getEruptionType();}
     
-	void setStarter(const std::shared_ptr<StartVolume> starter);
+	void setStarter(const std::shared_ptr<StartVolume> starter) {simulation.setStarter(starter);}
 	
-	void setColor(const Vec3& color);
+	void setColor(const Vec3& color) {simulation.setColor(color);}
 		
-	void restart(size_t count);
+	void restart(size_t count) {simulation.restart(count);}
 	
-	void setBounce(bool bounce);
-	void setAcceleration(const Vec3& acceleration);
-	void setMaxAge(float maxAge) {this->maxAge = maxAge;}
+	void setBounce(bool bounce) {simulation.setBounce(bounce);}
+	void setAcceleration(const Vec3& acceleration) {simulation.setAcceleration(acceleration);}
+	void setMaxAge(float maxAge) {simulation.setMaxAge(maxAge);}
 	void setInitialSpeed(const Vec3& initialSpeedMin, const Vec3& initialSpeedMax) {
-		this->initialSpeedMin = initialSpeedMin;
-		this->initialSpeedMax = initialSpeedMax;
+		simulation.setInitialSpeed(initialSpeedMin, initialSpeedMax);
 	}
 	
 	virtual std::vector<float> getData() const;
-	virtual size_t getParticleCount() const {return particles.size();}
+	virtual void fillData(float* target) const {simulation.getData(target);}
+	virtual size_t getParticleCount() const {return simulation.getParticleCount();}
 
-    void setAutoRestart(bool autorestart) {this->autorestart = autorestart;}
-    bool getAutoRestart() const {return autorestart;}
+    void setAutoRestart(bool autorestart) {simulation.setAutoRestart(autorestart);}
+    bool getAutoRestart() const {return simulation.getAutoRestart();}
 
 private:
 	ParticleSystem(const ParticleSystem&);
 	
-	std::shared_ptr<StartVolume> starter;
-	Vec3 initialSpeedMin;
-	Vec3 initialSpeedMax;
-	std::vector<Particle> particles;
-		
-	Vec3 acceleration;
-	
-	Vec3 color;
-	float maxAge;
-	float lastT;
-    bool autorestart;
-    std::shared_ptr<Grid2D> grid;
-    EruptionType eruptionType;
-
-	Vec3 computeStart() const;
-	Vec3 computeDirection() const;
+	ParticleSimulation simulation;
 };
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cmath>
+
 #include "Vec3.h"
+#include "Vec4.h"
 #include "Mat4.h"
 
 class Quaternion {
@@ -33,6 +36,33 @@ public:
     w(other.w)
   {}
 
+  explicit Quaternion(const Vec4& v) :
+    x(v.x),
+    y(v.y),
+    z(v.z),
+    w(v.w)
+  {}
+
+  Vec4 toVec4() const {
+    return {x, y, z, w};
+  }
+
+  // spherical interpolation along the shorter arc, the result has unit
+  // length, VecArray::slerp interpolates many at once
+  static Quaternion slerp(const Quaternion& a, const Quaternion& b, float t) {
+    const Vec4 qa = Vec4::normalize(a.toVec4());
+    Vec4 qb = Vec4::normalize(b.toVec4());
+    float d = Vec4::dot(qa, qb);
+    if (d < 0.0f) {
+      qb = qb * -1.0f;
+      d = -d;
+    }
+    if (d > 0.9995f) return Quaternion{Vec4::normalize(qa*(1.0f-t) + qb*t)};
+    const float theta = std::acos(d);
+    const float s = std::sin(theta);
+    return Quaternion{qa*(std::sin((1.0f-t)*theta)/s) + qb*(std::sin(t*theta)/s)};
+  }
+
   Mat4 computeRotation() const {
     float n, s;
     float xs, ys, zs;
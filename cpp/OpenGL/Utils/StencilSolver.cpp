@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+#include "CPUFeatures.h"
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+#include "StencilSolver.h"
+
+// the AVX2 rows have to give the same heights as the scalar rows, so no
+// multiply and add in this file is fused into an FMA, whatever the flags
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace {
+  // tiles of the blocked steps, with a ghost zone of four cells the
+  // buffers of a thread stay well inside the L2 cache
+  const size_t tileWidth = 256;
+  const size_t tileHeight = 64;
+
+#ifdef CPU_X86
+SIMD_TARGET_BEGIN_AVX2
+  // the leading multiple of eight cells of updateRow, returns the first
+  // cell left over
+  size_t updateRowAVX2(float* out, const float* c, const float* above, const float* below,
+                       const float* past, size_t count, float neighbourWeight, float centerWeight) {
+    size_t i = 0;
+    const __m256 n = _mm256_set1_ps(neighbourWeight);
+    const __m256 w = _mm256_set1_ps(centerWeight);
+    for (;i+8<=count;i += 8) {
+      const __m256 sum = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(c+i+1),
+                                                                   _mm256_loadu_ps(c+i-1)),
+                                                     _mm256_loadu_ps(below+i)),
+                                       _mm256_loadu_ps(above+i));
+      __m256 v = _mm256_add_ps(_mm256_mul_ps(n, sum), _mm256_mul_ps(w, _mm256_loadu_ps(c+i)));
+      if (past) v = _mm256_sub_ps(v, _mm256_loadu_ps(past+i));
+      _mm256_storeu_ps(out+i, v);
+    }
+    return i;
+  }
+SIMD_TARGET_END
+#endif
+
+  // out = neighbourWeight*(c[+1]+c[-1]+below+above) + centerWeight*c - past,
+  // past may be null
+  void updateRow(float* out, const float* c, const float* above, const float* below,
+                 const float* past, size_t count, float neighbourWeight, float centerWeight) {
+    size_t i = 0;
+#ifdef CPU_X86
+    if (CPUFeatures::hasAVX2())
+      i = updateRowAVX2(out, c, above, below, past, count, neighbourWeight, centerWeight);
+#endif
+    for (;i<count;++i) {
+      const float v = neighbourWeight * (c[i+1]+c[i-1]+below[i]+above[i]) + centerWeight * c[i];
+      out[i] = past ? v - past[i] : v;
+    }
+  }
+
+  void colorizeRow(uint8_t* pixels, size_t componentCount, const float* values, size_t count,
+                   float colorScale) {
+    for (size_t i = 0;i<count;++i) {
+      const float v = values[i]*colorScale;
+      pixels[0] = v > 0 ? uint8_t(std::min(v, 255.0f)) : 0;
+      pixels[1] = v < 0 ? uint8_t(std::min(-v, 255.0f)) : 0;
+      pixels[2] = 0;
+      pixels += componentCount;
+    }
+  }
+
+  void copyRows(float* target, size_t targetStride, const float* source, size_t sourceStride,
+                size_t width, size_t rows) {
+    for (size_t r = 0;r<rows;++r)
+      std::memcpy(target+r*targetStride, source+r*sourceStride, width*sizeof(float));
+  }
+}
+
+StencilSolver::StencilSolver(size_t width, size_t height, float factor,
+                             Equation equation, size_t blockDepth) :
+  width{width},
+  height{height},
+  halo{std::max<size_t>(blockDepth, 1)},
+  stride{width+2*halo},
+  neighbourWeight{factor},
+  centerWeight{equation == Equation::Wave ? 2.0f-4.0f*factor : 1.0f-4.0f*factor},
+  wave{equation == Equation::Wave}
+{
+  if (width < halo || height < halo)
+    throw std::runtime_error("StencilSolver grid is smaller than the block depth");
+
+  const size_t size = stride*(height+2*halo);
+  current.resize(size, 0.0f);
+  nextCurrent.resize(size, 0.0f);
+  if (wave) {
+    last.resize(size, 0.0f);
+    nextLast.resize(size, 0.0f);
+  }
+}
+
+void StencilSolver::fill(float value) {
+  std::fill(current.begin(), current.end(), value);
+  std::fill(last.begin(), last.end(), value);
+}
+
+void StencilSolver::step(size_t count) {
+  step(count, nullptr, 0, 0.0f);
+}
+
+void StencilSolver::step(size_t count, Image& image, float colorScale) {
+  if (image.width != width || image.height != height || image.componentCount < 3)
+    throw std::runtime_error("StencilSolver needs an RGB image of the grid size");
+  step(count, image.data.data(), image.componentCount, colorScale);
+}
+
+void StencilSolver::step(size_t count, uint8_t* pixels, size_t componentCount, float colorScale) {
+  while (count > 0) {
+    const size_t depth = std::min(count, halo);
+    count -= depth;
+    uint8_t* target = count == 0 ? pixels : nullptr;
+    refreshHalo(current);
+    if (depth == 1) {
+      singleStep(target, componentCount, colorScale);
+    } else {
+      if (wave) refreshHalo(last);
+      blockedSteps(depth, target, componentCount, colorScale);
+    }
+  }
+}
+
+void StencilSolver::refreshHalo(std::vector<float>& level) const {
+  for (size_t y = halo;y<height+halo;++y) {
+    float* row = level.data() + y*stride;
+    std::memcpy(row, row+width, halo*sizeof(float));
+    std::memcpy(row+width+halo, row+halo, halo*sizeof(float));
+  }
+  copyRows(level.data(), stride, level.data()+height*stride, stride, stride, halo);
+  copyRows(level.data()+(height+halo)*stride, stride, level.data()+halo*stride, stride, stride, halo);
+}
+
+void StencilSolver::singleStep(uint8_t* pixels, size_t componentCount, float colorScale) {
+  const int64_t rows = int64_t(height);
+#pragma omp parallel for schedule(static)
+  for (int64_t y = 0;y<rows;++y) {
+    const size_t i = index(0, size_t(y));
+    updateRow(nextCurrent.data()+i, current.data()+i, current.data()+i-stride,
+              current.data()+i+stride, wave ? last.data()+i : nullptr, width,
+              neighbourWeight, centerWeight);
+    if (pixels)
+      colorizeRow(pixels + size_t(y)*width*componentCount, componentCount,
+                  nextCurrent.data()+i, width, colorScale);
+  }
+
+  if (wave) std::swap(last, current);
+  std::swap(current, nextCurrent);
+}
+
+void StencilSolver::blockedSteps(size_t depth, uint8_t* pixels, size_t componentCount, float colorScale) {
+  const size_t tilesX = (width+tileWidth-1)/tileWidth;
+  const size_t tilesY = (height+tileHeight-1)/tileHeight;
+  const int64_t tileCount = int64_t(tilesX*tilesY);
+  const size_t localStride = tileWidth+2*depth;
+
+#pragma omp parallel
+  {
+    std::vector<float> a(localStride*(tileHeight+2*depth));
+    std::vector<float> b(a.size());
+    std::vector<float> c(a.size());
+
+#pragma omp for schedule(static)
+    for (int64_t t = 0;t<tileCount;++t) {
+      const size_t x0 = (size_t(t) % tilesX)*tileWidth;
+      const size_t y0 = (size_t(t) / tilesX)*tileHeight;
+      const size_t tw = std::min(tileWidth, width-x0);
+      const size_t th = std::min(tileHeight, height-y0);
+      const size_t localWidth = tw+2*depth;
+      const size_t localHeight = th+2*depth;
+
+      // level s is valid in the local buffers up to depth-s cells around
+      // the tile, so every step shrinks the updated area by one cell
+      float* past = a.data();
+      float* now = b.data();
+      float* next = c.data();
+      const size_t origin = index(x0, y0) - depth*stride - depth;
+      copyRows(now, localStride, current.data()+origin, stride, localWidth, localHeight);
+      if (wave) copyRows(past, localStride, last.data()+origin, stride, localWidth, localHeight);
+
+      for (size_t s = 1;s<=depth;++s) {
+        for (size_t r = s;r<localHeight-s;++r) {
+          const size_t i = r*localStride + s;
+          updateRow(next+i, now+i, now+i-localStride, now+i+localStride,
+                    wave ? past+i : nullptr, localWidth-2*s, neighbourWeight, centerWeight);
+          if (pixels && s == depth)
+            colorizeRow(pixels + ((y0+r-depth)*width + x0)*componentCount, componentCount,
+                        next+i, tw, colorScale);
+        }
+        std::swap(past, now);
+        std::swap(now, next);
+      }
+
+      const size_t inner = depth*localStride + depth;
+      copyRows(nextCurrent.data()+index(x0, y0), stride, now+inner, localStride, tw, th);
+      if (wave) copyRows(nextLast.data()+index(x0, y0), stride, past+inner, localStride, tw, th);
+    }
+  }
+
+  if (wave) std::swap(last, nextLast);
+  std::swap(current, nextCurrent);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Image.h"
+
+// Explicit five point stencil on a periodic grid of floats, for the wave
+// equation
+//   next = factor*(left+right+top+bottom) + (2-4*factor)*current - last
+// with factor = c^2*dt^2/dx^2, and for the diffusion equation
+//   next = factor*(left+right+top+bottom) + (1-4*factor)*current
+// with factor = k*dt/dx^2. The levels are stored with a halo of
+// blockDepth cells around them that mirrors the opposite border, so the
+// rows are updated without any wraparound. Several steps are run per pass
+// over memory: each tile of the grid copies itself with a ghost zone of
+// one cell per step into thread local buffers and steps there, the tiles
+// run in parallel with OpenMP. The rows are updated eight cells at a time
+// with AVX2 where available.
+class StencilSolver {
+public:
+  enum class Equation {Wave, Diffusion};
+
+  // throws std::runtime_error if the grid is smaller than blockDepth
+  StencilSolver(size_t width, size_t height, float factor,
+                Equation equation=Equation::Wave, size_t blockDepth=4);
+
+  size_t getWidth() const {return width;}
+  size_t getHeight() const {return height;}
+
+  // the current level
+  float getValue(size_t x, size_t y) const {return current[index(x,y)];}
+  void setValue(size_t x, size_t y, float value) {current[index(x,y)] = value;}
+  void fill(float value);
+
+  void step(size_t count=1);
+
+  // runs count steps, the last one also writes positive values scaled by
+  // colorScale to the red and negative ones to the green channel of image,
+  // saturating at 255, blue is set to zero
+  void step(size_t count, Image& image, float colorScale);
+  // the same for interleaved pixels of componentCount >= 3 bytes each
+  void step(size_t count, uint8_t* pixels, size_t componentCount, float colorScale);
+
+private:
+  size_t width;
+  size_t height;
+  size_t halo;
+  size_t stride;
+  float neighbourWeight;
+  float centerWeight;
+  bool wave;
+
+  std::vector<float> last;
+  std::vector<float> current;
+  std::vector<float> nextLast;
+  std::vector<float> nextCurrent;
+
+  size_t index(size_t x, size_t y) const {return (y+halo)*stride + x+halo;}
+
+  void refreshHalo(std::vector<float>& level) const;
+  void singleStep(uint8_t* pixels, size_t componentCount, float colorScale);
+  void blockedSteps(size_t depth, uint8_t* pixels, size_t componentCount, float colorScale);
+};
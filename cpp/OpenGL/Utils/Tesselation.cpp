@@ -1,10 +1,16 @@
 #include <cmath>
 #include <iostream>
+#include <algorithm>
 
 #include "Vec2.h"
+#include "VecArray.h"
+#include "MeshOptimizer.h"
 
 constexpr float PI = 3.14159265358979323846f;
 
+// below this many vertices starting the threads costs more than it saves
+static const size_t parallelVertexCount{size_t(1) << 14};
+
 #include "Tesselation.h"
 
 Tesselation Tesselation::genSphere(const Vec3& center, const float radius, const uint32_t sectorCount, const uint32_t stackCount) {
@@ -14,69 +20,91 @@ Tesselation Tesselation::genSphere(const Vec3& center, const float radius, const
 	const float sectorStep{2.0f * PI / sectorCount};
 	const float stackStep{PI / stackCount};
 
-	for(uint32_t i = 0; i <= stackCount; ++i) {
+	// the tangents of a stack are computed in one batch
+	const size_t rowSize = sectorCount+1;
+	tess.vertices.resize(rowSize*(stackCount+1)*3);
+	tess.normals.resize(rowSize*(stackCount+1)*3);
+	tess.tangents.resize(rowSize*(stackCount+1)*3);
+	tess.texCoords.resize(rowSize*(stackCount+1)*2);
+
+#pragma omp parallel if (rowSize*(stackCount+1) >= parallelVertexCount)
+	{
+	Vec3Array n{rowSize};
+	Vec3Array t{rowSize};
+	Vec3Array b{rowSize};
+
+#pragma omp for
+	for(int64_t i = 0; i <= int64_t(stackCount); ++i) {
 		const float stackAngle{PI / 2.0f - i * stackStep};       // starting from pi/2 to -pi/2
 		const float xy{radius * cosf(stackAngle)};             // r * cos(u)
 		const float z{radius * sinf(stackAngle)};              // r * sin(u)
+		const size_t row = i * rowSize;
 
 		// add (sectorCount+1) vertices per stack
 		// the first and last vertices have same position and normal, but different tex coords
 		for(uint32_t j = 0; j <= sectorCount; ++j){
 			const float sectorAngle{j * sectorStep};           // starting from 0 to 2pi
+			const size_t v = row + j;
 
 			// vertex position (x, y, z)
 			const float x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
 			const float y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
-			tess.vertices.push_back(center.x + x);
-			tess.vertices.push_back(center.y + y);
-			tess.vertices.push_back(center.z + z);
+			tess.vertices[v*3+0] = center.x + x;
+			tess.vertices[v*3+1] = center.y + y;
+			tess.vertices[v*3+2] = center.z + z;
 
 			// normalized vertex normal (nx, ny, nz)
-			tess.normals.push_back(x * lengthInv);
-			tess.normals.push_back(y * lengthInv);
-			tess.normals.push_back(z * lengthInv);
+			tess.normals[v*3+0] = x * lengthInv;
+			tess.normals[v*3+1] = y * lengthInv;
+			tess.normals[v*3+2] = z * lengthInv;
 
 			const float nextSectorAngle{(j+1) * sectorStep};
 			const float nx = xy * cosf(nextSectorAngle);
 			const float ny = xy * sinf(nextSectorAngle);
-			
-			// compute the tangent an make sure it is perpendicular to the normal
-			Vec3 n{x * lengthInv, y * lengthInv,z * lengthInv};
-			Vec3 t{Vec3::normalize(Vec3{nx,ny,z}-Vec3{x,y,z})};
-			Vec3 b{Vec3::cross(n,t)};
-			Vec3 tCorr{Vec3::cross(b,n)};
-					
-			// normalized vertex tangent (tx, ty, tz)
-			tess.tangents.push_back(tCorr.x);
-			tess.tangents.push_back(tCorr.y);
-			tess.tangents.push_back(tCorr.z);
-			
+			n.set(j, Vec3{x * lengthInv, y * lengthInv, z * lengthInv});
+			t.set(j, Vec3{nx,ny,z}-Vec3{x,y,z});
+
 			// vertex tex coord (s, t) range between [0, 1]
-			tess.texCoords.push_back((float)j / sectorCount);
-			tess.texCoords.push_back(1.0f-(float)i / stackCount);
+			tess.texCoords[v*2+0] = (float)j / sectorCount;
+			tess.texCoords[v*2+1] = 1.0f-(float)i / stackCount;
 		}
+
+		// compute the tangent an make sure it is perpendicular to the normal
+		VecArray::normalize(t, t);
+		VecArray::cross(n, t, b);
+		VecArray::cross(b, n, t);
+		t.toInterleaved(&tess.tangents[row*3]);
+	}
 	}
 	
-	
+	// the first and last stacks have one triangle per sector, the others two
+	const size_t lastStack = stackCount > 0 ? stackCount-1 : 0;
+	const auto firstIndex = [&](size_t i) {
+		return size_t(3) * sectorCount * ((i > 0 ? i-1 : 0) + std::min(i, lastStack));
+	};
+	tess.indices.resize(firstIndex(stackCount));
+
 	// generate CCW index list of sphere triangles
-	for(uint32_t i = 0; i < stackCount; ++i) {
-		uint32_t k1 = i * (sectorCount + 1);     // beginning of current stack
+#pragma omp parallel for if (tess.indices.size() >= parallelVertexCount)
+	for(int64_t i = 0; i < int64_t(stackCount); ++i) {
+		uint32_t k1 = uint32_t(i) * (sectorCount + 1);     // beginning of current stack
 		uint32_t k2 = k1 + sectorCount + 1;      // beginning of next stack
+		uint32_t* index = tess.indices.data() + firstIndex(size_t(i));
 
 		for(uint32_t j = 0; j < sectorCount; ++j, ++k1, ++k2) {
 			// 2 triangles per sector excluding first and last stacks
 			// k1 => k2 => k1+1
 			if(i != 0) {
-				tess.indices.push_back(k1);
-				tess.indices.push_back(k2);
-				tess.indices.push_back(k1 + 1);
+				*index++ = k1;
+				*index++ = k2;
+				*index++ = k1 + 1;
 			}
 
 			// k1+1 => k2 => k2+1
-			if(i != (stackCount-1)){
-				tess.indices.push_back(k1 + 1);
-				tess.indices.push_back(k2);
-				tess.indices.push_back(k2 + 1);
+			if(i != int64_t(lastStack)){
+				*index++ = k1 + 1;
+				*index++ = k2;
+				*index++ = k2 + 1;
 			}
 		}
 	}
@@ -105,9 +133,10 @@ Tesselation Tesselation::genGrid(const Vec3& center, const float width,
   grid.tangents = std::vector<float>(vertCount*3);
   grid.texCoords = std::vector<float>(vertCount*2);
 
-  for (size_t y = 0;y<subDivV+1;++y){
+#pragma omp parallel for if (vertCount >= parallelVertexCount)
+  for (int64_t y = 0;y<int64_t(subDivV)+1;++y){
     for (size_t x = 0;x<subDivU+1;++x){
-      const size_t i{x + y * (subDivU+1)};
+      const size_t i{x + size_t(y) * (subDivU+1)};
       float normX{float(x) / subDivU};
       float normY{float(y) / subDivV};
 
@@ -130,10 +159,11 @@ Tesselation Tesselation::genGrid(const Vec3& center, const float width,
 
   grid.indices = std::vector<uint32_t>(indCount);
   
-  for (size_t y = 0;y<subDivV;++y){
+#pragma omp parallel for if (vertCount >= parallelVertexCount)
+  for (int64_t y = 0;y<int64_t(subDivV);++y){
     for (size_t x = 0;x<subDivU;++x){
-      const size_t i{x + y * subDivU};
-      const size_t j{x + y * (subDivU+1)};
+      const size_t i{x + size_t(y) * subDivU};
+      const uint32_t j{uint32_t(x + size_t(y) * (subDivU+1))};
       
       grid.indices[i*6+0] = j;
       grid.indices[i*6+1] = j+1;
@@ -393,10 +423,19 @@ Tesselation Tesselation::genTorus(const Vec3 &center, float majorRadius,
                                   uint32_t minorSteps) {
 	Tesselation tess{};
 
-	for (uint32_t x = 0; x <= majorSteps; x++) {
+	const size_t rowSize = minorSteps+1;
+	const size_t vertexCount = (majorSteps+1)*rowSize;
+	tess.vertices.resize(vertexCount*3);
+	tess.normals.resize(vertexCount*3);
+	tess.tangents.resize(vertexCount*3);
+	tess.texCoords.resize(vertexCount*2);
+
+#pragma omp parallel for if (vertexCount >= parallelVertexCount)
+	for (int64_t x = 0; x <= int64_t(majorSteps); x++) {
 		const float phi = (2.0f * PI * x) / majorSteps;
 		for (uint32_t y = 0; y <= minorSteps; y++) {
 			const float theta = (2.0f * PI * y) / minorSteps;
+			const size_t v = size_t(x)*rowSize + y;
 
 			const Vec3 vertice{(majorRadius + minorRadius*std::cos(theta))*std::cos(phi),
 					   (majorRadius + minorRadius*std::cos(theta))*std::sin(phi),
@@ -408,33 +447,38 @@ Tesselation Tesselation::genTorus(const Vec3 &center, float majorRadius,
                          static_cast<float>(y)/static_cast<float>(minorSteps)};
 
 
-			tess.vertices.push_back(vertice.x + center.x);
-			tess.vertices.push_back(vertice.y + center.y);
-			tess.vertices.push_back(vertice.z + center.z);
+			tess.vertices[v*3+0] = vertice.x + center.x;
+			tess.vertices[v*3+1] = vertice.y + center.y;
+			tess.vertices[v*3+2] = vertice.z + center.z;
 
-			tess.normals.push_back(normal.x);
-			tess.normals.push_back(normal.y);
-			tess.normals.push_back(normal.z);
+			tess.normals[v*3+0] = normal.x;
+			tess.normals[v*3+1] = normal.y;
+			tess.normals[v*3+2] = normal.z;
 
-			tess.tangents.push_back(tangent.x);
-			tess.tangents.push_back(tangent.y);
-			tess.tangents.push_back(tangent.z);
+			tess.tangents[v*3+0] = tangent.x;
+			tess.tangents[v*3+1] = tangent.y;
+			tess.tangents[v*3+2] = tangent.z;
 
-			tess.texCoords.push_back(texture.x);
-			tess.texCoords.push_back(texture.y);
+			tess.texCoords[v*2+0] = texture.x;
+			tess.texCoords[v*2+1] = texture.y;
 		}
 	}
 
-	for (uint32_t x = 0; x < majorSteps; x++) {
+	tess.indices.resize(size_t(majorSteps)*minorSteps*6);
+#pragma omp parallel for if (vertexCount >= parallelVertexCount)
+	for (int64_t x = 0; x < int64_t(majorSteps); x++) {
+		uint32_t* index = tess.indices.data() + size_t(x)*minorSteps*6;
+		const uint32_t row = uint32_t(x)*(minorSteps+1);
+		const uint32_t nextRow = row + minorSteps+1;
 		for (uint32_t y = 0; y < minorSteps; y++) {
 			// push 2 triangles per point
-			tess.indices.push_back((x+0)*(minorSteps+1) + (y+0));
-			tess.indices.push_back((x+1)*(minorSteps+1) + (y+0));
-			tess.indices.push_back((x+1)*(minorSteps+1) + (y+1));
+			*index++ = row + (y+0);
+			*index++ = nextRow + (y+0);
+			*index++ = nextRow + (y+1);
 
-			tess.indices.push_back((x+0)*(minorSteps+1) + (y+0));
-			tess.indices.push_back((x+1)*(minorSteps+1) + (y+1));
-			tess.indices.push_back((x+0)*(minorSteps+1) + (y+1));
+			*index++ = row + (y+0);
+			*index++ = nextRow + (y+1);
+			*index++ = row + (y+1);
 		}
 	}
 
@@ -514,9 +558,18 @@ Tesselation Tesselation::genCylinder(const Vec3 &center, const float radius,
   
   const float texScale = 1.0f / (1+genBottom+genTop);
   float texOffset = 0.0f;
+
+  // a bottom and a top vertex per step
+  const size_t vertexCount = (size_t(steps)+1)*2;
+  tess.vertices.resize(vertexCount*3);
+  tess.normals.resize(vertexCount*3);
+  tess.tangents.resize(vertexCount*3);
+  tess.texCoords.resize(vertexCount*2);
   
-  for (uint32_t x = 0; x <= steps; x++) {
+#pragma omp parallel for if (vertexCount >= parallelVertexCount)
+  for (int64_t x = 0; x <= int64_t(steps); x++) {
     const float phi = (2.0f * PI * x) / steps;
+    const size_t v = size_t(x)*2;
 
     const Vec3 vertexBottom{
       radius*std::cos(phi),
@@ -551,45 +604,40 @@ Tesselation Tesselation::genCylinder(const Vec3 &center, const float radius,
       1
     };
     
-    tess.vertices.push_back(vertexBottom.x + center.x);
-    tess.vertices.push_back(vertexBottom.y + center.y);
-    tess.vertices.push_back(vertexBottom.z + center.z);
-
-    tess.vertices.push_back(vertexTop.x + center.x);
-    tess.vertices.push_back(vertexTop.y + center.y);
-    tess.vertices.push_back(vertexTop.z + center.z);
-
-    tess.normals.push_back(normal.x);
-    tess.normals.push_back(normal.y);
-    tess.normals.push_back(normal.z);
-
-    tess.normals.push_back(normal.x);
-    tess.normals.push_back(normal.y);
-    tess.normals.push_back(normal.z);
-
-    tess.tangents.push_back(tangent.x);
-    tess.tangents.push_back(tangent.y);
-    tess.tangents.push_back(tangent.z);
-
-    tess.tangents.push_back(tangent.x);
-    tess.tangents.push_back(tangent.y);
-    tess.tangents.push_back(tangent.z);
+    tess.vertices[v*3+0] = vertexBottom.x + center.x;
+    tess.vertices[v*3+1] = vertexBottom.y + center.y;
+    tess.vertices[v*3+2] = vertexBottom.z + center.z;
+
+    tess.vertices[v*3+3] = vertexTop.x + center.x;
+    tess.vertices[v*3+4] = vertexTop.y + center.y;
+    tess.vertices[v*3+5] = vertexTop.z + center.z;
+
+    for (size_t k = 0;k<2;++k) {
+      tess.normals[(v+k)*3+0] = normal.x;
+      tess.normals[(v+k)*3+1] = normal.y;
+      tess.normals[(v+k)*3+2] = normal.z;
+
+      tess.tangents[(v+k)*3+0] = tangent.x;
+      tess.tangents[(v+k)*3+1] = tangent.y;
+      tess.tangents[(v+k)*3+2] = tangent.z;
+    }
 
-    tess.texCoords.push_back(textureBottom.x*texScale);
-    tess.texCoords.push_back(textureBottom.y);
+    tess.texCoords[v*2+0] = textureBottom.x*texScale;
+    tess.texCoords[v*2+1] = textureBottom.y;
 
-    tess.texCoords.push_back(textureTop.x*texScale);
-    tess.texCoords.push_back(textureTop.y);
+    tess.texCoords[v*2+2] = textureTop.x*texScale;
+    tess.texCoords[v*2+3] = textureTop.y;
   }
 
+  tess.indices.resize(size_t(steps)*6);
   for (uint32_t x = 0; x < steps; x++) {
-    tess.indices.push_back(x*2+0);
-    tess.indices.push_back(x*2+1);
-    tess.indices.push_back(x*2+2);
+    tess.indices[x*6+0] = x*2+0;
+    tess.indices[x*6+1] = x*2+1;
+    tess.indices[x*6+2] = x*2+2;
 
-    tess.indices.push_back(x*2+2);
-    tess.indices.push_back(x*2+1);
-    tess.indices.push_back(x*2+3);
+    tess.indices[x*6+3] = x*2+2;
+    tess.indices[x*6+4] = x*2+1;
+    tess.indices[x*6+5] = x*2+3;
   }
 
   if (genBottom) {
@@ -613,18 +661,63 @@ Tesselation Tesselation::genCylinder(const Vec3 &center, const float radius,
 void Tesselation::append(const Tesselation& other,
                          const Vec2& texOffset,
                          const Vec2& texScale) {
-  const size_t offset = vertices.size()/3;
+  const uint32_t offset = uint32_t(vertices.size()/3);
 
   vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
   normals.insert(normals.end(), other.normals.begin(), other.normals.end());
   tangents.insert(tangents.end(), other.tangents.begin(), other.tangents.end());
 
-  
+  const size_t texCoordStart = texCoords.size();
+  texCoords.resize(texCoordStart + other.texCoords.size());
   for (size_t i = 0;i< other.texCoords.size();++i) {
-    texCoords.push_back(other.texCoords[i]*texScale[i%2]+texOffset[i%2]);
+    texCoords[texCoordStart+i] = other.texCoords[i]*texScale[i%2]+texOffset[i%2];
   }
 
-  for (const uint32_t index : other.indices) {
-    indices.push_back(offset+index);
+  const size_t indexStart = indices.size();
+  indices.resize(indexStart + other.indices.size());
+  for (size_t i = 0;i< other.indices.size();++i) {
+    indices[indexStart+i] = offset+other.indices[i];
   }
 }
+
+std::vector<float> Tesselation::getInterleaved() const {
+  std::vector<float> data(getVertexCount()*interleavedStride);
+  interleave(data.data());
+  return data;
+}
+
+void Tesselation::interleave(float* data) const {
+  const size_t vertexCount = getVertexCount();
+
+#pragma omp parallel for if (vertexCount >= parallelVertexCount)
+  for (int64_t i = 0;i<int64_t(vertexCount);++i) {
+    float* vertex = data + size_t(i)*interleavedStride;
+    for (size_t c = 0;c<3;++c) {
+      vertex[c] = vertices[size_t(i)*3+c];
+      vertex[normalOffset+c] = normals[size_t(i)*3+c];
+      vertex[tangentOffset+c] = tangents[size_t(i)*3+c];
+    }
+    for (size_t c = 0;c<2;++c)
+      vertex[texCoordOffset+c] = texCoords[size_t(i)*2+c];
+  }
+}
+
+void Tesselation::optimizeVertexCache(size_t cacheSize) {
+  const size_t vertexCount = getVertexCount();
+  const std::vector<uint32_t> order = MeshOptimizer::tipsify(indices, vertexCount, cacheSize);
+  const std::vector<uint32_t> remap = MeshOptimizer::fetchOrder(order, vertexCount);
+
+  const auto reorder = [&](std::vector<float>& attribute, size_t components) {
+    std::vector<float> reordered(attribute.size());
+    for (size_t v = 0;v<vertexCount;++v)
+      for (size_t c = 0;c<components;++c)
+        reordered[remap[v]*components+c] = attribute[v*components+c];
+    attribute.swap(reordered);
+  };
+  reorder(vertices, 3);
+  reorder(normals, 3);
+  reorder(tangents, 3);
+  reorder(texCoords, 2);
+
+  for (size_t i = 0;i<order.size();++i) indices[i] = remap[order[i]];
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Vec3.h"
+#include "Vec2.h"
 #include <vector>
 
 class Tesselation {
@@ -33,7 +34,24 @@ class Tesselation {
 		const std::vector<float>& getTangents() const {return tangents;}
 		const std::vector<float>& getTexCoords() const {return texCoords;}
 		const std::vector<uint32_t>& getIndices() const {return indices;}
-		
+		size_t getVertexCount() const {return vertices.size()/3;}
+
+    // All attributes of a vertex next to each other, position, normal,
+    // tangent and texture coordinates, so a single buffer holds the mesh.
+    // The offsets are in floats, for GLBuffer::connectVertexAttrib.
+    static constexpr size_t interleavedStride{11};
+    static constexpr size_t normalOffset{3};
+    static constexpr size_t tangentOffset{6};
+    static constexpr size_t texCoordOffset{9};
+    std::vector<float> getInterleaved() const;
+    // writes getVertexCount()*interleavedStride floats, e.g. to a mapped
+    // buffer
+    void interleave(float* data) const;
+
+    // reorders the triangles for a vertex cache of cacheSize entries and
+    // then the vertices in the order the triangles use them
+    void optimizeVertexCache(size_t cacheSize=16);
+
     void append(const Tesselation& other,
                 const Vec2& texOffset={0.0f,0.0f},
                 const Vec2& texScale={1.0f,1.0f});
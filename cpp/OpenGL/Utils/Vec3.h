@@ -148,12 +148,20 @@ public:
   }
   
   static Vec3t<float> random() {
-    return {staticRand.rand01(),staticRand.rand01(),staticRand.rand01()};
+    return random(staticRand);
+  }
+
+  static Vec3t<float> random(Random& random) {
+    return {random.rand01(),random.rand01(),random.rand01()};
   }
   
   static Vec3t<float> randomPointInSphere() {
+    return randomPointInSphere(staticRand);
+  }
+
+  static Vec3t<float> randomPointInSphere(Random& random) {
     while (true) {
-      Vec3t<float> p{staticRand.rand11(),staticRand.rand11(),staticRand.rand11()};
+      Vec3t<float> p{random.rand11(),random.rand11(),random.rand11()};
       if (p.sqlength() > 1) continue;
       return p;
     }
@@ -168,8 +176,12 @@ public:
   }
   
   static Vec3t<float> randomPointInDisc() {
+    return randomPointInDisc(staticRand);
+  }
+
+  static Vec3t<float> randomPointInDisc(Random& random) {
     while (true) {
-      Vec3t<float> p{staticRand.rand11(),staticRand.rand11(),0};
+      Vec3t<float> p{random.rand11(),random.rand11(),0};
       if (p.sqlength() > 1) continue;
       return p;
     }
@@ -0,0 +1,269 @@
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <type_traits>
+
+#include "CPUFeatures.h"
+#ifdef CPU_X86
+#include <immintrin.h>
+#endif
+
+#include "VecArray.h"
+
+namespace {
+  struct Pointers {
+    const float* x;
+    const float* y;
+    const float* z;
+  };
+
+  struct OutPointers {
+    float* x;
+    float* y;
+    float* z;
+  };
+
+  // interleaved vectors are processed in blocks, copied to arrays of
+  // components on the stack and back
+  const size_t blockSize = 256;
+
+  void deinterleave(const float* data, size_t count, size_t stride, float* x, float* y, float* z) {
+    for (size_t i = 0;i<count;++i) {
+      x[i] = data[i*stride];
+      y[i] = data[i*stride+1];
+      z[i] = data[i*stride+2];
+    }
+  }
+
+  void interleave(const float* x, const float* y, const float* z, size_t count, size_t stride, float* data) {
+    for (size_t i = 0;i<count;++i) {
+      data[i*stride] = x[i];
+      data[i*stride+1] = y[i];
+      data[i*stride+2] = z[i];
+    }
+  }
+
+  Pointers pointers(const Vec3Array& a) {return {a.x.data(), a.y.data(), a.z.data()};}
+  OutPointers pointers(Vec3Array& a) {return {a.x.data(), a.y.data(), a.z.data()};}
+
+  // the baseline of the platform, SSE2 on x86-64
+  namespace base {
+#if defined(__SSE2__) || defined(_M_X64)
+    typedef __m128 Lanes;
+    const size_t laneCount = 4;
+    inline Lanes broadcast(Lanes, float v) {return _mm_set1_ps(v);}
+    inline Lanes load(Lanes, const float* p) {return _mm_loadu_ps(p);}
+    inline void store(float* p, Lanes v) {_mm_storeu_ps(p, v);}
+    inline Lanes add(Lanes a, Lanes b) {return _mm_add_ps(a, b);}
+    inline Lanes sub(Lanes a, Lanes b) {return _mm_sub_ps(a, b);}
+    inline Lanes mul(Lanes a, Lanes b) {return _mm_mul_ps(a, b);}
+    inline Lanes div(Lanes a, Lanes b) {return _mm_div_ps(a, b);}
+    inline Lanes squareRoot(Lanes a) {return _mm_sqrt_ps(a);}
+    // operand order as in std::min and std::max, so NaNs pass the same way
+    inline Lanes minimum(Lanes a, Lanes b) {return _mm_min_ps(b, a);}
+    inline Lanes maximum(Lanes a, Lanes b) {return _mm_max_ps(b, a);}
+    inline Lanes absolute(Lanes a) {return _mm_andnot_ps(_mm_set1_ps(-0.0f), a);}
+    inline Lanes less(Lanes a, Lanes b) {return _mm_cmplt_ps(a, b);}
+    inline Lanes lessEqual(Lanes a, Lanes b) {return _mm_cmple_ps(a, b);}
+    inline Lanes notEqual(Lanes a, Lanes b) {return _mm_cmpneq_ps(a, b);}
+    inline Lanes both(Lanes a, Lanes b) {return _mm_and_ps(a, b);}
+    inline Lanes select(Lanes mask, Lanes a, Lanes b) {
+      return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+    }
+    inline int toBits(Lanes mask) {return _mm_movemask_ps(mask);}
+#else
+    typedef float Lanes;
+    const size_t laneCount = 1;
+#endif
+
+#include "VecArrayKernels.h"
+  }
+
+#ifdef CPU_X86
+SIMD_TARGET_BEGIN_AVX2
+  namespace avx2 {
+    typedef __m256 Lanes;
+    const size_t laneCount = 8;
+    inline Lanes broadcast(Lanes, float v) {return _mm256_set1_ps(v);}
+    inline Lanes load(Lanes, const float* p) {return _mm256_loadu_ps(p);}
+    inline void store(float* p, Lanes v) {_mm256_storeu_ps(p, v);}
+    inline Lanes add(Lanes a, Lanes b) {return _mm256_add_ps(a, b);}
+    inline Lanes sub(Lanes a, Lanes b) {return _mm256_sub_ps(a, b);}
+    inline Lanes mul(Lanes a, Lanes b) {return _mm256_mul_ps(a, b);}
+    inline Lanes div(Lanes a, Lanes b) {return _mm256_div_ps(a, b);}
+    inline Lanes squareRoot(Lanes a) {return _mm256_sqrt_ps(a);}
+    // operand order as in std::min and std::max, so NaNs pass the same way
+    inline Lanes minimum(Lanes a, Lanes b) {return _mm256_min_ps(b, a);}
+    inline Lanes maximum(Lanes a, Lanes b) {return _mm256_max_ps(b, a);}
+    inline Lanes absolute(Lanes a) {return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a);}
+    inline Lanes less(Lanes a, Lanes b) {return _mm256_cmp_ps(a, b, _CMP_LT_OQ);}
+    inline Lanes lessEqual(Lanes a, Lanes b) {return _mm256_cmp_ps(a, b, _CMP_LE_OQ);}
+    inline Lanes notEqual(Lanes a, Lanes b) {return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);}
+    inline Lanes both(Lanes a, Lanes b) {return _mm256_and_ps(a, b);}
+    inline Lanes select(Lanes mask, Lanes a, Lanes b) {return _mm256_blendv_ps(b, a, mask);}
+    inline int toBits(Lanes mask) {return _mm256_movemask_ps(mask);}
+
+#include "VecArrayKernels.h"
+  }
+SIMD_TARGET_END
+
+  // the kernel of the widest instruction set the CPU has
+  #define KERNEL(name) (CPUFeatures::hasAVX2() ? avx2::name : base::name)
+#else
+  #define KERNEL(name) base::name
+#endif
+}
+
+Vec3Array::Vec3Array(size_t size) :
+  x(size),
+  y(size),
+  z(size)
+{
+}
+
+Vec3Array::Vec3Array(const std::vector<Vec3>& vectors) :
+  Vec3Array(vectors.empty() ? nullptr : &vectors[0].x, vectors.size(), 3)
+{
+}
+
+Vec3Array::Vec3Array(const float* data, size_t count, size_t stride) :
+  Vec3Array(count)
+{
+  deinterleave(data, count, stride, x.data(), y.data(), z.data());
+}
+
+void Vec3Array::resize(size_t size) {
+  x.resize(size);
+  y.resize(size);
+  z.resize(size);
+}
+
+std::vector<Vec3> Vec3Array::toVectors() const {
+  std::vector<Vec3> vectors(size());
+  if (!vectors.empty()) toInterleaved(&vectors[0].x, 3);
+  return vectors;
+}
+
+void Vec3Array::toInterleaved(float* data, size_t stride) const {
+  interleave(x.data(), y.data(), z.data(), size(), stride, data);
+}
+
+Vec4Array::Vec4Array(size_t size) :
+  x(size),
+  y(size),
+  z(size),
+  w(size)
+{
+}
+
+Vec4Array::Vec4Array(const std::vector<Vec4>& vectors) :
+  Vec4Array(vectors.empty() ? nullptr : &vectors[0].x, vectors.size(), 4)
+{
+}
+
+Vec4Array::Vec4Array(const float* data, size_t count, size_t stride) :
+  Vec4Array(count)
+{
+  for (size_t i = 0;i<count;++i) {
+    x[i] = data[i*stride];
+    y[i] = data[i*stride+1];
+    z[i] = data[i*stride+2];
+    w[i] = data[i*stride+3];
+  }
+}
+
+void Vec4Array::resize(size_t size) {
+  x.resize(size);
+  y.resize(size);
+  z.resize(size);
+  w.resize(size);
+}
+
+std::vector<Vec4> Vec4Array::toVectors() const {
+  std::vector<Vec4> vectors(size());
+  if (!vectors.empty()) toInterleaved(&vectors[0].x, 4);
+  return vectors;
+}
+
+void Vec4Array::toInterleaved(float* data, size_t stride) const {
+  for (size_t i = 0;i<size();++i) {
+    data[i*stride] = x[i];
+    data[i*stride+1] = y[i];
+    data[i*stride+2] = z[i];
+    data[i*stride+3] = w[i];
+  }
+}
+
+void VecArray::transformPoints(const Mat4& m, const Vec3Array& in, Vec3Array& out) {
+  out.resize(in.size());
+  KERNEL(transformPoints)(m, pointers(in), pointers(out), in.size());
+}
+
+void VecArray::transformPoints(const Mat4& m, float* data, size_t count, size_t stride) {
+  const auto kernel = KERNEL(transformPoints);
+  float x[blockSize], y[blockSize], z[blockSize];
+  for (size_t first = 0;first<count;first += blockSize) {
+    const size_t n = std::min(blockSize, count-first);
+    deinterleave(data+first*stride, n, stride, x, y, z);
+    kernel(m, {x, y, z}, {x, y, z}, n);
+    interleave(x, y, z, n, stride, data+first*stride);
+  }
+}
+
+void VecArray::transformVectors(const Mat4& m, const Vec3Array& in, Vec3Array& out) {
+  out.resize(in.size());
+  KERNEL(transformVectors)(m, in, out);
+}
+
+void VecArray::transform(const Mat4& m, const Vec4Array& in, Vec4Array& out) {
+  out.resize(in.size());
+  KERNEL(transform)(m, in, out);
+}
+
+void VecArray::cross(const Vec3Array& a, const Vec3Array& b, Vec3Array& out) {
+  out.resize(a.size());
+  KERNEL(cross)(a, b, out);
+}
+
+void VecArray::normalize(const Vec3Array& in, Vec3Array& out) {
+  out.resize(in.size());
+  KERNEL(normalize)(in, out);
+}
+
+VecArray::AABB VecArray::bounds(const Vec3Array& v) {
+  return KERNEL(bounds)(pointers(v), v.size());
+}
+
+VecArray::AABB VecArray::bounds(const float* data, size_t count, size_t stride) {
+  const float highest = std::numeric_limits<float>::max();
+  const float lowest = std::numeric_limits<float>::lowest();
+  AABB box{{highest, highest, highest}, {lowest, lowest, lowest}};
+  const auto kernel = KERNEL(bounds);
+  float x[blockSize], y[blockSize], z[blockSize];
+  for (size_t first = 0;first<count;first += blockSize) {
+    const size_t n = std::min(blockSize, count-first);
+    deinterleave(data+first*stride, n, stride, x, y, z);
+    const AABB block = kernel({x, y, z}, n);
+    box.min = Vec3::minV(box.min, block.min);
+    box.max = Vec3::maxV(box.max, block.max);
+  }
+  return box;
+}
+
+void VecArray::transformBoxes(const Mat4& m, const Vec3Array& mins, const Vec3Array& maxs,
+                              Vec3Array& outMins, Vec3Array& outMaxs) {
+  outMins.resize(mins.size());
+  outMaxs.resize(mins.size());
+  KERNEL(transformBoxes)(m, mins, maxs, outMins, outMaxs);
+}
+
+void VecArray::overlaps(const AABB& box, const Vec3Array& mins, const Vec3Array& maxs,
+                        std::vector<uint8_t>& result) {
+  result.resize(mins.size());
+  KERNEL(overlaps)(box, mins, maxs, result);
+}
+
+void VecArray::slerp(const Vec4Array& a, const Vec4Array& b, const std::vector<float>& t, Vec4Array& out) {
+  out.resize(a.size());
+  KERNEL(slerp)(a, b, t, out);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "Vec3.h"
+#include "Vec4.h"
+#include "Mat4.h"
+
+// Vectors stored as a structure of arrays, one array per component, so
+// the kernels in VecArray process eight of them at a time if the CPU has
+// AVX2, four with SSE and one at a time otherwise.
+class Vec3Array {
+public:
+  Vec3Array(size_t size=0);
+  Vec3Array(const std::vector<Vec3>& vectors);
+  // from interleaved floats, stride is the distance of two vectors in
+  // floats, e.g. 3 for the vertices of a Tesselation
+  Vec3Array(const float* data, size_t count, size_t stride=3);
+
+  size_t size() const {return x.size();}
+  void resize(size_t size);
+
+  Vec3 operator[](size_t i) const {return {x[i], y[i], z[i]};}
+  void set(size_t i, const Vec3& v) {x[i] = v.x; y[i] = v.y; z[i] = v.z;}
+
+  std::vector<Vec3> toVectors() const;
+  void toInterleaved(float* data, size_t stride=3) const;
+
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+};
+
+class Vec4Array {
+public:
+  Vec4Array(size_t size=0);
+  Vec4Array(const std::vector<Vec4>& vectors);
+  Vec4Array(const float* data, size_t count, size_t stride=4);
+
+  size_t size() const {return x.size();}
+  void resize(size_t size);
+
+  Vec4 operator[](size_t i) const {return {x[i], y[i], z[i], w[i]};}
+  void set(size_t i, const Vec4& v) {x[i] = v.x; y[i] = v.y; z[i] = v.z; w[i] = v.w;}
+
+  std::vector<Vec4> toVectors() const;
+  void toInterleaved(float* data, size_t stride=4) const;
+
+  std::vector<float> x;
+  std::vector<float> y;
+  std::vector<float> z;
+  std::vector<float> w;
+};
+
+// Bulk versions of the Mat4 and Vec3 operations. The results are those of
+// the single vector operations up to rounding, outputs may be the inputs.
+// The overloads on interleaved floats work in place on vertex buffers as
+// Tesselation and OBJFile store them.
+namespace VecArray {
+  struct AABB {
+    Vec3 min;
+    Vec3 max;
+  };
+
+  // m * v with the division by w, as Mat4 * Vec3
+  void transformPoints(const Mat4& m, const Vec3Array& in, Vec3Array& out);
+  void transformPoints(const Mat4& m, float* data, size_t count, size_t stride=3);
+  // the upper 3x3 part of m only, for directions
+  void transformVectors(const Mat4& m, const Vec3Array& in, Vec3Array& out);
+  void transform(const Mat4& m, const Vec4Array& in, Vec4Array& out);
+
+  void cross(const Vec3Array& a, const Vec3Array& b, Vec3Array& out);
+  // zero vectors stay zero, as in Vec3::normalize
+  void normalize(const Vec3Array& in, Vec3Array& out);
+
+  // componentwise minimum and maximum, an empty input gives min above max
+  AABB bounds(const Vec3Array& v);
+  AABB bounds(const float* data, size_t count, size_t stride=3);
+
+  // the boxes around the transformed boxes, for affine m
+  void transformBoxes(const Mat4& m, const Vec3Array& mins, const Vec3Array& maxs,
+                      Vec3Array& outMins, Vec3Array& outMaxs);
+  // 1 for every box that overlaps box, touching counts
+  void overlaps(const AABB& box, const Vec3Array& mins, const Vec3Array& maxs,
+                std::vector<uint8_t>& result);
+
+  // Spherical interpolation of quaternions stored as x, y, z, w, from a[i]
+  // to b[i] by t[i], along the shorter arc. The inputs need not be unit
+  // length, the results are. Uses the polynomial approximation of Eberly,
+  // "A Fast and Accurate Algorithm for Computing SLERP", accurate to about
+  // 1e-6 and without any trigonometric functions.
+  void slerp(const Vec4Array& a, const Vec4Array& b, const std::vector<float>& t, Vec4Array& out);
+}
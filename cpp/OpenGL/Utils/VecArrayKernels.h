@@ -0,0 +1,253 @@
+// The kernels of VecArray for one lane type. VecArray.cpp includes this
+// file once per instruction set, each time in its own namespace that
+// defines Lanes, laneCount and the Lanes overloads of the operations
+// below, so every copy is compiled for its own instruction set. There is
+// deliberately no include guard.
+//
+// Every kernel is written once against the overloads and runs on Lanes for
+// full groups of vectors and on float for the rest, so both paths round
+// the same way. With Lanes = float and laneCount = 1 the kernels run one
+// vector at a time.
+
+inline float broadcast(float, float v) {return v;}
+inline float load(float, const float* p) {return *p;}
+inline void store(float* p, float v) {*p = v;}
+inline float add(float a, float b) {return a+b;}
+inline float sub(float a, float b) {return a-b;}
+inline float mul(float a, float b) {return a*b;}
+inline float div(float a, float b) {return a/b;}
+inline float squareRoot(float a) {return std::sqrt(a);}
+inline float minimum(float a, float b) {return std::min(a, b);}
+inline float maximum(float a, float b) {return std::max(a, b);}
+inline float absolute(float a) {return std::fabs(a);}
+inline bool less(float a, float b) {return a < b;}
+inline bool lessEqual(float a, float b) {return a <= b;}
+inline bool notEqual(float a, float b) {return a != b;}
+inline bool both(bool a, bool b) {return a && b;}
+inline float select(bool mask, float a, float b) {return mask ? a : b;}
+
+// calls f(V{}, i) for every i below count, with V = Lanes for as many
+// full groups as possible
+template <typename F>
+void forEach(size_t count, F f) {
+  size_t i = 0;
+  for (;i+laneCount<=count;i += laneCount) f(Lanes{}, i);
+  for (;i<count;++i) f(0.0f, i);
+}
+
+inline float reduce(Lanes v, bool findMax) {
+  float lanes[laneCount];
+  store(lanes, v);
+  float result = lanes[0];
+  for (size_t i = 1;i<laneCount;++i)
+    result = findMax ? std::max(result, lanes[i]) : std::min(result, lanes[i]);
+  return result;
+}
+
+void transformPoints(const float* e, Pointers in, OutPointers out, size_t count) {
+  forEach(count, [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V x = load(tag, in.x+i);
+    const V y = load(tag, in.y+i);
+    const V z = load(tag, in.z+i);
+    auto row = [&](size_t r) {
+      return add(add(add(mul(x, broadcast(tag, e[r*4])), mul(y, broadcast(tag, e[r*4+1]))),
+                     mul(z, broadcast(tag, e[r*4+2]))), broadcast(tag, e[r*4+3]));
+    };
+    const V w = row(3);
+    store(out.x+i, V(div(row(0), w)));
+    store(out.y+i, V(div(row(1), w)));
+    store(out.z+i, V(div(row(2), w)));
+  });
+}
+
+VecArray::AABB bounds(Pointers in, size_t count) {
+  const float highest = std::numeric_limits<float>::max();
+  const float lowest = std::numeric_limits<float>::lowest();
+  VecArray::AABB box{{highest, highest, highest}, {lowest, lowest, lowest}};
+
+  size_t i = 0;
+  if (count >= laneCount) {
+    Lanes minX = broadcast(Lanes{}, highest), minY = minX, minZ = minX;
+    Lanes maxX = broadcast(Lanes{}, lowest), maxY = maxX, maxZ = maxX;
+    for (;i+laneCount<=count;i += laneCount) {
+      const Lanes x = load(Lanes{}, in.x+i);
+      const Lanes y = load(Lanes{}, in.y+i);
+      const Lanes z = load(Lanes{}, in.z+i);
+      minX = minimum(minX, x); minY = minimum(minY, y); minZ = minimum(minZ, z);
+      maxX = maximum(maxX, x); maxY = maximum(maxY, y); maxZ = maximum(maxZ, z);
+    }
+    box.min = Vec3{reduce(minX, false), reduce(minY, false), reduce(minZ, false)};
+    box.max = Vec3{reduce(maxX, true), reduce(maxY, true), reduce(maxZ, true)};
+  }
+  for (;i<count;++i) {
+    box.min = Vec3::minV(box.min, Vec3{in.x[i], in.y[i], in.z[i]});
+    box.max = Vec3::maxV(box.max, Vec3{in.x[i], in.y[i], in.z[i]});
+  }
+  return box;
+}
+
+void transformVectors(const float* e, const Vec3Array& in, Vec3Array& out) {
+  forEach(in.size(), [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V x = load(tag, &in.x[i]);
+    const V y = load(tag, &in.y[i]);
+    const V z = load(tag, &in.z[i]);
+    auto row = [&](size_t r) {
+      return add(add(mul(x, broadcast(tag, e[r*4])), mul(y, broadcast(tag, e[r*4+1]))),
+                 mul(z, broadcast(tag, e[r*4+2])));
+    };
+    store(&out.x[i], V(row(0)));
+    store(&out.y[i], V(row(1)));
+    store(&out.z[i], V(row(2)));
+  });
+}
+
+void transform(const float* e, const Vec4Array& in, Vec4Array& out) {
+  forEach(in.size(), [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V x = load(tag, &in.x[i]);
+    const V y = load(tag, &in.y[i]);
+    const V z = load(tag, &in.z[i]);
+    const V w = load(tag, &in.w[i]);
+    auto row = [&](size_t r) {
+      return add(add(add(mul(x, broadcast(tag, e[r*4])), mul(y, broadcast(tag, e[r*4+1]))),
+                     mul(z, broadcast(tag, e[r*4+2]))), mul(w, broadcast(tag, e[r*4+3])));
+    };
+    const V rx = row(0), ry = row(1), rz = row(2), rw = row(3);
+    store(&out.x[i], rx);
+    store(&out.y[i], ry);
+    store(&out.z[i], rz);
+    store(&out.w[i], rw);
+  });
+}
+
+void cross(const Vec3Array& a, const Vec3Array& b, Vec3Array& out) {
+  forEach(a.size(), [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V ax = load(tag, &a.x[i]), ay = load(tag, &a.y[i]), az = load(tag, &a.z[i]);
+    const V bx = load(tag, &b.x[i]), by = load(tag, &b.y[i]), bz = load(tag, &b.z[i]);
+    store(&out.x[i], V(sub(mul(ay, bz), mul(az, by))));
+    store(&out.y[i], V(sub(mul(az, bx), mul(ax, bz))));
+    store(&out.z[i], V(sub(mul(ax, by), mul(ay, bx))));
+  });
+}
+
+void normalize(const Vec3Array& in, Vec3Array& out) {
+  forEach(in.size(), [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V x = load(tag, &in.x[i]), y = load(tag, &in.y[i]), z = load(tag, &in.z[i]);
+    const V zero = broadcast(tag, 0.0f);
+    const V l = squareRoot(add(add(mul(x, x), mul(y, y)), mul(z, z)));
+    const auto valid = notEqual(l, zero);
+    store(&out.x[i], V(select(valid, div(x, l), zero)));
+    store(&out.y[i], V(select(valid, div(y, l), zero)));
+    store(&out.z[i], V(select(valid, div(z, l), zero)));
+  });
+}
+
+void transformBoxes(const float* e, const Vec3Array& mins, const Vec3Array& maxs,
+                    Vec3Array& outMins, Vec3Array& outMaxs) {
+  forEach(mins.size(), [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V half = broadcast(tag, 0.5f);
+    const V minX = load(tag, &mins.x[i]), minY = load(tag, &mins.y[i]), minZ = load(tag, &mins.z[i]);
+    const V maxX = load(tag, &maxs.x[i]), maxY = load(tag, &maxs.y[i]), maxZ = load(tag, &maxs.z[i]);
+    const V cx = mul(add(minX, maxX), half), cy = mul(add(minY, maxY), half), cz = mul(add(minZ, maxZ), half);
+    const V ex = mul(sub(maxX, minX), half), ey = mul(sub(maxY, minY), half), ez = mul(sub(maxZ, minZ), half);
+    // center through m, extent through the absolute values of its 3x3 part
+    V center[3], extent[3];
+    for (size_t r = 0;r<3;++r) {
+      const V m0 = broadcast(tag, e[r*4]), m1 = broadcast(tag, e[r*4+1]), m2 = broadcast(tag, e[r*4+2]);
+      center[r] = add(add(add(mul(cx, m0), mul(cy, m1)), mul(cz, m2)), broadcast(tag, e[r*4+3]));
+      extent[r] = add(add(mul(ex, absolute(m0)), mul(ey, absolute(m1))), mul(ez, absolute(m2)));
+    }
+    store(&outMins.x[i], V(sub(center[0], extent[0])));
+    store(&outMins.y[i], V(sub(center[1], extent[1])));
+    store(&outMins.z[i], V(sub(center[2], extent[2])));
+    store(&outMaxs.x[i], V(add(center[0], extent[0])));
+    store(&outMaxs.y[i], V(add(center[1], extent[1])));
+    store(&outMaxs.z[i], V(add(center[2], extent[2])));
+  });
+}
+
+void overlaps(const VecArray::AABB& box, const Vec3Array& mins, const Vec3Array& maxs,
+              std::vector<uint8_t>& result) {
+  forEach(mins.size(), [&](auto tag, size_t i) {
+    const auto x = both(lessEqual(load(tag, &mins.x[i]), broadcast(tag, box.max.x)),
+                        lessEqual(broadcast(tag, box.min.x), load(tag, &maxs.x[i])));
+    const auto y = both(lessEqual(load(tag, &mins.y[i]), broadcast(tag, box.max.y)),
+                        lessEqual(broadcast(tag, box.min.y), load(tag, &maxs.y[i])));
+    const auto z = both(lessEqual(load(tag, &mins.z[i]), broadcast(tag, box.max.z)),
+                        lessEqual(broadcast(tag, box.min.z), load(tag, &maxs.z[i])));
+    const auto inside = both(x, both(y, z));
+    if constexpr (std::is_same<decltype(tag), float>::value) {
+      result[i] = inside ? 1 : 0;
+    } else {
+      const int bits = toBits(inside);
+      for (size_t l = 0;l<laneCount;++l) result[i+l] = uint8_t((bits >> l) & 1);
+    }
+  });
+}
+
+void slerp(const Vec4Array& a, const Vec4Array& b, const std::vector<float>& t, Vec4Array& out) {
+  // Eberly's coefficients u[i] = 1/(i*(2i+1)) and v[i] = i/(2i+1), the
+  // last ones corrected by the factor 1+mu for the truncated series
+  const size_t termCount = 8;
+  const float onePlusMu = 1.90110745351730037f;
+  float u[termCount], v[termCount];
+  for (size_t i = 0;i<termCount;++i) {
+    const float n = float(i+1);
+    u[i] = 1.0f/(n*(2.0f*n+1.0f));
+    v[i] = n/(2.0f*n+1.0f);
+  }
+  u[termCount-1] *= onePlusMu;
+  v[termCount-1] *= onePlusMu;
+
+  forEach(a.size(), [&](auto tag, size_t i) {
+    typedef decltype(tag) V;
+    const V zero = broadcast(tag, 0.0f);
+    const V one = broadcast(tag, 1.0f);
+
+    V ax = load(tag, &a.x[i]), ay = load(tag, &a.y[i]), az = load(tag, &a.z[i]), aw = load(tag, &a.w[i]);
+    V bx = load(tag, &b.x[i]), by = load(tag, &b.y[i]), bz = load(tag, &b.z[i]), bw = load(tag, &b.w[i]);
+    const V la = squareRoot(add(add(mul(ax, ax), mul(ay, ay)), add(mul(az, az), mul(aw, aw))));
+    const V lb = squareRoot(add(add(mul(bx, bx), mul(by, by)), add(mul(bz, bz), mul(bw, bw))));
+    ax = div(ax, la); ay = div(ay, la); az = div(az, la); aw = div(aw, la);
+    bx = div(bx, lb); by = div(by, lb); bz = div(bz, lb); bw = div(bw, lb);
+
+    // the shorter arc, through -b if the quaternions point apart
+    V d = add(add(mul(ax, bx), mul(ay, by)), add(mul(az, bz), mul(aw, bw)));
+    const auto negative = less(d, zero);
+    const V sign = select(negative, broadcast(tag, -1.0f), one);
+    d = minimum(mul(d, sign), one);
+
+    const V tt = load(tag, &t[i]);
+    const V s = sub(one, tt);
+    const V dm1 = sub(d, one);
+    const V tt2 = mul(tt, tt);
+    const V s2 = mul(s, s);
+    V ct = one;
+    V cs = one;
+    for (size_t k = termCount;k-- > 0;) {
+      const V uk = broadcast(tag, u[k]);
+      const V vk = broadcast(tag, v[k]);
+      ct = add(one, mul(mul(sub(mul(uk, tt2), vk), dm1), ct));
+      cs = add(one, mul(mul(sub(mul(uk, s2), vk), dm1), cs));
+    }
+    ct = mul(mul(ct, tt), sign);
+    cs = mul(cs, s);
+
+    V rx = add(mul(ax, cs), mul(bx, ct));
+    V ry = add(mul(ay, cs), mul(by, ct));
+    V rz = add(mul(az, cs), mul(bz, ct));
+    V rw = add(mul(aw, cs), mul(bw, ct));
+    // the approximation keeps the length to about 1e-6, renormalizing
+    // makes the results unit quaternions for computeRotation
+    const V l = squareRoot(add(add(mul(rx, rx), mul(ry, ry)), add(mul(rz, rz), mul(rw, rw))));
+    store(&out.x[i], V(div(rx, l)));
+    store(&out.y[i], V(div(ry, l)));
+    store(&out.z[i], V(div(rz, l)));
+    store(&out.w[i], V(div(rw, l)));
+  });
+}
@@ -0,0 +1,237 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <omp.h>
+
+#include <StencilSolver.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Compares StencilSolver with the loop the water demo used before, over
+// Grid2D style accessors with modulo wraparound and per pixel colorization.
+// Small grids, with tiles cut at the border, are checked for the same
+// heights after single and blocked steps, for the wave and the diffusion
+// equation, and for the colors of the last step. StencilSolver never fuses
+// multiplies and adds, the old loop here may, so heights may differ in the
+// last bits and colors by one. Every size is then timed in million
+// cell updates per second, one step per frame with colors as the demo
+// does and blocks of steps with colors after the last one.
+//
+//   waterBench [size...]   defaults 1024 4096 8192
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// the parts of Grid2D and Image the old loop used
+struct Grid {
+  size_t width;
+  size_t height;
+  std::vector<float> data;
+
+  Grid(size_t width, size_t height) : width(width), height(height), data(width*height, 0.0f) {}
+  size_t getWidth() const {return width;}
+  size_t getHeight() const {return height;}
+  float getValue(size_t x, size_t y) const {return data[x + y*width];}
+  void setValue(size_t x, size_t y, float value) {data[x + y*width] = value;}
+};
+
+struct Pixels {
+  size_t width;
+  std::vector<uint8_t> data;
+
+  Pixels(size_t width, size_t height) : width(width), data(width*height*3, 0) {}
+  void setValue(uint32_t x, uint32_t y, uint32_t component, uint8_t value) {
+    data[component + (size_t(x) + size_t(y)*width)*3] = value;
+  }
+};
+
+const float c = 2.0f;
+const float dx = 0.5f;
+const float dt = 0.05f;
+const float alpha = (c*c*dt*dt) / (dx*dx);
+const float colorScale = 500.0f;
+
+// the animate method of the demo
+struct Legacy {
+  std::shared_ptr<Grid> last;
+  std::shared_ptr<Grid> current;
+  std::shared_ptr<Grid> next;
+  Pixels image;
+  const float beta = 2.0f - 4.0f*alpha;
+
+  Legacy(size_t w, size_t h) :
+    last{std::make_shared<Grid>(w,h)},
+    current{std::make_shared<Grid>(w,h)},
+    next{std::make_shared<Grid>(w,h)},
+    image{w,h}
+  {}
+
+  void animate() {
+    const size_t w   = current->getWidth();
+    const size_t h   = current->getHeight();
+
+    for (size_t y = 0;y<current->getHeight();++y) {
+      for (size_t x = 0;x<current->getWidth();++x) {
+
+        const float left   = current->getValue((x+1)%w,y);
+        const float right  = current->getValue((x+w-1)%w,y);
+        const float top    = current->getValue(x,(y+1)%h);
+        const float bottom = current->getValue(x,(y+h-1)%h);
+        const float center = current->getValue(x,y);
+        const float past   = last->getValue(x,y);
+
+        const float v = alpha * (left+right+top+bottom) + beta * center - past;
+        next->setValue(x,y,v);
+
+        image.setValue(uint32_t(x),uint32_t(y),0, v > 0 ? uint8_t(v*500) : 0);
+        image.setValue(uint32_t(x),uint32_t(y),1, v < 0 ? uint8_t(-v*500) : 0);
+      }
+    }
+
+    std::shared_ptr<Grid> t = last;
+    last    = current;
+    current = next;
+    next    = t;
+  }
+};
+
+// the diffusion step written the same way
+static void diffuse(Grid& current, Grid& next) {
+  const size_t w = current.getWidth();
+  const size_t h = current.getHeight();
+  const float beta = 1.0f - 4.0f*alpha;
+  for (size_t y = 0;y<h;++y) {
+    for (size_t x = 0;x<w;++x) {
+      const float v = alpha * (current.getValue((x+1)%w,y) + current.getValue((x+w-1)%w,y) +
+                               current.getValue(x,(y+1)%h) + current.getValue(x,(y+h-1)%h)) +
+                      beta * current.getValue(x,y);
+      next.setValue(x,y,v);
+    }
+  }
+  std::swap(current, next);
+}
+
+// a few drops, as if the demo had been clicked
+static std::vector<std::pair<size_t,size_t>> drops(size_t w, size_t h) {
+  return {{w/2,h/2}, {w/5,h/3}, {w-1,h-1}, {0,h/7}, {w/3,0}};
+}
+
+static bool sameHeights(const Grid& reference, const StencilSolver& solver) {
+  for (size_t y = 0;y<reference.height;++y)
+    for (size_t x = 0;x<reference.width;++x)
+      if (std::abs(reference.getValue(x,y) - solver.getValue(x,y)) > 1e-5f) return false;
+  return true;
+}
+
+static bool sameColors(const Grid& reference, const std::vector<uint8_t>& pixels) {
+  for (size_t y = 0;y<reference.height;++y) {
+    for (size_t x = 0;x<reference.width;++x) {
+      const float v = reference.getValue(x,y)*colorScale;
+      const uint8_t* p = &pixels[(x + y*reference.width)*3];
+      if (std::abs(p[0] - (v > 0 ? std::min(v, 255.0f) : 0.0f)) > 1.0f ||
+          std::abs(p[1] - (v < 0 ? std::min(-v, 255.0f) : 0.0f)) > 1.0f || p[2] != 0) return false;
+    }
+  }
+  return true;
+}
+
+static bool check(size_t w, size_t h, size_t steps) {
+  Legacy legacy{w,h};
+  Grid diffusion{w,h};
+  Grid diffusionNext{w,h};
+  StencilSolver single{w, h, alpha};
+  StencilSolver blocked{w, h, alpha};
+  StencilSolver diffusionSingle{w, h, alpha, StencilSolver::Equation::Diffusion};
+  StencilSolver diffusionBlocked{w, h, alpha, StencilSolver::Equation::Diffusion};
+  for (const auto& d : drops(w,h)) {
+    legacy.current->setValue(d.first, d.second, 1.0f);
+    diffusion.setValue(d.first, d.second, 1.0f);
+    single.setValue(d.first, d.second, 1.0f);
+    blocked.setValue(d.first, d.second, 1.0f);
+    diffusionSingle.setValue(d.first, d.second, 1.0f);
+    diffusionBlocked.setValue(d.first, d.second, 1.0f);
+  }
+
+  std::vector<uint8_t> singlePixels(w*h*3);
+  std::vector<uint8_t> blockedPixels(w*h*3);
+  for (size_t s = 0;s<steps;++s) {
+    legacy.animate();
+    diffuse(diffusion, diffusionNext);
+    single.step(1, singlePixels.data(), 3, colorScale);
+    diffusionSingle.step();
+  }
+  blocked.step(steps, blockedPixels.data(), 3, colorScale);
+  diffusionBlocked.step(steps);
+
+  return sameHeights(*legacy.current, single) && sameHeights(*legacy.current, blocked) &&
+         sameHeights(diffusion, diffusionSingle) && sameHeights(diffusion, diffusionBlocked) &&
+         sameColors(*legacy.current, singlePixels) && sameColors(*legacy.current, blockedPixels);
+}
+
+static void report(const std::string& name, size_t cells, size_t steps, double time, double reference) {
+  const double rate = double(cells)*double(steps)/time/1e6;
+  std::cout << "  " << std::left << std::setw(28) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(9) << rate << " Mcell updates/s";
+  if (reference > 0) std::cout << std::setw(8) << reference/time << "x";
+  std::cout << std::endl;
+}
+
+static void run(size_t size) {
+  const size_t cells = size*size;
+  const size_t steps = std::max<size_t>(8, (size_t(1) << 27) / cells / 8 * 8);
+  std::cout << size << "x" << size << ", " << steps << " steps" << std::endl;
+
+  double legacyTime = 0;
+  {
+    Legacy legacy{size,size};
+    for (const auto& d : drops(size,size)) legacy.current->setValue(d.first, d.second, 1.0f);
+    const auto t1 = Clock::now();
+    for (size_t s = 0;s<steps;++s) legacy.animate();
+    legacyTime = seconds(t1, Clock::now());
+    report("old loop", cells, steps, legacyTime, 0);
+  }
+
+  std::vector<uint8_t> pixels(cells*3);
+  {
+    StencilSolver solver{size, size, alpha};
+    for (const auto& d : drops(size,size)) solver.setValue(d.first, d.second, 1.0f);
+    const auto t1 = Clock::now();
+    for (size_t s = 0;s<steps;++s) solver.step(1, pixels.data(), 3, colorScale);
+    report("one step per frame", cells, steps, seconds(t1, Clock::now()), legacyTime);
+  }
+  for (const size_t depth : {2, 4, 8}) {
+    StencilSolver solver{size, size, alpha, StencilSolver::Equation::Wave, depth};
+    for (const auto& d : drops(size,size)) solver.setValue(d.first, d.second, 1.0f);
+    const auto t1 = Clock::now();
+    solver.step(steps, pixels.data(), 3, colorScale);
+    report("blocks of " + std::to_string(depth) + " steps", cells, steps, seconds(t1, Clock::now()), legacyTime);
+  }
+}
+
+int main(int argc, char** argv) {
+  std::vector<size_t> sizes;
+  for (int i = 1;i<argc;++i) sizes.push_back(size_t(atol(argv[i])));
+  if (sizes.empty()) sizes = {1024, 4096, 8192};
+
+  std::cout << omp_get_max_threads() << " threads" << std::endl;
+  for (const auto& s : {std::make_pair(512, 512), std::make_pair(300, 200), std::make_pair(17, 9)}) {
+    for (const size_t steps : {1, 6, 25}) {
+      if (!check(size_t(s.first), size_t(s.second), steps)) {
+        std::cout << "WRONG result for " << s.first << "x" << s.second << " after " << steps
+                  << " steps" << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  std::cout << "checked" << std::endl;
+
+  for (const size_t size : sizes) run(size);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,381 @@
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#include "Contours.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+static const uint32_t none = std::numeric_limits<uint32_t>::max();
+
+// A grid edge is identified by its first vertex p = x + y*width, 2p for
+// the edge to the right and 2p+1 for the edge upwards. Both cells next to
+// an edge agree on the ID and on the position of the crossing on it.
+struct Segment {
+  std::array<uint64_t, 2> edges;
+  // the same edges numbered within the tile
+  std::array<uint32_t, 2> local;
+};
+
+// polylines as the sequences of edges their vertices lie on
+struct Chains {
+  std::vector<uint64_t> edges;
+  std::vector<size_t> offsets{0};
+  std::vector<uint8_t> closed;
+
+  size_t size() const {return closed.size();}
+  size_t begin(size_t i) const {return offsets[i];}
+  size_t end(size_t i) const {return offsets[i+1];}
+  void finish(bool isClosed) {
+    offsets.push_back(edges.size());
+    closed.push_back(isClosed);
+  }
+};
+
+// Joins the segments of one tile and isovalue. Every edge inside the tile
+// is shared by exactly two segments, so link holds two slots per local
+// edge. Walks start at edges with a single segment, on the tile or image
+// border, whatever is left over afterwards are closed loops.
+static void chainTile(const std::vector<Segment>& segments, std::vector<uint32_t>& link,
+                      std::vector<uint8_t>& visited, Chains& chains) {
+  for (uint32_t s = 0;s<segments.size();++s) {
+    for (const uint32_t l : segments[s].local) {
+      if (link[2*l] == none) link[2*l] = s; else link[2*l+1] = s;
+    }
+  }
+  const auto next = [&](uint32_t l, uint32_t s) {
+    return link[2*l] == s ? link[2*l+1] : link[2*l];
+  };
+
+  // returns whether the walk came back to the first segment
+  const auto walk = [&](uint32_t s, size_t entry) {
+    const uint32_t first = s;
+    chains.edges.push_back(segments[s].edges[entry]);
+    while (true) {
+      visited[s] = 1;
+      const size_t exit = 1-entry;
+      chains.edges.push_back(segments[s].edges[exit]);
+      const uint32_t l = segments[s].local[exit];
+      const uint32_t n = next(l, s);
+      if (n == none) return false;
+      if (n == first) {
+        chains.edges.pop_back();
+        return true;
+      }
+      entry = segments[n].local[0] == l ? 0 : 1;
+      s = n;
+    }
+  };
+
+  visited.assign(segments.size(), 0);
+  for (uint32_t s = 0;s<segments.size();++s) {
+    for (size_t end = 0;end<2;++end) {
+      if (!visited[s] && next(segments[s].local[end], s) == none) chains.finish(walk(s, end));
+    }
+  }
+  for (uint32_t s = 0;s<segments.size();++s) {
+    if (!visited[s]) chains.finish(walk(s, 0));
+  }
+
+  for (const Segment& segment : segments) {
+    for (const uint32_t l : segment.local) link[2*l] = link[2*l+1] = none;
+  }
+}
+
+// Joins the open chains of all tiles for one isovalue at the tile borders.
+static Chains stitch(const std::vector<std::vector<Chains>>& tileChains, size_t isovalue) {
+  std::vector<std::pair<const Chains*, size_t>> open;
+  for (const std::vector<Chains>& tile : tileChains) {
+    const Chains& chains = tile[isovalue];
+    for (size_t i = 0;i<chains.size();++i) {
+      if (!chains.closed[i]) open.push_back({&chains, i});
+    }
+  }
+  const auto endEdge = [&](size_t i, size_t end) {
+    const Chains& chains = *open[i].first;
+    const size_t c = open[i].second;
+    return end == 0 ? chains.edges[chains.begin(c)] : chains.edges[chains.end(c)-1];
+  };
+
+  // the (at most two) chain ends on every border edge, as 2*chain+end
+  std::unordered_map<uint64_t, std::array<uint32_t, 2>> ends;
+  ends.reserve(open.size()*2);
+  for (uint32_t i = 0;i<open.size();++i) {
+    for (uint32_t end = 0;end<2;++end) {
+      std::array<uint32_t, 2>& refs = ends.try_emplace(endEdge(i, end), std::array<uint32_t, 2>{none, none}).first->second;
+      (refs[0] == none ? refs[0] : refs[1]) = 2*i+end;
+    }
+  }
+  const auto other = [&](size_t i, size_t end) {
+    const std::array<uint32_t, 2>& refs = ends.find(endEdge(i, end))->second;
+    return refs[0] == 2*i+end ? refs[1] : refs[0];
+  };
+
+  Chains result;
+  std::vector<uint8_t> visited(open.size(), 0);
+  const auto walk = [&](size_t i, size_t entry) {
+    const size_t first = i;
+    bool skipFirst = false;
+    while (true) {
+      visited[i] = 1;
+      const Chains& chains = *open[i].first;
+      const size_t c = open[i].second;
+      // the edge joining two chains is only added once
+      if (entry == 0) {
+        result.edges.insert(result.edges.end(), chains.edges.begin()+chains.begin(c)+skipFirst,
+                            chains.edges.begin()+chains.end(c));
+      } else {
+        result.edges.insert(result.edges.end(), chains.edges.rbegin()+(chains.edges.size()-chains.end(c))+skipFirst,
+                            chains.edges.rbegin()+(chains.edges.size()-chains.begin(c)));
+      }
+      skipFirst = true;
+
+      const uint32_t n = other(i, 1-entry);
+      if (n == none) return false;
+      if (n/2 == first) {
+        result.edges.pop_back();
+        return true;
+      }
+      i = n/2;
+      entry = n%2;
+    }
+  };
+
+  for (size_t i = 0;i<open.size();++i) {
+    for (size_t end = 0;end<2;++end) {
+      if (!visited[i] && other(i, end) == none) result.finish(walk(i, end));
+    }
+  }
+  for (size_t i = 0;i<open.size();++i) {
+    if (!visited[i]) result.finish(walk(i, 0));
+  }
+  return result;
+}
+
+static float segmentDistance(const Vec2& p, const Vec2& a, const Vec2& b) {
+  const float dx = b.x-a.x;
+  const float dy = b.y-a.y;
+  const float lengthSq = dx*dx + dy*dy;
+  const float t = lengthSq > 0.0f ? std::clamp(((p.x-a.x)*dx + (p.y-a.y)*dy) / lengthSq, 0.0f, 1.0f) : 0.0f;
+  const float ex = a.x + t*dx - p.x;
+  const float ey = a.y + t*dy - p.y;
+  return std::sqrt(ex*ex + ey*ey);
+}
+
+// Douglas-Peucker, keeps the first and the last vertex
+static std::vector<Vec2> simplify(const std::vector<Vec2>& vertices, float tolerance) {
+  std::vector<uint8_t> keep(vertices.size(), 0);
+  keep.front() = keep.back() = 1;
+  std::vector<std::pair<size_t, size_t>> ranges{{0, vertices.size()-1}};
+  while (!ranges.empty()) {
+    const auto [first, last] = ranges.back();
+    ranges.pop_back();
+    float maxDistance = tolerance;
+    size_t farthest = first;
+    for (size_t i = first+1;i<last;++i) {
+      const float d = segmentDistance(vertices[i], vertices[first], vertices[last]);
+      if (d > maxDistance) {
+        maxDistance = d;
+        farthest = i;
+      }
+    }
+    if (farthest != first) {
+      keep[farthest] = 1;
+      ranges.push_back({first, farthest});
+      ranges.push_back({farthest, last});
+    }
+  }
+
+  std::vector<Vec2> result;
+  for (size_t i = 0;i<vertices.size();++i) {
+    if (keep[i]) result.push_back(vertices[i]);
+  }
+  return result;
+}
+
+Contours::Contours(const Image& image, const std::vector<uint8_t>& isovalues, bool useAsymptoticDecider,
+                   float tolerance, uint32_t tileSize) :
+  Contours(image.data.data(), image.width, image.height, image.componentCount, isovalues,
+           useAsymptoticDecider, tolerance, tileSize)
+{
+}
+
+Contours::Contours(const uint8_t* data, uint32_t imageWidth, uint32_t imageHeight, uint32_t componentCount,
+                   const std::vector<uint8_t>& isovalues, bool useAsymptoticDecider,
+                   float tolerance, uint32_t tileSize) :
+  segmentCount{0},
+  segmentSeconds{0},
+  stitchSeconds{0},
+  simplifySeconds{0}
+{
+  if (imageWidth < 2 || imageHeight < 2 || isovalues.empty()) return;
+
+  const size_t width = imageWidth;
+  const size_t components = componentCount;
+  const uint32_t tilesX = (imageWidth-1+tileSize-1)/tileSize;
+  const uint32_t tilesY = (imageHeight-1+tileSize-1)/tileSize;
+  const size_t tileCount = size_t(tilesX)*tilesY;
+
+  // whether any isovalue lies in [lo,hi), for the smallest and largest
+  // corner of a cell, ruling out cases 0 and 15 for all of them at once
+  std::vector<std::array<bool, 256>> crossed(256);
+  for (size_t lo = 0;lo<256;++lo) {
+    for (size_t hi = 0;hi<256;++hi) {
+      crossed[lo][hi] = std::any_of(isovalues.begin(), isovalues.end(),
+                                    [&](uint8_t i) {return lo <= i && i < hi;});
+    }
+  }
+
+  auto t1 = Clock::now();
+  std::vector<std::vector<Chains>> tileChains(tileCount, std::vector<Chains>(isovalues.size()));
+  size_t segments = 0;
+#pragma omp parallel reduction(+:segments)
+  {
+    std::vector<std::vector<Segment>> tileSegments(isovalues.size());
+    std::vector<uint32_t> link(4*size_t(tileSize+1)*(tileSize+1), none);
+    std::vector<uint8_t> visited;
+
+#pragma omp for schedule(dynamic)
+    for (int64_t t = 0;t<int64_t(tileCount);++t) {
+      const uint32_t u0 = uint32_t(t%tilesX)*tileSize;
+      const uint32_t v0 = uint32_t(t/tilesX)*tileSize;
+      const uint32_t u1 = std::min(u0+tileSize, imageWidth-1);
+      const uint32_t v1 = std::min(v0+tileSize, imageHeight-1);
+      const uint32_t stride = u1-u0+1;
+
+      for (uint32_t v = v0;v<v1;++v) {
+        const uint8_t* lower = data + v*width*components;
+        const uint8_t* upper = lower + width*components;
+        for (uint32_t u = u0;u<u1;++u) {
+          // the corners in the order of vertexPosTable in MS.inl
+          const std::array<uint8_t, 4> corners{upper[u*components], upper[(u+1)*components],
+                                               lower[(u+1)*components], lower[u*components]};
+          const uint8_t lo = std::min(std::min(corners[0], corners[1]), std::min(corners[2], corners[3]));
+          const uint8_t hi = std::max(std::max(corners[0], corners[1]), std::max(corners[2], corners[3]));
+          if (!crossed[lo][hi]) continue;
+
+          const uint64_t p = u + v*width;
+          const std::array<uint64_t, 4> edges{2*(p+width), 2*(p+1)+1, 2*p, 2*p+1};
+          const uint32_t lp = (u-u0) + (v-v0)*stride;
+          const std::array<uint32_t, 4> local{2*(lp+stride), 2*(lp+1)+1, 2*lp, 2*lp+1};
+
+          for (size_t k = 0;k<isovalues.size();++k) {
+            const uint8_t isovalue = isovalues[k];
+            // only cases other than 0 and 15
+            if (isovalue < lo || isovalue >= hi) continue;
+
+            std::array<size_t, 4> crossings;
+            size_t count = 0;
+            for (size_t i = 0;i<4;++i) {
+              if ((corners[i] > isovalue) != (corners[(i+1)%4] > isovalue)) crossings[count++] = i;
+            }
+
+            std::vector<Segment>& out = tileSegments[k];
+            if (count == 2) {
+              out.push_back({{edges[crossings[0]], edges[crossings[1]]}, {local[crossings[0]], local[crossings[1]]}});
+              continue;
+            }
+
+            // the saddles 5 and 10, paired like Isoline pairs them
+            const bool case5 = corners[0] > isovalue;
+            bool swap = false;
+            if (useAsymptoticDecider) {
+              const float decider{float(corners[3]*corners[1]-corners[2]*corners[0]) /
+                                  float(corners[1]+corners[3]-corners[2]-corners[0])};
+              swap = (decider < isovalue && case5) || (decider > isovalue && !case5);
+            }
+            if (swap) {
+              out.push_back({{edges[0], edges[3]}, {local[0], local[3]}});
+              out.push_back({{edges[1], edges[2]}, {local[1], local[2]}});
+            } else {
+              out.push_back({{edges[0], edges[1]}, {local[0], local[1]}});
+              out.push_back({{edges[2], edges[3]}, {local[2], local[3]}});
+            }
+          }
+        }
+      }
+
+      for (size_t k = 0;k<isovalues.size();++k) {
+        segments += tileSegments[k].size();
+        chainTile(tileSegments[k], link, visited, tileChains[size_t(t)][k]);
+        tileSegments[k].clear();
+      }
+    }
+  }
+  segmentCount = segments;
+  auto t2 = Clock::now();
+  segmentSeconds = std::chrono::duration<double>(t2-t1).count();
+
+  t1 = Clock::now();
+  std::vector<Chains> stitched(isovalues.size());
+#pragma omp parallel for schedule(dynamic)
+  for (int64_t k = 0;k<int64_t(isovalues.size());++k)
+    stitched[size_t(k)] = stitch(tileChains, size_t(k));
+  t2 = Clock::now();
+  stitchSeconds = std::chrono::duration<double>(t2-t1).count();
+
+  t1 = Clock::now();
+  struct Job {
+    const Chains* chains;
+    size_t index;
+    uint8_t isovalue;
+  };
+  std::vector<Job> jobs;
+  for (size_t k = 0;k<isovalues.size();++k) {
+    for (size_t i = 0;i<stitched[k].size();++i) jobs.push_back({&stitched[k], i, isovalues[k]});
+    for (const std::vector<Chains>& tile : tileChains) {
+      const Chains& chains = tile[k];
+      for (size_t i = 0;i<chains.size();++i) {
+        if (chains.closed[i]) jobs.push_back({&chains, i, isovalues[k]});
+      }
+    }
+  }
+
+  const float scaleX = 2.0f/imageWidth;
+  const float scaleY = 2.0f/imageHeight;
+  polylines.resize(jobs.size());
+#pragma omp parallel for schedule(dynamic, 256)
+  for (int64_t j = 0;j<int64_t(jobs.size());++j) {
+    const Job& job = jobs[size_t(j)];
+    Polyline& polyline = polylines[size_t(j)];
+    polyline.isovalue = job.isovalue;
+    polyline.closed = job.chains->closed[job.index];
+
+    // in pixels, where the tolerance applies
+    std::vector<Vec2> vertices;
+    vertices.reserve(job.chains->end(job.index)-job.chains->begin(job.index)+1);
+    for (size_t e = job.chains->begin(job.index);e<job.chains->end(job.index);++e) {
+      const uint64_t edge = job.chains->edges[e];
+      const uint64_t p = edge/2;
+      const uint64_t q = (edge & 1) ? p+width : p+1;
+      const float a = data[p*components];
+      const float b = data[q*components];
+      const float alpha = std::clamp((a-float(job.isovalue)) / (a-b), 0.0f, 1.0f);
+      const float x = float(p%width);
+      const float y = float(p/width);
+      vertices.push_back((edge & 1) ? Vec2{x, y+alpha} : Vec2{x+alpha, y});
+    }
+
+    if (tolerance > 0.0f && vertices.size() > 2) {
+      if (polyline.closed) {
+        vertices.push_back(vertices.front());
+        vertices = simplify(vertices, tolerance);
+        vertices.pop_back();
+        if (vertices.size() < 3) vertices.clear();
+      } else {
+        vertices = simplify(vertices, tolerance);
+      }
+    }
+
+    for (Vec2& v : vertices) v = Vec2{(v.x+0.5f)*scaleX-1.0f, (v.y+0.5f)*scaleY-1.0f};
+    polyline.vertices = std::move(vertices);
+  }
+  polylines.erase(std::remove_if(polylines.begin(), polylines.end(),
+                                 [](const Polyline& p) {return p.vertices.empty();}),
+                  polylines.end());
+  t2 = Clock::now();
+  simplifySeconds = std::chrono::duration<double>(t2-t1).count();
+}
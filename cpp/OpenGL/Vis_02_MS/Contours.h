@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Image.h>
+#include <Vec2.h>
+
+struct Polyline {
+  uint8_t isovalue;
+  // a closed polyline does not repeat its first vertex at the end
+  bool closed;
+  std::vector<Vec2> vertices;
+};
+
+// Marching squares over the first component of an image for any number of
+// isovalues in one pass, producing connected polylines instead of the line
+// list of Isoline. Vertices are in the same [-1,1] coordinates as there.
+//
+// The image is split into tiles of cells processed in parallel. Every
+// tile emits its segments, identified by the grid edges they cross, and
+// joins them to chains, so only chains ending on a tile border are left
+// to stitch through a hash map over the edge IDs. Chains ending on the
+// border of the image stay open polylines. With a tolerance in pixels
+// above zero the polylines are simplified after Douglas and Peucker,
+// closed ones that shrink below three vertices are dropped.
+struct Contours {
+  Contours(const Image& image, const std::vector<uint8_t>& isovalues, bool useAsymptoticDecider,
+           float tolerance=0.0f, uint32_t tileSize=256);
+  // interleaved pixels in rows from the bottom, as in Image
+  Contours(const uint8_t* data, uint32_t width, uint32_t height, uint32_t componentCount,
+           const std::vector<uint8_t>& isovalues, bool useAsymptoticDecider,
+           float tolerance=0.0f, uint32_t tileSize=256);
+
+  std::vector<Polyline> polylines;
+
+  size_t segmentCount;
+  double segmentSeconds;
+  double stitchSeconds;
+  double simplifySeconds;
+};
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include <Vec2.h>
+
+#include "MS.inl"
+#include "Contours.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Extracts contours of a synthetic elevation map with Contours and with
+// the line list code of Isoline, one isovalue at a time, and checks that
+// the polylines use exactly the segments of Isoline, that consecutive
+// vertices are in neighbouring cells and that open polylines end on the
+// image border.
+//
+//   msBench [sizes...]   defaults 4096 16384
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// Isoline on a single channel image without the Image class
+static std::vector<Vec2> legacyIsoline(const std::vector<uint8_t>& image, uint32_t width, uint32_t height,
+                                       uint8_t isovalue, bool useAsymptoticDecider) {
+  std::vector<Vec2> vertices;
+  for(size_t v = 0; v < height-1; v++) {
+    for(size_t u = 0; u < width-1; u++) {
+      std::array<uint8_t, 4> data{};
+      for (uint8_t i = 0;i<4;++i) {
+        const size_t index = (u+size_t(vertexPosTable[i][0])) +
+                             (v+size_t(vertexPosTable[i][1])) * width;
+        data[i]    = image[index];
+      }
+
+      uint8_t msCase{0};
+      for (uint8_t i = 0;i<4;++i) msCase += uint8_t(data[i] > isovalue) * (1<<i);
+      if (msCase == 0 || msCase == 15) continue;
+
+      const Vec2 squareOffset{
+        (float(u)+0.5f)/(width),
+        (float(v)+0.5f)/(height)
+      };
+
+      for (uint8_t i = 0;i<4;++i) {
+        if(edgeTable[msCase] & 1<<i) {
+          const std::array<uint8_t,2>& index = edgeToVertexTable[i];
+          const float alpha = std::clamp((float(data[index[0]])-float(isovalue)) / (float(data[index[0]])-float(data[index[1]])),0.0f,1.0f);
+          const Vec2 positionInSquare{vertexPosTable[index[0]] + ( vertexPosTable[index[1]]-vertexPosTable[index[0]]) * alpha};
+          vertices.push_back((squareOffset + positionInSquare/Vec2{float(width), float(height)})*2.0f-Vec2(1.0f,1.0f));
+        }
+      }
+
+      if (useAsymptoticDecider && (msCase == 5 || msCase == 10)) {
+        const float decider{float(data[3]*data[1]-data[2]*data[0]) / float(data[1]+data[3]-data[2]-data[0])};
+        if ((decider < isovalue && msCase == 5) || (decider > isovalue && msCase == 10)) {
+          std::swap(vertices[vertices.size()-1],vertices[vertices.size()-3]);
+        }
+      }
+    }
+  }
+  return vertices;
+}
+
+// hills a few hundred pixels across, independent of the image size
+static std::vector<uint8_t> elevationMap(uint32_t size) {
+  std::vector<uint8_t> image(size_t(size)*size);
+#pragma omp parallel for
+  for (int64_t y = 0;y<int64_t(size);++y) {
+    for (uint32_t x = 0;x<size;++x) {
+      const float v = 128.0f + 60.0f*std::sin(x*0.011f + 0.3f)*std::cos(y*0.013f)
+                             + 40.0f*std::sin((x+y)*0.0047f)
+                             + 20.0f*std::sin(x*0.031f)*std::sin(y*0.027f + 1.0f);
+      image[x+size_t(y)*size] = uint8_t(std::clamp(v, 0.0f, 255.0f));
+    }
+  }
+  return image;
+}
+
+static bool check(const Contours& contours, uint32_t size, size_t legacySegments) {
+  if (contours.segmentCount != legacySegments) return false;
+  size_t segments = 0;
+  const float scale = size/2.0f;
+  const auto pixel = [&](const Vec2& v) {return Vec2{(v.x+1.0f)*scale-0.5f, (v.y+1.0f)*scale-0.5f};};
+  for (const Polyline& polyline : contours.polylines) {
+    const std::vector<Vec2>& v = polyline.vertices;
+    segments += polyline.closed ? v.size() : v.size()-1;
+    for (size_t i = 0;i<v.size();++i) {
+      if (i+1 == v.size() && !polyline.closed) break;
+      const Vec2 a = pixel(v[i]);
+      const Vec2 b = pixel(v[(i+1)%v.size()]);
+      if (std::abs(a.x-b.x) > 1.001f || std::abs(a.y-b.y) > 1.001f) return false;
+    }
+    if (!polyline.closed) {
+      for (const Vec2& end : {pixel(v.front()), pixel(v.back())}) {
+        if (end.x > 0.001f && end.x < size-1.001f && end.y > 0.001f && end.y < size-1.001f) return false;
+      }
+    }
+  }
+  return segments == contours.segmentCount;
+}
+
+int main(int argc, char** argv) {
+  std::vector<uint32_t> sizes;
+  for (int i = 1;i<argc;++i) sizes.push_back(uint32_t(atoi(argv[i])));
+  if (sizes.empty()) sizes = {4096, 16384};
+
+  const std::vector<uint8_t> isovalues{64, 96, 128, 160, 192};
+  for (const uint32_t size : sizes) {
+    const std::vector<uint8_t> image = elevationMap(size);
+    std::cout << size << "x" << size << ", " << isovalues.size() << " isovalues" << std::endl;
+
+    auto t1 = Clock::now();
+    size_t legacySegments = 0;
+    for (const uint8_t isovalue : isovalues)
+      legacySegments += legacyIsoline(image, size, size, isovalue, true).size()/2;
+    auto t2 = Clock::now();
+    const double legacy = seconds(t1,t2);
+
+    t1 = Clock::now();
+    const Contours contours{image.data(), size, size, 1, isovalues, true};
+    t2 = Clock::now();
+    const double total = seconds(t1,t2);
+
+    size_t closed = 0;
+    for (const Polyline& polyline : contours.polylines) closed += polyline.closed;
+    const bool ok = check(contours, size, legacySegments);
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "  Isoline:  " << legacy << " s, " << std::setprecision(1) << legacySegments/legacy/1e6
+              << " M segments/s, " << legacySegments << " segments" << std::endl
+              << "  Contours: " << std::setprecision(3) << total << " s, segments " << contours.segmentSeconds
+              << " s (" << std::setprecision(1) << contours.segmentCount/contours.segmentSeconds/1e6
+              << " M segments/s), stitching " << std::setprecision(3) << contours.stitchSeconds
+              << " s, placing " << contours.simplifySeconds << " s" << std::endl
+              << "  " << contours.polylines.size() << " polylines, " << closed << " closed, "
+              << (ok ? "consistent with" : "DIFFERENT FROM") << " Isoline" << std::endl;
+    if (!ok) return EXIT_FAILURE;
+
+    for (const float tolerance : {0.25f, 1.0f}) {
+      const Contours simplified{image.data(), size, size, 1, isovalues, true, tolerance};
+      size_t vertices = 0;
+      for (const Polyline& polyline : simplified.polylines) vertices += polyline.vertices.size();
+      std::cout << "  tolerance " << std::setprecision(2) << tolerance << " px: " << vertices
+                << " vertices (" << std::setprecision(1) << 100.0*vertices/contours.segmentCount
+                << "%), simplification " << std::setprecision(3) << simplified.simplifySeconds
+                << " s, " << simplified.polylines.size() << " polylines" << std::endl;
+    }
+  }
+  return EXIT_SUCCESS;
+}
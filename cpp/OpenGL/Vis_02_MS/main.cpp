@@ -1,6 +1,6 @@
 #include <GLApp.h>
 #include <bmp.h>
-#include "MS.h"
+#include "Contours.h"
 
 class MyGLApp : public GLApp {
 public:
@@ -8,6 +8,7 @@ public:
   Image image = BMP::load("image.bmp");
   std::vector<uint8_t> isovalues{128};
   bool useAsymptoticDecider{true};
+  float tolerance{0.0f};
   
   virtual void init() override {
     glEnv.setTitle("Marching Squares demo");
@@ -19,17 +20,23 @@ public:
   
   void extractIsoline() {
     data.clear();
-    for (const uint8_t isovalue : isovalues) {
-      Isoline s{image, isovalue, useAsymptoticDecider};
-      for (const Vec2& v : s.vertices) {
-        data.push_back(v[0]);
-        data.push_back(v[1]);
-        data.push_back(0);
-         
-        data.push_back(0.0f);
-        data.push_back(0.0f);
-        data.push_back(1.0f);
-        data.push_back(1.0f);
+    const Contours contours{image, isovalues, useAsymptoticDecider, tolerance};
+    for (const Polyline& polyline : contours.polylines) {
+      // closed polylines in blue, those ending on the border in green
+      const Vec4 color = polyline.closed ? Vec4{0.0f,0.0f,1.0f,1.0f} : Vec4{0.0f,1.0f,0.0f,1.0f};
+      const size_t count = polyline.vertices.size();
+      const size_t segments = polyline.closed ? count : count-1;
+      for (size_t i = 0;i<segments;++i) {
+        for (const Vec2& v : {polyline.vertices[i], polyline.vertices[(i+1)%count]}) {
+          data.push_back(v[0]);
+          data.push_back(v[1]);
+          data.push_back(0);
+
+          data.push_back(color.r);
+          data.push_back(color.g);
+          data.push_back(color.b);
+          data.push_back(color.a);
+        }
       }
     }
   }
@@ -55,6 +62,11 @@ public:
           isovalues.push_back(isovalues.back());
           extractIsoline();
           break;
+        case GLFW_KEY_S:
+          tolerance = tolerance > 0.0f ? 0.0f : 1.0f;
+          std::cout << "Simplification is " << (tolerance > 0.0f ? "enabled" : "disabled") << std::endl;
+          extractIsoline();
+          break;
         case GLFW_KEY_C:
           isovalues.clear();
           isovalues.push_back(128);
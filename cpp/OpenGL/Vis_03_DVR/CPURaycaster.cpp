@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cmath>
+
+#include "CPURaycaster.h"
+
+namespace {
+  // trilinear interpolation within the bricks of one level, the ghost voxels
+  // after every brick hold the upper neighbours, so a sample never needs
+  // more than one brick and the last one is kept until the ray leaves it
+  class BrickSampler {
+  public:
+    BrickSampler(const BrickedVolume& volume, size_t level) :
+      volume(volume),
+      level(level),
+      info(volume.getLevel(level)),
+      normalization(1.0f/float(volume.getMaxValue()))
+    {}
+
+    float sample(const Vec3& tc) {
+      // texel centers as in OpenGL
+      const float px = std::clamp(tc.x*float(info.width)  - 0.5f, 0.0f, float(info.width-1));
+      const float py = std::clamp(tc.y*float(info.height) - 0.5f, 0.0f, float(info.height-1));
+      const float pz = std::clamp(tc.z*float(info.depth)  - 0.5f, 0.0f, float(info.depth-1));
+      const uint32_t ix = uint32_t(px);
+      const uint32_t iy = uint32_t(py);
+      const uint32_t iz = uint32_t(pz);
+      const float fx = px-float(ix);
+      const float fy = py-float(iy);
+      const float fz = pz-float(iz);
+
+      const uint32_t bx = ix / BrickedVolume::brickSize;
+      const uint32_t by = iy / BrickedVolume::brickSize;
+      const uint32_t bz = iz / BrickedVolume::brickSize;
+      const size_t index = info.brickIndex(bx, by, bz);
+      if (index != currentIndex) {
+        brick = volume.getBrick(level, bx, by, bz);
+        currentIndex = index;
+      }
+
+      const int32_t lx = int32_t(ix - bx*BrickedVolume::brickSize);
+      const int32_t ly = int32_t(iy - by*BrickedVolume::brickSize);
+      const int32_t lz = int32_t(iz - bz*BrickedVolume::brickSize);
+      const float v00 = lerp(value(lx, ly,   lz),   value(lx+1, ly,   lz),   fx);
+      const float v10 = lerp(value(lx, ly+1, lz),   value(lx+1, ly+1, lz),   fx);
+      const float v01 = lerp(value(lx, ly,   lz+1), value(lx+1, ly,   lz+1), fx);
+      const float v11 = lerp(value(lx, ly+1, lz+1), value(lx+1, ly+1, lz+1), fx);
+      return lerp(lerp(v00, v10, fy), lerp(v01, v11, fy), fz) * normalization;
+    }
+
+  private:
+    const BrickedVolume& volume;
+    const size_t level;
+    const BrickLevel& info;
+    const float normalization;
+    const uint8_t* brick{nullptr};
+    size_t currentIndex{size_t(-1)};
+
+    float value(int32_t x, int32_t y, int32_t z) const {
+      const size_t i = BrickedVolume::storedIndex(x, y, z);
+      if (volume.getBytesPerVoxel() == 1) return float(brick[i]);
+      return float(brick[2*i] | (brick[2*i+1] << 8));
+    }
+
+    static float lerp(float a, float b, float alpha) {
+      return a + (b-a)*alpha;
+    }
+  };
+
+  // entry and exit parameter of the ray o + t * d through the unit cube
+  bool intersectCube(const Vec3& o, const Vec3& d, float& tEntry, float& tExit) {
+    tEntry = 0.0f;
+    tExit = 1.0f;
+    for (size_t axis = 0; axis < 3; ++axis) {
+      if (std::fabs(d[axis]) < 1e-12f) {
+        if (o[axis] < -0.5f || o[axis] > 0.5f) return false;
+        continue;
+      }
+      const float t0 = (-0.5f - o[axis]) / d[axis];
+      const float t1 = ( 0.5f - o[axis]) / d[axis];
+      tEntry = std::max(tEntry, std::min(t0, t1));
+      tExit = std::min(tExit, std::max(t0, t1));
+    }
+    return tEntry < tExit;
+  }
+}
+
+CPURaycaster::CPURaycaster(const BrickedVolume& volume) :
+  volume(volume)
+{
+}
+
+Image CPURaycaster::render(const Mat4& mvp, uint32_t width, uint32_t height, size_t level,
+                           float smoothStepStart, float smoothStepWidth, const Vec3& background) const {
+  Image image{width, height, 4};
+  const Mat4 inverse = Mat4::inverse(mvp);
+  const BrickLevel& info = volume.getLevel(level);
+  const float sampleCount = float(std::max(info.width, std::max(info.height, info.depth)) * 3);
+
+  const uint32_t tileSize = 16;
+  const uint32_t tilesX = (width+tileSize-1)/tileSize;
+  const uint32_t tilesY = (height+tileSize-1)/tileSize;
+
+  #pragma omp parallel
+  {
+    BrickSampler sampler{volume, level};
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t tile = 0; tile < int64_t(tilesX*tilesY); ++tile) {
+      const uint32_t x0 = uint32_t(tile % tilesX) * tileSize;
+      const uint32_t y0 = uint32_t(tile / tilesX) * tileSize;
+      for (uint32_t y = y0; y < std::min(y0+tileSize, height); ++y) {
+        for (uint32_t x = x0; x < std::min(x0+tileSize, width); ++x) {
+          const float ndcX = (float(x)+0.5f)/float(width)*2.0f-1.0f;
+          const float ndcY = (float(y)+0.5f)/float(height)*2.0f-1.0f;
+          const Vec3 nearPoint = inverse * Vec3{ndcX, ndcY, -1.0f};
+          const Vec3 farPoint  = inverse * Vec3{ndcX, ndcY,  1.0f};
+          const Vec3 ray = farPoint - nearPoint;
+
+          // front to back compositing as in backFS.glsl
+          float color{0.0f};
+          float alpha{0.0f};
+          float tEntry, tExit;
+          if (intersectCube(nearPoint, ray, tEntry, tExit)) {
+            const Vec3 entry = nearPoint + ray*tEntry + Vec3{0.5f, 0.5f, 0.5f};
+            const Vec3 exit  = nearPoint + ray*tExit + Vec3{0.5f, 0.5f, 0.5f};
+            const Vec3 step = Vec3::normalize(exit-entry) / sampleCount;
+            const size_t steps = size_t((exit-entry).length() * sampleCount) + 1;
+            Vec3 current = entry;
+            for (size_t i = 0; i < steps && alpha <= 0.95f; ++i) {
+              float v = std::clamp((sampler.sample(current) - smoothStepStart) / smoothStepWidth, 0.0f, 1.0f);
+              v = v*v*(3.0f-2.0f*v);
+              color += (1.0f-alpha) * v * v;
+              alpha += (1.0f-alpha) * v;
+              current = current + step;
+            }
+          }
+
+          // the blending of the GPU path: source alpha, one minus source alpha
+          const size_t index = 4*(size_t(x) + size_t(y)*width);
+          for (size_t c = 0; c < 3; ++c) {
+            const float blended = color*alpha + background[c]*(1.0f-alpha);
+            image.data[index+c] = uint8_t(std::clamp(blended, 0.0f, 1.0f)*255.0f);
+          }
+          image.data[index+3] = 255;
+        }
+      }
+    }
+  }
+  return image;
+}
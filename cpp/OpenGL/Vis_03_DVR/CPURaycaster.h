@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Mat4.h>
+#include <Image.h>
+#include <BrickedVolume.h>
+
+// Software version of backFS.glsl for volumes that do not fit into GPU
+// memory, the rays sample a bricked volume at a chosen level of detail so
+// only the bricks they pass are paged in.
+class CPURaycaster {
+public:
+  CPURaycaster(const BrickedVolume& volume);
+
+  // mvp maps the unit cube around the origin to clip space, like the one
+  // of the cube the shaders render, the result is blended over background
+  Image render(const Mat4& mvp, uint32_t width, uint32_t height, size_t level,
+               float smoothStepStart, float smoothStepWidth, const Vec3& background) const;
+
+private:
+  const BrickedVolume& volume;
+};
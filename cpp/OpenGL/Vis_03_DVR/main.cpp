@@ -2,8 +2,12 @@
 #include <GLFramebuffer.h>
 #include <Tesselation.h>
 #include <ArcBall.h>
+#include <BrickedVolume.h>
+#include <memory>
+#include <fstream>
 
 #include "QVis.h"
+#include "CPURaycaster.h"
 
 class GLIPApp : public GLApp {
 public:
@@ -17,6 +21,7 @@ public:
 
   void loadVolume() {
     volume = QVis{filenames[currentFile]}.volume;
+    bricked.reset();
     volumeExtend = volume.scale*Vec3{float(volume.width),float(volume.height),float(volume.depth)}/volume.maxSize;
 
     volumeTex.setData(volume.data,
@@ -92,9 +97,42 @@ public:
     GL(glDisable(GL_BLEND));
   }
 
+  // the CPU fallback reads a bricked copy of the volume, it is converted
+  // next to the .dat file the first time it is needed
+  void openBricked() {
+    const std::string& datFilename = filenames[currentFile];
+    const std::string filename = datFilename.substr(0, datFilename.find_last_of('.')) + ".bvol";
+    if (!std::ifstream{filename}) {
+      BrickedVolumeWriter writer{filename, uint32_t(volume.width), uint32_t(volume.height),
+                                 uint32_t(volume.depth), 1, volume.scale};
+      for (size_t z = 0;z<volume.depth;++z) writer.addSlice(volume.data.data() + z*volume.width*volume.height);
+      writer.finish();
+    }
+    bricked = std::make_unique<BrickedVolume>(filename, size_t(512) << 20);
+    level = std::min(level, bricked->getLevelCount()-1);
+  }
+
+  void raycastCPU() {
+    const Dimensions dim = glEnv.getFramebufferSize();
+    GL(glViewport(0, 0, GLsizei(dim.width), GLsizei(dim.height)));
+    GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+
+    const Image image = CPURaycaster{*bricked}.render(mvp, dim.width, dim.height, level,
+                                                      stepStart, stepWidth, Vec3{0.0f, 0.0f, 0.5f});
+    GL(glDisable(GL_CULL_FACE));
+    setDrawProjection(Mat4{});
+    setDrawTransform(Mat4{});
+    drawImage(image, {-1.0f, -1.0f}, {1.0f, 1.0f});
+    GL(glEnable(GL_CULL_FACE));
+  }
+
   virtual void draw() override {
-    renderRayEntryTex();
-    raycast();
+    if (cpuFallback) {
+      raycastCPU();
+    } else {
+      renderRayEntryTex();
+      raycast();
+    }
   }
   
   virtual void keyboard(int key, int scancode, int action, int mods) override {
@@ -107,6 +145,13 @@ public:
           currentFile = (currentFile + 1) % filenames.size();
           loadVolume();
           break;
+        case GLFW_KEY_C:
+          cpuFallback = !cpuFallback;
+          if (cpuFallback && !bricked) openBricked();
+          break;
+        case GLFW_KEY_L:
+          if (bricked) level = (level + 1) % bricked->getLevelCount();
+          break;
         case GLFW_KEY_R:
           rotation = Mat4{};
           stepStart = 0.12f;
@@ -160,6 +205,9 @@ private:
   Volume volume;
   Vec3 volumeExtend;
   GLTexture3D volumeTex{GL_LINEAR, GL_LINEAR,GL_CLAMP_TO_BORDER,GL_CLAMP_TO_BORDER,GL_CLAMP_TO_BORDER};
+  std::unique_ptr<BrickedVolume> bricked;
+  bool cpuFallback{false};
+  size_t level{0};
   
   ArcBall arcball{{512, 512}};
   Mat4 rotation;
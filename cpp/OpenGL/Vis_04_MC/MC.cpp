@@ -2,56 +2,540 @@
 #include "MC.inl"
 #include <algorithm> // std::clamp
 
-Isosurface::Isosurface(const Volume& volume, uint8_t isovalue) {
-  for (size_t l = 0; l < volume.depth-1; ++l) {
-    for(size_t v = 0; v < volume.height-1; v++) {
-      for(size_t u = 0; u < volume.width-1; u++) {
-      
-        // fetch data from the volume
-        std::array<uint8_t, 8> data{};
-        std::array<Vec3, 8> normals{};
-        for (uint8_t i = 0;i<8;++i) {
-          const size_t index = (u+size_t(vertexPosTable[i][0])) +
-                               (v+size_t(vertexPosTable[i][1])) * volume.width +
-                               (l+size_t(vertexPosTable[i][2])) * volume.width*volume.height;
-          data[i]    = volume.data[index];
-          normals[i] = volume.normals[index];
+const size_t MinMaxOctree::blockSize;
+
+MinMaxOctree::MinMaxOctree(const Volume& volume) {
+  // a block covers blockSize cells, i.e. blockSize+1 voxels along each axis
+  Level base;
+  base.sizeX = std::max<size_t>(1, (volume.width  + blockSize-2) / blockSize);
+  base.sizeY = std::max<size_t>(1, (volume.height + blockSize-2) / blockSize);
+  base.sizeZ = std::max<size_t>(1, (volume.depth  + blockSize-2) / blockSize);
+  base.minValues.resize(base.sizeX*base.sizeY*base.sizeZ);
+  base.maxValues.resize(base.sizeX*base.sizeY*base.sizeZ);
+
+  const size_t sliceSize = volume.width*volume.height;
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t bz = 0; bz < int64_t(base.sizeZ); ++bz) {
+    const size_t z0 = size_t(bz)*blockSize;
+    const size_t z1 = std::min(z0+blockSize, volume.depth-1);
+    for (size_t by = 0; by < base.sizeY; ++by) {
+      const size_t y0 = by*blockSize;
+      const size_t y1 = std::min(y0+blockSize, volume.height-1);
+      for (size_t bx = 0; bx < base.sizeX; ++bx) {
+        const size_t x0 = bx*blockSize;
+        const size_t x1 = std::min(x0+blockSize, volume.width-1);
+
+        uint8_t minValue{255};
+        uint8_t maxValue{0};
+        for (size_t z = z0; z <= z1; ++z) {
+          for (size_t y = y0; y <= y1; ++y) {
+            const uint8_t* row = volume.data.data() + y*volume.width + z*sliceSize;
+            for (size_t x = x0; x <= x1; ++x) {
+              minValue = std::min(minValue, row[x]);
+              maxValue = std::max(maxValue, row[x]);
+            }
+          }
         }
-        
-        // classify vertices and compute case index
-        uint8_t mcCase{0};
-        for (uint8_t i = 0;i<8;++i) mcCase += uint8_t(data[i] < isovalue) * (1<<i);
-        
-        // bail out on empty cases
-        if (mcCase == 0 || mcCase == 255) continue;
-        
-        // compute offset to current cube
-        const Vec3 cubeOffset{
-          float(u)/volume.maxSize-0.5f*float(volume.width)/float(volume.maxSize),
-          float(v)/volume.maxSize-0.5f*float(volume.height)/float(volume.maxSize),
-          float(l)/volume.maxSize-0.5f*float(volume.depth)/float(volume.maxSize)
-        };
-        
-        // interpolate vertices and normals
-        std::array<Vertex, 12> trisVertices;
-        for (uint8_t i = 0;i<12;++i) {
-          if(edgeTable[mcCase] & 1<<i) {
-            const std::array<uint8_t,2>& index = edgeToVertexTable[i];
-            const float alpha = std::clamp((float(data[index[0]])-float(isovalue)) / (float(data[index[0]])-float(data[index[1]])),0.0f,1.0f);
-            const Vec3 positionInCube{vertexPosTable[index[0]] + ( vertexPosTable[index[1]]-vertexPosTable[index[0]]) * alpha};
-            const Vec3 normal{normals[index[0]] + (normals[index[1]]-normals[index[0]]) * alpha};
-            trisVertices[i] = Vertex{Vec3{volume.scale * (cubeOffset + positionInCube/float(volume.maxSize))}, Vec3::normalize(normal)};
+        const size_t index = bx + base.sizeX*(by + base.sizeY*size_t(bz));
+        base.minValues[index] = minValue;
+        base.maxValues[index] = maxValue;
+      }
+    }
+  }
+  levels.push_back(std::move(base));
+
+  // merge 2x2x2 nodes until a single root remains
+  while (levels.back().sizeX > 1 || levels.back().sizeY > 1 || levels.back().sizeZ > 1) {
+    const Level& child = levels.back();
+    Level parent;
+    parent.sizeX = (child.sizeX+1)/2;
+    parent.sizeY = (child.sizeY+1)/2;
+    parent.sizeZ = (child.sizeZ+1)/2;
+    parent.minValues.resize(parent.sizeX*parent.sizeY*parent.sizeZ, 255);
+    parent.maxValues.resize(parent.sizeX*parent.sizeY*parent.sizeZ, 0);
+    for (size_t z = 0; z < child.sizeZ; ++z) {
+      for (size_t y = 0; y < child.sizeY; ++y) {
+        for (size_t x = 0; x < child.sizeX; ++x) {
+          const size_t c = x + child.sizeX*(y + child.sizeY*z);
+          const size_t p = x/2 + parent.sizeX*(y/2 + parent.sizeY*(z/2));
+          parent.minValues[p] = std::min(parent.minValues[p], child.minValues[c]);
+          parent.maxValues[p] = std::max(parent.maxValues[p], child.maxValues[c]);
+        }
+      }
+    }
+    levels.push_back(std::move(parent));
+  }
+}
+
+void MinMaxOctree::collect(size_t level, size_t x, size_t y, size_t z, uint8_t isovalue,
+                           std::vector<std::vector<uint32_t>>& blocks) const {
+  const Level& l = levels[level];
+  const size_t index = x + l.sizeX*(y + l.sizeY*z);
+  // same classification as the cells: inside means below the isovalue
+  if (l.minValues[index] >= isovalue || l.maxValues[index] < isovalue) return;
+
+  if (level == 0) {
+    blocks[z].push_back(uint32_t(x + y*l.sizeX));
+    return;
+  }
+
+  const Level& child = levels[level-1];
+  for (size_t cz = 2*z; cz < std::min(2*z+2, child.sizeZ); ++cz) {
+    for (size_t cy = 2*y; cy < std::min(2*y+2, child.sizeY); ++cy) {
+      for (size_t cx = 2*x; cx < std::min(2*x+2, child.sizeX); ++cx) {
+        collect(level-1, cx, cy, cz, isovalue, blocks);
+      }
+    }
+  }
+}
+
+std::vector<std::vector<uint32_t>> MinMaxOctree::activeBlocks(uint8_t isovalue) const {
+  std::vector<std::vector<uint32_t>> blocks(getBlocksZ());
+  collect(levels.size()-1, 0, 0, 0, isovalue, blocks);
+  // walk the blocks in memory order
+  for (std::vector<uint32_t>& layer : blocks) std::sort(layer.begin(), layer.end());
+  return blocks;
+}
+
+namespace {
+  // a cell edge of MC.inl as its axis and the grid point at its lower end
+  // relative to the cell, neighbouring cells thus agree on shared edges
+  struct GridEdge {
+    uint8_t axis;
+    uint8_t dx;
+    uint8_t dy;
+    uint8_t dz;
+  };
+
+  std::array<GridEdge,12> computeGridEdges() {
+    std::array<GridEdge,12> edges;
+    for (size_t i = 0;i<12;++i) {
+      const Vec3& a = vertexPosTable[edgeToVertexTable[i][0]];
+      const Vec3& b = vertexPosTable[edgeToVertexTable[i][1]];
+      edges[i] = GridEdge{
+        uint8_t(a.x != b.x ? 0 : (a.y != b.y ? 1 : 2)),
+        uint8_t(std::min(a.x, b.x)),
+        uint8_t(std::min(a.y, b.y)),
+        uint8_t(std::min(a.z, b.z))
+      };
+    }
+    return edges;
+  }
+
+  const std::array<GridEdge,12> gridEdges{computeGridEdges()};
+
+  // marks a reference to a vertex of the next slab in Slab::indices
+  const uint32_t pendingFlag{0x80000000u};
+
+  // the mesh of one layer of blocks
+  struct Slab {
+    std::vector<Vertex> vertices;
+    // local vertex index, or pendingFlag | index into pending
+    std::vector<uint32_t> indices;
+    // plane keys of vertices on the top plane, those belong to the next slab
+    std::vector<uint64_t> pending;
+    // plane key and vertex of everything created on the bottom plane
+    std::vector<std::pair<uint64_t,uint32_t>> bottom;
+    // global edge key and vertex of everything created on the faces of a
+    // brick, see extractBrick
+    std::vector<std::pair<uint64_t,uint32_t>> boundary;
+  };
+
+  // maps the grid of the extracted volume into the normalized coordinates of
+  // the whole volume, for a brick the extracted volume is a small part of it
+  struct Frame {
+    Vec3 offset;
+    Vec3 center;
+    float maxSize;
+    Vec3 scale;
+    size_t globalWidth;
+    size_t globalHeight;
+  };
+
+  struct CacheEntry {
+    uint32_t stamp;
+    uint32_t ref;
+  };
+
+  class SlabExtractor {
+  public:
+    SlabExtractor(const Volume& volume, uint8_t isovalue, size_t blocksX) :
+      volume(volume),
+      isovalue(isovalue),
+      blocksX(blocksX),
+      sliceSize(volume.width*volume.height),
+      frame{Vec3{0.0f, 0.0f, 0.0f},
+            Vec3{0.5f*float(volume.width), 0.5f*float(volume.height), 0.5f*float(volume.depth)},
+            float(volume.maxSize), volume.scale, volume.width, volume.height}
+    {
+      for (uint8_t i = 0;i<8;++i) {
+        cornerOffsets[i] = size_t(vertexPosTable[i][0]) +
+                           size_t(vertexPosTable[i][1]) * volume.width +
+                           size_t(vertexPosTable[i][2]) * sliceSize;
+      }
+    }
+
+    void extract(size_t slabIndex, size_t slabCount, const std::vector<uint32_t>& blocks, Slab& target) {
+      if (blocks.empty()) return;
+
+      const size_t first = slabIndex*MinMaxOctree::blockSize;
+      begin(target, slabIndex == 0, slabIndex+1 == slabCount,
+            first, std::min(first+MinMaxOctree::blockSize, volume.depth-1));
+
+      for (size_t z = z0; z < z1; ++z) {
+        for (const uint32_t block : blocks) {
+          const size_t x0 = (block % blocksX) * MinMaxOctree::blockSize;
+          const size_t y0 = (block / blocksX) * MinMaxOctree::blockSize;
+          const size_t x1 = std::min(x0+MinMaxOctree::blockSize, volume.width-1);
+          const size_t y1 = std::min(y0+MinMaxOctree::blockSize, volume.height-1);
+          for (size_t y = y0; y < y1; ++y) {
+            for (size_t x = x0; x < x1; ++x) {
+              processCell(x, y, z);
+            }
           }
         }
-       
-        // add triangles to isosurface
-        size_t i = 0;
-        while (trisTable[mcCase][i] != N_E) {
-          vertices.push_back(trisVertices[trisTable[mcCase][i++]]);
-          vertices.push_back(trisVertices[trisTable[mcCase][i++]]);
-          vertices.push_back(trisVertices[trisTable[mcCase][i++]]);
+
+        // the top plane becomes the bottom one, invalidate the other caches
+        bottomPlane ^= 1;
+        planeStamps[bottomPlane^1] = ++stampCounter;
+        zStamp = ++stampCounter;
+      }
+
+      std::sort(target.bottom.begin(), target.bottom.end());
+    }
+
+    // extracts the cells [first, first+count) of a brick copied into the
+    // volume, the vertices on the faces of that box are listed in
+    // target.boundary so the bricks can be welded afterwards
+    void extractBrick(const Frame& brickFrame, const std::array<size_t,3>& first,
+                      const std::array<size_t,3>& count, Slab& target) {
+      frame = brickFrame;
+      boxFirst = first;
+      boxLast = {first[0]+count[0], first[1]+count[1], first[2]+count[2]};
+      trackBoundary = true;
+      begin(target, true, true, boxFirst[2], boxLast[2]);
+
+      for (size_t z = z0; z < z1; ++z) {
+        for (size_t y = boxFirst[1]; y < boxLast[1]; ++y) {
+          for (size_t x = boxFirst[0]; x < boxLast[0]; ++x) {
+            processCell(x, y, z);
+          }
+        }
+        bottomPlane ^= 1;
+        planeStamps[bottomPlane^1] = ++stampCounter;
+        zStamp = ++stampCounter;
+      }
+    }
+
+  private:
+    const Volume& volume;
+    const uint8_t isovalue;
+    const size_t blocksX;
+    const size_t sliceSize;
+    std::array<size_t, 8> cornerOffsets;
+
+    // vertex references of the x and y edges in the planes below and above
+    // the current layer of cells and of the z edges in between, an entry
+    // is only valid if its stamp matches the one of its cache
+    std::array<std::vector<CacheEntry>, 2> xEdges;
+    std::array<std::vector<CacheEntry>, 2> yEdges;
+    std::vector<CacheEntry> zEdges;
+    std::array<uint32_t, 2> planeStamps{0,0};
+    uint32_t zStamp{0};
+    uint32_t stampCounter{0};
+    size_t bottomPlane{0};
+
+    Slab* slab{nullptr};
+    bool firstSlab{false};
+    bool lastSlab{false};
+    size_t z0{0};
+    size_t z1{0};
+
+    Frame frame;
+    bool trackBoundary{false};
+    std::array<size_t,3> boxFirst{0,0,0};
+    std::array<size_t,3> boxLast{0,0,0};
+
+    void begin(Slab& target, bool first, bool last, size_t zBegin, size_t zEnd) {
+      // the plane caches are only allocated by threads that get any work
+      if (zEdges.empty()) {
+        for (size_t i = 0;i<2;++i) {
+          xEdges[i].resize(sliceSize, CacheEntry{0,0});
+          yEdges[i].resize(sliceSize, CacheEntry{0,0});
+        }
+        zEdges.resize(sliceSize, CacheEntry{0,0});
+      }
+
+      slab = &target;
+      firstSlab = first;
+      lastSlab = last;
+      z0 = zBegin;
+      z1 = zEnd;
+
+      bottomPlane = 0;
+      planeStamps[0] = ++stampCounter;
+      planeStamps[1] = ++stampCounter;
+      zStamp = ++stampCounter;
+    }
+
+    void processCell(size_t x, size_t y, size_t z) {
+      const uint8_t* cell = volume.data.data() + x + y*volume.width + z*sliceSize;
+
+      // classify vertices and compute case index
+      uint8_t mcCase{0};
+      for (uint8_t i = 0;i<8;++i) mcCase |= uint8_t(uint8_t(cell[cornerOffsets[i]] < isovalue) << i);
+
+      // bail out on empty cases
+      if (mcCase == 0 || mcCase == 255) return;
+
+      std::array<uint32_t, 12> refs;
+      for (uint8_t i = 0;i<12;++i) {
+        if (edgeTable[mcCase] & 1<<i) refs[i] = vertexRef(i, x, y, z);
+      }
+
+      for (size_t i = 0; trisTable[mcCase][i] != N_E; ++i) {
+        slab->indices.push_back(refs[trisTable[mcCase][i]]);
+      }
+    }
+
+    uint32_t vertexRef(uint8_t edge, size_t x, size_t y, size_t z) {
+      const GridEdge& e = gridEdges[edge];
+      const size_t px = x + e.dx;
+      const size_t py = y + e.dy;
+      const size_t pz = z + e.dz;
+      const size_t planeIndex = px + py*volume.width;
+
+      CacheEntry* entry;
+      uint32_t stamp;
+      if (e.axis == 2) {
+        entry = &zEdges[planeIndex];
+        stamp = zStamp;
+      } else {
+        const size_t plane = e.dz ? bottomPlane^1 : bottomPlane;
+        entry = e.axis == 0 ? &xEdges[plane][planeIndex] : &yEdges[plane][planeIndex];
+        stamp = planeStamps[plane];
+      }
+      if (entry->stamp == stamp) return entry->ref;
+      entry->stamp = stamp;
+
+      const uint64_t key = uint64_t(planeIndex)*2 + e.axis;
+      if (e.axis != 2 && pz == z1 && !lastSlab) {
+        entry->ref = pendingFlag | uint32_t(slab->pending.size());
+        slab->pending.push_back(key);
+      } else {
+        entry->ref = uint32_t(slab->vertices.size());
+        slab->vertices.push_back(createVertex(e.axis, px, py, pz));
+        if (e.axis != 2 && pz == z0 && !firstSlab) slab->bottom.push_back({key, entry->ref});
+        if (trackBoundary && onBoxFace(px, py, pz)) {
+          // the offset of a brick is integral, it only starts at -1
+          const uint64_t gx = uint64_t(int64_t(frame.offset.x) + int64_t(px));
+          const uint64_t gy = uint64_t(int64_t(frame.offset.y) + int64_t(py));
+          const uint64_t gz = uint64_t(int64_t(frame.offset.z) + int64_t(pz));
+          const uint64_t globalKey = (gx + frame.globalWidth*(gy + frame.globalHeight*gz))*3 + e.axis;
+          slab->boundary.push_back({globalKey, entry->ref});
         }
       }
+      return entry->ref;
+    }
+
+    bool onBoxFace(size_t x, size_t y, size_t z) const {
+      return x == boxFirst[0] || x == boxLast[0] ||
+             y == boxFirst[1] || y == boxLast[1] ||
+             z == boxFirst[2] || z == boxLast[2];
+    }
+
+    // central differences, one sided at the border of the volume
+    Vec3 gradient(size_t x, size_t y, size_t z) const {
+      const uint8_t* d = volume.data.data() + x + y*volume.width + z*sliceSize;
+      const size_t w = volume.width;
+      const Vec3 normal{
+        float(x > 0 ? d[-1] : d[0]) - float(x+1 < volume.width ? d[1] : d[0]),
+        float(y > 0 ? *(d-w) : d[0]) - float(y+1 < volume.height ? d[w] : d[0]),
+        float(z > 0 ? *(d-sliceSize) : d[0]) - float(z+1 < volume.depth ? d[sliceSize] : d[0])
+      };
+      return Vec3::normalize(normal);
     }
+
+    Vertex createVertex(uint8_t axis, size_t x, size_t y, size_t z) const {
+      const Vec3 direction{axis == 0 ? 1.0f : 0.0f, axis == 1 ? 1.0f : 0.0f, axis == 2 ? 1.0f : 0.0f};
+      const size_t x1 = x + size_t(direction.x);
+      const size_t y1 = y + size_t(direction.y);
+      const size_t z1 = z + size_t(direction.z);
+
+      const float d0 = float(volume.data[x + y*volume.width + z*sliceSize]);
+      const float d1 = float(volume.data[x1 + y1*volume.width + z1*sliceSize]);
+      const float alpha = std::clamp((d0-float(isovalue)) / (d0-d1), 0.0f, 1.0f);
+
+      const Vec3 gridPos{frame.offset + Vec3{float(x), float(y), float(z)} + direction * alpha};
+      const Vec3 n0 = gradient(x, y, z);
+      const Vec3 n1 = gradient(x1, y1, z1);
+      return Vertex{Vec3{frame.scale * ((gridPos - frame.center) / frame.maxSize)},
+                    Vec3::normalize(n0 + (n1-n0) * alpha)};
+    }
+  };
+}
+
+Isosurface::Isosurface(const Volume& volume, uint8_t isovalue) :
+  Isosurface(volume, MinMaxOctree{volume}, isovalue)
+{
+}
+
+Isosurface::Isosurface(const Volume& volume, const MinMaxOctree& octree, uint8_t isovalue) {
+  if (volume.width < 2 || volume.height < 2 || volume.depth < 2) return;
+
+  // every layer of blocks is a slab, the slabs are extracted independently
+  // and only share the vertices on the planes between them
+  const std::vector<std::vector<uint32_t>> blocks = octree.activeBlocks(isovalue);
+  std::vector<Slab> slabs(blocks.size());
+
+  #pragma omp parallel
+  {
+    SlabExtractor extractor{volume, isovalue, octree.getBlocksX()};
+    #pragma omp for schedule(dynamic)
+    for (int64_t s = 0; s < int64_t(slabs.size()); ++s) {
+      extractor.extract(size_t(s), slabs.size(), blocks[size_t(s)], slabs[size_t(s)]);
+    }
+  }
+
+  std::vector<size_t> vertexOffsets(slabs.size()+1, 0);
+  std::vector<size_t> indexOffsets(slabs.size()+1, 0);
+  for (size_t s = 0; s < slabs.size(); ++s) {
+    vertexOffsets[s+1] = vertexOffsets[s] + slabs[s].vertices.size();
+    indexOffsets[s+1] = indexOffsets[s] + slabs[s].indices.size();
+  }
+  vertices.resize(vertexOffsets.back());
+  indices.resize(indexOffsets.back());
+
+  // concatenate the slabs, references into the next slab are looked up by
+  // their plane key
+  #pragma omp parallel for schedule(dynamic)
+  for (int64_t s = 0; s < int64_t(slabs.size()); ++s) {
+    Slab& slab = slabs[size_t(s)];
+    std::copy(slab.vertices.begin(), slab.vertices.end(), vertices.begin() + int64_t(vertexOffsets[size_t(s)]));
+
+    for (size_t i = 0; i < slab.indices.size(); ++i) {
+      const uint32_t ref = slab.indices[i];
+      size_t index;
+      if (ref & pendingFlag) {
+        const uint64_t key = slab.pending[ref & ~pendingFlag];
+        const std::vector<std::pair<uint64_t,uint32_t>>& below = slabs[size_t(s)+1].bottom;
+        const auto it = std::lower_bound(below.begin(), below.end(), std::make_pair(key, uint32_t(0)));
+        index = vertexOffsets[size_t(s)+1] + it->second;
+      } else {
+        index = vertexOffsets[size_t(s)] + ref;
+      }
+      indices[indexOffsets[size_t(s)] + i] = uint32_t(index);
+    }
+
+    slab.vertices = std::vector<Vertex>{};
+    slab.indices = std::vector<uint32_t>{};
+  }
+}
+
+Isosurface::Isosurface(const BrickedVolume& volume, uint8_t isovalue, size_t level) {
+  const BrickLevel& info = volume.getLevel(level);
+  if (info.width < 2 || info.height < 2 || info.depth < 2) return;
+
+  // the same normalized coordinates as a Volume of this level would have
+  Volume global;
+  global.width = info.width;
+  global.height = info.height;
+  global.depth = info.depth;
+  global.scale = volume.getScale();
+  global.normalizeScale();
+  const Frame globalFrame{
+    Vec3{0.0f, 0.0f, 0.0f},
+    Vec3{0.5f*float(global.width), 0.5f*float(global.height), 0.5f*float(global.depth)},
+    float(global.maxSize), global.scale, global.width, global.height
+  };
+
+  // the isovalue is given in 8 bit, 16 bit data is compared by its high byte
+  const uint32_t shift = volume.getBytesPerVoxel() == 2 ? 8 : 0;
+  std::vector<size_t> active;
+  for (size_t i = 0; i < info.bricks.size(); ++i) {
+    if ((info.bricks[i].minValue >> shift) < isovalue && (info.bricks[i].maxValue >> shift) >= isovalue)
+      active.push_back(i);
+  }
+  std::vector<Slab> bricks(active.size());
+
+  #pragma omp parallel
+  {
+    // only one brick per thread is copied out of the mapping at a time
+    const size_t storedSize = BrickedVolume::storedSize;
+    Volume brick;
+    brick.width = brick.height = brick.depth = brick.maxSize = storedSize;
+    brick.scale = Vec3{1.0f, 1.0f, 1.0f};
+    brick.data.resize(storedSize*storedSize*storedSize);
+    SlabExtractor extractor{brick, isovalue, 1};
+
+    #pragma omp for schedule(dynamic)
+    for (int64_t a = 0; a < int64_t(active.size()); ++a) {
+      const size_t index = active[size_t(a)];
+      const uint32_t bx = uint32_t(index % info.bricksX);
+      const uint32_t by = uint32_t((index / info.bricksX) % info.bricksY);
+      const uint32_t bz = uint32_t(index / (size_t(info.bricksX)*info.bricksY));
+
+      const uint8_t* data = volume.getBrick(level, bx, by, bz);
+      if (shift) {
+        for (size_t i = 0; i < brick.data.size(); ++i) brick.data[i] = data[2*i+1];
+      } else {
+        std::copy(data, data+brick.data.size(), brick.data.begin());
+      }
+
+      const size_t ghost = BrickedVolume::ghostBefore;
+      const std::array<size_t,3> first{ghost, ghost, ghost};
+      const std::array<size_t,3> count{
+        std::min<size_t>(BrickedVolume::brickSize, info.width-1-size_t(bx)*BrickedVolume::brickSize),
+        std::min<size_t>(BrickedVolume::brickSize, info.height-1-size_t(by)*BrickedVolume::brickSize),
+        std::min<size_t>(BrickedVolume::brickSize, info.depth-1-size_t(bz)*BrickedVolume::brickSize)
+      };
+      Frame frame = globalFrame;
+      frame.offset = Vec3{float(size_t(bx)*BrickedVolume::brickSize) - float(ghost),
+                          float(size_t(by)*BrickedVolume::brickSize) - float(ghost),
+                          float(size_t(bz)*BrickedVolume::brickSize) - float(ghost)};
+      extractor.extractBrick(frame, first, count, bricks[size_t(a)]);
+    }
+  }
+
+  std::vector<size_t> vertexOffsets(bricks.size()+1, 0);
+  for (size_t b = 0; b < bricks.size(); ++b) {
+    vertexOffsets[b+1] = vertexOffsets[b] + bricks[b].vertices.size();
+  }
+
+  // vertices on the faces between bricks were created by every brick that
+  // shares the edge, map all of them to the first one by their global key
+  std::vector<std::pair<uint64_t,uint32_t>> boundary;
+  for (size_t b = 0; b < bricks.size(); ++b) {
+    for (const auto& entry : bricks[b].boundary) {
+      boundary.push_back({entry.first, uint32_t(vertexOffsets[b] + entry.second)});
+    }
+    bricks[b].boundary = std::vector<std::pair<uint64_t,uint32_t>>{};
+  }
+  std::sort(boundary.begin(), boundary.end());
+
+  std::vector<uint32_t> remap(vertexOffsets.back());
+  for (size_t i = 0; i < remap.size(); ++i) remap[i] = uint32_t(i);
+  for (size_t i = 1; i < boundary.size(); ++i) {
+    if (boundary[i].first == boundary[i-1].first) remap[boundary[i].second] = remap[boundary[i-1].second];
+  }
+
+  // drop the duplicates and compact the vertex array
+  uint32_t kept{0};
+  for (size_t b = 0; b < bricks.size(); ++b) {
+    for (size_t v = 0; v < bricks[b].vertices.size(); ++v) {
+      const size_t i = vertexOffsets[b] + v;
+      if (remap[i] != i) {
+        remap[i] = remap[remap[i]];
+        continue;
+      }
+      remap[i] = kept++;
+      vertices.push_back(bricks[b].vertices[v]);
+    }
+    bricks[b].vertices = std::vector<Vertex>{};
+  }
+
+  for (size_t b = 0; b < bricks.size(); ++b) {
+    for (const uint32_t ref : bricks[b].indices) indices.push_back(remap[vertexOffsets[b] + ref]);
+    bricks[b].indices = std::vector<uint32_t>{};
   }
 }
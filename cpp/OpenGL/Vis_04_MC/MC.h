@@ -1,14 +1,56 @@
 #pragma once
 
 #include <vector>
+#include <cstdint>
 #include "Volume.h"
+#include "BrickedVolume.h"
 
 struct Vertex {
   Vec3 position;
   Vec3 normal;
 };
 
+// Minimum and maximum of the voxels of every macro cell of blockSize^3
+// cells, stored as an implicit octree (a min/max pyramid). A node can only
+// contain the isosurface if min < isovalue <= max, so empty space is
+// skipped without touching its voxels. Build it once per volume, it stays
+// valid for every isovalue.
+class MinMaxOctree {
+public:
+  static const size_t blockSize{8};
+
+  MinMaxOctree(const Volume& volume);
+
+  // blocks that may contain the isosurface as x + y * getBlocksX(),
+  // one list per layer of blocks along z
+  std::vector<std::vector<uint32_t>> activeBlocks(uint8_t isovalue) const;
+
+  size_t getBlocksX() const {return levels[0].sizeX;}
+  size_t getBlocksY() const {return levels[0].sizeY;}
+  size_t getBlocksZ() const {return levels[0].sizeZ;}
+
+private:
+  struct Level {
+    size_t sizeX;
+    size_t sizeY;
+    size_t sizeZ;
+    std::vector<uint8_t> minValues;
+    std::vector<uint8_t> maxValues;
+  };
+  std::vector<Level> levels;
+
+  void collect(size_t level, size_t x, size_t y, size_t z, uint8_t isovalue,
+               std::vector<std::vector<uint32_t>>& blocks) const;
+};
+
+// Indexed isosurface, vertices on an edge shared by neighbouring cells are
+// stored once. Every three entries of indices form a triangle.
 struct Isosurface {
   Isosurface(const Volume& volume, uint8_t isovalue);
+  Isosurface(const Volume& volume, const MinMaxOctree& octree, uint8_t isovalue);
+  // brick by brick, bricks are skipped by the min and max of the file and
+  // only one brick per thread is copied out of the mapping at a time
+  Isosurface(const BrickedVolume& volume, uint8_t isovalue, size_t level=0);
   std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
 };
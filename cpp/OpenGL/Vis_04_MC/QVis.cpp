@@ -68,6 +68,7 @@ void QVis::load(const std::string& filename) {
     throw QVisFileException{"object filename not found"};
   
   std::ifstream rawFile( rawFilename, std::ios::binary );  
+  if (!rawFile) throw QVisFileException{std::string("Unable to read file ")+rawFilename};
   
   if (needsConversion) {
     // if it's not 8bit, we assume 16bit
@@ -90,7 +91,8 @@ void QVis::load(const std::string& filename) {
   }
   rawFile.close();
 
-  volume.computeNormals();
+  if (volume.data.size() != volume.width*volume.height*volume.depth)
+    throw QVisFileException{std::string("Unexpected size of ")+rawFilename};
 }
 
 std::vector<std::string> QVis::tokenize(const std::string& str) const {
@@ -19,7 +19,6 @@ struct Volume {
   Vec3 scale;
 
   std::vector<uint8_t> data;
-  std::vector<Vec3> normals;
   
   void normalizeScale() {
     maxSize = std::max(width,std::max(height,depth));
@@ -44,21 +43,4 @@ struct Volume {
     
     return ss.str();
   }
-  
-  void computeNormals() {
-    normals.resize(data.size());
-    for (size_t w = 1;w<depth-1;++w) {
-      for (size_t v = 1;v<height-1;++v) {
-        for (size_t u = 1;u<width-1;++u) {
-          const size_t index = u + v * width + w * width * height;
-          const Vec3 normal{
-            float(data[index-1]) - float(data[index+1]),
-            float(data[index-width]) - float(data[index+width]),
-            float(data[index-width*height]) - float(data[index+width*height])
-          };
-          normals[index] = Vec3::normalize(normal);
-        }
-      }
-    }
-  }
 };
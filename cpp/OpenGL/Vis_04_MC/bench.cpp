@@ -0,0 +1,285 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <cstdio>
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+#include "QVis.h"
+#include "MC.h"
+#include "MC.inl"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Extracts isosurfaces from the bundled volumes and a synthetic cube of
+// size^3 voxels, reports triangles per second and the peak memory, and
+// compares the small volumes against the original per-cell extraction.
+// Every volume is also converted into a bricked file and extracted brick by
+// brick within a small memory budget, that has to give the same mesh.
+//
+//   mcBench [size]   size of the synthetic volume, default 1024
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+static double peakMemoryMB() {
+#ifdef __unix__
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return double(usage.ru_maxrss) / 1024.0;
+#else
+  return 0.0;
+#endif
+}
+
+// the original extractor: dense normals, unshared vertices
+static std::vector<Vertex> referenceExtraction(const Volume& volume, uint8_t isovalue) {
+  std::vector<Vec3> normals(volume.data.size());
+  for (size_t w = 1;w<volume.depth-1;++w) {
+    for (size_t v = 1;v<volume.height-1;++v) {
+      for (size_t u = 1;u<volume.width-1;++u) {
+        const size_t index = u + v * volume.width + w * volume.width * volume.height;
+        const Vec3 normal{
+          float(volume.data[index-1]) - float(volume.data[index+1]),
+          float(volume.data[index-volume.width]) - float(volume.data[index+volume.width]),
+          float(volume.data[index-volume.width*volume.height]) - float(volume.data[index+volume.width*volume.height])
+        };
+        normals[index] = Vec3::normalize(normal);
+      }
+    }
+  }
+
+  std::vector<Vertex> vertices;
+  for (size_t l = 0; l < volume.depth-1; ++l) {
+    for(size_t v = 0; v < volume.height-1; v++) {
+      for(size_t u = 0; u < volume.width-1; u++) {
+        std::array<uint8_t, 8> data{};
+        std::array<Vec3, 8> n{};
+        for (uint8_t i = 0;i<8;++i) {
+          const size_t index = (u+size_t(vertexPosTable[i][0])) +
+                               (v+size_t(vertexPosTable[i][1])) * volume.width +
+                               (l+size_t(vertexPosTable[i][2])) * volume.width*volume.height;
+          data[i] = volume.data[index];
+          n[i]    = normals[index];
+        }
+        uint8_t mcCase{0};
+        for (uint8_t i = 0;i<8;++i) mcCase += uint8_t(data[i] < isovalue) * (1<<i);
+        if (mcCase == 0 || mcCase == 255) continue;
+
+        const Vec3 cubeOffset{
+          float(u)/volume.maxSize-0.5f*float(volume.width)/float(volume.maxSize),
+          float(v)/volume.maxSize-0.5f*float(volume.height)/float(volume.maxSize),
+          float(l)/volume.maxSize-0.5f*float(volume.depth)/float(volume.maxSize)
+        };
+        std::array<Vertex, 12> trisVertices;
+        for (uint8_t i = 0;i<12;++i) {
+          if(edgeTable[mcCase] & 1<<i) {
+            const std::array<uint8_t,2>& index = edgeToVertexTable[i];
+            const float alpha = std::clamp((float(data[index[0]])-float(isovalue)) / (float(data[index[0]])-float(data[index[1]])),0.0f,1.0f);
+            const Vec3 positionInCube{vertexPosTable[index[0]] + ( vertexPosTable[index[1]]-vertexPosTable[index[0]]) * alpha};
+            const Vec3 normal{n[index[0]] + (n[index[1]]-n[index[0]]) * alpha};
+            trisVertices[i] = Vertex{Vec3{volume.scale * (cubeOffset + positionInCube/float(volume.maxSize))}, Vec3::normalize(normal)};
+          }
+        }
+        size_t i = 0;
+        while (trisTable[mcCase][i] != N_E) vertices.push_back(trisVertices[trisTable[mcCase][i++]]);
+      }
+    }
+  }
+  return vertices;
+}
+
+static double area(const Vec3& a, const Vec3& b, const Vec3& c) {
+  return 0.5 * double(Vec3::cross(b-a, c-a).length());
+}
+
+static bool validate(const Volume& volume, const Isosurface& surface, uint8_t isovalue) {
+  const auto t1 = Clock::now();
+  const std::vector<Vertex> reference = referenceExtraction(volume, isovalue);
+  const auto t2 = Clock::now();
+
+  for (const uint32_t index : surface.indices) {
+    if (index >= surface.vertices.size()) {
+      std::cout << "  invalid index " << index << std::endl;
+      return false;
+    }
+  }
+  if (reference.size() != surface.indices.size()) {
+    std::cout << "  " << surface.indices.size()/3 << " triangles, reference has "
+              << reference.size()/3 << std::endl;
+    return false;
+  }
+
+  double referenceArea = 0.0;
+  for (size_t i = 0;i<reference.size();i+=3) {
+    referenceArea += area(reference[i].position, reference[i+1].position, reference[i+2].position);
+  }
+  double surfaceArea = 0.0;
+  for (size_t i = 0;i<surface.indices.size();i+=3) {
+    surfaceArea += area(surface.vertices[surface.indices[i]].position,
+                        surface.vertices[surface.indices[i+1]].position,
+                        surface.vertices[surface.indices[i+2]].position);
+  }
+  if (std::fabs(surfaceArea-referenceArea) > 1e-4*referenceArea) {
+    std::cout << "  area " << surfaceArea << ", reference " << referenceArea << std::endl;
+    return false;
+  }
+
+  // with shared vertices there is exactly one vertex per intersected edge
+  const size_t steps[3] = {1, volume.width, volume.width*volume.height};
+  size_t edgeCount = 0;
+  for (size_t z = 0;z<volume.depth;++z) {
+    for (size_t y = 0;y<volume.height;++y) {
+      for (size_t x = 0;x<volume.width;++x) {
+        const size_t index = x + volume.width*(y + volume.height*z);
+        const bool inside = volume.data[index] < isovalue;
+        const bool inRange[3] = {x+1 < volume.width, y+1 < volume.height, z+1 < volume.depth};
+        for (size_t axis = 0;axis<3;++axis) {
+          if (inRange[axis] && inside != (volume.data[index+steps[axis]] < isovalue)) edgeCount++;
+        }
+      }
+    }
+  }
+  if (edgeCount != surface.vertices.size()) {
+    std::cout << "  " << surface.vertices.size() << " vertices, but " << edgeCount << " intersected edges" << std::endl;
+    return false;
+  }
+
+  std::cout << "  matches reference (" << std::fixed << std::setprecision(3) << seconds(t1,t2)
+            << " s, " << reference.size() << " unshared vertices)" << std::endl;
+  return true;
+}
+
+static double surfaceArea(const Isosurface& surface) {
+  double result = 0.0;
+  for (size_t i = 0;i<surface.indices.size();i+=3) {
+    result += area(surface.vertices[surface.indices[i]].position,
+                   surface.vertices[surface.indices[i+1]].position,
+                   surface.vertices[surface.indices[i+2]].position);
+  }
+  return result;
+}
+
+static bool benchmarkBricked(const Volume& volume, const std::vector<uint8_t>& isovalues) {
+  const std::string filename{"mcBench.bvol"};
+  auto t1 = Clock::now();
+  {
+    BrickedVolumeWriter writer{filename, uint32_t(volume.width), uint32_t(volume.height),
+                               uint32_t(volume.depth), 1, volume.scale};
+    for (size_t z = 0;z<volume.depth;++z) writer.addSlice(volume.data.data() + z*volume.width*volume.height);
+    writer.finish();
+  }
+  auto t2 = Clock::now();
+  std::cout << "  bricked file written in " << std::fixed << std::setprecision(3) << seconds(t1,t2) << " s" << std::endl;
+
+  bool result = true;
+  {
+    const BrickedVolume bricked{filename, size_t(64) << 20};
+    for (const uint8_t isovalue : isovalues) {
+      t1 = Clock::now();
+      const Isosurface surface{bricked, isovalue};
+      t2 = Clock::now();
+      const Isosurface reference{volume, isovalue};
+      std::cout << "  bricked  " << std::setw(3) << int(isovalue) << ": "
+                << std::setw(10) << surface.indices.size()/3 << " triangles, "
+                << std::setw(10) << surface.vertices.size() << " vertices, "
+                << std::setw(8) << std::setprecision(3) << seconds(t1,t2) << " s, "
+                << std::setw(8) << std::setprecision(2) << double(surface.indices.size()/3) / seconds(t1,t2) / 1e6
+                << " Mtris/s, bricks peak " << (bricked.getPeakResidentBytes() >> 20) << " of "
+                << (bricked.getMemoryBudget() >> 20) << " MB" << std::endl;
+
+      const double a = surfaceArea(surface);
+      const double b = surfaceArea(reference);
+      if (surface.indices.size() != reference.indices.size() ||
+          surface.vertices.size() != reference.vertices.size() ||
+          std::fabs(a-b) > 1e-4*b) {
+        std::cout << "  differs from the in-core surface (" << reference.indices.size()/3 << " triangles, "
+                  << reference.vertices.size() << " vertices, area " << b << " vs. " << a << ")" << std::endl;
+        result = false;
+        break;
+      }
+    }
+  }
+  std::remove(filename.c_str());
+  return result;
+}
+
+static bool benchmark(const std::string& name, const Volume& volume,
+                      const std::vector<uint8_t>& isovalues, bool withReference) {
+  std::cout << name << " " << volume.width << "x" << volume.height << "x" << volume.depth << std::endl;
+
+  auto t1 = Clock::now();
+  const MinMaxOctree octree{volume};
+  auto t2 = Clock::now();
+  std::cout << "  octree " << std::fixed << std::setprecision(3) << seconds(t1,t2) << " s" << std::endl;
+
+  for (const uint8_t isovalue : isovalues) {
+    t1 = Clock::now();
+    const Isosurface surface{volume, octree, isovalue};
+    t2 = Clock::now();
+    const double triangles = double(surface.indices.size()/3);
+    std::cout << "  isovalue " << std::setw(3) << int(isovalue) << ": "
+              << std::setw(10) << size_t(triangles) << " triangles, "
+              << std::setw(10) << surface.vertices.size() << " vertices, "
+              << std::setw(8) << std::setprecision(3) << seconds(t1,t2) << " s, "
+              << std::setw(8) << std::setprecision(2) << triangles / seconds(t1,t2) / 1e6 << " Mtris/s, peak "
+              << std::setprecision(0) << peakMemoryMB() << " MB" << std::endl;
+
+    if (withReference && !validate(volume, surface, isovalue)) return false;
+  }
+  return benchmarkBricked(volume, isovalues);
+}
+
+// a few overlapping metaballs in an otherwise empty volume
+static Volume syntheticVolume(size_t size) {
+  Volume volume;
+  volume.width = volume.height = volume.depth = size;
+  volume.scale = Vec3{1.0f, 1.0f, 1.0f};
+  volume.normalizeScale();
+  volume.data.resize(size*size*size);
+
+  const std::array<Vec3, 3> centers{
+    Vec3{0.4f, 0.4f, 0.5f}, Vec3{0.6f, 0.55f, 0.45f}, Vec3{0.5f, 0.7f, 0.6f}
+  };
+  #pragma omp parallel for schedule(static)
+  for (int64_t z = 0; z < int64_t(size); ++z) {
+    for (size_t y = 0; y < size; ++y) {
+      for (size_t x = 0; x < size; ++x) {
+        const Vec3 p{float(x)/float(size), float(y)/float(size), float(z)/float(size)};
+        float field = 0.0f;
+        for (const Vec3& c : centers) field += 0.01f / std::max((p-c).sqlength(), 1e-6f);
+        volume.data[x + size*(y + size*size_t(z))] = uint8_t(std::min(field * 64.0f, 255.0f));
+      }
+    }
+  }
+  return volume;
+}
+
+int main(int argc, char** argv) {
+  const size_t size = argc > 1 ? size_t(atoll(argv[1])) : 1024;
+
+  for (const std::string filename : {"bonsai.dat", "Engine.dat"}) {
+    try {
+      QVis q{filename};
+      if (!benchmark(filename, q.volume, {40, 80, 120}, true)) return EXIT_FAILURE;
+    } catch (const QVisFileException& e) {
+      std::cout << filename << ": " << e.what() << ", skipped" << std::endl;
+    }
+  }
+
+  auto t1 = Clock::now();
+  const Volume synthetic = syntheticVolume(size);
+  auto t2 = Clock::now();
+  std::cout << "synthetic volume generated in " << std::fixed << std::setprecision(3)
+            << seconds(t1,t2) << " s" << std::endl;
+  if (!benchmark("synthetic", synthetic, {64, 128, 200}, size <= 256)) return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
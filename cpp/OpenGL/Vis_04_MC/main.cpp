@@ -1,14 +1,26 @@
 #include <GLApp.h>
 #include <Mat4.h>
 #include <ArcBall.h>
+#include <memory>
 
 #include "QVis.h"
 #include "MC.h"
 
 class MyGLApp : public GLApp {
 public:
+  // position, color and normal of every shared vertex, as the lighting
+  // shader of GLApp expects them, drawn through the index buffer
   std::vector<float> data;
+  std::vector<uint32_t> indices;
+  GLArray meshArray;
+  GLBuffer meshVb{GL_ARRAY_BUFFER};
+  GLBuffer meshIb{GL_ELEMENT_ARRAY_BUFFER};
   QVis q{"bonsai.dat"};
+  MinMaxOctree octree{q.volume};
+  // set if a .bvol file is given on the command line, its bricks are
+  // extracted one by one instead of the in-core volume
+  std::unique_ptr<BrickedVolume> bricked;
+  size_t level{0};
   uint8_t isovalue{40};
   bool wireframe{false};
   bool surfaceChanged{true};
@@ -28,8 +40,10 @@ public:
   
   void extractIsosurface() {
     surfaceChanged = true;
-    Isosurface s{q.volume,isovalue};
+    const Isosurface s = bricked ? Isosurface{*bricked,isovalue,level}
+                                 : Isosurface{q.volume,octree,isovalue};
     data.clear();
+    data.reserve(s.vertices.size()*10);
     for (const Vertex& v : s.vertices) {
       data.push_back(v.position[0]);
       data.push_back(v.position[1]);
@@ -44,6 +58,7 @@ public:
       data.push_back(v.normal[1]);
       data.push_back(v.normal[2]);
     }
+    indices = s.indices;
   }
   
   virtual void draw() override {
@@ -51,12 +66,21 @@ public:
     setDrawProjection(Mat4::perspective(45, glEnv.getFramebufferSize().aspect(), 0.0001f, 100));
     setDrawTransform(Mat4::lookAt({0,0,2},{0,0,0},{0,1,0}) * rotation );
     
+    shaderUpdate();
+    simpleLightProg.enable();
+    meshArray.bind();
     if (surfaceChanged) {
-      drawTriangles(data, TrisDrawType::LIST, wireframe, true);
+      meshVb.setData(data, 10, GL_DYNAMIC_DRAW);
+      meshIb.setData(indices);
+      meshArray.connectVertexAttrib(meshVb, simpleLightProg, "vPos", 3);
+      meshArray.connectVertexAttrib(meshVb, simpleLightProg, "vColor", 4, 3);
+      meshArray.connectVertexAttrib(meshVb, simpleLightProg, "vNormal", 3, 7);
+      meshArray.connectIndexBuffer(meshIb);
       surfaceChanged = false;
-    } else {
-      redrawTriangles(wireframe);
     }
+
+    GL(glPolygonMode(GL_FRONT_AND_BACK, wireframe ? GL_LINE : GL_FILL));
+    GL(glDrawElements(GL_TRIANGLES, GLsizei(indices.size()), GL_UNSIGNED_INT, (void*)0));
   }
   
   virtual void keyboard(int key, int scancode, int action, int mods) override {
@@ -69,6 +93,12 @@ public:
         case GLFW_KEY_W:
           wireframe = !wireframe;
           break;
+        case GLFW_KEY_L:
+          if (bricked) {
+            level = (level+1) % bricked->getLevelCount();
+            extractIsosurface();
+          }
+          break;
       }
     }
     switch (key) {
@@ -105,6 +135,7 @@ public:
 } myApp;
 
 int main(int argc, char ** argv) {
+  if (argc > 1) myApp.bricked = std::make_unique<BrickedVolume>(argv[1]);
   myApp.run();
   return EXIT_SUCCESS;
 }  
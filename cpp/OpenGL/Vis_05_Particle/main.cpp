@@ -2,7 +2,8 @@
 #include <Mat4.h>
 #include <ArcBall.h>
 
-#include "Flowfield.h"
+#include <Flowfield.h>
+#include <FlowTracer.h>
 
 class MyGLApp : public GLApp {
 public:
@@ -11,6 +12,7 @@ public:
   std::vector<Vec3> particlePos;
   std::vector<float> data;
   Flowfield flow = Flowfield::genDemo(64, DemoType::SATTLE);
+  FlowTracer tracer{flow};
   ArcBall arcball{{512, 512}};
   Mat4 rotation;
   bool leftMouseDown{false};
@@ -34,19 +36,20 @@ public:
   void advect(double animationTime) {
     const double deltaT = animationTime - lastAnimationTime;
     lastAnimationTime = animationTime;
-    
-    for (size_t i = 0;i<particlePos.size();++i) {
-      particlePos[i] = advect(particlePos[i], deltaT);
-    }
-  }
 
-  Vec3 advect(const Vec3& particle, double deltaT) {
-    if (particle.x < 0.0 || particle.x > 1.0 ||
-        particle.y < 0.0 || particle.y > 1.0 ||
-        particle.z < 0.0 || particle.z > 1.0) {
-      return Vec3::random();
+    TraceParameters p;
+    p.integrator = Integrator::RK4;
+    p.stepSize = 0.01f;
+    tracer.advect(particlePos, 0.0f, float(deltaT), p);
+
+    // particles stop where they leave the field, start them anew
+    for (Vec3& particle : particlePos) {
+      if (particle.x <= 0.0f || particle.x >= 1.0f ||
+          particle.y <= 0.0f || particle.y >= 1.0f ||
+          particle.z <= 0.0f || particle.z >= 1.0f) {
+        particle = Vec3::random();
+      }
     }
-    return particle + flow.interpolate(particle) * float(deltaT);
   }
 
   void particlePosToRenderData() {
@@ -0,0 +1,178 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+
+#include <Flowfield.h>
+#include <FlowTracer.h>
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Traces a grid of seeds through the demo fields with every integrator and
+// compares the end points with an RK4 reference of small steps. The fixed
+// step Euler through Flowfield::interpolate the demos used before is
+// measured as well, then pathlines through a time dependent field.
+//
+//   tracerBench [seedsPerAxis] [duration]   defaults 12 and 2
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+struct Result {
+  double time;
+  double meanError;
+  double maxError;
+  size_t samples;
+};
+
+static void printResult(const std::string& name, const Result& r, size_t seedCount) {
+  std::cout << std::setw(24) << name << ": mean error " << std::scientific << std::setprecision(2)
+            << r.meanError << ", max " << r.maxError << std::fixed << ", " << std::setprecision(3)
+            << r.time << " s, " << std::setprecision(0) << std::setw(7) << double(r.samples)/seedCount
+            << " lookups per seed, " << std::setw(9) << seedCount/r.time << " seeds/s" << std::endl;
+}
+
+static Result compare(const std::vector<Vec3>& endPoints, const std::vector<Vec3>& reference,
+                      double time, size_t samples) {
+  Result r{time, 0.0, 0.0, samples};
+  for (size_t i = 0;i<endPoints.size();++i) {
+    const double error = (endPoints[i]-reference[i]).length();
+    r.meanError += error;
+    r.maxError = std::max(r.maxError, error);
+  }
+  r.meanError /= endPoints.size();
+  return r;
+}
+
+static std::vector<Vec3> endPoints(const std::vector<std::vector<Vec3>>& lines) {
+  std::vector<Vec3> points;
+  for (const std::vector<Vec3>& line : lines) points.push_back(line.back());
+  return points;
+}
+
+static Result run(const FlowTracer& tracer, const std::vector<Vec3>& seeds, const TraceParameters& p,
+                  const std::vector<Vec3>& reference) {
+  const auto t1 = Clock::now();
+  const std::vector<std::vector<Vec3>> lines = tracer.streamlines(seeds, p);
+  const auto t2 = Clock::now();
+  return compare(endPoints(lines), reference, seconds(t1,t2), tracer.getSampleCount());
+}
+
+// the advection of the previous demos, stopping where the line leaves the
+// cube instead of clipping it, like the original
+static Result eulerInterpolate(const Flowfield& flow, const std::vector<Vec3>& seeds, float stepSize,
+                               float duration, const std::vector<Vec3>& reference) {
+  const size_t steps = size_t(std::round(duration/stepSize));
+  std::vector<Vec3> points(seeds.size());
+  size_t samples = 0;
+  const auto t1 = Clock::now();
+  for (size_t i = 0;i<seeds.size();++i) {
+    Vec3 pos = seeds[i];
+    for (size_t s = 0;s<steps;++s) {
+      const Vec3 next = pos + flow.interpolate(pos) * stepSize;
+      ++samples;
+      if (next.x < 0.0 || next.x > 1.0 || next.y < 0.0 || next.y > 1.0 || next.z < 0.0 || next.z > 1.0) break;
+      pos = next;
+    }
+    points[i] = pos;
+  }
+  const auto t2 = Clock::now();
+  return compare(points, reference, seconds(t1,t2), samples);
+}
+
+int main(int argc, char** argv) {
+  const size_t seedsPerAxis = argc > 1 ? size_t(atoi(argv[1])) : 12;
+  const float duration = argc > 2 ? float(atof(argv[2])) : 2.0f;
+
+  const std::vector<std::pair<std::string, DemoType>> fields{
+    {"sattle", DemoType::SATTLE}, {"drain", DemoType::DRAIN}, {"critical", DemoType::CRITICAL}
+  };
+  const std::vector<Vec3> seeds = FlowTracer::seedGrid(seedsPerAxis, seedsPerAxis, seedsPerAxis);
+
+  TraceParameters p;
+  p.duration = duration;
+  p.maxPoints = std::numeric_limits<size_t>::max();
+
+  for (const auto& field : fields) {
+    const Flowfield flow = Flowfield::genDemo(128, field.second);
+    const FlowTracer tracer{flow};
+
+    TraceParameters referenceParameters = p;
+    referenceParameters.integrator = Integrator::RK4;
+    referenceParameters.stepSize = 1e-3f;
+    const std::vector<Vec3> reference = endPoints(tracer.streamlines(seeds, referenceParameters));
+
+    std::cout << field.first << ", " << seeds.size() << " seeds, duration " << duration << std::endl;
+    for (const float h : {1e-2f, 1e-3f}) {
+      std::stringstream name;
+      name << "Euler interpolate h=" << h;
+      printResult(name.str(), eulerInterpolate(flow, seeds, h, duration, reference), seeds.size());
+    }
+    for (const float h : {1e-2f, 1e-3f}) {
+      TraceParameters q = p;
+      q.integrator = Integrator::EULER;
+      q.stepSize = h;
+      std::stringstream name;
+      name << "Euler h=" << h;
+      printResult(name.str(), run(tracer, seeds, q, reference), seeds.size());
+    }
+    for (const float h : {0.1f, 0.05f, 0.02f}) {
+      TraceParameters q = p;
+      q.integrator = Integrator::RK4;
+      q.stepSize = h;
+      std::stringstream name;
+      name << "RK4 h=" << h;
+      printResult(name.str(), run(tracer, seeds, q, reference), seeds.size());
+    }
+    for (const float tolerance : {1e-3f, 1e-4f, 1e-5f, 1e-6f}) {
+      TraceParameters q = p;
+      q.integrator = Integrator::RK45;
+      q.tolerance = tolerance;
+      q.maxStepSize = 0.5f;
+      std::stringstream name;
+      name << "RK45 tol=" << tolerance;
+      printResult(name.str(), run(tracer, seeds, q, reference), seeds.size());
+    }
+  }
+
+  // pathlines through a field turning from a saddle into a drain
+  std::vector<Flowfield> timesteps;
+  const Flowfield sattle = Flowfield::genDemo(64, DemoType::SATTLE);
+  const Flowfield drain = Flowfield::genDemo(64, DemoType::DRAIN);
+  for (size_t i = 0;i<5;++i) {
+    const float alpha = i/4.0f;
+    std::vector<Vec3> vectors(sattle.getVectors().size());
+    for (size_t j = 0;j<vectors.size();++j)
+      vectors[j] = sattle.getVectors()[j]*(1.0f-alpha) + drain.getVectors()[j]*alpha;
+    timesteps.push_back(Flowfield{64, 64, 64, vectors});
+  }
+  const FlowTracer unsteady{timesteps, duration/4.0f};
+  TraceParameters referenceParameters = p;
+  referenceParameters.integrator = Integrator::RK4;
+  referenceParameters.stepSize = 1e-3f;
+  const auto t1 = Clock::now();
+  const std::vector<Vec3> reference = endPoints(unsteady.pathlines(seeds, 0.0f, referenceParameters));
+  const auto t2 = Clock::now();
+  std::cout << "unsteady, " << seeds.size() << " seeds, duration " << duration << std::endl;
+  printResult("RK4 h=0.001", Result{seconds(t1,t2), 0.0, 0.0, unsteady.getSampleCount()}, seeds.size());
+  for (const float tolerance : {1e-5f, 1e-7f}) {
+    TraceParameters q = p;
+    q.tolerance = tolerance;
+    q.maxStepSize = 0.5f;
+    const auto t3 = Clock::now();
+    const std::vector<std::vector<Vec3>> lines = unsteady.pathlines(seeds, 0.0f, q);
+    const auto t4 = Clock::now();
+    std::stringstream name;
+    name << "RK45 tol=" << tolerance;
+    printResult(name.str(), compare(endPoints(lines), reference, seconds(t3,t4), unsteady.getSampleCount()),
+                seeds.size());
+  }
+
+  return EXIT_SUCCESS;
+}
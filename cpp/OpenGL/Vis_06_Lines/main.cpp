@@ -2,7 +2,8 @@
 #include <Mat4.h>
 #include <ArcBall.h>
 
-#include "Flowfield.h"
+#include <Flowfield.h>
+#include <FlowTracer.h>
 
 class MyGLApp : public GLApp {
 public:
@@ -15,6 +16,7 @@ public:
   double angle{0};
   std::vector<float> data;
   Flowfield flow = Flowfield::genDemo(128, DemoType::SATTLE);
+  FlowTracer tracer{flow};
   
   virtual void init() override {
     glEnv.setTitle("Flow Vis Demo 2 (Integral Curves)");
@@ -25,65 +27,32 @@ public:
   }
 
   void initLines() {
-    std::vector<Vec3> linePoints;
-    linePoints.resize(lineCount*linelength);
-    for (size_t l = 0;l<lineCount;++l) {
-      linePoints[l*linelength] = Vec3::random();
-    }
-    
-    data.resize(lineCount*(linelength-1)*2*7);
-    
-    advect(linePoints, 0.1f);
-    linePointsToRenderData(linePoints);
-  }
-  
-  void advect(std::vector<Vec3>& linePoints, double deltaT) {
-    for (size_t l = 0;l<lineCount;++l) {
-      for (size_t s = 1;s<linelength;++s) {
-        const size_t i = l*linelength + s;
-        linePoints[i] = advect(linePoints[i-1], deltaT);
-        
-        if (linePoints[i] == linePoints[i-1]) break;
-      }
-    }
+    TraceParameters p;
+    p.integrator = Integrator::RK45;
+    p.stepSize = 0.1f;
+    p.maxStepSize = 0.1f;
+    p.duration = linelength*0.1f;
+    p.maxPoints = linelength;
+    linePointsToRenderData(tracer.streamlines(FlowTracer::seedRandom(lineCount), p));
   }
 
-  Vec3 advect(const Vec3& particle, double deltaT) {
-    if (particle.x < 0.0 || particle.x > 1.0 ||
-        particle.y < 0.0 || particle.y > 1.0 ||
-        particle.z < 0.0 || particle.z > 1.0) {
-      return particle;
-    }
-    return particle + flow.interpolate(particle) * float(deltaT);
-  }
+  void addVertex(const Vec3& pos) {
+    data.push_back(pos.x*2-1);
+    data.push_back(pos.y*2-1);
+    data.push_back(pos.z*2-1);
 
-  void linePointsToRenderData(const std::vector<Vec3>& linePoints) {
-    size_t i = 0;
-    for (size_t l = 0;l<lineCount;++l) {
-      for (size_t s = 0;s<linelength-1;++s) {
-        size_t j = l*linelength + s;
-        
-        if (linePoints[j] == linePoints[j+1]) break;
-        
-        data[i++] = linePoints[j].x*2-1;
-        data[i++] = linePoints[j].y*2-1;
-        data[i++] = linePoints[j].z*2-1;
-        
-        data[i++] = linePoints[j].x;
-        data[i++] = linePoints[j].y;
-        data[i++] = linePoints[j].z;
-        data[i++] = 1.0f;
+    data.push_back(pos.x);
+    data.push_back(pos.y);
+    data.push_back(pos.z);
+    data.push_back(1.0f);
+  }
 
-        j++;
-        
-        data[i++] = linePoints[j].x*2-1;
-        data[i++] = linePoints[j].y*2-1;
-        data[i++] = linePoints[j].z*2-1;
-        
-        data[i++] = linePoints[j].x;
-        data[i++] = linePoints[j].y;
-        data[i++] = linePoints[j].z;
-        data[i++] = 1.0f;
+  void linePointsToRenderData(const std::vector<std::vector<Vec3>>& lines) {
+    data.clear();
+    for (const std::vector<Vec3>& line : lines) {
+      for (size_t s = 0;s+1<line.size();++s) {
+        addVertex(line[s]);
+        addVertex(line[s+1]);
       }
     }
   }
@@ -0,0 +1,271 @@
+#include <array>
+#include <cmath>
+#include <algorithm>
+
+#include "FastLIC.h"
+
+// streamlines are integrated up to this many kernel lengths in each
+// direction, unless they leave the tile of their seed for good
+static const size_t maxKernelLengths = 16;
+
+static const uint32_t tileSize2D = 64;
+static const uint32_t tileSize3D = 16;
+
+// bilinear sampling of an xy-slice of the field
+struct SliceSampler {
+  const float* vx;
+  const float* vy;
+  size_t sizeX;
+  size_t sizeY;
+
+  void operator()(const std::array<float, 2>& pos, std::array<float, 2>& v) const {
+    // positions are always inside [0,1], so truncation is floor
+    const float fx = pos[0]*(sizeX-1);
+    const float fy = pos[1]*(sizeY-1);
+    const size_t x0 = std::min(size_t(fx), sizeX-1);
+    const size_t y0 = std::min(size_t(fy), sizeY-1);
+    const size_t x1 = std::min(x0+1, sizeX-1);
+    const size_t y1 = std::min(y0+1, sizeY-1);
+    const float ax = fx - x0;
+    const float ay = fy - y0;
+
+    const std::array<size_t, 4> i{x0+y0*sizeX, x1+y0*sizeX, x0+y1*sizeX, x1+y1*sizeX};
+    const std::array<float, 4> w{(1-ax)*(1-ay), ax*(1-ay), (1-ax)*ay, ax*ay};
+    v[0] = w[0]*vx[i[0]] + w[1]*vx[i[1]] + w[2]*vx[i[2]] + w[3]*vx[i[3]];
+    v[1] = w[0]*vy[i[0]] + w[1]*vy[i[1]] + w[2]*vy[i[2]] + w[3]*vy[i[3]];
+  }
+};
+
+// trilinear sampling of the whole field
+struct VolumeSampler {
+  const float* vx;
+  const float* vy;
+  const float* vz;
+  size_t sizeX;
+  size_t sizeY;
+  size_t sizeZ;
+
+  void operator()(const std::array<float, 3>& pos, std::array<float, 3>& v) const {
+    const float fx = pos[0]*(sizeX-1);
+    const float fy = pos[1]*(sizeY-1);
+    const float fz = pos[2]*(sizeZ-1);
+    const size_t x0 = std::min(size_t(fx), sizeX-1);
+    const size_t y0 = std::min(size_t(fy), sizeY-1);
+    const size_t z0 = std::min(size_t(fz), sizeZ-1);
+    const size_t x1 = std::min(x0+1, sizeX-1);
+    const size_t y1 = std::min(y0+1, sizeY-1);
+    const size_t z1 = std::min(z0+1, sizeZ-1);
+    const float ax = fx - x0;
+    const float ay = fy - y0;
+    const float az = fz - z0;
+
+    const size_t sliceSize = sizeX*sizeY;
+    const std::array<size_t, 8> i{
+      x0+y0*sizeX+z0*sliceSize, x1+y0*sizeX+z0*sliceSize,
+      x0+y1*sizeX+z0*sliceSize, x1+y1*sizeX+z0*sliceSize,
+      x0+y0*sizeX+z1*sliceSize, x1+y0*sizeX+z1*sliceSize,
+      x0+y1*sizeX+z1*sliceSize, x1+y1*sizeX+z1*sliceSize
+    };
+    const std::array<float, 8> w{
+      (1-ax)*(1-ay)*(1-az), ax*(1-ay)*(1-az), (1-ax)*ay*(1-az), ax*ay*(1-az),
+      (1-ax)*(1-ay)*az,     ax*(1-ay)*az,     (1-ax)*ay*az,     ax*ay*az
+    };
+    v = {0.0f, 0.0f, 0.0f};
+    for (size_t j = 0;j<8;++j) {
+      v[0] += w[j]*vx[i[j]];
+      v[1] += w[j]*vy[i[j]];
+      v[2] += w[j]*vz[i[j]];
+    }
+  }
+};
+
+// the pixel a position maps to, pixel x sits at position x/width
+template <size_t D>
+static std::array<uint32_t, D> toPixel(const std::array<float, D>& pos,
+                                       const std::array<uint32_t, D>& size) {
+  std::array<uint32_t, D> c;
+  for (size_t d = 0;d<D;++d) c[d] = std::min(uint32_t(pos[d]*size[d]+0.5f), size[d]-1);
+  return c;
+}
+
+template <size_t D>
+static size_t toIndex(const std::array<uint32_t, D>& c, const std::array<uint32_t, D>& size) {
+  size_t index = 0;
+  for (size_t d = D;d-->0;) index = index*size[d] + c[d];
+  return index;
+}
+
+template <size_t D, typename Sampler>
+static std::vector<uint8_t> fastLIC(const Sampler& sample, const std::array<float, D>& delta,
+                                    const std::vector<uint8_t>& noise,
+                                    const std::array<uint32_t, D>& size,
+                                    uint32_t steps, uint32_t tileSize) {
+  typedef std::array<float, D> Pos;
+  typedef std::array<uint32_t, D> Pixel;
+
+  size_t pixelCount = 1;
+  size_t tileCount = 1;
+  Pixel tiles;
+  for (size_t d = 0;d<D;++d) {
+    pixelCount *= size[d];
+    tiles[d] = (size[d]+tileSize-1)/tileSize;
+    tileCount *= tiles[d];
+  }
+  if (noise.size() < pixelCount) return std::vector<uint8_t>(pixelCount, 0);
+
+  std::vector<float> sum(pixelCount, 0.0f);
+  std::vector<uint32_t> hits(pixelCount, 0);
+  const size_t maxLength = size_t(steps)*maxKernelLengths;
+
+#pragma omp parallel
+  {
+    std::vector<Pos> forward;
+    std::vector<Pos> backward;
+    std::vector<uint32_t> prefix;
+
+#pragma omp for schedule(dynamic)
+    for (int64_t t = 0;t<int64_t(tileCount);++t) {
+      Pixel first;
+      Pixel last;
+      size_t rest = size_t(t);
+      for (size_t d = 0;d<D;++d) {
+        first[d] = uint32_t(rest % tiles[d])*tileSize;
+        last[d] = std::min(first[d]+tileSize, size[d]);
+        rest /= tiles[d];
+      }
+
+      auto inTile = [&](const Pixel& c) {
+        for (size_t d = 0;d<D;++d) {
+          if (c[d] < first[d] || c[d] >= last[d]) return false;
+        }
+        return true;
+      };
+
+      // returns true if the streamline ended in the field, i.e. at the
+      // border or at a critical point, and not because it got too long
+      auto integrate = [&](Pos pos, float direction, std::vector<Pos>& points) {
+        points.clear();
+        size_t outside = 0;
+        while (points.size() < maxLength) {
+          Pos v;
+          sample(pos, v);
+          float length = 0.0f;
+          for (size_t d = 0;d<D;++d) length += v[d]*v[d];
+          if (!(length > 1e-20f)) return true;
+          length = direction / std::sqrt(length);
+          for (size_t d = 0;d<D;++d) {
+            pos[d] += v[d]*length*delta[d];
+            if (pos[d] < 0.0f || pos[d] > 1.0f) return true;
+          }
+          points.push_back(pos);
+
+          // once the line stayed outside the tile for a whole kernel length
+          // none of the following points could still contribute
+          outside = inTile(toPixel(pos, size)) ? 0 : outside+1;
+          if (outside > steps) return false;
+        }
+        return false;
+      };
+
+      auto noiseAt = [&](const Pos& pos) {
+        Pixel c;
+        for (size_t d = 0;d<D;++d) c[d] = uint32_t(pos[d]*size[d]+0.5f) % size[d];
+        return noise[toIndex(c, size)];
+      };
+
+      Pixel seed = first;
+      while (true) {
+        if (hits[toIndex(seed, size)] == 0) {
+          Pos start;
+          for (size_t d = 0;d<D;++d) start[d] = float(seed[d])/size[d];
+          const bool backwardEnds = integrate(start, -1.0f, backward);
+          const bool forwardEnds = integrate(start, 1.0f, forward);
+
+          // prefix sums over the whole line turn the box filter into one
+          // subtraction per point
+          const size_t n = backward.size() + 1 + forward.size();
+          auto point = [&](size_t k) -> const Pos& {
+            if (k < backward.size()) return backward[backward.size()-1-k];
+            if (k == backward.size()) return start;
+            return forward[k-backward.size()-1];
+          };
+          prefix.resize(n+1);
+          prefix[0] = 0;
+          for (size_t k = 0;k<n;++k) prefix[k+1] = prefix[k] + noiseAt(point(k));
+
+          // points closer than a kernel length to an end that is not the end
+          // of the streamline itself would see a truncated kernel
+          const size_t begin = backwardEnds ? 0 : steps;
+          const size_t end = forwardEnds ? n : (n > steps ? n-steps : 0);
+          for (size_t k = begin;k<end;++k) {
+            const Pixel c = toPixel(point(k), size);
+            if (!inTile(c)) continue;
+            const size_t lo = k > steps ? k-steps : 0;
+            const size_t hi = std::min(k+steps+1, n);
+            const size_t index = toIndex(c, size);
+            sum[index] += float(prefix[hi]-prefix[lo]) / float(hi-lo);
+            hits[index]++;
+          }
+        }
+
+        size_t d = 0;
+        for (;d<D;++d) {
+          if (++seed[d] < last[d]) break;
+          seed[d] = first[d];
+        }
+        if (d == D) break;
+      }
+    }
+  }
+
+  std::vector<uint8_t> result(pixelCount);
+  for (size_t i = 0;i<pixelCount;++i) {
+    result[i] = hits[i] ? uint8_t(sum[i]/hits[i]) : noise[i];
+  }
+  return result;
+}
+
+FastLIC::FastLIC(const Flowfield& flow) :
+sizeX(flow.getSizeX()),
+sizeY(flow.getSizeY()),
+sizeZ(flow.getSizeZ()),
+vx(flow.getVectors().size()),
+vy(flow.getVectors().size()),
+vz(flow.getVectors().size())
+{
+  const std::vector<Vec3>& data = flow.getVectors();
+  for (size_t i = 0;i<data.size();++i) {
+    vx[i] = data[i].x;
+    vy[i] = data[i].y;
+    vz[i] = data[i].z;
+  }
+}
+
+std::vector<uint8_t> FastLIC::compute(const std::vector<uint8_t>& noise,
+                                      uint32_t width, uint32_t height,
+                                      float z, uint32_t steps) const {
+  // the slice is interpolated once, the streamlines then only need
+  // bilinear lookups
+  const float fz = std::clamp(z, 0.0f, 1.0f)*(sizeZ-1);
+  const size_t z0 = std::min(size_t(fz), sizeZ-1);
+  const size_t z1 = std::min(z0+1, sizeZ-1);
+  const float alpha = fz - z0;
+  const size_t sliceSize = sizeX*sizeY;
+  std::vector<float> sliceX(sliceSize);
+  std::vector<float> sliceY(sliceSize);
+  for (size_t i = 0;i<sliceSize;++i) {
+    sliceX[i] = vx[i+z0*sliceSize]*(1.0f-alpha) + vx[i+z1*sliceSize]*alpha;
+    sliceY[i] = vy[i+z0*sliceSize]*(1.0f-alpha) + vy[i+z1*sliceSize]*alpha;
+  }
+
+  const SliceSampler sampler{sliceX.data(), sliceY.data(), sizeX, sizeY};
+  return fastLIC<2>(sampler, {0.5f/sizeX, 0.5f/sizeY}, noise, {width, height}, steps, tileSize2D);
+}
+
+std::vector<uint8_t> FastLIC::computeVolume(const std::vector<uint8_t>& noise,
+                                            uint32_t width, uint32_t height, uint32_t depth,
+                                            uint32_t steps) const {
+  const VolumeSampler sampler{vx.data(), vy.data(), vz.data(), sizeX, sizeY, sizeZ};
+  return fastLIC<3>(sampler, {0.5f/sizeX, 0.5f/sizeY, 0.5f/sizeZ}, noise,
+                    {width, height, depth}, steps, tileSize3D);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include <Flowfield.h>
+
+// Line integral convolution after Stalling and Hege, "Fast and Resolution
+// Independent Line Integral Convolution". Instead of integrating a short
+// curve for every pixel, long streamlines are only started in pixels no
+// earlier streamline has passed through. A running box filter along each
+// streamline then yields the convolution for every pixel on its way, and
+// every pixel averages the convolutions it received.
+//
+// The image is split into tiles that are processed in parallel. A
+// streamline is started by the thread owning its seed tile and only
+// contributes to pixels of that tile, so no two threads ever write the
+// same pixel.
+class FastLIC {
+public:
+  FastLIC(const Flowfield& flow);
+
+  // LIC of the xy-slice at z (in [0,1]) of the field. noise and the result
+  // have one byte per pixel, the kernel covers steps half-pixel steps in
+  // each direction, just as the per pixel curves in main.cpp
+  std::vector<uint8_t> compute(const std::vector<uint8_t>& noise,
+                               uint32_t width, uint32_t height,
+                               float z, uint32_t steps) const;
+
+  // 3D LIC, streamlines follow all three components through a noise volume
+  std::vector<uint8_t> computeVolume(const std::vector<uint8_t>& noise,
+                                     uint32_t width, uint32_t height, uint32_t depth,
+                                     uint32_t steps) const;
+
+private:
+  size_t sizeX;
+  size_t sizeY;
+  size_t sizeZ;
+  // the field with one array per component, the interpolation weights
+  // of a sample are shared by all of them
+  std::vector<float> vx;
+  std::vector<float> vy;
+  std::vector<float> vz;
+};
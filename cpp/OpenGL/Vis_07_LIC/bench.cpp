@@ -0,0 +1,124 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+#include <Vec2.h>
+
+#include <Flowfield.h>
+#include "FastLIC.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// Compares FastLIC with the per pixel LIC the demo used before, on random
+// noise for all demo fields and growing image sizes, and times a 3D LIC.
+//
+//   licBench [maxSize] [steps]   defaults 2048 and 50
+
+static double seconds(const Clock::time_point& t1, const Clock::time_point& t2) {
+  return std::chrono::duration<double>(t2-t1).count();
+}
+
+// the curve and convolution of the original licStep
+static std::vector<Vec2> computeCurve(Flowfield& flow, float x, float y, float z, uint32_t steps) {
+  std::vector<Vec2> r;
+
+  Vec2 pos{x,y};
+  r.push_back(pos);
+
+  const Vec2 delta{0.5f/flow.getSizeX(),0.5f/flow.getSizeY()};
+
+  for (size_t i = 0;i<steps;++i) {
+    const Vec3 v = flow.interpolate(Vec3(pos.x, pos.y, z));
+    pos = pos + Vec2::normalize(Vec2{v.x,v.y}) * delta;
+    if (pos.x < 0.0 || pos.x > 1.0 || pos.y < 0.0 || pos.y > 1.0) break;
+    r.push_back(pos);
+  }
+
+  pos = Vec2{x,y};
+  for (size_t i = 0;i<steps;++i) {
+    const Vec3 v = flow.interpolate(Vec3(pos.x, pos.y, z));
+    pos = pos - Vec2::normalize(Vec2{v.x,v.y}) * delta;
+    if (pos.x < 0.0 || pos.x > 1.0 || pos.y < 0.0 || pos.y > 1.0) break;
+    r.push_back(pos);
+  }
+
+  return r;
+}
+
+static std::vector<uint8_t> perPixelLIC(Flowfield& flow, const std::vector<uint8_t>& noise,
+                                        uint32_t width, uint32_t height, uint32_t steps) {
+  std::vector<uint8_t> result(size_t(width)*height);
+  for (uint32_t y = 0; y < height;++y) {
+    for (uint32_t x = 0; x < width;++x) {
+      std::vector<Vec2> trace = computeCurve(flow, float(x)/width, float(y)/height, 0.5f, steps);
+      float value=0.0f;
+      for (size_t i = 0;i<trace.size();++i) {
+        const uint32_t u = uint32_t(trace[i].x * width + 0.5f) % width;
+        const uint32_t v = uint32_t(trace[i].y * height + 0.5f) % height;
+        value += noise[u+v*width];
+      }
+      result[x+y*width] = uint8_t(value/trace.size());
+    }
+  }
+  return result;
+}
+
+static std::vector<uint8_t> genNoise(size_t count) {
+  std::mt19937 gen{4711};
+  std::vector<uint8_t> noise(count);
+  for (uint8_t& n : noise) n = uint8_t(gen() & 0xff);
+  return noise;
+}
+
+int main(int argc, char** argv) {
+  const uint32_t maxSize = argc > 1 ? uint32_t(atoi(argv[1])) : 2048;
+  const uint32_t steps = argc > 2 ? uint32_t(atoi(argv[2])) : 50;
+
+  const std::vector<std::pair<std::string, DemoType>> fields{
+    {"sattle", DemoType::SATTLE}, {"drain", DemoType::DRAIN}, {"critical", DemoType::CRITICAL}
+  };
+
+  std::cout << std::fixed;
+  for (const auto& field : fields) {
+    Flowfield flow = Flowfield::genDemo(256, field.second);
+    const FastLIC lic{flow};
+
+    for (uint32_t size = 256;size<=maxSize;size*=2) {
+      const std::vector<uint8_t> noise = genNoise(size_t(size)*size);
+
+      auto t1 = Clock::now();
+      const std::vector<uint8_t> reference = perPixelLIC(flow, noise, size, size, steps);
+      auto t2 = Clock::now();
+      const double perPixelTime = seconds(t1,t2);
+
+      t1 = Clock::now();
+      const std::vector<uint8_t> fast = lic.compute(noise, size, size, 0.5f, steps);
+      t2 = Clock::now();
+      const double fastTime = seconds(t1,t2);
+
+      double error = 0.0;
+      for (size_t i = 0;i<fast.size();++i) error += std::abs(int(fast[i]) - int(reference[i]));
+
+      std::cout << std::setw(8) << field.first << " " << std::setw(4) << size << "^2: per pixel "
+                << std::setprecision(3) << perPixelTime << " s, FastLIC " << fastTime << " s ("
+                << std::setprecision(1) << perPixelTime/fastTime << "x), mean difference "
+                << std::setprecision(2) << error/fast.size() << std::endl;
+    }
+  }
+
+  Flowfield flow = Flowfield::genDemo(128, DemoType::DRAIN);
+  const FastLIC lic{flow};
+  const uint32_t size = 128;
+  const std::vector<uint8_t> noise = genNoise(size_t(size)*size*size);
+  const auto t1 = Clock::now();
+  const std::vector<uint8_t> volume = lic.computeVolume(noise, size, size, size, steps);
+  const auto t2 = Clock::now();
+  std::cout << "3D LIC " << size << "^3: " << std::setprecision(3) << seconds(t1,t2) << " s" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -1,7 +1,7 @@
 #include <GLApp.h>
 #include <bmp.h>
 
-#include "Flowfield.h"
+#include <Flowfield.h>
 
 class MyGLApp : public GLApp {
 public:
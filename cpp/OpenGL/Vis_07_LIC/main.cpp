@@ -1,10 +1,12 @@
 #include <array>
 #include <cmath>
+#include <random>
 
 #include <GLApp.h>
 #include <bmp.h>
 
-#include "Flowfield.h"
+#include <Flowfield.h>
+#include "FastLIC.h"
 
 class MyGLApp : public GLApp {
 public:
@@ -14,7 +16,15 @@ public:
   Image noiseImage = BMP::load("noise.bmp");
   Image inputImage = noiseImage;
   Image licImage{uint32_t(flow.getSizeX()),uint32_t(flow.getSizeY()),3};
+  FastLIC lic{flow};
   uint32_t steps{50};
+  // the slice of the field that is shown, swept through the field when
+  // the animation is on
+  float z{0.5f};
+  bool animated{false};
+  // set by computing a 3D LIC, its slices are shown instead of 2D LICs
+  std::vector<uint8_t> licVolume;
+  const uint32_t volumeSize{128};
 
   virtual void init() override {
     glEnv.setTitle("LIC demo");
@@ -24,50 +34,20 @@ public:
     computeLIC();
   }
   
-  std::vector<Vec2> computeCurve(float x, float y, float z) {
-    std::vector<Vec2> r;
-    
-    Vec2 pos{x,y};
-    r.push_back(pos);
-    
-    const Vec2 delta{0.5f/flow.getSizeX(),0.5f/flow.getSizeY()};
-    
-    for (size_t i = 0;i<steps;++i) {
-      const Vec3 v = flow.interpolate(Vec3(pos.x, pos.y, z));
-      pos = pos + Vec2::normalize(Vec2{v.x,v.y}) * delta;
-      if (pos.x < 0.0 || pos.x > 1.0 || pos.y < 0.0 || pos.y > 1.0) break;
-      r.push_back(pos);
-    }
-
-    pos = Vec2{x,y};
-    for (size_t i = 0;i<steps;++i) {
-      const Vec3 v = flow.interpolate(Vec3(pos.x, pos.y, z));
-      pos = pos - Vec2::normalize(Vec2{v.x,v.y}) * delta;
-      if (pos.x < 0.0 || pos.x > 1.0 || pos.y < 0.0 || pos.y > 1.0) break;
-      r.push_back(pos);
+  void licStep(Image& image) {
+    const Image input = (inputImage.width == image.width && inputImage.height == image.height)
+                      ? inputImage : inputImage.cropToAspectAndResample(image.width, image.height);
+    const size_t pixelCount = size_t(image.width)*image.height;
+    std::vector<uint8_t> noise(pixelCount);
+    for (size_t i = 0;i<pixelCount;++i) {
+      noise[i] = input.data[i*input.componentCount];
     }
 
-    return r;
-  }
-
-  void licStep(Image& image) {
-    for (uint32_t y = 0; y < image.height;++y) {
-      for (uint32_t x = 0; x < image.width;++x) {
-        std::vector<Vec2> trace = computeCurve(float(x)/image.width,
-                                               float(y)/image.height,
-                                               0.5f);
-        float value=0.0f;
-        for (size_t i = 0;i<trace.size();++i) {
-          const uint32_t u = uint32_t(trace[i].x * inputImage.width + 0.5f) % image.width;
-          const uint32_t v = uint32_t(trace[i].y * inputImage.height + 0.5f) % image.height;
-          value += inputImage.getValue(u,v,0);
-        }
-        
-        const uint8_t output = uint8_t(value/trace.size());
-        image.setValue(x,y,0,output);
-        image.setValue(x,y,1,output);
-        image.setValue(x,y,2,output);
-      }
+    const std::vector<uint8_t> result = lic.compute(noise, image.width, image.height, z, steps);
+    for (size_t i = 0;i<pixelCount;++i) {
+      image.data[i*image.componentCount+0] = result[i];
+      image.data[i*image.componentCount+1] = result[i];
+      image.data[i*image.componentCount+2] = result[i];
     }
   }
 
@@ -101,6 +81,7 @@ public:
   }
   
   void computeLIC() {
+    licVolume.clear();
     inputImage = noiseImage;
     for (size_t i = 0;i<3;++i) {
       licStep(licImage);
@@ -109,6 +90,38 @@ public:
     }
   }
   
+  void computeVolumeLIC() {
+    std::mt19937 gen{0};
+    std::vector<uint8_t> noise(size_t(volumeSize)*volumeSize*volumeSize);
+    for (uint8_t& n : noise) n = uint8_t(gen() & 0xff);
+    licVolume = lic.computeVolume(noise, volumeSize, volumeSize, volumeSize, steps);
+    showVolumeSlice();
+  }
+
+  void showVolumeSlice() {
+    licImage = Image(volumeSize, volumeSize, 3);
+    const size_t sliceSize = size_t(volumeSize)*volumeSize;
+    const size_t slice = size_t(z*(volumeSize-1));
+    for (size_t i = 0;i<sliceSize;++i) {
+      const uint8_t value = licVolume[i+slice*sliceSize];
+      licImage.data[i*3+0] = value;
+      licImage.data[i*3+1] = value;
+      licImage.data[i*3+2] = value;
+    }
+    equalizeStep(licImage);
+  }
+
+  virtual void animate(double animationTime) override {
+    if (!animated) return;
+    z = float(fmod(animationTime*0.1, 1.0));
+    if (licVolume.empty()) {
+      licImage = Image(uint32_t(flow.getSizeX()), uint32_t(flow.getSizeY()), 3);
+      computeLIC();
+    } else {
+      showVolumeSlice();
+    }
+  }
+
   virtual void draw() override {
     GL(glClear(GL_COLOR_BUFFER_BIT));
     drawImage(licImage);
@@ -126,19 +139,33 @@ public:
           break;
         case GLFW_KEY_D:
           licImage = Image(uint32_t(flow.getSizeX()),uint32_t(flow.getSizeY()),3 );
-          flow = Flowfield::genDemo(256, DemoType::DRAIN);          
+          flow = Flowfield::genDemo(256, DemoType::DRAIN);
+          lic = FastLIC{flow};
           computeLIC();
           break;
         case GLFW_KEY_S:
           licImage = Image(uint32_t(flow.getSizeX()), uint32_t(flow.getSizeY()), 3);
           flow = Flowfield::genDemo(256, DemoType::SATTLE);
+          lic = FastLIC{flow};
           computeLIC();
           break;
         case GLFW_KEY_C:
           licImage = Image(uint32_t(flow.getSizeX()), uint32_t(flow.getSizeY()), 3);
           flow = Flowfield::genDemo(256, DemoType::CRITICAL);
+          lic = FastLIC{flow};
           computeLIC();
           break;
+        case GLFW_KEY_A:
+          animated = !animated;
+          break;
+        case GLFW_KEY_V:
+          if (licVolume.empty()) {
+            computeVolumeLIC();
+          } else {
+            licImage = Image(uint32_t(flow.getSizeX()), uint32_t(flow.getSizeY()), 3);
+            computeLIC();
+          }
+          break;
         case GLFW_KEY_1:
           noiseImage = BMP::load("noise.bmp");
           steps = 50;
@@ -7,6 +7,8 @@ class Camera {
 		Camera(const Vec3& lookFrom, const Vec3& lookAt, const Vec3& vUp, float fovy, 
 			   float aspectRatio, float aperture, float distToFocus);
 		Ray getRay(const float s, const float t) const;
+		// same as above but with the lens sample provided by the caller
+		Ray getRay(const float s, const float t, const float lensX, const float lensY) const;
 		
 	private:		
 		Vec3 lookFrom;
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// Counter based random numbers: every value is a pure function of a 64 bit
+// stream key and a running counter, so each ray can carry its own stream
+// without any shared generator state between threads. The same key always
+// reproduces the same sequence, independent of the thread that draws it.
+class CounterRand {
+public:
+	CounterRand(uint64_t key, uint32_t counter=0) :
+		key{key},
+		counter{counter}
+	{}
+
+	static uint64_t mix(uint64_t x) {
+		// splitmix64 finalizer
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	static uint64_t streamKey(uint64_t seed, uint64_t pixel, uint64_t sample) {
+		return mix(mix(seed ^ mix(pixel)) + sample);
+	}
+
+	float rand01() {
+		const uint64_t bits{mix(key + 0x9e3779b97f4a7c15ull * ++counter)};
+		return float(bits >> 40) * (1.0f / 16777216.0f);
+	}
+
+	float rand11() {return rand01()*2.0f-1.0f;}
+	float rand0Pi() {return rand01()*6.28318530718f;}
+
+	uint64_t getKey() const {return key;}
+	uint32_t getCounter() const {return counter;}
+
+private:
+	uint64_t key;
+	uint32_t counter;
+};
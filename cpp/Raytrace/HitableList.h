@@ -6,11 +6,13 @@
 #include "Ray.h"
 #include "Hitable.h"
 
-class HitableList {
+class HitableList : public Hitable {
 	public:
 		HitableList();
+		virtual ~HitableList() {}
 		void add(std::shared_ptr<const Hitable> hitable);
-		const std::optional<HitRecord> hit(const Ray& r, const float tMin, const float tMax) const;
+		virtual const std::optional<HitRecord> hit(const Ray& r, const float tMin, const float tMax) const;
+		size_t size() const {return objects.size();}
 		
 	private:
 		std::vector<std::shared_ptr<const Hitable>> objects;
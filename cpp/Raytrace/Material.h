@@ -8,9 +8,20 @@
 
 class HitRecord;
 
+// plain parameter view of a material so that batched integrators can
+// evaluate scattering without going through the virtual scatter call
+struct MaterialInfo {
+	enum class Type {Lambertian, Metal, Dielectric};
+	Type type;
+	Vec3 color;
+	float fuzz;
+	float refIdx;
+};
+
 class Material {
 public:
 	virtual std::optional<std::pair<Vec3,Ray>> scatter(const Ray& rIn, const HitRecord& hitRec) const = 0;
+	virtual MaterialInfo info() const = 0;
 };
 	
 class Dielectric : public Material {
@@ -18,10 +29,10 @@ public:
 	Dielectric(float refIdx);
 	virtual ~Dielectric() {}
 	virtual std::optional<std::pair<Vec3,Ray>> scatter(const Ray& rIn, const HitRecord& hitRec) const;
+	virtual MaterialInfo info() const {return {MaterialInfo::Type::Dielectric, {1.0f,1.0f,1.0f}, 0.0f, refIdx};}
+	static float schlick(float cosine, float refIdx);
 private:
 	float refIdx;	
-	static float schlick(float cosine, float refIdx);
-	
 };
 
 class Lambertian : public Material {
@@ -29,6 +40,7 @@ public:
 	Lambertian(const Vec3& color);
 	virtual ~Lambertian() {}
 	virtual std::optional<std::pair<Vec3,Ray>> scatter(const Ray& rIn, const HitRecord& hitRec) const;
+	virtual MaterialInfo info() const {return {MaterialInfo::Type::Lambertian, color, 0.0f, 1.0f};}
 private:
 	Vec3 color;
 };
@@ -38,6 +50,7 @@ public:
 	Metal(const Vec3& color, float fuzz);
 	virtual ~Metal() {}
 	virtual std::optional<std::pair<Vec3,Ray>> scatter(const Ray& rIn, const HitRecord& hitRec) const;	
+	virtual MaterialInfo info() const {return {MaterialInfo::Type::Metal, color, fuzz, 1.0f};}
 private:
 	Vec3 color;
 	float fuzz;
@@ -4,13 +4,12 @@
 constexpr float M_PI = 3.14159265358979323846f;
 #endif
 
-std::random_device Rand::rd{};
-std::mt19937 Rand::gen{rd()};
-std::uniform_real_distribution<float> Rand::dis01{0.0f, 1.0f};
-std::uniform_real_distribution<float> Rand::dis005{0.0f, 0.5f};
-std::uniform_real_distribution<float> Rand::dis051{0.5f, 1.0f};
-std::uniform_real_distribution<float> Rand::dis11{-1.0f, 1.0f};
-std::uniform_real_distribution<float> Rand::disPi{0.0f, 2.0f * M_PI};
+thread_local std::mt19937 Rand::gen{std::random_device{}()};
+thread_local std::uniform_real_distribution<float> Rand::dis01{0.0f, 1.0f};
+thread_local std::uniform_real_distribution<float> Rand::dis005{0.0f, 0.5f};
+thread_local std::uniform_real_distribution<float> Rand::dis051{0.5f, 1.0f};
+thread_local std::uniform_real_distribution<float> Rand::dis11{-1.0f, 1.0f};
+thread_local std::uniform_real_distribution<float> Rand::disPi{0.0f, 2.0f * M_PI};
 
 float Rand::rand01() {
     return dis01(gen);
@@ -32,3 +31,7 @@ float Rand::rand0Pi() {
     return disPi(gen);
 }
 
+void Rand::seed(uint32_t s) {
+    gen.seed(s);
+}
+
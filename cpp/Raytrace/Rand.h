@@ -9,13 +9,16 @@ public:
     static float rand01();
     static float rand11();
     static float rand0Pi();
+    // seeds the generator of the calling thread only
+    static void seed(uint32_t s);
 private:
-    static std::random_device rd;
-    static std::mt19937 gen;
-    static std::uniform_real_distribution<float> dis01;
-    static std::uniform_real_distribution<float> dis11;
-    static std::uniform_real_distribution<float> disPi;
-    static std::uniform_real_distribution<float> dis005;
-    static std::uniform_real_distribution<float> dis051;
+    // one generator per thread, so the OpenMP loops of the recursive
+    // renderer don't race on it
+    static thread_local std::mt19937 gen;
+    static thread_local std::uniform_real_distribution<float> dis01;
+    static thread_local std::uniform_real_distribution<float> dis11;
+    static thread_local std::uniform_real_distribution<float> disPi;
+    static thread_local std::uniform_real_distribution<float> dis005;
+    static thread_local std::uniform_real_distribution<float> dis051;
 
 };
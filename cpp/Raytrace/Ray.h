@@ -1,5 +1,7 @@
 #pragma once 
 
+#include <cstdint>
+
 #include "Vec3.h"
 
 class Ray {
@@ -14,4 +16,16 @@ class Ray {
 	private:
 		Vec3 o;
 		Vec3 d;
-};
\ No newline at end of file
+};
+
+// eight rays as structure of arrays, each pointer addresses eight
+// consecutive floats, lanes at and beyond count are ignored
+struct RayPacket {
+	const float* ox;
+	const float* oy;
+	const float* oz;
+	const float* dx;
+	const float* dy;
+	const float* dz;
+	uint32_t count;
+};
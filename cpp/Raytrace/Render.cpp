@@ -0,0 +1,277 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "Render.h"
+#include "Material.h"
+
+const Vec3 rayColor(const Ray& r, const Hitable& world, const float depth) {
+	// if we've exceeded the ray bounce limit, no more light is gathered.
+	if (depth <= 0)
+		return {0,0,0};
+
+	auto rec {world.hit(r, 0.001f, std::numeric_limits<float>::infinity() )};
+	if (rec) {
+		auto result {rec->material->scatter(r, rec.value())};
+		if (result) {
+			return rayColor(result->second, world, depth-1)*result->first;
+		}
+		return {0,0,0};
+	}
+
+	// background
+	const Vec3 unitDirection{Vec3::normalize(r.direction())};
+	const float t = (unitDirection.y() + 1.0f)*0.5f;
+	return Vec3{1.0f, 1.0f, 1.0f}*(1.0f-t) + Vec3{0.5f, 0.7f, 1.0f}*t;
+}
+
+static float clamp(const float n, const float smallest, const float largest) {
+	return fmax(smallest, fmin(n, largest));
+}
+
+const std::array<uint8_t,3> finalizeColor(const Vec3& pixelColor, const uint32_t samplesPerPixel) {
+	float r{pixelColor.r()};
+	float g{pixelColor.g()};
+	float b{pixelColor.b()};
+
+	// Replace NaN components with zero. See explanation in Ray Tracing: The Rest of Your Life.
+	if (!std::isnormal(r)) r = 0.0f;
+	if (!std::isnormal(g)) g = 0.0f;
+	if (!std::isnormal(b)) b = 0.0f;
+
+	// Divide the color by the number of samples and gamma-correct for gamma=2.0.
+	const float scale {1.0f / samplesPerPixel};
+	r = sqrt(scale * r);
+	g = sqrt(scale * g);
+	b = sqrt(scale * b);
+
+	// return the translated [0,255] value of each color component.
+	return {uint8_t(256 * clamp(r, 0.0f, 0.999f)),
+			uint8_t(256 * clamp(g, 0.0f, 0.999f)),
+			uint8_t(256 * clamp(b, 0.0f, 0.999f))};
+}
+
+void WavefrontRenderer::RayStream::resize(const size_t count) {
+	// pad to whole packets so the last packet can be loaded as eight lanes
+	const size_t padded{(count + 7) / 8 * 8};
+	for (auto v : {&ox, &oy, &oz, &dx, &dy, &dz, &throughputR, &throughputG, &throughputB, &t}) {
+		v->resize(padded, 1.0f);
+	}
+	pixel.resize(padded);
+	key.resize(padded);
+	counter.resize(padded);
+	prim.resize(padded);
+	size = count;
+}
+
+void WavefrontRenderer::RayStream::copy(const size_t from, const size_t to) {
+	ox[to] = ox[from];
+	oy[to] = oy[from];
+	oz[to] = oz[from];
+	dx[to] = dx[from];
+	dy[to] = dy[from];
+	dz[to] = dz[from];
+	throughputR[to] = throughputR[from];
+	throughputG[to] = throughputG[from];
+	throughputB[to] = throughputB[from];
+	pixel[to] = pixel[from];
+	key[to] = key[from];
+	counter[to] = counter[from];
+}
+
+WavefrontRenderer::WavefrontRenderer(const BVH& world, const uint32_t width, const uint32_t height,
+									 const uint32_t maxDepth, const uint32_t tileSize) :
+	world{world},
+	width{width},
+	height{height},
+	maxDepth{maxDepth},
+	tileSize{tileSize}
+{
+	for (const auto& material : world.getMaterials()) {
+		materials.push_back(material->info());
+	}
+}
+
+void WavefrontRenderer::render(const Camera& cam, const uint64_t seed, const uint32_t samplesPerPixel,
+							   std::vector<float>& radiance) const {
+	radiance.assign(size_t(width)*height*3, 0.0f);
+
+	const uint32_t tilesX{(width + tileSize - 1) / tileSize};
+	const uint32_t tilesY{(height + tileSize - 1) / tileSize};
+
+	// path lengths vary a lot between tiles (sky vs. glass), hence dynamic
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int tile = 0; tile < int(tilesX*tilesY); ++tile) {
+		const uint32_t x{(tile % tilesX) * tileSize};
+		const uint32_t y{(tile / tilesX) * tileSize};
+		const uint32_t w{std::min(tileSize, width - x)};
+		const uint32_t h{std::min(tileSize, height - y)};
+
+		std::vector<float> tileRadiance(size_t(w)*h*3, 0.0f);
+		renderTile(cam, seed, x, y, w, h, 0, samplesPerPixel, tileRadiance.data());
+
+		for (uint32_t j = 0;j<h;++j) {
+			std::copy(tileRadiance.begin() + j*w*3, tileRadiance.begin() + (j+1)*w*3,
+					  radiance.begin() + ((y+j)*size_t(width) + x)*3);
+		}
+	}
+}
+
+void WavefrontRenderer::renderTile(const Camera& cam, const uint64_t seed,
+								   const uint32_t x, const uint32_t y, const uint32_t w, const uint32_t h,
+								   const uint32_t firstSample, const uint32_t sampleCount,
+								   float* radiance, float* squaredLuminance) const {
+	static thread_local RayStream rays;
+
+	// bound the stream size by splitting the sample range into passes
+	const uint32_t samplesPerPass{std::max(1u, std::min(sampleCount, maxRaysPerPass / std::max(1u, w*h)))};
+
+	for (uint32_t sample = firstSample; sample < firstSample+sampleCount; sample += samplesPerPass) {
+		const uint32_t passSamples{std::min(samplesPerPass, firstSample+sampleCount-sample)};
+		generateCameraRays(rays, cam, seed, x, y, w, h, sample, passSamples);
+
+		for (uint32_t bounce = 0;bounce < maxDepth && rays.size > 0;++bounce) {
+			intersect(rays);
+
+			// shade and compact the surviving rays to the front of the stream
+			size_t alive{0};
+			for (size_t i = 0;i<rays.size;++i) {
+				if (shade(rays, i, radiance, squaredLuminance)) {
+					if (alive != i) rays.copy(i, alive);
+					++alive;
+				}
+			}
+			rays.size = alive;
+		}
+		// paths still running after maxDepth bounces gather no light
+	}
+}
+
+void WavefrontRenderer::generateCameraRays(RayStream& rays, const Camera& cam, const uint64_t seed,
+										   const uint32_t x, const uint32_t y, const uint32_t w, const uint32_t h,
+										   const uint32_t firstSample, const uint32_t sampleCount) const {
+	rays.resize(size_t(w)*h*sampleCount);
+
+	size_t index{0};
+	for (uint32_t j = 0;j<h;++j) {
+		for (uint32_t i = 0;i<w;++i) {
+			const uint64_t globalPixel{uint64_t(y+j)*width + (x+i)};
+			for (uint32_t s = firstSample;s<firstSample+sampleCount;++s) {
+				CounterRand rng{CounterRand::streamKey(seed, globalPixel, s)};
+
+				const float u{(x + i + rng.rand01()) / (width-1)};
+				const float v{(y + j + rng.rand01()) / (height-1)};
+
+				// lens sample, same distribution as Vec3::randomPointInDisc
+				float lensX, lensY;
+				do {
+					lensX = rng.rand01();
+					lensY = rng.rand01();
+				} while (lensX*lensX + lensY*lensY > 1);
+
+				const Ray r{cam.getRay(u, v, lensX, lensY)};
+				const Vec3 o{r.origin()};
+				const Vec3 d{r.direction()};
+				rays.ox[index] = o.x();
+				rays.oy[index] = o.y();
+				rays.oz[index] = o.z();
+				rays.dx[index] = d.x();
+				rays.dy[index] = d.y();
+				rays.dz[index] = d.z();
+				rays.throughputR[index] = 1.0f;
+				rays.throughputG[index] = 1.0f;
+				rays.throughputB[index] = 1.0f;
+				rays.pixel[index] = j*w+i;
+				rays.key[index] = rng.getKey();
+				rays.counter[index] = rng.getCounter();
+				++index;
+			}
+		}
+	}
+}
+
+void WavefrontRenderer::intersect(RayStream& rays) const {
+	for (size_t i = 0;i<rays.size;i+=8) {
+		const RayPacket packet{&rays.ox[i], &rays.oy[i], &rays.oz[i],
+							   &rays.dx[i], &rays.dy[i], &rays.dz[i],
+							   uint32_t(std::min<size_t>(8, rays.size-i))};
+		world.hit(packet, 0.001f, std::numeric_limits<float>::infinity(), &rays.t[i], &rays.prim[i]);
+	}
+}
+
+static Vec3 randomUnitVector(CounterRand& rng) {
+	const float a{rng.rand0Pi()};
+	const float z{rng.rand11()};
+	const float r{sqrtf(1.0f - z*z)};
+	return Vec3{r*cosf(a), r*sinf(a), z};
+}
+
+bool WavefrontRenderer::shade(RayStream& rays, const size_t i, float* radiance, float* squaredLuminance) const {
+	const Vec3 direction{rays.dx[i], rays.dy[i], rays.dz[i]};
+	const Vec3 throughput{rays.throughputR[i], rays.throughputG[i], rays.throughputB[i]};
+
+	if (rays.prim[i] < 0) {
+		// background
+		const Vec3 unitDirection{Vec3::normalize(direction)};
+		const float t = (unitDirection.y() + 1.0f)*0.5f;
+		const Vec3 color{(Vec3{1.0f, 1.0f, 1.0f}*(1.0f-t) + Vec3{0.5f, 0.7f, 1.0f}*t) * throughput};
+		float* target{radiance + size_t(rays.pixel[i])*3};
+		target[0] += color.r();
+		target[1] += color.g();
+		target[2] += color.b();
+		if (squaredLuminance) {
+			// a path contributes exactly once, so this is the per sample value
+			const float l{luminance(color.r(), color.g(), color.b())};
+			squaredLuminance[rays.pixel[i]] += l*l;
+		}
+		return false;
+	}
+
+	const uint32_t prim{uint32_t(rays.prim[i])};
+	const Vec3 p{Vec3{rays.ox[i], rays.oy[i], rays.oz[i]} + direction*rays.t[i]};
+	const Vec3 outwardNormal{(p - world.getCenter(prim)) / world.getRadius(prim)};
+	const bool frontFace{Vec3::dot(direction, outwardNormal) < 0};
+	const Vec3 n{frontFace ? outwardNormal : outwardNormal*-1};
+
+	const MaterialInfo& material{materials[world.getMaterialIndex(prim)]};
+	CounterRand rng{rays.key[i], rays.counter[i]};
+
+	Vec3 scattered;
+	switch (material.type) {
+		case MaterialInfo::Type::Lambertian :
+			scattered = n + randomUnitVector(rng);
+			break;
+		case MaterialInfo::Type::Metal : {
+			const Vec3 reflected{Vec3::reflect(Vec3::normalize(direction), n)};
+			scattered = reflected + randomUnitVector(rng)*material.fuzz;
+			if (Vec3::dot(scattered, n) <= 0) return false;
+			break;
+		}
+		case MaterialInfo::Type::Dielectric : {
+			const float etaiOverEtat = frontFace ? (1.0f / material.refIdx) : material.refIdx;
+			const Vec3 unitDirection{Vec3::normalize(direction)};
+			const float cosTheta{fminf(Vec3::dot(unitDirection*-1, n), 1.0f)};
+			const float sinTheta{sqrtf(1.0f - cosTheta*cosTheta)};
+			if (etaiOverEtat * sinTheta > 1.0f ||
+				rng.rand01() < Dielectric::schlick(cosTheta, etaiOverEtat)) {
+				scattered = Vec3::reflect(unitDirection, n);
+			} else {
+				scattered = Vec3::refract(unitDirection, n, etaiOverEtat);
+			}
+			break;
+		}
+	}
+
+	const Vec3 newThroughput{throughput * material.color};
+	rays.ox[i] = p.x();
+	rays.oy[i] = p.y();
+	rays.oz[i] = p.z();
+	rays.dx[i] = scattered.x();
+	rays.dy[i] = scattered.y();
+	rays.dz[i] = scattered.z();
+	rays.throughputR[i] = newThroughput.r();
+	rays.throughputG[i] = newThroughput.g();
+	rays.throughputB[i] = newThroughput.b();
+	rays.counter[i] = rng.getCounter();
+	return true;
+}
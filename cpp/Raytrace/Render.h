@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <cstdint>
+
+#include "Vec3.h"
+#include "Ray.h"
+#include "Camera.h"
+#include "Hitable.h"
+#include "BVH.h"
+#include "CounterRand.h"
+
+// recursive single path reference integrator
+const Vec3 rayColor(const Ray& r, const Hitable& world, const float depth);
+
+// divides the sum over all samples by their count, applies gamma 2 and
+// quantizes to 8 bit
+const std::array<uint8_t,3> finalizeColor(const Vec3& pixelColor, const uint32_t samplesPerPixel);
+
+// Rec. 709 luminance, used for the per pixel variance estimates
+inline float luminance(const float r, const float g, const float b) {
+	return 0.2126f*r + 0.7152f*g + 0.0722f*b;
+}
+
+// Wavefront path tracer over a BVH: all camera rays of a tile are generated
+// up front, intersected in packets of eight, shaded, and the surviving rays
+// are compacted before the next bounce. Every path draws from its own
+// counter based random stream keyed on (seed, pixel, sample), so the result
+// does not depend on the thread or tile order and sample ranges rendered
+// separately add up to the same image.
+class WavefrontRenderer {
+	public:
+		WavefrontRenderer(const BVH& world, const uint32_t width, const uint32_t height,
+						  const uint32_t maxDepth, const uint32_t tileSize=16);
+
+		// renders the full image, tiles are handed out dynamically to the
+		// OpenMP threads; radiance receives 3 floats per pixel holding the
+		// sum over all samples
+		void render(const Camera& cam, const uint64_t seed, const uint32_t samplesPerPixel,
+					std::vector<float>& radiance) const;
+
+		// adds samples [firstSample, firstSample+sampleCount) of the pixels in
+		// the given rectangle to radiance (3 floats per pixel, w*h pixels);
+		// if given, squaredLuminance (1 float per pixel) receives the sum of
+		// the squared per sample luminance for variance estimation
+		void renderTile(const Camera& cam, const uint64_t seed,
+						const uint32_t x, const uint32_t y, const uint32_t w, const uint32_t h,
+						const uint32_t firstSample, const uint32_t sampleCount,
+						float* radiance, float* squaredLuminance=nullptr) const;
+
+		uint32_t getWidth() const {return width;}
+		uint32_t getHeight() const {return height;}
+		uint32_t getTileSize() const {return tileSize;}
+
+	private:
+		struct RayStream {
+			std::vector<float> ox, oy, oz;
+			std::vector<float> dx, dy, dz;
+			std::vector<float> throughputR, throughputG, throughputB;
+			std::vector<uint32_t> pixel;
+			std::vector<uint64_t> key;
+			std::vector<uint32_t> counter;
+			std::vector<float> t;
+			std::vector<int32_t> prim;
+			size_t size{0};
+
+			void resize(const size_t count);
+			void copy(const size_t from, const size_t to);
+		};
+
+		static const uint32_t maxRaysPerPass{8192};
+
+		const BVH& world;
+		std::vector<MaterialInfo> materials;
+		uint32_t width;
+		uint32_t height;
+		uint32_t maxDepth;
+		uint32_t tileSize;
+
+		void generateCameraRays(RayStream& rays, const Camera& cam, const uint64_t seed,
+								const uint32_t x, const uint32_t y, const uint32_t w, const uint32_t h,
+								const uint32_t firstSample, const uint32_t sampleCount) const;
+		void intersect(RayStream& rays) const;
+		bool shade(RayStream& rays, const size_t i, float* radiance, float* squaredLuminance) const;
+};
@@ -0,0 +1,421 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <thread>
+
+#include "RenderFarm.h"
+#include "Scene.h"
+#include "Mat4.h"
+#include "Rand.h"
+#include "bmp.h"
+
+typedef std::chrono::high_resolution_clock Clock;
+
+Camera frameCamera(const FarmSettings& settings, const uint32_t frame) {
+	const Mat4 m{Mat4::rotationY(float(settings.stepping))};
+	Vec3 lookFrom{13,2,3};
+	for (uint32_t i = 0;i<=frame;++i) lookFrom = m*lookFrom;
+
+	const float aspectRatio{float(settings.width)/float(settings.height)};
+	return Camera{lookFrom, Vec3{0,0,0}, Vec3{0,1,0}, 20, aspectRatio, 0.1f, 10.0f};
+}
+
+static std::string toString(const BinaryEncoder& e) {
+	const std::vector<uint8_t> data{e.getEncodedMessage()};
+	return std::string(data.begin(), data.end());
+}
+
+static BinaryDecoder toDecoder(const std::string& message) {
+	return BinaryDecoder(std::vector<uint8_t>(message.begin(), message.end()));
+}
+
+static void encode(BinaryEncoder& e, const FarmSettings& s) {
+	e.add(s.width);
+	e.add(s.height);
+	e.add(s.maxDepth);
+	e.add(s.frameCount);
+	e.add(s.stepping);
+	e.add(s.tileSize);
+	e.add(s.passSamples);
+	e.add(s.minSamples);
+	e.add(s.maxSamples);
+	e.add(s.sceneSeed);
+	e.add(s.varianceThreshold);
+}
+
+static FarmSettings decodeSettings(BinaryDecoder& d) {
+	FarmSettings s;
+	s.width = d.nextUint32();
+	s.height = d.nextUint32();
+	s.maxDepth = d.nextUint32();
+	s.frameCount = d.nextUint32();
+	s.stepping = d.nextUint32();
+	s.tileSize = d.nextUint32();
+	s.passSamples = d.nextUint32();
+	s.minSamples = d.nextUint32();
+	s.maxSamples = d.nextUint32();
+	s.sceneSeed = d.nextUint32();
+	s.varianceThreshold = d.nextFloat();
+	return s;
+}
+
+static void encode(BinaryEncoder& e, const FarmJob& j) {
+	e.add(j.id);
+	e.add(j.frame);
+	e.add(j.tile);
+	e.add(j.x);
+	e.add(j.y);
+	e.add(j.w);
+	e.add(j.h);
+	e.add(j.firstSample);
+	e.add(j.sampleCount);
+}
+
+static FarmJob decodeJob(BinaryDecoder& d) {
+	FarmJob j;
+	j.id = d.nextUint32();
+	j.frame = d.nextUint32();
+	j.tile = d.nextUint32();
+	j.x = d.nextUint32();
+	j.y = d.nextUint32();
+	j.w = d.nextUint32();
+	j.h = d.nextUint32();
+	j.firstSample = d.nextUint32();
+	j.sampleCount = d.nextUint32();
+	return j;
+}
+
+static std::string simpleMessage(const FarmMessage type) {
+	BinaryEncoder e;
+	e.add(uint8_t(type));
+	return toString(e);
+}
+
+RenderCoordinator::RenderCoordinator(uint16_t port, const FarmSettings& settings) :
+	Server(port),
+	settings{settings}
+{
+}
+
+void RenderCoordinator::handleClientConnection(uint32_t id, const std::string& address, uint16_t port) {
+	std::cout << "Worker " << id << " connected from " << address << ":" << port << std::endl;
+}
+
+void RenderCoordinator::handleError(const std::string& message) {
+	std::cerr << "Coordinator error: " << message << std::endl;
+}
+
+void RenderCoordinator::handleClientDisconnection(uint32_t id) {
+	const std::scoped_lock<std::mutex> lock(stateMutex);
+	std::cout << "Worker " << id << " disconnected" << std::endl;
+
+	// hand the sample ranges of its unfinished jobs to other workers
+	for (auto it = jobsInFlight.begin(); it != jobsInFlight.end();) {
+		if (it->second.first == id) {
+			const FarmJob job{it->second.second};
+			it = jobsInFlight.erase(it);
+
+			auto frameIt = openFrames.find(job.frame);
+			if (frameIt == openFrames.end()) continue;
+			Tile& tile{frameIt->second.tiles[job.tile]};
+			tile.jobsInFlight--;
+			if (!tile.converged) tile.lostRanges.push_back({job.firstSample, job.sampleCount});
+			completeTile(frameIt, job.tile);
+		} else {
+			++it;
+		}
+	}
+}
+
+bool RenderCoordinator::isFinished() {
+	const std::scoped_lock<std::mutex> lock(stateMutex);
+	return framesDone == settings.frameCount;
+}
+
+void RenderCoordinator::handleClientMessage(uint32_t id, const std::string& message) {
+	try {
+		BinaryDecoder d{toDecoder(message)};
+		switch (FarmMessage(d.nextUint8())) {
+			case FarmMessage::RequestJob :
+				assignJob(id);
+				break;
+			case FarmMessage::Result :
+				mergeResult(message);
+				break;
+			default:
+				std::cerr << "Unexpected message from worker " << id << std::endl;
+				break;
+		}
+	} catch (const MessageException& e) {
+		std::cerr << "Invalid message from worker " << id << ": " << e.what() << std::endl;
+	}
+}
+
+void RenderCoordinator::openFrame(const uint32_t frameIndex) {
+	Frame frame;
+	for (uint32_t y = 0;y<settings.height;y+=settings.tileSize) {
+		for (uint32_t x = 0;x<settings.width;x+=settings.tileSize) {
+			Tile tile;
+			tile.x = x;
+			tile.y = y;
+			tile.w = std::min(settings.tileSize, settings.width-x);
+			tile.h = std::min(settings.tileSize, settings.height-y);
+			tile.radiance.resize(size_t(tile.w)*tile.h*3, 0.0f);
+			tile.squaredLuminance.resize(size_t(tile.w)*tile.h, 0.0f);
+			frame.tiles.push_back(tile);
+		}
+	}
+	frame.openTiles = uint32_t(frame.tiles.size());
+	frame.startTime = Clock::now();
+	openFrames[frameIndex] = std::move(frame);
+}
+
+std::optional<FarmJob> RenderCoordinator::nextJob() {
+	while (true) {
+		for (auto& [frameIndex, frame] : openFrames) {
+			for (uint32_t t = 0;t<frame.tiles.size();++t) {
+				Tile& tile{frame.tiles[t]};
+				if (tile.converged) continue;
+
+				FarmJob job{0, frameIndex, t, tile.x, tile.y, tile.w, tile.h, 0, 0};
+				if (!tile.lostRanges.empty()) {
+					job.firstSample = tile.lostRanges.back().first;
+					job.sampleCount = tile.lostRanges.back().second;
+					tile.lostRanges.pop_back();
+				} else {
+					// up to minSamples passes may run in parallel, after that
+					// only one pass ahead of the last variance estimate
+					const uint32_t limit{std::min(settings.maxSamples,
+												  std::max(settings.minSamples, tile.samplesDone + settings.passSamples))};
+					if (tile.samplesDispatched >= limit) continue;
+					job.firstSample = tile.samplesDispatched;
+					job.sampleCount = std::min(settings.passSamples, limit - tile.samplesDispatched);
+					tile.samplesDispatched += job.sampleCount;
+				}
+				job.id = ++lastJobID;
+				tile.jobsInFlight++;
+				return job;
+			}
+		}
+
+		// all open frames are busy, look ahead to the next frame
+		if (nextFrame < settings.frameCount && openFrames.size() < maxOpenFrames) {
+			openFrame(nextFrame++);
+		} else {
+			return {};
+		}
+	}
+}
+
+void RenderCoordinator::assignJob(uint32_t workerID) {
+	const std::scoped_lock<std::mutex> lock(stateMutex);
+
+	if (framesDone == settings.frameCount) {
+		sendMessage(simpleMessage(FarmMessage::Finished), workerID);
+		return;
+	}
+
+	const std::optional<FarmJob> job{nextJob()};
+	if (!job) {
+		sendMessage(simpleMessage(FarmMessage::Wait), workerID);
+		return;
+	}
+
+	jobsInFlight[job->id] = {workerID, *job};
+
+	BinaryEncoder e;
+	e.add(uint8_t(FarmMessage::Job));
+	encode(e, settings);
+	encode(e, *job);
+	sendMessage(toString(e), workerID);
+}
+
+float RenderCoordinator::tileError(const Tile& tile) const {
+	const double n{double(tile.samplesDone)};
+	if (n < 2) return std::numeric_limits<float>::infinity();
+
+	double errorSum{0};
+	double meanSum{0};
+	for (size_t i = 0;i<tile.squaredLuminance.size();++i) {
+		const double mean{luminance(tile.radiance[i*3], tile.radiance[i*3+1], tile.radiance[i*3+2]) / n};
+		const double variance{std::max(0.0, (tile.squaredLuminance[i] / n - mean*mean) * n / (n-1))};
+		errorSum += std::sqrt(variance / n);
+		meanSum += mean;
+	}
+	return float(errorSum / (meanSum + 1e-3));
+}
+
+void RenderCoordinator::mergeResult(const std::string& message) {
+	BinaryDecoder d{toDecoder(message)};
+	d.nextUint8();
+	const FarmJob job{decodeJob(d)};
+
+	const std::scoped_lock<std::mutex> lock(stateMutex);
+	auto inFlight = jobsInFlight.find(job.id);
+	if (inFlight == jobsInFlight.end()) return; // worker was considered lost
+	jobsInFlight.erase(inFlight);
+
+	auto frameIt = openFrames.find(job.frame);
+	if (frameIt == openFrames.end()) return;
+	Frame& frame{frameIt->second};
+	Tile& tile{frame.tiles[job.tile]};
+
+	for (float& r : tile.radiance) r += d.nextFloat();
+	for (float& l : tile.squaredLuminance) l += d.nextFloat();
+	tile.samplesDone += job.sampleCount;
+	tile.jobsInFlight--;
+
+	if (!tile.converged) {
+		if (tile.samplesDone >= settings.maxSamples ||
+			(tile.samplesDone >= settings.minSamples && tileError(tile) < settings.varianceThreshold)) {
+			tile.converged = true;
+			tile.lostRanges.clear();
+		}
+	}
+	completeTile(frameIt, job.tile);
+}
+
+void RenderCoordinator::completeTile(std::map<uint32_t, Frame>::iterator frameIt, const uint32_t tileIndex) {
+	Frame& frame{frameIt->second};
+	Tile& tile{frame.tiles[tileIndex]};
+	if (!tile.converged || tile.jobsInFlight > 0 || tile.complete) return;
+
+	tile.complete = true;
+	if (--frame.openTiles == 0) {
+		finishFrame(frameIt->first, frame);
+		openFrames.erase(frameIt);
+	}
+}
+
+void RenderCoordinator::finishFrame(const uint32_t frameIndex, Frame& frame) {
+	std::vector<uint8_t> image(size_t(settings.width)*settings.height*4);
+	uint64_t totalSamples{0};
+	for (const Tile& tile : frame.tiles) {
+		totalSamples += uint64_t(tile.samplesDone)*tile.w*tile.h;
+		for (uint32_t j = 0;j<tile.h;++j) {
+			for (uint32_t i = 0;i<tile.w;++i) {
+				const float* r{&tile.radiance[(j*tile.w+i)*3]};
+				const auto c = finalizeColor(Vec3{r[0], r[1], r[2]}, tile.samplesDone);
+				const size_t index{((tile.y+j)*size_t(settings.width) + tile.x+i)*4};
+				image[index+0] = c[0];
+				image[index+1] = c[1];
+				image[index+2] = c[2];
+				image[index+3] = 255;
+			}
+		}
+	}
+
+	std::stringstream s;
+	s << "result" << std::setfill('0') << std::setw(3) << frameIndex*settings.stepping << ".bmp";
+	save(s.str(), settings.width, settings.height, image);
+	++framesDone;
+
+	const auto t2 = Clock::now();
+	std::cout << "Done with " << s.str() << " "
+			  << std::chrono::duration_cast<std::chrono::milliseconds>(t2-frame.startTime).count() << " ms passed, "
+			  << std::fixed << std::setprecision(1)
+			  << double(totalSamples) / (double(settings.width)*settings.height) << " samples per pixel on average"
+			  << std::endl;
+}
+
+RenderWorker::RenderWorker(const std::string& address, uint16_t port) :
+	Client(address, port)
+{
+}
+
+void RenderWorker::handleServerMessage(const std::string& message) {
+	{
+		const std::scoped_lock<std::mutex> lock(messageMutex);
+		messages.push(message);
+	}
+	messageAvailable.notify_one();
+}
+
+void RenderWorker::prepare(const FarmSettings& settings) {
+	if (currentSettings && currentSettings->sceneSeed == settings.sceneSeed &&
+		currentSettings->width == settings.width && currentSettings->height == settings.height &&
+		currentSettings->maxDepth == settings.maxDepth) return;
+
+	// same seed, same binary, same scene as on the coordinator
+	Rand::seed(settings.sceneSeed);
+	renderer = nullptr;
+	world = std::make_unique<BVH>(randomSphereScene());
+	renderer = std::make_unique<WavefrontRenderer>(*world, settings.width, settings.height, settings.maxDepth);
+	currentSettings = settings;
+}
+
+std::string RenderWorker::render(const FarmSettings& settings, const FarmJob& job) {
+	prepare(settings);
+
+	const Camera cam{frameCamera(settings, job.frame)};
+	const size_t pixelCount{size_t(job.w)*job.h};
+	std::vector<float> radiance(pixelCount*3, 0.0f);
+	std::vector<float> squaredLuminance(pixelCount, 0.0f);
+
+	// split the sample range across the local threads, counter based
+	// sampling makes the partial sums independent of this split
+	const int threadCount{std::max(1, int(std::thread::hardware_concurrency()))};
+	const uint32_t chunk{(job.sampleCount + threadCount - 1) / threadCount};
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int t = 0;t<threadCount;++t) {
+		const uint32_t first{job.firstSample + t*chunk};
+		const uint32_t end{std::min(job.firstSample + job.sampleCount, first + chunk)};
+		if (first >= end) continue;
+		std::vector<float> partialRadiance(pixelCount*3, 0.0f);
+		std::vector<float> partialLuminance(pixelCount, 0.0f);
+		renderer->renderTile(cam, job.frame, job.x, job.y, job.w, job.h, first, end-first,
+							 partialRadiance.data(), partialLuminance.data());
+		#pragma omp critical
+		{
+			for (size_t i = 0;i<radiance.size();++i) radiance[i] += partialRadiance[i];
+			for (size_t i = 0;i<squaredLuminance.size();++i) squaredLuminance[i] += partialLuminance[i];
+		}
+	}
+
+	BinaryEncoder e;
+	e.add(uint8_t(FarmMessage::Result));
+	encode(e, job);
+	for (const float r : radiance) e.add(r);
+	for (const float l : squaredLuminance) e.add(l);
+	return toString(e);
+}
+
+void RenderWorker::run() {
+	while (true) {
+		sendMessage(simpleMessage(FarmMessage::RequestJob));
+
+		std::string message;
+		{
+			std::unique_lock<std::mutex> lock(messageMutex);
+			// re-request if the answer got lost with a reconnect
+			if (!messageAvailable.wait_for(lock, std::chrono::seconds(10), [this]{return !messages.empty();})) continue;
+			message = messages.front();
+			messages.pop();
+		}
+
+		try {
+			BinaryDecoder d{toDecoder(message)};
+			switch (FarmMessage(d.nextUint8())) {
+				case FarmMessage::Job : {
+					const FarmSettings settings{decodeSettings(d)};
+					const FarmJob job{decodeJob(d)};
+					sendMessage(render(settings, job));
+					break;
+				}
+				case FarmMessage::Wait :
+					std::this_thread::sleep_for(std::chrono::milliseconds(100));
+					break;
+				case FarmMessage::Finished :
+					// let the client thread flush the queue before we leave
+					while (cueSize() > 0) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+					return;
+				default:
+					std::cerr << "Unexpected message from coordinator" << std::endl;
+					break;
+			}
+		} catch (const MessageException& e) {
+			std::cerr << "Invalid message from coordinator: " << e.what() << std::endl;
+		}
+	}
+}
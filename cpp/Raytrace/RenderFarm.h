@@ -0,0 +1,137 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <optional>
+#include <condition_variable>
+
+#include <Server.h>
+#include <Client.h>
+
+#include "BVH.h"
+#include "Camera.h"
+#include "Render.h"
+
+// Everything a worker needs to reproduce the coordinator's scene, camera
+// path and sampling; it travels with every job so workers need no setup.
+struct FarmSettings {
+	uint32_t width{1920};
+	uint32_t height{1080};
+	uint32_t maxDepth{50};
+	uint32_t frameCount{72};
+	uint32_t stepping{5};
+	uint32_t tileSize{32};
+	uint32_t passSamples{16};
+	uint32_t minSamples{32};
+	uint32_t maxSamples{512};
+	uint32_t sceneSeed{42};
+	// a tile stops once the mean standard error of its pixel luminance
+	// relative to its mean luminance drops below this value
+	float varianceThreshold{0.02f};
+};
+
+// camera of the given frame on the orbit used by main.cpp
+Camera frameCamera(const FarmSettings& settings, const uint32_t frame);
+
+enum class FarmMessage : uint8_t {
+	RequestJob = 1,
+	Job,
+	Result,
+	Wait,
+	Finished
+};
+
+struct FarmJob {
+	uint32_t id;
+	uint32_t frame;
+	uint32_t tile;
+	uint32_t x;
+	uint32_t y;
+	uint32_t w;
+	uint32_t h;
+	uint32_t firstSample;
+	uint32_t sampleCount;
+};
+
+class RenderCoordinator : public Server<SizedClientConnection> {
+public:
+	RenderCoordinator(uint16_t port, const FarmSettings& settings);
+	virtual ~RenderCoordinator() {}
+
+	virtual void handleClientConnection(uint32_t id, const std::string& address, uint16_t port) override;
+	virtual void handleClientMessage(uint32_t id, const std::string& message) override;
+	virtual void handleClientDisconnection(uint32_t id) override;
+	virtual void handleError(const std::string& message) override;
+
+	bool isFinished();
+
+private:
+	struct Tile {
+		uint32_t x;
+		uint32_t y;
+		uint32_t w;
+		uint32_t h;
+		uint32_t samplesDispatched{0};
+		uint32_t samplesDone{0};
+		uint32_t jobsInFlight{0};
+		bool converged{false};
+		bool complete{false};
+		std::vector<float> radiance;
+		std::vector<float> squaredLuminance;
+		// sample ranges of jobs lost with a disconnected worker
+		std::vector<std::pair<uint32_t,uint32_t>> lostRanges;
+	};
+
+	struct Frame {
+		std::vector<Tile> tiles;
+		uint32_t openTiles;
+		std::chrono::high_resolution_clock::time_point startTime;
+	};
+
+	static const uint32_t maxOpenFrames{3};
+
+	FarmSettings settings;
+	std::mutex stateMutex;
+	std::map<uint32_t, Frame> openFrames;
+	std::map<uint32_t, std::pair<uint32_t, FarmJob>> jobsInFlight;
+	uint32_t nextFrame{0};
+	uint32_t framesDone{0};
+	uint32_t lastJobID{0};
+
+	void openFrame(const uint32_t frame);
+	std::optional<FarmJob> nextJob();
+	void assignJob(uint32_t workerID);
+	void mergeResult(const std::string& message);
+	float tileError(const Tile& tile) const;
+	void completeTile(std::map<uint32_t, Frame>::iterator frameIt, const uint32_t tileIndex);
+	void finishFrame(const uint32_t frameIndex, Frame& frame);
+};
+
+class RenderWorker : public Client {
+public:
+	RenderWorker(const std::string& address, uint16_t port);
+	virtual ~RenderWorker() {}
+
+	virtual void handleServerMessage(const std::string& message) override;
+
+	// requests and renders jobs until the coordinator reports that all
+	// frames are done
+	void run();
+
+private:
+	std::mutex messageMutex;
+	std::condition_variable messageAvailable;
+	std::queue<std::string> messages;
+
+	std::optional<FarmSettings> currentSettings;
+	std::unique_ptr<BVH> world;
+	std::unique_ptr<WavefrontRenderer> renderer;
+
+	void prepare(const FarmSettings& settings);
+	std::string render(const FarmSettings& settings, const FarmJob& job);
+};
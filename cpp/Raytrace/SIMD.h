@@ -0,0 +1,125 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Minimal eight lane float/int vectors. With AVX2 enabled (-mavx2 or
+// -march=native, /arch:AVX2 on MSVC) these map to __m256, otherwise they
+// fall back to plain loops over std::array so the code still runs anywhere.
+
+#ifdef __AVX2__
+
+class Float8 {
+public:
+	Float8() : v{_mm256_setzero_ps()} {}
+	Float8(float s) : v{_mm256_set1_ps(s)} {}
+	Float8(__m256 v) : v{v} {}
+
+	static Float8 load(const float* p) {return _mm256_loadu_ps(p);}
+	void store(float* p) const {_mm256_storeu_ps(p, v);}
+
+	Float8 operator+(const Float8& o) const {return _mm256_add_ps(v, o.v);}
+	Float8 operator-(const Float8& o) const {return _mm256_sub_ps(v, o.v);}
+	Float8 operator*(const Float8& o) const {return _mm256_mul_ps(v, o.v);}
+	Float8 operator/(const Float8& o) const {return _mm256_div_ps(v, o.v);}
+	Float8 operator-() const {return _mm256_xor_ps(v, _mm256_set1_ps(-0.0f));}
+
+	Float8 operator<(const Float8& o) const {return _mm256_cmp_ps(v, o.v, _CMP_LT_OQ);}
+	Float8 operator>(const Float8& o) const {return _mm256_cmp_ps(v, o.v, _CMP_GT_OQ);}
+	Float8 operator<=(const Float8& o) const {return _mm256_cmp_ps(v, o.v, _CMP_LE_OQ);}
+	Float8 operator&(const Float8& o) const {return _mm256_and_ps(v, o.v);}
+	Float8 operator|(const Float8& o) const {return _mm256_or_ps(v, o.v);}
+	Float8 andNot(const Float8& o) const {return _mm256_andnot_ps(o.v, v);}
+
+	static Float8 min(const Float8& a, const Float8& b) {return _mm256_min_ps(a.v, b.v);}
+	static Float8 max(const Float8& a, const Float8& b) {return _mm256_max_ps(a.v, b.v);}
+	static Float8 sqrt(const Float8& a) {return _mm256_sqrt_ps(a.v);}
+	// lanes of a where mask is set, b otherwise
+	static Float8 select(const Float8& mask, const Float8& a, const Float8& b) {return _mm256_blendv_ps(b.v, a.v, mask.v);}
+
+	// one bit per lane, set where the lane of a comparison result is true
+	int mask() const {return _mm256_movemask_ps(v);}
+
+	static Float8 laneMask(const uint32_t count) {
+		const __m256i lanes{_mm256_setr_epi32(0,1,2,3,4,5,6,7)};
+		return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(int32_t(count)), lanes));
+	}
+
+	__m256 v;
+};
+
+class Int8 {
+public:
+	Int8(int32_t s) : v{_mm256_set1_epi32(s)} {}
+	Int8(__m256i v) : v{v} {}
+
+	void store(int32_t* p) const {_mm256_storeu_si256((__m256i*)p, v);}
+	static Int8 select(const Float8& mask, const Int8& a, const Int8& b) {
+		return _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(b.v), _mm256_castsi256_ps(a.v), mask.v));
+	}
+
+	__m256i v;
+};
+
+#else
+
+class Float8 {
+public:
+	Float8() : v{} {}
+	Float8(float s) {v.fill(s);}
+
+	static Float8 load(const float* p) {Float8 r; std::copy(p, p+8, r.v.begin()); return r;}
+	void store(float* p) const {std::copy(v.begin(), v.end(), p);}
+
+	Float8 operator+(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = v[i]+o.v[i]; return r;}
+	Float8 operator-(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = v[i]-o.v[i]; return r;}
+	Float8 operator*(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = v[i]*o.v[i]; return r;}
+	Float8 operator/(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = v[i]/o.v[i]; return r;}
+	Float8 operator-() const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = -v[i]; return r;}
+
+	Float8 operator<(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(v[i]<o.v[i]); return r;}
+	Float8 operator>(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(v[i]>o.v[i]); return r;}
+	Float8 operator<=(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(v[i]<=o.v[i]); return r;}
+	Float8 operator&(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(isSet(v[i]) && isSet(o.v[i])); return r;}
+	Float8 operator|(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(isSet(v[i]) || isSet(o.v[i])); return r;}
+	Float8 andNot(const Float8& o) const {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(isSet(v[i]) && !isSet(o.v[i])); return r;}
+
+	static Float8 min(const Float8& a, const Float8& b) {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r;}
+	static Float8 max(const Float8& a, const Float8& b) {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r;}
+	static Float8 sqrt(const Float8& a) {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = std::sqrt(a.v[i]); return r;}
+	static Float8 select(const Float8& mask, const Float8& a, const Float8& b) {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = isSet(mask.v[i]) ? a.v[i] : b.v[i]; return r;}
+
+	int mask() const {int m{0}; for (size_t i=0;i<8;++i) if (isSet(v[i])) m |= 1 << i; return m;}
+
+	static Float8 laneMask(const uint32_t count) {Float8 r; for (size_t i=0;i<8;++i) r.v[i] = fromBool(i < count); return r;}
+
+	std::array<float, 8> v;
+
+private:
+	// masks are stored as 1.0 / 0.0 in the scalar fallback
+	static float fromBool(bool b) {return b ? 1.0f : 0.0f;}
+	static bool isSet(float f) {return f != 0.0f;}
+	friend class Int8;
+};
+
+class Int8 {
+public:
+	Int8(int32_t s) {v.fill(s);}
+
+	void store(int32_t* p) const {std::copy(v.begin(), v.end(), p);}
+	static Int8 select(const Float8& mask, const Int8& a, const Int8& b) {
+		Int8 r{0};
+		for (size_t i=0;i<8;++i) r.v[i] = Float8::isSet(mask.v[i]) ? a.v[i] : b.v[i];
+		return r;
+	}
+
+	std::array<int32_t, 8> v;
+};
+
+#endif
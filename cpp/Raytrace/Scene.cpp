@@ -0,0 +1,48 @@
+#include "Scene.h"
+#include "Rand.h"
+
+std::vector<std::shared_ptr<const Sphere>> randomSphereScene(const int32_t extent) {
+	std::vector<std::shared_ptr<const Sphere>> world{};
+
+	// Bottom "plane"
+	world.push_back(std::make_shared<Sphere>(Vec3{0.0f,-1000.0f,0.0f}, 1000.0f, std::make_shared<Lambertian>(Vec3{0.5f, 0.5f, 0.5f})));
+
+	// three large spheres
+	world.push_back(std::make_shared<Sphere>(Vec3{0.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Dielectric>(1.5f)));
+	world.push_back(std::make_shared<Sphere>(Vec3{-4.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Lambertian>(Vec3{0.4f, 0.2f, 0.1f})));
+	world.push_back(std::make_shared<Sphere>(Vec3{4.0f, 1.0f, 0.0f}, 1.0f, std::make_shared<Metal>(Vec3{0.7f, 0.6f, 0.5f}, 0.0f)));
+
+	// numerous small spheres
+	for (int32_t a{-extent}; a < extent;++a) {
+		for (int32_t b{-extent}; b < extent;++b) {
+			const float chooseMat{Rand::rand01()};
+			const Vec3 center{a + 0.9f*Rand::rand01(), 0.2f, b + 0.9f*Rand::rand01()};
+
+			if ((center - Vec3{4.0f, 0.2f, 0.0f}).length() > 0.9f) {
+				if (chooseMat < 0.8f) {
+					// diffuse
+					const Vec3 color{Vec3::random() * Vec3::random()};
+					world.push_back(std::make_shared<Sphere>(center, 0.2f, std::make_shared<Lambertian>(color)));
+				} else {
+					if (chooseMat < 0.9f) {
+						// metal
+						const float c{Rand::rand005()};
+						const Vec3 color{c,c,c};
+						const float fuzz{Rand::rand051()};
+						world.push_back(std::make_shared<Sphere>(center, 0.2f, std::make_shared<Metal>(color, fuzz)));
+					} else {
+						// glass
+						world.push_back(std::make_shared<Sphere>(center, 0.2f, std::make_shared<Dielectric>(1.5f)));
+					}
+				}
+			}
+		}
+	}
+	return world;
+}
+
+HitableList toHitableList(const std::vector<std::shared_ptr<const Sphere>>& spheres) {
+	HitableList list{};
+	for (const auto& sphere : spheres) list.add(sphere);
+	return list;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Sphere.h"
+#include "HitableList.h"
+
+// the "Ray Tracing in One Weekend" cover scene, extent controls the number
+// of small spheres: (2*extent)^2 grid cells, 11 gives the original ~500
+std::vector<std::shared_ptr<const Sphere>> randomSphereScene(const int32_t extent=11);
+
+HitableList toHitableList(const std::vector<std::shared_ptr<const Sphere>>& spheres);
@@ -13,6 +13,10 @@ class Sphere : public Hitable {
 		Sphere(const Vec3& center, const float radius, const std::shared_ptr<Material> material);
 		virtual ~Sphere() {}
 		virtual const std::optional<HitRecord> hit(const Ray& r, const float tMin, const float tMax) const;
+
+		const Vec3 getCenter() const {return center;}
+		float getRadius() const {return radius;}
+		const std::shared_ptr<Material> getMaterial() const {return material;}
 		
 	private:
 		const Vec3 center;
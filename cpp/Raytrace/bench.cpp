@@ -0,0 +1,151 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <limits>
+#include <cmath>
+
+#include <chrono>
+typedef std::chrono::high_resolution_clock Clock;
+
+#include "BVH.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Rand.h"
+#include "Render.h"
+
+// Compares the linear HitableList scan against the BVH on the random sphere
+// scene at growing sphere counts and reports closest-hit queries per second,
+// then compares the recursive per-pixel integrator against the wavefront
+// renderer in samples per second and mean image color.
+
+static std::vector<Ray> generateRays(const Camera& cam, const size_t count) {
+	std::vector<Ray> rays;
+	rays.reserve(count);
+	for (size_t i = 0;i<count;++i) {
+		rays.push_back(cam.getRay(Rand::rand01(), Rand::rand01()));
+	}
+	return rays;
+}
+
+static double traceAll(const Hitable& world, const std::vector<Ray>& rays, std::vector<float>& hits) {
+	hits.resize(rays.size());
+	const auto t1 = Clock::now();
+	for (size_t i = 0;i<rays.size();++i) {
+		const auto rec{world.hit(rays[i], 0.001f, std::numeric_limits<float>::infinity())};
+		hits[i] = rec ? rec->t : -1.0f;
+	}
+	const auto t2 = Clock::now();
+	return std::chrono::duration<double>(t2-t1).count();
+}
+
+static void benchIntersection(const Camera& cam) {
+	std::cout << std::setw(8) << "spheres" << std::setw(10) << "build ms"
+			  << std::setw(8) << "nodes" << std::setw(8) << "depth"
+			  << std::setw(14) << "list Mrays/s" << std::setw(14) << "BVH Mrays/s"
+			  << std::setw(10) << "speedup" << std::setw(12) << "mismatches" << std::endl;
+
+	for (const int32_t extent : {11, 32, 100, 160}) {
+		const auto spheres{randomSphereScene(extent)};
+		const HitableList list{toHitableList(spheres)};
+
+		const auto b1 = Clock::now();
+		const BVH bvh{spheres};
+		const auto b2 = Clock::now();
+
+		// keep the linear scan affordable for large scenes
+		const size_t bvhRayCount{1000000};
+		const size_t listRayCount{std::max<size_t>(1000, size_t(200000000 / spheres.size()) / 100)};
+
+		const std::vector<Ray> rays{generateRays(cam, bvhRayCount)};
+		const std::vector<Ray> listRays(rays.begin(), rays.begin() + std::min(listRayCount, rays.size()));
+
+		std::vector<float> listHits, bvhHits;
+		const double listTime{traceAll(list, listRays, listHits)};
+		const double bvhTime{traceAll(bvh, rays, bvhHits)};
+
+		size_t mismatches{0};
+		for (size_t i = 0;i<listHits.size();++i) {
+			if (std::fabs(listHits[i] - bvhHits[i]) > 1e-4f) ++mismatches;
+		}
+
+		const double listRate{listRays.size() / listTime / 1e6};
+		const double bvhRate{rays.size() / bvhTime / 1e6};
+
+		std::cout << std::setw(8) << spheres.size()
+				  << std::setw(10) << std::chrono::duration_cast<std::chrono::milliseconds>(b2-b1).count()
+				  << std::setw(8) << bvh.nodeCount() << std::setw(8) << bvh.depth()
+				  << std::fixed << std::setprecision(4)
+				  << std::setw(14) << listRate << std::setw(14) << bvhRate
+				  << std::setprecision(1) << std::setw(9) << bvhRate/listRate << "x"
+				  << std::setw(12) << mismatches << std::endl;
+	}
+}
+
+static Vec3 meanColor(const std::vector<float>& radiance, const uint32_t samplesPerPixel) {
+	double r{0}, g{0}, b{0};
+	for (size_t i = 0;i<radiance.size();i+=3) {
+		r += radiance[i];
+		g += radiance[i+1];
+		b += radiance[i+2];
+	}
+	const double n{double(radiance.size()/3) * samplesPerPixel};
+	return Vec3{float(r/n), float(g/n), float(b/n)};
+}
+
+static void benchIntegrators(const Camera& cam, const float aspectRatio) {
+	const uint32_t imageWidth{480};
+	const uint32_t imageHeight{uint32_t(imageWidth / aspectRatio)};
+	const uint32_t samplesPerPixel{16};
+	const uint32_t maxDepth{50};
+	const double sampleCount{double(imageWidth)*imageHeight*samplesPerPixel};
+
+	const BVH world{randomSphereScene()};
+
+	std::vector<float> recursive(size_t(imageWidth)*imageHeight*3);
+	auto t1 = Clock::now();
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int j=0; j < int(imageHeight); ++j) {
+		for (uint32_t i{0}; i < imageWidth; ++i) {
+			Vec3 pixelColor{0,0,0};
+			for (uint32_t s{0}; s < samplesPerPixel; ++s) {
+				const float u{(i + Rand::rand01()) / (imageWidth-1)};
+				const float v{(j + Rand::rand01()) / (imageHeight-1)};
+				pixelColor = pixelColor + rayColor(cam.getRay(u, v), world, maxDepth);
+			}
+			const size_t index{(j * size_t(imageWidth) + i)*3};
+			recursive[index+0] = pixelColor.r();
+			recursive[index+1] = pixelColor.g();
+			recursive[index+2] = pixelColor.b();
+		}
+	}
+	auto t2 = Clock::now();
+	const double recursiveTime{std::chrono::duration<double>(t2-t1).count()};
+
+	const WavefrontRenderer renderer{world, imageWidth, imageHeight, maxDepth};
+	std::vector<float> wavefront;
+	t1 = Clock::now();
+	renderer.render(cam, 0, samplesPerPixel, wavefront);
+	t2 = Clock::now();
+	const double wavefrontTime{std::chrono::duration<double>(t2-t1).count()};
+
+	std::cout << std::endl << imageWidth << "x" << imageHeight << ", " << samplesPerPixel
+			  << " spp, max depth " << maxDepth << std::endl;
+	std::cout << std::setw(12) << "integrator" << std::setw(14) << "Msamples/s"
+			  << std::setw(34) << "mean color" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::setw(12) << "recursive" << std::setw(14) << sampleCount / recursiveTime / 1e6
+			  << std::setw(34) << meanColor(recursive, samplesPerPixel).toString() << std::endl;
+	std::cout << std::setw(12) << "wavefront" << std::setw(14) << sampleCount / wavefrontTime / 1e6
+			  << std::setw(34) << meanColor(wavefront, samplesPerPixel).toString() << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	const float aspectRatio{16.0f/9.0f};
+	const Camera cam{Vec3{13,2,3}, Vec3{0,0,0}, Vec3{0,1,0}, 20, aspectRatio, 0.1f, 10.0f};
+
+	benchIntersection(cam);
+	benchIntegrators(cam, aspectRatio);
+
+	return EXIT_SUCCESS;
+}
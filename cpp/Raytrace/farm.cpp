@@ -0,0 +1,97 @@
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <cstdlib>
+
+#include "RenderFarm.h"
+
+// Progressive distributed renderer for the orbit animation of main.cpp.
+//
+//   raytraceFarm coordinator [port] [width] [frames] [threshold]
+//   raytraceFarm worker [host] [port]
+//   raytraceFarm local [workers] [port] [width] [frames] [threshold]
+//
+// The coordinator splits every frame into tiles and hands out sample ranges
+// to the workers, a tile stops receiving samples once its noise estimate
+// drops below the threshold. "local" runs a coordinator and spawns the given
+// number of worker processes on this machine.
+
+static void usage(const std::string& name) {
+	std::cerr << "usage: " << name << " coordinator [port] [width] [frames] [threshold]" << std::endl;
+	std::cerr << "       " << name << " worker [host] [port]" << std::endl;
+	std::cerr << "       " << name << " local [workers] [port] [width] [frames] [threshold]" << std::endl;
+}
+
+static FarmSettings parseSettings(int argc, char *argv[], int first) {
+	FarmSettings settings;
+	if (argc > first) {
+		settings.width = uint32_t(atoi(argv[first]));
+		settings.height = settings.width * 9 / 16;
+	}
+	if (argc > first+1) settings.frameCount = uint32_t(atoi(argv[first+1]));
+	if (argc > first+2) settings.varianceThreshold = float(atof(argv[first+2]));
+	return settings;
+}
+
+static int runCoordinator(const uint16_t port, const FarmSettings& settings) {
+	RenderCoordinator coordinator{port, settings};
+	coordinator.start();
+	while (coordinator.isStarting()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	if (!coordinator.isOK()) {
+		std::cerr << "Unable to start the coordinator on port " << port << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Rendering " << settings.frameCount << " frames at " << settings.width << "x"
+			  << settings.height << " on port " << port << std::endl;
+	while (!coordinator.isFinished()) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	// give the workers a chance to pick up their finish message
+	std::this_thread::sleep_for(std::chrono::milliseconds(500));
+	return EXIT_SUCCESS;
+}
+
+static int runWorker(const std::string& host, const uint16_t port) {
+	RenderWorker worker{host, port};
+	worker.run();
+	return EXIT_SUCCESS;
+}
+
+static void spawnWorker(const std::string& executable, const uint16_t port) {
+	std::stringstream command;
+#ifdef _WIN32
+	command << "start /b \"\" \"" << executable << "\" worker 127.0.0.1 " << port;
+#else
+	command << "\"" << executable << "\" worker 127.0.0.1 " << port << " &";
+#endif
+	if (std::system(command.str().c_str()) != 0) {
+		std::cerr << "Unable to start worker: " << command.str() << std::endl;
+	}
+}
+
+int main(int argc, char *argv[]) {
+	if (argc < 2) {
+		usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	const std::string mode{argv[1]};
+	if (mode == "coordinator") {
+		const uint16_t port{uint16_t(argc > 2 ? atoi(argv[2]) : 11004)};
+		return runCoordinator(port, parseSettings(argc, argv, 3));
+	} else if (mode == "worker") {
+		const std::string host{argc > 2 ? argv[2] : "127.0.0.1"};
+		const uint16_t port{uint16_t(argc > 3 ? atoi(argv[3]) : 11004)};
+		return runWorker(host, port);
+	} else if (mode == "local") {
+		const uint32_t workerCount{uint32_t(argc > 2 ? atoi(argv[2]) : 2)};
+		const uint16_t port{uint16_t(argc > 3 ? atoi(argv[3]) : 11004)};
+		const FarmSettings settings{parseSettings(argc, argv, 4)};
+		for (uint32_t i = 0;i<workerCount;++i) spawnWorker(argv[0], port);
+		return runCoordinator(port, settings);
+	}
+
+	usage(argv[0]);
+	return EXIT_FAILURE;
+}
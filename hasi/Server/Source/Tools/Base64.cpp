@@ -1,104 +1,81 @@
 #include "Base64.h"
 
-#ifdef ARDUINO
-  #define STR_LENGTH length
-  #define STR_FIND indexOf
-#else
-  #define STR_LENGTH size 
-  #define STR_FIND find
-#endif
-
-
-static const B64_PORTABLE_STRING base64_chars =
+static const char base64_chars[] =
 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
 "abcdefghijklmnopqrstuvwxyz"
 "0123456789+/";
 
+// the value of every character, -1 outside of the alphabet
+struct DecodeTable {
+  int8_t values[256];
+  
+  DecodeTable() {
+    for (int i = 0;i<256;++i) values[i] = -1;
+    for (int i = 0;i<64;++i) values[uint8_t(base64_chars[i])] = int8_t(i);
+  }
+};
 
-static inline bool is_base64(uint8_t c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
+static const int8_t* decode_table() {
+  static const DecodeTable table;
+  return table.values;
 }
 
 B64_PORTABLE_STRING base64_encode(uint8_t const* buf, unsigned int bufLen) {
   B64_PORTABLE_STRING ret;
-  int i = 0;
-  int j = 0;
-  uint8_t char_array_3[3];
-  uint8_t char_array_4[4];
+  ret.reserve((bufLen+2)/3*4);
   
-  while (bufLen--) {
-    char_array_3[i++] = *(buf++);
-    if (i == 3) {
-      char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-      char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-      char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-      char_array_4[3] = char_array_3[2] & 0x3f;
-      
-      for(i = 0; (i <4) ; i++)
-        ret += base64_chars[char_array_4[i]];
-      i = 0;
-    }
+  unsigned int i = 0;
+  for (;i+3 <= bufLen;i += 3) {
+    const uint32_t v = uint32_t(buf[i]) << 16 | uint32_t(buf[i+1]) << 8 | buf[i+2];
+    ret += base64_chars[v >> 18];
+    ret += base64_chars[(v >> 12) & 0x3f];
+    ret += base64_chars[(v >> 6) & 0x3f];
+    ret += base64_chars[v & 0x3f];
   }
   
-  if (i)
-  {
-    for(j = i; j < 3; j++)
-      char_array_3[j] = '\0';
-    
-    char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-    char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-    char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-    char_array_4[3] = char_array_3[2] & 0x3f;
-    
-    for (j = 0; (j < i + 1); j++)
-      ret += base64_chars[char_array_4[j]];
-    
-    while((i++ < 3))
-      ret += '=';
+  const unsigned int rest = bufLen-i;
+  if (rest) {
+    const uint32_t v = uint32_t(buf[i]) << 16 | (rest == 2 ? uint32_t(buf[i+1]) << 8 : 0);
+    ret += base64_chars[v >> 18];
+    ret += base64_chars[(v >> 12) & 0x3f];
+    ret += rest == 2 ? base64_chars[(v >> 6) & 0x3f] : '=';
+    ret += '=';
   }
   
   return ret;
 }
 
+// decoding stops at the first character outside of the alphabet, such as
+// the padding
 void base64_decode(const B64_PORTABLE_STRING& encoded_string, SimpleVec& result) {
-  int in_len = (int)encoded_string.STR_LENGTH();
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  uint8_t char_array_4[4], char_array_3[3];
+  const int8_t* table = decode_table();
+  const uint32_t in_len = uint32_t(encoded_string.length());
   
-  result.clear();
+  result.setLength((in_len+3)/4*3);
+  uint8_t* out = result.data();
   
-  while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_]; in_++;
-    if (i ==4) {
-      for (i = 0; i <4; i++)
-        char_array_4[i] = (unsigned char)base64_chars.STR_FIND(char_array_4[i]);
-      
-      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-      
-      for (i = 0; (i < 3); i++)
-        result.append(char_array_3[i]);
-      i = 0;
+  uint32_t v = 0;
+  uint32_t count = 0;
+  for (uint32_t in_ = 0;in_ < in_len;++in_) {
+    const int8_t value = table[uint8_t(encoded_string[in_])];
+    if (value < 0) break;
+    v = v << 6 | uint32_t(value);
+    if (++count == 4) {
+      *out++ = uint8_t(v >> 16);
+      *out++ = uint8_t(v >> 8);
+      *out++ = uint8_t(v);
+      v = 0;
+      count = 0;
     }
   }
   
-  if (i) {
-    for (j = i; j <4; j++)
-      char_array_4[j] = 0;
-    
-    for (j = 0; j <4; j++)
-      char_array_4[j] = (unsigned char)base64_chars.STR_FIND(char_array_4[j]);
-    
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-    
-    for (j = 0; (j < i - 1); j++)
-      result.append(char_array_3[j]);
+  if (count > 1) {
+    v <<= 6*(4-count);
+    *out++ = uint8_t(v >> 16);
+    if (count == 3) *out++ = uint8_t(v >> 8);
   }
+  
+  result.truncate(uint32_t(out-result.data()));
 }
 
 